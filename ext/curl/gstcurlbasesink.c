@@ -36,6 +36,13 @@
  *     use-content-length=false
  * ]|
  * </refsect2>
+ *
+ * By default every buffer is completely handed over to libcurl before the
+ * next one is accepted. Setting #GstCurlBaseSink:max-queue-bytes or
+ * #GstCurlBaseSink:max-queue-time lets the sink queue up to that much data
+ * for the transfer thread instead, so upstream is only blocked while the
+ * queue is full. Errors of the transfer are then reported on the next
+ * buffer or at EOS. A flush drops the buffers that are still queued.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -70,6 +77,8 @@
 #define DEFAULT_URL                    "localhost:5555"
 #define DEFAULT_TIMEOUT                30
 #define DEFAULT_QOS_DSCP               0
+#define DEFAULT_MAX_QUEUE_BYTES        0
+#define DEFAULT_MAX_QUEUE_TIME         0
 
 #define DSCP_MIN                       0
 #define DSCP_MAX                       63
@@ -91,7 +100,10 @@ enum
   PROP_USER_PASSWD,
   PROP_FILE_NAME,
   PROP_TIMEOUT,
-  PROP_QOS_DSCP
+  PROP_QOS_DSCP,
+  PROP_MAX_QUEUE_BYTES,
+  PROP_MAX_QUEUE_TIME,
+  PROP_STATS
 };
 
 /* Object class function declarations */
@@ -143,6 +155,10 @@ static void gst_curl_base_sink_wait_for_transfer_thread_to_send_unlocked
 static void gst_curl_base_sink_data_sent_notify (GstCurlBaseSink * sink);
 static void gst_curl_base_sink_wait_for_response (GstCurlBaseSink * sink);
 static void gst_curl_base_sink_got_response_notify (GstCurlBaseSink * sink);
+static void gst_curl_base_sink_wait_for_queue_drained_unlocked
+    (GstCurlBaseSink * sink);
+static void gst_curl_base_sink_queue_flush_unlocked (GstCurlBaseSink * sink);
+static GstStructure *gst_curl_base_sink_get_stats (GstCurlBaseSink * sink);
 
 static void handle_transfer (GstCurlBaseSink * sink);
 static size_t transfer_data_buffer (void *curl_ptr, TransferBuffer * buf,
@@ -235,6 +251,49 @@ gst_curl_base_sink_class_init (GstCurlBaseSinkClass * klass)
           DSCP_MIN, DSCP_MAX, DEFAULT_QOS_DSCP,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCurlBaseSink:max-queue-bytes:
+   *
+   * Maximum amount of data that is queued for the transfer thread, 0 means
+   * no limit. When both this and #GstCurlBaseSink:max-queue-time are 0,
+   * every buffer is sent before the next one is accepted.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_QUEUE_BYTES,
+      g_param_spec_uint64 ("max-queue-bytes", "Max. queue bytes",
+          "Max. amount of data queued for upload (0 = no limit, "
+          "synchronous upload if max-queue-time is 0 too)",
+          0, G_MAXUINT64, DEFAULT_MAX_QUEUE_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCurlBaseSink:max-queue-time:
+   *
+   * Maximum duration of the buffers that are queued for the transfer
+   * thread, 0 means no limit.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_QUEUE_TIME,
+      g_param_spec_uint64 ("max-queue-time", "Max. queue time",
+          "Max. duration of the data queued for upload in ns (0 = no limit, "
+          "synchronous upload if max-queue-bytes is 0 too)",
+          0, G_MAXUINT64, DEFAULT_MAX_QUEUE_TIME,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCurlBaseSink:stats:
+   *
+   * Queue level and throughput of the upload.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Queue level and throughput of the upload",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&sinktemplate));
 }
@@ -256,6 +315,9 @@ gst_curl_base_sink_init (GstCurlBaseSink * sink)
   sink->error = NULL;
   sink->flow_ret = GST_FLOW_OK;
   sink->is_live = FALSE;
+  g_queue_init (&sink->queue);
+  sink->max_queue_bytes = DEFAULT_MAX_QUEUE_BYTES;
+  sink->max_queue_time = DEFAULT_MAX_QUEUE_TIME;
 }
 
 static void
@@ -268,6 +330,7 @@ gst_curl_base_sink_finalize (GObject * gobject)
     g_thread_join (this->transfer_thread);
   }
 
+  gst_curl_base_sink_queue_flush_unlocked (this);
   gst_curl_base_sink_transfer_cleanup (this);
   g_cond_clear (&this->transfer_cond->cond);
   g_free (this->transfer_cond);
@@ -292,7 +355,7 @@ gst_curl_base_sink_transfer_thread_notify_unlocked (GstCurlBaseSink * sink)
   sink->transfer_cond->data_available = TRUE;
   sink->transfer_cond->data_sent = FALSE;
   sink->transfer_cond->wait_for_response = TRUE;
-  g_cond_signal (&sink->transfer_cond->cond);
+  g_cond_broadcast (&sink->transfer_cond->cond);
 }
 
 void
@@ -335,13 +398,114 @@ gst_curl_base_sink_is_live (GstCurlBaseSink * sink)
   return result;
 }
 
+/* Subclasses that send data from transfer_buf themselves do not know about
+ * the queue and always get one buffer at a time */
+static gboolean
+gst_curl_base_sink_is_queueing_unlocked (GstCurlBaseSink * sink)
+{
+  GstCurlBaseSinkClass *klass = GST_CURL_BASE_SINK_GET_CLASS (sink);
+
+  return (sink->max_queue_bytes > 0 || sink->max_queue_time > 0) &&
+      klass->transfer_data_buffer == gst_curl_base_sink_transfer_data_buffer;
+}
+
+/* Whether render has to wait before queueing another buffer */
+static gboolean
+gst_curl_base_sink_queue_is_full_unlocked (GstCurlBaseSink * sink)
+{
+  if (sink->transfer_buffer == NULL && g_queue_is_empty (&sink->queue))
+    return FALSE;
+
+  if (!gst_curl_base_sink_is_queueing_unlocked (sink))
+    return TRUE;
+
+  return (sink->max_queue_bytes > 0 &&
+      sink->queued_bytes >= sink->max_queue_bytes) ||
+      (sink->max_queue_time > 0 && sink->queued_time >= sink->max_queue_time);
+}
+
+/* Maps the next queued buffer into transfer_buf and wakes up the transfer
+ * thread */
+static void
+gst_curl_base_sink_queue_pop_unlocked (GstCurlBaseSink * sink)
+{
+  GstBuffer *buf;
+
+  g_assert (sink->transfer_buffer == NULL);
+
+  buf = g_queue_pop_head (&sink->queue);
+  gst_buffer_map (buf, &sink->transfer_map, GST_MAP_READ);
+  sink->transfer_buffer = buf;
+
+  sink->transfer_buf->ptr = sink->transfer_map.data;
+  sink->transfer_buf->len = sink->transfer_map.size;
+  sink->transfer_buf->offset = 0;
+
+  if (sink->first_send_time == 0)
+    sink->first_send_time = g_get_monotonic_time ();
+
+  gst_curl_base_sink_transfer_thread_notify_unlocked (sink);
+}
+
+/* Releases the buffer that has just been sent */
+static void
+gst_curl_base_sink_queue_release_unlocked (GstCurlBaseSink * sink,
+    gboolean sent)
+{
+  GstBuffer *buf = sink->transfer_buffer;
+  GstClockTime duration = GST_BUFFER_DURATION (buf);
+
+  gst_buffer_unmap (buf, &sink->transfer_map);
+  sink->transfer_buffer = NULL;
+
+  sink->queued_bytes -= sink->transfer_map.size;
+  if (GST_CLOCK_TIME_IS_VALID (duration))
+    sink->queued_time -= duration;
+
+  if (sent) {
+    sink->bytes_sent += sink->transfer_map.size;
+    sink->buffers_sent++;
+    sink->last_send_time = g_get_monotonic_time ();
+  }
+
+  gst_buffer_unref (buf);
+}
+
+/* Drops the buffers that have not been handed to the transfer thread yet.
+ * The one in transfer_buf is read by libcurl without the lock and is left
+ * for the transfer thread to finish and release. */
+static void
+gst_curl_base_sink_queue_drop_unlocked (GstCurlBaseSink * sink)
+{
+  GstClockTime duration;
+  GstBuffer *buf;
+
+  while ((buf = g_queue_pop_head (&sink->queue)) != NULL) {
+    sink->queued_bytes -= gst_buffer_get_size (buf);
+    duration = GST_BUFFER_DURATION (buf);
+    if (GST_CLOCK_TIME_IS_VALID (duration))
+      sink->queued_time -= duration;
+    gst_buffer_unref (buf);
+  }
+}
+
+static void
+gst_curl_base_sink_queue_flush_unlocked (GstCurlBaseSink * sink)
+{
+  if (sink->transfer_buffer != NULL)
+    gst_curl_base_sink_queue_release_unlocked (sink, FALSE);
+
+  gst_curl_base_sink_queue_drop_unlocked (sink);
+
+  sink->queued_bytes = 0;
+  sink->queued_time = 0;
+}
+
 static GstFlowReturn
 gst_curl_base_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 {
   GstCurlBaseSink *sink;
-  GstMapInfo map;
-  guint8 *data;
-  size_t size;
+  GstClockTime duration;
   GstFlowReturn ret;
   gchar *error;
 
@@ -351,18 +515,12 @@ gst_curl_base_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 
   GST_OBJECT_LOCK (sink);
 
-  gst_buffer_map (buf, &map, GST_MAP_READ);
-  data = map.data;
-  size = map.size;
-
   /* check if the transfer thread has encountered problems while the
    * pipeline thread was working elsewhere */
   if (sink->flow_ret != GST_FLOW_OK) {
     goto done;
   }
 
-  g_assert (sink->transfer_cond->data_available == FALSE);
-
   /* if there is no transfer thread created, lets create one */
   if (sink->transfer_thread == NULL) {
     if (!gst_curl_base_sink_transfer_start_unlocked (sink)) {
@@ -371,20 +529,43 @@ gst_curl_base_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     }
   }
 
-  /* make data available for the transfer thread and notify */
-  sink->transfer_buf->ptr = data;
-  sink->transfer_buf->len = size;
-  sink->transfer_buf->offset = 0;
-  gst_curl_base_sink_transfer_thread_notify_unlocked (sink);
+  /* wait for the transfer thread to make room in the queue. It notifies
+   * whenever a buffer has been sent or if an error has occurred. */
+  while (gst_curl_base_sink_queue_is_full_unlocked (sink) &&
+      sink->flow_ret == GST_FLOW_OK && !sink->flushing) {
+    GST_LOG ("queue full, %" G_GUINT64_FORMAT " bytes", sink->queued_bytes);
+    g_cond_wait (&sink->transfer_cond->cond, GST_OBJECT_GET_LOCK (sink));
+  }
 
-  /* wait for the transfer thread to send the data. This will be notified
-   * either when transfer is completed by the curl read callback or by
-   * the thread function if an error has occurred. */
-  gst_curl_base_sink_wait_for_transfer_thread_to_send_unlocked (sink);
+  if (sink->flushing) {
+    GST_OBJECT_UNLOCK (sink);
+    GST_LOG ("flushing");
+    return GST_FLOW_FLUSHING;
+  }
 
-done:
-  gst_buffer_unmap (buf, &map);
+  if (sink->flow_ret != GST_FLOW_OK) {
+    goto done;
+  }
 
+  g_queue_push_tail (&sink->queue, gst_buffer_ref (buf));
+  sink->queued_bytes += gst_buffer_get_size (buf);
+  duration = GST_BUFFER_DURATION (buf);
+  if (GST_CLOCK_TIME_IS_VALID (duration))
+    sink->queued_time += duration;
+  sink->max_queued_bytes = MAX (sink->max_queued_bytes, sink->queued_bytes);
+
+  /* make data available for the transfer thread and notify, if it is still
+   * busy with an earlier buffer it picks this one up when done with that */
+  if (!sink->transfer_cond->data_available)
+    gst_curl_base_sink_queue_pop_unlocked (sink);
+
+  /* without a queue, wait for the transfer thread to send the data. This
+   * will be notified either when transfer is completed by the curl read
+   * callback or by the thread function if an error has occurred. */
+  if (!gst_curl_base_sink_is_queueing_unlocked (sink))
+    gst_curl_base_sink_wait_for_transfer_thread_to_send_unlocked (sink);
+
+done:
   /* Hand over error from transfer thread to streaming thread */
   error = sink->error;
   sink->error = NULL;
@@ -407,10 +588,25 @@ gst_curl_base_sink_event (GstBaseSink * bsink, GstEvent * event)
 {
   GstCurlBaseSink *sink = GST_CURL_BASE_SINK (bsink);
   GstCurlBaseSinkClass *klass = GST_CURL_BASE_SINK_GET_CLASS (sink);
+  gchar *error;
 
   switch (event->type) {
     case GST_EVENT_EOS:
       GST_DEBUG_OBJECT (sink, "received EOS");
+
+      /* send everything that is still queued before closing the transfer */
+      GST_OBJECT_LOCK (sink);
+      gst_curl_base_sink_wait_for_queue_drained_unlocked (sink);
+      error = sink->error;
+      sink->error = NULL;
+      GST_OBJECT_UNLOCK (sink);
+
+      if (error != NULL) {
+        GST_ERROR_OBJECT (sink, "%s", error);
+        GST_ELEMENT_ERROR (sink, RESOURCE, WRITE, ("%s", error), (NULL));
+        g_free (error);
+      }
+
       gst_curl_base_sink_transfer_thread_close (sink);
       gst_curl_base_sink_wait_for_response (sink);
       break;
@@ -442,6 +638,12 @@ gst_curl_base_sink_start (GstBaseSink * bsink)
   sink->transfer_thread_close = FALSE;
   sink->new_file = TRUE;
   sink->flow_ret = GST_FLOW_OK;
+  sink->flushing = FALSE;
+  sink->max_queued_bytes = 0;
+  sink->bytes_sent = 0;
+  sink->buffers_sent = 0;
+  sink->first_send_time = 0;
+  sink->last_send_time = 0;
 
   if ((sink->fdset = gst_poll_new (TRUE)) == NULL) {
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_READ_WRITE,
@@ -460,6 +662,11 @@ gst_curl_base_sink_stop (GstBaseSink * bsink)
   GstCurlBaseSink *sink = GST_CURL_BASE_SINK (bsink);
 
   gst_curl_base_sink_transfer_thread_close (sink);
+
+  GST_OBJECT_LOCK (sink);
+  gst_curl_base_sink_queue_flush_unlocked (sink);
+  GST_OBJECT_UNLOCK (sink);
+
   if (sink->fdset != NULL) {
     gst_poll_free (sink->fdset);
     sink->fdset = NULL;
@@ -478,6 +685,13 @@ gst_curl_base_sink_unlock (GstBaseSink * bsink)
   GST_LOG_OBJECT (sink, "Flushing");
   gst_poll_set_flushing (sink->fdset, TRUE);
 
+  GST_OBJECT_LOCK (sink);
+  sink->flushing = TRUE;
+  /* nothing queued before the flush may be sent after it */
+  gst_curl_base_sink_queue_drop_unlocked (sink);
+  g_cond_broadcast (&sink->transfer_cond->cond);
+  GST_OBJECT_UNLOCK (sink);
+
   return TRUE;
 }
 
@@ -491,6 +705,10 @@ gst_curl_base_sink_unlock_stop (GstBaseSink * bsink)
   GST_LOG_OBJECT (sink, "No longer flushing");
   gst_poll_set_flushing (sink->fdset, FALSE);
 
+  GST_OBJECT_LOCK (sink);
+  sink->flushing = FALSE;
+  GST_OBJECT_UNLOCK (sink);
+
   return TRUE;
 }
 
@@ -538,6 +756,16 @@ gst_curl_base_sink_set_property (GObject * object, guint prop_id,
         gst_curl_base_sink_setup_dscp_unlocked (sink);
         GST_DEBUG_OBJECT (sink, "dscp set to %d", sink->qos_dscp);
         break;
+      case PROP_MAX_QUEUE_BYTES:
+        sink->max_queue_bytes = g_value_get_uint64 (value);
+        GST_DEBUG_OBJECT (sink, "max_queue_bytes set to %" G_GUINT64_FORMAT,
+            sink->max_queue_bytes);
+        break;
+      case PROP_MAX_QUEUE_TIME:
+        sink->max_queue_time = g_value_get_uint64 (value);
+        GST_DEBUG_OBJECT (sink, "max_queue_time set to %" GST_TIME_FORMAT,
+            GST_TIME_ARGS (sink->max_queue_time));
+        break;
       default:
         GST_DEBUG_OBJECT (sink, "invalid property id %d", prop_id);
         break;
@@ -553,6 +781,8 @@ gst_curl_base_sink_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_FILE_NAME:
+      /* the queued data still belongs to the previous file */
+      gst_curl_base_sink_wait_for_queue_drained_unlocked (sink);
       g_free (sink->file_name);
       sink->file_name = g_value_dup_string (value);
       GST_DEBUG_OBJECT (sink, "file_name set to %s", sink->file_name);
@@ -567,6 +797,18 @@ gst_curl_base_sink_set_property (GObject * object, guint prop_id,
       gst_curl_base_sink_setup_dscp_unlocked (sink);
       GST_DEBUG_OBJECT (sink, "dscp set to %d", sink->qos_dscp);
       break;
+    case PROP_MAX_QUEUE_BYTES:
+      sink->max_queue_bytes = g_value_get_uint64 (value);
+      GST_DEBUG_OBJECT (sink, "max_queue_bytes set to %" G_GUINT64_FORMAT,
+          sink->max_queue_bytes);
+      g_cond_broadcast (&sink->transfer_cond->cond);
+      break;
+    case PROP_MAX_QUEUE_TIME:
+      sink->max_queue_time = g_value_get_uint64 (value);
+      GST_DEBUG_OBJECT (sink, "max_queue_time set to %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (sink->max_queue_time));
+      g_cond_broadcast (&sink->transfer_cond->cond);
+      break;
     default:
       GST_WARNING_OBJECT (sink, "cannot set property when PLAYING");
       break;
@@ -603,6 +845,15 @@ gst_curl_base_sink_get_property (GObject * object, guint prop_id,
     case PROP_QOS_DSCP:
       g_value_set_int (value, sink->qos_dscp);
       break;
+    case PROP_MAX_QUEUE_BYTES:
+      g_value_set_uint64 (value, sink->max_queue_bytes);
+      break;
+    case PROP_MAX_QUEUE_TIME:
+      g_value_set_uint64 (value, sink->max_queue_time);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_curl_base_sink_get_stats (sink));
+      break;
     default:
       GST_DEBUG_OBJECT (sink, "invalid property id");
       break;
@@ -1315,12 +1566,62 @@ gst_curl_base_sink_data_sent_notify (GstCurlBaseSink * sink)
 {
   GST_LOG ("transfer completed");
   GST_OBJECT_LOCK (sink);
-  sink->transfer_cond->data_available = FALSE;
-  sink->transfer_cond->data_sent = TRUE;
-  g_cond_signal (&sink->transfer_cond->cond);
+  if (sink->flow_ret != GST_FLOW_OK) {
+    /* nothing more will be sent */
+    gst_curl_base_sink_queue_flush_unlocked (sink);
+  } else if (sink->transfer_buffer != NULL) {
+    gst_curl_base_sink_queue_release_unlocked (sink, TRUE);
+  }
+
+  if (!g_queue_is_empty (&sink->queue)) {
+    gst_curl_base_sink_queue_pop_unlocked (sink);
+  } else {
+    sink->transfer_cond->data_available = FALSE;
+    sink->transfer_cond->data_sent = TRUE;
+    g_cond_broadcast (&sink->transfer_cond->cond);
+  }
   GST_OBJECT_UNLOCK (sink);
 }
 
+static void
+gst_curl_base_sink_wait_for_queue_drained_unlocked (GstCurlBaseSink * sink)
+{
+  GST_LOG ("waiting for %" G_GUINT64_FORMAT " queued bytes to be sent",
+      sink->queued_bytes);
+
+  /* the transfer thread maps the next buffer as soon as one is sent */
+  while (sink->transfer_buffer != NULL && sink->transfer_thread != NULL &&
+      sink->flow_ret == GST_FLOW_OK && !sink->flushing) {
+    g_cond_wait (&sink->transfer_cond->cond, GST_OBJECT_GET_LOCK (sink));
+  }
+  GST_LOG ("queue drained");
+}
+
+static GstStructure *
+gst_curl_base_sink_get_stats (GstCurlBaseSink * sink)
+{
+  GstStructure *s;
+  guint64 throughput = 0;
+
+  GST_OBJECT_LOCK (sink);
+  if (sink->last_send_time > sink->first_send_time)
+    throughput = gst_util_uint64_scale (sink->bytes_sent, G_USEC_PER_SEC,
+        sink->last_send_time - sink->first_send_time);
+
+  s = gst_structure_new ("application/x-curl-sink-stats",
+      "queued-buffers", G_TYPE_UINT, g_queue_get_length (&sink->queue) +
+      (sink->transfer_buffer != NULL),
+      "queued-bytes", G_TYPE_UINT64, sink->queued_bytes,
+      "queued-time", G_TYPE_UINT64, sink->queued_time,
+      "max-queued-bytes", G_TYPE_UINT64, sink->max_queued_bytes,
+      "buffers-sent", G_TYPE_UINT64, sink->buffers_sent,
+      "bytes-sent", G_TYPE_UINT64, sink->bytes_sent,
+      "throughput", G_TYPE_UINT64, throughput, NULL);
+  GST_OBJECT_UNLOCK (sink);
+
+  return s;
+}
+
 static void
 gst_curl_base_sink_wait_for_response (GstCurlBaseSink * sink)
 {
@@ -83,6 +83,24 @@ struct _GstCurlBaseSink
   gboolean transfer_thread_close;
   gboolean new_file;
   gboolean is_live;
+
+  /* buffers accepted by render but not completely sent yet, the head is
+   * mapped into transfer_buf while it is being sent */
+  GQueue queue;
+  GstBuffer *transfer_buffer;
+  GstMapInfo transfer_map;
+  guint64 max_queue_bytes;
+  GstClockTime max_queue_time;
+  guint64 queued_bytes;
+  GstClockTime queued_time;
+  gboolean flushing;
+
+  /* statistics */
+  guint64 max_queued_bytes;
+  guint64 bytes_sent;
+  guint64 buffers_sent;
+  gint64 first_send_time;
+  gint64 last_send_time;
 };
 
 struct _GstCurlBaseSinkClass
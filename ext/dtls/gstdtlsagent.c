@@ -38,6 +38,9 @@
 
 #include <openssl/err.h>
 #include <openssl/ssl.h>
+#ifndef OPENSSL_NO_EC
+#include <openssl/ec.h>
+#endif
 
 GST_DEBUG_CATEGORY_STATIC (gst_dtls_agent_debug);
 #define GST_CAT_DEFAULT gst_dtls_agent_debug
@@ -189,6 +192,16 @@ gst_dtls_agent_init (GstDtlsAgent * self)
   SSL_CTX_set_read_ahead (priv->ssl_context, 1);
 #if OPENSSL_VERSION_NUMBER >= 0x1000200fL
   SSL_CTX_set_ecdh_auto (priv->ssl_context, 1);
+#elif !defined(OPENSSL_NO_EC)
+  {
+    /* needed for ECDHE, and so for certificates with ECDSA keys */
+    EC_KEY *ecdh = EC_KEY_new_by_curve_name (NID_X9_62_prime256v1);
+
+    if (ecdh) {
+      SSL_CTX_set_tmp_ecdh (priv->ssl_context, ecdh);
+      EC_KEY_free (ecdh);
+    }
+  }
 #endif
 }
 
@@ -266,6 +279,16 @@ gst_dtls_agent_get_certificate_pem (GstDtlsAgent * self)
   return pem;
 }
 
+gchar *
+gst_dtls_agent_export_certificate_pem (GstDtlsAgent * self)
+{
+  g_return_val_if_fail (GST_IS_DTLS_AGENT (self), NULL);
+  g_return_val_if_fail (GST_IS_DTLS_CERTIFICATE (self->priv->certificate),
+      NULL);
+
+  return gst_dtls_certificate_export_pem (self->priv->certificate);
+}
+
 const GstDtlsAgentContext
 _gst_dtls_agent_peek_context (GstDtlsAgent * self)
 {
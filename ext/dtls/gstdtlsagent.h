@@ -73,6 +73,12 @@ GstDtlsCertificate *gst_dtls_agent_get_certificate(GstDtlsAgent *);
  */
 gchar *gst_dtls_agent_get_certificate_pem(GstDtlsAgent *self);
 
+/*
+ * Returns the certificate used by the agent together with its unencrypted private key,
+ * see gst_dtls_certificate_export_pem().
+ */
+gchar *gst_dtls_agent_export_certificate_pem(GstDtlsAgent *self);
+
 /* internal */
 void _gst_dtls_init_openssl(void);
 const GstDtlsAgentContext _gst_dtls_agent_peek_context(GstDtlsAgent *);
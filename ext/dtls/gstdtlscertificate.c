@@ -39,6 +39,9 @@
 #endif
 
 #include <openssl/ssl.h>
+#ifndef OPENSSL_NO_EC
+#include <openssl/ec.h>
+#endif
 
 GST_DEBUG_CATEGORY_STATIC (gst_dtls_certificate_debug);
 #define GST_CAT_DEFAULT gst_dtls_certificate_debug
@@ -53,12 +56,14 @@ enum
 {
   PROP_0,
   PROP_PEM,
+  PROP_KEY_TYPE,
   NUM_PROPERTIES
 };
 
 static GParamSpec *properties[NUM_PROPERTIES];
 
 #define DEFAULT_PEM NULL
+#define DEFAULT_KEY_TYPE GST_DTLS_KEY_TYPE_RSA
 
 struct _GstDtlsCertificatePrivate
 {
@@ -66,8 +71,36 @@ struct _GstDtlsCertificatePrivate
   EVP_PKEY *private_key;
 
   gchar *pem;
+  GstDtlsKeyType key_type;
+  gint64 generation_time;
 };
 
+/* Certificates generated ahead of time, per key type */
+static GMutex generated_lock;
+static GCond generated_cond;
+static GQueue generated_certificates[GST_DTLS_N_KEY_TYPES];
+static guint generated_pending[GST_DTLS_N_KEY_TYPES];
+static GThreadPool *generator_pool;
+
+GType
+gst_dtls_key_type_get_type (void)
+{
+  static gsize id = 0;
+  static const GEnumValue values[] = {
+    {GST_DTLS_KEY_TYPE_RSA, "2048 bit RSA", "rsa"},
+    {GST_DTLS_KEY_TYPE_ECDSA, "ECDSA P-256", "ecdsa"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&id)) {
+    GType tmp = g_enum_register_static ("GstDtlsKeyType", values);
+    g_once_init_leave (&id, tmp);
+  }
+
+  return (GType) id;
+}
+
+static void gst_dtls_certificate_constructed (GObject * gobject);
 static void gst_dtls_certificate_finalize (GObject * gobject);
 static void gst_dtls_certificate_set_property (GObject *, guint prop_id,
     const GValue *, GParamSpec *);
@@ -75,6 +108,7 @@ static void gst_dtls_certificate_get_property (GObject *, guint prop_id,
     GValue *, GParamSpec *);
 
 static void init_generated (GstDtlsCertificate *);
+static gchar *x509_and_key_to_pem (X509 * x509, EVP_PKEY * private_key);
 static void init_from_pem_string (GstDtlsCertificate *, const gchar * pem);
 
 static void
@@ -90,14 +124,22 @@ gst_dtls_certificate_class_init (GstDtlsCertificateClass * klass)
   properties[PROP_PEM] =
       g_param_spec_string ("pem",
       "Pem string",
-      "A string containing a X509 certificate and RSA private key in PEM format",
+      "A string containing a X509 certificate and private key in PEM format",
       DEFAULT_PEM,
       G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_KEY_TYPE] =
+      g_param_spec_enum ("key-type",
+      "Key type",
+      "The type of key to generate if no PEM string is set",
+      GST_TYPE_DTLS_KEY_TYPE, DEFAULT_KEY_TYPE,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   _gst_dtls_init_openssl ();
 
+  gobject_class->constructed = gst_dtls_certificate_constructed;
   gobject_class->finalize = gst_dtls_certificate_finalize;
 }
 
@@ -110,6 +152,35 @@ gst_dtls_certificate_init (GstDtlsCertificate * self)
   priv->x509 = NULL;
   priv->private_key = NULL;
   priv->pem = NULL;
+  priv->key_type = DEFAULT_KEY_TYPE;
+  priv->generation_time = 0;
+}
+
+static void
+gst_dtls_certificate_constructed (GObject * gobject)
+{
+  GstDtlsCertificate *self = GST_DTLS_CERTIFICATE (gobject);
+  gchar *pem;
+
+  /* the private key is only initialized once all construct properties are
+   * known */
+  pem = self->priv->pem;
+  self->priv->pem = NULL;
+
+  if (pem) {
+    init_from_pem_string (self, pem);
+    g_free (pem);
+  } else {
+    gint64 start = g_get_monotonic_time ();
+
+    init_generated (self);
+    self->priv->generation_time = g_get_monotonic_time () - start;
+
+    GST_DEBUG_OBJECT (self, "generated certificate in %" G_GINT64_FORMAT
+        " us", self->priv->generation_time);
+  }
+
+  G_OBJECT_CLASS (gst_dtls_certificate_parent_class)->constructed (gobject);
 }
 
 static void
@@ -135,16 +206,14 @@ gst_dtls_certificate_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
   GstDtlsCertificate *self = GST_DTLS_CERTIFICATE (object);
-  const gchar *pem;
 
   switch (prop_id) {
     case PROP_PEM:
-      pem = g_value_get_string (value);
-      if (pem) {
-        init_from_pem_string (self, pem);
-      } else {
-        init_generated (self);
-      }
+      g_free (self->priv->pem);
+      self->priv->pem = g_value_dup_string (value);
+      break;
+    case PROP_KEY_TYPE:
+      self->priv->key_type = g_value_get_enum (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
@@ -162,16 +231,75 @@ gst_dtls_certificate_get_property (GObject * object, guint prop_id,
       g_return_if_fail (self->priv->pem);
       g_value_set_string (value, self->priv->pem);
       break;
+    case PROP_KEY_TYPE:
+      g_value_set_enum (value, self->priv->key_type);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
 }
 
+static gboolean
+generate_rsa_key (GstDtlsCertificate * self, EVP_PKEY * private_key)
+{
+  RSA *rsa;
+
+  rsa = RSA_generate_key (2048, RSA_F4, NULL, NULL);
+
+  if (!rsa) {
+    GST_WARNING_OBJECT (self, "failed to generate RSA");
+    return FALSE;
+  }
+
+  if (!EVP_PKEY_assign_RSA (private_key, rsa)) {
+    GST_WARNING_OBJECT (self, "failed to assign RSA");
+    RSA_free (rsa);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+generate_ecdsa_key (GstDtlsCertificate * self, EVP_PKEY * private_key)
+{
+#ifndef OPENSSL_NO_EC
+  EC_KEY *ec_key;
+
+  ec_key = EC_KEY_new_by_curve_name (NID_X9_62_prime256v1);
+
+  if (!ec_key) {
+    GST_WARNING_OBJECT (self, "failed to create EC key");
+    return FALSE;
+  }
+
+  /* only name the curve in the certificate, like browsers do */
+  EC_KEY_set_asn1_flag (ec_key, OPENSSL_EC_NAMED_CURVE);
+
+  if (!EC_KEY_generate_key (ec_key)) {
+    GST_WARNING_OBJECT (self, "failed to generate EC key");
+    EC_KEY_free (ec_key);
+    return FALSE;
+  }
+
+  if (!EVP_PKEY_assign_EC_KEY (private_key, ec_key)) {
+    GST_WARNING_OBJECT (self, "failed to assign EC key");
+    EC_KEY_free (ec_key);
+    return FALSE;
+  }
+
+  return TRUE;
+#else
+  GST_WARNING_OBJECT (self, "OpenSSL was built without EC support");
+  return FALSE;
+#endif
+}
+
 static void
 init_generated (GstDtlsCertificate * self)
 {
   GstDtlsCertificatePrivate *priv = self->priv;
-  RSA *rsa;
+  gboolean generated;
   X509_NAME *name = NULL;
 
   g_return_if_fail (!priv->x509);
@@ -192,28 +320,19 @@ init_generated (GstDtlsCertificate * self)
     priv->private_key = NULL;
     return;
   }
-  rsa = RSA_generate_key (2048, RSA_F4, NULL, NULL);
 
-  if (!rsa) {
-    GST_WARNING_OBJECT (self, "failed to generate RSA");
-    EVP_PKEY_free (priv->private_key);
-    priv->private_key = NULL;
-    X509_free (priv->x509);
-    priv->x509 = NULL;
-    return;
-  }
+  if (priv->key_type == GST_DTLS_KEY_TYPE_ECDSA)
+    generated = generate_ecdsa_key (self, priv->private_key);
+  else
+    generated = generate_rsa_key (self, priv->private_key);
 
-  if (!EVP_PKEY_assign_RSA (priv->private_key, rsa)) {
-    GST_WARNING_OBJECT (self, "failed to assign RSA");
-    RSA_free (rsa);
-    rsa = NULL;
+  if (!generated) {
     EVP_PKEY_free (priv->private_key);
     priv->private_key = NULL;
     X509_free (priv->x509);
     priv->x509 = NULL;
     return;
   }
-  rsa = NULL;
 
   X509_set_version (priv->x509, 2);
   ASN1_INTEGER_set (X509_get_serialNumber (priv->x509), 0);
@@ -309,6 +428,120 @@ beach:
   return pem;
 }
 
+/* The private key is appended to the certificate, the result can be used
+ * as the "pem" property again */
+static gchar *
+x509_and_key_to_pem (X509 * x509, EVP_PKEY * private_key)
+{
+  BIO *bio;
+  gchar *data;
+  glong len;
+  gchar *pem = NULL;
+
+  bio = BIO_new (BIO_s_mem ());
+  g_return_val_if_fail (bio, NULL);
+
+  if (!PEM_write_bio_X509 (bio, x509) ||
+      !PEM_write_bio_PrivateKey (bio, private_key, NULL, NULL, 0, NULL, NULL)) {
+    g_warn_if_reached ();
+    goto beach;
+  }
+
+  len = BIO_get_mem_data (bio, &data);
+  if (len <= 0) {
+    g_warn_if_reached ();
+    goto beach;
+  }
+
+  pem = g_strndup (data, len);
+
+beach:
+  BIO_free (bio);
+
+  return pem;
+}
+
+static void
+generate_in_background (gpointer data, gpointer user_data)
+{
+  GstDtlsKeyType key_type = GPOINTER_TO_INT (data) - 1;
+  GstDtlsCertificate *certificate;
+
+  certificate = g_object_new (GST_TYPE_DTLS_CERTIFICATE, "key-type", key_type,
+      NULL);
+
+  g_mutex_lock (&generated_lock);
+  generated_pending[key_type]--;
+  g_queue_push_tail (&generated_certificates[key_type], certificate);
+  g_cond_broadcast (&generated_cond);
+  g_mutex_unlock (&generated_lock);
+}
+
+void
+gst_dtls_certificate_prepare_generated (GstDtlsKeyType key_type)
+{
+  g_return_if_fail (key_type < GST_DTLS_N_KEY_TYPES);
+
+  _gst_dtls_init_openssl ();
+
+  g_mutex_lock (&generated_lock);
+  if (!generated_certificates[key_type].length && !generated_pending[key_type]) {
+    /* one thread is enough, this happens rarely and should not compete
+     * with streaming threads */
+    if (!generator_pool)
+      generator_pool =
+          g_thread_pool_new (generate_in_background, NULL, 1, FALSE, NULL);
+
+    GST_DEBUG ("generating a certificate with key type %d in the background",
+        key_type);
+    generated_pending[key_type]++;
+    g_thread_pool_push (generator_pool, GINT_TO_POINTER (key_type + 1), NULL);
+  }
+  g_mutex_unlock (&generated_lock);
+}
+
+GstDtlsCertificate *
+gst_dtls_certificate_new_generated (GstDtlsKeyType key_type)
+{
+  GstDtlsCertificate *certificate;
+
+  g_return_val_if_fail (key_type < GST_DTLS_N_KEY_TYPES, NULL);
+
+  g_mutex_lock (&generated_lock);
+  /* a certificate that is being generated is ready sooner than a new one */
+  while (!generated_certificates[key_type].length &&
+      generated_pending[key_type])
+    g_cond_wait (&generated_cond, &generated_lock);
+  certificate = g_queue_pop_head (&generated_certificates[key_type]);
+  g_mutex_unlock (&generated_lock);
+
+  if (!certificate) {
+    GST_DEBUG ("no prepared certificate with key type %d, generating now",
+        key_type);
+    certificate = g_object_new (GST_TYPE_DTLS_CERTIFICATE, "key-type",
+        key_type, NULL);
+  }
+
+  return certificate;
+}
+
+gchar *
+gst_dtls_certificate_export_pem (GstDtlsCertificate * self)
+{
+  g_return_val_if_fail (GST_IS_DTLS_CERTIFICATE (self), NULL);
+  g_return_val_if_fail (self->priv->x509, NULL);
+  g_return_val_if_fail (self->priv->private_key, NULL);
+
+  return x509_and_key_to_pem (self->priv->x509, self->priv->private_key);
+}
+
+gint64
+gst_dtls_certificate_get_generation_time (GstDtlsCertificate * self)
+{
+  g_return_val_if_fail (GST_IS_DTLS_CERTIFICATE (self), 0);
+  return self->priv->generation_time;
+}
+
 GstDtlsCertificateInternalCertificate
 _gst_dtls_certificate_get_internal_certificate (GstDtlsCertificate * self)
 {
@@ -37,6 +37,24 @@ G_BEGIN_DECLS
 #define GST_IS_DTLS_CERTIFICATE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_DTLS_CERTIFICATE))
 #define GST_DTLS_CERTIFICATE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), GST_TYPE_DTLS_CERTIFICATE, GstDtlsCertificateClass))
 
+/*
+ * GstDtlsKeyType:
+ * @GST_DTLS_KEY_TYPE_RSA: 2048 bit RSA
+ * @GST_DTLS_KEY_TYPE_ECDSA: ECDSA on the P-256 curve, much faster to
+ *   generate than RSA
+ *
+ * The type of key of a generated certificate.
+ */
+typedef enum {
+    GST_DTLS_KEY_TYPE_RSA,
+    GST_DTLS_KEY_TYPE_ECDSA
+} GstDtlsKeyType;
+
+#define GST_DTLS_N_KEY_TYPES (GST_DTLS_KEY_TYPE_ECDSA + 1)
+
+#define GST_TYPE_DTLS_KEY_TYPE (gst_dtls_key_type_get_type())
+GType gst_dtls_key_type_get_type(void);
+
 typedef gpointer GstDtlsCertificateInternalCertificate;
 typedef gpointer GstDtlsCertificateInternalKey;
 
@@ -48,7 +66,9 @@ typedef struct _GstDtlsCertificatePrivate GstDtlsCertificatePrivate;
  * GstDtlsCertificate:
  *
  * Handles a X509 certificate and a private key.
- * If a certificate is created without the "pem" property, a self-signed certificate is generated.
+ * If a certificate is created without the "pem" property, a self-signed certificate is generated
+ * with a key of the type given by the "key-type" property. The "pem" property of a generated
+ * certificate only contains the certificate, see gst_dtls_certificate_export_pem().
  */
 struct _GstDtlsCertificate {
     GObject parent_instance;
@@ -62,6 +82,32 @@ struct _GstDtlsCertificateClass {
 
 GType gst_dtls_certificate_get_type(void) G_GNUC_CONST;
 
+/*
+ * Starts generating a certificate with the given key type in the background, unless one
+ * is already available or being generated.
+ */
+void gst_dtls_certificate_prepare_generated(GstDtlsKeyType);
+
+/*
+ * Returns a generated self-signed certificate with the given key type. It is taken from
+ * the certificates prepared in the background if possible, so this only blocks for the
+ * remaining generation time, if any.
+ */
+GstDtlsCertificate *gst_dtls_certificate_new_generated(GstDtlsKeyType);
+
+/*
+ * Returns the certificate followed by its private key in PEM format. The private key is not
+ * encrypted, so the string must be kept secret. It can be stored and used as the "pem"
+ * property later to skip generating a certificate.
+ */
+gchar *gst_dtls_certificate_export_pem(GstDtlsCertificate *);
+
+/*
+ * Returns the time it took to generate the certificate in microseconds, or 0 if it was
+ * created from a PEM string.
+ */
+gint64 gst_dtls_certificate_get_generation_time(GstDtlsCertificate *);
+
 /* internal */
 GstDtlsCertificateInternalCertificate _gst_dtls_certificate_get_internal_certificate(GstDtlsCertificate *);
 GstDtlsCertificateInternalKey _gst_dtls_certificate_get_internal_key(GstDtlsCertificate *);
@@ -96,6 +96,12 @@ struct _GstDtlsConnectionPrivate
 
   gboolean timeout_pending;
   GThreadPool *thread_pool;
+
+  /* monotonic times of the handshake phases, 0 if not reached yet */
+  gint64 start_time;
+  gint64 peer_certificate_time;
+  gint64 handshake_time;
+  guint retransmissions;
 };
 
 static void gst_dtls_connection_finalize (GObject * gobject);
@@ -189,6 +195,11 @@ gst_dtls_connection_init (GstDtlsConnection * self)
   priv->thread_pool = g_thread_pool_new (handle_timeout, self, 1, FALSE, NULL);
   g_assert (priv->thread_pool);
   priv->timeout_pending = FALSE;
+
+  priv->start_time = 0;
+  priv->peer_certificate_time = 0;
+  priv->handshake_time = 0;
+  priv->retransmissions = 0;
 }
 
 static void
@@ -275,6 +286,11 @@ gst_dtls_connection_start (GstDtlsConnection * self, gboolean is_client)
   priv->bio_buffer_offset = 0;
   priv->keys_exported = FALSE;
 
+  priv->start_time = g_get_monotonic_time ();
+  priv->peer_certificate_time = 0;
+  priv->handshake_time = 0;
+  priv->retransmissions = 0;
+
   priv->is_client = is_client;
   if (priv->is_client) {
     SSL_set_connect_state (priv->ssl);
@@ -311,6 +327,7 @@ handle_timeout (gpointer data, gpointer user_data)
     if (ret < 0) {
       GST_WARNING_OBJECT (self, "handling timeout failed");
     } else if (ret > 0) {
+      priv->retransmissions++;
       log_state (self, "handling timeout before poll");
       openssl_poll (self);
       log_state (self, "handling timeout after poll");
@@ -543,6 +560,35 @@ gst_dtls_connection_send (GstDtlsConnection * self, gpointer data, gint len)
   return ret;
 }
 
+#define PHASE_TIME(priv,t) \
+    ((t) ? ((t) - (priv)->start_time) * GST_USECOND : GST_CLOCK_TIME_NONE)
+
+GstStructure *
+gst_dtls_connection_get_stats (GstDtlsConnection * self)
+{
+  GstDtlsConnectionPrivate *priv;
+  GstStructure *s;
+
+  g_return_val_if_fail (GST_IS_DTLS_CONNECTION (self), NULL);
+
+  priv = self->priv;
+
+  g_mutex_lock (&priv->mutex);
+  s = gst_structure_new ("application/x-dtls-connection-stats",
+      "is-client", G_TYPE_BOOLEAN, priv->is_client,
+      "started", G_TYPE_BOOLEAN, priv->start_time != 0,
+      "peer-certificate-time", G_TYPE_UINT64,
+      (guint64) PHASE_TIME (priv, priv->peer_certificate_time),
+      "handshake-time", G_TYPE_UINT64,
+      (guint64) PHASE_TIME (priv, priv->handshake_time),
+      "retransmissions", G_TYPE_UINT, priv->retransmissions, NULL);
+  g_mutex_unlock (&priv->mutex);
+
+  return s;
+}
+
+#undef PHASE_TIME
+
 /*
      ######   #######  ##    ##
     ##    ## ##     ## ###   ##
@@ -674,8 +720,11 @@ openssl_poll (GstDtlsConnection * self)
 
   if (ret == 1) {
     if (!self->priv->keys_exported) {
+      self->priv->handshake_time = g_get_monotonic_time ();
       GST_INFO_OBJECT (self,
-          "handshake just completed successfully, exporting keys");
+          "handshake just completed successfully after %" G_GINT64_FORMAT
+          " us, exporting keys",
+          self->priv->handshake_time - self->priv->start_time);
       export_srtp_keys (self);
     } else {
       GST_INFO_OBJECT (self, "handshake is completed");
@@ -731,6 +780,9 @@ openssl_verify_callback (int preverify_ok, X509_STORE_CTX * x509_ctx)
   self = SSL_get_ex_data (ssl, connection_ex_index);
   g_return_val_if_fail (GST_IS_DTLS_CONNECTION (self), FALSE);
 
+  if (!self->priv->peer_certificate_time)
+    self->priv->peer_certificate_time = g_get_monotonic_time ();
+
   pem = _gst_dtls_x509_to_pem (x509_ctx->cert);
 
   if (!pem) {
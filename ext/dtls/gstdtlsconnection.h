@@ -26,7 +26,7 @@
 #ifndef gstdtlsconnection_h
 #define gstdtlsconnection_h
 
-#include <glib-object.h>
+#include <gst/gst.h>
 
 G_BEGIN_DECLS
 
@@ -118,6 +118,14 @@ gint gst_dtls_connection_process(GstDtlsConnection *, gpointer ptr, gint len);
  */
 gint gst_dtls_connection_send(GstDtlsConnection *, gpointer ptr, gint len);
 
+/*
+ * Returns the timing of the handshake: "peer-certificate-time" and "handshake-time" are
+ * the time from gst_dtls_connection_start() until the peer certificate was received and
+ * until the handshake completed, or GST_CLOCK_TIME_NONE. "retransmissions" counts the
+ * handshake timeouts that caused a flight to be sent again.
+ */
+GstStructure *gst_dtls_connection_get_stats(GstDtlsConnection *);
+
 G_END_DECLS
 
 #endif /* gstdtlsconnection_h */
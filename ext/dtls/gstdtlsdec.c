@@ -67,6 +67,9 @@ enum
   PROP_DECODER_KEY,
   PROP_SRTP_CIPHER,
   PROP_SRTP_AUTH,
+  PROP_KEY_TYPE,
+  PROP_STATS,
+  PROP_PRIVATE_PEM,
   NUM_PROPERTIES
 };
 
@@ -79,6 +82,7 @@ static GParamSpec *properties[NUM_PROPERTIES];
 #define DEFAULT_DECODER_KEY NULL
 #define DEFAULT_SRTP_CIPHER 0
 #define DEFAULT_SRTP_AUTH 0
+#define DEFAULT_KEY_TYPE GST_DTLS_KEY_TYPE_RSA
 
 
 static void gst_dtls_dec_finalize (GObject *);
@@ -102,7 +106,11 @@ static GstFlowReturn sink_chain (GstPad *, GstObject * parent, GstBuffer *);
 static GstFlowReturn sink_chain_list (GstPad *, GstObject * parent,
     GstBufferList *);
 
-static GstDtlsAgent *get_agent_by_pem (const gchar * pem);
+static GstDtlsAgent *get_agent_by_pem (const gchar * pem,
+    GstDtlsKeyType key_type);
+static void prepare_generated_agent (GstDtlsKeyType key_type);
+static GstDtlsAgent *gst_dtls_dec_get_agent (GstDtlsDec *);
+static GstStructure *gst_dtls_dec_get_stats (GstDtlsDec *);
 static void agent_weak_ref_notify (gchar * pem, GstDtlsAgent *);
 static void create_connection (GstDtlsDec *, gchar * id);
 static void connection_weak_ref_notify (gchar * id, GstDtlsConnection *);
@@ -140,7 +148,7 @@ gst_dtls_dec_class_init (GstDtlsDecClass * klass)
   properties[PROP_PEM] =
       g_param_spec_string ("pem",
       "PEM string",
-      "A string containing a X509 certificate and RSA private key in PEM format",
+      "A string containing a X509 certificate and private key in PEM format",
       DEFAULT_PEM, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
   properties[PROP_PEER_PEM] =
@@ -171,6 +179,29 @@ gst_dtls_dec_class_init (GstDtlsDecClass * klass)
       0, GST_DTLS_SRTP_AUTH_HMAC_SHA1_80, DEFAULT_SRTP_AUTH,
       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_KEY_TYPE] =
+      g_param_spec_enum ("key-type",
+      "Key type",
+      "The type of key of the generated certificate, if no pem is set. "
+      "Must be set before the connection-id, setting it starts generating "
+      "the certificate in the background",
+      GST_TYPE_DTLS_KEY_TYPE, DEFAULT_KEY_TYPE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_STATS] =
+      g_param_spec_boxed ("stats",
+      "Statistics",
+      "Certificate generation and handshake timing",
+      GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_PRIVATE_PEM] =
+      g_param_spec_string ("private-pem",
+      "Private PEM string",
+      "The X509 certificate followed by its unencrypted private key in PEM "
+      "format. It can be stored and set as pem later to skip certificate "
+      "generation, and must be kept secret",
+      DEFAULT_PEM, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   gst_element_class_add_pad_template (element_class,
@@ -187,7 +218,11 @@ gst_dtls_dec_class_init (GstDtlsDecClass * klass)
 static void
 gst_dtls_dec_init (GstDtlsDec * self)
 {
-  self->agent = get_agent_by_pem (NULL);
+  /* the agent is only created when it is needed, a pem or the key type may
+   * still be set until then */
+  self->agent = NULL;
+  self->key_type = DEFAULT_KEY_TYPE;
+
   self->connection_id = NULL;
   self->connection = NULL;
   self->peer_pem = NULL;
@@ -260,18 +295,27 @@ gst_dtls_dec_set_property (GObject * object, guint prop_id,
     case PROP_CONNECTION_ID:
       g_free (self->connection_id);
       self->connection_id = g_value_dup_string (value);
-      g_return_if_fail (self->agent);
+      g_return_if_fail (gst_dtls_dec_get_agent (self));
       create_connection (self, self->connection_id);
       break;
     case PROP_PEM:
       if (self->agent) {
         g_object_unref (self->agent);
       }
-      self->agent = get_agent_by_pem (g_value_get_string (value));
+      self->agent = get_agent_by_pem (g_value_get_string (value),
+          self->key_type);
       if (self->connection_id) {
         create_connection (self, self->connection_id);
       }
       break;
+    case PROP_KEY_TYPE:
+      self->key_type = g_value_get_enum (value);
+      if (self->agent)
+        GST_WARNING_OBJECT (self, "key-type set after the certificate was "
+            "chosen, ignoring it");
+      else
+        prepare_generated_agent (self->key_type);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
@@ -289,7 +333,7 @@ gst_dtls_dec_get_property (GObject * object, guint prop_id, GValue * value,
       break;
     case PROP_PEM:
       g_value_take_string (value,
-          gst_dtls_agent_get_certificate_pem (self->agent));
+          gst_dtls_agent_get_certificate_pem (gst_dtls_dec_get_agent (self)));
       break;
     case PROP_PEER_PEM:
       g_value_set_string (value, self->peer_pem);
@@ -303,6 +347,17 @@ gst_dtls_dec_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_SRTP_AUTH:
       g_value_set_uint (value, self->srtp_auth);
       break;
+    case PROP_KEY_TYPE:
+      g_value_set_enum (value, self->key_type);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_dtls_dec_get_stats (self));
+      break;
+    case PROP_PRIVATE_PEM:
+      g_value_take_string (value,
+          gst_dtls_agent_export_certificate_pem (gst_dtls_dec_get_agent
+              (self)));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
@@ -602,30 +657,48 @@ sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 static GHashTable *agent_table = NULL;
 G_LOCK_DEFINE_STATIC (agent_table);
 
-static GstDtlsAgent *generated_cert_agent = NULL;
+/* one agent with a generated certificate per key type */
+static GstDtlsAgent *generated_cert_agents[GST_DTLS_N_KEY_TYPES];
+G_LOCK_DEFINE_STATIC (generated_cert_agents);
 
 static GstDtlsAgent *
-get_agent_by_pem (const gchar * pem)
+get_agent_by_pem (const gchar * pem, GstDtlsKeyType key_type)
 {
   GstDtlsAgent *agent;
 
   if (!pem) {
-    if (g_once_init_enter (&generated_cert_agent)) {
-      GstDtlsAgent *new_agent;
+    GstDtlsCertificate *certificate;
+    GstDtlsAgent *new_agent;
 
-      new_agent = g_object_new (GST_TYPE_DTLS_AGENT, "certificate",
-          g_object_new (GST_TYPE_DTLS_CERTIFICATE, NULL), NULL);
+    G_LOCK (generated_cert_agents);
+    agent = generated_cert_agents[key_type];
+    if (agent)
+      g_object_ref (agent);
+    G_UNLOCK (generated_cert_agents);
 
-      GST_DEBUG_OBJECT (generated_cert_agent,
-          "no agent with generated cert found, creating new");
-      g_once_init_leave (&generated_cert_agent, new_agent);
-    } else {
-      GST_DEBUG_OBJECT (generated_cert_agent,
-          "using agent with generated cert");
+    if (agent) {
+      GST_DEBUG_OBJECT (agent, "using agent with generated cert");
+      return agent;
     }
 
-    agent = generated_cert_agent;
-    g_object_ref (agent);
+    /* waiting for the certificate must not block other elements, which
+     * only need the lock to look up or prepare their agent */
+    certificate = gst_dtls_certificate_new_generated (key_type);
+    new_agent =
+        g_object_new (GST_TYPE_DTLS_AGENT, "certificate", certificate, NULL);
+    g_object_unref (certificate);
+
+    G_LOCK (generated_cert_agents);
+    if (!generated_cert_agents[key_type]) {
+      generated_cert_agents[key_type] = g_object_ref (new_agent);
+      GST_DEBUG_OBJECT (new_agent,
+          "no agent with generated cert found, created new");
+    }
+    agent = g_object_ref (generated_cert_agents[key_type]);
+    G_UNLOCK (generated_cert_agents);
+
+    /* unless another element was faster */
+    g_object_unref (new_agent);
   } else {
     G_LOCK (agent_table);
 
@@ -659,6 +732,57 @@ get_agent_by_pem (const gchar * pem)
   return agent;
 }
 
+/* Makes sure the certificate of the agent is generated in the background if
+ * that agent does not exist yet */
+static void
+prepare_generated_agent (GstDtlsKeyType key_type)
+{
+  gboolean exists;
+
+  G_LOCK (generated_cert_agents);
+  exists = generated_cert_agents[key_type] != NULL;
+  G_UNLOCK (generated_cert_agents);
+
+  if (!exists)
+    gst_dtls_certificate_prepare_generated (key_type);
+}
+
+static GstDtlsAgent *
+gst_dtls_dec_get_agent (GstDtlsDec * self)
+{
+  if (!self->agent)
+    self->agent = get_agent_by_pem (NULL, self->key_type);
+
+  return self->agent;
+}
+
+static GstStructure *
+gst_dtls_dec_get_stats (GstDtlsDec * self)
+{
+  GstStructure *s;
+  GstDtlsCertificate *certificate = NULL;
+  gint64 generation_time = 0;
+
+  if (self->connection) {
+    s = gst_dtls_connection_get_stats (self->connection);
+    gst_structure_set_name (s, "application/x-dtls-stats");
+  } else {
+    s = gst_structure_new_empty ("application/x-dtls-stats");
+  }
+
+  if (self->agent)
+    certificate = gst_dtls_agent_get_certificate (self->agent);
+  if (certificate) {
+    generation_time = gst_dtls_certificate_get_generation_time (certificate);
+    g_object_unref (certificate);
+  }
+
+  gst_structure_set (s, "certificate-generation-time", G_TYPE_UINT64,
+      (guint64) generation_time * GST_USECOND, NULL);
+
+  return s;
+}
+
 static void
 agent_weak_ref_notify (gchar * pem, GstDtlsAgent * agent)
 {
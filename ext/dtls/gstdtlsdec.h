@@ -55,6 +55,7 @@ struct _GstDtlsDec {
     GMutex src_mutex;
 
     GstDtlsAgent *agent;
+    GstDtlsKeyType key_type;
     GstDtlsConnection *connection;
     GMutex connection_mutex;
     gchar *connection_id;
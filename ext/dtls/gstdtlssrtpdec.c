@@ -30,6 +30,7 @@
 #include "gstdtlssrtpdec.h"
 
 #include "gstdtlsconnection.h"
+#include "gstdtlscertificate.h"
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -69,6 +70,9 @@ enum
   PROP_0,
   PROP_PEM,
   PROP_PEER_PEM,
+  PROP_KEY_TYPE,
+  PROP_STATS,
+  PROP_PRIVATE_PEM,
   NUM_PROPERTIES
 };
 
@@ -76,6 +80,7 @@ static GParamSpec *properties[NUM_PROPERTIES];
 
 #define DEFAULT_PEM NULL
 #define DEFAULT_PEER_PEM NULL
+#define DEFAULT_KEY_TYPE GST_DTLS_KEY_TYPE_RSA
 
 static void gst_dtls_srtp_dec_set_property (GObject *, guint prop_id,
     const GValue *, GParamSpec *);
@@ -122,7 +127,7 @@ gst_dtls_srtp_dec_class_init (GstDtlsSrtpDecClass * klass)
   properties[PROP_PEM] =
       g_param_spec_string ("pem",
       "PEM string",
-      "A string containing a X509 certificate and RSA private key in PEM format",
+      "A string containing a X509 certificate and private key in PEM format",
       DEFAULT_PEM, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
   properties[PROP_PEER_PEM] =
@@ -131,6 +136,29 @@ gst_dtls_srtp_dec_class_init (GstDtlsSrtpDecClass * klass)
       "The X509 certificate received in the DTLS handshake, in PEM format",
       DEFAULT_PEER_PEM, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_KEY_TYPE] =
+      g_param_spec_enum ("key-type",
+      "Key type",
+      "The type of key of the generated certificate, if no pem is set. "
+      "Must be set before the connection-id, setting it starts generating "
+      "the certificate in the background",
+      GST_TYPE_DTLS_KEY_TYPE, DEFAULT_KEY_TYPE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_STATS] =
+      g_param_spec_boxed ("stats",
+      "Statistics",
+      "Certificate generation and handshake timing",
+      GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_PRIVATE_PEM] =
+      g_param_spec_string ("private-pem",
+      "Private PEM string",
+      "The X509 certificate followed by its unencrypted private key in PEM "
+      "format. It can be stored and set as pem later to skip certificate "
+      "generation, and must be kept secret",
+      DEFAULT_PEM, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   gst_element_class_add_pad_template (element_class,
@@ -246,6 +274,14 @@ gst_dtls_srtp_dec_set_property (GObject * object,
         GST_WARNING_OBJECT (self, "tried to set pem after disabling DTLS");
       }
       break;
+    case PROP_KEY_TYPE:
+      if (self->bin.dtls_element) {
+        g_object_set_property (G_OBJECT (self->bin.dtls_element), "key-type",
+            value);
+      } else {
+        GST_WARNING_OBJECT (self, "tried to set key-type after disabling DTLS");
+      }
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
@@ -273,6 +309,31 @@ gst_dtls_srtp_dec_get_property (GObject * object,
         GST_WARNING_OBJECT (self, "tried to get peer-pem after disabling DTLS");
       }
       break;
+    case PROP_KEY_TYPE:
+      if (self->bin.dtls_element) {
+        g_object_get_property (G_OBJECT (self->bin.dtls_element), "key-type",
+            value);
+      } else {
+        GST_WARNING_OBJECT (self, "tried to get key-type after disabling DTLS");
+      }
+      break;
+    case PROP_STATS:
+      if (self->bin.dtls_element) {
+        g_object_get_property (G_OBJECT (self->bin.dtls_element), "stats",
+            value);
+      } else {
+        GST_WARNING_OBJECT (self, "tried to get stats after disabling DTLS");
+      }
+      break;
+    case PROP_PRIVATE_PEM:
+      if (self->bin.dtls_element) {
+        g_object_get_property (G_OBJECT (self->bin.dtls_element),
+            "private-pem", value);
+      } else {
+        GST_WARNING_OBJECT (self,
+            "tried to get private-pem after disabling DTLS");
+      }
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
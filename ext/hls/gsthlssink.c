@@ -28,6 +28,13 @@
  * gst-launch-1.0 videotestsrc is-live=true ! x264enc ! mpegtsmux ! hlssink max-files=5
  * ]|
  * </refsect2>
+ *
+ * With #GstHlsSink:writer set to file or app, fragments are collected in
+ * memory instead of going through multifilesink. The file writer writes
+ * them with GIO, so #GstHlsSink:location and #GstHlsSink:playlist-location
+ * can be any URI GIO can write to. The app writer hands fragments and
+ * playlists to the #GstHlsSink::write-fragment and
+ * #GstHlsSink::write-playlist signals, e.g. to upload them directly.
  */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -39,6 +46,7 @@
 #include <gio/gio.h>
 #include <glib/gstdio.h>
 #include <memory.h>
+#include <string.h>
 
 
 GST_DEBUG_CATEGORY_STATIC (gst_hls_sink_debug);
@@ -50,6 +58,7 @@ GST_DEBUG_CATEGORY_STATIC (gst_hls_sink_debug);
 #define DEFAULT_MAX_FILES 10
 #define DEFAULT_TARGET_DURATION 15
 #define DEFAULT_PLAYLIST_LENGTH 5
+#define DEFAULT_WRITER GST_HLS_SINK_WRITER_MULTIFILESINK
 
 #define GST_M3U8_PLAYLIST_VERSION 3
 
@@ -61,9 +70,40 @@ enum
   PROP_PLAYLIST_ROOT,
   PROP_MAX_FILES,
   PROP_TARGET_DURATION,
-  PROP_PLAYLIST_LENGTH
+  PROP_PLAYLIST_LENGTH,
+  PROP_WRITER
+};
+
+enum
+{
+  SIGNAL_WRITE_FRAGMENT,
+  SIGNAL_WRITE_PLAYLIST,
+  SIGNAL_DELETE_FRAGMENT,
+  LAST_SIGNAL
 };
 
+static guint gst_hls_sink_signals[LAST_SIGNAL] = { 0 };
+
+#define GST_TYPE_HLS_SINK_WRITER (gst_hls_sink_writer_get_type ())
+static GType
+gst_hls_sink_writer_get_type (void)
+{
+  static GType writer_type = 0;
+  static const GEnumValue writers[] = {
+    {GST_HLS_SINK_WRITER_MULTIFILESINK, "Write fragments with multifilesink",
+        "multifilesink"},
+    {GST_HLS_SINK_WRITER_FILE, "Segment in memory, write with GIO", "file"},
+    {GST_HLS_SINK_WRITER_APP, "Segment in memory, write with signals",
+        "app"},
+    {0, NULL, NULL},
+  };
+
+  if (!writer_type) {
+    writer_type = g_enum_register_static ("GstHlsSinkWriter", writers);
+  }
+  return writer_type;
+}
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -87,6 +127,8 @@ gst_hls_sink_change_state (GstElement * element, GstStateChange trans);
 static gboolean schedule_next_key_unit (GstHlsSink * sink);
 static GstFlowReturn gst_hls_sink_chain_list (GstPad * pad, GstObject * parent,
     GstBufferList * list);
+static void gst_hls_sink_fragment_closed (GstHlsSink * sink,
+    const gchar * filename, GstClockTime running_time);
 
 static void
 gst_hls_sink_dispose (GObject * object)
@@ -106,6 +148,8 @@ gst_hls_sink_finalize (GObject * object)
   g_free (sink->playlist_root);
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
+  g_queue_foreach (&sink->old_locations, (GFunc) g_free, NULL);
+  g_queue_clear (&sink->old_locations);
 
   G_OBJECT_CLASS (parent_class)->finalize ((GObject *) sink);
 }
@@ -169,6 +213,69 @@ gst_hls_sink_class_init (GstHlsSinkClass * klass)
           "the playlist will be infinite.",
           0, G_MAXUINT, DEFAULT_PLAYLIST_LENGTH,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstHlsSink:writer:
+   *
+   * How fragments and the playlist are written. Only takes effect when set
+   * before the element goes to the READY state for the first time.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_WRITER,
+      g_param_spec_enum ("writer", "Writer",
+          "How fragments and the playlist are written",
+          GST_TYPE_HLS_SINK_WRITER, DEFAULT_WRITER,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstHlsSink::write-fragment:
+   * @sink: the #GstHlsSink
+   * @location: the location of the fragment
+   * @fragment: the buffers of the fragment
+   *
+   * Emitted with the app writer when a fragment is complete. Handlers must
+   * not modify @fragment and have to return %TRUE when it was written.
+   *
+   * Since: 1.6
+   */
+  gst_hls_sink_signals[SIGNAL_WRITE_FRAGMENT] =
+      g_signal_new ("write-fragment", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, G_STRUCT_OFFSET (GstHlsSinkClass, write_fragment),
+      g_signal_accumulator_true_handled, NULL, g_cclosure_marshal_generic,
+      G_TYPE_BOOLEAN, 2, G_TYPE_STRING, GST_TYPE_BUFFER_LIST);
+
+  /**
+   * GstHlsSink::write-playlist:
+   * @sink: the #GstHlsSink
+   * @location: the location of the playlist
+   * @playlist: the playlist
+   *
+   * Emitted with the app writer whenever the playlist changes. Handlers
+   * have to return %TRUE when it was written.
+   *
+   * Since: 1.6
+   */
+  gst_hls_sink_signals[SIGNAL_WRITE_PLAYLIST] =
+      g_signal_new ("write-playlist", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, G_STRUCT_OFFSET (GstHlsSinkClass, write_playlist),
+      g_signal_accumulator_true_handled, NULL, g_cclosure_marshal_generic,
+      G_TYPE_BOOLEAN, 2, G_TYPE_STRING, G_TYPE_STRING);
+
+  /**
+   * GstHlsSink::delete-fragment:
+   * @sink: the #GstHlsSink
+   * @location: the location of the fragment
+   *
+   * Emitted with the app writer when a fragment falls out of
+   * #GstHlsSink:max-files.
+   *
+   * Since: 1.6
+   */
+  gst_hls_sink_signals[SIGNAL_DELETE_FRAGMENT] =
+      g_signal_new ("delete-fragment", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, G_STRUCT_OFFSET (GstHlsSinkClass, delete_fragment),
+      NULL, NULL, g_cclosure_marshal_generic, G_TYPE_NONE, 1, G_TYPE_STRING);
 }
 
 static void
@@ -190,6 +297,8 @@ gst_hls_sink_init (GstHlsSink * sink)
   sink->playlist_length = DEFAULT_PLAYLIST_LENGTH;
   sink->max_files = DEFAULT_MAX_FILES;
   sink->target_duration = DEFAULT_TARGET_DURATION;
+  sink->writer = DEFAULT_WRITER;
+  g_queue_init (&sink->old_locations);
 
   /* haven't added a sink yet, make it is detected as a sink meanwhile */
   GST_OBJECT_FLAG_SET (sink, GST_ELEMENT_FLAG_SINK);
@@ -208,6 +317,13 @@ gst_hls_sink_reset (GstHlsSink * sink)
   gst_event_replace (&sink->force_key_unit_event, NULL);
   gst_segment_init (&sink->segment, GST_FORMAT_UNDEFINED);
 
+  if (sink->fragment)
+    gst_buffer_list_unref (sink->fragment);
+  sink->fragment = NULL;
+  sink->fragment_end_running_time = GST_CLOCK_TIME_NONE;
+  g_queue_foreach (&sink->old_locations, (GFunc) g_free, NULL);
+  g_queue_clear (&sink->old_locations);
+
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
   sink->playlist =
@@ -215,6 +331,52 @@ gst_hls_sink_reset (GstHlsSink * sink)
       FALSE);
 }
 
+static void
+gst_hls_sink_handoff (GstElement * fakesink, GstBuffer * buffer, GstPad * pad,
+    GstHlsSink * sink)
+{
+  GstClockTime timestamp, running_time;
+
+  if (sink->fragment == NULL)
+    sink->fragment = gst_buffer_list_new ();
+  gst_buffer_list_add (sink->fragment, gst_buffer_ref (buffer));
+
+  timestamp = GST_BUFFER_TIMESTAMP (buffer);
+  if (!GST_CLOCK_TIME_IS_VALID (timestamp))
+    return;
+
+  if (GST_BUFFER_DURATION_IS_VALID (buffer))
+    timestamp += GST_BUFFER_DURATION (buffer);
+  running_time = gst_segment_to_running_time (&sink->segment,
+      GST_FORMAT_TIME, timestamp);
+  if (GST_CLOCK_TIME_IS_VALID (running_time))
+    sink->fragment_end_running_time = running_time;
+}
+
+static gboolean
+gst_hls_sink_create_fakesink (GstHlsSink * sink)
+{
+  GstPad *pad;
+
+  sink->fakesink = gst_element_factory_make ("fakesink", NULL);
+  if (sink->fakesink == NULL)
+    return FALSE;
+
+  /* the fakesink only handles preroll and hands the buffers over */
+  g_object_set (sink->fakesink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink->fakesink, "handoff",
+      G_CALLBACK (gst_hls_sink_handoff), sink);
+
+  gst_bin_add (GST_BIN_CAST (sink), sink->fakesink);
+
+  pad = gst_element_get_static_pad (sink->fakesink, "sink");
+  gst_ghost_pad_set_target (GST_GHOST_PAD (sink->ghostpad), pad);
+  gst_object_unref (pad);
+
+  sink->elements_created = TRUE;
+  return TRUE;
+}
+
 static gboolean
 gst_hls_sink_create_elements (GstHlsSink * sink)
 {
@@ -225,6 +387,12 @@ gst_hls_sink_create_elements (GstHlsSink * sink)
   if (sink->elements_created)
     return TRUE;
 
+  if (sink->writer != GST_HLS_SINK_WRITER_MULTIFILESINK) {
+    if (!gst_hls_sink_create_fakesink (sink))
+      goto missing_fakesink;
+    return TRUE;
+  }
+
   sink->multifilesink = gst_element_factory_make ("multifilesink", NULL);
   if (sink->multifilesink == NULL)
     goto missing_element;
@@ -250,6 +418,14 @@ missing_element:
       (("Missing element '%s' - check your GStreamer installation."),
           "multifilesink"), (NULL));
   return FALSE;
+
+missing_fakesink:
+  gst_element_post_message (GST_ELEMENT_CAST (sink),
+      gst_missing_element_message_new (GST_ELEMENT_CAST (sink), "fakesink"));
+  GST_ELEMENT_ERROR (sink, CORE, MISSING_PLUGIN,
+      (("Missing element '%s' - check your GStreamer installation."),
+          "fakesink"), (NULL));
+  return FALSE;
 }
 
 static void
@@ -257,10 +433,33 @@ gst_hls_sink_write_playlist (GstHlsSink * sink)
 {
   char *playlist_content;
   GError *error = NULL;
+  GFile *file;
+  gboolean written = FALSE;
 
   playlist_content = gst_m3u8_playlist_render (sink->playlist);
-  if (!g_file_set_contents (sink->playlist_location,
-          playlist_content, -1, &error)) {
+
+  switch (sink->writer) {
+    case GST_HLS_SINK_WRITER_MULTIFILESINK:
+      g_file_set_contents (sink->playlist_location, playlist_content, -1,
+          &error);
+      break;
+    case GST_HLS_SINK_WRITER_FILE:
+      file = g_file_new_for_commandline_arg (sink->playlist_location);
+      g_file_replace_contents (file, playlist_content,
+          strlen (playlist_content), NULL, FALSE, G_FILE_CREATE_NONE, NULL,
+          NULL, &error);
+      g_object_unref (file);
+      break;
+    case GST_HLS_SINK_WRITER_APP:
+      g_signal_emit (sink, gst_hls_sink_signals[SIGNAL_WRITE_PLAYLIST], 0,
+          sink->playlist_location, playlist_content, &written);
+      if (!written)
+        error = g_error_new_literal (GST_RESOURCE_ERROR,
+            GST_RESOURCE_ERROR_WRITE, "not handled by the application");
+      break;
+  }
+
+  if (error != NULL) {
     GST_ERROR ("Failed to write playlist: %s", error->message);
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
         (("Failed to write playlist '%s'."), error->message), (NULL));
@@ -271,6 +470,159 @@ gst_hls_sink_write_playlist (GstHlsSink * sink)
 
 }
 
+static gboolean
+gst_hls_sink_file_write_fragment (const gchar * location,
+    GstBufferList * fragment, GError ** error)
+{
+  GFile *file;
+  GFileOutputStream *stream;
+  guint i, j, len;
+  gboolean ret = TRUE;
+
+  file = g_file_new_for_commandline_arg (location);
+  stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+  g_object_unref (file);
+  if (stream == NULL)
+    return FALSE;
+
+  /* straight from the buffers, nothing is merged or copied */
+  len = gst_buffer_list_length (fragment);
+  for (i = 0; i < len && ret; i++) {
+    GstBuffer *buffer = gst_buffer_list_get (fragment, i);
+
+    for (j = 0; j < gst_buffer_n_memory (buffer) && ret; j++) {
+      GstMemory *mem = gst_buffer_peek_memory (buffer, j);
+      GstMapInfo map;
+
+      if (!gst_memory_map (mem, &map, GST_MAP_READ)) {
+        g_set_error (error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_WRITE,
+            "failed to map memory");
+        ret = FALSE;
+        break;
+      }
+      ret = g_output_stream_write_all (G_OUTPUT_STREAM (stream), map.data,
+          map.size, NULL, NULL, error);
+      gst_memory_unmap (mem, &map);
+    }
+  }
+
+  if (ret)
+    ret = g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, error);
+  g_object_unref (stream);
+
+  return ret;
+}
+
+static void
+gst_hls_sink_delete_fragment (GstHlsSink * sink, const gchar * location)
+{
+  GError *error = NULL;
+  GFile *file;
+
+  GST_DEBUG_OBJECT (sink, "deleting fragment %s", location);
+
+  if (sink->writer == GST_HLS_SINK_WRITER_APP) {
+    g_signal_emit (sink, gst_hls_sink_signals[SIGNAL_DELETE_FRAGMENT], 0,
+        location);
+    return;
+  }
+
+  file = g_file_new_for_commandline_arg (location);
+  if (!g_file_delete (file, NULL, &error)) {
+    GST_WARNING_OBJECT (sink, "Failed to delete fragment %s: %s", location,
+        error->message);
+    g_error_free (error);
+  }
+  g_object_unref (file);
+}
+
+/* Writes out the fragment collected in memory, which ends at @running_time */
+static void
+gst_hls_sink_write_fragment (GstHlsSink * sink, GstClockTime running_time)
+{
+  GError *error = NULL;
+  gboolean written = FALSE;
+  gchar *location;
+
+  if (sink->fragment == NULL)
+    return;
+
+  location = g_strdup_printf (sink->location, sink->count);
+  GST_DEBUG_OBJECT (sink, "writing fragment %s with %u buffers", location,
+      gst_buffer_list_length (sink->fragment));
+
+  if (sink->writer == GST_HLS_SINK_WRITER_APP) {
+    g_signal_emit (sink, gst_hls_sink_signals[SIGNAL_WRITE_FRAGMENT], 0,
+        location, sink->fragment, &written);
+    if (!written)
+      error = g_error_new_literal (GST_RESOURCE_ERROR,
+          GST_RESOURCE_ERROR_WRITE, "not handled by the application");
+  } else if (gst_hls_sink_file_write_fragment (location, sink->fragment,
+          &error)) {
+    written = TRUE;
+  }
+
+  gst_buffer_list_unref (sink->fragment);
+  sink->fragment = NULL;
+  sink->count++;
+
+  if (!written) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+        (("Failed to write fragment '%s'."), location), ("%s",
+            error->message));
+    g_error_free (error);
+    g_free (location);
+    return;
+  }
+
+  g_queue_push_tail (&sink->old_locations, g_strdup (location));
+  while (sink->max_files > 0 &&
+      g_queue_get_length (&sink->old_locations) > sink->max_files) {
+    gchar *old_location = g_queue_pop_head (&sink->old_locations);
+
+    gst_hls_sink_delete_fragment (sink, old_location);
+    g_free (old_location);
+  }
+
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    running_time = sink->fragment_end_running_time;
+  gst_hls_sink_fragment_closed (sink, location, running_time);
+  g_free (location);
+}
+
+static void
+gst_hls_sink_fragment_closed (GstHlsSink * sink, const gchar * filename,
+    GstClockTime running_time)
+{
+  GstClockTime duration;
+  gboolean discont = FALSE;
+  gchar *entry_location;
+
+  duration = running_time - sink->last_running_time;
+  sink->last_running_time = running_time;
+
+  GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
+  if (sink->playlist_root == NULL)
+    entry_location = g_path_get_basename (filename);
+  else {
+    gchar *name = g_path_get_basename (filename);
+    entry_location = g_build_filename (sink->playlist_root, name, NULL);
+    g_free (name);
+  }
+
+  gst_m3u8_playlist_add_entry (sink->playlist, entry_location,
+      NULL, duration, sink->index, discont);
+  g_free (entry_location);
+
+  gst_hls_sink_write_playlist (sink);
+
+  /* a new fragment is starting. It means that upstream sent a key unit and
+   * we can schedule the next key unit now.
+   */
+  sink->waiting_fku = FALSE;
+  schedule_next_key_unit (sink);
+}
+
 static void
 gst_hls_sink_handle_message (GstBin * bin, GstMessage * message)
 {
@@ -280,9 +632,7 @@ gst_hls_sink_handle_message (GstBin * bin, GstMessage * message)
     case GST_MESSAGE_ELEMENT:
     {
       const char *filename;
-      GstClockTime running_time, duration;
-      gboolean discont = FALSE;
-      gchar *entry_location;
+      GstClockTime running_time;
       const GstStructure *structure;
 
       structure = gst_message_get_structure (message);
@@ -291,29 +641,9 @@ gst_hls_sink_handle_message (GstBin * bin, GstMessage * message)
 
       filename = gst_structure_get_string (structure, "filename");
       gst_structure_get_clock_time (structure, "running-time", &running_time);
-      duration = running_time - sink->last_running_time;
-      sink->last_running_time = running_time;
-
-      GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
-      if (sink->playlist_root == NULL)
-        entry_location = g_path_get_basename (filename);
-      else {
-        gchar *name = g_path_get_basename (filename);
-        entry_location = g_build_filename (sink->playlist_root, name, NULL);
-        g_free (name);
-      }
 
-      gst_m3u8_playlist_add_entry (sink->playlist, entry_location,
-          NULL, duration, sink->index, discont);
-      g_free (entry_location);
-
-      gst_hls_sink_write_playlist (sink);
-
-      /* multifilesink is starting a new file. It means that upstream sent a key
-       * unit and we can schedule the next key unit now.
-       */
-      sink->waiting_fku = FALSE;
-      schedule_next_key_unit (sink);
+      /* multifilesink is starting a new file */
+      gst_hls_sink_fragment_closed (sink, filename, running_time);
 
       /* multifilesink is an internal implementation detail. If applications
        * need a notification, we should probably do our own message */
@@ -407,6 +737,13 @@ gst_hls_sink_set_property (GObject * object, guint prop_id,
       sink->playlist_length = g_value_get_uint (value);
       sink->playlist->window_size = sink->playlist_length;
       break;
+    case PROP_WRITER:
+      if (sink->elements_created) {
+        GST_WARNING_OBJECT (sink, "writer can't be changed after READY");
+        break;
+      }
+      sink->writer = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -438,6 +775,9 @@ gst_hls_sink_get_property (GObject * object, guint prop_id,
     case PROP_PLAYLIST_LENGTH:
       g_value_set_uint (value, sink->playlist_length);
       break;
+    case PROP_WRITER:
+      g_value_set_enum (value, sink->writer);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -459,6 +799,14 @@ gst_hls_sink_ghost_event_probe (GstPad * pad, GstPadProbeInfo * info,
     }
     case GST_EVENT_FLUSH_STOP:
       gst_segment_init (&sink->segment, GST_FORMAT_UNDEFINED);
+      if (sink->fragment) {
+        gst_buffer_list_unref (sink->fragment);
+        sink->fragment = NULL;
+      }
+      break;
+    case GST_EVENT_EOS:
+      /* the last fragment ends with the stream */
+      gst_hls_sink_write_fragment (sink, GST_CLOCK_TIME_NONE);
       break;
     case GST_EVENT_CUSTOM_DOWNSTREAM:
     {
@@ -473,8 +821,13 @@ gst_hls_sink_ghost_event_probe (GstPad * pad, GstPadProbeInfo * info,
       gst_event_replace (&sink->force_key_unit_event, event);
       gst_video_event_parse_downstream_force_key_unit (event,
           &timestamp, &stream_time, &running_time, &all_headers, &count);
+
       GST_INFO_OBJECT (sink, "setting index %d", count);
       sink->index = count;
+
+      /* the key unit starts the next fragment, like multifilesink does it
+       * with next-file=key-unit-event */
+      gst_hls_sink_write_fragment (sink, running_time);
       break;
     }
     default:
@@ -34,12 +34,30 @@ G_BEGIN_DECLS
 typedef struct _GstHlsSink GstHlsSink;
 typedef struct _GstHlsSinkClass GstHlsSinkClass;
 
+/**
+ * GstHlsSinkWriter:
+ * @GST_HLS_SINK_WRITER_MULTIFILESINK: fragments are written by multifilesink
+ * @GST_HLS_SINK_WRITER_FILE: fragments are collected in memory and written
+ *   together with the playlist through GIO, locations can be URIs
+ * @GST_HLS_SINK_WRITER_APP: fragments are collected in memory and handed to
+ *   the application together with the playlist through signals
+ *
+ * How fragments and the playlist are written.
+ */
+typedef enum
+{
+  GST_HLS_SINK_WRITER_MULTIFILESINK,
+  GST_HLS_SINK_WRITER_FILE,
+  GST_HLS_SINK_WRITER_APP
+} GstHlsSinkWriter;
+
 struct _GstHlsSink
 {
   GstBin bin;
 
   GstPad *ghostpad;
   GstElement *multifilesink;
+  GstElement *fakesink;
   gboolean elements_created;
   GstEvent *force_key_unit_event;
 
@@ -56,11 +74,24 @@ struct _GstHlsSink
   GstSegment segment;
   gboolean waiting_fku;
   GstClockTime last_running_time;
+
+  GstHlsSinkWriter writer;
+  /* fragment being collected for the in-memory writers */
+  GstBufferList *fragment;
+  GstClockTime fragment_end_running_time;
+  GQueue old_locations;
 };
 
 struct _GstHlsSinkClass
 {
   GstBinClass bin_class;
+
+  /* signals */
+  gboolean (*write_fragment) (GstHlsSink * sink, const gchar * location,
+      GstBufferList * fragment);
+  gboolean (*write_playlist) (GstHlsSink * sink, const gchar * location,
+      const gchar * playlist);
+  void (*delete_fragment) (GstHlsSink * sink, const gchar * location);
 };
 
 GType gst_hls_sink_get_type (void);
@@ -20,6 +20,7 @@
  */
 
 #include <glib.h>
+#include <string.h>
 
 #include "gstfragmented.h"
 #include "gstm3u8playlist.h"
@@ -99,6 +100,7 @@ gst_m3u8_playlist_new (guint version, guint window_size, gboolean allow_cache)
   playlist->type = GST_M3U8_PLAYLIST_TYPE_EVENT;
   playlist->end_list = FALSE;
   playlist->entries = g_queue_new ();
+  playlist->playlist_str = g_string_new ("");
 
   return playlist;
 }
@@ -110,6 +112,7 @@ gst_m3u8_playlist_free (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_free (playlist->entries);
+  g_string_free (playlist->playlist_str, TRUE);
   g_free (playlist);
 }
 
@@ -120,6 +123,8 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
     gfloat duration, guint index, gboolean discontinuous)
 {
   GstM3U8Entry *entry;
+  gchar *entry_str;
+  gboolean max_removed = FALSE;
 
   g_return_val_if_fail (playlist != NULL, FALSE);
   g_return_val_if_fail (url != NULL, FALSE);
@@ -130,81 +135,88 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
   entry = gst_m3u8_entry_new (url, title, duration, discontinuous);
 
   if (playlist->window_size > 0) {
+    gsize trim_len = 0;
+
     /* Delete old entries from the playlist */
     while (playlist->entries->length >= playlist->window_size) {
       GstM3U8Entry *old_entry;
 
       old_entry = g_queue_pop_head (playlist->entries);
+      trim_len += old_entry->rendered_len;
+      max_removed |= old_entry->duration >= playlist->max_duration;
       gst_m3u8_entry_free (old_entry);
     }
+
+    /* ... and their text from the front of the rendered entries */
+    g_string_erase (playlist->playlist_str, 0, trim_len);
   }
 
   playlist->sequence_number = index + 1;
   g_queue_push_tail (playlist->entries, entry);
 
-  return TRUE;
-}
+  /* Entries never change once added, so they are rendered only once */
+  entry_str = gst_m3u8_entry_render (entry, playlist->version);
+  entry->rendered_len = strlen (entry_str);
+  g_string_append_len (playlist->playlist_str, entry_str, entry->rendered_len);
+  g_free (entry_str);
 
-static guint
-gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
-{
-  gint i;
-  GstM3U8Entry *entry;
-  guint64 target_duration = 0;
+  if (max_removed) {
+    GList *l;
 
-  for (i = 0; i < playlist->entries->length; i++) {
-    entry = (GstM3U8Entry *) g_queue_peek_nth (playlist->entries, i);
-    if (entry->duration > target_duration)
-      target_duration = entry->duration;
+    playlist->max_duration = 0;
+    for (l = playlist->entries->head; l; l = l->next) {
+      GstM3U8Entry *e = l->data;
+
+      playlist->max_duration = MAX (playlist->max_duration, e->duration);
+    }
+  } else {
+    playlist->max_duration = MAX (playlist->max_duration, duration);
   }
 
-  return (guint) ((target_duration + 500 * GST_MSECOND) / GST_SECOND);
+  return TRUE;
 }
 
-static void
-render_entry (GstM3U8Entry * entry, GstM3U8Playlist * playlist)
+static guint
+gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
 {
-  gchar *entry_str;
+  guint64 target_duration = playlist->max_duration;
 
-  entry_str = gst_m3u8_entry_render (entry, playlist->version);
-  g_string_append_printf (playlist->playlist_str, "%s", entry_str);
-  g_free (entry_str);
+  return (guint) ((target_duration + 500 * GST_MSECOND) / GST_SECOND);
 }
 
 gchar *
 gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
 {
-  gchar *pl;
+  GString *playlist_str;
 
   g_return_val_if_fail (playlist != NULL, NULL);
 
-  playlist->playlist_str = g_string_new ("");
+  /* the header is short, make room for it and the entries at once */
+  playlist_str = g_string_sized_new (playlist->playlist_str->len + 256);
 
   /* #EXTM3U */
-  g_string_append_printf (playlist->playlist_str, M3U8_HEADER_TAG);
+  g_string_append (playlist_str, M3U8_HEADER_TAG);
   /* #EXT-X-VERSION */
-  g_string_append_printf (playlist->playlist_str, M3U8_VERSION_TAG,
-      playlist->version);
+  g_string_append_printf (playlist_str, M3U8_VERSION_TAG, playlist->version);
   /* #EXT-X-ALLOW_CACHE */
-  g_string_append_printf (playlist->playlist_str, M3U8_ALLOW_CACHE_TAG,
+  g_string_append_printf (playlist_str, M3U8_ALLOW_CACHE_TAG,
       playlist->allow_cache ? "YES" : "NO");
   /* #EXT-X-MEDIA-SEQUENCE */
-  g_string_append_printf (playlist->playlist_str, M3U8_MEDIA_SEQUENCE_TAG,
+  g_string_append_printf (playlist_str, M3U8_MEDIA_SEQUENCE_TAG,
       playlist->sequence_number - playlist->entries->length);
   /* #EXT-X-TARGETDURATION */
-  g_string_append_printf (playlist->playlist_str, M3U8_TARGETDURATION_TAG,
+  g_string_append_printf (playlist_str, M3U8_TARGETDURATION_TAG,
       gst_m3u8_playlist_target_duration (playlist));
-  g_string_append_printf (playlist->playlist_str, "\n");
+  g_string_append_c (playlist_str, '\n');
 
   /* Entries */
-  g_queue_foreach (playlist->entries, (GFunc) render_entry, playlist);
+  g_string_append_len (playlist_str, playlist->playlist_str->str,
+      playlist->playlist_str->len);
 
   if (playlist->end_list)
-    g_string_append_printf (playlist->playlist_str, M3U8_ENDLIST_TAG);
+    g_string_append (playlist_str, M3U8_ENDLIST_TAG);
 
-  pl = playlist->playlist_str->str;
-  g_string_free (playlist->playlist_str, FALSE);
-  return pl;
+  return g_string_free (playlist_str, FALSE);
 }
 
 void
@@ -214,6 +226,8 @@ gst_m3u8_playlist_clear (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_clear (playlist->entries);
+  g_string_truncate (playlist->playlist_str, 0);
+  playlist->max_duration = 0;
 }
 
 guint
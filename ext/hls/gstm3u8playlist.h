@@ -37,6 +37,9 @@ struct _GstM3U8Entry
   gchar *title;
   gchar *url;
   gboolean discontinuous;
+
+  /*< Private >*/
+  gsize rendered_len;
 };
 
 struct _GstM3U8Playlist
@@ -50,7 +53,9 @@ struct _GstM3U8Playlist
 
   /*< Private >*/
   GQueue *entries;
+  /* rendered entries, appended to and trimmed along with @entries */
   GString *playlist_str;
+  gfloat max_duration;
 };
 
 
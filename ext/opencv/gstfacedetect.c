@@ -55,6 +55,10 @@
  * until the size is &lt;= GstFaceDetect::min-size-width or 
  * GstFaceDetect::min-size-height. 
  *
+ * With GstFaceDetect::async the detection runs on a separate thread, on
+ * frames shrunk by GstFaceDetect::downscale and at most
+ * GstFaceDetect::max-rate times per second, while the video keeps flowing.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -63,6 +67,9 @@
  * |[
  * gst-launch-1.0 autovideosrc ! video/x-raw,width=320,height=240 ! videoconvert ! facedetect min-size-width=60 min-size-height=60 ! colorspace ! xvimagesink
  * ]| Detect large faces on a smaller image 
+ * |[
+ * gst-launch-1.0 autovideosrc ! videoconvert ! facedetect async=true downscale=2 max-rate=5 ! videoconvert ! xvimagesink
+ * ]| Detect faces five times per second without slowing down the video
  *
  * </refsect2>
  */
@@ -99,6 +106,9 @@ GST_DEBUG_CATEGORY_STATIC (gst_face_detect_debug);
 #define DEFAULT_MIN_SIZE_WIDTH 30
 #define DEFAULT_MIN_SIZE_HEIGHT 30
 #define DEFAULT_MIN_STDDEV 0
+#define DEFAULT_ASYNC FALSE
+#define DEFAULT_MAX_RATE 0.0
+#define DEFAULT_DOWNSCALE 1
 
 /* Filter signals and args */
 enum
@@ -121,9 +131,20 @@ enum
   PROP_MIN_SIZE_WIDTH,
   PROP_MIN_SIZE_HEIGHT,
   PROP_UPDATES,
-  PROP_MIN_STDDEV
+  PROP_MIN_STDDEV,
+  PROP_ASYNC,
+  PROP_MAX_RATE,
+  PROP_DOWNSCALE
 };
 
+/* A detected face and its features, in image coordinates */
+typedef struct
+{
+  CvRect face;
+  CvRect nose, mouth, eyes;
+  gboolean have_nose, have_mouth, have_eyes;
+} GstFaceDetectFace;
+
 
 /*
  * GstOpencvFaceDetectFlags:
@@ -210,6 +231,7 @@ static gboolean gst_face_detect_set_caps (GstOpencvVideoFilter * transform,
     gint out_width, gint out_height, gint out_depth, gint out_channels);
 static GstFlowReturn gst_face_detect_transform_ip (GstOpencvVideoFilter * base,
     GstBuffer * buf, IplImage * img);
+static gboolean gst_face_detect_stop (GstBaseTransform * trans);
 
 static CvHaarClassifierCascade *gst_face_detect_load_profile (GstFaceDetect *
     filter, gchar * profile);
@@ -239,6 +261,9 @@ gst_face_detect_finalize (GObject * obj)
   if (filter->cvEyesDetect)
     cvReleaseHaarClassifierCascade (&filter->cvEyesDetect);
 
+  gst_face_detect_stop (GST_BASE_TRANSFORM_CAST (filter));
+  g_mutex_clear (&filter->detect_lock);
+
   G_OBJECT_CLASS (gst_face_detect_parent_class)->finalize (obj);
 }
 
@@ -259,6 +284,8 @@ gst_face_detect_class_init (GstFaceDetectClass * klass)
 
   gstopencvbasefilter_class->cv_trans_ip_func = gst_face_detect_transform_ip;
   gstopencvbasefilter_class->cv_set_caps = gst_face_detect_set_caps;
+  GST_BASE_TRANSFORM_CLASS (klass)->stop =
+      GST_DEBUG_FUNCPTR (gst_face_detect_stop);
 
   g_object_class_install_property (gobject_class, PROP_DISPLAY,
       g_param_spec_boolean ("display", "Display",
@@ -317,6 +344,47 @@ gst_face_detect_class_init (GstFaceDetectClass * klass)
           "false positives not performing face detection on images with "
           "little changes", 0,
           255, DEFAULT_MIN_STDDEV, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFaceDetect:async:
+   *
+   * Run the detection on a separate thread. Frames pass through at full
+   * rate while the worker detects on the most recent frame it was given,
+   * and every frame is annotated with the latest results. Bus messages
+   * carry the timestamps of the frame the detection ran on.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_ASYNC,
+      g_param_spec_boolean ("async", "Async",
+          "Detect faces on a separate thread without holding back the video",
+          DEFAULT_ASYNC, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFaceDetect:max-rate:
+   *
+   * Maximum number of detections per second in async mode, 0 detects as
+   * often as the worker thread allows.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_RATE,
+      g_param_spec_double ("max-rate", "Maximum rate",
+          "Maximum number of detections per second in async mode "
+          "(0 = unlimited)", 0.0, G_MAXDOUBLE, DEFAULT_MAX_RATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFaceDetect:downscale:
+   *
+   * Factor by which frames are shrunk before the detection in async mode.
+   * The minimum sizes are scaled accordingly and the results are reported
+   * in coordinates of the original frame.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_DOWNSCALE,
+      g_param_spec_int ("downscale", "Downscale",
+          "Factor by which frames are shrunk before detection in async mode",
+          1, 16, DEFAULT_DOWNSCALE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (element_class,
       "facedetect",
@@ -348,6 +416,10 @@ gst_face_detect_init (GstFaceDetect * filter)
   filter->min_size_width = DEFAULT_MIN_SIZE_WIDTH;
   filter->min_size_height = DEFAULT_MIN_SIZE_HEIGHT;
   filter->min_stddev = DEFAULT_MIN_STDDEV;
+  filter->async = DEFAULT_ASYNC;
+  filter->max_rate = DEFAULT_MAX_RATE;
+  filter->downscale = DEFAULT_DOWNSCALE;
+  g_mutex_init (&filter->detect_lock);
   filter->cvFaceDetect =
       gst_face_detect_load_profile (filter, filter->face_profile);
   filter->cvNoseDetect =
@@ -370,36 +442,44 @@ gst_face_detect_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_FACE_PROFILE:
+      g_mutex_lock (&filter->detect_lock);
       g_free (filter->face_profile);
       if (filter->cvFaceDetect)
         cvReleaseHaarClassifierCascade (&filter->cvFaceDetect);
       filter->face_profile = g_value_dup_string (value);
       filter->cvFaceDetect =
           gst_face_detect_load_profile (filter, filter->face_profile);
+      g_mutex_unlock (&filter->detect_lock);
       break;
     case PROP_NOSE_PROFILE:
+      g_mutex_lock (&filter->detect_lock);
       g_free (filter->nose_profile);
       if (filter->cvNoseDetect)
         cvReleaseHaarClassifierCascade (&filter->cvNoseDetect);
       filter->nose_profile = g_value_dup_string (value);
       filter->cvNoseDetect =
           gst_face_detect_load_profile (filter, filter->nose_profile);
+      g_mutex_unlock (&filter->detect_lock);
       break;
     case PROP_MOUTH_PROFILE:
+      g_mutex_lock (&filter->detect_lock);
       g_free (filter->mouth_profile);
       if (filter->cvMouthDetect)
         cvReleaseHaarClassifierCascade (&filter->cvMouthDetect);
       filter->mouth_profile = g_value_dup_string (value);
       filter->cvMouthDetect =
           gst_face_detect_load_profile (filter, filter->mouth_profile);
+      g_mutex_unlock (&filter->detect_lock);
       break;
     case PROP_EYES_PROFILE:
+      g_mutex_lock (&filter->detect_lock);
       g_free (filter->eyes_profile);
       if (filter->cvEyesDetect)
         cvReleaseHaarClassifierCascade (&filter->cvEyesDetect);
       filter->eyes_profile = g_value_dup_string (value);
       filter->cvEyesDetect =
           gst_face_detect_load_profile (filter, filter->eyes_profile);
+      g_mutex_unlock (&filter->detect_lock);
       break;
     case PROP_DISPLAY:
       filter->display = g_value_get_boolean (value);
@@ -425,6 +505,15 @@ gst_face_detect_set_property (GObject * object, guint prop_id,
     case PROP_UPDATES:
       filter->updates = g_value_get_enum (value);
       break;
+    case PROP_ASYNC:
+      filter->async = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_RATE:
+      filter->max_rate = g_value_get_double (value);
+      break;
+    case PROP_DOWNSCALE:
+      filter->downscale = g_value_get_int (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -474,6 +563,15 @@ gst_face_detect_get_property (GObject * object, guint prop_id,
     case PROP_UPDATES:
       g_value_set_enum (value, filter->updates);
       break;
+    case PROP_ASYNC:
+      g_value_set_boolean (value, filter->async);
+      break;
+    case PROP_MAX_RATE:
+      g_value_set_double (value, filter->max_rate);
+      break;
+    case PROP_DOWNSCALE:
+      g_value_set_int (value, filter->downscale);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -503,44 +601,46 @@ gst_face_detect_set_caps (GstOpencvVideoFilter * transform, gint in_width,
   else
     cvClearMemStorage (filter->cvStorage);
 
+  /* Results of the worker refer to the previous frame size */
+  GST_OBJECT_LOCK (filter);
+  if (filter->results) {
+    g_array_unref (filter->results);
+    filter->results = NULL;
+  }
+  GST_OBJECT_UNLOCK (filter);
+
   return TRUE;
 }
 
 static GstMessage *
-gst_face_detect_message_new (GstFaceDetect * filter, GstBuffer * buf)
+gst_face_detect_message_new (GstFaceDetect * filter,
+    const GstOpencvAsyncFrame * frame)
 {
-  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (filter);
   GstStructure *s;
-  GstClockTime running_time, stream_time;
-
-  running_time = gst_segment_to_running_time (&trans->segment, GST_FORMAT_TIME,
-      GST_BUFFER_TIMESTAMP (buf));
-  stream_time = gst_segment_to_stream_time (&trans->segment, GST_FORMAT_TIME,
-      GST_BUFFER_TIMESTAMP (buf));
 
   s = gst_structure_new ("facedetect",
-      "timestamp", G_TYPE_UINT64, GST_BUFFER_TIMESTAMP (buf),
-      "stream-time", G_TYPE_UINT64, stream_time,
-      "running-time", G_TYPE_UINT64, running_time,
-      "duration", G_TYPE_UINT64, GST_BUFFER_DURATION (buf), NULL);
+      "timestamp", G_TYPE_UINT64, frame->timestamp,
+      "stream-time", G_TYPE_UINT64, frame->stream_time,
+      "running-time", G_TYPE_UINT64, frame->running_time,
+      "duration", G_TYPE_UINT64, frame->duration, NULL);
 
   return gst_message_new_element (GST_OBJECT (filter), s);
 }
 
 static CvSeq *
-gst_face_detect_run_detector (GstFaceDetect * filter,
-    CvHaarClassifierCascade * detector, gint min_size_width,
-    gint min_size_height)
+gst_face_detect_run_detector (GstFaceDetect * filter, IplImage * gray,
+    CvMemStorage * storage, CvHaarClassifierCascade * detector,
+    gint min_size_width, gint min_size_height)
 {
   double img_stddev = 0;
   if (filter->min_stddev > 0) {
     CvScalar mean, stddev;
-    cvAvgSdv (filter->cvGray, &mean, &stddev, NULL);
+    cvAvgSdv (gray, &mean, &stddev, NULL);
     img_stddev = stddev.val[0];
   }
   if (img_stddev >= filter->min_stddev) {
-    return cvHaarDetectObjects (filter->cvGray, detector,
-        filter->cvStorage, filter->scale_factor, filter->min_neighbors,
+    return cvHaarDetectObjects (gray, detector,
+        storage, filter->scale_factor, filter->min_neighbors,
         filter->flags, cvSize (min_size_width, min_size_height)
 #if (CV_MAJOR_VERSION >= 2) && (CV_MINOR_VERSION >= 2)
         , cvSize (0, 0)
@@ -550,251 +650,395 @@ gst_face_detect_run_detector (GstFaceDetect * filter,
     GST_LOG_OBJECT (filter,
         "Calculated stddev %f lesser than min_stddev %d, detection not performed",
         img_stddev, filter->min_stddev);
-    return cvCreateSeq (0, sizeof (CvSeq), sizeof (CvPoint), filter->cvStorage);
+    return cvCreateSeq (0, sizeof (CvSeq), sizeof (CvPoint), storage);
   }
 }
 
-/* 
- * Performs the face detection
+/* Runs @detector on the @roi of @gray and stores the first hit, in
+ * coordinates of the whole image, in @res */
+static gboolean
+gst_face_detect_run_feature_detector (GstFaceDetect * filter, IplImage * gray,
+    CvMemStorage * storage, CvHaarClassifierCascade * detector, CvRect roi,
+    gint min_size_width, gint min_size_height, CvRect * res)
+{
+  CvSeq *seq;
+  CvRect *sr;
+  gboolean found = FALSE;
+
+  cvSetImageROI (gray, roi);
+  seq = gst_face_detect_run_detector (filter, gray, storage, detector,
+      min_size_width, min_size_height);
+  if (seq && seq->total) {
+    sr = (CvRect *) cvGetSeqElem (seq, 0);
+    *res = cvRect (roi.x + sr->x, roi.y + sr->y, sr->width, sr->height);
+    found = TRUE;
+  }
+  cvResetImageROI (gray);
+
+  return found;
+}
+
+static void
+gst_face_detect_scale_rect (CvRect * r, gint scale)
+{
+  r->x *= scale;
+  r->y *= scale;
+  r->width *= scale;
+  r->height *= scale;
+}
+
+/*
+ * Performs the face detection on @gray, which was shrunk by @downscale.
+ * The returned faces are in coordinates of the original image. Must be
+ * called with the detect lock.
  */
-static GstFlowReturn
-gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
-    IplImage * img)
+static GArray *
+gst_face_detect_detect (GstFaceDetect * filter, IplImage * gray,
+    CvMemStorage * storage, gint downscale)
 {
-  GstFaceDetect *filter = GST_FACE_DETECT (base);
+  GArray *result;
+  CvSeq *faces;
+  gint min_w = filter->min_size_width / downscale;
+  gint min_h = filter->min_size_height / downscale;
+  gint i;
 
-  if (filter->cvFaceDetect) {
-    GstMessage *msg = NULL;
-    GstStructure *s;
-    GValue facelist = { 0 };
-    GValue facedata = { 0 };
-    CvSeq *faces;
-    CvSeq *mouth = NULL, *nose = NULL, *eyes = NULL;
-    gint i;
-    gboolean do_display = FALSE;
-    gboolean post_msg = FALSE;
-
-    if (filter->display) {
-      if (gst_buffer_is_writable (buf)) {
-        do_display = TRUE;
-      } else {
-        GST_LOG_OBJECT (filter, "Buffer is not writable, not drawing faces.");
-      }
+  result = g_array_new (FALSE, TRUE, sizeof (GstFaceDetectFace));
+
+  cvClearMemStorage (storage);
+  faces = gst_face_detect_run_detector (filter, gray, storage,
+      filter->cvFaceDetect, min_w, min_h);
+
+  for (i = 0; i < (faces ? faces->total : 0); i++) {
+    CvRect *r = (CvRect *) cvGetSeqElem (faces, i);
+    GstFaceDetectFace face = { {0}, };
+    guint mw = min_w / 8;
+    guint mh = min_h / 8;
+
+    face.face = *r;
+
+    /* detect face features */
+
+    if (filter->cvNoseDetect) {
+      face.have_nose = gst_face_detect_run_feature_detector (filter, gray,
+          storage, filter->cvNoseDetect, cvRect (r->x + r->width / 4,
+              r->y + r->height / 4, r->width / 2, r->height / 2), mw, mh,
+          &face.nose);
     }
 
-    cvCvtColor (img, filter->cvGray, CV_RGB2GRAY);
-    cvClearMemStorage (filter->cvStorage);
+    if (filter->cvMouthDetect) {
+      face.have_mouth = gst_face_detect_run_feature_detector (filter, gray,
+          storage, filter->cvMouthDetect, cvRect (r->x, r->y + r->height / 2,
+              r->width, r->height / 2), mw, mh, &face.mouth);
+    }
+
+    if (filter->cvEyesDetect) {
+      face.have_eyes = gst_face_detect_run_feature_detector (filter, gray,
+          storage, filter->cvEyesDetect, cvRect (r->x, r->y, r->width,
+              r->height / 2), mw, mh, &face.eyes);
+    }
 
-    faces = gst_face_detect_run_detector (filter, filter->cvFaceDetect,
-        filter->min_size_width, filter->min_size_height);
+    if (downscale > 1) {
+      gst_face_detect_scale_rect (&face.face, downscale);
+      gst_face_detect_scale_rect (&face.nose, downscale);
+      gst_face_detect_scale_rect (&face.mouth, downscale);
+      gst_face_detect_scale_rect (&face.eyes, downscale);
+    }
 
-    switch (filter->updates) {
-      case GST_FACEDETECT_UPDATES_EVERY_FRAME:
-        post_msg = TRUE;
-        break;
-      case GST_FACEDETECT_UPDATES_ON_CHANGE:
-        if (faces && faces->total > 0) {
-          if (!filter->face_detected)
-            post_msg = TRUE;
-        } else {
-          if (filter->face_detected) {
-            post_msg = TRUE;
-          }
-        }
-        break;
-      case GST_FACEDETECT_UPDATES_ON_FACE:
-        if (faces && faces->total > 0) {
+    GST_LOG_OBJECT (filter,
+        "%2d/%2d: x,y = %4u,%4u: w.h = %4u,%4u : features(e,n,m) = %d,%d,%d",
+        i, faces->total, face.face.x, face.face.y, face.face.width,
+        face.face.height, face.have_eyes, face.have_nose, face.have_mouth);
+
+    g_array_append_val (result, face);
+  }
+
+  return result;
+}
+
+static void
+gst_face_detect_post_results (GstFaceDetect * filter, GArray * faces,
+    const GstOpencvAsyncFrame * frame)
+{
+  GstMessage *msg;
+  GstStructure *s;
+  GValue facelist = { 0 };
+  GValue facedata = { 0 };
+  gboolean post_msg = FALSE;
+  guint i;
+
+  switch (filter->updates) {
+    case GST_FACEDETECT_UPDATES_EVERY_FRAME:
+      post_msg = TRUE;
+      break;
+    case GST_FACEDETECT_UPDATES_ON_CHANGE:
+      if (faces->len > 0) {
+        if (!filter->face_detected)
+          post_msg = TRUE;
+      } else {
+        if (filter->face_detected) {
           post_msg = TRUE;
-        } else {
-          post_msg = FALSE;
         }
-        break;
-      case GST_FACEDETECT_UPDATES_NONE:
-        post_msg = FALSE;
-        break;
-      default:
+      }
+      break;
+    case GST_FACEDETECT_UPDATES_ON_FACE:
+      if (faces->len > 0) {
         post_msg = TRUE;
-        break;
+      } else {
+        post_msg = FALSE;
+      }
+      break;
+    case GST_FACEDETECT_UPDATES_NONE:
+      post_msg = FALSE;
+      break;
+    default:
+      post_msg = TRUE;
+      break;
+  }
+
+  filter->face_detected = faces->len > 0;
+
+  if (!post_msg)
+    return;
+
+  msg = gst_face_detect_message_new (filter, frame);
+  g_value_init (&facelist, GST_TYPE_LIST);
+
+  for (i = 0; i < faces->len; i++) {
+    GstFaceDetectFace *face = &g_array_index (faces, GstFaceDetectFace, i);
+    CvRect *r = &face->face;
+
+    s = gst_structure_new ("face",
+        "x", G_TYPE_UINT, r->x,
+        "y", G_TYPE_UINT, r->y,
+        "width", G_TYPE_UINT, r->width,
+        "height", G_TYPE_UINT, r->height, NULL);
+    if (face->have_nose) {
+      CvRect *sr = &face->nose;
+      GST_LOG_OBJECT (filter, "nose: x,y = %4u,%4u: w.h = %4u,%4u",
+          sr->x, sr->y, sr->width, sr->height);
+      gst_structure_set (s,
+          "nose->x", G_TYPE_UINT, sr->x,
+          "nose->y", G_TYPE_UINT, sr->y,
+          "nose->width", G_TYPE_UINT, sr->width,
+          "nose->height", G_TYPE_UINT, sr->height, NULL);
     }
+    if (face->have_mouth) {
+      CvRect *sr = &face->mouth;
+      GST_LOG_OBJECT (filter, "mouth: x,y = %4u,%4u: w.h = %4u,%4u",
+          sr->x, sr->y, sr->width, sr->height);
+      gst_structure_set (s,
+          "mouth->x", G_TYPE_UINT, sr->x,
+          "mouth->y", G_TYPE_UINT, sr->y,
+          "mouth->width", G_TYPE_UINT, sr->width,
+          "mouth->height", G_TYPE_UINT, sr->height, NULL);
+    }
+    if (face->have_eyes) {
+      CvRect *sr = &face->eyes;
+      GST_LOG_OBJECT (filter, "eyes: x,y = %4u,%4u: w.h = %4u,%4u",
+          sr->x, sr->y, sr->width, sr->height);
+      gst_structure_set (s,
+          "eyes->x", G_TYPE_UINT, sr->x,
+          "eyes->y", G_TYPE_UINT, sr->y,
+          "eyes->width", G_TYPE_UINT, sr->width,
+          "eyes->height", G_TYPE_UINT, sr->height, NULL);
+    }
+
+    g_value_init (&facedata, GST_TYPE_STRUCTURE);
+    g_value_take_boxed (&facedata, s);
+    gst_value_list_append_value (&facelist, &facedata);
+    g_value_unset (&facedata);
+    s = NULL;
+  }
 
-    filter->face_detected = faces ? faces->total > 0 : FALSE;
+  gst_structure_set_value ((GstStructure *) gst_message_get_structure (msg),
+      "faces", &facelist);
+  g_value_unset (&facelist);
+  gst_element_post_message (GST_ELEMENT (filter), msg);
+}
+
+static void
+gst_face_detect_draw_feature (IplImage * img, CvRect * sr, gdouble wscale,
+    gdouble hscale, CvScalar color)
+{
+  CvPoint center;
+  CvSize axes;
+  gdouble w, h;
+
+  w = sr->width / 2;
+  h = sr->height / 2;
+  center.x = cvRound ((sr->x + w));
+  center.y = cvRound ((sr->y + h));
+  axes.width = w * wscale;
+  axes.height = h * hscale;
+  cvEllipse (img, center, axes, 0.0, 0.0, 360.0, color, 1, 8, 0);
+}
 
-    if (post_msg) {
-      msg = gst_face_detect_message_new (filter, buf);
-      g_value_init (&facelist, GST_TYPE_LIST);
+/* Highlights @faces in @img if requested and attaches them to @buf */
+static void
+gst_face_detect_apply_results (GstFaceDetect * filter, GstBuffer * buf,
+    IplImage * img, GArray * faces)
+{
+  gboolean do_display = FALSE;
+  guint i;
+
+  if (filter->display) {
+    if (gst_buffer_is_writable (buf)) {
+      do_display = TRUE;
+    } else {
+      GST_LOG_OBJECT (filter, "Buffer is not writable, not drawing faces.");
     }
+  }
 
-    for (i = 0; i < (faces ? faces->total : 0); i++) {
-      CvRect *r = (CvRect *) cvGetSeqElem (faces, i);
-      guint mw = filter->min_size_width / 8;
-      guint mh = filter->min_size_height / 8;
-      guint rnx = 0, rny = 0, rnw, rnh;
-      guint rmx = 0, rmy = 0, rmw, rmh;
-      guint rex = 0, rey = 0, rew, reh;
-      gboolean have_nose, have_mouth, have_eyes;
-
-      /* detect face features */
-
-      if (filter->cvNoseDetect) {
-        rnx = r->x + r->width / 4;
-        rny = r->y + r->height / 4;
-        rnw = r->width / 2;
-        rnh = r->height / 2;
-        cvSetImageROI (filter->cvGray, cvRect (rnx, rny, rnw, rnh));
-        nose =
-            gst_face_detect_run_detector (filter, filter->cvNoseDetect, mw, mh);
-        have_nose = (nose && nose->total);
-        cvResetImageROI (filter->cvGray);
-      } else {
-        have_nose = FALSE;
-      }
+  for (i = 0; i < faces->len; i++) {
+    GstFaceDetectFace *face = &g_array_index (faces, GstFaceDetectFace, i);
+    CvRect *r = &face->face;
+
+    if (do_display) {
+      CvPoint center;
+      CvSize axes;
+      gdouble w, h;
+      gint cb = 255 - ((i & 3) << 7);
+      gint cg = 255 - ((i & 12) << 5);
+      gint cr = 255 - ((i & 48) << 3);
+
+      w = r->width / 2;
+      h = r->height / 2;
+      center.x = cvRound ((r->x + w));
+      center.y = cvRound ((r->y + h));
+      axes.width = w;
+      axes.height = h * 1.25;   /* tweak for face form */
+      cvEllipse (img, center, axes, 0.0, 0.0, 360.0, CV_RGB (cr, cg, cb),
+          3, 8, 0);
+
+      /* tweak for nose, mouth and eyes form */
+      if (face->have_nose)
+        gst_face_detect_draw_feature (img, &face->nose, 1.0, 1.25,
+            CV_RGB (cr, cg, cb));
+      if (face->have_mouth)
+        gst_face_detect_draw_feature (img, &face->mouth, 1.5, 1.0,
+            CV_RGB (cr, cg, cb));
+      if (face->have_eyes)
+        gst_face_detect_draw_feature (img, &face->eyes, 1.5, 1.0,
+            CV_RGB (cr, cg, cb));
+    }
+    gst_buffer_add_video_region_of_interest_meta (buf, "face",
+        (guint) r->x, (guint) r->y, (guint) r->width, (guint) r->height);
+  }
+}
 
-      if (filter->cvMouthDetect) {
-        rmx = r->x;
-        rmy = r->y + r->height / 2;
-        rmw = r->width;
-        rmh = r->height / 2;
-        cvSetImageROI (filter->cvGray, cvRect (rmx, rmy, rmw, rmh));
-        mouth =
-            gst_face_detect_run_detector (filter, filter->cvMouthDetect, mw,
-            mh);
-        have_mouth = (mouth && mouth->total);
-        cvResetImageROI (filter->cvGray);
-      } else {
-        have_mouth = FALSE;
-      }
+/* Runs on the worker thread in async mode */
+static void
+gst_face_detect_async_detect (IplImage * image,
+    const GstOpencvAsyncFrame * frame, gpointer user_data)
+{
+  GstFaceDetect *filter = GST_FACE_DETECT (user_data);
+  GArray *faces = NULL, *old;
 
-      if (filter->cvEyesDetect) {
-        rex = r->x;
-        rey = r->y;
-        rew = r->width;
-        reh = r->height / 2;
-        cvSetImageROI (filter->cvGray, cvRect (rex, rey, rew, reh));
-        eyes =
-            gst_face_detect_run_detector (filter, filter->cvEyesDetect, mw, mh);
-        have_eyes = (eyes && eyes->total);
-        cvResetImageROI (filter->cvGray);
-      } else {
-        have_eyes = FALSE;
-      }
+  if (filter->cvAsyncGray && (filter->cvAsyncGray->width != image->width
+          || filter->cvAsyncGray->height != image->height))
+    cvReleaseImage (&filter->cvAsyncGray);
+  if (!filter->cvAsyncGray)
+    filter->cvAsyncGray =
+        cvCreateImage (cvSize (image->width, image->height), IPL_DEPTH_8U, 1);
+  if (!filter->cvAsyncStorage)
+    filter->cvAsyncStorage = cvCreateMemStorage (0);
 
-      GST_LOG_OBJECT (filter,
-          "%2d/%2d: x,y = %4u,%4u: w.h = %4u,%4u : features(e,n,m) = %d,%d,%d",
-          i, faces->total, r->x, r->y, r->width, r->height,
-          have_eyes, have_nose, have_mouth);
-      if (post_msg) {
-        s = gst_structure_new ("face",
-            "x", G_TYPE_UINT, r->x,
-            "y", G_TYPE_UINT, r->y,
-            "width", G_TYPE_UINT, r->width,
-            "height", G_TYPE_UINT, r->height, NULL);
-        if (have_nose) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (nose, 0);
-          GST_LOG_OBJECT (filter, "nose/%d: x,y = %4u,%4u: w.h = %4u,%4u",
-              nose->total, rnx + sr->x, rny + sr->y, sr->width, sr->height);
-          gst_structure_set (s,
-              "nose->x", G_TYPE_UINT, rnx + sr->x,
-              "nose->y", G_TYPE_UINT, rny + sr->y,
-              "nose->width", G_TYPE_UINT, sr->width,
-              "nose->height", G_TYPE_UINT, sr->height, NULL);
-        }
-        if (have_mouth) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (mouth, 0);
-          GST_LOG_OBJECT (filter, "mouth/%d: x,y = %4u,%4u: w.h = %4u,%4u",
-              mouth->total, rmx + sr->x, rmy + sr->y, sr->width, sr->height);
-          gst_structure_set (s,
-              "mouth->x", G_TYPE_UINT, rmx + sr->x,
-              "mouth->y", G_TYPE_UINT, rmy + sr->y,
-              "mouth->width", G_TYPE_UINT, sr->width,
-              "mouth->height", G_TYPE_UINT, sr->height, NULL);
-        }
-        if (have_eyes) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (eyes, 0);
-          GST_LOG_OBJECT (filter, "eyes/%d: x,y = %4u,%4u: w.h = %4u,%4u",
-              eyes->total, rex + sr->x, rey + sr->y, sr->width, sr->height);
-          gst_structure_set (s,
-              "eyes->x", G_TYPE_UINT, rex + sr->x,
-              "eyes->y", G_TYPE_UINT, rey + sr->y,
-              "eyes->width", G_TYPE_UINT, sr->width,
-              "eyes->height", G_TYPE_UINT, sr->height, NULL);
-        }
+  cvCvtColor (image, filter->cvAsyncGray, CV_RGB2GRAY);
 
-        g_value_init (&facedata, GST_TYPE_STRUCTURE);
-        g_value_take_boxed (&facedata, s);
-        gst_value_list_append_value (&facelist, &facedata);
-        g_value_unset (&facedata);
-        s = NULL;
-      }
+  g_mutex_lock (&filter->detect_lock);
+  if (filter->cvFaceDetect)
+    faces = gst_face_detect_detect (filter, filter->cvAsyncGray,
+        filter->cvAsyncStorage, frame->downscale);
+  g_mutex_unlock (&filter->detect_lock);
 
-      if (do_display) {
-        CvPoint center;
-        CvSize axes;
-        gdouble w, h;
-        gint cb = 255 - ((i & 3) << 7);
-        gint cg = 255 - ((i & 12) << 5);
-        gint cr = 255 - ((i & 48) << 3);
-
-        w = r->width / 2;
-        h = r->height / 2;
-        center.x = cvRound ((r->x + w));
-        center.y = cvRound ((r->y + h));
-        axes.width = w;
-        axes.height = h * 1.25; /* tweak for face form */
-        cvEllipse (img, center, axes, 0.0, 0.0, 360.0, CV_RGB (cr, cg, cb),
-            3, 8, 0);
-
-        if (have_nose) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (nose, 0);
-
-          w = sr->width / 2;
-          h = sr->height / 2;
-          center.x = cvRound ((rnx + sr->x + w));
-          center.y = cvRound ((rny + sr->y + h));
-          axes.width = w;
-          axes.height = h * 1.25;       /* tweak for nose form */
-          cvEllipse (img, center, axes, 0.0, 0.0, 360.0, CV_RGB (cr, cg, cb),
-              1, 8, 0);
-        }
-        if (have_mouth) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (mouth, 0);
-
-          w = sr->width / 2;
-          h = sr->height / 2;
-          center.x = cvRound ((rmx + sr->x + w));
-          center.y = cvRound ((rmy + sr->y + h));
-          axes.width = w * 1.5; /* tweak for mouth form */
-          axes.height = h;
-          cvEllipse (img, center, axes, 0.0, 0.0, 360.0, CV_RGB (cr, cg, cb),
-              1, 8, 0);
-        }
-        if (have_eyes) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (eyes, 0);
-
-          w = sr->width / 2;
-          h = sr->height / 2;
-          center.x = cvRound ((rex + sr->x + w));
-          center.y = cvRound ((rey + sr->y + h));
-          axes.width = w * 1.5; /* tweak for eyes form */
-          axes.height = h;
-          cvEllipse (img, center, axes, 0.0, 0.0, 360.0, CV_RGB (cr, cg, cb),
-              1, 8, 0);
-        }
-      }
-      gst_buffer_add_video_region_of_interest_meta (buf, "face",
-          (guint) r->x, (guint) r->y, (guint) r->width, (guint) r->height);
+  if (!faces)
+    return;
+
+  gst_face_detect_post_results (filter, faces, frame);
+
+  GST_OBJECT_LOCK (filter);
+  old = filter->results;
+  filter->results = faces;
+  GST_OBJECT_UNLOCK (filter);
+
+  if (old)
+    g_array_unref (old);
+}
+
+/*
+ * Performs the face detection, or in async mode hands the frame to the
+ * worker and applies the latest results it produced
+ */
+static GstFlowReturn
+gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
+    IplImage * img)
+{
+  GstFaceDetect *filter = GST_FACE_DETECT (base);
+  GstOpencvAsyncFrame frame;
+  GArray *faces = NULL;
+
+  if (filter->async && !filter->worker) {
+    filter->worker = gst_opencv_async_new ("facedetect",
+        gst_face_detect_async_detect, filter);
+    if (!filter->worker)
+      GST_WARNING_OBJECT (filter, "detecting synchronously");
+  }
+
+  if (filter->async && filter->worker) {
+    gst_opencv_async_frame_init (&frame, &GST_BASE_TRANSFORM_CAST (filter)->
+        segment, buf, filter->downscale);
+    gst_opencv_async_push (filter->worker, img, &frame, filter->max_rate);
+
+    GST_OBJECT_LOCK (filter);
+    if (filter->results)
+      faces = g_array_ref (filter->results);
+    GST_OBJECT_UNLOCK (filter);
+  } else {
+    g_mutex_lock (&filter->detect_lock);
+    if (filter->cvFaceDetect) {
+      cvCvtColor (img, filter->cvGray, CV_RGB2GRAY);
+      faces = gst_face_detect_detect (filter, filter->cvGray,
+          filter->cvStorage, 1);
     }
+    g_mutex_unlock (&filter->detect_lock);
 
-    if (post_msg) {
-      gst_structure_set_value ((GstStructure *) gst_message_get_structure (msg),
-          "faces", &facelist);
-      g_value_unset (&facelist);
-      gst_element_post_message (GST_ELEMENT (filter), msg);
+    if (faces) {
+      gst_opencv_async_frame_init (&frame,
+          &GST_BASE_TRANSFORM_CAST (filter)->segment, buf, 1);
+      gst_face_detect_post_results (filter, faces, &frame);
     }
   }
 
+  if (faces) {
+    gst_face_detect_apply_results (filter, buf, img, faces);
+    g_array_unref (faces);
+  }
+
   return GST_FLOW_OK;
 }
 
+static gboolean
+gst_face_detect_stop (GstBaseTransform * trans)
+{
+  GstFaceDetect *filter = GST_FACE_DETECT (trans);
+
+  if (filter->worker) {
+    gst_opencv_async_free (filter->worker);
+    filter->worker = NULL;
+  }
+  if (filter->cvAsyncGray)
+    cvReleaseImage (&filter->cvAsyncGray);
+  if (filter->cvAsyncStorage)
+    cvReleaseMemStorage (&filter->cvAsyncStorage);
+  if (filter->results) {
+    g_array_unref (filter->results);
+    filter->results = NULL;
+  }
+  filter->face_detected = FALSE;
+
+  return TRUE;
+}
+
 
 static CvHaarClassifierCascade *
 gst_face_detect_load_profile (GstFaceDetect * filter, gchar * profile)
@@ -51,6 +51,7 @@
 #include <gst/gst.h>
 #include <opencv2/core/version.hpp>
 #include "gstopencvvideofilter.h"
+#include "gstopencvasync.h"
 
 #if (CV_MAJOR_VERSION >= 2) && (CV_MINOR_VERSION >= 2)
 #include <opencv2/objdetect/objdetect.hpp>
@@ -112,6 +113,19 @@ struct _GstFaceDetect
   CvHaarClassifierCascade *cvMouthDetect;
   CvHaarClassifierCascade *cvEyesDetect;
   CvMemStorage *cvStorage;
+  /* held while the cascades are used or replaced */
+  GMutex detect_lock;
+
+  gboolean async;
+  gdouble max_rate;
+  gint downscale;
+  GstOpencvAsync *worker;
+  /* only used by the worker thread */
+  IplImage *cvAsyncGray;
+  CvMemStorage *cvAsyncStorage;
+  /* latest GstFaceDetectFace results of the worker, protected by the
+   * object lock */
+  GArray *results;
 };
 
 struct _GstFaceDetectClass
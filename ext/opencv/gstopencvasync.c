@@ -0,0 +1,211 @@
+/* GStreamer
+ *
+ * gstopencvasync.c: runs image analysis on a worker thread
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Analysis elements that are slower than the frame rate hand a copy of
+ * the frame to a worker thread and let the video continue. Only the most
+ * recent frame is kept: a frame pushed while the worker is busy replaces
+ * the one still waiting, so results lag by at most one analysis run. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstopencvasync.h"
+#include <opencv2/imgproc/imgproc_c.h>
+
+GST_DEBUG_CATEGORY_STATIC (gst_opencv_async_debug);
+#define GST_CAT_DEFAULT gst_opencv_async_debug
+
+struct _GstOpencvAsync
+{
+  GThread *thread;
+  GMutex lock;
+  GCond cond;
+  gboolean running;
+
+  GstOpencvAsyncFunc func;
+  gpointer user_data;
+
+  /* protected by lock */
+  IplImage *pending;
+  IplImage *spare;
+  gboolean have_pending;
+  GstOpencvAsyncFrame pending_frame;
+  GstClockTime last_running_time;
+};
+
+static gpointer
+gst_opencv_async_thread (gpointer data)
+{
+  GstOpencvAsync *async = (GstOpencvAsync *) data;
+  GstOpencvAsyncFrame frame;
+  IplImage *image;
+
+  g_mutex_lock (&async->lock);
+  while (async->running) {
+    if (!async->have_pending) {
+      g_cond_wait (&async->cond, &async->lock);
+      continue;
+    }
+
+    /* Take the pending image, the next push fills the spare one */
+    image = async->pending;
+    async->pending = NULL;
+    async->have_pending = FALSE;
+    frame = async->pending_frame;
+    g_mutex_unlock (&async->lock);
+
+    async->func (image, &frame, async->user_data);
+
+    g_mutex_lock (&async->lock);
+    if (async->spare == NULL)
+      async->spare = image;
+    else
+      cvReleaseImage (&image);
+  }
+  g_mutex_unlock (&async->lock);
+
+  return NULL;
+}
+
+GstOpencvAsync *
+gst_opencv_async_new (const gchar * name, GstOpencvAsyncFunc func,
+    gpointer user_data)
+{
+  static gsize debug_init = 0;
+  GstOpencvAsync *async;
+  GError *err = NULL;
+
+  if (g_once_init_enter (&debug_init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_opencv_async_debug, "opencvasync", 0,
+        "OpenCV worker threads");
+    g_once_init_leave (&debug_init, 1);
+  }
+
+  async = g_slice_new0 (GstOpencvAsync);
+  g_mutex_init (&async->lock);
+  g_cond_init (&async->cond);
+  async->func = func;
+  async->user_data = user_data;
+  async->running = TRUE;
+  async->last_running_time = GST_CLOCK_TIME_NONE;
+
+  async->thread = g_thread_try_new (name, gst_opencv_async_thread, async,
+      &err);
+  if (!async->thread) {
+    GST_WARNING ("Could not start worker thread: %s", err->message);
+    g_clear_error (&err);
+    g_mutex_clear (&async->lock);
+    g_cond_clear (&async->cond);
+    g_slice_free (GstOpencvAsync, async);
+    return NULL;
+  }
+
+  return async;
+}
+
+/* Stops the worker, waiting for a running analysis to finish */
+void
+gst_opencv_async_free (GstOpencvAsync * async)
+{
+  g_mutex_lock (&async->lock);
+  async->running = FALSE;
+  g_cond_signal (&async->cond);
+  g_mutex_unlock (&async->lock);
+
+  g_thread_join (async->thread);
+
+  if (async->pending)
+    cvReleaseImage (&async->pending);
+  if (async->spare)
+    cvReleaseImage (&async->spare);
+  g_mutex_clear (&async->lock);
+  g_cond_clear (&async->cond);
+  g_slice_free (GstOpencvAsync, async);
+}
+
+void
+gst_opencv_async_frame_init (GstOpencvAsyncFrame * frame,
+    const GstSegment * segment, GstBuffer * buf, gint downscale)
+{
+  frame->timestamp = GST_BUFFER_TIMESTAMP (buf);
+  frame->duration = GST_BUFFER_DURATION (buf);
+  frame->running_time = gst_segment_to_running_time (segment,
+      GST_FORMAT_TIME, frame->timestamp);
+  frame->stream_time = gst_segment_to_stream_time (segment,
+      GST_FORMAT_TIME, frame->timestamp);
+  frame->downscale = MAX (downscale, 1);
+}
+
+/* Hands a copy of @image, shrunk by frame->downscale, to the worker.
+ * Frames closer than 1 / @max_rate seconds in running time to the last
+ * accepted one are skipped, 0 accepts every frame. Returns FALSE if the
+ * frame was skipped. */
+gboolean
+gst_opencv_async_push (GstOpencvAsync * async, IplImage * image,
+    const GstOpencvAsyncFrame * frame, gdouble max_rate)
+{
+  CvSize size;
+  IplImage *dest;
+
+  g_mutex_lock (&async->lock);
+
+  if (max_rate > 0 && GST_CLOCK_TIME_IS_VALID (frame->running_time)
+      && GST_CLOCK_TIME_IS_VALID (async->last_running_time)
+      && frame->running_time >= async->last_running_time
+      && frame->running_time - async->last_running_time <
+      (GstClockTime) (GST_SECOND / max_rate)) {
+    g_mutex_unlock (&async->lock);
+    return FALSE;
+  }
+  async->last_running_time = frame->running_time;
+
+  size = cvSize (MAX (image->width / frame->downscale, 1),
+      MAX (image->height / frame->downscale, 1));
+
+  /* Reuse the image still waiting, it is replaced by this frame */
+  dest = async->pending ? async->pending : async->spare;
+  if (dest == async->spare)
+    async->spare = NULL;
+  async->pending = NULL;
+
+  if (dest && (dest->width != size.width || dest->height != size.height
+          || dest->nChannels != image->nChannels
+          || dest->depth != image->depth))
+    cvReleaseImage (&dest);
+  if (!dest)
+    dest = cvCreateImage (size, image->depth, image->nChannels);
+
+  if (frame->downscale > 1)
+    cvResize (image, dest, CV_INTER_AREA);
+  else
+    cvCopy (image, dest, NULL);
+
+  if (async->have_pending)
+    GST_LOG ("worker busy, replacing pending frame");
+
+  async->pending = dest;
+  async->pending_frame = *frame;
+  async->have_pending = TRUE;
+  g_cond_signal (&async->cond);
+  g_mutex_unlock (&async->lock);
+
+  return TRUE;
+}
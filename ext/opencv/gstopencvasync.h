@@ -0,0 +1,59 @@
+/* GStreamer
+ *
+ * gstopencvasync.h: runs image analysis on a worker thread
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_OPENCV_ASYNC__
+#define __GST_OPENCV_ASYNC__
+
+#include <gst/gst.h>
+#include <opencv2/core/core_c.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstOpencvAsync GstOpencvAsync;
+typedef struct _GstOpencvAsyncFrame GstOpencvAsyncFrame;
+
+/* Timing of the buffer an image was taken from, so that results can be
+ * reported against the source frame. @downscale is the factor the image
+ * was shrunk by before it was handed to the worker. */
+struct _GstOpencvAsyncFrame
+{
+  GstClockTime timestamp;
+  GstClockTime duration;
+  GstClockTime running_time;
+  GstClockTime stream_time;
+  gint downscale;
+};
+
+typedef void (*GstOpencvAsyncFunc) (IplImage * image,
+    const GstOpencvAsyncFrame * frame, gpointer user_data);
+
+GstOpencvAsync *gst_opencv_async_new (const gchar * name,
+    GstOpencvAsyncFunc func, gpointer user_data);
+void gst_opencv_async_free (GstOpencvAsync * async);
+
+void gst_opencv_async_frame_init (GstOpencvAsyncFrame * frame,
+    const GstSegment * segment, GstBuffer * buf, gint downscale);
+
+gboolean gst_opencv_async_push (GstOpencvAsync * async, IplImage * image,
+    const GstOpencvAsyncFrame * frame, gdouble max_rate);
+
+G_END_DECLS
+
+#endif /* __GST_OPENCV_ASYNC__ */
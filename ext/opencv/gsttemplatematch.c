@@ -72,6 +72,9 @@ GST_DEBUG_CATEGORY_STATIC (gst_template_match_debug);
 #define GST_CAT_DEFAULT gst_template_match_debug
 
 #define DEFAULT_METHOD (3)
+#define DEFAULT_ASYNC FALSE
+#define DEFAULT_MAX_RATE 0.0
+#define DEFAULT_DOWNSCALE 1
 
 /* Filter signals and args */
 enum
@@ -86,6 +89,9 @@ enum
   PROP_METHOD,
   PROP_TEMPLATE,
   PROP_DISPLAY,
+  PROP_ASYNC,
+  PROP_MAX_RATE,
+  PROP_DOWNSCALE
 };
 
 /* the capabilities of the inputs and outputs.
@@ -114,11 +120,14 @@ static gboolean gst_template_match_handle_sink_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
 static GstFlowReturn gst_template_match_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buf);
+static GstStateChangeReturn gst_template_match_change_state (GstElement *
+    element, GstStateChange transition);
 
 static void gst_template_match_load_template (GstTemplateMatch * filter,
     gchar * template);
 static void gst_template_match_match (IplImage * input, IplImage * template,
     IplImage * dist_image, double *best_res, CvPoint * best_pos, int method);
+static void gst_template_match_stop_worker (GstTemplateMatch * filter);
 
 
 
@@ -135,6 +144,9 @@ gst_template_match_class_init (GstTemplateMatchClass * klass)
   gobject_class->set_property = gst_template_match_set_property;
   gobject_class->get_property = gst_template_match_get_property;
 
+  element_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_template_match_change_state);
+
   g_object_class_install_property (gobject_class, PROP_METHOD,
       g_param_spec_int ("method", "Method",
           "Specifies the way the template must be compared with image regions. 0=SQDIFF, 1=SQDIFF_NORMED, 2=CCOR, 3=CCOR_NORMED, 4=CCOEFF, 5=CCOEFF_NORMED.",
@@ -146,6 +158,48 @@ gst_template_match_class_init (GstTemplateMatchClass * klass)
       g_param_spec_boolean ("display", "Display",
           "Sets whether the detected template should be highlighted in the output",
           TRUE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstTemplateMatch:async:
+   *
+   * Match the template on a separate thread. Frames pass through at full
+   * rate while the worker matches the most recent frame it was given, and
+   * every frame is highlighted with the latest result. Bus messages carry
+   * the timestamps of the frame the match ran on.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_ASYNC,
+      g_param_spec_boolean ("async", "Async",
+          "Match the template on a separate thread without holding back "
+          "the video", DEFAULT_ASYNC,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstTemplateMatch:max-rate:
+   *
+   * Maximum number of matches per second in async mode, 0 matches as
+   * often as the worker thread allows.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_RATE,
+      g_param_spec_double ("max-rate", "Maximum rate",
+          "Maximum number of matches per second in async mode "
+          "(0 = unlimited)", 0.0, G_MAXDOUBLE, DEFAULT_MAX_RATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstTemplateMatch:downscale:
+   *
+   * Factor by which frames and the template are shrunk before matching in
+   * async mode. Positions are reported in coordinates of the original
+   * frame.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_DOWNSCALE,
+      g_param_spec_int ("downscale", "Downscale",
+          "Factor by which frames are shrunk before matching in async mode",
+          1, 16, DEFAULT_DOWNSCALE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (element_class,
       "templatematch",
@@ -185,6 +239,10 @@ gst_template_match_init (GstTemplateMatch * filter)
   filter->cvDistImage = NULL;
   filter->cvImage = NULL;
   filter->method = DEFAULT_METHOD;
+  filter->async = DEFAULT_ASYNC;
+  filter->max_rate = DEFAULT_MAX_RATE;
+  filter->downscale = DEFAULT_DOWNSCALE;
+  gst_segment_init (&filter->segment, GST_FORMAT_TIME);
 }
 
 static void
@@ -226,6 +284,21 @@ gst_template_match_set_property (GObject * object, guint prop_id,
       filter->display = g_value_get_boolean (value);
       GST_OBJECT_UNLOCK (filter);
       break;
+    case PROP_ASYNC:
+      GST_OBJECT_LOCK (filter);
+      filter->async = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MAX_RATE:
+      GST_OBJECT_LOCK (filter);
+      filter->max_rate = g_value_get_double (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_DOWNSCALE:
+      GST_OBJECT_LOCK (filter);
+      filter->downscale = g_value_get_int (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -248,6 +321,15 @@ gst_template_match_get_property (GObject * object, guint prop_id,
     case PROP_DISPLAY:
       g_value_set_boolean (value, filter->display);
       break;
+    case PROP_ASYNC:
+      g_value_set_boolean (value, filter->async);
+      break;
+    case PROP_MAX_RATE:
+      g_value_set_double (value, filter->max_rate);
+      break;
+    case PROP_DOWNSCALE:
+      g_value_set_int (value, filter->downscale);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -279,8 +361,19 @@ gst_template_match_handle_sink_event (GstPad * pad, GstObject * parent,
       filter->cvImage =
           cvCreateImageHeader (cvSize (info.width, info.height), IPL_DEPTH_8U,
           3);
+
+      /* Results of the worker refer to the previous frame size */
+      GST_OBJECT_LOCK (filter);
+      filter->have_result = FALSE;
+      GST_OBJECT_UNLOCK (filter);
       break;
     }
+    case GST_EVENT_SEGMENT:
+      gst_event_copy_segment (event, &filter->segment);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_segment_init (&filter->segment, GST_FORMAT_TIME);
+      break;
     default:
       break;
   }
@@ -298,6 +391,8 @@ gst_template_match_finalize (GObject * object)
   GstTemplateMatch *filter;
   filter = GST_TEMPLATE_MATCH (object);
 
+  gst_template_match_stop_worker (filter);
+
   g_free (filter->template);
   if (filter->cvImage) {
     cvReleaseImageHeader (&filter->cvImage);
@@ -312,6 +407,155 @@ gst_template_match_finalize (GObject * object)
   G_OBJECT_CLASS (gst_template_match_parent_class)->finalize (object);
 }
 
+static GstMessage *
+gst_template_match_message_new (GstTemplateMatch * filter,
+    const GstOpencvAsyncFrame * frame, CvPoint * best_pos, gint width,
+    gint height, double best_res)
+{
+  GstStructure *s;
+
+  s = gst_structure_new ("template_match",
+      "x", G_TYPE_UINT, best_pos->x,
+      "y", G_TYPE_UINT, best_pos->y,
+      "width", G_TYPE_UINT, width,
+      "height", G_TYPE_UINT, height,
+      "result", G_TYPE_DOUBLE, best_res,
+      "timestamp", G_TYPE_UINT64, frame->timestamp,
+      "stream-time", G_TYPE_UINT64, frame->stream_time,
+      "running-time", G_TYPE_UINT64, frame->running_time,
+      "duration", G_TYPE_UINT64, frame->duration, NULL);
+
+  return gst_message_new_element (GST_OBJECT (filter), s);
+}
+
+/* Must be called with the object lock */
+static void
+gst_template_match_draw (GstTemplateMatch * filter, CvPoint best_pos,
+    double best_res)
+{
+  CvPoint corner = best_pos;
+  CvScalar color;
+
+  if (filter->method == CV_TM_SQDIFF_NORMED
+      || filter->method == CV_TM_CCORR_NORMED
+      || filter->method == CV_TM_CCOEFF_NORMED) {
+    /* Yellow growing redder as match certainty approaches 1.0.  This can
+       only be applied with method == *_NORMED as the other match methods
+       aren't normalized to be in range 0.0 - 1.0 */
+    color = CV_RGB (255, 255 - pow (255, best_res), 32);
+  } else {
+    color = CV_RGB (255, 32, 32);
+  }
+
+  corner.x += filter->cvTemplateImage->width;
+  corner.y += filter->cvTemplateImage->height;
+  cvRectangle (filter->cvImage, best_pos, corner, color, 3, 8, 0);
+}
+
+/* Runs on the worker thread in async mode, matches a copy of the template
+ * shrunk by the same factor as @image */
+static void
+gst_template_match_async_match (IplImage * image,
+    const GstOpencvAsyncFrame * frame, gpointer user_data)
+{
+  GstTemplateMatch *filter = GST_TEMPLATE_MATCH (user_data);
+  CvPoint best_pos;
+  double best_res;
+  gint method, width, height;
+  CvSize dist_size;
+  GstMessage *m;
+
+  GST_OBJECT_LOCK (filter);
+  if (!filter->cvTemplateImage) {
+    GST_OBJECT_UNLOCK (filter);
+    return;
+  }
+  if (!filter->cvAsyncTemplate
+      || filter->async_template_cookie != filter->template_cookie
+      || filter->async_template_scale != frame->downscale) {
+    if (filter->cvAsyncTemplate)
+      cvReleaseImage (&filter->cvAsyncTemplate);
+    filter->cvAsyncTemplate =
+        cvCreateImage (cvSize (MAX (filter->cvTemplateImage->width /
+                frame->downscale, 1),
+            MAX (filter->cvTemplateImage->height / frame->downscale, 1)),
+        filter->cvTemplateImage->depth, filter->cvTemplateImage->nChannels);
+    cvResize (filter->cvTemplateImage, filter->cvAsyncTemplate, CV_INTER_AREA);
+    filter->async_template_cookie = filter->template_cookie;
+    filter->async_template_scale = frame->downscale;
+  }
+  method = filter->method;
+  width = filter->cvTemplateImage->width;
+  height = filter->cvTemplateImage->height;
+  GST_OBJECT_UNLOCK (filter);
+
+  if (filter->cvAsyncTemplate->width > image->width
+      || filter->cvAsyncTemplate->height > image->height) {
+    GST_WARNING_OBJECT (filter, "Template Image is larger than input image");
+    return;
+  }
+
+  dist_size = cvSize (image->width - filter->cvAsyncTemplate->width + 1,
+      image->height - filter->cvAsyncTemplate->height + 1);
+  if (filter->cvAsyncDist && (filter->cvAsyncDist->width != dist_size.width
+          || filter->cvAsyncDist->height != dist_size.height))
+    cvReleaseImage (&filter->cvAsyncDist);
+  if (!filter->cvAsyncDist)
+    filter->cvAsyncDist = cvCreateImage (dist_size, IPL_DEPTH_32F, 1);
+
+  gst_template_match_match (image, filter->cvAsyncTemplate,
+      filter->cvAsyncDist, &best_res, &best_pos, method);
+  best_pos.x *= frame->downscale;
+  best_pos.y *= frame->downscale;
+
+  m = gst_template_match_message_new (filter, frame, &best_pos, width, height,
+      best_res);
+  gst_element_post_message (GST_ELEMENT (filter), m);
+
+  GST_OBJECT_LOCK (filter);
+  filter->best_pos = best_pos;
+  filter->best_res = best_res;
+  filter->have_result = TRUE;
+  GST_OBJECT_UNLOCK (filter);
+}
+
+static void
+gst_template_match_stop_worker (GstTemplateMatch * filter)
+{
+  if (filter->worker) {
+    gst_opencv_async_free (filter->worker);
+    filter->worker = NULL;
+  }
+  if (filter->cvAsyncTemplate)
+    cvReleaseImage (&filter->cvAsyncTemplate);
+  if (filter->cvAsyncDist)
+    cvReleaseImage (&filter->cvAsyncDist);
+  filter->have_result = FALSE;
+}
+
+static GstStateChangeReturn
+gst_template_match_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstTemplateMatch *filter = GST_TEMPLATE_MATCH (element);
+  GstStateChangeReturn ret;
+
+  ret =
+      GST_ELEMENT_CLASS (gst_template_match_parent_class)->change_state
+      (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_template_match_stop_worker (filter);
+      gst_segment_init (&filter->segment, GST_FORMAT_TIME);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
 /* chain function
  * this function does the actual processing
  */
@@ -323,6 +567,10 @@ gst_template_match_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   double best_res;
   GstMapInfo info;
   GstMessage *m = NULL;
+  GstOpencvAsyncFrame frame;
+  gboolean async;
+  gdouble max_rate;
+  gint downscale;
 
   filter = GST_TEMPLATE_MATCH (parent);
 
@@ -335,6 +583,32 @@ gst_template_match_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   gst_buffer_map (buf, &info, GST_MAP_READWRITE);
   filter->cvImage->imageData = (char *) info.data;
 
+  GST_OBJECT_LOCK (filter);
+  async = filter->async;
+  max_rate = filter->max_rate;
+  downscale = filter->downscale;
+  GST_OBJECT_UNLOCK (filter);
+
+  if (async && !filter->worker) {
+    filter->worker = gst_opencv_async_new ("templatematch",
+        gst_template_match_async_match, filter);
+    if (!filter->worker)
+      GST_WARNING_OBJECT (filter, "matching synchronously");
+  }
+
+  if (async && filter->worker) {
+    gst_opencv_async_frame_init (&frame, &filter->segment, buf, downscale);
+    gst_opencv_async_push (filter->worker, filter->cvImage, &frame, max_rate);
+
+    GST_OBJECT_LOCK (filter);
+    if (filter->have_result && filter->cvTemplateImage && filter->display)
+      gst_template_match_draw (filter, filter->best_pos, filter->best_res);
+    GST_OBJECT_UNLOCK (filter);
+
+    gst_buffer_unmap (buf, &info);
+    return gst_pad_push (filter->srcpad, buf);
+  }
+
   GST_OBJECT_LOCK (filter);
   if (filter->cvTemplateImage && !filter->cvDistImage) {
     if (filter->cvTemplateImage->width > filter->cvImage->width) {
@@ -358,44 +632,21 @@ gst_template_match_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     }
   }
   if (filter->cvTemplateImage && filter->cvDistImage) {
-    GstStructure *s;
-
     gst_template_match_match (filter->cvImage, filter->cvTemplateImage,
         filter->cvDistImage, &best_res, &best_pos, filter->method);
 
-    s = gst_structure_new ("template_match",
-        "x", G_TYPE_UINT, best_pos.x,
-        "y", G_TYPE_UINT, best_pos.y,
-        "width", G_TYPE_UINT, filter->cvTemplateImage->width,
-        "height", G_TYPE_UINT, filter->cvTemplateImage->height,
-        "result", G_TYPE_DOUBLE, best_res, NULL);
-
-    m = gst_message_new_element (GST_OBJECT (filter), s);
-
-    if (filter->display) {
-      CvPoint corner = best_pos;
-      CvScalar color;
-      if (filter->method == CV_TM_SQDIFF_NORMED
-          || filter->method == CV_TM_CCORR_NORMED
-          || filter->method == CV_TM_CCOEFF_NORMED) {
-        /* Yellow growing redder as match certainty approaches 1.0.  This can
-           only be applied with method == *_NORMED as the other match methods
-           aren't normalized to be in range 0.0 - 1.0 */
-        color = CV_RGB (255, 255 - pow (255, best_res), 32);
-      } else {
-        color = CV_RGB (255, 32, 32);
-      }
-
-      buf = gst_buffer_make_writable (buf);
-
-      corner.x += filter->cvTemplateImage->width;
-      corner.y += filter->cvTemplateImage->height;
-      cvRectangle (filter->cvImage, best_pos, corner, color, 3, 8, 0);
-    }
+    gst_opencv_async_frame_init (&frame, &filter->segment, buf, 1);
+    m = gst_template_match_message_new (filter, &frame, &best_pos,
+        filter->cvTemplateImage->width, filter->cvTemplateImage->height,
+        best_res);
 
+    if (filter->display)
+      gst_template_match_draw (filter, best_pos, best_res);
   }
   GST_OBJECT_UNLOCK (filter);
 
+  gst_buffer_unmap (buf, &info);
+
   if (m) {
     gst_element_post_message (GST_ELEMENT (filter), m);
   }
@@ -454,6 +705,9 @@ gst_template_match_load_template (GstTemplateMatch * filter, gchar * template)
   oldDistImage = filter->cvDistImage;
   /* This will be recreated in the chain function as required: */
   filter->cvDistImage = NULL;
+  /* ... and the worker's copy of the template */
+  filter->template_cookie++;
+  filter->have_result = FALSE;
   GST_OBJECT_UNLOCK (filter);
 
   cvReleaseImage (&oldDistImage);
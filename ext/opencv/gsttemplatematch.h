@@ -47,6 +47,7 @@
 #define __GST_TEMPLATE_MATCH_H__
 
 #include <gst/gst.h>
+#include "gstopencvasync.h"
 
 #ifdef HAVE_HIGHGUI_H
 #include <highgui.h>            // includes highGUI definitions
@@ -82,6 +83,23 @@ struct _GstTemplateMatch
   gchar *template;
 
   IplImage *cvImage, *cvGray, *cvTemplateImage, *cvDistImage;
+
+  GstSegment segment;
+
+  gboolean async;
+  gdouble max_rate;
+  gint downscale;
+  GstOpencvAsync *worker;
+  /* bumped whenever cvTemplateImage is replaced */
+  guint template_cookie;
+  /* only used by the worker thread */
+  IplImage *cvAsyncTemplate, *cvAsyncDist;
+  guint async_template_cookie;
+  gint async_template_scale;
+  /* latest result of the worker, protected by the object lock */
+  gboolean have_result;
+  CvPoint best_pos;
+  double best_res;
 };
 
 struct _GstTemplateMatchClass
@@ -35,6 +35,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideodecoder.h>
+#include <gst/video/gstvideopool.h>
 #include <string.h>             /* for memcpy */
 
 
@@ -77,6 +78,8 @@ struct _GstOpenh264DecPrivate
   ISVCDecoder *decoder;
   GstVideoCodecState *input_state;
   guint width, height;
+  /* strides of the decoded luma and chroma planes */
+  gint stride[2];
 };
 
 /* pad templates */
@@ -219,6 +222,7 @@ gst_openh264dec_stop (GstVideoDecoder * decoder)
     openh264dec->priv->input_state = NULL;
   }
   openh264dec->priv->width = openh264dec->priv->height = 0;
+  openh264dec->priv->stride[0] = openh264dec->priv->stride[1] = 0;
 
   return TRUE;
 }
@@ -267,6 +271,7 @@ gst_openh264dec_handle_frame (GstVideoDecoder * decoder,
   guint i;
   guint8 *p;
   guint row_stride, component_width, component_height, src_width, row;
+  gint *src_strides;
 
   if (frame) {
     if (!gst_buffer_map (frame->input_buffer, &map_info, GST_MAP_READ)) {
@@ -330,15 +335,21 @@ gst_openh264dec_handle_frame (GstVideoDecoder * decoder,
 
   actual_width = dst_buf_info.UsrData.sSystemBuffer.iWidth;
   actual_height = dst_buf_info.UsrData.sSystemBuffer.iHeight;
+  src_strides = dst_buf_info.UsrData.sSystemBuffer.iStride;
 
+  /* The strides are part of the negotiation, see decide_allocation() */
   if (!gst_pad_has_current_caps (GST_VIDEO_DECODER_SRC_PAD (openh264dec))
       || actual_width != openh264dec->priv->width
-      || actual_height != openh264dec->priv->height) {
+      || actual_height != openh264dec->priv->height
+      || src_strides[0] != openh264dec->priv->stride[0]
+      || src_strides[1] != openh264dec->priv->stride[1]) {
     state =
         gst_video_decoder_set_output_state (decoder, GST_VIDEO_FORMAT_I420,
         actual_width, actual_height, openh264dec->priv->input_state);
     openh264dec->priv->width = actual_width;
     openh264dec->priv->height = actual_height;
+    openh264dec->priv->stride[0] = src_strides[0];
+    openh264dec->priv->stride[1] = src_strides[1];
 
     if (!gst_video_decoder_negotiate (decoder)) {
       GST_ERROR_OBJECT (openh264dec,
@@ -371,10 +382,15 @@ gst_openh264dec_handle_frame (GstVideoDecoder * decoder,
     row_stride = GST_VIDEO_FRAME_COMP_STRIDE (&video_frame, i);
     component_width = GST_VIDEO_FRAME_COMP_WIDTH (&video_frame, i);
     component_height = GST_VIDEO_FRAME_COMP_HEIGHT (&video_frame, i);
-    src_width =
-        i <
-        1 ? dst_buf_info.UsrData.sSystemBuffer.
-        iStride[0] : dst_buf_info.UsrData.sSystemBuffer.iStride[1];
+    src_width = i < 1 ? src_strides[0] : src_strides[1];
+
+    if (row_stride == src_width) {
+      /* Same layout as the decoder's picture, copy the plane at once */
+      memcpy (p, yuvdata[i],
+          row_stride * (component_height - 1) + component_width);
+      continue;
+    }
+
     for (row = 0; row < component_height; row++) {
       memcpy (p, yuvdata[i], component_width);
       p += row_stride;
@@ -407,6 +423,7 @@ gst_openh264dec_finish (GstVideoDecoder * decoder)
 static gboolean
 gst_openh264dec_decide_allocation (GstVideoDecoder * decoder, GstQuery * query)
 {
+  GstOpenh264Dec *openh264dec = GST_OPENH264DEC (decoder);
   GstVideoCodecState *state;
   GstBufferPool *pool;
   guint size, min, max;
@@ -424,6 +441,21 @@ gst_openh264dec_decide_allocation (GstVideoDecoder * decoder, GstQuery * query)
   if (gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL)) {
     gst_buffer_pool_config_add_option (config,
         GST_BUFFER_POOL_OPTION_VIDEO_META);
+
+    /* Pad the rows to the strides of the decoder's pictures so that
+     * each plane can be copied with a single memcpy */
+    if (gst_buffer_pool_has_option (pool, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT)
+        && openh264dec->priv->stride[0] >
+        GST_VIDEO_INFO_WIDTH (&state->info)) {
+      GstVideoAlignment align;
+
+      gst_video_alignment_reset (&align);
+      align.padding_right =
+          openh264dec->priv->stride[0] - GST_VIDEO_INFO_WIDTH (&state->info);
+      gst_buffer_pool_config_add_option (config,
+          GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+      gst_buffer_pool_config_set_video_alignment (config, &align);
+    }
   }
 
   gst_buffer_pool_set_config (pool, config);
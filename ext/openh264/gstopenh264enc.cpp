@@ -211,6 +211,7 @@ enum
   PROP_SLICE_MODE,
   PROP_NUM_SLICES,
   PROP_COMPLEXITY,
+  PROP_STATS,
   N_PROPERTIES
 };
 
@@ -238,6 +239,13 @@ struct _GstOpenh264EncPrivate
   SliceModeEnum slice_mode;
   guint num_slices;
   ECOMPLEXITY_MODE complexity;
+  gboolean byte_stream;
+
+  /* protected by the object lock */
+  guint64 encoded_frames;
+  GstClockTime last_encode_time;
+  GstClockTime total_encode_time;
+  GstClockTime max_encode_time;
 };
 
 /* pad templates */
@@ -254,7 +262,7 @@ GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS
-    ("video/x-h264, stream-format=(string)\"avc\", alignment=(string)\"au\", profile=(string)\"baseline\"")
+    ("video/x-h264, stream-format=(string){ avc, byte-stream }, alignment=(string)au, profile=(string)baseline")
     );
 
 /* class initialization */
@@ -381,6 +389,30 @@ gst_openh264enc_class_init (GstOpenh264EncClass * klass)
       g_param_spec_enum ("complexity", "Complexity / quality / speed tradeoff", "Complexity",
           GST_TYPE_OPENH264ENC_COMPLEXITY, DEFAULT_COMPLEXITY,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  /**
+   * GstOpenh264Enc:stats:
+   *
+   * Encoding statistics since the encoder was started, in a structure named
+   * application/x-openh264enc-stats with the fields
+   *
+   * "encoded-frames" G_TYPE_UINT64: number of frames passed to the encoder
+   * "last-encode-time" G_TYPE_UINT64: time spent encoding the last frame, in
+   * nanoseconds
+   * "average-encode-time" G_TYPE_UINT64: average time spent encoding one
+   * frame, in nanoseconds
+   * "max-encode-time" G_TYPE_UINT64: longest time spent encoding one frame,
+   * in nanoseconds
+   *
+   * Comparing the encode times with the frame duration shows whether the
+   * multi-thread and slice settings are enough for the stream.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics", "Encoding statistics",
+          GST_TYPE_STRUCTURE,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
@@ -525,6 +557,24 @@ gst_openh264enc_set_property (GObject * object, guint property_id,
   }
 }
 
+static GstStructure *
+gst_openh264enc_get_stats (GstOpenh264Enc * openh264enc)
+{
+  GstOpenh264EncPrivate *priv = openh264enc->priv;
+  GstStructure *s;
+
+  GST_OBJECT_LOCK (openh264enc);
+  s = gst_structure_new ("application/x-openh264enc-stats",
+      "encoded-frames", G_TYPE_UINT64, priv->encoded_frames,
+      "last-encode-time", G_TYPE_UINT64, priv->last_encode_time,
+      "average-encode-time", G_TYPE_UINT64, priv->encoded_frames ?
+      priv->total_encode_time / priv->encoded_frames : 0,
+      "max-encode-time", G_TYPE_UINT64, priv->max_encode_time, NULL);
+  GST_OBJECT_UNLOCK (openh264enc);
+
+  return s;
+}
+
 void
 gst_openh264enc_get_property (GObject * object, guint property_id,
     GValue * value, GParamSpec * pspec)
@@ -594,6 +644,10 @@ gst_openh264enc_get_property (GObject * object, guint property_id,
       g_value_set_enum (value, openh264enc->priv->complexity);
       break;
 
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_openh264enc_get_stats (openh264enc));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -623,6 +677,13 @@ gst_openh264enc_start (GstVideoEncoder * encoder)
   GstOpenh264Enc *openh264enc = GST_OPENH264ENC (encoder);
   GST_DEBUG_OBJECT (openh264enc, "start");
 
+  GST_OBJECT_LOCK (openh264enc);
+  openh264enc->priv->encoded_frames = 0;
+  openh264enc->priv->last_encode_time = 0;
+  openh264enc->priv->total_encode_time = 0;
+  openh264enc->priv->max_encode_time = 0;
+  GST_OBJECT_UNLOCK (openh264enc);
+
   return TRUE;
 }
 
@@ -666,10 +727,10 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
   gint nal_sps_length = 0;
   guchar *nal_pps_data = NULL;
   gint nal_pps_length = 0;
-  guchar *sps_tmp_buf;
   guchar *codec_data_tmp_buf;
   GstBuffer *codec_data;
-  GstCaps *outcaps;
+  GstCaps *outcaps, *allowed_caps;
+  gint i, j;
   GstVideoCodecState *output_state;
   openh264enc->priv->frame_count = 0;
   int video_format = videoFormatI420;
@@ -753,53 +814,97 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
   memset (&bsInfo, 0, sizeof (SFrameBSInfo));
 
   ret = priv->encoder->EncodeParameterSets (&bsInfo);
-
-  nal_sps_data = bsInfo.sLayerInfo[0].pBsBuf + 4;
-  nal_sps_length = bsInfo.sLayerInfo[0].pNalLengthInByte[0] - 4;
-
-  nal_pps_data = bsInfo.sLayerInfo[0].pBsBuf + nal_sps_length + 8;
-  nal_pps_length = bsInfo.sLayerInfo[0].pNalLengthInByte[1] - 4;
-
   if (ret != cmResultSuccess) {
     GST_ELEMENT_ERROR (openh264enc, STREAM, ENCODE,
         ("Could not create headers"), ("Could not create SPS"));
     return FALSE;
   }
 
-  sps_tmp_buf = (guchar *) (g_memdup (nal_sps_data, nal_sps_length));
-
-  codec_data_tmp_buf =
-      (guchar *) g_malloc (5 + 3 + nal_sps_length + 3 + nal_pps_length);
-  codec_data_tmp_buf[0] = 1; /* version 1 */ ;
-  codec_data_tmp_buf[1] = sps_tmp_buf[1];       /* profile */
-  codec_data_tmp_buf[2] = sps_tmp_buf[2];       /* profile constraints */
-  codec_data_tmp_buf[3] = sps_tmp_buf[3];       /* level */
-  codec_data_tmp_buf[4] = 1;    /* NAL length marker length minus one */
-  codec_data_tmp_buf[5] = 1;    /* Number of SPS */
-  GST_WRITE_UINT16_BE (codec_data_tmp_buf + 6, nal_sps_length);
-  memcpy (codec_data_tmp_buf + 8, sps_tmp_buf, nal_sps_length);
-
-  g_free (sps_tmp_buf);
+  /* Every NAL unit is preceded by a 4 byte start code, find the SPS and
+   * PPS by their type instead of relying on their position */
+  for (i = 0; i < bsInfo.iLayerNum; i++) {
+    SLayerBSInfo *layer = &bsInfo.sLayerInfo[i];
+    guchar *data = layer->pBsBuf;
+
+    for (j = 0; j < layer->iNalCount; j++) {
+      switch (data[4] & 0x1f) {
+        case 7:
+          if (!nal_sps_data) {
+            nal_sps_data = data + 4;
+            nal_sps_length = layer->pNalLengthInByte[j] - 4;
+          }
+          break;
+        case 8:
+          if (!nal_pps_data) {
+            nal_pps_data = data + 4;
+            nal_pps_length = layer->pNalLengthInByte[j] - 4;
+          }
+          break;
+        default:
+          break;
+      }
+      data += layer->pNalLengthInByte[j];
+    }
+  }
 
-  codec_data_tmp_buf[8 + nal_sps_length] = 1;   /* Number of PPS */
-  GST_WRITE_UINT16_BE (codec_data_tmp_buf + 8 + nal_sps_length + 1,
-      nal_pps_length);
-  memcpy (codec_data_tmp_buf + 8 + nal_sps_length + 3, nal_pps_data,
-      nal_pps_length);
+  if (!nal_sps_data || !nal_pps_data || nal_sps_length < 4) {
+    GST_ELEMENT_ERROR (openh264enc, STREAM, ENCODE,
+        ("Could not create headers"), ("No SPS or PPS produced"));
+    return FALSE;
+  }
 
   GST_DEBUG_OBJECT (openh264enc, "Got SPS of size %d and PPS of size %d",
       nal_sps_length, nal_pps_length);
 
-  codec_data =
-      gst_buffer_new_wrapped (codec_data_tmp_buf,
-      5 + 3 + nal_sps_length + 3 + nal_pps_length);
-
-  outcaps =
-      gst_caps_copy (gst_static_pad_template_get_caps
-      (&gst_openh264enc_src_template));
-  gst_caps_set_simple (outcaps, "codec_data", GST_TYPE_BUFFER, codec_data,
-      NULL);
-  gst_buffer_unref (codec_data);
+  /* Prefer avc, the parameter sets are repeated in-band for both */
+  priv->byte_stream = FALSE;
+  allowed_caps = gst_pad_get_allowed_caps (GST_VIDEO_ENCODER_SRC_PAD (encoder));
+  if (allowed_caps && !gst_caps_is_empty (allowed_caps)) {
+    GstStructure *s;
+    const gchar *stream_format;
+
+    allowed_caps = gst_caps_make_writable (allowed_caps);
+    allowed_caps = gst_caps_truncate (allowed_caps);
+    s = gst_caps_get_structure (allowed_caps, 0);
+    gst_structure_fixate_field_string (s, "stream-format", "avc");
+    stream_format = gst_structure_get_string (s, "stream-format");
+    if (g_strcmp0 (stream_format, "byte-stream") == 0)
+      priv->byte_stream = TRUE;
+  }
+  if (allowed_caps)
+    gst_caps_unref (allowed_caps);
+
+  outcaps = gst_caps_new_simple ("video/x-h264",
+      "stream-format", G_TYPE_STRING, priv->byte_stream ? "byte-stream" : "avc",
+      "alignment", G_TYPE_STRING, "au",
+      "profile", G_TYPE_STRING, "baseline", NULL);
+
+  if (!priv->byte_stream) {
+    codec_data_tmp_buf =
+        (guchar *) g_malloc (5 + 3 + nal_sps_length + 3 + nal_pps_length);
+    codec_data_tmp_buf[0] = 1; /* version 1 */ ;
+    codec_data_tmp_buf[1] = nal_sps_data[1];    /* profile */
+    codec_data_tmp_buf[2] = nal_sps_data[2];    /* profile constraints */
+    codec_data_tmp_buf[3] = nal_sps_data[3];    /* level */
+    codec_data_tmp_buf[4] = 0xff; /* 4 byte NAL lengths, like the start codes */
+    codec_data_tmp_buf[5] = 0xe1; /* Number of SPS */
+    GST_WRITE_UINT16_BE (codec_data_tmp_buf + 6, nal_sps_length);
+    memcpy (codec_data_tmp_buf + 8, nal_sps_data, nal_sps_length);
+
+    codec_data_tmp_buf[8 + nal_sps_length] = 1; /* Number of PPS */
+    GST_WRITE_UINT16_BE (codec_data_tmp_buf + 8 + nal_sps_length + 1,
+        nal_pps_length);
+    memcpy (codec_data_tmp_buf + 8 + nal_sps_length + 3, nal_pps_data,
+        nal_pps_length);
+
+    codec_data =
+        gst_buffer_new_wrapped (codec_data_tmp_buf,
+        5 + 3 + nal_sps_length + 3 + nal_pps_length);
+
+    gst_caps_set_simple (outcaps, "codec_data", GST_TYPE_BUFFER, codec_data,
+        NULL);
+    gst_buffer_unref (codec_data);
+  }
 
   output_state = gst_video_encoder_set_output_state (encoder, outcaps, state);
   gst_video_codec_state_unref (output_state);
@@ -817,6 +922,75 @@ gst_openh264enc_propose_allocation (GstVideoEncoder * encoder, GstQuery * query)
       (gst_openh264enc_parent_class)->propose_allocation (encoder, query);
 }
 
+static void
+gst_openh264enc_update_stats (GstOpenh264Enc * openh264enc,
+    GstClockTime encode_time)
+{
+  GstOpenh264EncPrivate *priv = openh264enc->priv;
+
+  GST_OBJECT_LOCK (openh264enc);
+  priv->encoded_frames++;
+  priv->last_encode_time = encode_time;
+  priv->total_encode_time += encode_time;
+  priv->max_encode_time = MAX (priv->max_encode_time, encode_time);
+  GST_OBJECT_UNLOCK (openh264enc);
+
+  GST_LOG_OBJECT (openh264enc, "encoded frame in %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (encode_time));
+}
+
+/* Copies all NAL units of all layers into one output buffer, with one copy
+ * per layer since openh264 stores the NAL units of a layer back to back.
+ * For avc the 4 byte start codes are then overwritten with the NAL sizes. */
+static GstBuffer *
+gst_openh264enc_collect_nals (GstOpenh264Enc * openh264enc,
+    SFrameBSInfo * frame_info)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gsize size = 0, offset = 0;
+  gint i, j;
+
+  for (i = 0; i < frame_info->iLayerNum; i++) {
+    SLayerBSInfo *layer = &frame_info->sLayerInfo[i];
+
+    for (j = 0; j < layer->iNalCount; j++)
+      size += layer->pNalLengthInByte[j];
+  }
+
+  buffer =
+      gst_video_encoder_allocate_output_buffer (GST_VIDEO_ENCODER
+      (openh264enc), size);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+
+  for (i = 0; i < frame_info->iLayerNum; i++) {
+    SLayerBSInfo *layer = &frame_info->sLayerInfo[i];
+    gsize layer_size = 0;
+
+    for (j = 0; j < layer->iNalCount; j++)
+      layer_size += layer->pNalLengthInByte[j];
+
+    memcpy (map.data + offset, layer->pBsBuf, layer_size);
+
+    if (openh264enc->priv->byte_stream) {
+      offset += layer_size;
+    } else {
+      for (j = 0; j < layer->iNalCount; j++) {
+        GST_WRITE_UINT32_BE (map.data + offset,
+            layer->pNalLengthInByte[j] - 4);
+        offset += layer->pNalLengthInByte[j];
+      }
+    }
+  }
+
+  gst_buffer_unmap (buffer, &map);
+
+  GST_LOG_OBJECT (openh264enc, "%d layers, %" G_GSIZE_FORMAT " bytes",
+      frame_info->iLayerNum, size);
+
+  return buffer;
+}
+
 static GstFlowReturn
 gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
     GstVideoCodecFrame * frame)
@@ -828,6 +1002,7 @@ gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
   gint ret;
   SFrameBSInfo frame_info;
   gfloat fps;
+  GstClockTime start;
   GstVideoEncoder *base_encoder = GST_VIDEO_ENCODER (openh264enc);
 
   if (frame) {
@@ -891,7 +1066,11 @@ gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
   }
 
   memset (&frame_info, 0, sizeof (SFrameBSInfo));
+  start = gst_util_get_timestamp ();
   ret = openh264enc->priv->encoder->EncodeFrame (src_pic, &frame_info);
+  if (frame)
+    gst_openh264enc_update_stats (openh264enc,
+        gst_util_get_timestamp () - start);
   if (ret != cmResultSuccess) {
     if (frame) {
       gst_video_frame_unmap (&video_frame);
@@ -930,62 +1109,16 @@ gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
   if (!frame) {
     GST_ELEMENT_ERROR (openh264enc, STREAM, ENCODE,
         ("Could not encode frame"), ("openh264enc returned %d", ret));
-    gst_video_codec_frame_unref (frame);
     return GST_FLOW_ERROR;
   }
 
-  SLayerBSInfo *bs_info = &frame_info.sLayerInfo[0];
-  gint nal_size = bs_info->pNalLengthInByte[0] - 4;
-  guchar *nal_sps_data, *nal_pps_data;
-  gint nal_sps_length, nal_pps_length, idr_length, tmp_buf_length;
-
-  if (videoFrameTypeIDR == frame_info.eFrameType) {
-    GstMapInfo map;
-
-    /* sps */
-    nal_sps_data = frame_info.sLayerInfo[0].pBsBuf + 4;
-    nal_sps_length = frame_info.sLayerInfo[0].pNalLengthInByte[0] - 4;
-    /* pps */
-    nal_pps_data = nal_sps_data + frame_info.sLayerInfo[0].pNalLengthInByte[0];
-    nal_pps_length = frame_info.sLayerInfo[0].pNalLengthInByte[1] - 4;
-    /* idr */
-    bs_info = &frame_info.sLayerInfo[1];
-    idr_length = bs_info->pNalLengthInByte[0] - 4;
-
-    tmp_buf_length = nal_sps_length + 2 + nal_pps_length + 2 + idr_length + 2;
-    frame->output_buffer =
-        gst_video_encoder_allocate_output_buffer (encoder, tmp_buf_length);
-    gst_buffer_map (frame->output_buffer, &map, GST_MAP_WRITE);
-
-    GST_WRITE_UINT16_BE (map.data, nal_sps_length);
-    memcpy (map.data + 2, nal_sps_data, nal_sps_length);
-
-    GST_WRITE_UINT16_BE (map.data + nal_sps_length + 2, nal_pps_length);
-    memcpy (map.data + nal_sps_length + 2 + 2, nal_pps_data, nal_pps_length);
-
-    GST_WRITE_UINT16_BE (map.data + nal_sps_length + 2 + nal_pps_length + 2,
-        idr_length);
-    memcpy (map.data + nal_sps_length + 2 + nal_pps_length + 2 + 2,
-        bs_info->pBsBuf + 4, idr_length);
-
-    gst_buffer_unmap (frame->output_buffer, &map);
+  frame->output_buffer =
+      gst_openh264enc_collect_nals (openh264enc, &frame_info);
 
+  if (videoFrameTypeIDR == frame_info.eFrameType)
     GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (frame);
-  } else {
-    GstMapInfo map;
-
-    tmp_buf_length = nal_size + 2;
-    frame->output_buffer =
-        gst_video_encoder_allocate_output_buffer (encoder, tmp_buf_length);
-    gst_buffer_map (frame->output_buffer, &map, GST_MAP_WRITE);
-
-    GST_WRITE_UINT16_BE (map.data, nal_size);
-    memcpy (map.data + 2, bs_info->pBsBuf + 4, nal_size);
-
-    gst_buffer_unmap (frame->output_buffer, &map);
-
+  else
     GST_VIDEO_CODEC_FRAME_UNSET_SYNC_POINT (frame);
-  }
 
   GST_LOG_OBJECT (openh264enc, "openh264 picture %scoded OK!",
       (ret != cmResultSuccess) ? "NOT " : "");
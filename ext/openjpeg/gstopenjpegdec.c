@@ -25,14 +25,35 @@
 #endif
 
 #include "gstopenjpegdec.h"
+#include "gstopenjpegpack.h"
 
 #include <string.h>
 
 GST_DEBUG_CATEGORY_STATIC (gst_openjpeg_dec_debug);
 #define GST_CAT_DEFAULT gst_openjpeg_dec_debug
 
+enum
+{
+  PROP_0,
+  PROP_MAX_THREADS
+};
+
+#define DEFAULT_MAX_THREADS 1
+
+static void gst_openjpeg_dec_finalize (GObject * object);
+static void gst_openjpeg_dec_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_openjpeg_dec_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
 static gboolean gst_openjpeg_dec_start (GstVideoDecoder * decoder);
 static gboolean gst_openjpeg_dec_stop (GstVideoDecoder * decoder);
+static gboolean gst_openjpeg_dec_flush (GstVideoDecoder * decoder);
+static GstFlowReturn gst_openjpeg_dec_finish (GstVideoDecoder * decoder);
+static void gst_openjpeg_dec_decode_job (gpointer data, gpointer user_data);
+static GstFlowReturn gst_openjpeg_dec_output_job (gpointer data,
+    gpointer user_data);
+static void gst_openjpeg_dec_drop_job (gpointer data, gpointer user_data);
 static gboolean gst_openjpeg_dec_set_format (GstVideoDecoder * decoder,
     GstVideoCodecState * state);
 static GstFlowReturn gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
@@ -73,12 +94,33 @@ G_DEFINE_TYPE (GstOpenJPEGDec, gst_openjpeg_dec, GST_TYPE_VIDEO_DECODER);
 static void
 gst_openjpeg_dec_class_init (GstOpenJPEGDecClass * klass)
 {
+  GObjectClass *gobject_class;
   GstElementClass *element_class;
   GstVideoDecoderClass *video_decoder_class;
 
+  gobject_class = (GObjectClass *) klass;
   element_class = (GstElementClass *) klass;
   video_decoder_class = (GstVideoDecoderClass *) klass;
 
+  gobject_class->finalize = gst_openjpeg_dec_finalize;
+  gobject_class->set_property = gst_openjpeg_dec_set_property;
+  gobject_class->get_property = gst_openjpeg_dec_get_property;
+
+  /**
+   * GstOpenJPEGDec:max-threads:
+   *
+   * Maximum number of frames that are decoded in parallel, each by its own
+   * thread. Frames are still output in order, which adds a latency of
+   * max-threads - 1 frames. Changes take effect on the next start.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum threads",
+          "Maximum number of frames decoded in parallel (0 = auto)",
+          0, GST_PARALLEL_MAX_THREADS, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&gst_openjpeg_dec_src_template));
   gst_element_class_add_pad_template (element_class,
@@ -92,6 +134,8 @@ gst_openjpeg_dec_class_init (GstOpenJPEGDecClass * klass)
 
   video_decoder_class->start = GST_DEBUG_FUNCPTR (gst_openjpeg_dec_start);
   video_decoder_class->stop = GST_DEBUG_FUNCPTR (gst_openjpeg_dec_stop);
+  video_decoder_class->flush = GST_DEBUG_FUNCPTR (gst_openjpeg_dec_flush);
+  video_decoder_class->finish = GST_DEBUG_FUNCPTR (gst_openjpeg_dec_finish);
   video_decoder_class->set_format =
       GST_DEBUG_FUNCPTR (gst_openjpeg_dec_set_format);
   video_decoder_class->handle_frame =
@@ -113,15 +157,75 @@ gst_openjpeg_dec_init (GstOpenJPEGDec * self)
 #ifdef HAVE_OPENJPEG_1
   self->params.cp_limit_decoding = NO_LIMITATION;
 #endif
+
+  self->max_threads = DEFAULT_MAX_THREADS;
+  gst_parallel_queue_init (&self->queue, gst_openjpeg_dec_decode_job,
+      gst_openjpeg_dec_output_job, gst_openjpeg_dec_drop_job, self);
+}
+
+static void
+gst_openjpeg_dec_finalize (GObject * object)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (object);
+
+  gst_parallel_queue_clear (&self->queue);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_openjpeg_dec_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (object);
+
+  switch (prop_id) {
+    case PROP_MAX_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->max_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_openjpeg_dec_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (object);
+
+  switch (prop_id) {
+    case PROP_MAX_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->max_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
 }
 
 static gboolean
 gst_openjpeg_dec_start (GstVideoDecoder * decoder)
 {
   GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
+  guint threads;
 
   GST_DEBUG_OBJECT (self, "Starting");
 
+  GST_OBJECT_LOCK (self);
+  threads = self->max_threads;
+  GST_OBJECT_UNLOCK (self);
+
+  threads = gst_parallel_queue_start (&self->queue, GST_OBJECT (self),
+      threads);
+
+  GST_INFO_OBJECT (self, "decoding %u frames in parallel", threads);
+
   return TRUE;
 }
 
@@ -132,6 +236,8 @@ gst_openjpeg_dec_stop (GstVideoDecoder * video_decoder)
 
   GST_DEBUG_OBJECT (self, "Stopping");
 
+  gst_parallel_queue_stop (&self->queue);
+
   if (self->output_state) {
     gst_video_codec_state_unref (self->output_state);
     self->output_state = NULL;
@@ -154,9 +260,13 @@ gst_openjpeg_dec_set_format (GstVideoDecoder * decoder,
   GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
   GstStructure *s;
   const gchar *color_space;
+  GstClockTime latency = 0;
 
   GST_DEBUG_OBJECT (self, "Setting format: %" GST_PTR_FORMAT, state->caps);
 
+  /* frames still being decoded belong to the previous format */
+  gst_parallel_queue_drain (&self->queue);
+
   s = gst_caps_get_structure (state->caps, 0);
 
   self->color_space = OPJ_CLRSPC_UNKNOWN;
@@ -190,14 +300,21 @@ gst_openjpeg_dec_set_format (GstVideoDecoder * decoder,
     gst_video_codec_state_unref (self->input_state);
   self->input_state = gst_video_codec_state_ref (state);
 
+  /* a frame is output when the frame n_threads - 1 frames later came in */
+  if (self->queue.n_threads > 1 && state->info.fps_n > 0)
+    latency =
+        gst_util_uint64_scale_ceil ((self->queue.n_threads - 1) * GST_SECOND,
+        state->info.fps_d, state->info.fps_n);
+  gst_video_decoder_set_latency (decoder, latency, latency);
+
   return TRUE;
 }
 
 static void
 fill_frame_packed8_4 (GstVideoFrame * frame, opj_image_t * image)
 {
-  gint x, y, w, h;
-  guint8 *data_out, *tmp;
+  gint y, w, h;
+  guint8 *data_out;
   const gint *data_in[4];
   gint dstride;
 
@@ -212,20 +329,13 @@ fill_frame_packed8_4 (GstVideoFrame * frame, opj_image_t * image)
   data_in[3] = image->comps[3].data;
 
   for (y = 0; y < h; y++) {
-    tmp = data_out;
-
-    for (x = 0; x < w; x++) {
-      tmp[0] = *data_in[3];
-      tmp[1] = *data_in[0];
-      tmp[2] = *data_in[1];
-      tmp[3] = *data_in[2];
+    gst_openjpeg_pack_row_argb (data_out, data_in[3], data_in[0], data_in[1],
+        data_in[2], w);
 
-      tmp += 4;
-      data_in[0]++;
-      data_in[1]++;
-      data_in[2]++;
-      data_in[3]++;
-    }
+    data_in[0] += w;
+    data_in[1] += w;
+    data_in[2] += w;
+    data_in[3] += w;
     data_out += dstride;
   }
 }
@@ -233,8 +343,8 @@ fill_frame_packed8_4 (GstVideoFrame * frame, opj_image_t * image)
 static void
 fill_frame_packed16_4 (GstVideoFrame * frame, opj_image_t * image)
 {
-  gint x, y, w, h;
-  guint16 *data_out, *tmp;
+  gint y, w, h;
+  guint16 *data_out;
   const gint *data_in[4];
   gint dstride;
   gint shift[4];
@@ -249,26 +359,20 @@ fill_frame_packed16_4 (GstVideoFrame * frame, opj_image_t * image)
   data_in[2] = image->comps[2].data;
   data_in[3] = image->comps[3].data;
 
-  shift[0] = 16 - image->comps[0].prec;
-  shift[1] = 16 - image->comps[1].prec;
-  shift[2] = 16 - image->comps[2].prec;
-  shift[3] = 16 - image->comps[3].prec;
+  /* in ARGB order */
+  shift[0] = 16 - image->comps[3].prec;
+  shift[1] = 16 - image->comps[0].prec;
+  shift[2] = 16 - image->comps[1].prec;
+  shift[3] = 16 - image->comps[2].prec;
 
   for (y = 0; y < h; y++) {
-    tmp = data_out;
+    gst_openjpeg_pack_row_argb64 (data_out, data_in[3], data_in[0],
+        data_in[1], data_in[2], shift, w);
 
-    for (x = 0; x < w; x++) {
-      tmp[0] = *data_in[3] << shift[3];
-      tmp[1] = *data_in[0] << shift[0];
-      tmp[2] = *data_in[1] << shift[1];
-      tmp[3] = *data_in[2] << shift[2];
-
-      tmp += 4;
-      data_in[0]++;
-      data_in[1]++;
-      data_in[2]++;
-      data_in[3]++;
-    }
+    data_in[0] += w;
+    data_in[1] += w;
+    data_in[2] += w;
+    data_in[3] += w;
     data_out += dstride;
   }
 }
@@ -276,8 +380,8 @@ fill_frame_packed16_4 (GstVideoFrame * frame, opj_image_t * image)
 static void
 fill_frame_packed8_3 (GstVideoFrame * frame, opj_image_t * image)
 {
-  gint x, y, w, h;
-  guint8 *data_out, *tmp;
+  gint y, w, h;
+  guint8 *data_out;
   const gint *data_in[3];
   gint dstride;
 
@@ -291,18 +395,12 @@ fill_frame_packed8_3 (GstVideoFrame * frame, opj_image_t * image)
   data_in[2] = image->comps[2].data;
 
   for (y = 0; y < h; y++) {
-    tmp = data_out;
+    gst_openjpeg_pack_row_argb (data_out, NULL, data_in[0], data_in[1],
+        data_in[2], w);
 
-    for (x = 0; x < w; x++) {
-      tmp[1] = *data_in[0];
-      tmp[2] = *data_in[1];
-      tmp[3] = *data_in[2];
-
-      tmp += 4;
-      data_in[0]++;
-      data_in[1]++;
-      data_in[2]++;
-    }
+    data_in[0] += w;
+    data_in[1] += w;
+    data_in[2] += w;
     data_out += dstride;
   }
 }
@@ -310,11 +408,11 @@ fill_frame_packed8_3 (GstVideoFrame * frame, opj_image_t * image)
 static void
 fill_frame_packed16_3 (GstVideoFrame * frame, opj_image_t * image)
 {
-  gint x, y, w, h;
-  guint16 *data_out, *tmp;
+  gint y, w, h;
+  guint16 *data_out;
   const gint *data_in[3];
   gint dstride;
-  gint shift[3];
+  gint shift[4];
 
   w = GST_VIDEO_FRAME_WIDTH (frame);
   h = GST_VIDEO_FRAME_HEIGHT (frame);
@@ -325,23 +423,18 @@ fill_frame_packed16_3 (GstVideoFrame * frame, opj_image_t * image)
   data_in[1] = image->comps[1].data;
   data_in[2] = image->comps[2].data;
 
-  shift[0] = 16 - image->comps[0].prec;
-  shift[1] = 16 - image->comps[1].prec;
-  shift[2] = 16 - image->comps[2].prec;
+  shift[0] = 0;
+  shift[1] = 16 - image->comps[0].prec;
+  shift[2] = 16 - image->comps[1].prec;
+  shift[3] = 16 - image->comps[2].prec;
 
   for (y = 0; y < h; y++) {
-    tmp = data_out;
-
-    for (x = 0; x < w; x++) {
-      tmp[1] = *data_in[0] << shift[0];
-      tmp[2] = *data_in[1] << shift[1];
-      tmp[3] = *data_in[2] << shift[2];
+    gst_openjpeg_pack_row_argb64 (data_out, NULL, data_in[0], data_in[1],
+        data_in[2], shift, w);
 
-      tmp += 4;
-      data_in[0]++;
-      data_in[1]++;
-      data_in[2]++;
-    }
+    data_in[0] += w;
+    data_in[1] += w;
+    data_in[2] += w;
     data_out += dstride;
   }
 }
@@ -349,8 +442,8 @@ fill_frame_packed16_3 (GstVideoFrame * frame, opj_image_t * image)
 static void
 fill_frame_planar8_1 (GstVideoFrame * frame, opj_image_t * image)
 {
-  gint x, y, w, h;
-  guint8 *data_out, *tmp;
+  gint y, w, h;
+  guint8 *data_out;
   const gint *data_in;
   gint dstride;
 
@@ -362,14 +455,9 @@ fill_frame_planar8_1 (GstVideoFrame * frame, opj_image_t * image)
   data_in = image->comps[0].data;
 
   for (y = 0; y < h; y++) {
-    tmp = data_out;
-
-    for (x = 0; x < w; x++) {
-      *tmp = *data_in;
+    gst_openjpeg_pack_row_8 (data_out, data_in, w);
 
-      tmp++;
-      data_in++;
-    }
+    data_in += w;
     data_out += dstride;
   }
 }
@@ -377,8 +465,8 @@ fill_frame_planar8_1 (GstVideoFrame * frame, opj_image_t * image)
 static void
 fill_frame_planar16_1 (GstVideoFrame * frame, opj_image_t * image)
 {
-  gint x, y, w, h;
-  guint16 *data_out, *tmp;
+  gint y, w, h;
+  guint16 *data_out;
   const gint *data_in;
   gint dstride;
   gint shift;
@@ -393,14 +481,9 @@ fill_frame_planar16_1 (GstVideoFrame * frame, opj_image_t * image)
   shift = 16 - image->comps[0].prec;
 
   for (y = 0; y < h; y++) {
-    tmp = data_out;
-
-    for (x = 0; x < w; x++) {
-      *tmp = *data_in << shift;
+    gst_openjpeg_pack_row_16 (data_out, data_in, shift, w);
 
-      tmp++;
-      data_in++;
-    }
+    data_in += w;
     data_out += dstride;
   }
 }
@@ -408,8 +491,8 @@ fill_frame_planar16_1 (GstVideoFrame * frame, opj_image_t * image)
 static void
 fill_frame_planar8_3 (GstVideoFrame * frame, opj_image_t * image)
 {
-  gint c, x, y, w, h;
-  guint8 *data_out, *tmp;
+  gint c, y, w, h;
+  guint8 *data_out;
   const gint *data_in;
   gint dstride;
 
@@ -421,13 +504,9 @@ fill_frame_planar8_3 (GstVideoFrame * frame, opj_image_t * image)
     data_in = image->comps[c].data;
 
     for (y = 0; y < h; y++) {
-      tmp = data_out;
+      gst_openjpeg_pack_row_8 (data_out, data_in, w);
 
-      for (x = 0; x < w; x++) {
-        *tmp = *data_in;
-        tmp++;
-        data_in++;
-      }
+      data_in += w;
       data_out += dstride;
     }
   }
@@ -436,8 +515,8 @@ fill_frame_planar8_3 (GstVideoFrame * frame, opj_image_t * image)
 static void
 fill_frame_planar16_3 (GstVideoFrame * frame, opj_image_t * image)
 {
-  gint c, x, y, w, h;
-  guint16 *data_out, *tmp;
+  gint c, y, w, h;
+  guint16 *data_out;
   const gint *data_in;
   gint dstride;
   gint shift;
@@ -451,13 +530,9 @@ fill_frame_planar16_3 (GstVideoFrame * frame, opj_image_t * image)
     shift = 16 - image->comps[c].prec;
 
     for (y = 0; y < h; y++) {
-      tmp = data_out;
+      gst_openjpeg_pack_row_16 (data_out, data_in, shift, w);
 
-      for (x = 0; x < w; x++) {
-        *tmp = *data_in << shift;
-        tmp++;
-        data_in++;
-      }
+      data_in += w;
       data_out += dstride;
     }
   }
@@ -580,7 +655,7 @@ fill_frame_planar16_3_generic (GstVideoFrame * frame, opj_image_t * image)
     tmp = data_out;
 
     for (x = 0; x < w; x++) {
-      tmp[0] = 0xff;
+      tmp[0] = 0xffff;
       tmp[1] = data_in[0][((y / dy[0]) * w + x) / dx[0]] << shift[0];
       tmp[2] = data_in[1][((y / dy[1]) * w + x) / dx[1]] << shift[1];
       tmp[3] = data_in[2][((y / dy[2]) * w + x) / dx[2]] << shift[2];
@@ -947,13 +1022,33 @@ seek_fn (OPJ_OFF_T p_nb_bytes, void *p_user_data)
 }
 #endif
 
-static GstFlowReturn
-gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
-    GstVideoCodecFrame * frame)
+typedef enum
+{
+  DECODE_OK,
+  DECODE_INIT_ERROR,
+  DECODE_MAP_ERROR,
+  DECODE_OPEN_ERROR,
+  DECODE_ERROR
+} DecodeResult;
+
+/* One frame, decoded in the streaming thread or by the thread pool. The
+ * stream properties are copied as set_format() can change them while
+ * the frame is decoded. */
+typedef struct
+{
+  GstVideoCodecFrame *frame;
+  OPJ_CODEC_FORMAT codec_format;
+  gboolean is_jp2c;
+  gint ncomps;
+
+  opj_image_t *image;
+  DecodeResult result;
+} GstOpenJPEGDecJob;
+
+/* Only uses the job and the parameters from init, can run in any thread */
+static void
+gst_openjpeg_dec_decode (GstOpenJPEGDec * self, GstOpenJPEGDecJob * job)
 {
-  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
-  GstFlowReturn ret = GST_FLOW_OK;
-  gint64 deadline;
   GstMapInfo map;
 #ifdef HAVE_OPENJPEG_1
   opj_dinfo_t *dec;
@@ -964,23 +1059,16 @@ gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
   MemStream mstream;
 #endif
   opj_image_t *image;
-  GstVideoFrame vframe;
   opj_dparameters_t params;
 
-  GST_DEBUG_OBJECT (self, "Handling frame");
+  job->image = NULL;
 
-  deadline = gst_video_decoder_get_max_decode_time (decoder, frame);
-  if (deadline < 0) {
-    GST_LOG_OBJECT (self, "Dropping too late frame: deadline %" G_GINT64_FORMAT,
-        deadline);
-    ret = gst_video_decoder_drop_frame (decoder, frame);
-    return ret;
+  dec = opj_create_decompress (job->codec_format);
+  if (!dec) {
+    job->result = DECODE_INIT_ERROR;
+    return;
   }
 
-  dec = opj_create_decompress (self->codec_format);
-  if (!dec)
-    goto initialization_error;
-
 #ifdef HAVE_OPENJPEG_1
   if (G_UNLIKELY (gst_debug_category_get_threshold (GST_CAT_DEFAULT) >=
           GST_LEVEL_TRACE)) {
@@ -1007,30 +1095,35 @@ gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
 #endif
 
   params = self->params;
-  if (self->ncomps)
-    params.jpwl_exp_comps = self->ncomps;
+  if (job->ncomps)
+    params.jpwl_exp_comps = job->ncomps;
   opj_setup_decoder (dec, &params);
 
-  if (!gst_buffer_map (frame->input_buffer, &map, GST_MAP_READ))
-    goto map_read_error;
+  if (!gst_buffer_map (job->frame->input_buffer, &map, GST_MAP_READ)) {
+    job->result = DECODE_MAP_ERROR;
+    goto done;
+  }
 
 #ifdef HAVE_OPENJPEG_1
-  io = opj_cio_open ((opj_common_ptr) dec, map.data + (self->is_jp2c ? 8 : 0),
-      map.size - (self->is_jp2c ? 8 : 0));
-  if (!io)
-    goto open_error;
+  io = opj_cio_open ((opj_common_ptr) dec, map.data + (job->is_jp2c ? 8 : 0),
+      map.size - (job->is_jp2c ? 8 : 0));
+  if (!io) {
+    job->result = DECODE_OPEN_ERROR;
+    goto unmap;
+  }
 
   image = opj_decode (dec, io);
-  if (!image)
-    goto decode_error;
+  opj_cio_close (io);
 #else
   stream = opj_stream_create (4096, OPJ_TRUE);
-  if (!stream)
-    goto open_error;
+  if (!stream) {
+    job->result = DECODE_OPEN_ERROR;
+    goto unmap;
+  }
 
-  mstream.data = map.data + (self->is_jp2c ? 8 : 0);
+  mstream.data = map.data + (job->is_jp2c ? 8 : 0);
   mstream.offset = 0;
-  mstream.size = map.size - (self->is_jp2c ? 8 : 0);
+  mstream.size = map.size - (job->is_jp2c ? 8 : 0);
 
   opj_stream_set_read_function (stream, read_fn);
   opj_stream_set_write_function (stream, write_fn);
@@ -1040,16 +1133,58 @@ gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
   opj_stream_set_user_data_length (stream, mstream.size);
 
   image = NULL;
-  if (!opj_read_header (stream, dec, &image))
-    goto decode_error;
+  if (opj_read_header (stream, dec, &image) && opj_decode (dec, stream, image)) {
+    opj_end_decompress (dec, stream);
+  } else if (image) {
+    opj_image_destroy (image);
+    image = NULL;
+  }
+  opj_stream_destroy (stream);
+#endif
+
+  job->image = image;
+  job->result = image ? DECODE_OK : DECODE_ERROR;
 
-  if (!opj_decode (dec, stream, image))
-    goto decode_error;
+unmap:
+  gst_buffer_unmap (job->frame->input_buffer, &map);
+done:
+#ifdef HAVE_OPENJPEG_1
+  opj_destroy_decompress (dec);
+#else
+  opj_destroy_codec (dec);
 #endif
+}
 
-  gst_buffer_unmap (frame->input_buffer, &map);
+static void
+gst_openjpeg_dec_decode_job (gpointer data, gpointer user_data)
+{
+  gst_openjpeg_dec_decode (GST_OPENJPEG_DEC (user_data), data);
+}
+
+/* Negotiates, converts and pushes a decoded frame, in the streaming thread
+ * and in decoding order */
+static GstFlowReturn
+gst_openjpeg_dec_output_frame (GstOpenJPEGDec * self, GstOpenJPEGDecJob * job)
+{
+  GstVideoDecoder *decoder = GST_VIDEO_DECODER (self);
+  GstVideoCodecFrame *frame = job->frame;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstVideoFrame vframe;
 
-  ret = gst_openjpeg_dec_negotiate (self, image);
+  switch (job->result) {
+    case DECODE_INIT_ERROR:
+      goto initialization_error;
+    case DECODE_MAP_ERROR:
+      goto map_read_error;
+    case DECODE_OPEN_ERROR:
+      goto open_error;
+    case DECODE_ERROR:
+      goto decode_error;
+    default:
+      break;
+  }
+
+  ret = gst_openjpeg_dec_negotiate (self, job->image);
   if (ret != GST_FLOW_OK)
     goto negotiate_error;
 
@@ -1061,20 +1196,11 @@ gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
           frame->output_buffer, GST_MAP_WRITE))
     goto map_write_error;
 
-  self->fill_frame (&vframe, image);
+  self->fill_frame (&vframe, job->image);
 
   gst_video_frame_unmap (&vframe);
 
-#ifdef HAVE_OPENJPEG_1
-  opj_cio_close (io);
-  opj_image_destroy (image);
-  opj_destroy_decompress (dec);
-#else
-  opj_end_decompress (dec, stream);
-  opj_stream_destroy (stream);
-  opj_image_destroy (image);
-  opj_destroy_codec (dec);
-#endif
+  opj_image_destroy (job->image);
 
   ret = gst_video_decoder_finish_frame (decoder, frame);
 
@@ -1089,11 +1215,6 @@ initialization_error:
   }
 map_read_error:
   {
-#ifdef HAVE_OPENJPEG_1
-    opj_destroy_decompress (dec);
-#else
-    opj_destroy_codec (dec);
-#endif
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, CORE, FAILED,
@@ -1102,12 +1223,6 @@ map_read_error:
   }
 open_error:
   {
-#ifdef HAVE_OPENJPEG_1
-    opj_destroy_decompress (dec);
-#else
-    opj_destroy_codec (dec);
-#endif
-    gst_buffer_unmap (frame->input_buffer, &map);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, LIBRARY, INIT,
@@ -1116,16 +1231,6 @@ open_error:
   }
 decode_error:
   {
-    if (image)
-      opj_image_destroy (image);
-#ifdef HAVE_OPENJPEG_1
-    opj_cio_close (io);
-    opj_destroy_decompress (dec);
-#else
-    opj_stream_destroy (stream);
-    opj_destroy_codec (dec);
-#endif
-    gst_buffer_unmap (frame->input_buffer, &map);
     gst_video_codec_frame_unref (frame);
 
     GST_VIDEO_DECODER_ERROR (self, 1, STREAM, DECODE,
@@ -1134,14 +1239,7 @@ decode_error:
   }
 negotiate_error:
   {
-    opj_image_destroy (image);
-#ifdef HAVE_OPENJPEG_1
-    opj_cio_close (io);
-    opj_destroy_decompress (dec);
-#else
-    opj_stream_destroy (stream);
-    opj_destroy_codec (dec);
-#endif
+    opj_image_destroy (job->image);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, CORE, NEGOTIATION,
@@ -1150,14 +1248,7 @@ negotiate_error:
   }
 allocate_error:
   {
-    opj_image_destroy (image);
-#ifdef HAVE_OPENJPEG_1
-    opj_cio_close (io);
-    opj_destroy_decompress (dec);
-#else
-    opj_stream_destroy (stream);
-    opj_destroy_codec (dec);
-#endif
+    opj_image_destroy (job->image);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, CORE, FAILED,
@@ -1166,14 +1257,7 @@ allocate_error:
   }
 map_write_error:
   {
-    opj_image_destroy (image);
-#ifdef HAVE_OPENJPEG_1
-    opj_cio_close (io);
-    opj_destroy_decompress (dec);
-#else
-    opj_stream_destroy (stream);
-    opj_destroy_codec (dec);
-#endif
+    opj_image_destroy (job->image);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, CORE, FAILED,
@@ -1182,6 +1266,77 @@ map_write_error:
   }
 }
 
+static GstFlowReturn
+gst_openjpeg_dec_output_job (gpointer data, gpointer user_data)
+{
+  GstOpenJPEGDecJob *job = data;
+  GstFlowReturn ret;
+
+  ret = gst_openjpeg_dec_output_frame (GST_OPENJPEG_DEC (user_data), job);
+  g_slice_free (GstOpenJPEGDecJob, job);
+
+  return ret;
+}
+
+static void
+gst_openjpeg_dec_drop_job (gpointer data, gpointer user_data)
+{
+  GstOpenJPEGDecJob *job = data;
+
+  if (job->image)
+    opj_image_destroy (job->image);
+  gst_video_decoder_release_frame (GST_VIDEO_DECODER (user_data), job->frame);
+  g_slice_free (GstOpenJPEGDecJob, job);
+}
+
+static gboolean
+gst_openjpeg_dec_flush (GstVideoDecoder * decoder)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
+
+  GST_DEBUG_OBJECT (self, "Flushing");
+
+  gst_parallel_queue_flush (&self->queue);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_openjpeg_dec_finish (GstVideoDecoder * decoder)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
+
+  GST_DEBUG_OBJECT (self, "Draining");
+
+  return gst_parallel_queue_drain (&self->queue);
+}
+
+static GstFlowReturn
+gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
+    GstVideoCodecFrame * frame)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
+  GstOpenJPEGDecJob *job;
+  gint64 deadline;
+
+  GST_DEBUG_OBJECT (self, "Handling frame");
+
+  deadline = gst_video_decoder_get_max_decode_time (decoder, frame);
+  if (deadline < 0) {
+    GST_LOG_OBJECT (self, "Dropping too late frame: deadline %" G_GINT64_FORMAT,
+        deadline);
+    return gst_video_decoder_drop_frame (decoder, frame);
+  }
+
+  job = g_slice_new0 (GstOpenJPEGDecJob);
+  job->frame = frame;
+  job->codec_format = self->codec_format;
+  job->is_jp2c = self->is_jp2c;
+  job->ncomps = self->ncomps;
+
+  return gst_parallel_queue_push (&self->queue, job);
+}
+
 static gboolean
 gst_openjpeg_dec_decide_allocation (GstVideoDecoder * decoder, GstQuery * query)
 {
@@ -24,6 +24,7 @@
 
 #include <gst/gst.h>
 #include <gst/video/video.h>
+#include <gst/parallel-private.h>
 
 #include "gstopenjpeg.h"
 
@@ -59,6 +60,11 @@ struct _GstOpenJPEGDec
   void (*fill_frame) (GstVideoFrame *frame, opj_image_t * image);
 
   opj_dparameters_t params;
+
+  guint max_threads;
+
+  /* frame threading */
+  GstParallelQueue queue;
 };
 
 struct _GstOpenJPEGDecClass
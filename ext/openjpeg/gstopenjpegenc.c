@@ -25,6 +25,7 @@
 #endif
 
 #include "gstopenjpegenc.h"
+#include "gstopenjpegpack.h"
 
 #include <string.h>
 
@@ -65,7 +66,8 @@ enum
   PROP_TILE_OFFSET_X,
   PROP_TILE_OFFSET_Y,
   PROP_TILE_WIDTH,
-  PROP_TILE_HEIGHT
+  PROP_TILE_HEIGHT,
+  PROP_MAX_THREADS
 };
 
 #define DEFAULT_NUM_LAYERS 1
@@ -75,6 +77,9 @@ enum
 #define DEFAULT_TILE_OFFSET_Y 0
 #define DEFAULT_TILE_WIDTH 0
 #define DEFAULT_TILE_HEIGHT 0
+#define DEFAULT_MAX_THREADS 1
+
+static void gst_openjpeg_enc_finalize (GObject * object);
 
 static void gst_openjpeg_enc_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -83,6 +88,12 @@ static void gst_openjpeg_enc_get_property (GObject * object, guint prop_id,
 
 static gboolean gst_openjpeg_enc_start (GstVideoEncoder * encoder);
 static gboolean gst_openjpeg_enc_stop (GstVideoEncoder * encoder);
+static gboolean gst_openjpeg_enc_flush (GstVideoEncoder * encoder);
+static GstFlowReturn gst_openjpeg_enc_finish (GstVideoEncoder * encoder);
+static void gst_openjpeg_enc_encode_job (gpointer data, gpointer user_data);
+static GstFlowReturn gst_openjpeg_enc_output_job (gpointer data,
+    gpointer user_data);
+static void gst_openjpeg_enc_drop_job (gpointer data, gpointer user_data);
 static gboolean gst_openjpeg_enc_set_format (GstVideoEncoder * encoder,
     GstVideoCodecState * state);
 static GstFlowReturn gst_openjpeg_enc_handle_frame (GstVideoEncoder * encoder,
@@ -138,6 +149,7 @@ gst_openjpeg_enc_class_init (GstOpenJPEGEncClass * klass)
   element_class = (GstElementClass *) klass;
   video_encoder_class = (GstVideoEncoderClass *) klass;
 
+  gobject_class->finalize = gst_openjpeg_enc_finalize;
   gobject_class->set_property = gst_openjpeg_enc_set_property;
   gobject_class->get_property = gst_openjpeg_enc_get_property;
 
@@ -177,6 +189,21 @@ gst_openjpeg_enc_class_init (GstOpenJPEGEncClass * klass)
           "Tile Height", 0, G_MAXINT, DEFAULT_TILE_HEIGHT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstOpenJPEGEnc:max-threads:
+   *
+   * Maximum number of frames that are encoded in parallel, each by its own
+   * thread. Frames are still output in order, which adds a latency of
+   * max-threads - 1 frames. Changes take effect on the next start.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum threads",
+          "Maximum number of frames encoded in parallel (0 = auto)",
+          0, GST_PARALLEL_MAX_THREADS, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&gst_openjpeg_enc_src_template));
   gst_element_class_add_pad_template (element_class,
@@ -190,6 +217,8 @@ gst_openjpeg_enc_class_init (GstOpenJPEGEncClass * klass)
 
   video_encoder_class->start = GST_DEBUG_FUNCPTR (gst_openjpeg_enc_start);
   video_encoder_class->stop = GST_DEBUG_FUNCPTR (gst_openjpeg_enc_stop);
+  video_encoder_class->flush = GST_DEBUG_FUNCPTR (gst_openjpeg_enc_flush);
+  video_encoder_class->finish = GST_DEBUG_FUNCPTR (gst_openjpeg_enc_finish);
   video_encoder_class->set_format =
       GST_DEBUG_FUNCPTR (gst_openjpeg_enc_set_format);
   video_encoder_class->handle_frame =
@@ -230,6 +259,20 @@ gst_openjpeg_enc_init (GstOpenJPEGEnc * self)
   self->params.cp_tdy = DEFAULT_TILE_HEIGHT;
   self->params.tile_size_on = (self->params.cp_tdx != 0
       && self->params.cp_tdy != 0);
+
+  self->max_threads = DEFAULT_MAX_THREADS;
+  gst_parallel_queue_init (&self->queue, gst_openjpeg_enc_encode_job,
+      gst_openjpeg_enc_output_job, gst_openjpeg_enc_drop_job, self);
+}
+
+static void
+gst_openjpeg_enc_finalize (GObject * object)
+{
+  GstOpenJPEGEnc *self = GST_OPENJPEG_ENC (object);
+
+  gst_parallel_queue_clear (&self->queue);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static void
@@ -264,6 +307,9 @@ gst_openjpeg_enc_set_property (GObject * object, guint prop_id,
       self->params.tile_size_on = (self->params.cp_tdx != 0
           && self->params.cp_tdy != 0);
       break;
+    case PROP_MAX_THREADS:
+      self->max_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -298,6 +344,9 @@ gst_openjpeg_enc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_TILE_HEIGHT:
       g_value_set_int (value, self->params.cp_tdy);
       break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, self->max_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -308,9 +357,15 @@ static gboolean
 gst_openjpeg_enc_start (GstVideoEncoder * encoder)
 {
   GstOpenJPEGEnc *self = GST_OPENJPEG_ENC (encoder);
+  guint threads;
 
   GST_DEBUG_OBJECT (self, "Starting");
 
+  threads = gst_parallel_queue_start (&self->queue, GST_OBJECT (self),
+      self->max_threads);
+
+  GST_INFO_OBJECT (self, "encoding %u frames in parallel", threads);
+
   return TRUE;
 }
 
@@ -321,6 +376,8 @@ gst_openjpeg_enc_stop (GstVideoEncoder * video_encoder)
 
   GST_DEBUG_OBJECT (self, "Stopping");
 
+  gst_parallel_queue_stop (&self->queue);
+
   if (self->output_state) {
     gst_video_codec_state_unref (self->output_state);
     self->output_state = NULL;
@@ -339,8 +396,8 @@ gst_openjpeg_enc_stop (GstVideoEncoder * video_encoder)
 static void
 fill_image_packed16_4 (opj_image_t * image, GstVideoFrame * frame)
 {
-  gint x, y, w, h;
-  const guint16 *data_in, *tmp;
+  gint y, w, h;
+  const guint16 *data_in;
   gint *data_out[4];
   gint sstride;
 
@@ -355,20 +412,13 @@ fill_image_packed16_4 (opj_image_t * image, GstVideoFrame * frame)
   data_out[3] = image->comps[3].data;
 
   for (y = 0; y < h; y++) {
-    tmp = data_in;
-
-    for (x = 0; x < w; x++) {
-      *data_out[3] = tmp[0];
-      *data_out[0] = tmp[1];
-      *data_out[1] = tmp[2];
-      *data_out[2] = tmp[3];
-
-      tmp += 4;
-      data_out[0]++;
-      data_out[1]++;
-      data_out[2]++;
-      data_out[3]++;
-    }
+    gst_openjpeg_unpack_row_argb64 (data_out[3], data_out[0], data_out[1],
+        data_out[2], data_in, w);
+
+    data_out[0] += w;
+    data_out[1] += w;
+    data_out[2] += w;
+    data_out[3] += w;
     data_in += sstride;
   }
 }
@@ -376,8 +426,8 @@ fill_image_packed16_4 (opj_image_t * image, GstVideoFrame * frame)
 static void
 fill_image_packed8_4 (opj_image_t * image, GstVideoFrame * frame)
 {
-  gint x, y, w, h;
-  const guint8 *data_in, *tmp;
+  gint y, w, h;
+  const guint8 *data_in;
   gint *data_out[4];
   gint sstride;
 
@@ -392,20 +442,13 @@ fill_image_packed8_4 (opj_image_t * image, GstVideoFrame * frame)
   data_out[3] = image->comps[3].data;
 
   for (y = 0; y < h; y++) {
-    tmp = data_in;
-
-    for (x = 0; x < w; x++) {
-      *data_out[3] = tmp[0];
-      *data_out[0] = tmp[1];
-      *data_out[1] = tmp[2];
-      *data_out[2] = tmp[3];
-
-      tmp += 4;
-      data_out[0]++;
-      data_out[1]++;
-      data_out[2]++;
-      data_out[3]++;
-    }
+    gst_openjpeg_unpack_row_argb (data_out[3], data_out[0], data_out[1],
+        data_out[2], data_in, w);
+
+    data_out[0] += w;
+    data_out[1] += w;
+    data_out[2] += w;
+    data_out[3] += w;
     data_in += sstride;
   }
 }
@@ -413,8 +456,8 @@ fill_image_packed8_4 (opj_image_t * image, GstVideoFrame * frame)
 static void
 fill_image_packed8_3 (opj_image_t * image, GstVideoFrame * frame)
 {
-  gint x, y, w, h;
-  const guint8 *data_in, *tmp;
+  gint y, w, h;
+  const guint8 *data_in;
   gint *data_out[3];
   gint sstride;
 
@@ -428,18 +471,12 @@ fill_image_packed8_3 (opj_image_t * image, GstVideoFrame * frame)
   data_out[2] = image->comps[2].data;
 
   for (y = 0; y < h; y++) {
-    tmp = data_in;
+    gst_openjpeg_unpack_row_argb (NULL, data_out[0], data_out[1],
+        data_out[2], data_in, w);
 
-    for (x = 0; x < w; x++) {
-      *data_out[0] = tmp[1];
-      *data_out[1] = tmp[2];
-      *data_out[2] = tmp[3];
-
-      tmp += 4;
-      data_out[0]++;
-      data_out[1]++;
-      data_out[2]++;
-    }
+    data_out[0] += w;
+    data_out[1] += w;
+    data_out[2] += w;
     data_in += sstride;
   }
 }
@@ -447,8 +484,8 @@ fill_image_packed8_3 (opj_image_t * image, GstVideoFrame * frame)
 static void
 fill_image_planar16_3 (opj_image_t * image, GstVideoFrame * frame)
 {
-  gint c, x, y, w, h;
-  const guint16 *data_in, *tmp;
+  gint c, y, w, h;
+  const guint16 *data_in;
   gint *data_out;
   gint sstride;
 
@@ -460,12 +497,9 @@ fill_image_planar16_3 (opj_image_t * image, GstVideoFrame * frame)
     data_out = image->comps[c].data;
 
     for (y = 0; y < h; y++) {
-      tmp = data_in;
-      for (x = 0; x < w; x++) {
-        *data_out = *tmp;
-        data_out++;
-        tmp++;
-      }
+      gst_openjpeg_unpack_row_16 (data_out, data_in, w);
+
+      data_out += w;
       data_in += sstride;
     }
   }
@@ -474,8 +508,8 @@ fill_image_planar16_3 (opj_image_t * image, GstVideoFrame * frame)
 static void
 fill_image_planar8_3 (opj_image_t * image, GstVideoFrame * frame)
 {
-  gint c, x, y, w, h;
-  const guint8 *data_in, *tmp;
+  gint c, y, w, h;
+  const guint8 *data_in;
   gint *data_out;
   gint sstride;
 
@@ -487,12 +521,9 @@ fill_image_planar8_3 (opj_image_t * image, GstVideoFrame * frame)
     data_out = image->comps[c].data;
 
     for (y = 0; y < h; y++) {
-      tmp = data_in;
-      for (x = 0; x < w; x++) {
-        *data_out = *tmp;
-        data_out++;
-        tmp++;
-      }
+      gst_openjpeg_unpack_row_8 (data_out, data_in, w);
+
+      data_out += w;
       data_in += sstride;
     }
   }
@@ -501,8 +532,8 @@ fill_image_planar8_3 (opj_image_t * image, GstVideoFrame * frame)
 static void
 fill_image_planar8_1 (opj_image_t * image, GstVideoFrame * frame)
 {
-  gint x, y, w, h;
-  const guint8 *data_in, *tmp;
+  gint y, w, h;
+  const guint8 *data_in;
   gint *data_out;
   gint sstride;
 
@@ -513,12 +544,9 @@ fill_image_planar8_1 (opj_image_t * image, GstVideoFrame * frame)
   data_out = image->comps[0].data;
 
   for (y = 0; y < h; y++) {
-    tmp = data_in;
-    for (x = 0; x < w; x++) {
-      *data_out = *tmp;
-      data_out++;
-      tmp++;
-    }
+    gst_openjpeg_unpack_row_8 (data_out, data_in, w);
+
+    data_out += w;
     data_in += sstride;
   }
 }
@@ -526,8 +554,8 @@ fill_image_planar8_1 (opj_image_t * image, GstVideoFrame * frame)
 static void
 fill_image_planar16_1 (opj_image_t * image, GstVideoFrame * frame)
 {
-  gint x, y, w, h;
-  const guint16 *data_in, *tmp;
+  gint y, w, h;
+  const guint16 *data_in;
   gint *data_out;
   gint sstride;
 
@@ -538,12 +566,9 @@ fill_image_planar16_1 (opj_image_t * image, GstVideoFrame * frame)
   data_out = image->comps[0].data;
 
   for (y = 0; y < h; y++) {
-    tmp = data_in;
-    for (x = 0; x < w; x++) {
-      *data_out = *tmp;
-      data_out++;
-      tmp++;
-    }
+    gst_openjpeg_unpack_row_16 (data_out, data_in, w);
+
+    data_out += w;
     data_in += sstride;
   }
 }
@@ -557,9 +582,13 @@ gst_openjpeg_enc_set_format (GstVideoEncoder * encoder,
   GstStructure *s;
   const gchar *colorspace;
   gint ncomps;
+  GstClockTime latency = 0;
 
   GST_DEBUG_OBJECT (self, "Setting format: %" GST_PTR_FORMAT, state->caps);
 
+  /* frames still being encoded belong to the previous format */
+  gst_parallel_queue_drain (&self->queue);
+
   if (self->input_state)
     gst_video_codec_state_unref (self->input_state);
   self->input_state = gst_video_codec_state_ref (state);
@@ -652,6 +681,13 @@ gst_openjpeg_enc_set_format (GstVideoEncoder * encoder,
 
   gst_video_encoder_negotiate (GST_VIDEO_ENCODER (encoder));
 
+  /* a frame is output when the frame n_threads - 1 frames later came in */
+  if (self->queue.n_threads > 1 && state->info.fps_n > 0)
+    latency =
+        gst_util_uint64_scale_ceil ((self->queue.n_threads - 1) * GST_SECOND,
+        state->info.fps_d, state->info.fps_n);
+  gst_video_encoder_set_latency (encoder, latency, latency);
+
   return TRUE;
 }
 
@@ -795,12 +831,32 @@ seek_fn (OPJ_OFF_T p_nb_bytes, void *p_user_data)
 }
 #endif
 
-static GstFlowReturn
-gst_openjpeg_enc_handle_frame (GstVideoEncoder * encoder,
-    GstVideoCodecFrame * frame)
+typedef enum
+{
+  ENCODE_OK,
+  ENCODE_INIT_ERROR,
+  ENCODE_MAP_ERROR,
+  ENCODE_FILL_ERROR,
+  ENCODE_OPEN_ERROR,
+  ENCODE_ERROR
+} EncodeResult;
+
+/* One frame, encoded in the streaming thread or by the thread pool. The
+ * parameters are copied as the properties can change while the frame is
+ * encoded, everything else only changes in set_format() after all pending
+ * frames are done. */
+typedef struct
+{
+  GstVideoCodecFrame *frame;
+  opj_cparameters_t params;
+
+  GstBuffer *output;
+  EncodeResult result;
+} GstOpenJPEGEncJob;
+
+static void
+gst_openjpeg_enc_encode (GstOpenJPEGEnc * self, GstOpenJPEGEncJob * job)
 {
-  GstOpenJPEGEnc *self = GST_OPENJPEG_ENC (encoder);
-  GstFlowReturn ret = GST_FLOW_OK;
 #ifdef HAVE_OPENJPEG_1
   opj_cinfo_t *enc;
   GstMapInfo map;
@@ -814,11 +870,13 @@ gst_openjpeg_enc_handle_frame (GstVideoEncoder * encoder,
   opj_image_t *image;
   GstVideoFrame vframe;
 
-  GST_DEBUG_OBJECT (self, "Handling frame");
+  job->output = NULL;
 
   enc = opj_create_compress (self->codec_format);
-  if (!enc)
-    goto initialization_error;
+  if (!enc) {
+    job->result = ENCODE_INIT_ERROR;
+    return;
+  }
 
 #ifdef HAVE_OPENJPEG_1
   if (G_UNLIKELY (gst_debug_category_get_threshold (GST_CAT_DEFAULT) >=
@@ -846,49 +904,48 @@ gst_openjpeg_enc_handle_frame (GstVideoEncoder * encoder,
 #endif
 
   if (!gst_video_frame_map (&vframe, &self->input_state->info,
-          frame->input_buffer, GST_MAP_READ))
-    goto map_read_error;
+          job->frame->input_buffer, GST_MAP_READ)) {
+    job->result = ENCODE_MAP_ERROR;
+    goto done;
+  }
 
   image = gst_openjpeg_enc_fill_image (self, &vframe);
-  if (!image)
-    goto fill_image_error;
   gst_video_frame_unmap (&vframe);
+  if (!image) {
+    job->result = ENCODE_FILL_ERROR;
+    goto done;
+  }
 
-  opj_setup_encoder (enc, &self->params, image);
+  opj_setup_encoder (enc, &job->params, image);
 
 #ifdef HAVE_OPENJPEG_1
   io = opj_cio_open ((opj_common_ptr) enc, NULL, 0);
-  if (!io)
-    goto open_error;
-
-  if (!opj_encode (enc, io, image, NULL))
-    goto encode_error;
-
-  opj_image_destroy (image);
+  if (!io) {
+    job->result = ENCODE_OPEN_ERROR;
+    goto destroy_image;
+  }
 
-  length = cio_tell (io);
-
-  ret =
-      gst_video_encoder_allocate_output_frame (encoder, frame,
-      length + (self->is_jp2c ? 8 : 0));
-  if (ret != GST_FLOW_OK)
-    goto allocate_error;
-
-  gst_buffer_fill (frame->output_buffer, self->is_jp2c ? 8 : 0, io->buffer,
-      length);
-  if (self->is_jp2c) {
-    gst_buffer_map (frame->output_buffer, &map, GST_MAP_WRITE);
-    GST_WRITE_UINT32_BE (map.data, length + 8);
-    GST_WRITE_UINT32_BE (map.data + 4, GST_MAKE_FOURCC ('j', 'p', '2', 'c'));
-    gst_buffer_unmap (frame->output_buffer, &map);
+  if (opj_encode (enc, io, image, NULL)) {
+    length = cio_tell (io);
+
+    job->output =
+        gst_buffer_new_allocate (NULL, length + (self->is_jp2c ? 8 : 0), NULL);
+    gst_buffer_fill (job->output, self->is_jp2c ? 8 : 0, io->buffer, length);
+    if (self->is_jp2c) {
+      gst_buffer_map (job->output, &map, GST_MAP_WRITE);
+      GST_WRITE_UINT32_BE (map.data, length + 8);
+      GST_WRITE_UINT32_BE (map.data + 4, GST_MAKE_FOURCC ('j', 'p', '2', 'c'));
+      gst_buffer_unmap (job->output, &map);
+    }
   }
 
   opj_cio_close (io);
-  opj_destroy_compress (enc);
 #else
   stream = opj_stream_create (4096, OPJ_FALSE);
-  if (!stream)
-    goto open_error;
+  if (!stream) {
+    job->result = ENCODE_OPEN_ERROR;
+    goto destroy_image;
+  }
 
   mstream.allocsize = 4096;
   mstream.data = g_malloc (mstream.allocsize);
@@ -902,41 +959,74 @@ gst_openjpeg_enc_handle_frame (GstVideoEncoder * encoder,
   opj_stream_set_user_data (stream, &mstream);
   opj_stream_set_user_data_length (stream, mstream.size);
 
-  if (!opj_start_compress (enc, image, stream))
-    goto encode_error;
+  if (opj_start_compress (enc, image, stream) && opj_encode (enc, stream)
+      && opj_end_compress (enc, stream)) {
+    job->output = gst_buffer_new ();
 
-  if (!opj_encode (enc, stream))
-    goto encode_error;
+    if (self->is_jp2c) {
+      GstMapInfo map;
+      GstMemory *mem;
 
-  if (!opj_end_compress (enc, stream))
-    goto encode_error;
+      mem = gst_allocator_alloc (NULL, 8, NULL);
+      gst_memory_map (mem, &map, GST_MAP_WRITE);
+      GST_WRITE_UINT32_BE (map.data, mstream.size + 8);
+      GST_WRITE_UINT32_BE (map.data + 4, GST_MAKE_FOURCC ('j', 'p', '2', 'c'));
+      gst_memory_unmap (mem, &map);
+      gst_buffer_append_memory (job->output, mem);
+    }
+
+    gst_buffer_append_memory (job->output,
+        gst_memory_new_wrapped (0, mstream.data, mstream.allocsize, 0,
+            mstream.size, NULL, (GDestroyNotify) g_free));
+  } else {
+    g_free (mstream.data);
+  }
 
-  opj_image_destroy (image);
   opj_stream_destroy (stream);
-  opj_destroy_codec (enc);
+#endif
 
-  frame->output_buffer = gst_buffer_new ();
+  job->result = job->output ? ENCODE_OK : ENCODE_ERROR;
 
-  if (self->is_jp2c) {
-    GstMapInfo map;
-    GstMemory *mem;
+destroy_image:
+  opj_image_destroy (image);
+done:
+#ifdef HAVE_OPENJPEG_1
+  opj_destroy_compress (enc);
+#else
+  opj_destroy_codec (enc);
+#endif
+}
 
-    mem = gst_allocator_alloc (NULL, 8, NULL);
-    gst_memory_map (mem, &map, GST_MAP_WRITE);
-    GST_WRITE_UINT32_BE (map.data, mstream.size + 8);
-    GST_WRITE_UINT32_BE (map.data + 4, GST_MAKE_FOURCC ('j', 'p', '2', 'c'));
-    gst_memory_unmap (mem, &map);
-    gst_buffer_append_memory (frame->output_buffer, mem);
-  }
+static void
+gst_openjpeg_enc_encode_job (gpointer data, gpointer user_data)
+{
+  gst_openjpeg_enc_encode (GST_OPENJPEG_ENC (user_data), data);
+}
 
-  gst_buffer_append_memory (frame->output_buffer,
-      gst_memory_new_wrapped (0, mstream.data, mstream.allocsize, 0,
-          mstream.size, NULL, (GDestroyNotify) g_free));
-#endif
+/* Pushes an encoded frame, in the streaming thread and in input order */
+static GstFlowReturn
+gst_openjpeg_enc_output_frame (GstOpenJPEGEnc * self, GstOpenJPEGEncJob * job)
+{
+  GstVideoCodecFrame *frame = job->frame;
+
+  switch (job->result) {
+    case ENCODE_INIT_ERROR:
+      goto initialization_error;
+    case ENCODE_MAP_ERROR:
+      goto map_read_error;
+    case ENCODE_FILL_ERROR:
+      goto fill_image_error;
+    case ENCODE_OPEN_ERROR:
+      goto open_error;
+    case ENCODE_ERROR:
+      goto encode_error;
+    default:
+      break;
+  }
 
-  ret = gst_video_encoder_finish_frame (encoder, frame);
+  frame->output_buffer = job->output;
 
-  return ret;
+  return gst_video_encoder_finish_frame (GST_VIDEO_ENCODER (self), frame);
 
 initialization_error:
   {
@@ -947,11 +1037,6 @@ initialization_error:
   }
 map_read_error:
   {
-#ifdef HAVE_OPENJPEG_1
-    opj_destroy_compress (enc);
-#else
-    opj_destroy_codec (enc);
-#endif
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, CORE, FAILED,
@@ -960,12 +1045,6 @@ map_read_error:
   }
 fill_image_error:
   {
-#ifdef HAVE_OPENJPEG_1
-    opj_destroy_compress (enc);
-#else
-    opj_destroy_codec (enc);
-#endif
-    gst_video_frame_unmap (&vframe);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, LIBRARY, INIT,
@@ -974,12 +1053,6 @@ fill_image_error:
   }
 open_error:
   {
-    opj_image_destroy (image);
-#ifdef HAVE_OPENJPEG_1
-    opj_destroy_compress (enc);
-#else
-    opj_destroy_codec (enc);
-#endif
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, LIBRARY, INIT,
@@ -988,34 +1061,73 @@ open_error:
   }
 encode_error:
   {
-#ifdef HAVE_OPENJPEG_1
-    opj_cio_close (io);
-    opj_image_destroy (image);
-    opj_destroy_compress (enc);
-#else
-    opj_stream_destroy (stream);
-    g_free (mstream.data);
-    opj_image_destroy (image);
-    opj_destroy_codec (enc);
-#endif
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, STREAM, ENCODE,
         ("Failed to encode OpenJPEG stream"), (NULL));
     return GST_FLOW_ERROR;
   }
-#ifdef HAVE_OPENJPEG_1
-allocate_error:
-  {
-    opj_cio_close (io);
-    opj_destroy_compress (enc);
-    gst_video_codec_frame_unref (frame);
+}
 
-    GST_ELEMENT_ERROR (self, CORE, FAILED,
-        ("Failed to allocate output buffer"), (NULL));
-    return ret;
-  }
-#endif
+static GstFlowReturn
+gst_openjpeg_enc_output_job (gpointer data, gpointer user_data)
+{
+  GstOpenJPEGEncJob *job = data;
+  GstFlowReturn ret;
+
+  ret = gst_openjpeg_enc_output_frame (GST_OPENJPEG_ENC (user_data), job);
+  g_slice_free (GstOpenJPEGEncJob, job);
+
+  return ret;
+}
+
+static void
+gst_openjpeg_enc_drop_job (gpointer data, gpointer user_data)
+{
+  GstOpenJPEGEncJob *job = data;
+
+  if (job->output)
+    gst_buffer_unref (job->output);
+  gst_video_codec_frame_unref (job->frame);
+  g_slice_free (GstOpenJPEGEncJob, job);
+}
+
+static gboolean
+gst_openjpeg_enc_flush (GstVideoEncoder * encoder)
+{
+  GstOpenJPEGEnc *self = GST_OPENJPEG_ENC (encoder);
+
+  GST_DEBUG_OBJECT (self, "Flushing");
+
+  gst_parallel_queue_flush (&self->queue);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_openjpeg_enc_finish (GstVideoEncoder * encoder)
+{
+  GstOpenJPEGEnc *self = GST_OPENJPEG_ENC (encoder);
+
+  GST_DEBUG_OBJECT (self, "Draining");
+
+  return gst_parallel_queue_drain (&self->queue);
+}
+
+static GstFlowReturn
+gst_openjpeg_enc_handle_frame (GstVideoEncoder * encoder,
+    GstVideoCodecFrame * frame)
+{
+  GstOpenJPEGEnc *self = GST_OPENJPEG_ENC (encoder);
+  GstOpenJPEGEncJob *job;
+
+  GST_DEBUG_OBJECT (self, "Handling frame");
+
+  job = g_slice_new0 (GstOpenJPEGEncJob);
+  job->frame = frame;
+  job->params = self->params;
+
+  return gst_parallel_queue_push (&self->queue, job);
 }
 
 static gboolean
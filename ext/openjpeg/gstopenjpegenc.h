@@ -24,6 +24,7 @@
 
 #include <gst/gst.h>
 #include <gst/video/video.h>
+#include <gst/parallel-private.h>
 
 #include "gstopenjpeg.h"
 
@@ -57,6 +58,11 @@ struct _GstOpenJPEGEnc
   void (*fill_image) (opj_image_t * image, GstVideoFrame *frame);
 
   opj_cparameters_t params;
+
+  guint max_threads;
+
+  /* frame threading */
+  GstParallelQueue queue;
 };
 
 struct _GstOpenJPEGEncClass
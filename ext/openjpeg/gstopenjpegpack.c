@@ -0,0 +1,383 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ */
+
+/* The vector versions narrow the 32 bit samples with saturating packs and
+ * interleave them with unpacks, or vld4/vst4 on NEON. 16 bit samples
+ * keep their low 16 bits, like the plain C conversion. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstopenjpegpack.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_PACK_SSE2 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define HAVE_PACK_NEON 1
+#endif
+
+#ifdef HAVE_PACK_SSE2
+/* 8 samples of (src << shift) as 16 bit */
+static inline __m128i
+narrow_16_sse2 (const gint * src, __m128i shift)
+{
+  __m128i lo = _mm_sll_epi32 (_mm_loadu_si128 ((const __m128i *) src), shift);
+  __m128i hi =
+      _mm_sll_epi32 (_mm_loadu_si128 ((const __m128i *) (src + 4)), shift);
+
+  /* sign extend the low halves so the signed saturation keeps them */
+  lo = _mm_srai_epi32 (_mm_slli_epi32 (lo, 16), 16);
+  hi = _mm_srai_epi32 (_mm_slli_epi32 (hi, 16), 16);
+
+  return _mm_packs_epi32 (lo, hi);
+}
+
+/* p0 to p3 hold the four components of one pixel each */
+static inline void
+store_transposed_sse2 (__m128i p0, __m128i p1, __m128i p2, __m128i p3,
+    gint * a, gint * r, gint * g, gint * b)
+{
+  __m128i t0 = _mm_unpacklo_epi32 (p0, p1);
+  __m128i t1 = _mm_unpacklo_epi32 (p2, p3);
+  __m128i t2 = _mm_unpackhi_epi32 (p0, p1);
+  __m128i t3 = _mm_unpackhi_epi32 (p2, p3);
+
+  if (a)
+    _mm_storeu_si128 ((__m128i *) a, _mm_unpacklo_epi64 (t0, t1));
+  _mm_storeu_si128 ((__m128i *) r, _mm_unpackhi_epi64 (t0, t1));
+  _mm_storeu_si128 ((__m128i *) g, _mm_unpacklo_epi64 (t2, t3));
+  _mm_storeu_si128 ((__m128i *) b, _mm_unpackhi_epi64 (t2, t3));
+}
+#endif
+
+#ifdef HAVE_PACK_NEON
+static inline uint8x8_t
+narrow_8_neon (const gint * src)
+{
+  return vqmovn_u16 (vcombine_u16 (vqmovun_s32 (vld1q_s32 (src)),
+          vqmovun_s32 (vld1q_s32 (src + 4))));
+}
+
+static inline uint16x4_t
+narrow_16_neon (const gint * src, int32x4_t shift)
+{
+  return vreinterpret_u16_s16 (vmovn_s32 (vshlq_s32 (vld1q_s32 (src),
+              shift)));
+}
+
+static inline void
+store_widened_8_neon (gint * dest, uint8x8_t v)
+{
+  uint16x8_t w = vmovl_u8 (v);
+
+  vst1q_s32 (dest, vreinterpretq_s32_u32 (vmovl_u16 (vget_low_u16 (w))));
+  vst1q_s32 (dest + 4, vreinterpretq_s32_u32 (vmovl_u16 (vget_high_u16 (w))));
+}
+
+static inline void
+store_widened_16_neon (gint * dest, uint16x4_t v)
+{
+  vst1q_s32 (dest, vreinterpretq_s32_u32 (vmovl_u16 (v)));
+}
+#endif
+
+void
+gst_openjpeg_pack_row_8 (guint8 * dest, const gint * src, gint width)
+{
+  gint x = 0;
+
+#ifdef HAVE_PACK_SSE2
+  const __m128i noshift = _mm_setzero_si128 ();
+
+  for (; x + 16 <= width; x += 16)
+    _mm_storeu_si128 ((__m128i *) (dest + x),
+        _mm_packus_epi16 (narrow_16_sse2 (src + x, noshift),
+            narrow_16_sse2 (src + x + 8, noshift)));
+#elif defined (HAVE_PACK_NEON)
+  for (; x + 8 <= width; x += 8)
+    vst1_u8 (dest + x, narrow_8_neon (src + x));
+#endif
+
+  for (; x < width; x++)
+    dest[x] = src[x];
+}
+
+void
+gst_openjpeg_pack_row_16 (guint16 * dest, const gint * src, gint shift,
+    gint width)
+{
+  gint x = 0;
+
+#ifdef HAVE_PACK_SSE2
+  const __m128i sh = _mm_cvtsi32_si128 (shift);
+
+  for (; x + 8 <= width; x += 8)
+    _mm_storeu_si128 ((__m128i *) (dest + x), narrow_16_sse2 (src + x, sh));
+#elif defined (HAVE_PACK_NEON)
+  const int32x4_t sh = vdupq_n_s32 (shift);
+
+  for (; x + 8 <= width; x += 8)
+    vst1q_u16 (dest + x, vcombine_u16 (narrow_16_neon (src + x, sh),
+            narrow_16_neon (src + x + 4, sh)));
+#endif
+
+  for (; x < width; x++)
+    dest[x] = src[x] << shift;
+}
+
+void
+gst_openjpeg_pack_row_argb (guint8 * dest, const gint * a, const gint * r,
+    const gint * g, const gint * b, gint width)
+{
+  gint x = 0;
+
+#ifdef HAVE_PACK_SSE2
+  const __m128i noshift = _mm_setzero_si128 ();
+  const __m128i opaque = _mm_set1_epi16 (0xff);
+
+  for (; x + 8 <= width; x += 8) {
+    __m128i va = a ? narrow_16_sse2 (a + x, noshift) : opaque;
+    __m128i vr = narrow_16_sse2 (r + x, noshift);
+    __m128i vg = narrow_16_sse2 (g + x, noshift);
+    __m128i vb = narrow_16_sse2 (b + x, noshift);
+    __m128i ar_lo = _mm_unpacklo_epi16 (va, vr);
+    __m128i ar_hi = _mm_unpackhi_epi16 (va, vr);
+    __m128i gb_lo = _mm_unpacklo_epi16 (vg, vb);
+    __m128i gb_hi = _mm_unpackhi_epi16 (vg, vb);
+
+    _mm_storeu_si128 ((__m128i *) (dest + 4 * x),
+        _mm_packus_epi16 (_mm_unpacklo_epi32 (ar_lo, gb_lo),
+            _mm_unpackhi_epi32 (ar_lo, gb_lo)));
+    _mm_storeu_si128 ((__m128i *) (dest + 4 * x + 16),
+        _mm_packus_epi16 (_mm_unpacklo_epi32 (ar_hi, gb_hi),
+            _mm_unpackhi_epi32 (ar_hi, gb_hi)));
+  }
+#elif defined (HAVE_PACK_NEON)
+  for (; x + 8 <= width; x += 8) {
+    uint8x8x4_t v;
+
+    v.val[0] = a ? narrow_8_neon (a + x) : vdup_n_u8 (0xff);
+    v.val[1] = narrow_8_neon (r + x);
+    v.val[2] = narrow_8_neon (g + x);
+    v.val[3] = narrow_8_neon (b + x);
+    vst4_u8 (dest + 4 * x, v);
+  }
+#endif
+
+  for (; x < width; x++) {
+    dest[4 * x + 0] = a ? a[x] : 0xff;
+    dest[4 * x + 1] = r[x];
+    dest[4 * x + 2] = g[x];
+    dest[4 * x + 3] = b[x];
+  }
+}
+
+void
+gst_openjpeg_pack_row_argb64 (guint16 * dest, const gint * a, const gint * r,
+    const gint * g, const gint * b, const gint shift[4], gint width)
+{
+  gint x = 0;
+
+#ifdef HAVE_PACK_SSE2
+  const __m128i sh_a = _mm_cvtsi32_si128 (shift[0]);
+  const __m128i sh_r = _mm_cvtsi32_si128 (shift[1]);
+  const __m128i sh_g = _mm_cvtsi32_si128 (shift[2]);
+  const __m128i sh_b = _mm_cvtsi32_si128 (shift[3]);
+  const __m128i opaque = _mm_set1_epi16 (-1);
+
+  for (; x + 8 <= width; x += 8) {
+    __m128i va = a ? narrow_16_sse2 (a + x, sh_a) : opaque;
+    __m128i vr = narrow_16_sse2 (r + x, sh_r);
+    __m128i vg = narrow_16_sse2 (g + x, sh_g);
+    __m128i vb = narrow_16_sse2 (b + x, sh_b);
+    __m128i ar_lo = _mm_unpacklo_epi16 (va, vr);
+    __m128i ar_hi = _mm_unpackhi_epi16 (va, vr);
+    __m128i gb_lo = _mm_unpacklo_epi16 (vg, vb);
+    __m128i gb_hi = _mm_unpackhi_epi16 (vg, vb);
+
+    _mm_storeu_si128 ((__m128i *) (dest + 4 * x),
+        _mm_unpacklo_epi32 (ar_lo, gb_lo));
+    _mm_storeu_si128 ((__m128i *) (dest + 4 * x + 8),
+        _mm_unpackhi_epi32 (ar_lo, gb_lo));
+    _mm_storeu_si128 ((__m128i *) (dest + 4 * x + 16),
+        _mm_unpacklo_epi32 (ar_hi, gb_hi));
+    _mm_storeu_si128 ((__m128i *) (dest + 4 * x + 24),
+        _mm_unpackhi_epi32 (ar_hi, gb_hi));
+  }
+#elif defined (HAVE_PACK_NEON)
+  const int32x4_t sh_a = vdupq_n_s32 (shift[0]);
+  const int32x4_t sh_r = vdupq_n_s32 (shift[1]);
+  const int32x4_t sh_g = vdupq_n_s32 (shift[2]);
+  const int32x4_t sh_b = vdupq_n_s32 (shift[3]);
+
+  for (; x + 4 <= width; x += 4) {
+    uint16x4x4_t v;
+
+    v.val[0] = a ? narrow_16_neon (a + x, sh_a) : vdup_n_u16 (0xffff);
+    v.val[1] = narrow_16_neon (r + x, sh_r);
+    v.val[2] = narrow_16_neon (g + x, sh_g);
+    v.val[3] = narrow_16_neon (b + x, sh_b);
+    vst4_u16 (dest + 4 * x, v);
+  }
+#endif
+
+  for (; x < width; x++) {
+    dest[4 * x + 0] = a ? a[x] << shift[0] : 0xffff;
+    dest[4 * x + 1] = r[x] << shift[1];
+    dest[4 * x + 2] = g[x] << shift[2];
+    dest[4 * x + 3] = b[x] << shift[3];
+  }
+}
+
+void
+gst_openjpeg_unpack_row_8 (gint * dest, const guint8 * src, gint width)
+{
+  gint x = 0;
+
+#ifdef HAVE_PACK_SSE2
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (; x + 16 <= width; x += 16) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (src + x));
+    __m128i lo = _mm_unpacklo_epi8 (v, zero);
+    __m128i hi = _mm_unpackhi_epi8 (v, zero);
+
+    _mm_storeu_si128 ((__m128i *) (dest + x), _mm_unpacklo_epi16 (lo, zero));
+    _mm_storeu_si128 ((__m128i *) (dest + x + 4),
+        _mm_unpackhi_epi16 (lo, zero));
+    _mm_storeu_si128 ((__m128i *) (dest + x + 8),
+        _mm_unpacklo_epi16 (hi, zero));
+    _mm_storeu_si128 ((__m128i *) (dest + x + 12),
+        _mm_unpackhi_epi16 (hi, zero));
+  }
+#elif defined (HAVE_PACK_NEON)
+  for (; x + 8 <= width; x += 8)
+    store_widened_8_neon (dest + x, vld1_u8 (src + x));
+#endif
+
+  for (; x < width; x++)
+    dest[x] = src[x];
+}
+
+void
+gst_openjpeg_unpack_row_16 (gint * dest, const guint16 * src, gint width)
+{
+  gint x = 0;
+
+#ifdef HAVE_PACK_SSE2
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (; x + 8 <= width; x += 8) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (src + x));
+
+    _mm_storeu_si128 ((__m128i *) (dest + x), _mm_unpacklo_epi16 (v, zero));
+    _mm_storeu_si128 ((__m128i *) (dest + x + 4),
+        _mm_unpackhi_epi16 (v, zero));
+  }
+#elif defined (HAVE_PACK_NEON)
+  for (; x + 8 <= width; x += 8) {
+    uint16x8_t v = vld1q_u16 (src + x);
+
+    store_widened_16_neon (dest + x, vget_low_u16 (v));
+    store_widened_16_neon (dest + x + 4, vget_high_u16 (v));
+  }
+#endif
+
+  for (; x < width; x++)
+    dest[x] = src[x];
+}
+
+void
+gst_openjpeg_unpack_row_argb (gint * a, gint * r, gint * g, gint * b,
+    const guint8 * src, gint width)
+{
+  gint x = 0;
+
+#ifdef HAVE_PACK_SSE2
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (; x + 4 <= width; x += 4) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (src + 4 * x));
+    __m128i lo = _mm_unpacklo_epi8 (v, zero);
+    __m128i hi = _mm_unpackhi_epi8 (v, zero);
+
+    store_transposed_sse2 (_mm_unpacklo_epi16 (lo, zero),
+        _mm_unpackhi_epi16 (lo, zero), _mm_unpacklo_epi16 (hi, zero),
+        _mm_unpackhi_epi16 (hi, zero), a ? a + x : NULL, r + x, g + x, b + x);
+  }
+#elif defined (HAVE_PACK_NEON)
+  for (; x + 8 <= width; x += 8) {
+    uint8x8x4_t v = vld4_u8 (src + 4 * x);
+
+    if (a)
+      store_widened_8_neon (a + x, v.val[0]);
+    store_widened_8_neon (r + x, v.val[1]);
+    store_widened_8_neon (g + x, v.val[2]);
+    store_widened_8_neon (b + x, v.val[3]);
+  }
+#endif
+
+  for (; x < width; x++) {
+    if (a)
+      a[x] = src[4 * x + 0];
+    r[x] = src[4 * x + 1];
+    g[x] = src[4 * x + 2];
+    b[x] = src[4 * x + 3];
+  }
+}
+
+void
+gst_openjpeg_unpack_row_argb64 (gint * a, gint * r, gint * g, gint * b,
+    const guint16 * src, gint width)
+{
+  gint x = 0;
+
+#ifdef HAVE_PACK_SSE2
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (; x + 4 <= width; x += 4) {
+    __m128i v0 = _mm_loadu_si128 ((const __m128i *) (src + 4 * x));
+    __m128i v1 = _mm_loadu_si128 ((const __m128i *) (src + 4 * x + 8));
+
+    store_transposed_sse2 (_mm_unpacklo_epi16 (v0, zero),
+        _mm_unpackhi_epi16 (v0, zero), _mm_unpacklo_epi16 (v1, zero),
+        _mm_unpackhi_epi16 (v1, zero), a ? a + x : NULL, r + x, g + x, b + x);
+  }
+#elif defined (HAVE_PACK_NEON)
+  for (; x + 4 <= width; x += 4) {
+    uint16x4x4_t v = vld4_u16 (src + 4 * x);
+
+    if (a)
+      store_widened_16_neon (a + x, v.val[0]);
+    store_widened_16_neon (r + x, v.val[1]);
+    store_widened_16_neon (g + x, v.val[2]);
+    store_widened_16_neon (b + x, v.val[3]);
+  }
+#endif
+
+  for (; x < width; x++) {
+    if (a)
+      a[x] = src[4 * x + 0];
+    r[x] = src[4 * x + 1];
+    g[x] = src[4 * x + 2];
+    b[x] = src[4 * x + 3];
+  }
+}
@@ -0,0 +1,51 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef __GST_OPENJPEG_PACK_H__
+#define __GST_OPENJPEG_PACK_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Conversion of one row of pixels between the 32 bit component planes of
+ * an opj_image_t and 8 or 16 bit video frames. The packed variants use
+ * the component order of ARGB/AYUV, an alpha of NULL is written as fully
+ * opaque and not read when unpacking. */
+
+void gst_openjpeg_pack_row_8        (guint8 * dest, const gint * src, gint width);
+void gst_openjpeg_pack_row_16       (guint16 * dest, const gint * src,
+                                     gint shift, gint width);
+void gst_openjpeg_pack_row_argb     (guint8 * dest, const gint * a,
+                                     const gint * r, const gint * g,
+                                     const gint * b, gint width);
+void gst_openjpeg_pack_row_argb64   (guint16 * dest, const gint * a,
+                                     const gint * r, const gint * g,
+                                     const gint * b, const gint shift[4],
+                                     gint width);
+
+void gst_openjpeg_unpack_row_8      (gint * dest, const guint8 * src, gint width);
+void gst_openjpeg_unpack_row_16     (gint * dest, const guint16 * src, gint width);
+void gst_openjpeg_unpack_row_argb   (gint * a, gint * r, gint * g, gint * b,
+                                     const guint8 * src, gint width);
+void gst_openjpeg_unpack_row_argb64 (gint * a, gint * r, gint * g, gint * b,
+                                     const guint16 * src, gint width);
+
+G_END_DECLS
+
+#endif /* __GST_OPENJPEG_PACK_H__ */
@@ -45,13 +45,12 @@ GST_STATIC_PAD_TEMPLATE ("sink",
     GST_STATIC_CAPS ("image/webp")
     );
 
-/*Fixme: Add YUV support */
 static GstStaticPadTemplate gst_webp_dec_src_pad_template =
 GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE
-        ("{ RGB, RGBA, BGR, BGRA, ARGB, RGB16}"))
+        ("{ RGB, RGBA, BGR, BGRA, ARGB, RGB16, I420 }"))
     );
 
 GST_DEBUG_CATEGORY_STATIC (webp_dec_debug);
@@ -349,6 +348,69 @@ error:
   return GST_FLOW_ERROR;
 }
 
+/* Returns the libwebp output mode that decodes straight into frames of
+ * @format, FALSE if images with or without alpha can't be output in it */
+static gboolean
+gst_webp_dec_get_colorspace (GstVideoFormat format, gboolean has_alpha,
+    WEBP_CSP_MODE * colorspace)
+{
+  switch (format) {
+    case GST_VIDEO_FORMAT_RGBA:
+      *colorspace = MODE_RGBA;
+      return TRUE;
+    case GST_VIDEO_FORMAT_BGRA:
+      *colorspace = MODE_BGRA;
+      return TRUE;
+    case GST_VIDEO_FORMAT_ARGB:
+      *colorspace = MODE_ARGB;
+      return TRUE;
+    case GST_VIDEO_FORMAT_RGB:
+      *colorspace = MODE_RGB;
+      return !has_alpha;
+    case GST_VIDEO_FORMAT_BGR:
+      *colorspace = MODE_BGR;
+      return !has_alpha;
+    case GST_VIDEO_FORMAT_I420:
+      *colorspace = MODE_YUV;
+      return !has_alpha;
+    default:
+      return FALSE;
+  }
+}
+
+/* Picks the first format downstream prefers that libwebp can decode to,
+ * so that no conversion is needed after decoding */
+static GstVideoFormat
+gst_webp_dec_choose_format (GstWebPDec * dec, gboolean has_alpha)
+{
+  GstVideoFormat format;
+  WEBP_CSP_MODE colorspace;
+  GstCaps *allowed;
+  guint i;
+
+  allowed = gst_pad_get_allowed_caps (GST_VIDEO_DECODER_SRC_PAD (dec));
+  if (allowed) {
+    allowed = gst_caps_normalize (allowed);
+
+    for (i = 0; i < gst_caps_get_size (allowed); i++) {
+      const gchar *str = gst_structure_get_string (gst_caps_get_structure
+          (allowed, i), "format");
+
+      if (!str)
+        continue;
+
+      format = gst_video_format_from_string (str);
+      if (gst_webp_dec_get_colorspace (format, has_alpha, &colorspace)) {
+        gst_caps_unref (allowed);
+        return format;
+      }
+    }
+    gst_caps_unref (allowed);
+  }
+
+  return has_alpha ? GST_VIDEO_FORMAT_ARGB : GST_VIDEO_FORMAT_RGB;
+}
+
 static GstFlowReturn
 gst_webp_dec_update_src_caps (GstWebPDec * dec, GstMapInfo * map_info)
 {
@@ -367,27 +429,23 @@ gst_webp_dec_update_src_caps (GstWebPDec * dec, GstMapInfo * map_info)
     return GST_FLOW_ERROR;
   }
 
-  /* TODO: Add support for other formats */
-  if (features.has_alpha) {
-    format = GST_VIDEO_FORMAT_ARGB;
-    dec->colorspace = MODE_ARGB;
-  } else {
-    format = GST_VIDEO_FORMAT_RGB;
-    dec->colorspace = MODE_RGB;
-  }
-
-  /* Check if output state changed */
+  /* Keep the current format as long as it can hold the image */
   if (dec->output_state) {
     GstVideoInfo *info = &dec->output_state->info;
 
     if (features.width == GST_VIDEO_INFO_WIDTH (info) &&
         features.height == GST_VIDEO_INFO_HEIGHT (info) &&
-        GST_VIDEO_INFO_FORMAT (info) == format) {
+        gst_webp_dec_get_colorspace (GST_VIDEO_INFO_FORMAT (info),
+            features.has_alpha, &dec->colorspace)) {
       goto beach;
     }
     gst_video_codec_state_unref (dec->output_state);
   }
 
+  format = gst_webp_dec_choose_format (dec, features.has_alpha);
+  gst_webp_dec_get_colorspace (format, features.has_alpha, &dec->colorspace);
+  GST_DEBUG_OBJECT (dec, "decoding to %s", gst_video_format_to_string (format));
+
   dec->output_state =
       gst_video_decoder_set_output_state (GST_VIDEO_DECODER (dec), format,
       features.width, features.height, dec->input_state);
@@ -442,12 +500,33 @@ gst_webp_dec_handle_frame (GstVideoDecoder * decoder,
   webpdec->config.options.no_fancy_upsampling = webpdec->no_fancy_upsampling;
   webpdec->config.options.use_threads = webpdec->use_threads;
   webpdec->config.output.colorspace = webpdec->colorspace;
-  webpdec->config.output.u.RGBA.rgba = (uint8_t *) vframe.map[0].data;
-  webpdec->config.output.u.RGBA.stride =
-      GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 0);
-  webpdec->config.output.u.RGBA.size = GST_VIDEO_FRAME_SIZE (&vframe);
   webpdec->config.output.is_external_memory = 1;
 
+  /* libwebp writes straight into the planes of the output frame */
+  if (webpdec->colorspace == MODE_YUV) {
+    WebPYUVABuffer *yuva = &webpdec->config.output.u.YUVA;
+
+    yuva->y = GST_VIDEO_FRAME_COMP_DATA (&vframe, 0);
+    yuva->u = GST_VIDEO_FRAME_COMP_DATA (&vframe, 1);
+    yuva->v = GST_VIDEO_FRAME_COMP_DATA (&vframe, 2);
+    yuva->a = NULL;
+    yuva->y_stride = GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 0);
+    yuva->u_stride = GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 1);
+    yuva->v_stride = GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 2);
+    yuva->a_stride = 0;
+    yuva->y_size = yuva->y_stride * GST_VIDEO_FRAME_COMP_HEIGHT (&vframe, 0);
+    yuva->u_size = yuva->u_stride * GST_VIDEO_FRAME_COMP_HEIGHT (&vframe, 1);
+    yuva->v_size = yuva->v_stride * GST_VIDEO_FRAME_COMP_HEIGHT (&vframe, 2);
+    yuva->a_size = 0;
+  } else {
+    webpdec->config.output.u.RGBA.rgba = GST_VIDEO_FRAME_PLANE_DATA (&vframe, 0);
+    webpdec->config.output.u.RGBA.stride =
+        GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 0);
+    webpdec->config.output.u.RGBA.size =
+        GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 0) *
+        GST_VIDEO_FRAME_HEIGHT (&vframe);
+  }
+
   if (WebPDecode (map_info.data, map_info.size,
           &webpdec->config) != VP8_STATUS_OK) {
     GST_ERROR_OBJECT (decoder, "Failed to decode the webp frame");
@@ -37,13 +37,17 @@ enum
   PROP_LOSSLESS,
   PROP_QUALITY,
   PROP_SPEED,
-  PROP_PRESET
+  PROP_PRESET,
+  PROP_MAX_THREADS
 };
 
 #define DEFAULT_LOSSLESS FALSE
 #define DEFAULT_QUALITY 90
 #define DEFAULT_SPEED 4
 #define DEFAULT_PRESET WEBP_PRESET_PHOTO
+#define DEFAULT_MAX_THREADS 1
+
+static void gst_webp_enc_finalize (GObject * object);
 
 static void gst_webp_enc_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -51,6 +55,12 @@ static void gst_webp_enc_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static gboolean gst_webp_enc_start (GstVideoEncoder * benc);
 static gboolean gst_webp_enc_stop (GstVideoEncoder * benc);
+static gboolean gst_webp_enc_flush (GstVideoEncoder * benc);
+static GstFlowReturn gst_webp_enc_finish (GstVideoEncoder * benc);
+static void gst_webp_enc_encode_job (gpointer data, gpointer user_data);
+static GstFlowReturn gst_webp_enc_output_job (gpointer data,
+    gpointer user_data);
+static void gst_webp_enc_drop_job (gpointer data, gpointer user_data);
 static gboolean gst_webp_enc_set_format (GstVideoEncoder * encoder,
     GstVideoCodecState * state);
 static GstFlowReturn gst_webp_enc_handle_frame (GstVideoEncoder * encoder,
@@ -121,6 +131,7 @@ gst_webp_enc_class_init (GstWebpEncClass * klass)
 
   parent_class = g_type_class_peek_parent (klass);
 
+  gobject_class->finalize = gst_webp_enc_finalize;
   gobject_class->set_property = gst_webp_enc_set_property;
   gobject_class->get_property = gst_webp_enc_get_property;
   gst_element_class_add_pad_template (element_class,
@@ -134,6 +145,8 @@ gst_webp_enc_class_init (GstWebpEncClass * klass)
 
   venc_class->start = gst_webp_enc_start;
   venc_class->stop = gst_webp_enc_stop;
+  venc_class->flush = gst_webp_enc_flush;
+  venc_class->finish = gst_webp_enc_finish;
   venc_class->set_format = gst_webp_enc_set_format;
   venc_class->handle_frame = gst_webp_enc_handle_frame;
   venc_class->propose_allocation = gst_webp_enc_propose_allocation;
@@ -156,6 +169,21 @@ gst_webp_enc_class_init (GstWebpEncClass * klass)
           GST_WEBP_ENC_PRESET_TYPE, DEFAULT_PRESET,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstWebpEnc:max-threads:
+   *
+   * Maximum number of frames that are encoded in parallel, each by its own
+   * thread. Frames are still output in order, which adds a latency of
+   * max-threads - 1 frames. Changes take effect on the next start.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum threads",
+          "Maximum number of frames encoded in parallel (0 = auto)",
+          0, GST_PARALLEL_MAX_THREADS, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   GST_DEBUG_CATEGORY_INIT (webpenc_debug, "webpenc", 0,
       "WEBP encoding element");
 }
@@ -170,8 +198,89 @@ gst_webp_enc_init (GstWebpEnc * webpenc)
 
   webpenc->use_argb = FALSE;
   webpenc->rgb_format = GST_VIDEO_FORMAT_UNKNOWN;
+
+  webpenc->max_threads = DEFAULT_MAX_THREADS;
+  gst_parallel_queue_init (&webpenc->queue, gst_webp_enc_encode_job,
+      gst_webp_enc_output_job, gst_webp_enc_drop_job, webpenc);
+  g_mutex_init (&webpenc->lock);
+}
+
+static void
+gst_webp_enc_finalize (GObject * object)
+{
+  GstWebpEnc *webpenc = GST_WEBP_ENC (object);
+
+  gst_parallel_queue_clear (&webpenc->queue);
+  g_mutex_clear (&webpenc->lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+/* A picture and output writer, reused for all frames of the same format.
+ * Every frame being encoded takes one from the idle list. */
+typedef struct
+{
+  WebPPicture picture;
+  WebPMemoryWriter writer;
+} GstWebpEncContext;
+
+static GstWebpEncContext *
+gst_webp_enc_get_context (GstWebpEnc * enc)
+{
+  GstWebpEncContext *ctx = NULL;
+  GstVideoInfo *info = &enc->input_state->info;
+
+  g_mutex_lock (&enc->lock);
+  if (enc->contexts) {
+    ctx = enc->contexts->data;
+    enc->contexts = g_slist_delete_link (enc->contexts, enc->contexts);
+  }
+  g_mutex_unlock (&enc->lock);
+
+  if (ctx)
+    return ctx;
+
+  ctx = g_slice_new0 (GstWebpEncContext);
+  if (!WebPPictureInit (&ctx->picture)) {
+    g_slice_free (GstWebpEncContext, ctx);
+    return NULL;
+  }
+
+  ctx->picture.width = GST_VIDEO_INFO_WIDTH (info);
+  ctx->picture.height = GST_VIDEO_INFO_HEIGHT (info);
+
+  WebPMemoryWriterInit (&ctx->writer);
+  ctx->picture.writer = WebPMemoryWrite;
+  ctx->picture.custom_ptr = &ctx->writer;
+
+  return ctx;
+}
+
+static void
+gst_webp_enc_release_context (GstWebpEnc * enc, GstWebpEncContext * ctx)
+{
+  g_mutex_lock (&enc->lock);
+  enc->contexts = g_slist_prepend (enc->contexts, ctx);
+  g_mutex_unlock (&enc->lock);
+}
+
+static void
+gst_webp_enc_context_free (GstWebpEncContext * ctx)
+{
+  WebPPictureFree (&ctx->picture);
+  free (ctx->writer.mem);
+  g_slice_free (GstWebpEncContext, ctx);
+}
+
+/* Must only be called when no frame is being encoded */
+static void
+gst_webp_enc_free_contexts (GstWebpEnc * enc)
+{
+  g_slist_free_full (enc->contexts, (GDestroyNotify) gst_webp_enc_context_free);
+  enc->contexts = NULL;
 }
 
+
 static gboolean
 gst_webp_enc_set_format (GstVideoEncoder * encoder, GstVideoCodecState * state)
 {
@@ -179,10 +288,18 @@ gst_webp_enc_set_format (GstVideoEncoder * encoder, GstVideoCodecState * state)
   GstVideoCodecState *output_state;
   GstVideoInfo *info;
   GstVideoFormat format;
+  GstClockTime latency = 0;
 
   info = &state->info;
   format = GST_VIDEO_INFO_FORMAT (info);
 
+  /* frames still being encoded belong to the previous format */
+  gst_parallel_queue_drain (&enc->queue);
+  gst_webp_enc_free_contexts (enc);
+
+  enc->use_argb = FALSE;
+  enc->rgb_format = GST_VIDEO_FORMAT_UNKNOWN;
+
   if (GST_VIDEO_INFO_IS_YUV (info)) {
     switch (format) {
       case GST_VIDEO_FORMAT_I420:
@@ -208,102 +325,259 @@ gst_webp_enc_set_format (GstVideoEncoder * encoder, GstVideoCodecState * state)
       gst_caps_new_empty_simple ("image/webp"), enc->input_state);
   gst_video_codec_state_unref (output_state);
 
+  /* a frame is output when the frame n_threads - 1 frames later came in */
+  if (enc->queue.n_threads > 1 && info->fps_n > 0)
+    latency =
+        gst_util_uint64_scale_ceil ((enc->queue.n_threads - 1) * GST_SECOND,
+        info->fps_d, info->fps_n);
+  gst_video_encoder_set_latency (encoder, latency, latency);
+
   return TRUE;
 }
 
+/* Lossless encoding works on ARGB. RGB input is packed into the
+ * picture's own buffer, which is allocated once and kept for all frames. */
 static gboolean
-gst_webp_set_picture_params (GstWebpEnc * enc)
+gst_webp_enc_fill_argb (GstWebpEnc * enc, WebPPicture * picture,
+    GstVideoFrame * vframe)
 {
-  GstVideoInfo *info;
-  gboolean ret = TRUE;
-
-  info = &enc->input_state->info;
+  const guint8 *src;
+  uint32_t *dest;
+  gint width, height, stride;
+  gint x, y;
+
+  if (picture->argb == NULL) {
+    picture->use_argb = 1;
+    if (!WebPPictureAlloc (picture))
+      return FALSE;
+  }
 
-  if (!WebPPictureInit (&enc->webp_picture)) {
-    ret = FALSE;
-    goto failed_pic_init;
+  width = GST_VIDEO_FRAME_WIDTH (vframe);
+  height = GST_VIDEO_FRAME_HEIGHT (vframe);
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (vframe, 0);
+
+  for (y = 0; y < height; y++) {
+    src = GST_VIDEO_FRAME_COMP_DATA (vframe, 0);
+    src += y * stride;
+    dest = picture->argb + y * picture->argb_stride;
+
+    if (enc->rgb_format == GST_VIDEO_FORMAT_RGBA) {
+      for (x = 0; x < width; x++) {
+        dest[x] = ((uint32_t) src[3] << 24) | (src[0] << 16) | (src[1] << 8)
+            | src[2];
+        src += 4;
+      }
+    } else {
+      for (x = 0; x < width; x++) {
+        dest[x] = 0xff000000u | (src[0] << 16) | (src[1] << 8) | src[2];
+        src += 3;
+      }
+    }
   }
 
-  enc->webp_picture.use_argb = enc->use_argb;
-  if (!enc->use_argb)
-    enc->webp_picture.colorspace = enc->webp_color_space;
+  return TRUE;
+}
 
-  enc->webp_picture.width = GST_VIDEO_INFO_WIDTH (info);
-  enc->webp_picture.height = GST_VIDEO_INFO_HEIGHT (info);
+static gboolean
+gst_webp_enc_fill_picture (GstWebpEnc * enc, WebPPicture * picture,
+    GstVideoFrame * vframe)
+{
+  /* YUV input is encoded from the mapped frame without any copy */
+  if (!enc->use_argb) {
+    picture->use_argb = 0;
+    picture->colorspace = enc->webp_color_space;
 
-  WebPMemoryWriterInit (&enc->webp_writer);
-  enc->webp_picture.writer = WebPMemoryWrite;
-  enc->webp_picture.custom_ptr = &enc->webp_writer;
+    picture->y = GST_VIDEO_FRAME_COMP_DATA (vframe, 0);
+    picture->u = GST_VIDEO_FRAME_COMP_DATA (vframe, 1);
+    picture->v = GST_VIDEO_FRAME_COMP_DATA (vframe, 2);
 
-  return ret;
+    picture->y_stride = GST_VIDEO_FRAME_COMP_STRIDE (vframe, 0);
+    picture->uv_stride = GST_VIDEO_FRAME_COMP_STRIDE (vframe, 1);
+
+    return TRUE;
+  }
 
-failed_pic_init:
-  {
-    GST_ERROR_OBJECT (enc, "Failed to Initialize WebPPicture !");
-    return ret;
+  if (enc->webp_config.lossless)
+    return gst_webp_enc_fill_argb (enc, picture, vframe);
+
+  /* Lossy encoding works on YUV, libwebp converts RGB to it in one pass */
+  picture->use_argb = 0;
+  switch (enc->rgb_format) {
+    case GST_VIDEO_FORMAT_RGB:
+      return WebPPictureImportRGB (picture,
+          GST_VIDEO_FRAME_COMP_DATA (vframe, 0),
+          GST_VIDEO_FRAME_COMP_STRIDE (vframe, 0));
+    case GST_VIDEO_FORMAT_RGBA:
+      return WebPPictureImportRGBA (picture,
+          GST_VIDEO_FRAME_COMP_DATA (vframe, 0),
+          GST_VIDEO_FRAME_COMP_STRIDE (vframe, 0));
+    default:
+      return FALSE;
   }
 }
 
-static GstFlowReturn
-gst_webp_enc_handle_frame (GstVideoEncoder * encoder,
-    GstVideoCodecFrame * frame)
+typedef enum
 {
-  GstWebpEnc *enc = GST_WEBP_ENC (encoder);
-  GstBuffer *out_buffer = NULL;
+  ENCODE_OK,
+  ENCODE_INIT_ERROR,
+  ENCODE_MAP_ERROR,
+  ENCODE_ERROR
+} EncodeResult;
+
+/* One frame, encoded in the streaming thread or by the thread pool */
+typedef struct
+{
+  GstVideoCodecFrame *frame;
+
+  GstBuffer *output;
+  EncodeResult result;
+  WebPEncodingError error_code;
+} GstWebpEncJob;
+
+static void
+gst_webp_enc_encode (GstWebpEnc * enc, GstWebpEncJob * job)
+{
+  GstWebpEncContext *ctx;
+  WebPPicture *picture;
   GstVideoFrame vframe;
+  gboolean ok;
 
-  GST_LOG_OBJECT (enc, "got new frame");
+  job->output = NULL;
 
-  gst_webp_set_picture_params (enc);
+  ctx = gst_webp_enc_get_context (enc);
+  if (!ctx) {
+    job->result = ENCODE_INIT_ERROR;
+    return;
+  }
+  picture = &ctx->picture;
 
   if (!gst_video_frame_map (&vframe, &enc->input_state->info,
-          frame->input_buffer, GST_MAP_READ))
-    return GST_FLOW_ERROR;
-
-  if (!enc->use_argb) {
-    enc->webp_picture.y = GST_VIDEO_FRAME_COMP_DATA (&vframe, 0);
-    enc->webp_picture.u = GST_VIDEO_FRAME_COMP_DATA (&vframe, 1);
-    enc->webp_picture.v = GST_VIDEO_FRAME_COMP_DATA (&vframe, 2);
+          job->frame->input_buffer, GST_MAP_READ)) {
+    job->result = ENCODE_MAP_ERROR;
+    goto done;
+  }
 
-    enc->webp_picture.y_stride = GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 0);
-    enc->webp_picture.uv_stride = GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 1);
+  ok = gst_webp_enc_fill_picture (enc, picture, &vframe)
+      && WebPEncode (&enc->webp_config, picture);
+  gst_video_frame_unmap (&vframe);
 
+  if (ok) {
+    job->output = gst_buffer_new_allocate (NULL, ctx->writer.size, NULL);
+    gst_buffer_fill (job->output, 0, ctx->writer.mem, ctx->writer.size);
+    job->result = ENCODE_OK;
   } else {
-    switch (enc->rgb_format) {
-      case GST_VIDEO_FORMAT_RGB:
-        WebPPictureImportRGB (&enc->webp_picture,
-            GST_VIDEO_FRAME_COMP_DATA (&vframe, 0),
-            GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 0));
-        break;
-      case GST_VIDEO_FORMAT_RGBA:
-        WebPPictureImportRGBA (&enc->webp_picture,
-            GST_VIDEO_FRAME_COMP_DATA (&vframe, 0),
-            GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 0));
-        break;
-      default:
-        break;
-    }
+    job->error_code = picture->error_code;
+    job->result = ENCODE_ERROR;
   }
 
-  if (WebPEncode (&enc->webp_config, &enc->webp_picture)) {
-    WebPPictureFree (&enc->webp_picture);
+  /* keep the writer's memory for the next frame */
+  ctx->writer.size = 0;
+
+  /* drop the pointers into the input frame, and anything libwebp
+   * converted them to for lossless encoding */
+  if (!enc->use_argb)
+    WebPPictureFree (picture);
+
+done:
+  gst_webp_enc_release_context (enc, ctx);
+}
+
+static void
+gst_webp_enc_encode_job (gpointer data, gpointer user_data)
+{
+  gst_webp_enc_encode (GST_WEBP_ENC (user_data), data);
+}
+
+/* Pushes an encoded frame, in the streaming thread and in input order */
+static GstFlowReturn
+gst_webp_enc_output_frame (GstWebpEnc * enc, GstWebpEncJob * job)
+{
+  GstVideoCodecFrame *frame = job->frame;
 
-    out_buffer = gst_buffer_new_allocate (NULL, enc->webp_writer.size, NULL);
-    if (!out_buffer) {
-      GST_ERROR_OBJECT (enc, "Failed to create output buffer");
+  switch (job->result) {
+    case ENCODE_INIT_ERROR:
+      gst_video_codec_frame_unref (frame);
+      GST_ELEMENT_ERROR (enc, LIBRARY, INIT,
+          ("Failed to initialize WebPPicture"), (NULL));
       return GST_FLOW_ERROR;
-    }
-    gst_buffer_fill (out_buffer, 0, enc->webp_writer.mem,
-        enc->webp_writer.size);
-    free (enc->webp_writer.mem);
-  } else {
-    GST_ERROR_OBJECT (enc, "Failed to encode WebPPicture");
-    return GST_FLOW_ERROR;
+    case ENCODE_MAP_ERROR:
+      gst_video_codec_frame_unref (frame);
+      GST_ELEMENT_ERROR (enc, CORE, FAILED,
+          ("Failed to map input buffer"), (NULL));
+      return GST_FLOW_ERROR;
+    case ENCODE_ERROR:
+      gst_video_codec_frame_unref (frame);
+      GST_ELEMENT_ERROR (enc, STREAM, ENCODE,
+          ("Failed to encode WebPPicture"), ("error code %d",
+              job->error_code));
+      return GST_FLOW_ERROR;
+    default:
+      break;
   }
 
-  gst_video_frame_unmap (&vframe);
-  frame->output_buffer = out_buffer;
-  return gst_video_encoder_finish_frame (encoder, frame);
+  frame->output_buffer = job->output;
+
+  return gst_video_encoder_finish_frame (GST_VIDEO_ENCODER (enc), frame);
+}
+
+static GstFlowReturn
+gst_webp_enc_output_job (gpointer data, gpointer user_data)
+{
+  GstWebpEncJob *job = data;
+  GstFlowReturn ret;
+
+  ret = gst_webp_enc_output_frame (GST_WEBP_ENC (user_data), job);
+  g_slice_free (GstWebpEncJob, job);
+
+  return ret;
+}
+
+static void
+gst_webp_enc_drop_job (gpointer data, gpointer user_data)
+{
+  GstWebpEncJob *job = data;
+
+  if (job->output)
+    gst_buffer_unref (job->output);
+  gst_video_codec_frame_unref (job->frame);
+  g_slice_free (GstWebpEncJob, job);
+}
+
+static gboolean
+gst_webp_enc_flush (GstVideoEncoder * benc)
+{
+  GstWebpEnc *enc = GST_WEBP_ENC (benc);
+
+  GST_DEBUG_OBJECT (enc, "flushing");
+
+  gst_parallel_queue_flush (&enc->queue);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_webp_enc_finish (GstVideoEncoder * benc)
+{
+  GstWebpEnc *enc = GST_WEBP_ENC (benc);
+
+  GST_DEBUG_OBJECT (enc, "draining");
+
+  return gst_parallel_queue_drain (&enc->queue);
+}
+
+static GstFlowReturn
+gst_webp_enc_handle_frame (GstVideoEncoder * encoder,
+    GstVideoCodecFrame * frame)
+{
+  GstWebpEnc *enc = GST_WEBP_ENC (encoder);
+  GstWebpEncJob *job;
+
+  GST_LOG_OBJECT (enc, "got new frame");
+
+  job = g_slice_new0 (GstWebpEncJob);
+  job->frame = frame;
+
+  return gst_parallel_queue_push (&enc->queue, job);
 }
 
 static gboolean
@@ -334,6 +608,9 @@ gst_webp_enc_set_property (GObject * object, guint prop_id,
     case PROP_PRESET:
       webpenc->preset = g_value_get_enum (value);
       break;
+    case PROP_MAX_THREADS:
+      webpenc->max_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -360,6 +637,9 @@ gst_webp_enc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_PRESET:
       g_value_set_enum (value, webpenc->preset);
       break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, webpenc->max_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -370,6 +650,7 @@ static gboolean
 gst_webp_enc_start (GstVideoEncoder * benc)
 {
   GstWebpEnc *enc = (GstWebpEnc *) benc;
+  guint threads;
 
   if (!WebPConfigPreset (&enc->webp_config, enc->preset, enc->quality)) {
     GST_ERROR_OBJECT (enc, "Failed to Initialize WebPConfig ");
@@ -382,6 +663,12 @@ gst_webp_enc_start (GstVideoEncoder * benc)
     GST_ERROR_OBJECT (enc, "Failed to Validate the WebPConfig");
     return FALSE;
   }
+
+  threads = gst_parallel_queue_start (&enc->queue, GST_OBJECT (enc),
+      enc->max_threads);
+
+  GST_INFO_OBJECT (enc, "encoding %u frames in parallel", threads);
+
   return TRUE;
 }
 
@@ -389,8 +676,14 @@ static gboolean
 gst_webp_enc_stop (GstVideoEncoder * benc)
 {
   GstWebpEnc *enc = GST_WEBP_ENC (benc);
-  if (enc->input_state)
+
+  gst_parallel_queue_stop (&enc->queue);
+  gst_webp_enc_free_contexts (enc);
+
+  if (enc->input_state) {
     gst_video_codec_state_unref (enc->input_state);
+    enc->input_state = NULL;
+  }
   return TRUE;
 }
 
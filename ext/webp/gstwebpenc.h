@@ -21,6 +21,7 @@
 
 #include <gst/gst.h>
 #include <gst/video/video.h>
+#include <gst/parallel-private.h>
 #include <webp/encode.h>
 
 G_BEGIN_DECLS
@@ -60,8 +61,15 @@ struct _GstWebpEnc
 
   WebPEncCSP webp_color_space;
   struct WebPConfig webp_config;
-  struct WebPPicture webp_picture;
-  WebPMemoryWriter webp_writer;
+
+  guint max_threads;
+
+  /* frame threading */
+  GstParallelQueue queue;
+
+  /* pictures and writers not used by any frame, protected by lock */
+  GMutex lock;
+  GSList *contexts;
 };
 
 struct _GstWebpEncClass
@@ -200,6 +200,15 @@ gst_h264_parser_get_pps (GstH264NalParser * nalparser, guint8 pps_id)
   return NULL;
 }
 
+/* Raw bytes of the stored parameter sets. Streams commonly repeat them
+ * with every IDR frame or even every frame, an unchanged one is then
+ * copied from the store instead of being parsed again. */
+typedef struct
+{
+  NalCacheEntry sps[GST_H264_MAX_SPS_COUNT];
+  NalCacheEntry pps[GST_H264_MAX_PPS_COUNT];
+} GstH264ParamSetCache;
+
 static gboolean
 gst_h264_parse_nalu_header (GstH264NalUnit * nalu)
 {
@@ -388,6 +397,66 @@ gst_h264_sps_copy (GstH264SPS * dst_sps, const GstH264SPS * src_sps)
   return TRUE;
 }
 
+/* Fills @sps from the store if @nalu repeats a stored SPS, parsed with
+ * the same @parse_vui_params */
+static gboolean
+gst_h264_parser_find_cached_sps (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, gboolean parse_vui_params, GstH264SPS * sps)
+{
+  GstH264ParamSetCache *cache = nalparser->ps_cache;
+  gint id;
+
+  id = nal_cache_lookup (cache->sps, GST_H264_MAX_SPS_COUNT,
+      nalu->data + nalu->offset, nalu->size, ! !parse_vui_params);
+  if (id < 0 || !nalparser->sps[id].valid)
+    return FALSE;
+
+  GST_DEBUG ("sequence parameter set with id: %d unchanged", id);
+
+  *sps = nalparser->sps[id];
+  if (sps->extension_type == GST_H264_NAL_EXTENSION_MVC &&
+      !gst_h264_sps_mvc_copy (sps, &nalparser->sps[id]))
+    return FALSE;
+  nalparser->last_sps = &nalparser->sps[id];
+
+  return TRUE;
+}
+
+static void
+gst_h264_parser_cache_sps (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, gboolean parse_vui_params, guint id)
+{
+  GstH264ParamSetCache *cache = nalparser->ps_cache;
+
+  nal_cache_store (&cache->sps[id], nalu->data + nalu->offset, nalu->size,
+      ! !parse_vui_params);
+  /* parsing a PPS depends on its SPS */
+  nal_cache_clear (cache->pps, GST_H264_MAX_PPS_COUNT);
+}
+
+static gboolean
+gst_h264_parser_find_cached_pps (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264PPS * pps)
+{
+  GstH264ParamSetCache *cache = nalparser->ps_cache;
+  gint id;
+
+  id = nal_cache_lookup (cache->pps, GST_H264_MAX_PPS_COUNT,
+      nalu->data + nalu->offset, nalu->size, 0);
+  if (id < 0 || !nalparser->pps[id].valid)
+    return FALSE;
+
+  GST_DEBUG ("picture parameter set with id: %d unchanged", id);
+
+  *pps = nalparser->pps[id];
+  if (pps->slice_group_id)
+    pps->slice_group_id = g_memdup (pps->slice_group_id,
+        pps->pic_size_in_map_units_minus1 + 1);
+  nalparser->last_pps = &nalparser->pps[id];
+
+  return TRUE;
+}
+
 /****** Parsing functions *****/
 
 static gboolean
@@ -1245,6 +1314,7 @@ gst_h264_nal_parser_new (void)
   GstH264NalParser *nalparser;
 
   nalparser = g_slice_new0 (GstH264NalParser);
+  nalparser->ps_cache = g_slice_new0 (GstH264ParamSetCache);
   INITIALIZE_DEBUG_CATEGORY;
 
   return nalparser;
@@ -1259,12 +1329,16 @@ gst_h264_nal_parser_new (void)
 void
 gst_h264_nal_parser_free (GstH264NalParser * nalparser)
 {
+  GstH264ParamSetCache *cache = nalparser->ps_cache;
   guint i;
 
   for (i = 0; i < GST_H264_MAX_SPS_COUNT; i++)
     gst_h264_sps_clear (&nalparser->sps[i]);
   for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++)
     gst_h264_pps_clear (&nalparser->pps[i]);
+  nal_cache_clear (cache->sps, GST_H264_MAX_SPS_COUNT);
+  nal_cache_clear (cache->pps, GST_H264_MAX_PPS_COUNT);
+  g_slice_free (GstH264ParamSetCache, cache);
   g_slice_free (GstH264NalParser, nalparser);
 
   nalparser = NULL;
@@ -1490,14 +1564,19 @@ GstH264ParserResult
 gst_h264_parser_parse_sps (GstH264NalParser * nalparser, GstH264NalUnit * nalu,
     GstH264SPS * sps, gboolean parse_vui_params)
 {
-  GstH264ParserResult res = gst_h264_parse_sps (nalu, sps, parse_vui_params);
+  GstH264ParserResult res;
+
+  if (gst_h264_parser_find_cached_sps (nalparser, nalu, parse_vui_params, sps))
+    return GST_H264_PARSER_OK;
 
+  res = gst_h264_parse_sps (nalu, sps, parse_vui_params);
   if (res == GST_H264_PARSER_OK) {
     GST_DEBUG ("adding sequence parameter set with id: %d to array", sps->id);
 
     if (!gst_h264_sps_copy (&nalparser->sps[sps->id], sps))
       return GST_H264_PARSER_ERROR;
     nalparser->last_sps = &nalparser->sps[sps->id];
+    gst_h264_parser_cache_sps (nalparser, nalu, parse_vui_params, sps->id);
   }
   return res;
 }
@@ -1841,6 +1920,9 @@ gst_h264_parser_parse_subset_sps (GstH264NalParser * nalparser,
 {
   GstH264ParserResult res;
 
+  if (gst_h264_parser_find_cached_sps (nalparser, nalu, parse_vui_params, sps))
+    return GST_H264_PARSER_OK;
+
   res = gst_h264_parse_subset_sps (nalu, sps, parse_vui_params);
   if (res == GST_H264_PARSER_OK) {
     GST_DEBUG ("adding sequence parameter set with id: %d to array", sps->id);
@@ -1848,6 +1930,7 @@ gst_h264_parser_parse_subset_sps (GstH264NalParser * nalparser,
     if (!gst_h264_sps_copy (&nalparser->sps[sps->id], sps))
       return GST_H264_PARSER_ERROR;
     nalparser->last_sps = &nalparser->sps[sps->id];
+    gst_h264_parser_cache_sps (nalparser, nalu, parse_vui_params, sps->id);
   }
   return res;
 }
@@ -2058,14 +2141,21 @@ GstH264ParserResult
 gst_h264_parser_parse_pps (GstH264NalParser * nalparser,
     GstH264NalUnit * nalu, GstH264PPS * pps)
 {
-  GstH264ParserResult res = gst_h264_parse_pps (nalparser, nalu, pps);
+  GstH264ParamSetCache *cache = nalparser->ps_cache;
+  GstH264ParserResult res;
+
+  if (gst_h264_parser_find_cached_pps (nalparser, nalu, pps))
+    return GST_H264_PARSER_OK;
 
+  res = gst_h264_parse_pps (nalparser, nalu, pps);
   if (res == GST_H264_PARSER_OK) {
     GST_DEBUG ("adding picture parameter set with id: %d to array", pps->id);
 
     if (!gst_h264_pps_copy (&nalparser->pps[pps->id], pps))
       return GST_H264_PARSER_ERROR;
     nalparser->last_pps = &nalparser->pps[pps->id];
+    nal_cache_store (&cache->pps[pps->id], nalu->data + nalu->offset,
+        nalu->size, 0);
   }
 
   return res;
@@ -2088,22 +2178,10 @@ gst_h264_pps_clear (GstH264PPS * pps)
   pps->slice_group_id = NULL;
 }
 
-/**
- * gst_h264_parser_parse_slice_hdr:
- * @nalparser: a #GstH264NalParser
- * @nalu: The #GST_H264_NAL_SLICE #GstH264NalUnit to parse
- * @slice: The #GstH264SliceHdr to fill.
- * @parse_pred_weight_table: Whether to parse the pred_weight_table or not
- * @parse_dec_ref_pic_marking: Whether to parse the dec_ref_pic_marking or not
- *
- * Parses @data, and fills the @slice structure.
- *
- * Returns: a #GstH264ParserResult
- */
-GstH264ParserResult
-gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
-    GstH264NalUnit * nalu, GstH264SliceHdr * slice,
-    gboolean parse_pred_weight_table, gboolean parse_dec_ref_pic_marking)
+/* With @light, stops after bottom_field_flag */
+static GstH264ParserResult
+gst_h264_parser_parse_slice_hdr_internal (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice, gboolean light)
 {
   NalReader nr;
   gint pps_id;
@@ -2179,6 +2257,12 @@ gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
   else
     slice->max_pic_num = sps->max_frame_num;
 
+  if (light) {
+    slice->header_size = 0;
+    slice->n_emulation_prevention_bytes = 0;
+    return GST_H264_PARSER_OK;
+  }
+
   if (nalu->idr_pic_flag)
     READ_UE_MAX (&nr, slice->idr_pic_id, G_MAXUINT16);
 
@@ -2275,6 +2359,50 @@ error:
   return GST_H264_PARSER_ERROR;
 }
 
+/**
+ * gst_h264_parser_parse_slice_hdr:
+ * @nalparser: a #GstH264NalParser
+ * @nalu: The #GST_H264_NAL_SLICE #GstH264NalUnit to parse
+ * @slice: The #GstH264SliceHdr to fill.
+ * @parse_pred_weight_table: Whether to parse the pred_weight_table or not
+ * @parse_dec_ref_pic_marking: Whether to parse the dec_ref_pic_marking or not
+ *
+ * Parses @data, and fills the @slice structure.
+ *
+ * Returns: a #GstH264ParserResult
+ */
+GstH264ParserResult
+gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice,
+    gboolean parse_pred_weight_table, gboolean parse_dec_ref_pic_marking)
+{
+  return gst_h264_parser_parse_slice_hdr_internal (nalparser, nalu, slice,
+      FALSE);
+}
+
+/**
+ * gst_h264_parser_parse_slice_hdr_light:
+ * @nalparser: a #GstH264NalParser
+ * @nalu: The #GST_H264_NAL_SLICE #GstH264NalUnit to parse
+ * @slice: The #GstH264SliceHdr to fill.
+ *
+ * Parses the start of the slice header in @data, up to and including
+ * bottom_field_flag, which is enough to know the slice type and where
+ * pictures start. Only these fields of @slice are set, its header_size
+ * is 0.
+ *
+ * Returns: a #GstH264ParserResult
+ *
+ * Since: 1.6
+ */
+GstH264ParserResult
+gst_h264_parser_parse_slice_hdr_light (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice)
+{
+  return gst_h264_parser_parse_slice_hdr_internal (nalparser, nalu, slice,
+      TRUE);
+}
+
 /* Free MVC-specific data from subset SPS header */
 static void
 gst_h264_sps_mvc_clear (GstH264SPS * sps)
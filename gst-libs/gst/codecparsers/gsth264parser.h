@@ -1009,6 +1009,8 @@ struct _GstH264NalParser
   GstH264PPS pps[GST_H264_MAX_PPS_COUNT];
   GstH264SPS *last_sps;
   GstH264PPS *last_pps;
+  /* raw bytes of the parameter sets above */
+  gpointer ps_cache;
 };
 
 GstH264NalParser *gst_h264_nal_parser_new             (void);
@@ -1032,6 +1034,10 @@ GstH264ParserResult gst_h264_parser_parse_slice_hdr   (GstH264NalParser *nalpars
                                                        GstH264SliceHdr *slice, gboolean parse_pred_weight_table,
                                                        gboolean parse_dec_ref_pic_marking);
 
+GstH264ParserResult gst_h264_parser_parse_slice_hdr_light (GstH264NalParser *nalparser,
+                                                       GstH264NalUnit *nalu,
+                                                       GstH264SliceHdr *slice);
+
 GstH264ParserResult gst_h264_parser_parse_subset_sps  (GstH264NalParser *nalparser, GstH264NalUnit *nalu,
                                                        GstH264SPS *sps, gboolean parse_vui_params);
 
@@ -217,6 +217,26 @@ gst_h265_parser_get_pps (GstH265Parser * parser, guint8 pps_id)
   return NULL;
 }
 
+/* Raw bytes of the stored parameter sets. Streams commonly repeat them
+ * with every IRAP picture or even every picture, an unchanged one is
+ * then copied from the store instead of being parsed again. */
+typedef struct
+{
+  NalCacheEntry vps[GST_H265_MAX_VPS_COUNT];
+  NalCacheEntry sps[GST_H265_MAX_SPS_COUNT];
+  NalCacheEntry pps[GST_H265_MAX_PPS_COUNT];
+} GstH265ParamSetCache;
+
+/* Returns the id of the stored parameter set that @nalu repeats, parsed
+ * with the same @flags, or -1 */
+static gint
+gst_h265_parser_find_cached (NalCacheEntry * cache, guint n_entries,
+    GstH265NalUnit * nalu, guint flags)
+{
+  return nal_cache_lookup (cache, n_entries, nalu->data + nalu->offset,
+      nalu->size, flags);
+}
+
 static gboolean
 gst_h265_parse_nalu_header (GstH265NalUnit * nalu)
 {
@@ -1158,6 +1178,7 @@ gst_h265_parser_new (void)
   GstH265Parser *parser;
 
   parser = g_slice_new0 (GstH265Parser);
+  parser->ps_cache = g_slice_new0 (GstH265ParamSetCache);
   INITIALIZE_DEBUG_CATEGORY;
 
   return parser;
@@ -1172,6 +1193,12 @@ gst_h265_parser_new (void)
 void
 gst_h265_parser_free (GstH265Parser * parser)
 {
+  GstH265ParamSetCache *cache = parser->ps_cache;
+
+  nal_cache_clear (cache->vps, GST_H265_MAX_VPS_COUNT);
+  nal_cache_clear (cache->sps, GST_H265_MAX_SPS_COUNT);
+  nal_cache_clear (cache->pps, GST_H265_MAX_PPS_COUNT);
+  g_slice_free (GstH265ParamSetCache, cache);
   g_slice_free (GstH265Parser, parser);
   parser = NULL;
 }
@@ -1397,13 +1424,27 @@ GstH265ParserResult
 gst_h265_parser_parse_vps (GstH265Parser * parser, GstH265NalUnit * nalu,
     GstH265VPS * vps)
 {
-  GstH265ParserResult res = gst_h265_parse_vps (nalu, vps);
+  GstH265ParamSetCache *cache = parser->ps_cache;
+  GstH265ParserResult res;
+  gint id;
+
+  id = gst_h265_parser_find_cached (cache->vps, GST_H265_MAX_VPS_COUNT, nalu,
+      0);
+  if (id >= 0 && parser->vps[id].valid) {
+    GST_DEBUG ("video parameter set with id: %d unchanged", id);
+    *vps = parser->vps[id];
+    parser->last_vps = &parser->vps[id];
+    return GST_H265_PARSER_OK;
+  }
 
+  res = gst_h265_parse_vps (nalu, vps);
   if (res == GST_H265_PARSER_OK) {
     GST_DEBUG ("adding video parameter set with id: %d to array", vps->id);
 
     parser->vps[vps->id] = *vps;
     parser->last_vps = &parser->vps[vps->id];
+    nal_cache_store (&cache->vps[vps->id], nalu->data + nalu->offset,
+        nalu->size, 0);
   }
 
   return res;
@@ -1532,14 +1573,29 @@ GstH265ParserResult
 gst_h265_parser_parse_sps (GstH265Parser * parser, GstH265NalUnit * nalu,
     GstH265SPS * sps, gboolean parse_vui_params)
 {
-  GstH265ParserResult res =
-      gst_h265_parse_sps (parser, nalu, sps, parse_vui_params);
+  GstH265ParamSetCache *cache = parser->ps_cache;
+  GstH265ParserResult res;
+  gint id;
+
+  id = gst_h265_parser_find_cached (cache->sps, GST_H265_MAX_SPS_COUNT, nalu,
+      ! !parse_vui_params);
+  if (id >= 0 && parser->sps[id].valid) {
+    GST_DEBUG ("sequence parameter set with id: %d unchanged", id);
+    *sps = parser->sps[id];
+    parser->last_sps = &parser->sps[id];
+    return GST_H265_PARSER_OK;
+  }
 
+  res = gst_h265_parse_sps (parser, nalu, sps, parse_vui_params);
   if (res == GST_H265_PARSER_OK) {
     GST_DEBUG ("adding sequence parameter set with id: %d to array", sps->id);
 
     parser->sps[sps->id] = *sps;
     parser->last_sps = &parser->sps[sps->id];
+    nal_cache_store (&cache->sps[sps->id], nalu->data + nalu->offset,
+        nalu->size, ! !parse_vui_params);
+    /* parsing a PPS depends on its SPS */
+    nal_cache_clear (cache->pps, GST_H265_MAX_PPS_COUNT);
   }
 
   return res;
@@ -1900,32 +1956,36 @@ GstH265ParserResult
 gst_h265_parser_parse_pps (GstH265Parser * parser,
     GstH265NalUnit * nalu, GstH265PPS * pps)
 {
-  GstH265ParserResult res = gst_h265_parse_pps (parser, nalu, pps);
+  GstH265ParamSetCache *cache = parser->ps_cache;
+  GstH265ParserResult res;
+  gint id;
+
+  id = gst_h265_parser_find_cached (cache->pps, GST_H265_MAX_PPS_COUNT, nalu,
+      0);
+  if (id >= 0 && parser->pps[id].valid) {
+    GST_DEBUG ("picture parameter set with id: %d unchanged", id);
+    *pps = parser->pps[id];
+    parser->last_pps = &parser->pps[id];
+    return GST_H265_PARSER_OK;
+  }
+
+  res = gst_h265_parse_pps (parser, nalu, pps);
   if (res == GST_H265_PARSER_OK) {
     GST_DEBUG ("adding picture parameter set with id: %d to array", pps->id);
 
     parser->pps[pps->id] = *pps;
     parser->last_pps = &parser->pps[pps->id];
+    nal_cache_store (&cache->pps[pps->id], nalu->data + nalu->offset,
+        nalu->size, 0);
   }
 
   return res;
 }
 
-/**
- * gst_h265_parser_parse_slice_hdr:
- * @parser: a #GstH265Parser
- * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
- * @slice: The #GstH265SliceHdr to fill.
- *
- * Parses @data, and fills the @slice structure.
- * The resulting @slice_hdr structure shall be deallocated with
- * gst_h265_slice_hdr_free() when it is no longer needed
- *
- * Returns: a #GstH265ParserResult
- */
-GstH265ParserResult
-gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
-    GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+/* With @light, stops after slice_type */
+static GstH265ParserResult
+gst_h265_parser_parse_slice_hdr_internal (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice, gboolean light)
 {
   NalReader nr;
   gint pps_id;
@@ -2022,11 +2082,17 @@ gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
     READ_UINT32 (&nr, slice->segment_address, n);
   }
 
+  if (light && slice->dependent_slice_segment_flag)
+    goto light_done;
+
   if (!slice->dependent_slice_segment_flag) {
     for (i = 0; i < pps->num_extra_slice_header_bits; i++)
       nal_reader_skip (&nr, 1);
     READ_UE_MAX (&nr, slice->type, 63);
 
+    if (light)
+      goto light_done;
+
 
     if (pps->output_flag_present_flag)
       READ_UINT8 (&nr, slice->pic_output_flag, 1);
@@ -2231,6 +2297,12 @@ gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
 
   return GST_H265_PARSER_OK;
 
+light_done:
+  slice->header_size = 0;
+  slice->n_emulation_prevention_bytes = 0;
+
+  return GST_H265_PARSER_OK;
+
 error:
   GST_WARNING ("error parsing \"Slice header\"");
 
@@ -2239,6 +2311,50 @@ error:
   return GST_H265_PARSER_ERROR;
 }
 
+/**
+ * gst_h265_parser_parse_slice_hdr:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
+ * @slice: The #GstH265SliceHdr to fill.
+ *
+ * Parses @data, and fills the @slice structure.
+ * The resulting @slice_hdr structure shall be deallocated with
+ * gst_h265_slice_hdr_free() when it is no longer needed
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+{
+  return gst_h265_parser_parse_slice_hdr_internal (parser, nalu, slice, FALSE);
+}
+
+/**
+ * gst_h265_parser_parse_slice_hdr_light:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
+ * @slice: The #GstH265SliceHdr to fill.
+ *
+ * Parses the start of the slice header in @data, up to and including
+ * slice_type, which is enough to know the slice type and where pictures
+ * start. Only these fields of @slice are set, its header_size is 0.
+ * The slice type of a dependent slice segment is not set.
+ *
+ * The resulting @slice_hdr structure shall be deallocated with
+ * gst_h265_slice_hdr_free() when it is no longer needed
+ *
+ * Returns: a #GstH265ParserResult
+ *
+ * Since: 1.6
+ */
+GstH265ParserResult
+gst_h265_parser_parse_slice_hdr_light (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+{
+  return gst_h265_parser_parse_slice_hdr_internal (parser, nalu, slice, TRUE);
+}
+
 static gboolean
 nal_reader_has_more_data_in_payload (NalReader * nr,
     guint32 payload_start_pos_bit, guint32 payloadSize)
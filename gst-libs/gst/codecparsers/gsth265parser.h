@@ -992,6 +992,8 @@ struct _GstH265Parser
   GstH265VPS *last_vps;
   GstH265SPS *last_sps;
   GstH265PPS *last_pps;
+  /* raw bytes of the parameter sets above */
+  gpointer ps_cache;
 };
 
 GstH265Parser *     gst_h265_parser_new               (void);
@@ -1022,6 +1024,10 @@ GstH265ParserResult gst_h265_parser_parse_slice_hdr (GstH265Parser   * parser,
                                                      GstH265NalUnit  * nalu,
                                                      GstH265SliceHdr * slice);
 
+GstH265ParserResult gst_h265_parser_parse_slice_hdr_light (GstH265Parser   * parser,
+                                                     GstH265NalUnit  * nalu,
+                                                     GstH265SliceHdr * slice);
+
 GstH265ParserResult gst_h265_parser_parse_vps       (GstH265Parser   * parser,
                                                      GstH265NalUnit  * nalu,
                                                      GstH265VPS      * vps);
@@ -41,6 +41,7 @@
 
 #include "gstmpegvideoparser.h"
 #include "parserutils.h"
+#include "startcodeutils.h"
 
 #include <string.h>
 #include <gst/base/gstbitreader.h>
@@ -182,34 +183,9 @@ set_fps_from_code (GstMpegVideoSequenceHdr * seqhdr, guint8 fps_code)
 static inline gint
 scan_for_start_codes (const GstByteReader * reader, guint offset, guint size)
 {
-  const guint8 *data;
-  guint i = 0;
-
   g_assert ((guint64) offset + size <= reader->size - reader->byte);
 
-  /* we can't find the pattern with less than 4 bytes */
-  if (G_UNLIKELY (size < 4))
-    return -1;
-
-  data = reader->data + reader->byte + offset;
-
-  while (i <= (size - 4)) {
-    if (data[i + 2] > 1) {
-      i += 3;
-    } else if (data[i + 1]) {
-      i += 2;
-    } else if (data[i] || data[i + 2] != 1) {
-      i++;
-    } else {
-      break;
-    }
-  }
-
-  if (i <= (size - 4))
-    return offset + i;
-
-  /* nothing found */
-  return -1;
+  return scan_for_start_code (reader->data + reader->byte, offset, size);
 }
 
 /****** API *******/
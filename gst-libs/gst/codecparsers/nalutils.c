@@ -36,6 +36,7 @@
 #endif
 
 #include "nalutils.h"
+#include "startcodeutils.h"
 
 /* Compute Ceil(Log2(v)) */
 /* Derived from branchless code for integer log2(v) from:
@@ -300,10 +301,51 @@ nal_reader_has_more_data (NalReader * nr)
 inline gint
 scan_for_start_codes (const guint8 * data, guint size)
 {
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
-
   /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
+  return scan_for_start_code (data, 0, size);
+}
+
+/***********  parameter set cache ***************/
+
+/* Returns the index of the entry holding exactly @data, parsed with the
+ * same @flags, or -1. The NAL header and the parameter set id are part of
+ * @data, so there is at most one. */
+gint
+nal_cache_lookup (const NalCacheEntry * cache, guint n_entries,
+    const guint8 * data, guint size, guint flags)
+{
+  guint i;
+
+  for (i = 0; i < n_entries; i++) {
+    if (cache[i].size == size && cache[i].flags == flags &&
+        memcmp (cache[i].data, data, size) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
+void
+nal_cache_store (NalCacheEntry * entry, const guint8 * data, guint size,
+    guint flags)
+{
+  if (entry->size != size) {
+    g_free (entry->data);
+    entry->data = g_malloc (size);
+    entry->size = size;
+  }
+  memcpy (entry->data, data, size);
+  entry->flags = flags;
+}
+
+void
+nal_cache_clear (NalCacheEntry * cache, guint n_entries)
+{
+  guint i;
+
+  for (i = 0; i < n_entries; i++) {
+    g_free (cache[i].data);
+    cache[i].data = NULL;
+    cache[i].size = 0;
+  }
 }
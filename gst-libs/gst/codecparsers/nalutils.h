@@ -160,3 +160,19 @@ gboolean nal_reader_get_se (NalReader * nr, gint32 * val);
 }
 
 gint scan_for_start_codes (const guint8 * data, guint size);
+
+/* Raw bytes of a stored parameter set NAL, used to recognize a repeated
+ * one without parsing it again. @flags holds the parsing options that
+ * were used. */
+typedef struct
+{
+  guint8 *data;
+  guint size;
+  guint flags;
+} NalCacheEntry;
+
+gint nal_cache_lookup (const NalCacheEntry * cache, guint n_entries,
+    const guint8 * data, guint size, guint flags);
+void nal_cache_store (NalCacheEntry * entry, const guint8 * data, guint size,
+    guint flags);
+void nal_cache_clear (NalCacheEntry * cache, guint n_entries);
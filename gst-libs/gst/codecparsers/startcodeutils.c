@@ -0,0 +1,180 @@
+/* Gstreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* The vector versions compare three overlapping loads against 0, 0 and 1,
+ * which gives the exact start code positions of a whole block at once.
+ * Blocks without a start code, i.e. almost all of them in coded slice
+ * data, cost three loads and a handful of compares. */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "startcodeutils.h"
+#include <gst/parallel-private.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SCAN_SSE2 1
+#endif
+
+#ifdef GST_PARALLEL_HAVE_AVX2
+#include <immintrin.h>
+#define HAVE_SCAN_AVX2 1
+#endif
+
+#ifdef GST_PARALLEL_HAVE_NEON
+#include <arm_neon.h>
+#define HAVE_SCAN_NEON 1
+#endif
+
+/* All scan functions look for 00 00 01 lying completely inside
+ * @data[0, @len) starting at @i and return its position or -1 */
+typedef gint (*ScanFunc) (const guint8 * data, gint len, gint i);
+
+static gint
+scan_c (const guint8 * data, gint len, gint i)
+{
+  while (i + 2 < len) {
+    if (data[i + 2] > 1) {
+      i += 3;
+    } else if (data[i + 1]) {
+      i += 2;
+    } else if (data[i] || data[i + 2] != 1) {
+      i++;
+    } else {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+#ifdef HAVE_SCAN_SSE2
+static gint
+scan_sse2 (const guint8 * data, gint len, gint i)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i one = _mm_set1_epi8 (1);
+
+  /* Checks start positions i to i + 15, reading up to data[i + 17] */
+  for (; i + 18 <= len; i += 16) {
+    __m128i a = _mm_loadu_si128 ((const __m128i *) (data + i));
+    __m128i b = _mm_loadu_si128 ((const __m128i *) (data + i + 1));
+    __m128i c = _mm_loadu_si128 ((const __m128i *) (data + i + 2));
+    guint mask;
+
+    mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (c, one),
+            _mm_and_si128 (_mm_cmpeq_epi8 (a, zero),
+                _mm_cmpeq_epi8 (b, zero))));
+    if (mask)
+      return i + g_bit_nth_lsf (mask, -1);
+  }
+
+  return scan_c (data, len, i);
+}
+#endif
+
+#ifdef HAVE_SCAN_AVX2
+__attribute__ ((target ("avx2")))
+static gint
+scan_avx2 (const guint8 * data, gint len, gint i)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i one = _mm256_set1_epi8 (1);
+
+  /* Checks start positions i to i + 31, reading up to data[i + 33] */
+  for (; i + 34 <= len; i += 32) {
+    __m256i a = _mm256_loadu_si256 ((const __m256i *) (data + i));
+    __m256i b = _mm256_loadu_si256 ((const __m256i *) (data + i + 1));
+    __m256i c = _mm256_loadu_si256 ((const __m256i *) (data + i + 2));
+    guint mask;
+
+    mask = (guint) _mm256_movemask_epi8 (_mm256_and_si256 (_mm256_cmpeq_epi8 (c,
+                one), _mm256_and_si256 (_mm256_cmpeq_epi8 (a, zero),
+                _mm256_cmpeq_epi8 (b, zero))));
+    if (mask)
+      return i + g_bit_nth_lsf (mask, -1);
+  }
+
+  return scan_c (data, len, i);
+}
+#endif
+
+#ifdef HAVE_SCAN_NEON
+static gint
+scan_neon (const guint8 * data, gint len, gint i)
+{
+  const uint8x16_t zero = vdupq_n_u8 (0);
+  const uint8x16_t one = vdupq_n_u8 (1);
+
+  /* Checks start positions i to i + 15, reading up to data[i + 17] */
+  for (; i + 18 <= len; i += 16) {
+    uint8x16_t a = vld1q_u8 (data + i);
+    uint8x16_t b = vld1q_u8 (data + i + 1);
+    uint8x16_t c = vld1q_u8 (data + i + 2);
+    uint64x2_t m;
+
+    m = vreinterpretq_u64_u8 (vandq_u8 (vceqq_u8 (c, one),
+            vandq_u8 (vceqq_u8 (a, zero), vceqq_u8 (b, zero))));
+    /* There is no movemask, find the exact position in this block */
+    if (vgetq_lane_u64 (m, 0) | vgetq_lane_u64 (m, 1))
+      return scan_c (data, i + 18, i);
+  }
+
+  return scan_c (data, len, i);
+}
+#endif
+
+static gpointer
+scan_func_init (gpointer user_data)
+{
+  ScanFunc func = scan_c;
+
+#ifdef HAVE_SCAN_SSE2
+  func = scan_sse2;
+#endif
+#ifdef HAVE_SCAN_AVX2
+  if (gst_parallel_cpu_has_avx2 ())
+    func = scan_avx2;
+#endif
+#ifdef HAVE_SCAN_NEON
+  func = scan_neon;
+#endif
+
+  return (gpointer) func;
+}
+
+gint
+scan_for_start_code (const guint8 * data, guint offset, guint size)
+{
+  static GOnce once = G_ONCE_INIT;
+  ScanFunc func;
+  gint ret;
+
+  /* we can't find the pattern with less than 4 bytes */
+  if (G_UNLIKELY (size < 4))
+    return -1;
+
+  func = (ScanFunc) g_once (&once, scan_func_init, NULL);
+
+  /* The last byte can only follow a start code */
+  ret = func (data + offset, size - 1, 0);
+
+  return ret == -1 ? -1 : offset + ret;
+}
@@ -0,0 +1,34 @@
+/* Gstreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __START_CODE_UTILS_H__
+#define __START_CODE_UTILS_H__
+
+#include <gst/gst.h>
+
+/* Start code search shared by the MPEG-2, MPEG-4, VC-1, H.264 and H.265
+ * parsers.
+ *
+ * Returns the offset of the first 00 00 01 prefix found in
+ * @data[@offset, @offset + @size) that is followed by at least one more
+ * byte in that range, or -1.  This is the same as
+ * gst_byte_reader_masked_scan_uint32 (reader, 0xffffff00, 0x00000100,
+ * offset, size) on a reader positioned at @data. */
+gint scan_for_start_code (const guint8 * data, guint offset, guint size);
+
+#endif /* __START_CODE_UTILS_H__ */
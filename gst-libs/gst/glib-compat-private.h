@@ -133,6 +133,36 @@ gst_g_thread_create (GThreadFunc func, gpointer data, gboolean joinable,
 }
 #endif /* GLIB_CHECK_VERSION (2, 31, 0) */
 
+#if !GLIB_CHECK_VERSION (2, 36, 0)
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef G_OS_WIN32
+#include <windows.h>
+#endif
+#define g_get_num_processors gst_g_get_num_processors
+static inline guint
+gst_g_get_num_processors (void)
+{
+  guint threads = 0;
+
+#if defined(_SC_NPROC_ONLN)
+  threads = sysconf (_SC_NPROC_ONLN);
+#elif defined(_SC_NPROCESSORS_ONLN)
+  threads = sysconf (_SC_NPROCESSORS_ONLN);
+#elif defined(G_OS_WIN32)
+  {
+    SYSTEM_INFO sysinfo;
+
+    GetSystemInfo (&sysinfo);
+    threads = (guint) sysinfo.dwNumberOfProcessors;
+  }
+#endif
+
+  return MAX (threads, 1);
+}
+#endif /* !GLIB_CHECK_VERSION (2, 36, 0) */
+
 /* adaptations */
 
 G_END_DECLS
@@ -0,0 +1,269 @@
+/*
+ * gstmpegtscrc.c - CRC-32/MPEG-2 of PSI/SI sections
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Every section that is parsed or packetized goes through _calc_crc32(),
+ * which on a full DVB multiplex means megabytes of EIT per minute.
+ *
+ * The portable version processes 8 bytes per step with 8 tables
+ * ("slicing-by-8").  On x86-64 CPUs with PCLMULQDQ whole blocks are folded
+ * with carry-less multiplications and only reduced to 32 bits at the end,
+ * and on ARMv8 builds with the CRC extension the CRC32X instruction is
+ * used.  That one implements the bit-reflected variant of the same
+ * polynomial, so the input bytes and the state are bit-reversed around
+ * it. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mpegts.h"
+#include "gstmpegts-private.h"
+
+#if HAVE_CPU_X86_64 && defined(__GNUC__) && !defined(__clang__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <immintrin.h>
+#define HAVE_CRC_PCLMUL 1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define HAVE_CRC_ARMV8 1
+#endif
+
+typedef guint32 (*CrcFunc) (guint32 crc, const guint8 * data, guint len);
+
+/* MSB-first table for the CRC-32/MPEG-2 polynomial 0x04c11db7, relicensed
+ * to LGPL from fluendo ts demuxer */
+static const guint32 crc_tab[256] = {
+  0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9, 0x130476dc, 0x17c56b6b,
+  0x1a864db2, 0x1e475005, 0x2608edb8, 0x22c9f00f, 0x2f8ad6d6, 0x2b4bcb61,
+  0x350c9b64, 0x31cd86d3, 0x3c8ea00a, 0x384fbdbd, 0x4c11db70, 0x48d0c6c7,
+  0x4593e01e, 0x4152fda9, 0x5f15adac, 0x5bd4b01b, 0x569796c2, 0x52568b75,
+  0x6a1936c8, 0x6ed82b7f, 0x639b0da6, 0x675a1011, 0x791d4014, 0x7ddc5da3,
+  0x709f7b7a, 0x745e66cd, 0x9823b6e0, 0x9ce2ab57, 0x91a18d8e, 0x95609039,
+  0x8b27c03c, 0x8fe6dd8b, 0x82a5fb52, 0x8664e6e5, 0xbe2b5b58, 0xbaea46ef,
+  0xb7a96036, 0xb3687d81, 0xad2f2d84, 0xa9ee3033, 0xa4ad16ea, 0xa06c0b5d,
+  0xd4326d90, 0xd0f37027, 0xddb056fe, 0xd9714b49, 0xc7361b4c, 0xc3f706fb,
+  0xceb42022, 0xca753d95, 0xf23a8028, 0xf6fb9d9f, 0xfbb8bb46, 0xff79a6f1,
+  0xe13ef6f4, 0xe5ffeb43, 0xe8bccd9a, 0xec7dd02d, 0x34867077, 0x30476dc0,
+  0x3d044b19, 0x39c556ae, 0x278206ab, 0x23431b1c, 0x2e003dc5, 0x2ac12072,
+  0x128e9dcf, 0x164f8078, 0x1b0ca6a1, 0x1fcdbb16, 0x018aeb13, 0x054bf6a4,
+  0x0808d07d, 0x0cc9cdca, 0x7897ab07, 0x7c56b6b0, 0x71159069, 0x75d48dde,
+  0x6b93dddb, 0x6f52c06c, 0x6211e6b5, 0x66d0fb02, 0x5e9f46bf, 0x5a5e5b08,
+  0x571d7dd1, 0x53dc6066, 0x4d9b3063, 0x495a2dd4, 0x44190b0d, 0x40d816ba,
+  0xaca5c697, 0xa864db20, 0xa527fdf9, 0xa1e6e04e, 0xbfa1b04b, 0xbb60adfc,
+  0xb6238b25, 0xb2e29692, 0x8aad2b2f, 0x8e6c3698, 0x832f1041, 0x87ee0df6,
+  0x99a95df3, 0x9d684044, 0x902b669d, 0x94ea7b2a, 0xe0b41de7, 0xe4750050,
+  0xe9362689, 0xedf73b3e, 0xf3b06b3b, 0xf771768c, 0xfa325055, 0xfef34de2,
+  0xc6bcf05f, 0xc27dede8, 0xcf3ecb31, 0xcbffd686, 0xd5b88683, 0xd1799b34,
+  0xdc3abded, 0xd8fba05a, 0x690ce0ee, 0x6dcdfd59, 0x608edb80, 0x644fc637,
+  0x7a089632, 0x7ec98b85, 0x738aad5c, 0x774bb0eb, 0x4f040d56, 0x4bc510e1,
+  0x46863638, 0x42472b8f, 0x5c007b8a, 0x58c1663d, 0x558240e4, 0x51435d53,
+  0x251d3b9e, 0x21dc2629, 0x2c9f00f0, 0x285e1d47, 0x36194d42, 0x32d850f5,
+  0x3f9b762c, 0x3b5a6b9b, 0x0315d626, 0x07d4cb91, 0x0a97ed48, 0x0e56f0ff,
+  0x1011a0fa, 0x14d0bd4d, 0x19939b94, 0x1d528623, 0xf12f560e, 0xf5ee4bb9,
+  0xf8ad6d60, 0xfc6c70d7, 0xe22b20d2, 0xe6ea3d65, 0xeba91bbc, 0xef68060b,
+  0xd727bbb6, 0xd3e6a601, 0xdea580d8, 0xda649d6f, 0xc423cd6a, 0xc0e2d0dd,
+  0xcda1f604, 0xc960ebb3, 0xbd3e8d7e, 0xb9ff90c9, 0xb4bcb610, 0xb07daba7,
+  0xae3afba2, 0xaafbe615, 0xa7b8c0cc, 0xa379dd7b, 0x9b3660c6, 0x9ff77d71,
+  0x92b45ba8, 0x9675461f, 0x8832161a, 0x8cf30bad, 0x81b02d74, 0x857130c3,
+  0x5d8a9099, 0x594b8d2e, 0x5408abf7, 0x50c9b640, 0x4e8ee645, 0x4a4ffbf2,
+  0x470cdd2b, 0x43cdc09c, 0x7b827d21, 0x7f436096, 0x7200464f, 0x76c15bf8,
+  0x68860bfd, 0x6c47164a, 0x61043093, 0x65c52d24, 0x119b4be9, 0x155a565e,
+  0x18197087, 0x1cd86d30, 0x029f3d35, 0x065e2082, 0x0b1d065b, 0x0fdc1bec,
+  0x3793a651, 0x3352bbe6, 0x3e119d3f, 0x3ad08088, 0x2497d08d, 0x2056cd3a,
+  0x2d15ebe3, 0x29d4f654, 0xc5a92679, 0xc1683bce, 0xcc2b1d17, 0xc8ea00a0,
+  0xd6ad50a5, 0xd26c4d12, 0xdf2f6bcb, 0xdbee767c, 0xe3a1cbc1, 0xe760d676,
+  0xea23f0af, 0xeee2ed18, 0xf0a5bd1d, 0xf464a0aa, 0xf9278673, 0xfde69bc4,
+  0x89b8fd09, 0x8d79e0be, 0x803ac667, 0x84fbdbd0, 0x9abc8bd5, 0x9e7d9662,
+  0x933eb0bb, 0x97ffad0c, 0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668,
+  0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
+};
+
+/* crc_tab8[k][i] is the CRC of byte i followed by k zero bytes */
+static guint32 crc_tab8[8][256];
+
+static guint32
+crc32_bytewise (guint32 crc, const guint8 * data, guint len)
+{
+  while (len--)
+    crc = (crc << 8) ^ crc_tab[(crc >> 24) ^ *data++];
+
+  return crc;
+}
+
+static guint32
+crc32_slice8 (guint32 crc, const guint8 * data, guint len)
+{
+  for (; len >= 8; len -= 8, data += 8) {
+    guint32 hi = crc ^ GST_READ_UINT32_BE (data);
+    guint32 lo = GST_READ_UINT32_BE (data + 4);
+
+    crc = crc_tab8[7][hi >> 24] ^ crc_tab8[6][(hi >> 16) & 0xff] ^
+        crc_tab8[5][(hi >> 8) & 0xff] ^ crc_tab8[4][hi & 0xff] ^
+        crc_tab8[3][lo >> 24] ^ crc_tab8[2][(lo >> 16) & 0xff] ^
+        crc_tab8[1][(lo >> 8) & 0xff] ^ crc_tab8[0][lo & 0xff];
+  }
+
+  return crc32_bytewise (crc, data, len);
+}
+
+#ifdef HAVE_CRC_PCLMUL
+/* Folding constants, all x^n mod P(x) except for the Barrett constant
+ * floor (x^64 / P(x)) */
+#define K_576 0x8833794c
+#define K_512 0xe6228b11
+#define K_192 0xc5b9cd4c
+#define K_128 0xe8a45605
+#define K_96  0xf200aa66
+#define K_64  0x490d678d
+#define MU    G_GINT64_CONSTANT (0x104d101df)
+#define POLY  G_GINT64_CONSTANT (0x104c11db7)
+
+/* Loads 16 bytes as a polynomial, the first byte holding the highest
+ * coefficients */
+#define LOAD_BE(data) \
+    _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (data)), bswap)
+
+/* x * x^128 is congruent to x_hi * (x^192 mod P) + x_lo * (x^128 mod P) and
+ * likewise for longer distances */
+#define FOLD(x, k) \
+    _mm_xor_si128 (_mm_clmulepi64_si128 (x, k, 0x11), \
+        _mm_clmulepi64_si128 (x, k, 0x00))
+
+__attribute__ ((target ("pclmul,sse4.1")))
+static guint32
+crc32_pclmul (guint32 crc, const guint8 * data, guint len)
+{
+  const __m128i bswap = _mm_set_epi8 (0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+      12, 13, 14, 15);
+  __m128i x0, x1, x2, x3, k, t;
+
+  if (len < 64)
+    return crc32_slice8 (crc, data, len);
+
+  /* The running CRC is added to the first 32 bits of the message */
+  x0 = _mm_xor_si128 (LOAD_BE (data), _mm_set_epi32 (crc, 0, 0, 0));
+  x1 = LOAD_BE (data + 16);
+  x2 = LOAD_BE (data + 32);
+  x3 = LOAD_BE (data + 48);
+  data += 64;
+  len -= 64;
+
+  k = _mm_set_epi64x (K_576, K_512);
+  for (; len >= 64; len -= 64, data += 64) {
+    x0 = _mm_xor_si128 (FOLD (x0, k), LOAD_BE (data));
+    x1 = _mm_xor_si128 (FOLD (x1, k), LOAD_BE (data + 16));
+    x2 = _mm_xor_si128 (FOLD (x2, k), LOAD_BE (data + 32));
+    x3 = _mm_xor_si128 (FOLD (x3, k), LOAD_BE (data + 48));
+  }
+
+  k = _mm_set_epi64x (K_192, K_128);
+  x0 = _mm_xor_si128 (FOLD (x0, k), x1);
+  x0 = _mm_xor_si128 (FOLD (x0, k), x2);
+  x0 = _mm_xor_si128 (FOLD (x0, k), x3);
+  for (; len >= 16; len -= 16, data += 16)
+    x0 = _mm_xor_si128 (FOLD (x0, k), LOAD_BE (data));
+
+  /* x0 * x^32 mod P, first down to 96 bits ... */
+  t = _mm_clmulepi64_si128 (x0, _mm_set_epi64x (K_96, 0), 0x11);
+  x0 = _mm_xor_si128 (t, _mm_slli_si128 (_mm_move_epi64 (x0), 4));
+  /* ... then to 64 bits ... */
+  t = _mm_clmulepi64_si128 (_mm_srli_si128 (x0, 8), _mm_set_epi64x (0, K_64),
+      0x00);
+  x0 = _mm_xor_si128 (t, _mm_move_epi64 (x0));
+  /* ... and a Barrett reduction to the remainder */
+  t = _mm_clmulepi64_si128 (_mm_srli_epi64 (x0, 32), _mm_set_epi64x (0, MU),
+      0x00);
+  t = _mm_clmulepi64_si128 (_mm_srli_si128 (t, 4), _mm_set_epi64x (0, POLY),
+      0x00);
+  crc = _mm_cvtsi128_si32 (_mm_xor_si128 (x0, t));
+
+  return crc32_slice8 (crc, data, len);
+}
+
+#undef LOAD_BE
+#undef FOLD
+#endif
+
+#ifdef HAVE_CRC_ARMV8
+static inline guint32
+rbit32 (guint32 v)
+{
+  __asm__ ("rbit %w0, %w1":"=r" (v):"r" (v));
+  return v;
+}
+
+/* Reverses the bits of each byte, keeping the byte order */
+static inline guint64
+rbit_bytes (guint64 v)
+{
+  __asm__ ("rbit %0, %1\n\trev %0, %0":"=r" (v):"r" (v));
+  return v;
+}
+
+static guint32
+crc32_armv8 (guint32 crc, const guint8 * data, guint len)
+{
+  crc = rbit32 (crc);
+
+  for (; len >= 8; len -= 8, data += 8)
+    crc = __crc32d (crc, rbit_bytes (GST_READ_UINT64_LE (data)));
+  while (len--)
+    crc = __crc32b (crc, rbit32 (*data++) >> 24);
+
+  return rbit32 (crc);
+}
+#endif
+
+static gpointer
+crc_func_init (gpointer user_data)
+{
+  CrcFunc func = crc32_slice8;
+  guint i, k;
+
+  for (i = 0; i < 256; i++) {
+    crc_tab8[0][i] = crc_tab[i];
+    for (k = 1; k < 8; k++)
+      crc_tab8[k][i] = (crc_tab8[k - 1][i] << 8) ^
+          crc_tab[crc_tab8[k - 1][i] >> 24];
+  }
+
+#ifdef HAVE_CRC_PCLMUL
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("pclmul") && __builtin_cpu_supports ("sse4.1"))
+    func = crc32_pclmul;
+#endif
+#ifdef HAVE_CRC_ARMV8
+  func = crc32_armv8;
+#endif
+
+  return (gpointer) func;
+}
+
+guint32
+_calc_crc32 (const guint8 * data, guint datalen)
+{
+  static GOnce once = G_ONCE_INIT;
+  CrcFunc func;
+
+  func = (CrcFunc) g_once (&once, crc_func_init, NULL);
+
+  return func (0xffffffff, data, datalen);
+}
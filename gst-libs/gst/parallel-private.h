@@ -0,0 +1,378 @@
+/* GStreamer
+ *
+ * parallel-private.h: helpers for elements that spread their work over
+ * several threads
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_PARALLEL_PRIVATE_H__
+#define __GST_PARALLEL_PRIVATE_H__
+
+#include <gst/gst.h>
+#include <gst/glib-compat-private.h>
+
+G_BEGIN_DECLS
+
+/* Upper limit of the "max-threads" properties */
+#define GST_PARALLEL_MAX_THREADS 16
+
+/* Number of threads to use for a "max-threads" property value, 0 meaning
+ * one per processor */
+static inline guint
+gst_parallel_get_n_threads (guint max_threads)
+{
+  guint threads = max_threads ? max_threads : g_get_num_processors ();
+
+  return CLAMP (threads, 1, GST_PARALLEL_MAX_THREADS);
+}
+
+/* CPU features
+ *
+ * AVX2 code is compiled with a function-level target attribute so that the
+ * rest of the code does not require -mavx2, and must only be called if
+ * gst_parallel_cpu_has_avx2() returns TRUE. NEON is used whenever the
+ * compiler targets it, which is always the case on aarch64. */
+#if (HAVE_CPU_X86_64 || HAVE_CPU_I386) && defined(__GNUC__) && \
+    !defined(__clang__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define GST_PARALLEL_HAVE_AVX2 1
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(__aarch64__)
+#define GST_PARALLEL_HAVE_NEON 1
+#endif
+
+static inline gboolean
+gst_parallel_cpu_has_avx2 (void)
+{
+#ifdef GST_PARALLEL_HAVE_AVX2
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("avx2");
+#else
+  return FALSE;
+#endif
+}
+
+/* GstParallelBands:
+ *
+ * Splits one piece of work, usually the rows of a frame, into bands that
+ * are processed at the same time. The first band runs on the calling
+ * thread and the others on a thread pool, gst_parallel_bands_run() returns
+ * once all of them are done. */
+typedef void (*GstParallelBandFunc) (gpointer user_data, guint band,
+    guint n_bands);
+
+typedef struct
+{
+  GThreadPool *pool;
+  guint n_threads;
+
+  GMutex lock;
+  GCond cond;
+  guint n_pending;
+
+  /* the current run */
+  GstParallelBandFunc func;
+  gpointer user_data;
+  guint n_bands;
+} GstParallelBands;
+
+static inline void
+gst_parallel_bands_init (GstParallelBands * bands)
+{
+  bands->pool = NULL;
+  bands->n_threads = 1;
+  g_mutex_init (&bands->lock);
+  g_cond_init (&bands->cond);
+}
+
+static inline void
+gst_parallel_bands_clear (GstParallelBands * bands)
+{
+  g_mutex_clear (&bands->lock);
+  g_cond_clear (&bands->cond);
+}
+
+static inline void
+_gst_parallel_bands_worker (gpointer data, gpointer user_data)
+{
+  GstParallelBands *bands = user_data;
+
+  bands->func (bands->user_data, GPOINTER_TO_UINT (data), bands->n_bands);
+
+  g_mutex_lock (&bands->lock);
+  if (--bands->n_pending == 0)
+    g_cond_signal (&bands->cond);
+  g_mutex_unlock (&bands->lock);
+}
+
+/* Creates the workers for @max_threads, see gst_parallel_get_n_threads().
+ * Returns the number of bands that can run at the same time. */
+static inline guint
+gst_parallel_bands_start (GstParallelBands * bands, GstObject * parent,
+    guint max_threads)
+{
+  GError *err = NULL;
+  guint threads = gst_parallel_get_n_threads (max_threads);
+
+  g_return_val_if_fail (bands->pool == NULL, bands->n_threads);
+
+  bands->n_threads = 1;
+  if (threads > 1) {
+    bands->pool = g_thread_pool_new (_gst_parallel_bands_worker, bands,
+        threads - 1, TRUE, &err);
+    if (bands->pool == NULL) {
+      GST_WARNING_OBJECT (parent, "failed to create thread pool: %s",
+          err->message);
+      g_clear_error (&err);
+    } else {
+      bands->n_threads = threads;
+    }
+  }
+
+  return bands->n_threads;
+}
+
+static inline void
+gst_parallel_bands_stop (GstParallelBands * bands)
+{
+  if (bands->pool) {
+    g_thread_pool_free (bands->pool, FALSE, TRUE);
+    bands->pool = NULL;
+  }
+  bands->n_threads = 1;
+}
+
+/* Calls @func for every band of @n_bands, at most the number returned by
+ * gst_parallel_bands_start() */
+static inline void
+gst_parallel_bands_run (GstParallelBands * bands, guint n_bands,
+    GstParallelBandFunc func, gpointer user_data)
+{
+  guint i;
+
+  n_bands = MIN (n_bands, bands->n_threads);
+  if (n_bands <= 1) {
+    func (user_data, 0, 1);
+    return;
+  }
+
+  g_mutex_lock (&bands->lock);
+  bands->func = func;
+  bands->user_data = user_data;
+  bands->n_bands = n_bands;
+  bands->n_pending = n_bands - 1;
+  g_mutex_unlock (&bands->lock);
+
+  for (i = 1; i < n_bands; i++)
+    g_thread_pool_push (bands->pool, GUINT_TO_POINTER (i), NULL);
+  func (user_data, 0, n_bands);
+
+  g_mutex_lock (&bands->lock);
+  while (bands->n_pending > 0)
+    g_cond_wait (&bands->cond, &bands->lock);
+  g_mutex_unlock (&bands->lock);
+}
+
+/* GstParallelQueue:
+ *
+ * Processes independent jobs, usually whole frames, on a thread pool and
+ * outputs them in the order they were pushed. @output and @drop are called
+ * on the thread that pushes, drains or flushes the queue and take ownership
+ * of the job. */
+typedef void (*GstParallelJobFunc) (gpointer job, gpointer user_data);
+typedef GstFlowReturn (*GstParallelOutputFunc) (gpointer job,
+    gpointer user_data);
+
+typedef struct
+{
+  GThreadPool *pool;
+  guint n_threads;
+
+  GMutex lock;
+  GCond cond;
+  /* _GstParallelQueueItem, in push order */
+  GQueue pending;
+
+  GstParallelJobFunc process;
+  GstParallelOutputFunc output;
+  GstParallelJobFunc drop;
+  gpointer user_data;
+} GstParallelQueue;
+
+typedef struct
+{
+  gpointer job;
+  /* protected by the queue lock */
+  gboolean done;
+} _GstParallelQueueItem;
+
+static inline void
+gst_parallel_queue_init (GstParallelQueue * queue,
+    GstParallelJobFunc process, GstParallelOutputFunc output,
+    GstParallelJobFunc drop, gpointer user_data)
+{
+  queue->pool = NULL;
+  queue->n_threads = 1;
+  g_mutex_init (&queue->lock);
+  g_cond_init (&queue->cond);
+  g_queue_init (&queue->pending);
+  queue->process = process;
+  queue->output = output;
+  queue->drop = drop;
+  queue->user_data = user_data;
+}
+
+static inline void
+gst_parallel_queue_clear (GstParallelQueue * queue)
+{
+  g_mutex_clear (&queue->lock);
+  g_cond_clear (&queue->cond);
+}
+
+static inline void
+_gst_parallel_queue_worker (gpointer data, gpointer user_data)
+{
+  GstParallelQueue *queue = user_data;
+  _GstParallelQueueItem *item = data;
+
+  queue->process (item->job, queue->user_data);
+
+  g_mutex_lock (&queue->lock);
+  item->done = TRUE;
+  g_cond_broadcast (&queue->cond);
+  g_mutex_unlock (&queue->lock);
+}
+
+/* Creates the workers for @max_threads, see gst_parallel_get_n_threads().
+ * Returns the number of jobs that are processed at the same time. */
+static inline guint
+gst_parallel_queue_start (GstParallelQueue * queue, GstObject * parent,
+    guint max_threads)
+{
+  GError *err = NULL;
+  guint threads = gst_parallel_get_n_threads (max_threads);
+
+  g_return_val_if_fail (queue->pool == NULL, queue->n_threads);
+
+  queue->n_threads = 1;
+  if (threads > 1) {
+    queue->pool = g_thread_pool_new (_gst_parallel_queue_worker, queue,
+        threads, FALSE, &err);
+    if (queue->pool == NULL) {
+      GST_WARNING_OBJECT (parent, "failed to create thread pool: %s",
+          err->message);
+      g_clear_error (&err);
+    } else {
+      queue->n_threads = threads;
+    }
+  }
+
+  return queue->n_threads;
+}
+
+/* Outputs the jobs at the head of the queue, waiting for the oldest ones
+ * until no more than @max_pending are left */
+static inline GstFlowReturn
+_gst_parallel_queue_output (GstParallelQueue * queue, guint max_pending)
+{
+  _GstParallelQueueItem *item;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gpointer job;
+
+  while ((item = g_queue_peek_head (&queue->pending))) {
+    g_mutex_lock (&queue->lock);
+    if (g_queue_get_length (&queue->pending) > max_pending) {
+      while (!item->done)
+        g_cond_wait (&queue->cond, &queue->lock);
+    } else if (!item->done) {
+      g_mutex_unlock (&queue->lock);
+      break;
+    }
+    g_mutex_unlock (&queue->lock);
+
+    g_queue_pop_head (&queue->pending);
+    job = item->job;
+    g_slice_free (_GstParallelQueueItem, item);
+
+    ret = queue->output (job, queue->user_data);
+    if (ret != GST_FLOW_OK)
+      break;
+  }
+
+  return ret;
+}
+
+/* Queues @job and outputs the jobs that are done. Keeps every thread busy
+ * but never queues more than one job per thread. Without workers, @job is
+ * processed and output right away. */
+static inline GstFlowReturn
+gst_parallel_queue_push (GstParallelQueue * queue, gpointer job)
+{
+  _GstParallelQueueItem *item;
+
+  if (queue->pool == NULL) {
+    queue->process (job, queue->user_data);
+    return queue->output (job, queue->user_data);
+  }
+
+  item = g_slice_new0 (_GstParallelQueueItem);
+  item->job = job;
+  g_queue_push_tail (&queue->pending, item);
+  g_thread_pool_push (queue->pool, item, NULL);
+
+  return _gst_parallel_queue_output (queue, queue->n_threads - 1);
+}
+
+/* Waits for and outputs all queued jobs */
+static inline GstFlowReturn
+gst_parallel_queue_drain (GstParallelQueue * queue)
+{
+  return _gst_parallel_queue_output (queue, 0);
+}
+
+/* Waits for all queued jobs and drops them */
+static inline void
+gst_parallel_queue_flush (GstParallelQueue * queue)
+{
+  _GstParallelQueueItem *item;
+
+  while ((item = g_queue_pop_head (&queue->pending))) {
+    g_mutex_lock (&queue->lock);
+    while (!item->done)
+      g_cond_wait (&queue->cond, &queue->lock);
+    g_mutex_unlock (&queue->lock);
+
+    queue->drop (item->job, queue->user_data);
+    g_slice_free (_GstParallelQueueItem, item);
+  }
+}
+
+static inline void
+gst_parallel_queue_stop (GstParallelQueue * queue)
+{
+  gst_parallel_queue_flush (queue);
+  if (queue->pool) {
+    g_thread_pool_free (queue->pool, FALSE, TRUE);
+    queue->pool = NULL;
+  }
+  queue->n_threads = 1;
+}
+
+G_END_DECLS
+
+#endif /* __GST_PARALLEL_PRIVATE_H__ */
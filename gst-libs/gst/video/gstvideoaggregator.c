@@ -227,57 +227,315 @@ gst_videoaggregator_pad_finalize (GObject * o)
   G_OBJECT_CLASS (gst_videoaggregator_pad_parent_class)->finalize (o);
 }
 
+/* Cache of converted input frames, shared by all aggregators in the
+ * process. A multiviewer typically feeds the same buffer through a tee
+ * into several pads (or several compositors) that all scale it to the same
+ * size and format, so the conversion only has to run once per output
+ * frame. An entry lives as long as some pad uses its result: it is dropped
+ * when the last pad releases it after blending, so source buffers are not
+ * kept from their pools any longer than without the cache. The converted
+ * frames in the cache are limited in size, conversions beyond that are not
+ * shared. */
+#define CONVERSION_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
+typedef struct
+{
+  GstBuffer *src;
+  GstVideoInfo in_info;
+  GstVideoInfo out_info;
+  /* NULL while the conversion is running */
+  GstBuffer *result;
+  gsize size;
+  /* pads holding the result, or waiting for it */
+  guint users;
+} ConversionCacheEntry;
+
+static GMutex conversion_cache_lock;
+static GCond conversion_cache_cond;
+static GQueue conversion_cache = G_QUEUE_INIT;
+static gsize conversion_cache_bytes;
+/* number of aggregators, the cache is emptied with the last one */
+static guint conversion_cache_aggregators;
+
+static gboolean
+conversion_info_equal (const GstVideoInfo * a, const GstVideoInfo * b)
+{
+  return GST_VIDEO_INFO_FORMAT (a) == GST_VIDEO_INFO_FORMAT (b)
+      && GST_VIDEO_INFO_WIDTH (a) == GST_VIDEO_INFO_WIDTH (b)
+      && GST_VIDEO_INFO_HEIGHT (a) == GST_VIDEO_INFO_HEIGHT (b)
+      && GST_VIDEO_INFO_INTERLACE_MODE (a) == GST_VIDEO_INFO_INTERLACE_MODE (b)
+      && GST_VIDEO_INFO_FLAGS (a) == GST_VIDEO_INFO_FLAGS (b)
+      && GST_VIDEO_INFO_CHROMA_SITE (a) == GST_VIDEO_INFO_CHROMA_SITE (b)
+      && a->colorimetry.range == b->colorimetry.range
+      && a->colorimetry.matrix == b->colorimetry.matrix
+      && a->colorimetry.transfer == b->colorimetry.transfer
+      && a->colorimetry.primaries == b->colorimetry.primaries
+      && !memcmp (a->offset, b->offset, sizeof (a->offset))
+      && !memcmp (a->stride, b->stride, sizeof (a->stride));
+}
+
+static void
+conversion_cache_entry_free (ConversionCacheEntry * entry)
+{
+  gst_buffer_unref (entry->src);
+  if (entry->result)
+    gst_buffer_unref (entry->result);
+  g_slice_free (ConversionCacheEntry, entry);
+}
+
+/* Called with the cache lock */
+static void
+conversion_cache_remove (ConversionCacheEntry * entry)
+{
+  g_queue_remove (&conversion_cache, entry);
+  conversion_cache_bytes -= entry->size;
+}
+
+/* Called with the cache lock */
+static ConversionCacheEntry *
+conversion_cache_lookup (GstBuffer * buffer, const GstVideoInfo * in_info,
+    const GstVideoInfo * out_info)
+{
+  GList *l;
+
+  for (l = conversion_cache.head; l; l = l->next) {
+    ConversionCacheEntry *entry = l->data;
+
+    if (entry->src == buffer && conversion_info_equal (&entry->in_info, in_info)
+        && conversion_info_equal (&entry->out_info, out_info))
+      return entry;
+  }
+
+  return NULL;
+}
+
+static GstBuffer *
+convert_buffer (GstVideoConverter * convert, GstBuffer * buffer,
+    const GstVideoInfo * in_info, const GstVideoInfo * out_info,
+    gsize min_size)
+{
+  static GstAllocationParams params = { 0, 15, 0, 0, };
+  GstVideoFrame frame, converted_frame;
+  GstBuffer *converted_buf;
+
+  if (!gst_video_frame_map (&frame, (GstVideoInfo *) in_info, buffer,
+          GST_MAP_READ)) {
+    GST_WARNING ("Could not map input buffer");
+    return NULL;
+  }
+
+  converted_buf = gst_buffer_new_allocate (NULL,
+      MAX (GST_VIDEO_INFO_SIZE (out_info), min_size), &params);
+
+  if (!gst_video_frame_map (&converted_frame, (GstVideoInfo *) out_info,
+          converted_buf, GST_MAP_WRITE)) {
+    GST_WARNING ("Could not map converted frame");
+    gst_video_frame_unmap (&frame);
+    gst_buffer_unref (converted_buf);
+    return NULL;
+  }
+
+  gst_video_converter_frame (convert, &frame, &converted_frame);
+
+  gst_video_frame_unmap (&converted_frame);
+  gst_video_frame_unmap (&frame);
+
+  return converted_buf;
+}
+
+/**
+ * gst_videoaggregator_convert_buffer:
+ * @convert: a #GstVideoConverter from @in_info to @out_info, created with
+ *     the default configuration
+ * @buffer: the input buffer
+ * @in_info: the #GstVideoInfo of @buffer
+ * @out_info: the #GstVideoInfo to convert to
+ * @min_size: the minimum size of the returned buffer
+ *
+ * Converts @buffer with @convert, reusing the result of a conversion of the
+ * same buffer to the same @out_info by any pad of any aggregator that has
+ * not been released yet. If another thread is converting the same buffer
+ * already, this waits for its result instead of converting again.
+ *
+ * The returned buffer is shared and must only be mapped for reading. It
+ * must be released with gst_videoaggregator_release_converted_buffer()
+ * once the output frame it was used for is done.
+ *
+ * Returns: (transfer full) (nullable): the converted buffer, or %NULL if
+ *     @buffer could not be converted
+ *
+ * Since: 1.6
+ */
+GstBuffer *
+gst_videoaggregator_convert_buffer (GstVideoConverter * convert,
+    GstBuffer * buffer, const GstVideoInfo * in_info,
+    const GstVideoInfo * out_info, gsize min_size)
+{
+  ConversionCacheEntry *entry;
+  GstBuffer *result;
+  gsize size;
+
+  g_return_val_if_fail (convert != NULL, NULL);
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (in_info != NULL, NULL);
+  g_return_val_if_fail (out_info != NULL, NULL);
+
+  size = MAX (GST_VIDEO_INFO_SIZE (out_info), min_size);
+
+  g_mutex_lock (&conversion_cache_lock);
+  while ((entry = conversion_cache_lookup (buffer, in_info, out_info))) {
+    if (!entry->result) {
+      /* Converted by another thread right now, a failed conversion removes
+       * the entry and we try ourselves */
+      g_cond_wait (&conversion_cache_cond, &conversion_cache_lock);
+      continue;
+    }
+
+    if (entry->size < size)
+      break;
+
+    entry->users++;
+    result = gst_buffer_ref (entry->result);
+    g_mutex_unlock (&conversion_cache_lock);
+
+    GST_LOG ("Reusing conversion of buffer %p", buffer);
+    return result;
+  }
+
+  if (entry || conversion_cache_bytes + size > CONVERSION_CACHE_MAX_BYTES) {
+    /* Too small for us, or no room left: convert without sharing */
+    g_mutex_unlock (&conversion_cache_lock);
+
+    GST_LOG ("Converting buffer %p, not shared", buffer);
+    return convert_buffer (convert, buffer, in_info, out_info, size);
+  }
+
+  entry = g_slice_new0 (ConversionCacheEntry);
+  entry->src = gst_buffer_ref (buffer);
+  entry->in_info = *in_info;
+  entry->out_info = *out_info;
+  entry->size = size;
+  entry->users = 1;
+  g_queue_push_head (&conversion_cache, entry);
+  conversion_cache_bytes += size;
+  g_mutex_unlock (&conversion_cache_lock);
+
+  GST_LOG ("Converting buffer %p", buffer);
+  result = convert_buffer (convert, buffer, in_info, out_info, size);
+
+  g_mutex_lock (&conversion_cache_lock);
+  if (result) {
+    entry->result = gst_buffer_ref (result);
+  } else {
+    conversion_cache_remove (entry);
+  }
+  g_cond_broadcast (&conversion_cache_cond);
+  g_mutex_unlock (&conversion_cache_lock);
+
+  if (!result)
+    conversion_cache_entry_free (entry);
+
+  return result;
+}
+
+/**
+ * gst_videoaggregator_release_converted_buffer:
+ * @converted: (transfer full): a buffer returned by
+ *     gst_videoaggregator_convert_buffer()
+ *
+ * Releases @converted. Once every pad that got the same conversion
+ * released it, the conversion is dropped from the cache together with the
+ * ref on its input buffer.
+ *
+ * Since: 1.6
+ */
+void
+gst_videoaggregator_release_converted_buffer (GstBuffer * converted)
+{
+  ConversionCacheEntry *entry = NULL;
+  GList *l;
+
+  g_return_if_fail (GST_IS_BUFFER (converted));
+
+  g_mutex_lock (&conversion_cache_lock);
+  for (l = conversion_cache.head; l; l = l->next) {
+    ConversionCacheEntry *e = l->data;
+
+    if (e->result == converted) {
+      entry = e;
+      break;
+    }
+  }
+  if (entry && --entry->users == 0)
+    conversion_cache_remove (entry);
+  else
+    entry = NULL;
+  g_mutex_unlock (&conversion_cache_lock);
+
+  if (entry)
+    conversion_cache_entry_free (entry);
+  gst_buffer_unref (converted);
+}
+
+/* Drops what is left in the cache once there are no aggregators anymore,
+ * normally nothing as every pad releases its conversion after blending */
+static void
+conversion_cache_unref (void)
+{
+  GQueue entries = G_QUEUE_INIT;
+  ConversionCacheEntry *entry;
+
+  g_mutex_lock (&conversion_cache_lock);
+  if (--conversion_cache_aggregators == 0) {
+    entries = conversion_cache;
+    g_queue_init (&conversion_cache);
+    conversion_cache_bytes = 0;
+  }
+  g_mutex_unlock (&conversion_cache_lock);
+
+  while ((entry = g_queue_pop_head (&entries))) {
+    GST_WARNING ("conversion of buffer %p was never released", entry->src);
+    conversion_cache_entry_free (entry);
+  }
+}
+
 static gboolean
 gst_video_aggregator_pad_prepare_frame (GstVideoAggregatorPad * pad,
     GstVideoAggregator * vagg)
 {
-  guint outsize;
-  GstVideoFrame *converted_frame;
-  GstBuffer *converted_buf = NULL;
   GstVideoFrame *frame;
-  static GstAllocationParams params = { 0, 15, 0, 0, };
 
   if (!pad->buffer)
     return TRUE;
 
   frame = g_slice_new0 (GstVideoFrame);
 
-  if (!gst_video_frame_map (frame, &pad->buffer_vinfo, pad->buffer,
-          GST_MAP_READ)) {
-    GST_WARNING_OBJECT (vagg, "Could not map input buffer");
-    return FALSE;
-  }
-
   if (pad->priv->convert) {
-    gint converted_size;
-
-    converted_frame = g_slice_new0 (GstVideoFrame);
-
     /* We wait until here to set the conversion infos, in case vagg->info changed */
-    converted_size = pad->priv->conversion_info.size;
-    outsize = GST_VIDEO_INFO_SIZE (&vagg->info);
-    converted_size = converted_size > outsize ? converted_size : outsize;
-    converted_buf = gst_buffer_new_allocate (NULL, converted_size, &params);
-
-    if (!gst_video_frame_map (converted_frame, &(pad->priv->conversion_info),
-            converted_buf, GST_MAP_READWRITE)) {
-      GST_WARNING_OBJECT (vagg, "Could not map converted frame");
-
-      g_slice_free (GstVideoFrame, converted_frame);
-      gst_video_frame_unmap (frame);
+    pad->priv->converted_buffer =
+        gst_videoaggregator_convert_buffer (pad->priv->convert, pad->buffer,
+        &pad->buffer_vinfo, &pad->priv->conversion_info,
+        GST_VIDEO_INFO_SIZE (&vagg->info));
+
+    if (!pad->priv->converted_buffer
+        || !gst_video_frame_map (frame, &(pad->priv->conversion_info),
+            pad->priv->converted_buffer, GST_MAP_READ)) {
+      GST_WARNING_OBJECT (vagg, "Could not convert input buffer");
+      if (pad->priv->converted_buffer)
+        gst_videoaggregator_release_converted_buffer (pad->priv->
+            converted_buffer);
+      pad->priv->converted_buffer = NULL;
       g_slice_free (GstVideoFrame, frame);
       return FALSE;
     }
-
-    gst_video_converter_frame (pad->priv->convert, frame, converted_frame);
-    pad->priv->converted_buffer = converted_buf;
-    gst_video_frame_unmap (frame);
+  } else if (!gst_video_frame_map (frame, &pad->buffer_vinfo, pad->buffer,
+          GST_MAP_READ)) {
+    GST_WARNING_OBJECT (vagg, "Could not map input buffer");
     g_slice_free (GstVideoFrame, frame);
-  } else {
-    converted_frame = frame;
+    return FALSE;
   }
 
-  pad->aggregated_frame = converted_frame;
+  pad->aggregated_frame = frame;
 
   return TRUE;
 }
@@ -293,7 +551,7 @@ gst_video_aggregator_pad_clean_frame (GstVideoAggregatorPad * pad,
   }
 
   if (pad->priv->converted_buffer) {
-    gst_buffer_unref (pad->priv->converted_buffer);
+    gst_videoaggregator_release_converted_buffer (pad->priv->converted_buffer);
     pad->priv->converted_buffer = NULL;
   }
 }
@@ -1955,6 +2213,7 @@ gst_videoaggregator_finalize (GObject * o)
   GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (o);
 
   g_mutex_clear (&vagg->priv->lock);
+  conversion_cache_unref ();
 
   G_OBJECT_CLASS (gst_videoaggregator_parent_class)->finalize (o);
 }
@@ -2044,6 +2303,11 @@ gst_videoaggregator_init (GstVideoAggregator * vagg)
   vagg->priv->current_caps = NULL;
 
   g_mutex_init (&vagg->priv->lock);
+
+  g_mutex_lock (&conversion_cache_lock);
+  conversion_cache_aggregators++;
+  g_mutex_unlock (&conversion_cache_lock);
+
   /* initialize variables */
   gst_videoaggregator_reset (vagg);
 }
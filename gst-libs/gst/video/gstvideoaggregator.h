@@ -117,5 +117,13 @@ struct _GstVideoAggregatorClass
 
 GType gst_videoaggregator_get_type       (void);
 
+GstBuffer * gst_videoaggregator_convert_buffer (GstVideoConverter  * convert,
+                                                GstBuffer          * buffer,
+                                                const GstVideoInfo * in_info,
+                                                const GstVideoInfo * out_info,
+                                                gsize                min_size);
+
+void        gst_videoaggregator_release_converted_buffer (GstBuffer * converted);
+
 G_END_DECLS
 #endif /* __GST_VIDEO_AGGREGATOR_H__ */
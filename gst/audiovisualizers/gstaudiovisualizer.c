@@ -40,20 +40,27 @@
 #include <gst/video/video.h>
 #include <gst/video/gstvideometa.h>
 #include <gst/video/gstvideopool.h>
+#include <gst/parallel-private.h>
 
 #include "gstaudiovisualizer.h"
+#include "gstaudiovisualizerorc.h"
 
 GST_DEBUG_CATEGORY_STATIC (audio_visualizer_debug);
 #define GST_CAT_DEFAULT (audio_visualizer_debug)
 
 #define DEFAULT_SHADER GST_AUDIO_VISUALIZER_SHADER_FADE
 #define DEFAULT_SHADE_AMOUNT   0x000a0a0a
+#define DEFAULT_MAX_THREADS 0
+
+/* bands smaller than this cost more in synchronisation than they gain */
+#define MIN_BAND_HEIGHT 64
 
 enum
 {
   PROP_0,
   PROP_SHADER,
-  PROP_SHADE_AMOUNT
+  PROP_SHADE_AMOUNT,
+  PROP_MAX_THREADS
 };
 
 static GstBaseTransformClass *parent_class = NULL;
@@ -113,6 +120,14 @@ struct _GstAudioVisualizerPrivate
   GstAudioVisualizerShaderFunc shader;
   guint32 shade_amount;
 
+  /* row band workers of the shader */
+  guint max_threads;
+  GstParallelBands bands;
+  GstAudioVisualizerShaderFunc band_shader;
+  const GstVideoFrame *band_sframe;
+  GstVideoFrame *band_dframe;
+  guint32 band_shade;
+
   GstAdapter *adapter;
 
   GstBuffer *inbuf;
@@ -198,304 +213,193 @@ G_STMT_START {                                            \
 
 #endif
 
+/* Shade @width pixels of @s into @d, @shade is from shader_get_shade() */
+static inline void
+shade_row (guint8 * d, const guint8 * s, gint width, guint32 shade)
+{
+  if (width > 0)
+    audio_visualizer_orc_shade (d, s, shade, width);
+}
+
+/* Same for rows that are not pixel aligned */
+static inline void
+shade_row_unaligned (guint8 * d, const guint8 * s, gint width, guint32 shade)
+{
+  guint r = (shade >> 16) & 0xff;
+  guint g = (shade >> 8) & 0xff;
+  guint b = (shade >> 0) & 0xff;
+  gint i;
+
+  for (i = 0; i < width; i++) {
+    SHADE (d, s, i, r, g, b);
+  }
+}
+
+/* The shade amount as the pixel the ORC kernel subtracts. The padding byte
+ * is 0xff in both byte orders so that it is always cleared. */
+static guint32
+shader_get_shade (GstAudioVisualizer * scope)
+{
+  return (scope->priv->shade_amount & 0x00ffffff) | 0xff000000;
+}
+
+#define SRC_ROW(_f, _y) \
+    ((const guint8 *) GST_VIDEO_FRAME_PLANE_DATA (_f, 0) + \
+    (_y) * GST_VIDEO_FRAME_PLANE_STRIDE (_f, 0))
+#define DEST_ROW(_f, _y) \
+    ((guint8 *) GST_VIDEO_FRAME_PLANE_DATA (_f, 0) + \
+    (_y) * GST_VIDEO_FRAME_PLANE_STRIDE (_f, 0))
+
+/* The shaders fill rows [y_start, y_end) of @dframe. Every destination row
+ * only depends on @sframe, so bands of rows can be shaded concurrently. */
+
 static void
 shader_fade (GstAudioVisualizer * scope, const GstVideoFrame * sframe,
-    GstVideoFrame * dframe)
+    GstVideoFrame * dframe, guint32 shade, guint y_start, guint y_end)
 {
-  guint i, j;
-  guint32 shade_amount = scope->priv->shade_amount;
-  guint r = (shade_amount >> 16) & 0xff;
-  guint g = (shade_amount >> 8) & 0xff;
-  guint b = (shade_amount >> 0) & 0xff;
-  guint8 *s, *d;
-  gint ss, ds, width, height;
-
-  s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
-  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
-  d = GST_VIDEO_FRAME_PLANE_DATA (dframe, 0);
-  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, 0);
-
-  width = GST_VIDEO_FRAME_WIDTH (sframe);
-  height = GST_VIDEO_FRAME_HEIGHT (sframe);
-
-  for (j = 0; j < height; j++) {
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    s += ss;
-    d += ds;
-  }
+  gint width = GST_VIDEO_FRAME_WIDTH (sframe);
+  guint y;
+
+  for (y = y_start; y < y_end; y++)
+    shade_row (DEST_ROW (dframe, y), SRC_ROW (sframe, y), width, shade);
 }
 
 static void
 shader_fade_and_move_up (GstAudioVisualizer * scope,
-    const GstVideoFrame * sframe, GstVideoFrame * dframe)
+    const GstVideoFrame * sframe, GstVideoFrame * dframe, guint32 shade,
+    guint y_start, guint y_end)
 {
-  guint i, j;
-  guint32 shade_amount = scope->priv->shade_amount;
-  guint r = (shade_amount >> 16) & 0xff;
-  guint g = (shade_amount >> 8) & 0xff;
-  guint b = (shade_amount >> 0) & 0xff;
-  guint8 *s, *d;
-  gint ss, ds, width, height;
-
-  s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
-  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
-  d = GST_VIDEO_FRAME_PLANE_DATA (dframe, 0);
-  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, 0);
-
-  width = GST_VIDEO_FRAME_WIDTH (sframe);
-  height = GST_VIDEO_FRAME_HEIGHT (sframe);
-
-  for (j = 1; j < height; j++) {
-    s += ss;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    d += ds;
-  }
+  gint width = GST_VIDEO_FRAME_WIDTH (sframe);
+  guint height = GST_VIDEO_FRAME_HEIGHT (sframe);
+  guint y;
+
+  for (y = y_start; y < y_end && y + 1 < height; y++)
+    shade_row (DEST_ROW (dframe, y), SRC_ROW (sframe, y + 1), width, shade);
 }
 
 static void
 shader_fade_and_move_down (GstAudioVisualizer * scope,
-    const GstVideoFrame * sframe, GstVideoFrame * dframe)
+    const GstVideoFrame * sframe, GstVideoFrame * dframe, guint32 shade,
+    guint y_start, guint y_end)
 {
-  guint i, j;
-  guint32 shade_amount = scope->priv->shade_amount;
-  guint r = (shade_amount >> 16) & 0xff;
-  guint g = (shade_amount >> 8) & 0xff;
-  guint b = (shade_amount >> 0) & 0xff;
-  guint8 *s, *d;
-  gint ss, ds, width, height;
-
-  s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
-  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
-  d = GST_VIDEO_FRAME_PLANE_DATA (dframe, 0);
-  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, 0);
-
-  width = GST_VIDEO_FRAME_WIDTH (sframe);
-  height = GST_VIDEO_FRAME_HEIGHT (sframe);
-
-  for (j = 1; j < height; j++) {
-    d += ds;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    s += ss;
-  }
+  gint width = GST_VIDEO_FRAME_WIDTH (sframe);
+  guint y;
+
+  for (y = MAX (y_start, 1); y < y_end; y++)
+    shade_row (DEST_ROW (dframe, y), SRC_ROW (sframe, y - 1), width, shade);
 }
 
 static void
 shader_fade_and_move_left (GstAudioVisualizer * scope,
-    const GstVideoFrame * sframe, GstVideoFrame * dframe)
+    const GstVideoFrame * sframe, GstVideoFrame * dframe, guint32 shade,
+    guint y_start, guint y_end)
 {
-  guint i, j;
-  guint32 shade_amount = scope->priv->shade_amount;
-  guint r = (shade_amount >> 16) & 0xff;
-  guint g = (shade_amount >> 8) & 0xff;
-  guint b = (shade_amount >> 0) & 0xff;
-  guint8 *s, *d;
-  gint ss, ds, width, height;
-
-  s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
-  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
-  d = GST_VIDEO_FRAME_PLANE_DATA (dframe, 0);
-  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, 0);
-
-  width = GST_VIDEO_FRAME_WIDTH (sframe);
-  height = GST_VIDEO_FRAME_HEIGHT (sframe);
-
-  width -= 1;
-  s += 4;
+  gint width = GST_VIDEO_FRAME_WIDTH (sframe);
+  guint y;
 
   /* move to the left */
-  for (j = 0; j < height; j++) {
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    d += ds;
-    s += ss;
-  }
+  for (y = y_start; y < y_end; y++)
+    shade_row (DEST_ROW (dframe, y), SRC_ROW (sframe, y) + 4, width - 1,
+        shade);
 }
 
 static void
 shader_fade_and_move_right (GstAudioVisualizer * scope,
-    const GstVideoFrame * sframe, GstVideoFrame * dframe)
+    const GstVideoFrame * sframe, GstVideoFrame * dframe, guint32 shade,
+    guint y_start, guint y_end)
 {
-  guint i, j;
-  guint32 shade_amount = scope->priv->shade_amount;
-  guint r = (shade_amount >> 16) & 0xff;
-  guint g = (shade_amount >> 8) & 0xff;
-  guint b = (shade_amount >> 0) & 0xff;
-  guint8 *s, *d;
-  gint ss, ds, width, height;
-
-  s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
-  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
-  d = GST_VIDEO_FRAME_PLANE_DATA (dframe, 0);
-  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, 0);
-
-  width = GST_VIDEO_FRAME_WIDTH (sframe);
-  height = GST_VIDEO_FRAME_HEIGHT (sframe);
-
-  width -= 1;
-  d += 4;
+  gint width = GST_VIDEO_FRAME_WIDTH (sframe);
+  guint y;
 
   /* move to the right */
-  for (j = 0; j < height; j++) {
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    d += ds;
-    s += ss;
-  }
+  for (y = y_start; y < y_end; y++)
+    shade_row (DEST_ROW (dframe, y) + 4, SRC_ROW (sframe, y), width - 1,
+        shade);
 }
 
 static void
 shader_fade_and_move_horiz_out (GstAudioVisualizer * scope,
-    const GstVideoFrame * sframe, GstVideoFrame * dframe)
+    const GstVideoFrame * sframe, GstVideoFrame * dframe, guint32 shade,
+    guint y_start, guint y_end)
 {
-  guint i, j;
-  guint32 shade_amount = scope->priv->shade_amount;
-  guint r = (shade_amount >> 16) & 0xff;
-  guint g = (shade_amount >> 8) & 0xff;
-  guint b = (shade_amount >> 0) & 0xff;
-  guint8 *s, *d;
-  gint ss, ds, width, height;
-
-  s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
-  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
-  d = GST_VIDEO_FRAME_PLANE_DATA (dframe, 0);
-  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, 0);
-
-  width = GST_VIDEO_FRAME_WIDTH (sframe);
-  height = GST_VIDEO_FRAME_HEIGHT (sframe);
-
-  /* move upper half up */
-  for (j = 0; j < height / 2; j++) {
-    s += ss;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
+  gint width = GST_VIDEO_FRAME_WIDTH (sframe);
+  guint height = GST_VIDEO_FRAME_HEIGHT (sframe);
+  guint y;
+
+  for (y = y_start; y < y_end; y++) {
+    if (y < height / 2) {
+      /* move upper half up */
+      shade_row (DEST_ROW (dframe, y), SRC_ROW (sframe, y + 1), width, shade);
+    } else if (y > height / 2) {
+      /* move lower half down */
+      shade_row (DEST_ROW (dframe, y), SRC_ROW (sframe, y - 1), width, shade);
     }
-    d += ds;
-  }
-  /* move lower half down */
-  for (j = 0; j < height / 2; j++) {
-    d += ds;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    s += ss;
   }
 }
 
 static void
 shader_fade_and_move_horiz_in (GstAudioVisualizer * scope,
-    const GstVideoFrame * sframe, GstVideoFrame * dframe)
+    const GstVideoFrame * sframe, GstVideoFrame * dframe, guint32 shade,
+    guint y_start, guint y_end)
 {
-  guint i, j;
-  guint32 shade_amount = scope->priv->shade_amount;
-  guint r = (shade_amount >> 16) & 0xff;
-  guint g = (shade_amount >> 8) & 0xff;
-  guint b = (shade_amount >> 0) & 0xff;
-  guint8 *s, *d;
-  gint ss, ds, width, height;
-
-  s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
-  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
-  d = GST_VIDEO_FRAME_PLANE_DATA (dframe, 0);
-  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, 0);
-
-  width = GST_VIDEO_FRAME_WIDTH (sframe);
-  height = GST_VIDEO_FRAME_HEIGHT (sframe);
-
-  /* move upper half down */
-  for (j = 0; j < height / 2; j++) {
-    d += ds;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    s += ss;
-  }
-  /* move lower half up */
-  for (j = 0; j < height / 2; j++) {
-    s += ss;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
+  gint width = GST_VIDEO_FRAME_WIDTH (sframe);
+  guint height = GST_VIDEO_FRAME_HEIGHT (sframe);
+  guint y;
+
+  for (y = y_start; y < y_end; y++) {
+    if (y >= height / 2) {
+      /* move lower half up */
+      if (y + 1 < height)
+        shade_row (DEST_ROW (dframe, y), SRC_ROW (sframe, y + 1), width,
+            shade);
+    } else if (y > 0) {
+      /* move upper half down */
+      shade_row (DEST_ROW (dframe, y), SRC_ROW (sframe, y - 1), width, shade);
     }
-    d += ds;
   }
 }
 
 static void
 shader_fade_and_move_vert_out (GstAudioVisualizer * scope,
-    const GstVideoFrame * sframe, GstVideoFrame * dframe)
+    const GstVideoFrame * sframe, GstVideoFrame * dframe, guint32 shade,
+    guint y_start, guint y_end)
 {
-  guint i, j;
-  guint32 shade_amount = scope->priv->shade_amount;
-  guint r = (shade_amount >> 16) & 0xff;
-  guint g = (shade_amount >> 8) & 0xff;
-  guint b = (shade_amount >> 0) & 0xff;
-  guint8 *s, *s1, *d, *d1;
-  gint ss, ds, width, height;
-
-  s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
-  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
-  d = GST_VIDEO_FRAME_PLANE_DATA (dframe, 0);
-  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, 0);
-
-  width = GST_VIDEO_FRAME_WIDTH (sframe);
-  height = GST_VIDEO_FRAME_HEIGHT (sframe);
-
-  for (j = 0; j < height; j++) {
+  gint width = GST_VIDEO_FRAME_WIDTH (sframe);
+  gint half = width / 2;
+  const guint8 *s;
+  guint8 *d;
+  guint y;
+
+  for (y = y_start; y < y_end; y++) {
+    s = SRC_ROW (sframe, y);
+    d = DEST_ROW (dframe, y);
     /* move left half to the left */
-    s1 = s + 1;
-    for (i = 0; i < width / 2; i++) {
-      SHADE (d, s1, i, r, g, b);
-    }
+    shade_row_unaligned (d, s + 1, half, shade);
     /* move right half to the right */
-    d1 = d + 1;
-    for (; i < width - 1; i++) {
-      SHADE (d1, s, i, r, g, b);
-    }
-    s += ss;
-    d += ds;
+    shade_row_unaligned (d + 1 + half * 4, s + half * 4, width - 1 - half,
+        shade);
   }
 }
 
 static void
 shader_fade_and_move_vert_in (GstAudioVisualizer * scope,
-    const GstVideoFrame * sframe, GstVideoFrame * dframe)
+    const GstVideoFrame * sframe, GstVideoFrame * dframe, guint32 shade,
+    guint y_start, guint y_end)
 {
-  guint i, j;
-  guint32 shade_amount = scope->priv->shade_amount;
-  guint r = (shade_amount >> 16) & 0xff;
-  guint g = (shade_amount >> 8) & 0xff;
-  guint b = (shade_amount >> 0) & 0xff;
-  guint8 *s, *s1, *d, *d1;
-  gint ss, ds, width, height;
-
-  s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
-  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
-  d = GST_VIDEO_FRAME_PLANE_DATA (dframe, 0);
-  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, 0);
-
-  width = GST_VIDEO_FRAME_WIDTH (sframe);
-  height = GST_VIDEO_FRAME_HEIGHT (sframe);
-
-  for (j = 0; j < height; j++) {
+  gint width = GST_VIDEO_FRAME_WIDTH (sframe);
+  gint half = width / 2;
+  const guint8 *s;
+  guint8 *d;
+  guint y;
+
+  for (y = y_start; y < y_end; y++) {
+    s = SRC_ROW (sframe, y);
+    d = DEST_ROW (dframe, y);
     /* move left half to the right */
-    d1 = d + 1;
-    for (i = 0; i < width / 2; i++) {
-      SHADE (d1, s, i, r, g, b);
-    }
+    shade_row_unaligned (d + 1, s, half, shade);
     /* move right half to the left */
-    s1 = s + 1;
-    for (; i < width - 1; i++) {
-      SHADE (d, s1, i, r, g, b);
-    }
-    s += ss;
-    d += ds;
+    shade_row_unaligned (d + half * 4, s + 1 + half * 4, width - 1 - half,
+        shade);
   }
 }
 
@@ -544,6 +448,222 @@ gst_audio_visualizer_change_shader (GstAudioVisualizer * scope)
   scope->priv->shader = shader;
 }
 
+static void
+gst_audio_visualizer_shade_band (gpointer user_data, guint band,
+    guint n_bands)
+{
+  GstAudioVisualizer *scope = user_data;
+  GstAudioVisualizerPrivate *priv = scope->priv;
+  guint height = GST_VIDEO_FRAME_HEIGHT (priv->band_sframe);
+
+  priv->band_shader (scope, priv->band_sframe, priv->band_dframe,
+      priv->band_shade, band * height / n_bands,
+      (band + 1) * height / n_bands);
+}
+
+/* Runs the shader over horizontal bands of the frame, the first band on the
+ * streaming thread and the others on the worker pool */
+static void
+gst_audio_visualizer_shade (GstAudioVisualizer * scope,
+    GstAudioVisualizerShaderFunc shader, const GstVideoFrame * sframe,
+    GstVideoFrame * dframe)
+{
+  GstAudioVisualizerPrivate *priv = scope->priv;
+  guint height = GST_VIDEO_FRAME_HEIGHT (sframe);
+
+  priv->band_shader = shader;
+  priv->band_sframe = sframe;
+  priv->band_dframe = dframe;
+  priv->band_shade = shader_get_shade (scope);
+
+  gst_parallel_bands_run (&priv->bands, height / MIN_BAND_HEIGHT,
+      gst_audio_visualizer_shade_band, scope);
+}
+
+static void
+gst_audio_visualizer_start_workers (GstAudioVisualizer * scope)
+{
+  GstAudioVisualizerPrivate *priv = scope->priv;
+  guint threads;
+
+  threads = gst_parallel_bands_start (&priv->bands, GST_OBJECT (scope),
+      priv->max_threads);
+
+  GST_INFO_OBJECT (scope, "shading with up to %u threads", threads);
+}
+
+static void
+gst_audio_visualizer_stop_workers (GstAudioVisualizer * scope)
+{
+  gst_parallel_bands_stop (&scope->priv->bands);
+}
+
+/* spectrum analysis, shared between all visualizers of the process */
+
+#define SPECTRUM_CACHE_SIZE 8
+
+typedef struct
+{
+  guint num_samples;
+  GstFFTWindow window;
+  gint16 *adata;                /* samples before windowing, the key */
+  GstFFTS16Complex *fdata;      /* NULL while the FFT is running */
+} GstAudioVisualizerSpectrum;
+
+static GMutex spectrum_lock;
+static GCond spectrum_cond;
+static GstAudioVisualizerSpectrum spectrum_cache[SPECTRUM_CACHE_SIZE];
+static guint spectrum_next;
+/* number of visualizers, the cache is emptied with the last one */
+static guint spectrum_users;
+
+/* Called with the spectrum lock */
+static GstAudioVisualizerSpectrum *
+gst_audio_visualizer_lookup_spectrum (const gint16 * adata, guint num_samples,
+    GstFFTWindow window)
+{
+  GstAudioVisualizerSpectrum *entry;
+  guint i;
+
+  for (i = 0; i < SPECTRUM_CACHE_SIZE; i++) {
+    entry = &spectrum_cache[i];
+    if (entry->adata && entry->num_samples == num_samples
+        && entry->window == window
+        && memcmp (entry->adata, adata, num_samples * sizeof (gint16)) == 0)
+      return entry;
+  }
+  return NULL;
+}
+
+/* Called with the spectrum lock. Returns the slot to store a new spectrum
+ * in, or NULL if all of them are still being computed */
+static GstAudioVisualizerSpectrum *
+gst_audio_visualizer_claim_spectrum (void)
+{
+  GstAudioVisualizerSpectrum *entry;
+  guint i;
+
+  for (i = 0; i < SPECTRUM_CACHE_SIZE; i++) {
+    entry = &spectrum_cache[spectrum_next];
+    spectrum_next = (spectrum_next + 1) % SPECTRUM_CACHE_SIZE;
+    if (entry->adata == NULL || entry->fdata != NULL) {
+      g_free (entry->adata);
+      g_free (entry->fdata);
+      entry->adata = NULL;
+      entry->fdata = NULL;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+static void
+gst_audio_visualizer_spectrum_ref (void)
+{
+  g_mutex_lock (&spectrum_lock);
+  spectrum_users++;
+  g_mutex_unlock (&spectrum_lock);
+}
+
+static void
+gst_audio_visualizer_spectrum_unref (void)
+{
+  guint i;
+
+  g_mutex_lock (&spectrum_lock);
+  if (--spectrum_users == 0) {
+    /* nothing can be in flight without a visualizer */
+    for (i = 0; i < SPECTRUM_CACHE_SIZE; i++) {
+      g_free (spectrum_cache[i].adata);
+      g_free (spectrum_cache[i].fdata);
+      memset (&spectrum_cache[i], 0, sizeof (GstAudioVisualizerSpectrum));
+    }
+    spectrum_next = 0;
+  }
+  g_mutex_unlock (&spectrum_lock);
+}
+
+/**
+ * gst_audio_visualizer_get_spectrum:
+ * @scope: the visualizer
+ * @fft: a #GstFFTS16 for @num_samples samples
+ * @adata: interleaved samples in the negotiated audio format
+ * @num_samples: number of samples per channel in @adata
+ * @channel: the channel to analyse, or -1 for the mixdown of all channels
+ * @window: the window applied before the transform
+ * @fdata: @num_samples / 2 + 1 values that receive the spectrum
+ *
+ * Runs the FFT over one channel of @adata. Several visualizers are often
+ * fed the same audio, so the last results are kept and reused when the
+ * same samples are analysed again. If another visualizer is analysing the
+ * same samples right now, this waits for its result.
+ */
+void
+gst_audio_visualizer_get_spectrum (GstAudioVisualizer * scope,
+    GstFFTS16 * fft, const gint16 * adata, guint num_samples, gint channel,
+    GstFFTWindow window, GstFFTS16Complex * fdata)
+{
+  GstAudioVisualizerSpectrum *entry;
+  gsize fsize = (num_samples / 2 + 1) * sizeof (GstFFTS16Complex);
+  guint channels = GST_AUDIO_INFO_CHANNELS (&scope->ainfo);
+  gint16 *mono_adata, *windowed;
+  guint i, c, s;
+  gint v;
+
+  g_return_if_fail (channel < (gint) channels);
+
+  mono_adata = g_new (gint16, num_samples);
+  if (channel >= 0) {
+    for (i = 0, s = channel; i < num_samples; i++, s += channels)
+      mono_adata[i] = adata[s];
+  } else {
+    for (i = 0, s = 0; i < num_samples; i++) {
+      v = 0;
+      for (c = 0; c < channels; c++)
+        v += adata[s++];
+      mono_adata[i] = v / (gint) channels;
+    }
+  }
+
+  g_mutex_lock (&spectrum_lock);
+  while ((entry = gst_audio_visualizer_lookup_spectrum (mono_adata,
+              num_samples, window))) {
+    if (entry->fdata) {
+      memcpy (fdata, entry->fdata, fsize);
+      g_mutex_unlock (&spectrum_lock);
+      g_free (mono_adata);
+      return;
+    }
+    /* another visualizer is computing it */
+    g_cond_wait (&spectrum_cond, &spectrum_lock);
+  }
+
+  /* publish the key first so that others wait for our result, unless all
+   * slots are busy in which case the result is not shared */
+  entry = gst_audio_visualizer_claim_spectrum ();
+  if (entry) {
+    entry->num_samples = num_samples;
+    entry->window = window;
+    entry->adata = mono_adata;
+  }
+  g_mutex_unlock (&spectrum_lock);
+
+  windowed = g_memdup (mono_adata, num_samples * sizeof (gint16));
+  gst_fft_s16_window (fft, windowed, window);
+  gst_fft_s16_fft (fft, windowed, fdata);
+  g_free (windowed);
+
+  if (!entry) {
+    g_free (mono_adata);
+    return;
+  }
+
+  g_mutex_lock (&spectrum_lock);
+  entry->fdata = g_memdup (fdata, fsize);
+  g_cond_broadcast (&spectrum_cond);
+  g_mutex_unlock (&spectrum_lock);
+}
+
 /* base class */
 
 GType
@@ -606,6 +726,12 @@ gst_audio_visualizer_class_init (GstAudioVisualizerClass * klass)
           "Shading color to use (big-endian ARGB)", 0, G_MAXUINT32,
           DEFAULT_SHADE_AMOUNT,
           G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum threads",
+          "Maximum number of threads used to shade a frame (0 = auto), "
+          "applied from the next start",
+          0, GST_PARALLEL_MAX_THREADS, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -644,6 +770,7 @@ gst_audio_visualizer_init (GstAudioVisualizer * scope,
   scope->priv->shader_type = DEFAULT_SHADER;
   gst_audio_visualizer_change_shader (scope);
   scope->priv->shade_amount = DEFAULT_SHADE_AMOUNT;
+  scope->priv->max_threads = DEFAULT_MAX_THREADS;
 
   /* reset the initial video state */
   gst_video_info_init (&scope->vinfo);
@@ -654,6 +781,8 @@ gst_audio_visualizer_init (GstAudioVisualizer * scope,
   gst_video_info_init (&scope->vinfo);
 
   g_mutex_init (&scope->priv->config_lock);
+  gst_parallel_bands_init (&scope->priv->bands);
+  gst_audio_visualizer_spectrum_ref ();
 }
 
 static void
@@ -670,6 +799,9 @@ gst_audio_visualizer_set_property (GObject * object, guint prop_id,
     case PROP_SHADE_AMOUNT:
       scope->priv->shade_amount = g_value_get_uint (value);
       break;
+    case PROP_MAX_THREADS:
+      scope->priv->max_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -689,6 +821,9 @@ gst_audio_visualizer_get_property (GObject * object, guint prop_id,
     case PROP_SHADE_AMOUNT:
       g_value_set_uint (value, scope->priv->shade_amount);
       break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, scope->priv->max_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -716,6 +851,8 @@ gst_audio_visualizer_finalize (GObject * object)
   }
 
   g_mutex_clear (&priv->config_lock);
+  gst_parallel_bands_clear (&priv->bands);
+  gst_audio_visualizer_spectrum_unref ();
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -1235,7 +1372,8 @@ gst_audio_visualizer_chain (GstPad * pad, GstObject * parent,
         /* run various post processing (shading and geometric transformation) */
         /* FIXME: SHADER assumes 32bpp */
         if (priv->shader && GST_VIDEO_INFO_COMP_PSTRIDE (&scope->vinfo, 0) == 4) {
-          priv->shader (scope, &outframe, &priv->tempframe);
+          gst_audio_visualizer_shade (scope, priv->shader, &outframe,
+              &priv->tempframe);
         }
       }
     }
@@ -1438,6 +1576,7 @@ gst_audio_visualizer_change_state (GstElement * element,
   switch (transition) {
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       gst_audio_visualizer_reset (scope);
+      gst_audio_visualizer_start_workers (scope);
       break;
     default:
       break;
@@ -1448,6 +1587,7 @@ gst_audio_visualizer_change_state (GstElement * element,
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_audio_visualizer_set_allocation (scope, NULL, NULL, NULL, NULL);
+      gst_audio_visualizer_stop_workers (scope);
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
@@ -29,6 +29,7 @@
 #include <gst/video/video.h>
 #include <gst/audio/audio.h>
 #include <gst/base/gstadapter.h>
+#include <gst/fft/gstffts16.h>
 
 G_BEGIN_DECLS
 
@@ -43,7 +44,8 @@ typedef struct _GstAudioVisualizer GstAudioVisualizer;
 typedef struct _GstAudioVisualizerClass GstAudioVisualizerClass;
 typedef struct _GstAudioVisualizerPrivate GstAudioVisualizerPrivate;
 
-typedef void (*GstAudioVisualizerShaderFunc)(GstAudioVisualizer *scope, const GstVideoFrame *s, GstVideoFrame *d);
+/* shades rows [y_start, y_end) of @d from @s */
+typedef void (*GstAudioVisualizerShaderFunc)(GstAudioVisualizer *scope, const GstVideoFrame *s, GstVideoFrame *d, guint32 shade, guint y_start, guint y_end);
 
 /**
  * GstAudioVisualizerShader:
@@ -104,5 +106,9 @@ struct _GstAudioVisualizerClass
 
 GType gst_audio_visualizer_get_type (void);
 
+void gst_audio_visualizer_get_spectrum (GstAudioVisualizer * scope, GstFFTS16 * fft,
+                                        const gint16 * adata, guint num_samples, gint channel,
+                                        GstFFTWindow window, GstFFTS16Complex * fdata);
+
 G_END_DECLS
 #endif /* __GST_AUDIO_VISUALIZER_H__ */
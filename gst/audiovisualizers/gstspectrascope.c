@@ -167,7 +167,6 @@ gst_spectra_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
     GstVideoFrame * video)
 {
   GstSpectraScope *scope = GST_SPECTRA_SCOPE (bscope);
-  gint16 *mono_adata;
   GstFFTS16Complex *fdata = scope->freq_data;
   guint x, y, off, l;
   guint w = GST_VIDEO_INFO_WIDTH (&bscope->vinfo);
@@ -175,34 +174,14 @@ gst_spectra_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
   gfloat fr, fi;
   GstMapInfo amap;
   guint32 *vdata;
-  gint channels;
 
   gst_buffer_map (audio, &amap, GST_MAP_READ);
   vdata = (guint32 *) GST_VIDEO_FRAME_PLANE_DATA (video, 0);
 
-  channels = GST_AUDIO_INFO_CHANNELS (&bscope->ainfo);
-
-  mono_adata = (gint16 *) g_memdup (amap.data, amap.size);
-
-  if (channels > 1) {
-    guint ch = channels;
-    guint num_samples = amap.size / (ch * sizeof (gint16));
-    guint i, c, v, s = 0;
-
-    /* deinterleave and mixdown adata */
-    for (i = 0; i < num_samples; i++) {
-      v = 0;
-      for (c = 0; c < ch; c++) {
-        v += mono_adata[s++];
-      }
-      mono_adata[i] = v / ch;
-    }
-  }
-
-  /* run fft */
-  gst_fft_s16_window (scope->fft_ctx, mono_adata, GST_FFT_WINDOW_HAMMING);
-  gst_fft_s16_fft (scope->fft_ctx, mono_adata, fdata);
-  g_free (mono_adata);
+  /* run fft on the mixdown, shared with other scopes on the same audio */
+  gst_audio_visualizer_get_spectrum (bscope, scope->fft_ctx,
+      (const gint16 *) amap.data, bscope->req_spf, -1,
+      GST_FFT_WINDOW_HAMMING, fdata);
 
   /* draw lines */
   for (x = 0; x < w; x++) {
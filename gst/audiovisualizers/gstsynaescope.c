@@ -137,14 +137,6 @@ gst_synae_scope_finalize (GObject * object)
     g_free (scope->freq_data_r);
     scope->freq_data_r = NULL;
   }
-  if (scope->adata_l) {
-    g_free (scope->adata_l);
-    scope->adata_l = NULL;
-  }
-  if (scope->adata_r) {
-    g_free (scope->adata_r);
-    scope->adata_r = NULL;
-  }
 
   G_OBJECT_CLASS (gst_synae_scope_parent_class)->finalize (object);
 }
@@ -159,8 +151,6 @@ gst_synae_scope_setup (GstAudioVisualizer * bscope)
     gst_fft_s16_free (scope->fft_ctx);
   g_free (scope->freq_data_l);
   g_free (scope->freq_data_r);
-  g_free (scope->adata_l);
-  g_free (scope->adata_r);
 
   /* FIXME: we could have horizontal or vertical layout */
 
@@ -170,9 +160,6 @@ gst_synae_scope_setup (GstAudioVisualizer * bscope)
   scope->freq_data_l = g_new (GstFFTS16Complex, num_freq);
   scope->freq_data_r = g_new (GstFFTS16Complex, num_freq);
 
-  scope->adata_l = g_new (gint16, bscope->req_spf);
-  scope->adata_r = g_new (gint16, bscope->req_spf);
-
   return TRUE;
 }
 
@@ -208,8 +195,6 @@ gst_synae_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
   GstMapInfo amap;
   guint32 *vdata;
   gint16 *adata;
-  gint16 *adata_l = scope->adata_l;
-  gint16 *adata_r = scope->adata_r;
   GstFFTS16Complex *fdata_l = scope->freq_data_l;
   GstFFTS16Complex *fdata_r = scope->freq_data_r;
   gint x, y;
@@ -221,7 +206,7 @@ gst_synae_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
   //guint w2 = w /2;
   guint ch = GST_AUDIO_INFO_CHANNELS (&bscope->ainfo);
   guint num_samples;
-  gint i, j, b;
+  gint i, b;
   gint br, br1, br2;
   gint clarity;
   gdouble fc, r, l, rr, ll;
@@ -235,17 +220,11 @@ gst_synae_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
 
   num_samples = amap.size / (ch * sizeof (gint16));
 
-  /* deinterleave */
-  for (i = 0, j = 0; i < num_samples; i++) {
-    adata_l[i] = adata[j++];
-    adata_r[i] = adata[j++];
-  }
-
-  /* run fft */
-  /*gst_fft_s16_window (scope->fft_ctx, adata_l, GST_FFT_WINDOW_HAMMING); */
-  gst_fft_s16_fft (scope->fft_ctx, adata_l, fdata_l);
-  /*gst_fft_s16_window (scope->fft_ctx, adata_r, GST_FFT_WINDOW_HAMMING); */
-  gst_fft_s16_fft (scope->fft_ctx, adata_r, fdata_r);
+  /* run fft, shared with other scopes on the same audio */
+  gst_audio_visualizer_get_spectrum (bscope, scope->fft_ctx, adata,
+      num_samples, 0, GST_FFT_WINDOW_RECTANGULAR, fdata_l);
+  gst_audio_visualizer_get_spectrum (bscope, scope->fft_ctx, adata,
+      num_samples, 1, GST_FFT_WINDOW_RECTANGULAR, fdata_r);
 
   /* draw stars */
   for (y = 0; y < h; y++) {
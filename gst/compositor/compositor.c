@@ -356,11 +356,7 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
 {
   GstCompositor *comp = GST_COMPOSITOR (vagg);
   GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
-  guint outsize;
   GstVideoFrame *converted_frame;
-  GstBuffer *converted_buf = NULL;
-  GstVideoFrame *frame;
-  static GstAllocationParams params = { 0, 15, 0, 0, };
   gint width, height;
   gboolean frame_obscured = FALSE;
   GList *l;
@@ -506,41 +502,30 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     goto done;
   }
 
-  frame = g_slice_new0 (GstVideoFrame);
-
-  if (!gst_video_frame_map (frame, &pad->buffer_vinfo, pad->buffer,
-          GST_MAP_READ)) {
-    GST_WARNING_OBJECT (vagg, "Could not map input buffer");
-    return FALSE;
-  }
+  converted_frame = g_slice_new0 (GstVideoFrame);
 
   if (cpad->convert) {
-    gint converted_size;
-
-    converted_frame = g_slice_new0 (GstVideoFrame);
-
-    /* We wait until here to set the conversion infos, in case vagg->info changed */
-    converted_size = GST_VIDEO_INFO_SIZE (&cpad->conversion_info);
-    outsize = GST_VIDEO_INFO_SIZE (&vagg->info);
-    converted_size = converted_size > outsize ? converted_size : outsize;
-    converted_buf = gst_buffer_new_allocate (NULL, converted_size, &params);
-
-    if (!gst_video_frame_map (converted_frame, &(cpad->conversion_info),
-            converted_buf, GST_MAP_READWRITE)) {
-      GST_WARNING_OBJECT (vagg, "Could not map converted frame");
-
+    /* Pads showing the same buffer at the same size share one conversion */
+    cpad->converted_buffer =
+        gst_videoaggregator_convert_buffer (cpad->convert, pad->buffer,
+        &pad->buffer_vinfo, &cpad->conversion_info,
+        GST_VIDEO_INFO_SIZE (&vagg->info));
+
+    if (!cpad->converted_buffer
+        || !gst_video_frame_map (converted_frame, &(cpad->conversion_info),
+            cpad->converted_buffer, GST_MAP_READ)) {
+      GST_WARNING_OBJECT (vagg, "Could not convert input buffer");
+      if (cpad->converted_buffer)
+        gst_videoaggregator_release_converted_buffer (cpad->converted_buffer);
+      cpad->converted_buffer = NULL;
       g_slice_free (GstVideoFrame, converted_frame);
-      gst_video_frame_unmap (frame);
-      g_slice_free (GstVideoFrame, frame);
       return FALSE;
     }
-
-    gst_video_converter_frame (cpad->convert, frame, converted_frame);
-    cpad->converted_buffer = converted_buf;
-    gst_video_frame_unmap (frame);
-    g_slice_free (GstVideoFrame, frame);
-  } else {
-    converted_frame = frame;
+  } else if (!gst_video_frame_map (converted_frame, &pad->buffer_vinfo,
+          pad->buffer, GST_MAP_READ)) {
+    GST_WARNING_OBJECT (vagg, "Could not map input buffer");
+    g_slice_free (GstVideoFrame, converted_frame);
+    return FALSE;
   }
 
 done:
@@ -562,7 +547,7 @@ gst_compositor_pad_clean_frame (GstVideoAggregatorPad * pad,
   }
 
   if (cpad->converted_buffer) {
-    gst_buffer_unref (cpad->converted_buffer);
+    gst_videoaggregator_release_converted_buffer (cpad->converted_buffer);
     cpad->converted_buffer = NULL;
   }
 }
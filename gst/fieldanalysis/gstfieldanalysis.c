@@ -82,6 +82,10 @@ GST_DEBUG_CATEGORY_STATIC (gst_field_analysis_debug);
 #define DEFAULT_BLOCK_HEIGHT 16
 #define DEFAULT_BLOCK_THRESH 80
 #define DEFAULT_IGNORED_LINES 2
+#define DEFAULT_MAX_THREADS 0
+
+/* upper bound on the number of bands a frame is split into */
+#define FIELD_ANALYSIS_MAX_BANDS GST_PARALLEL_MAX_THREADS
 
 enum
 {
@@ -96,7 +100,8 @@ enum
   PROP_BLOCK_WIDTH,
   PROP_BLOCK_HEIGHT,
   PROP_BLOCK_THRESH,
-  PROP_IGNORED_LINES
+  PROP_IGNORED_LINES,
+  PROP_MAX_THREADS
 };
 
 static GstStaticPadTemplate sink_factory =
@@ -170,8 +175,7 @@ gst_fieldanalysis_frame_metric_get_type (void)
   if (!fieldanalysis_frame_metric_type) {
     static const GEnumValue fieldanalyis_frame_metrics[] = {
       {GST_FIELDANALYSIS_5_TAP, "5-tap [1,-3,4,-3,1] Vertical Filter", "5-tap"},
-      {GST_FIELDANALYSIS_WINDOWED_COMB,
-            "Windowed Comb Detection (not optimised)",
+      {GST_FIELDANALYSIS_WINDOWED_COMB, "Windowed Comb Detection",
           "windowed-comb"},
       {0, NULL, NULL},
     };
@@ -274,6 +278,12 @@ gst_field_analysis_class_init (GstFieldAnalysisClass * klass)
           "Ignore this many lines from the top and bottom for windowed comb detection",
           2, G_MAXUINT64, DEFAULT_IGNORED_LINES,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum threads",
+          "Maximum number of threads used to compute the metrics (0 = automatic), "
+          "applied when the element goes to READY",
+          0, FIELD_ANALYSIS_MAX_BANDS, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_field_analysis_change_state);
@@ -300,11 +310,14 @@ static gfloat same_parity_3_tap (GstFieldAnalysis * filter,
 static gfloat opposite_parity_5_tap (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2]);
 static guint64 block_score_for_row_32detect (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
+    FieldAnalysisFields (*history)[2], guint band, guint8 * base_fj,
+    guint8 * base_fjp1);
 static guint64 block_score_for_row_iscombed (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
+    FieldAnalysisFields (*history)[2], guint band, guint8 * base_fj,
+    guint8 * base_fjp1);
 static guint64 block_score_for_row_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
+    FieldAnalysisFields (*history)[2], guint band, guint8 * base_fj,
+    guint8 * base_fjp1);
 static gfloat opposite_parity_windowed_comb (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2]);
 
@@ -360,6 +373,26 @@ gst_field_analysis_init (GstFieldAnalysis * filter)
   filter->block_height = DEFAULT_BLOCK_HEIGHT;
   filter->block_thresh = DEFAULT_BLOCK_THRESH;
   filter->ignored_lines = DEFAULT_IGNORED_LINES;
+  filter->max_threads = DEFAULT_MAX_THREADS;
+  filter->n_bands = 1;
+  gst_parallel_bands_init (&filter->bands);
+}
+
+/* (re)allocates the per-band scratch rows used by the windowed comb
+ * detection for the current width, block width and number of bands */
+static void
+gst_field_analysis_alloc_scratch (GstFieldAnalysis * filter, gint width)
+{
+  guint n_bands = MAX (filter->n_bands, 1);
+
+  filter->comb_mask_stride = width;
+  filter->block_scores_stride = width / filter->block_width;
+
+  g_free (filter->comb_mask);
+  filter->comb_mask = g_malloc (n_bands * filter->comb_mask_stride);
+  g_free (filter->block_scores);
+  filter->block_scores =
+      g_malloc0 (n_bands * filter->block_scores_stride * sizeof (guint));
 }
 
 static void
@@ -424,19 +457,12 @@ gst_field_analysis_set_property (GObject * object, guint prop_id,
       filter->spatial_thresh = g_value_get_int64 (value);
       break;
     case PROP_BLOCK_WIDTH:
+      GST_OBJECT_LOCK (filter);
       filter->block_width = g_value_get_uint64 (value);
-      if (GST_VIDEO_FRAME_WIDTH (&filter->frames[0].frame)) {
-        const gint frame_width =
-            GST_VIDEO_FRAME_WIDTH (&filter->frames[0].frame);
-        if (filter->block_scores) {
-          gsize nbytes = (frame_width / filter->block_width) * sizeof (guint);
-          filter->block_scores = g_realloc (filter->block_scores, nbytes);
-          memset (filter->block_scores, 0, nbytes);
-        } else {
-          filter->block_scores =
-              g_malloc0 ((frame_width / filter->block_width) * sizeof (guint));
-        }
-      }
+      if (GST_VIDEO_INFO_WIDTH (&filter->vinfo))
+        gst_field_analysis_alloc_scratch (filter,
+            GST_VIDEO_INFO_WIDTH (&filter->vinfo));
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_BLOCK_HEIGHT:
       filter->block_height = g_value_get_uint64 (value);
@@ -447,6 +473,9 @@ gst_field_analysis_set_property (GObject * object, guint prop_id,
     case PROP_IGNORED_LINES:
       filter->ignored_lines = g_value_get_uint64 (value);
       break;
+    case PROP_MAX_THREADS:
+      filter->max_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -521,6 +550,9 @@ gst_field_analysis_get_property (GObject * object, guint prop_id,
     case PROP_IGNORED_LINES:
       g_value_set_uint64 (value, filter->ignored_lines);
       break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, filter->max_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -570,19 +602,7 @@ gst_field_analysis_update_format (GstFieldAnalysis * filter, GstCaps * caps)
   width = GST_VIDEO_INFO_WIDTH (&filter->vinfo);
 
   /* update allocations for metric scores */
-  if (filter->comb_mask) {
-    filter->comb_mask = g_realloc (filter->comb_mask, width);
-  } else {
-    filter->comb_mask = g_malloc (width);
-  }
-  if (filter->block_scores) {
-    gsize nbytes = (width / filter->block_width) * sizeof (guint);
-    filter->block_scores = g_realloc (filter->block_scores, nbytes);
-    memset (filter->block_scores, 0, nbytes);
-  } else {
-    filter->block_scores =
-        g_malloc0 ((width / filter->block_width) * sizeof (guint));
-  }
+  gst_field_analysis_alloc_scratch (filter, width);
 
   GST_OBJECT_UNLOCK (filter);
   return;
@@ -804,121 +824,158 @@ gst_field_analysis_sink_event (GstPad * pad, GstObject * parent,
 }
 
 
-static gfloat
-same_parity_sad (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+/* the frame is cut into horizontal bands which are analysed concurrently by
+ * the thread pool, the first band always being handled by the calling
+ * thread. each band function returns a partial result which the caller
+ * combines */
+typedef guint64 (*FieldAnalysisBandFunc) (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], guint band);
+
+typedef struct
 {
-  gint j;
-  gfloat sum;
-  guint8 *f1j, *f2j;
+  GstFieldAnalysis *filter;
+  FieldAnalysisBandFunc func;
+  FieldAnalysisFields (*history)[2];
+  guint64 *results;
+} FieldAnalysisBandJob;
+
+static void
+gst_field_analysis_band (gpointer user_data, guint band, guint n_bands)
+{
+  FieldAnalysisBandJob *job = user_data;
+
+  job->results[band] = job->func (job->filter, job->history, band);
+}
+
+/* runs func once per band and stores the per-band results in results */
+static void
+gst_field_analysis_run_bands (GstFieldAnalysis * filter,
+    FieldAnalysisBandFunc func, FieldAnalysisFields (*history)[2],
+    guint64 * results)
+{
+  FieldAnalysisBandJob job = { filter, func, history, results };
+
+  gst_parallel_bands_run (&filter->bands, filter->n_bands,
+      gst_field_analysis_band, &job);
+}
+
+static guint64
+gst_field_analysis_sum_bands (GstFieldAnalysis * filter,
+    FieldAnalysisBandFunc func, FieldAnalysisFields (*history)[2])
+{
+  guint64 results[FIELD_ANALYSIS_MAX_BANDS];
+  guint64 sum = 0;
+  guint i;
+
+  gst_field_analysis_run_bands (filter, func, history, results);
+  for (i = 0; i < MAX (filter->n_bands, 1); i++)
+    sum += results[i];
+
+  return sum;
+}
+
+/* splits count items into n_bands contiguous ranges */
+static inline void
+band_range (guint band, guint n_bands, gint count, gint * start, gint * end)
+{
+  n_bands = MAX (n_bands, 1);
+  *start = (gint) (((guint64) count * band) / n_bands);
+  *end = (gint) (((guint64) count * (band + 1)) / n_bands);
+}
+
+static inline guint8 *
+field_line (FieldAnalysisFields * field, gint j)
+{
+  return GST_VIDEO_FRAME_COMP_DATA (&field->frame, 0) +
+      GST_VIDEO_FRAME_COMP_OFFSET (&field->frame, 0) +
+      (field->parity + 2 * j) * GST_VIDEO_FRAME_COMP_STRIDE (&field->frame, 0);
+}
 
+static guint64
+same_parity_sad_band (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], guint band)
+{
+  gint j, start, end;
+  guint64 sum = 0;
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
   const guint32 noise_floor = filter->noise_floor;
 
-  f1j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-      0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
-
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  band_range (band, filter->n_bands, height >> 1, &start, &end);
+  for (j = start; j < end; j++) {
     guint32 tempsum = 0;
-    fieldanalysis_orc_same_parity_sad_planar_yuv (&tempsum, f1j, f2j,
+    fieldanalysis_orc_same_parity_sad_planar_yuv (&tempsum,
+        field_line (&(*history)[0], j), field_line (&(*history)[1], j),
         noise_floor, width);
     sum += tempsum;
-    f1j += stride0x2;
-    f2j += stride1x2;
   }
 
-  return sum / (0.5f * width * height);
+  return sum;
 }
 
 static gfloat
-same_parity_ssd (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+same_parity_sad (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
 {
-  gint j;
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
   gfloat sum;
-  guint8 *f1j, *f2j;
 
+  sum = gst_field_analysis_sum_bands (filter, same_parity_sad_band, history);
+
+  return sum / (0.5f * width * height);
+}
+
+static guint64
+same_parity_ssd_band (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], guint band)
+{
+  gint j, start, end;
+  guint64 sum = 0;
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
   /* noise floor needs to be squared for SSD */
   const guint32 noise_floor = filter->noise_floor * filter->noise_floor;
 
-  f1j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-      0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
-
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  band_range (band, filter->n_bands, height >> 1, &start, &end);
+  for (j = start; j < end; j++) {
     guint32 tempsum = 0;
-    fieldanalysis_orc_same_parity_ssd_planar_yuv (&tempsum, f1j, f2j,
+    fieldanalysis_orc_same_parity_ssd_planar_yuv (&tempsum,
+        field_line (&(*history)[0], j), field_line (&(*history)[1], j),
         noise_floor, width);
     sum += tempsum;
-    f1j += stride0x2;
-    f2j += stride1x2;
   }
 
-  return sum / (0.5f * width * height); /* field is half height */
+  return sum;
 }
 
-/* horizontal [1,4,1] diff between fields - is this a good idea or should the
- * current sample be emphasised more or less? */
 static gfloat
-same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+same_parity_ssd (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
 {
-  gint i, j;
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
   gfloat sum;
-  guint8 *f1j, *f2j;
 
+  sum = gst_field_analysis_sum_bands (filter, same_parity_ssd_band, history);
+
+  return sum / (0.5f * width * height); /* field is half height */
+}
+
+static guint64
+same_parity_3_tap_band (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], guint band)
+{
+  gint i, j, start, end;
+  guint64 sum = 0;
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
   const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
   /* noise floor needs to be *6 for [1,4,1] */
   const guint32 noise_floor = filter->noise_floor * 6;
 
-  f1j = GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame, 0) +
-      GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame, 0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
-
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  band_range (band, filter->n_bands, height >> 1, &start, &end);
+  for (j = start; j < end; j++) {
+    guint8 *f1j = field_line (&(*history)[0], j);
+    guint8 *f2j = field_line (&(*history)[1], j);
     guint32 tempsum = 0;
     guint32 diff;
 
@@ -939,14 +996,77 @@ same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
         - ((f2j[i - incr] << 1) + (f2j[i] << 2)));
     if (diff > noise_floor)
       sum += diff;
-
-    f1j += stride0x2;
-    f2j += stride1x2;
   }
 
+  return sum;
+}
+
+/* horizontal [1,4,1] diff between fields - is this a good idea or should the
+ * current sample be emphasised more or less? */
+static gfloat
+same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+{
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+  gfloat sum;
+
+  sum = gst_field_analysis_sum_bands (filter, same_parity_3_tap_band, history);
+
   return sum / ((6.0f / 2.0f) * width * height);        /* 1 + 4 + 1 = 6; field is half height */
 }
 
+/* fj is line j of the combined frame made from the even lines of the field
+ * with the 0th field's parity (the "a" field below) and the odd lines of the
+ * other one (the "b" field)
+ * fjp1 is one line down from fj
+ * fjm2 is two lines up from fj
+ * the first and last lines are mirrored at the edges */
+static guint64
+opposite_parity_5_tap_band (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], guint band)
+{
+  gint j, start, end;
+  guint64 sum = 0;
+  guint8 *a0, *b1;
+  gint a_stridex2, b_stridex2;
+
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+  const gint last = (height >> 1) - 1;
+  /* noise floor needs to be *6 for [1,-3,4,-3,1] */
+  const guint32 noise_floor = filter->noise_floor * 6;
+  /* 0th field's parity defines operation */
+  GstVideoFrame *a =
+      &(*history)[(*history)[0].parity == TOP_FIELD ? 0 : 1].frame;
+  GstVideoFrame *b =
+      &(*history)[(*history)[0].parity == TOP_FIELD ? 1 : 0].frame;
+
+  a0 = GST_VIDEO_FRAME_COMP_DATA (a, 0) + GST_VIDEO_FRAME_COMP_OFFSET (a, 0);
+  b1 = GST_VIDEO_FRAME_COMP_DATA (b, 0) + GST_VIDEO_FRAME_COMP_OFFSET (b, 0) +
+      GST_VIDEO_FRAME_COMP_STRIDE (b, 0);
+  a_stridex2 = GST_VIDEO_FRAME_COMP_STRIDE (a, 0) << 1;
+  b_stridex2 = GST_VIDEO_FRAME_COMP_STRIDE (b, 0) << 1;
+
+  band_range (band, filter->n_bands, last + 1, &start, &end);
+  for (j = start; j < end; j++) {
+    guint8 *fj = a0 + j * a_stridex2;
+    guint8 *fjm2 = j > 0 ? fj - a_stridex2 : fj + a_stridex2;
+    guint8 *fjp2 = j < last ? fj + a_stridex2 : fj - a_stridex2;
+    guint8 *fjp1 = b1 + j * b_stridex2;
+    guint8 *fjm1 = j > 0 ? fjp1 - b_stridex2 : fjp1;
+    guint32 tempsum = 0;
+
+    if (j == last)
+      fjp1 = fjm1;
+
+    fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1,
+        fj, fjp1, fjp2, noise_floor, width);
+    sum += tempsum;
+  }
+
+  return sum;
+}
+
 /* vertical [1,-3,4,-3,1] - same as is used in FieldDiff from TIVTC,
  * tritical's AVISynth IVTC filter */
 /* 0th field's parity defines operation */
@@ -954,97 +1074,78 @@ static gfloat
 opposite_parity_5_tap (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2])
 {
-  gint j;
-  gfloat sum;
-  guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
-  guint32 tempsum;
-
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
-  /* noise floor needs to be *6 for [1,-3,4,-3,1] */
-  const guint32 noise_floor = filter->noise_floor * 6;
+  gfloat sum;
 
-  sum = 0.0f;
+  sum = gst_field_analysis_sum_bands (filter, opposite_parity_5_tap_band,
+      history);
 
-  /* fj is line j of the combined frame made from the top field even lines of
-   *   field 0 and the bottom field odd lines from field 1
-   * fjp1 is one line down from fj
-   * fjm2 is two lines up from fj
-   * fj with j == 0 is the 0th line of the top field
-   * fj with j == 1 is the 0th line of the bottom field or the 1st field of
-   *   the frame*/
+  return sum / ((6.0f / 2.0f) * width * height);        /* 1 + 4 + 1 == 3 + 3 == 6; field is half height */
+}
 
-  /* unroll first line as it is a special case */
-  if ((*history)[0].parity == TOP_FIELD) {
-    fj = GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame, 0);
-    fjp1 =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0);
-    fjp2 = fj + stride0x2;
-  } else {
-    fj = GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame, 0);
-    fjp1 =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
-    fjp2 = fj + stride1x2;
-  }
+/* the spatial threshold as passed to the orc comb mask functions. sample
+ * differences can never exceed 255 so anything larger behaves the same and
+ * keeps the intermediate values within 16 bits */
+static inline gint
+comb_spatial_thresh (GstFieldAnalysis * filter)
+{
+  return (gint) MIN (filter->spatial_thresh, 256);
+}
 
-  tempsum = 0;
-  fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjp2, fjp1, fj,
-      fjp1, fjp2, noise_floor, width);
-  sum += tempsum;
-
-  for (j = 1; j < (height >> 1) - 1; j++) {
-    /* shift everything down a line in the field of interest (means += stridex2) */
-    fjm2 = fj;
-    fjm1 = fjp1;
-    fj = fjp2;
-    if ((*history)[0].parity == TOP_FIELD) {
-      fjp1 += stride1x2;
-      fjp2 += stride0x2;
-    } else {
-      fjp1 += stride0x2;
-      fjp2 += stride1x2;
-    }
+/* if the samples to the left and right are combed, they contribute to the
+ * block score. we have to work one result ahead of ourselves which results
+ * in some small peculiarities at the edges */
+static inline void
+accumulate_block_scores (const guint8 * comb_mask, guint * block_scores,
+    gint width, guint64 block_width)
+{
+  gint i;
 
-    tempsum = 0;
-    fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1,
-        fj, fjp1, fjp2, noise_floor, width);
-    sum += tempsum;
+  for (i = 1; i < width; i++) {
+    const guint64 res_idx = (i - 1) / block_width;
+
+    if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
+      /* left edge */
+      block_scores[res_idx]++;
+    } else if (i == width - 1) {
+      /* right edge */
+      if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
+        block_scores[res_idx]++;
+      if (comb_mask[i - 1] && comb_mask[i])
+        block_scores[i / block_width]++;
+    } else if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i]) {
+      block_scores[res_idx]++;
+    }
   }
+}
 
-  /* unroll the last line as it is a special case */
-  /* shift everything down a line in the field of interest (means += stridex2) */
-  fjm2 = fj;
-  fjm1 = fjp1;
-  fj = fjp2;
+static inline guint64
+max_block_score (const guint * block_scores, guint64 n_blocks)
+{
+  guint64 i, block_score = 0;
 
-  tempsum = 0;
-  fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1, fj,
-      fjm1, fjm2, noise_floor, width);
-  sum += tempsum;
+  for (i = 0; i < n_blocks; i++) {
+    if (block_scores[i] > block_score)
+      block_score = block_scores[i];
+  }
 
-  return sum / ((6.0f / 2.0f) * width * height);        /* 1 + 4 + 1 == 3 + 3 == 6; field is half height */
+  return block_score;
 }
 
+/* changes in the same direction */
+#define SAME_DIRECTION(diff1,diff2,thresh) \
+    (((diff1) > (thresh) && (diff2) > (thresh)) \
+        || ((diff1) < -(thresh) && (diff2) < -(thresh)))
+
 /* this metric was sourced from HandBrake but originally from transcode
  * the return value is the highest block score for the row of blocks */
-static inline guint64
+static guint64
 block_score_for_row_32detect (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+    FieldAnalysisFields (*history)[2], guint band, guint8 * base_fj,
+    guint8 * base_fjp1)
 {
   guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
-  guint64 block_score;
   guint8 *fjm2, *fjm1, *fj, *fjp1;
   const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
   const gint stridex2 =
@@ -1052,9 +1153,16 @@ block_score_for_row_32detect (GstFieldAnalysis * filter,
   const guint64 block_width = filter->block_width;
   const guint64 block_height = filter->block_height;
   const gint64 spatial_thresh = filter->spatial_thresh;
+  const gint thresh = comb_spatial_thresh (filter);
   const gint width =
       GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
       (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
+  const guint64 n_blocks = width / block_width;
+  guint8 *comb_mask = filter->comb_mask + band * filter->comb_mask_stride;
+  guint *block_scores =
+      filter->block_scores + band * filter->block_scores_stride;
+
+  memset (block_scores, 0, n_blocks * sizeof (guint));
 
   fjm2 = base_fj - stridex2;
   fjm1 = base_fjp1 - stridex2;
@@ -1062,47 +1170,22 @@ block_score_for_row_32detect (GstFieldAnalysis * filter,
   fjp1 = base_fjp1;
 
   for (j = 0; j < block_height; j++) {
-    /* we have to work one result ahead of ourselves which results in some small
-     * peculiarities below */
-    gint diff1, diff2;
-
-    diff1 = fj[0] - fjm1[0];
-    diff2 = fj[0] - fjp1[0];
-    /* change in the same direction */
-    if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-        || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-      comb_mask[0] = abs (fj[0] - fjm2[0]) < 10 && abs (fj[0] - fjm1[0]) > 15;
+    if (incr == 1) {
+      fieldanalysis_orc_comb_mask_32detect_planar_yuv (comb_mask, fjm2, fjm1,
+          fj, fjp1, thresh, -thresh, width);
     } else {
-      comb_mask[0] = FALSE;
-    }
+      for (i = 0; i < width; i++) {
+        const guint64 idx = i * incr;
+        const gint diff1 = fj[idx] - fjm1[idx];
+        const gint diff2 = fj[idx] - fjp1[idx];
 
-    for (i = 1; i < width; i++) {
-      const guint64 idx = i * incr;
-      const guint64 res_idx = (i - 1) / block_width;
-
-      diff1 = fj[idx] - fjm1[idx];
-      diff2 = fj[idx] - fjp1[idx];
-      if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-        comb_mask[i] = abs (fj[idx] - fjm2[idx]) < 10
-            && abs (fj[idx] - fjm1[idx]) > 15;
-      } else {
-        comb_mask[i] = FALSE;
-      }
-
-      if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
-        /* left edge */
-        block_scores[res_idx]++;
-      } else if (i == width - 1) {
-        /* right edge */
-        if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
-          block_scores[res_idx]++;
-        if (comb_mask[i - 1] && comb_mask[i])
-          block_scores[i / block_width]++;
-      } else if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i]) {
-        block_scores[res_idx]++;
+        comb_mask[i] = SAME_DIRECTION (diff1, diff2, spatial_thresh)
+            && abs (fj[idx] - fjm2[idx]) < 10 && abs (fj[idx] - fjm1[idx]) > 15;
       }
     }
+
+    accumulate_block_scores (comb_mask, block_scores, width, block_width);
+
     /* advance down a line */
     fjm2 = fjm1;
     fjm1 = fj;
@@ -1110,28 +1193,18 @@ block_score_for_row_32detect (GstFieldAnalysis * filter,
     fjp1 = fjm1 + stridex2;
   }
 
-  block_score = 0;
-  for (i = 0; i < width / block_width; i++) {
-    if (block_scores[i] > block_score)
-      block_score = block_scores[i];
-  }
-
-  g_free (block_scores);
-  g_free (comb_mask);
-  return block_score;
+  return max_block_score (block_scores, n_blocks);
 }
 
 /* this metric was sourced from HandBrake but originally from
  * tritical's isCombedT Avisynth function
  * the return value is the highest block score for the row of blocks */
-static inline guint64
+static guint64
 block_score_for_row_iscombed (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+    FieldAnalysisFields (*history)[2], guint band, guint8 * base_fj,
+    guint8 * base_fjp1)
 {
   guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
-  guint64 block_score;
   guint8 *fjm1, *fj, *fjp1;
   const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
   const gint stridex2 =
@@ -1140,86 +1213,57 @@ block_score_for_row_iscombed (GstFieldAnalysis * filter,
   const guint64 block_height = filter->block_height;
   const gint64 spatial_thresh = filter->spatial_thresh;
   const gint64 spatial_thresh_squared = spatial_thresh * spatial_thresh;
+  const gint thresh = comb_spatial_thresh (filter);
   const gint width =
       GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
       (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
+  const guint64 n_blocks = width / block_width;
+  guint8 *comb_mask = filter->comb_mask + band * filter->comb_mask_stride;
+  guint *block_scores =
+      filter->block_scores + band * filter->block_scores_stride;
+
+  memset (block_scores, 0, n_blocks * sizeof (guint));
 
   fjm1 = base_fjp1 - stridex2;
   fj = base_fj;
   fjp1 = base_fjp1;
 
   for (j = 0; j < block_height; j++) {
-    /* we have to work one result ahead of ourselves which results in some small
-     * peculiarities below */
-    gint diff1, diff2;
-
-    diff1 = fj[0] - fjm1[0];
-    diff2 = fj[0] - fjp1[0];
-    /* change in the same direction */
-    if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-        || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-      comb_mask[0] =
-          (fjm1[0] - fj[0]) * (fjp1[0] - fj[0]) > spatial_thresh_squared;
+    if (incr == 1) {
+      fieldanalysis_orc_comb_mask_iscombed_planar_yuv (comb_mask, fjm1, fj,
+          fjp1, thresh, -thresh, thresh * thresh, width);
     } else {
-      comb_mask[0] = FALSE;
-    }
-
-    for (i = 1; i < width; i++) {
-      const guint64 idx = i * incr;
-      const guint64 res_idx = (i - 1) / block_width;
+      for (i = 0; i < width; i++) {
+        const guint64 idx = i * incr;
+        const gint diff1 = fj[idx] - fjm1[idx];
+        const gint diff2 = fj[idx] - fjp1[idx];
 
-      diff1 = fj[idx] - fjm1[idx];
-      diff2 = fj[idx] - fjp1[idx];
-      if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-        comb_mask[i] =
-            (fjm1[idx] - fj[idx]) * (fjp1[idx] - fj[idx]) >
+        comb_mask[i] = SAME_DIRECTION (diff1, diff2, spatial_thresh)
+            && (fjm1[idx] - fj[idx]) * (fjp1[idx] - fj[idx]) >
             spatial_thresh_squared;
-      } else {
-        comb_mask[i] = FALSE;
-      }
-
-      if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
-        /* left edge */
-        block_scores[res_idx]++;
-      } else if (i == width - 1) {
-        /* right edge */
-        if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
-          block_scores[res_idx]++;
-        if (comb_mask[i - 1] && comb_mask[i])
-          block_scores[i / block_width]++;
-      } else if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i]) {
-        block_scores[res_idx]++;
       }
     }
+
+    accumulate_block_scores (comb_mask, block_scores, width, block_width);
+
     /* advance down a line */
     fjm1 = fj;
     fj = fjp1;
     fjp1 = fjm1 + stridex2;
   }
 
-  block_score = 0;
-  for (i = 0; i < width / block_width; i++) {
-    if (block_scores[i] > block_score)
-      block_score = block_scores[i];
-  }
-
-  g_free (block_scores);
-  g_free (comb_mask);
-  return block_score;
+  return max_block_score (block_scores, n_blocks);
 }
 
 /* this metric was sourced from HandBrake but originally from
  * tritical's isCombedT Avisynth function
  * the return value is the highest block score for the row of blocks */
-static inline guint64
+static guint64
 block_score_for_row_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+    FieldAnalysisFields (*history)[2], guint band, guint8 * base_fj,
+    guint8 * base_fjp1)
 {
   guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
-  guint64 block_score;
   guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
   const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
   const gint stridex2 =
@@ -1228,10 +1272,16 @@ block_score_for_row_5_tap (GstFieldAnalysis * filter,
   const guint64 block_height = filter->block_height;
   const gint64 spatial_thresh = filter->spatial_thresh;
   const gint64 spatial_threshx6 = 6 * spatial_thresh;
+  const gint thresh = comb_spatial_thresh (filter);
   const gint width =
       GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
       (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
+  const guint64 n_blocks = width / block_width;
+  guint8 *comb_mask = filter->comb_mask + band * filter->comb_mask_stride;
+  guint *block_scores =
+      filter->block_scores + band * filter->block_scores_stride;
 
+  memset (block_scores, 0, n_blocks * sizeof (guint));
 
   fjm2 = base_fj - stridex2;
   fjm1 = base_fjp1 - stridex2;
@@ -1240,67 +1290,39 @@ block_score_for_row_5_tap (GstFieldAnalysis * filter,
   fjp2 = fj + stridex2;
 
   for (j = 0; j < block_height; j++) {
-    /* we have to work one result ahead of ourselves which results in some small
-     * peculiarities below */
-    gint diff1, diff2;
-
-    diff1 = fj[0] - fjm1[0];
-    diff2 = fj[0] - fjp1[0];
-    /* change in the same direction */
-    if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-        || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-      comb_mask[0] =
-          abs (fjm2[0] + (fj[0] << 2) + fjp2[0] - 3 * (fjm1[0] + fjp1[0])) >
-          spatial_threshx6;
-
-      /* motion detection that needs previous and next frames
-         this isn't really necessary, but acts as an optimisation if the
-         additional delay isn't a problem
-         if (motion_detection) {
-         if (abs(fpj[idx] - fj[idx]               ) > motion_thresh &&
-         abs(           fjm1[idx] - fnjm1[idx]) > motion_thresh &&
-         abs(           fjp1[idx] - fnjp1[idx]) > motion_thresh)
-         motion++;
-         if (abs(             fj[idx]   - fnj[idx]) > motion_thresh &&
-         abs(fpjm1[idx] - fjm1[idx]           ) > motion_thresh &&
-         abs(fpjp1[idx] - fjp1[idx]           ) > motion_thresh)
-         motion++;
-         } else {
-         motion = 1;
-         }
-       */
+    /* motion detection that needs previous and next frames
+       this isn't really necessary, but acts as an optimisation if the
+       additional delay isn't a problem
+       if (motion_detection) {
+       if (abs(fpj[idx] - fj[idx]               ) > motion_thresh &&
+       abs(           fjm1[idx] - fnjm1[idx]) > motion_thresh &&
+       abs(           fjp1[idx] - fnjp1[idx]) > motion_thresh)
+       motion++;
+       if (abs(             fj[idx]   - fnj[idx]) > motion_thresh &&
+       abs(fpjm1[idx] - fjm1[idx]           ) > motion_thresh &&
+       abs(fpjp1[idx] - fjp1[idx]           ) > motion_thresh)
+       motion++;
+       } else {
+       motion = 1;
+       }
+     */
+    if (incr == 1) {
+      fieldanalysis_orc_comb_mask_5_tap_planar_yuv (comb_mask, fjm2, fjm1, fj,
+          fjp1, fjp2, thresh, -thresh, 6 * thresh, width);
     } else {
-      comb_mask[0] = FALSE;
-    }
-
-    for (i = 1; i < width; i++) {
-      const guint64 idx = i * incr;
-      const guint64 res_idx = (i - 1) / block_width;
+      for (i = 0; i < width; i++) {
+        const guint64 idx = i * incr;
+        const gint diff1 = fj[idx] - fjm1[idx];
+        const gint diff2 = fj[idx] - fjp1[idx];
 
-      diff1 = fj[idx] - fjm1[idx];
-      diff2 = fj[idx] - fjp1[idx];
-      if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-        comb_mask[i] =
-            abs (fjm2[idx] + (fj[idx] << 2) + fjp2[idx] - 3 * (fjm1[idx] +
+        comb_mask[i] = SAME_DIRECTION (diff1, diff2, spatial_thresh)
+            && abs (fjm2[idx] + (fj[idx] << 2) + fjp2[idx] - 3 * (fjm1[idx] +
                 fjp1[idx])) > spatial_threshx6;
-      } else {
-        comb_mask[i] = FALSE;
-      }
-
-      if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
-        /* left edge */
-        block_scores[res_idx]++;
-      } else if (i == width - 1) {
-        /* right edge */
-        if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
-          block_scores[res_idx]++;
-        if (comb_mask[i - 1] && comb_mask[i])
-          block_scores[i / block_width]++;
-      } else if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i]) {
-        block_scores[res_idx]++;
       }
     }
+
+    accumulate_block_scores (comb_mask, block_scores, width, block_width);
+
     /* advance down a line */
     fjm2 = fjm1;
     fjm1 = fj;
@@ -1309,32 +1331,20 @@ block_score_for_row_5_tap (GstFieldAnalysis * filter,
     fjp2 = fj + stridex2;
   }
 
-  block_score = 0;
-  for (i = 0; i < width / block_width; i++) {
-    if (block_scores[i] > block_score)
-      block_score = block_scores[i];
-  }
-
-  g_free (block_scores);
-  g_free (comb_mask);
-  return block_score;
+  return max_block_score (block_scores, n_blocks);
 }
 
-/* a pass is made over the field using one of three comb-detection metrics
-   and the results are then analysed block-wise. if the samples to the left
-   and right are combed, they contribute to the block score. if the block
-   score is above the given threshold, the frame is combed. if the block
-   score is between half the threshold and the threshold, the block is
-   slightly combed. if when analysis is complete, slight combing is detected
-   that is returned. if any results are observed that are above the threshold,
-   the function returns immediately */
-/* 0th field's parity defines operation */
-static gfloat
-opposite_parity_windowed_comb (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2])
+#undef SAME_DIRECTION
+
+/* returns 2 if a block row in the band is combed, 1 if one is slightly
+ * combed and 0 otherwise. bands stop early once any band found combing as
+ * the result can no longer change */
+static guint64
+opposite_parity_windowed_comb_band (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], guint band)
 {
-  gint j;
-  gboolean slightly_combed;
+  gint j, start, end, n_rows;
+  guint64 ret = 0;
 
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
   const gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
@@ -1342,6 +1352,14 @@ opposite_parity_windowed_comb (GstFieldAnalysis * filter,
   const guint64 block_height = filter->block_height;
   guint8 *base_fj, *base_fjp1;
 
+  /* each row of blocks covers 2 * block_height lines of the woven frame and
+   * ignored_lines are skipped at the top and the bottom */
+  if (block_height == 0
+      || 2 * (filter->ignored_lines + block_height) > (guint64) height)
+    return 0;
+  n_rows =
+      (height - 2 * (filter->ignored_lines + block_height)) / block_height + 1;
+
   if ((*history)[0].parity == TOP_FIELD) {
     base_fj =
         GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
@@ -1361,29 +1379,64 @@ opposite_parity_windowed_comb (GstFieldAnalysis * filter,
   }
 
   /* we operate on a row of blocks of height block_height through each iteration */
-  slightly_combed = FALSE;
-  for (j = 0; j <= height - filter->ignored_lines - block_height;
-      j += block_height) {
-    guint64 line_offset = (filter->ignored_lines + j) * stride;
-    guint block_score =
-        filter->block_score_for_row (filter, history, base_fj + line_offset,
-        base_fjp1 + line_offset);
+  band_range (band, filter->n_bands, n_rows, &start, &end);
+  for (j = start; j < end; j++) {
+    guint64 line_offset = (filter->ignored_lines + j * block_height) * stride;
+    guint64 block_score;
+
+    if (g_atomic_int_get (&filter->comb_found))
+      break;
+
+    block_score =
+        filter->block_score_for_row (filter, history, band,
+        base_fj + line_offset, base_fjp1 + line_offset);
 
     if (block_score > (block_thresh >> 1)
         && block_score <= block_thresh) {
       /* blend if nothing more combed comes along */
-      slightly_combed = TRUE;
+      ret = 1;
     } else if (block_score > block_thresh) {
-      if (GST_VIDEO_INFO_INTERLACE_MODE (&(*history)[0].frame.info) ==
-          GST_VIDEO_INTERLACE_MODE_INTERLEAVED) {
-        return 1.0f;            /* blend */
-      } else {
-        return 2.0f;            /* deinterlace */
-      }
+      g_atomic_int_set (&filter->comb_found, TRUE);
+      return 2;
     }
   }
 
-  return (gfloat) slightly_combed;      /* TRUE means blend, else don't */
+  return ret;
+}
+
+/* a pass is made over the field using one of three comb-detection metrics
+   and the results are then analysed block-wise. if the samples to the left
+   and right are combed, they contribute to the block score. if the block
+   score is above the given threshold, the frame is combed. if the block
+   score is between half the threshold and the threshold, the block is
+   slightly combed. if when analysis is complete, slight combing is detected
+   that is returned. if any results are observed that are above the threshold,
+   the function returns immediately */
+/* 0th field's parity defines operation */
+static gfloat
+opposite_parity_windowed_comb (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2])
+{
+  guint64 results[FIELD_ANALYSIS_MAX_BANDS];
+  guint64 combed = 0;
+  guint i;
+
+  g_atomic_int_set (&filter->comb_found, FALSE);
+  gst_field_analysis_run_bands (filter, opposite_parity_windowed_comb_band,
+      history, results);
+  for (i = 0; i < MAX (filter->n_bands, 1); i++)
+    combed = MAX (combed, results[i]);
+
+  if (combed == 2) {
+    if (GST_VIDEO_INFO_INTERLACE_MODE (&(*history)[0].frame.info) ==
+        GST_VIDEO_INTERLACE_MODE_INTERLEAVED) {
+      return 1.0f;              /* blend */
+    } else {
+      return 2.0f;              /* deinterlace */
+    }
+  }
+
+  return (gfloat) combed;       /* TRUE means blend, else don't */
 }
 
 /* this is where the magic happens
@@ -1791,6 +1844,22 @@ unref_unlock_ret:
   return ret;
 }
 
+static void
+gst_field_analysis_start_pool (GstFieldAnalysis * filter)
+{
+  filter->n_bands = gst_parallel_bands_start (&filter->bands,
+      GST_OBJECT (filter), filter->max_threads);
+
+  GST_INFO_OBJECT (filter, "analysing with %u threads", filter->n_bands);
+}
+
+static void
+gst_field_analysis_stop_pool (GstFieldAnalysis * filter)
+{
+  gst_parallel_bands_stop (&filter->bands);
+  filter->n_bands = 1;
+}
+
 static GstStateChangeReturn
 gst_field_analysis_change_state (GstElement * element,
     GstStateChange transition)
@@ -1800,6 +1869,7 @@ gst_field_analysis_change_state (GstElement * element,
 
   switch (transition) {
     case GST_STATE_CHANGE_NULL_TO_READY:
+      gst_field_analysis_start_pool (filter);
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       break;
@@ -1810,8 +1880,11 @@ gst_field_analysis_change_state (GstElement * element,
   }
 
   ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
-  if (ret != GST_STATE_CHANGE_SUCCESS)
+  if (ret != GST_STATE_CHANGE_SUCCESS) {
+    if (transition == GST_STATE_CHANGE_NULL_TO_READY)
+      gst_field_analysis_stop_pool (filter);
     return ret;
+  }
 
   switch (transition) {
     case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
@@ -1820,6 +1893,8 @@ gst_field_analysis_change_state (GstElement * element,
       gst_field_analysis_reset (filter);
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
+      gst_field_analysis_stop_pool (filter);
+      break;
     default:
       break;
   }
@@ -1833,6 +1908,7 @@ gst_field_analysis_finalize (GObject * object)
   GstFieldAnalysis *filter = GST_FIELDANALYSIS (object);
 
   gst_field_analysis_reset (filter);
+  gst_parallel_bands_clear (&filter->bands);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -45,6 +45,7 @@
 #define __GST_FIELDANALYSIS_H__
 
 #include <gst/gst.h>
+#include <gst/parallel-private.h>
 
 G_BEGIN_DECLS
 #define GST_TYPE_FIELDANALYSIS \
@@ -119,14 +120,21 @@ struct _GstFieldAnalysis
   GstVideoInfo vinfo;
   gfloat (*same_field) (GstFieldAnalysis *, FieldAnalysisFields (*)[2]);
   gfloat (*same_frame) (GstFieldAnalysis *, FieldAnalysisFields (*)[2]);
-  guint64 (*block_score_for_row) (GstFieldAnalysis *, FieldAnalysisFields (*)[2], guint8 *, guint8 *);
+  guint64 (*block_score_for_row) (GstFieldAnalysis *, FieldAnalysisFields (*)[2], guint, guint8 *, guint8 *);
   gboolean is_telecine;
   gboolean first_buffer; /* indicates the first buffer for which a buffer will be output
                           * after a discont or flushing seek */
-  guint8 *comb_mask;
-  guint *block_scores;
+  guint8 *comb_mask;     /* one row of comb_mask_stride per band */
+  guint *block_scores;   /* one row of block_scores_stride per band */
+  gsize comb_mask_stride, block_scores_stride;
   gboolean flushing;     /* indicates whether we are flushing or not */
 
+  /* metrics are computed in horizontal bands, all but the first of which are
+   * handed to the pool */
+  GstParallelBands bands;
+  guint n_bands;
+  volatile gint comb_found; /* a band found combing, the others can stop */
+
   /* properties */
   guint32 noise_floor; /* threshold for the result of a metric to be valid */
   gfloat field_thresh; /* threshold used for the same parity field metric */
@@ -135,6 +143,7 @@ struct _GstFieldAnalysis
   guint64 block_width, block_height; /* width/height of window used for comb clusted detection */
   guint64 block_thresh;
   guint64 ignored_lines;
+  guint max_threads;
 };
 
 struct _GstFieldAnalysisClass
@@ -111,6 +111,17 @@ void fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (guint32 *
     const orc_uint8 * ORC_RESTRICT s2, const orc_uint8 * ORC_RESTRICT s3,
     const orc_uint8 * ORC_RESTRICT s4, const orc_uint8 * ORC_RESTRICT s5,
     int p1, int n);
+void fieldanalysis_orc_comb_mask_32detect_planar_yuv (guint8 * ORC_RESTRICT d1,
+    const orc_uint8 * ORC_RESTRICT s1, const orc_uint8 * ORC_RESTRICT s2,
+    const orc_uint8 * ORC_RESTRICT s3, const orc_uint8 * ORC_RESTRICT s4,
+    int p1, int p2, int n);
+void fieldanalysis_orc_comb_mask_iscombed_planar_yuv (guint8 * ORC_RESTRICT d1,
+    const orc_uint8 * ORC_RESTRICT s1, const orc_uint8 * ORC_RESTRICT s2,
+    const orc_uint8 * ORC_RESTRICT s3, int p1, int p2, int p3, int n);
+void fieldanalysis_orc_comb_mask_5_tap_planar_yuv (guint8 * ORC_RESTRICT d1,
+    const orc_uint8 * ORC_RESTRICT s1, const orc_uint8 * ORC_RESTRICT s2,
+    const orc_uint8 * ORC_RESTRICT s3, const orc_uint8 * ORC_RESTRICT s4,
+    const orc_uint8 * ORC_RESTRICT s5, int p1, int p2, int p3, int n);
 
 
 /* begin Orc C target preamble */
@@ -1181,3 +1192,1150 @@ fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (guint32 * ORC_RESTRICT a1,
   *a1 = orc_executor_get_accumulator (ex, ORC_VAR_A1);
 }
 #endif
+
+
+/* fieldanalysis_orc_comb_mask_32detect_planar_yuv */
+#ifdef DISABLE_ORC
+void
+fieldanalysis_orc_comb_mask_32detect_planar_yuv (guint8 * ORC_RESTRICT d1,
+    const orc_uint8 * ORC_RESTRICT s1, const orc_uint8 * ORC_RESTRICT s2,
+    const orc_uint8 * ORC_RESTRICT s3, const orc_uint8 * ORC_RESTRICT s4,
+    int p1, int p2, int n)
+{
+  int i;
+  orc_int8 *ORC_RESTRICT ptr0;
+  const orc_int8 *ORC_RESTRICT ptr4;
+  const orc_int8 *ORC_RESTRICT ptr5;
+  const orc_int8 *ORC_RESTRICT ptr6;
+  const orc_int8 *ORC_RESTRICT ptr7;
+  orc_int8 var38;
+  orc_int8 var39;
+  orc_int8 var40;
+  orc_int8 var41;
+  orc_union16 var42;
+  orc_union16 var43;
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var44;
+#else
+  orc_union16 var44;
+#endif
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var45;
+#else
+  orc_union16 var45;
+#endif
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var46;
+#else
+  orc_union16 var46;
+#endif
+  orc_int8 var47;
+  orc_union16 var48;
+  orc_union16 var49;
+  orc_union16 var50;
+  orc_union16 var51;
+  orc_union16 var52;
+  orc_union16 var53;
+  orc_union16 var54;
+  orc_union16 var55;
+  orc_union16 var56;
+  orc_union16 var57;
+  orc_union16 var58;
+  orc_union16 var59;
+  orc_union16 var60;
+  orc_union16 var61;
+  orc_union16 var62;
+  orc_union16 var63;
+  orc_union16 var64;
+  orc_union16 var65;
+  orc_union16 var66;
+  orc_union16 var67;
+  orc_union16 var68;
+  orc_union16 var69;
+
+  ptr0 = (orc_int8 *) d1;
+  ptr4 = (orc_int8 *) s1;
+  ptr5 = (orc_int8 *) s2;
+  ptr6 = (orc_int8 *) s3;
+  ptr7 = (orc_int8 *) s4;
+
+  /* 11: loadpw */
+  var42.i = p1;
+  /* 15: loadpw */
+  var43.i = p2;
+  /* 21: loadpw */
+  var44.i = (int) 0x0000000f; /* 15 or 7.41098e-323f */
+  /* 25: loadpw */
+  var45.i = (int) 0x00000009; /* 9 or 4.44659e-323f */
+  /* 29: loadpw */
+  var46.i = (int) 0x00000001; /* 1 or 4.94066e-324f */
+
+  for (i = 0; i < n; i++) {
+    /* 0: loadb */
+    var38 = ptr4[i];
+    /* 1: convubw */
+    var48.i = (orc_uint8) var38;
+    /* 2: loadb */
+    var39 = ptr5[i];
+    /* 3: convubw */
+    var49.i = (orc_uint8) var39;
+    /* 4: loadb */
+    var40 = ptr6[i];
+    /* 5: convubw */
+    var50.i = (orc_uint8) var40;
+    /* 6: loadb */
+    var41 = ptr7[i];
+    /* 7: convubw */
+    var51.i = (orc_uint8) var41;
+    /* 8: subw */
+    var52.i = var50.i - var49.i;
+    /* 9: subw */
+    var53.i = var50.i - var51.i;
+    /* 10: subw */
+    var54.i = var50.i - var48.i;
+    /* 12: cmpgtsw */
+    var55.i = (var52.i > var42.i) ? (~0) : 0;
+    /* 13: cmpgtsw */
+    var56.i = (var53.i > var42.i) ? (~0) : 0;
+    /* 14: andw */
+    var57.i = var55.i & var56.i;
+    /* 16: cmpgtsw */
+    var58.i = (var43.i > var52.i) ? (~0) : 0;
+    /* 17: cmpgtsw */
+    var59.i = (var43.i > var53.i) ? (~0) : 0;
+    /* 18: andw */
+    var60.i = var58.i & var59.i;
+    /* 19: orw */
+    var61.i = var57.i | var60.i;
+    /* 20: absw */
+    var62.i = ORC_ABS (var52.i);
+    /* 22: cmpgtsw */
+    var63.i = (var62.i > var44.i) ? (~0) : 0;
+    /* 23: andw */
+    var64.i = var61.i & var63.i;
+    /* 24: absw */
+    var65.i = ORC_ABS (var54.i);
+    /* 26: cmpgtsw */
+    var66.i = (var65.i > var45.i) ? (~0) : 0;
+    /* 27: andw */
+    var67.i = var64.i & var66.i;
+    /* 28: xorw */
+    var68.i = var64.i ^ var67.i;
+    /* 30: andw */
+    var69.i = var68.i & var46.i;
+    /* 31: convwb */
+    var47 = var69.i;
+    /* 32: storeb */
+    ptr0[i] = var47;
+  }
+
+}
+
+#else
+static void
+_backup_fieldanalysis_orc_comb_mask_32detect_planar_yuv (OrcExecutor *
+    ORC_RESTRICT ex)
+{
+  int i;
+  int n = ex->n;
+  orc_int8 *ORC_RESTRICT ptr0;
+  const orc_int8 *ORC_RESTRICT ptr4;
+  const orc_int8 *ORC_RESTRICT ptr5;
+  const orc_int8 *ORC_RESTRICT ptr6;
+  const orc_int8 *ORC_RESTRICT ptr7;
+  orc_int8 var38;
+  orc_int8 var39;
+  orc_int8 var40;
+  orc_int8 var41;
+  orc_union16 var42;
+  orc_union16 var43;
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var44;
+#else
+  orc_union16 var44;
+#endif
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var45;
+#else
+  orc_union16 var45;
+#endif
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var46;
+#else
+  orc_union16 var46;
+#endif
+  orc_int8 var47;
+  orc_union16 var48;
+  orc_union16 var49;
+  orc_union16 var50;
+  orc_union16 var51;
+  orc_union16 var52;
+  orc_union16 var53;
+  orc_union16 var54;
+  orc_union16 var55;
+  orc_union16 var56;
+  orc_union16 var57;
+  orc_union16 var58;
+  orc_union16 var59;
+  orc_union16 var60;
+  orc_union16 var61;
+  orc_union16 var62;
+  orc_union16 var63;
+  orc_union16 var64;
+  orc_union16 var65;
+  orc_union16 var66;
+  orc_union16 var67;
+  orc_union16 var68;
+  orc_union16 var69;
+
+  ptr0 = (orc_int8 *) ex->arrays[0];
+  ptr4 = (orc_int8 *) ex->arrays[4];
+  ptr5 = (orc_int8 *) ex->arrays[5];
+  ptr6 = (orc_int8 *) ex->arrays[6];
+  ptr7 = (orc_int8 *) ex->arrays[7];
+
+  /* 11: loadpw */
+  var42.i = ex->params[24];
+  /* 15: loadpw */
+  var43.i = ex->params[25];
+  /* 21: loadpw */
+  var44.i = (int) 0x0000000f; /* 15 or 7.41098e-323f */
+  /* 25: loadpw */
+  var45.i = (int) 0x00000009; /* 9 or 4.44659e-323f */
+  /* 29: loadpw */
+  var46.i = (int) 0x00000001; /* 1 or 4.94066e-324f */
+
+  for (i = 0; i < n; i++) {
+    /* 0: loadb */
+    var38 = ptr4[i];
+    /* 1: convubw */
+    var48.i = (orc_uint8) var38;
+    /* 2: loadb */
+    var39 = ptr5[i];
+    /* 3: convubw */
+    var49.i = (orc_uint8) var39;
+    /* 4: loadb */
+    var40 = ptr6[i];
+    /* 5: convubw */
+    var50.i = (orc_uint8) var40;
+    /* 6: loadb */
+    var41 = ptr7[i];
+    /* 7: convubw */
+    var51.i = (orc_uint8) var41;
+    /* 8: subw */
+    var52.i = var50.i - var49.i;
+    /* 9: subw */
+    var53.i = var50.i - var51.i;
+    /* 10: subw */
+    var54.i = var50.i - var48.i;
+    /* 12: cmpgtsw */
+    var55.i = (var52.i > var42.i) ? (~0) : 0;
+    /* 13: cmpgtsw */
+    var56.i = (var53.i > var42.i) ? (~0) : 0;
+    /* 14: andw */
+    var57.i = var55.i & var56.i;
+    /* 16: cmpgtsw */
+    var58.i = (var43.i > var52.i) ? (~0) : 0;
+    /* 17: cmpgtsw */
+    var59.i = (var43.i > var53.i) ? (~0) : 0;
+    /* 18: andw */
+    var60.i = var58.i & var59.i;
+    /* 19: orw */
+    var61.i = var57.i | var60.i;
+    /* 20: absw */
+    var62.i = ORC_ABS (var52.i);
+    /* 22: cmpgtsw */
+    var63.i = (var62.i > var44.i) ? (~0) : 0;
+    /* 23: andw */
+    var64.i = var61.i & var63.i;
+    /* 24: absw */
+    var65.i = ORC_ABS (var54.i);
+    /* 26: cmpgtsw */
+    var66.i = (var65.i > var45.i) ? (~0) : 0;
+    /* 27: andw */
+    var67.i = var64.i & var66.i;
+    /* 28: xorw */
+    var68.i = var64.i ^ var67.i;
+    /* 30: andw */
+    var69.i = var68.i & var46.i;
+    /* 31: convwb */
+    var47 = var69.i;
+    /* 32: storeb */
+    ptr0[i] = var47;
+  }
+
+}
+
+void
+fieldanalysis_orc_comb_mask_32detect_planar_yuv (guint8 * ORC_RESTRICT d1,
+    const orc_uint8 * ORC_RESTRICT s1, const orc_uint8 * ORC_RESTRICT s2,
+    const orc_uint8 * ORC_RESTRICT s3, const orc_uint8 * ORC_RESTRICT s4,
+    int p1, int p2, int n)
+{
+  OrcExecutor _ex, *ex = &_ex;
+  static volatile int p_inited = 0;
+  static OrcCode *c = 0;
+  void (*func) (OrcExecutor *);
+
+  if (!p_inited) {
+    orc_once_mutex_lock ();
+    if (!p_inited) {
+      OrcProgram *p;
+
+#if 1
+      static const orc_uint8 bc[] = {
+        1, 9, 47, 102, 105, 101, 108, 100, 97, 110, 97, 108, 121, 115, 105, 115,
+        95, 111, 114, 99, 95, 99, 111, 109, 98, 95, 109, 97, 115, 107, 95, 51,
+        50, 100, 101, 116, 101, 99, 116, 95, 112, 108, 97, 110, 97, 114, 95, 121,
+        117, 118, 11, 1, 1, 12, 1, 1, 12, 1, 1, 12, 1, 1, 12, 1,
+        1, 14, 2, 15, 0, 0, 0, 14, 2, 9, 0, 0, 0, 14, 2, 1,
+        0, 0, 0, 16, 2, 16, 2, 20, 2, 20, 2, 20, 2, 20, 2, 20,
+        2, 20, 2, 150, 32, 4, 150, 33, 5, 150, 34, 6, 150, 35, 7, 98,
+        33, 34, 33, 98, 35, 34, 35, 98, 32, 34, 32, 78, 36, 33, 24, 78,
+        37, 35, 24, 73, 36, 36, 37, 78, 37, 25, 33, 78, 35, 25, 35, 73,
+        37, 37, 35, 92, 36, 36, 37, 69, 33, 33, 78, 33, 33, 16, 73, 36,
+        36, 33, 69, 32, 32, 78, 32, 32, 17, 73, 32, 36, 32, 101, 36, 36,
+        32, 73, 36, 36, 18, 157, 0, 36, 2, 0,
+      };
+      p = orc_program_new_from_static_bytecode (bc);
+      orc_program_set_backup_function (p,
+          _backup_fieldanalysis_orc_comb_mask_32detect_planar_yuv);
+#else
+      p = orc_program_new ();
+      orc_program_set_name (p, "fieldanalysis_orc_comb_mask_32detect_planar_yuv");
+      orc_program_set_backup_function (p,
+          _backup_fieldanalysis_orc_comb_mask_32detect_planar_yuv);
+      orc_program_add_destination (p, 1, "d1");
+      orc_program_add_source (p, 1, "s1");
+      orc_program_add_source (p, 1, "s2");
+      orc_program_add_source (p, 1, "s3");
+      orc_program_add_source (p, 1, "s4");
+      orc_program_add_constant (p, 2, 0x0000000f, "c1");
+      orc_program_add_constant (p, 2, 0x00000009, "c2");
+      orc_program_add_constant (p, 2, 0x00000001, "c3");
+      orc_program_add_parameter (p, 2, "p1");
+      orc_program_add_parameter (p, 2, "p2");
+      orc_program_add_temporary (p, 2, "t1");
+      orc_program_add_temporary (p, 2, "t2");
+      orc_program_add_temporary (p, 2, "t3");
+      orc_program_add_temporary (p, 2, "t4");
+      orc_program_add_temporary (p, 2, "t5");
+      orc_program_add_temporary (p, 2, "t6");
+
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T1, ORC_VAR_S1, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T2, ORC_VAR_S2, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T3, ORC_VAR_S3, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T4, ORC_VAR_S4, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "subw", 0, ORC_VAR_T2, ORC_VAR_T3, ORC_VAR_T2,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "subw", 0, ORC_VAR_T4, ORC_VAR_T3, ORC_VAR_T4,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "subw", 0, ORC_VAR_T1, ORC_VAR_T3, ORC_VAR_T1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T5, ORC_VAR_T2, ORC_VAR_P1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T6, ORC_VAR_T4, ORC_VAR_P1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T5, ORC_VAR_T5, ORC_VAR_T6,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T6, ORC_VAR_P2, ORC_VAR_T2,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T4, ORC_VAR_P2, ORC_VAR_T4,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T6, ORC_VAR_T6, ORC_VAR_T4,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "orw", 0, ORC_VAR_T5, ORC_VAR_T5, ORC_VAR_T6,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "absw", 0, ORC_VAR_T2, ORC_VAR_T2, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T2, ORC_VAR_T2, ORC_VAR_C1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T5, ORC_VAR_T5, ORC_VAR_T2,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "absw", 0, ORC_VAR_T1, ORC_VAR_T1, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T1, ORC_VAR_T1, ORC_VAR_C2,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T1, ORC_VAR_T5, ORC_VAR_T1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "xorw", 0, ORC_VAR_T5, ORC_VAR_T5, ORC_VAR_T1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T5, ORC_VAR_T5, ORC_VAR_C3,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convwb", 0, ORC_VAR_D1, ORC_VAR_T5, ORC_VAR_D1,
+          ORC_VAR_D1);
+#endif
+
+      orc_program_compile (p);
+      c = orc_program_take_code (p);
+      orc_program_free (p);
+    }
+    p_inited = TRUE;
+    orc_once_mutex_unlock ();
+  }
+  ex->arrays[ORC_VAR_A2] = c;
+  ex->program = 0;
+
+  ex->n = n;
+  ex->arrays[ORC_VAR_D1] = d1;
+  ex->arrays[ORC_VAR_S1] = (void *) s1;
+  ex->arrays[ORC_VAR_S2] = (void *) s2;
+  ex->arrays[ORC_VAR_S3] = (void *) s3;
+  ex->arrays[ORC_VAR_S4] = (void *) s4;
+  ex->params[ORC_VAR_P1] = p1;
+  ex->params[ORC_VAR_P2] = p2;
+
+  func = c->exec;
+  func (ex);
+}
+#endif
+
+
+/* fieldanalysis_orc_comb_mask_iscombed_planar_yuv */
+#ifdef DISABLE_ORC
+void
+fieldanalysis_orc_comb_mask_iscombed_planar_yuv (guint8 * ORC_RESTRICT d1,
+    const orc_uint8 * ORC_RESTRICT s1, const orc_uint8 * ORC_RESTRICT s2,
+    const orc_uint8 * ORC_RESTRICT s3, int p1, int p2, int p3, int n)
+{
+  int i;
+  orc_int8 *ORC_RESTRICT ptr0;
+  const orc_int8 *ORC_RESTRICT ptr4;
+  const orc_int8 *ORC_RESTRICT ptr5;
+  const orc_int8 *ORC_RESTRICT ptr6;
+  orc_int8 var38;
+  orc_int8 var39;
+  orc_int8 var40;
+  orc_union16 var41;
+  orc_union16 var42;
+  orc_union32 var43;
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var44;
+#else
+  orc_union16 var44;
+#endif
+  orc_int8 var45;
+  orc_union16 var46;
+  orc_union16 var47;
+  orc_union16 var48;
+  orc_union16 var49;
+  orc_union16 var50;
+  orc_union16 var51;
+  orc_union16 var52;
+  orc_union16 var53;
+  orc_union16 var54;
+  orc_union16 var55;
+  orc_union16 var56;
+  orc_union16 var57;
+  orc_union32 var58;
+  orc_union32 var59;
+  orc_union16 var60;
+  orc_union16 var61;
+  orc_union16 var62;
+
+  ptr0 = (orc_int8 *) d1;
+  ptr4 = (orc_int8 *) s1;
+  ptr5 = (orc_int8 *) s2;
+  ptr6 = (orc_int8 *) s3;
+
+  /* 8: loadpw */
+  var41.i = p1;
+  /* 12: loadpw */
+  var42.i = p2;
+  /* 18: loadpl */
+  var43.i = p3;
+  /* 22: loadpw */
+  var44.i = (int) 0x00000001; /* 1 or 4.94066e-324f */
+
+  for (i = 0; i < n; i++) {
+    /* 0: loadb */
+    var38 = ptr4[i];
+    /* 1: convubw */
+    var46.i = (orc_uint8) var38;
+    /* 2: loadb */
+    var39 = ptr5[i];
+    /* 3: convubw */
+    var47.i = (orc_uint8) var39;
+    /* 4: loadb */
+    var40 = ptr6[i];
+    /* 5: convubw */
+    var48.i = (orc_uint8) var40;
+    /* 6: subw */
+    var49.i = var47.i - var46.i;
+    /* 7: subw */
+    var50.i = var47.i - var48.i;
+    /* 9: cmpgtsw */
+    var51.i = (var49.i > var41.i) ? (~0) : 0;
+    /* 10: cmpgtsw */
+    var52.i = (var50.i > var41.i) ? (~0) : 0;
+    /* 11: andw */
+    var53.i = var51.i & var52.i;
+    /* 13: cmpgtsw */
+    var54.i = (var42.i > var49.i) ? (~0) : 0;
+    /* 14: cmpgtsw */
+    var55.i = (var42.i > var50.i) ? (~0) : 0;
+    /* 15: andw */
+    var56.i = var54.i & var55.i;
+    /* 16: orw */
+    var57.i = var53.i | var56.i;
+    /* 17: mulswl */
+    var58.i = var49.i * var50.i;
+    /* 19: cmpgtsl */
+    var59.i = (var58.i > var43.i) ? (~0) : 0;
+    /* 20: convlw */
+    var60.i = var59.i;
+    /* 21: andw */
+    var61.i = var57.i & var60.i;
+    /* 23: andw */
+    var62.i = var61.i & var44.i;
+    /* 24: convwb */
+    var45 = var62.i;
+    /* 25: storeb */
+    ptr0[i] = var45;
+  }
+
+}
+
+#else
+static void
+_backup_fieldanalysis_orc_comb_mask_iscombed_planar_yuv (OrcExecutor *
+    ORC_RESTRICT ex)
+{
+  int i;
+  int n = ex->n;
+  orc_int8 *ORC_RESTRICT ptr0;
+  const orc_int8 *ORC_RESTRICT ptr4;
+  const orc_int8 *ORC_RESTRICT ptr5;
+  const orc_int8 *ORC_RESTRICT ptr6;
+  orc_int8 var38;
+  orc_int8 var39;
+  orc_int8 var40;
+  orc_union16 var41;
+  orc_union16 var42;
+  orc_union32 var43;
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var44;
+#else
+  orc_union16 var44;
+#endif
+  orc_int8 var45;
+  orc_union16 var46;
+  orc_union16 var47;
+  orc_union16 var48;
+  orc_union16 var49;
+  orc_union16 var50;
+  orc_union16 var51;
+  orc_union16 var52;
+  orc_union16 var53;
+  orc_union16 var54;
+  orc_union16 var55;
+  orc_union16 var56;
+  orc_union16 var57;
+  orc_union32 var58;
+  orc_union32 var59;
+  orc_union16 var60;
+  orc_union16 var61;
+  orc_union16 var62;
+
+  ptr0 = (orc_int8 *) ex->arrays[0];
+  ptr4 = (orc_int8 *) ex->arrays[4];
+  ptr5 = (orc_int8 *) ex->arrays[5];
+  ptr6 = (orc_int8 *) ex->arrays[6];
+
+  /* 8: loadpw */
+  var41.i = ex->params[24];
+  /* 12: loadpw */
+  var42.i = ex->params[25];
+  /* 18: loadpl */
+  var43.i = ex->params[26];
+  /* 22: loadpw */
+  var44.i = (int) 0x00000001; /* 1 or 4.94066e-324f */
+
+  for (i = 0; i < n; i++) {
+    /* 0: loadb */
+    var38 = ptr4[i];
+    /* 1: convubw */
+    var46.i = (orc_uint8) var38;
+    /* 2: loadb */
+    var39 = ptr5[i];
+    /* 3: convubw */
+    var47.i = (orc_uint8) var39;
+    /* 4: loadb */
+    var40 = ptr6[i];
+    /* 5: convubw */
+    var48.i = (orc_uint8) var40;
+    /* 6: subw */
+    var49.i = var47.i - var46.i;
+    /* 7: subw */
+    var50.i = var47.i - var48.i;
+    /* 9: cmpgtsw */
+    var51.i = (var49.i > var41.i) ? (~0) : 0;
+    /* 10: cmpgtsw */
+    var52.i = (var50.i > var41.i) ? (~0) : 0;
+    /* 11: andw */
+    var53.i = var51.i & var52.i;
+    /* 13: cmpgtsw */
+    var54.i = (var42.i > var49.i) ? (~0) : 0;
+    /* 14: cmpgtsw */
+    var55.i = (var42.i > var50.i) ? (~0) : 0;
+    /* 15: andw */
+    var56.i = var54.i & var55.i;
+    /* 16: orw */
+    var57.i = var53.i | var56.i;
+    /* 17: mulswl */
+    var58.i = var49.i * var50.i;
+    /* 19: cmpgtsl */
+    var59.i = (var58.i > var43.i) ? (~0) : 0;
+    /* 20: convlw */
+    var60.i = var59.i;
+    /* 21: andw */
+    var61.i = var57.i & var60.i;
+    /* 23: andw */
+    var62.i = var61.i & var44.i;
+    /* 24: convwb */
+    var45 = var62.i;
+    /* 25: storeb */
+    ptr0[i] = var45;
+  }
+
+}
+
+void
+fieldanalysis_orc_comb_mask_iscombed_planar_yuv (guint8 * ORC_RESTRICT d1,
+    const orc_uint8 * ORC_RESTRICT s1, const orc_uint8 * ORC_RESTRICT s2,
+    const orc_uint8 * ORC_RESTRICT s3, int p1, int p2, int p3, int n)
+{
+  OrcExecutor _ex, *ex = &_ex;
+  static volatile int p_inited = 0;
+  static OrcCode *c = 0;
+  void (*func) (OrcExecutor *);
+
+  if (!p_inited) {
+    orc_once_mutex_lock ();
+    if (!p_inited) {
+      OrcProgram *p;
+
+#if 1
+      static const orc_uint8 bc[] = {
+        1, 9, 47, 102, 105, 101, 108, 100, 97, 110, 97, 108, 121, 115, 105, 115,
+        95, 111, 114, 99, 95, 99, 111, 109, 98, 95, 109, 97, 115, 107, 95, 105,
+        115, 99, 111, 109, 98, 101, 100, 95, 112, 108, 97, 110, 97, 114, 95, 121,
+        117, 118, 11, 1, 1, 12, 1, 1, 12, 1, 1, 12, 1, 1, 14, 2,
+        1, 0, 0, 0, 16, 2, 16, 2, 16, 4, 20, 2, 20, 2, 20, 2,
+        20, 2, 20, 2, 20, 4, 150, 32, 4, 150, 33, 5, 150, 34, 6, 98,
+        32, 33, 32, 98, 33, 33, 34, 78, 34, 32, 24, 78, 35, 33, 24, 73,
+        34, 34, 35, 78, 35, 25, 32, 78, 36, 25, 33, 73, 35, 35, 36, 92,
+        34, 34, 35, 176, 37, 32, 33, 111, 37, 37, 26, 163, 35, 37, 73, 34,
+        34, 35, 73, 34, 34, 16, 157, 0, 34, 2, 0,
+      };
+      p = orc_program_new_from_static_bytecode (bc);
+      orc_program_set_backup_function (p,
+          _backup_fieldanalysis_orc_comb_mask_iscombed_planar_yuv);
+#else
+      p = orc_program_new ();
+      orc_program_set_name (p, "fieldanalysis_orc_comb_mask_iscombed_planar_yuv");
+      orc_program_set_backup_function (p,
+          _backup_fieldanalysis_orc_comb_mask_iscombed_planar_yuv);
+      orc_program_add_destination (p, 1, "d1");
+      orc_program_add_source (p, 1, "s1");
+      orc_program_add_source (p, 1, "s2");
+      orc_program_add_source (p, 1, "s3");
+      orc_program_add_constant (p, 2, 0x00000001, "c1");
+      orc_program_add_parameter (p, 2, "p1");
+      orc_program_add_parameter (p, 2, "p2");
+      orc_program_add_parameter (p, 4, "p3");
+      orc_program_add_temporary (p, 2, "t1");
+      orc_program_add_temporary (p, 2, "t2");
+      orc_program_add_temporary (p, 2, "t3");
+      orc_program_add_temporary (p, 2, "t4");
+      orc_program_add_temporary (p, 2, "t5");
+      orc_program_add_temporary (p, 4, "t6");
+
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T1, ORC_VAR_S1, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T2, ORC_VAR_S2, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T3, ORC_VAR_S3, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "subw", 0, ORC_VAR_T1, ORC_VAR_T2, ORC_VAR_T1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "subw", 0, ORC_VAR_T2, ORC_VAR_T2, ORC_VAR_T3,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T3, ORC_VAR_T1, ORC_VAR_P1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T4, ORC_VAR_T2, ORC_VAR_P1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T3, ORC_VAR_T3, ORC_VAR_T4,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T4, ORC_VAR_P2, ORC_VAR_T1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T5, ORC_VAR_P2, ORC_VAR_T2,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T4, ORC_VAR_T4, ORC_VAR_T5,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "orw", 0, ORC_VAR_T3, ORC_VAR_T3, ORC_VAR_T4,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "mulswl", 0, ORC_VAR_T6, ORC_VAR_T1, ORC_VAR_T2,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsl", 0, ORC_VAR_T6, ORC_VAR_T6, ORC_VAR_P3,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convlw", 0, ORC_VAR_T4, ORC_VAR_T6, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T3, ORC_VAR_T3, ORC_VAR_T4,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T3, ORC_VAR_T3, ORC_VAR_C1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convwb", 0, ORC_VAR_D1, ORC_VAR_T3, ORC_VAR_D1,
+          ORC_VAR_D1);
+#endif
+
+      orc_program_compile (p);
+      c = orc_program_take_code (p);
+      orc_program_free (p);
+    }
+    p_inited = TRUE;
+    orc_once_mutex_unlock ();
+  }
+  ex->arrays[ORC_VAR_A2] = c;
+  ex->program = 0;
+
+  ex->n = n;
+  ex->arrays[ORC_VAR_D1] = d1;
+  ex->arrays[ORC_VAR_S1] = (void *) s1;
+  ex->arrays[ORC_VAR_S2] = (void *) s2;
+  ex->arrays[ORC_VAR_S3] = (void *) s3;
+  ex->params[ORC_VAR_P1] = p1;
+  ex->params[ORC_VAR_P2] = p2;
+  ex->params[ORC_VAR_P3] = p3;
+
+  func = c->exec;
+  func (ex);
+}
+#endif
+
+
+/* fieldanalysis_orc_comb_mask_5_tap_planar_yuv */
+#ifdef DISABLE_ORC
+void
+fieldanalysis_orc_comb_mask_5_tap_planar_yuv (guint8 * ORC_RESTRICT d1,
+    const orc_uint8 * ORC_RESTRICT s1, const orc_uint8 * ORC_RESTRICT s2,
+    const orc_uint8 * ORC_RESTRICT s3, const orc_uint8 * ORC_RESTRICT s4,
+    const orc_uint8 * ORC_RESTRICT s5, int p1, int p2, int p3, int n)
+{
+  int i;
+  orc_int8 *ORC_RESTRICT ptr0;
+  const orc_int8 *ORC_RESTRICT ptr4;
+  const orc_int8 *ORC_RESTRICT ptr5;
+  const orc_int8 *ORC_RESTRICT ptr6;
+  const orc_int8 *ORC_RESTRICT ptr7;
+  const orc_int8 *ORC_RESTRICT ptr8;
+  orc_int8 var37;
+  orc_int8 var38;
+  orc_int8 var39;
+  orc_int8 var40;
+  orc_int8 var41;
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var42;
+#else
+  orc_union16 var42;
+#endif
+  orc_union16 var43;
+  orc_union16 var44;
+  orc_union16 var45;
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var46;
+#else
+  orc_union16 var46;
+#endif
+  orc_int8 var47;
+  orc_union16 var48;
+  orc_union16 var49;
+  orc_union16 var50;
+  orc_union16 var51;
+  orc_union16 var52;
+  orc_union16 var53;
+  orc_union16 var54;
+  orc_union16 var55;
+  orc_union16 var56;
+  orc_union16 var57;
+  orc_union16 var58;
+  orc_union16 var59;
+  orc_union16 var60;
+  orc_union16 var61;
+  orc_union16 var62;
+  orc_union16 var63;
+  orc_union16 var64;
+  orc_union16 var65;
+  orc_union16 var66;
+  orc_union16 var67;
+  orc_union16 var68;
+  orc_union16 var69;
+  orc_union16 var70;
+  orc_union16 var71;
+
+  ptr0 = (orc_int8 *) d1;
+  ptr4 = (orc_int8 *) s1;
+  ptr5 = (orc_int8 *) s2;
+  ptr6 = (orc_int8 *) s3;
+  ptr7 = (orc_int8 *) s4;
+  ptr8 = (orc_int8 *) s5;
+
+  /* 14: loadpw */
+  var42.i = (int) 0x00000003; /* 3 or 1.4822e-323f */
+  /* 18: loadpw */
+  var43.i = p3;
+  /* 22: loadpw */
+  var44.i = p1;
+  /* 26: loadpw */
+  var45.i = p2;
+  /* 32: loadpw */
+  var46.i = (int) 0x00000001; /* 1 or 4.94066e-324f */
+
+  for (i = 0; i < n; i++) {
+    /* 0: loadb */
+    var37 = ptr4[i];
+    /* 1: convubw */
+    var48.i = (orc_uint8) var37;
+    /* 2: loadb */
+    var38 = ptr5[i];
+    /* 3: convubw */
+    var49.i = (orc_uint8) var38;
+    /* 4: loadb */
+    var39 = ptr6[i];
+    /* 5: convubw */
+    var50.i = (orc_uint8) var39;
+    /* 6: loadb */
+    var40 = ptr7[i];
+    /* 7: convubw */
+    var51.i = (orc_uint8) var40;
+    /* 8: loadb */
+    var41 = ptr8[i];
+    /* 9: convubw */
+    var52.i = (orc_uint8) var41;
+    /* 10: addw */
+    var53.i = var48.i + var52.i;
+    /* 11: shlw */
+    var54.i = ((orc_uint16) var50.i) << 2;
+    /* 12: addw */
+    var55.i = var53.i + var54.i;
+    /* 13: addw */
+    var56.i = var49.i + var51.i;
+    /* 15: mullw */
+    var57.i = (var56.i * var42.i) & 0xffff;
+    /* 16: subw */
+    var58.i = var55.i - var57.i;
+    /* 17: absw */
+    var59.i = ORC_ABS (var58.i);
+    /* 19: cmpgtsw */
+    var60.i = (var59.i > var43.i) ? (~0) : 0;
+    /* 20: subw */
+    var61.i = var50.i - var49.i;
+    /* 21: subw */
+    var62.i = var50.i - var51.i;
+    /* 23: cmpgtsw */
+    var63.i = (var61.i > var44.i) ? (~0) : 0;
+    /* 24: cmpgtsw */
+    var64.i = (var62.i > var44.i) ? (~0) : 0;
+    /* 25: andw */
+    var65.i = var63.i & var64.i;
+    /* 27: cmpgtsw */
+    var66.i = (var45.i > var61.i) ? (~0) : 0;
+    /* 28: cmpgtsw */
+    var67.i = (var45.i > var62.i) ? (~0) : 0;
+    /* 29: andw */
+    var68.i = var66.i & var67.i;
+    /* 30: orw */
+    var69.i = var65.i | var68.i;
+    /* 31: andw */
+    var70.i = var69.i & var60.i;
+    /* 33: andw */
+    var71.i = var70.i & var46.i;
+    /* 34: convwb */
+    var47 = var71.i;
+    /* 35: storeb */
+    ptr0[i] = var47;
+  }
+
+}
+
+#else
+static void
+_backup_fieldanalysis_orc_comb_mask_5_tap_planar_yuv (OrcExecutor * ORC_RESTRICT
+    ex)
+{
+  int i;
+  int n = ex->n;
+  orc_int8 *ORC_RESTRICT ptr0;
+  const orc_int8 *ORC_RESTRICT ptr4;
+  const orc_int8 *ORC_RESTRICT ptr5;
+  const orc_int8 *ORC_RESTRICT ptr6;
+  const orc_int8 *ORC_RESTRICT ptr7;
+  const orc_int8 *ORC_RESTRICT ptr8;
+  orc_int8 var37;
+  orc_int8 var38;
+  orc_int8 var39;
+  orc_int8 var40;
+  orc_int8 var41;
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var42;
+#else
+  orc_union16 var42;
+#endif
+  orc_union16 var43;
+  orc_union16 var44;
+  orc_union16 var45;
+#if defined(__APPLE__) && __GNUC__ == 4 && __GNUC_MINOR__ == 2 && defined (__i386__)
+  volatile orc_union16 var46;
+#else
+  orc_union16 var46;
+#endif
+  orc_int8 var47;
+  orc_union16 var48;
+  orc_union16 var49;
+  orc_union16 var50;
+  orc_union16 var51;
+  orc_union16 var52;
+  orc_union16 var53;
+  orc_union16 var54;
+  orc_union16 var55;
+  orc_union16 var56;
+  orc_union16 var57;
+  orc_union16 var58;
+  orc_union16 var59;
+  orc_union16 var60;
+  orc_union16 var61;
+  orc_union16 var62;
+  orc_union16 var63;
+  orc_union16 var64;
+  orc_union16 var65;
+  orc_union16 var66;
+  orc_union16 var67;
+  orc_union16 var68;
+  orc_union16 var69;
+  orc_union16 var70;
+  orc_union16 var71;
+
+  ptr0 = (orc_int8 *) ex->arrays[0];
+  ptr4 = (orc_int8 *) ex->arrays[4];
+  ptr5 = (orc_int8 *) ex->arrays[5];
+  ptr6 = (orc_int8 *) ex->arrays[6];
+  ptr7 = (orc_int8 *) ex->arrays[7];
+  ptr8 = (orc_int8 *) ex->arrays[8];
+
+  /* 14: loadpw */
+  var42.i = (int) 0x00000003; /* 3 or 1.4822e-323f */
+  /* 18: loadpw */
+  var43.i = ex->params[26];
+  /* 22: loadpw */
+  var44.i = ex->params[24];
+  /* 26: loadpw */
+  var45.i = ex->params[25];
+  /* 32: loadpw */
+  var46.i = (int) 0x00000001; /* 1 or 4.94066e-324f */
+
+  for (i = 0; i < n; i++) {
+    /* 0: loadb */
+    var37 = ptr4[i];
+    /* 1: convubw */
+    var48.i = (orc_uint8) var37;
+    /* 2: loadb */
+    var38 = ptr5[i];
+    /* 3: convubw */
+    var49.i = (orc_uint8) var38;
+    /* 4: loadb */
+    var39 = ptr6[i];
+    /* 5: convubw */
+    var50.i = (orc_uint8) var39;
+    /* 6: loadb */
+    var40 = ptr7[i];
+    /* 7: convubw */
+    var51.i = (orc_uint8) var40;
+    /* 8: loadb */
+    var41 = ptr8[i];
+    /* 9: convubw */
+    var52.i = (orc_uint8) var41;
+    /* 10: addw */
+    var53.i = var48.i + var52.i;
+    /* 11: shlw */
+    var54.i = ((orc_uint16) var50.i) << 2;
+    /* 12: addw */
+    var55.i = var53.i + var54.i;
+    /* 13: addw */
+    var56.i = var49.i + var51.i;
+    /* 15: mullw */
+    var57.i = (var56.i * var42.i) & 0xffff;
+    /* 16: subw */
+    var58.i = var55.i - var57.i;
+    /* 17: absw */
+    var59.i = ORC_ABS (var58.i);
+    /* 19: cmpgtsw */
+    var60.i = (var59.i > var43.i) ? (~0) : 0;
+    /* 20: subw */
+    var61.i = var50.i - var49.i;
+    /* 21: subw */
+    var62.i = var50.i - var51.i;
+    /* 23: cmpgtsw */
+    var63.i = (var61.i > var44.i) ? (~0) : 0;
+    /* 24: cmpgtsw */
+    var64.i = (var62.i > var44.i) ? (~0) : 0;
+    /* 25: andw */
+    var65.i = var63.i & var64.i;
+    /* 27: cmpgtsw */
+    var66.i = (var45.i > var61.i) ? (~0) : 0;
+    /* 28: cmpgtsw */
+    var67.i = (var45.i > var62.i) ? (~0) : 0;
+    /* 29: andw */
+    var68.i = var66.i & var67.i;
+    /* 30: orw */
+    var69.i = var65.i | var68.i;
+    /* 31: andw */
+    var70.i = var69.i & var60.i;
+    /* 33: andw */
+    var71.i = var70.i & var46.i;
+    /* 34: convwb */
+    var47 = var71.i;
+    /* 35: storeb */
+    ptr0[i] = var47;
+  }
+
+}
+
+void
+fieldanalysis_orc_comb_mask_5_tap_planar_yuv (guint8 * ORC_RESTRICT d1,
+    const orc_uint8 * ORC_RESTRICT s1, const orc_uint8 * ORC_RESTRICT s2,
+    const orc_uint8 * ORC_RESTRICT s3, const orc_uint8 * ORC_RESTRICT s4,
+    const orc_uint8 * ORC_RESTRICT s5, int p1, int p2, int p3, int n)
+{
+  OrcExecutor _ex, *ex = &_ex;
+  static volatile int p_inited = 0;
+  static OrcCode *c = 0;
+  void (*func) (OrcExecutor *);
+
+  if (!p_inited) {
+    orc_once_mutex_lock ();
+    if (!p_inited) {
+      OrcProgram *p;
+
+#if 1
+      static const orc_uint8 bc[] = {
+        1, 9, 44, 102, 105, 101, 108, 100, 97, 110, 97, 108, 121, 115, 105, 115,
+        95, 111, 114, 99, 95, 99, 111, 109, 98, 95, 109, 97, 115, 107, 95, 53,
+        95, 116, 97, 112, 95, 112, 108, 97, 110, 97, 114, 95, 121, 117, 118, 11,
+        1, 1, 12, 1, 1, 12, 1, 1, 12, 1, 1, 12, 1, 1, 12, 1,
+        1, 14, 2, 2, 0, 0, 0, 14, 2, 3, 0, 0, 0, 14, 2, 1,
+        0, 0, 0, 16, 2, 16, 2, 16, 2, 20, 2, 20, 2, 20, 2, 20,
+        2, 20, 2, 150, 32, 4, 150, 33, 5, 150, 34, 6, 150, 35, 7, 150,
+        36, 8, 70, 32, 32, 36, 93, 36, 34, 16, 70, 32, 32, 36, 70, 36,
+        33, 35, 89, 36, 36, 17, 98, 32, 32, 36, 69, 32, 32, 78, 32, 32,
+        26, 98, 33, 34, 33, 98, 35, 34, 35, 78, 36, 33, 24, 78, 34, 35,
+        24, 73, 36, 36, 34, 78, 33, 25, 33, 78, 35, 25, 35, 73, 33, 33,
+        35, 92, 36, 36, 33, 73, 36, 36, 32, 73, 36, 36, 18, 157, 0, 36,
+        2, 0,
+      };
+      p = orc_program_new_from_static_bytecode (bc);
+      orc_program_set_backup_function (p,
+          _backup_fieldanalysis_orc_comb_mask_5_tap_planar_yuv);
+#else
+      p = orc_program_new ();
+      orc_program_set_name (p, "fieldanalysis_orc_comb_mask_5_tap_planar_yuv");
+      orc_program_set_backup_function (p,
+          _backup_fieldanalysis_orc_comb_mask_5_tap_planar_yuv);
+      orc_program_add_destination (p, 1, "d1");
+      orc_program_add_source (p, 1, "s1");
+      orc_program_add_source (p, 1, "s2");
+      orc_program_add_source (p, 1, "s3");
+      orc_program_add_source (p, 1, "s4");
+      orc_program_add_source (p, 1, "s5");
+      orc_program_add_constant (p, 2, 0x00000002, "c1");
+      orc_program_add_constant (p, 2, 0x00000003, "c2");
+      orc_program_add_constant (p, 2, 0x00000001, "c3");
+      orc_program_add_parameter (p, 2, "p1");
+      orc_program_add_parameter (p, 2, "p2");
+      orc_program_add_parameter (p, 2, "p3");
+      orc_program_add_temporary (p, 2, "t1");
+      orc_program_add_temporary (p, 2, "t2");
+      orc_program_add_temporary (p, 2, "t3");
+      orc_program_add_temporary (p, 2, "t4");
+      orc_program_add_temporary (p, 2, "t5");
+
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T1, ORC_VAR_S1, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T2, ORC_VAR_S2, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T3, ORC_VAR_S3, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T4, ORC_VAR_S4, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convubw", 0, ORC_VAR_T5, ORC_VAR_S5, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "addw", 0, ORC_VAR_T1, ORC_VAR_T1, ORC_VAR_T5,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "shlw", 0, ORC_VAR_T5, ORC_VAR_T3, ORC_VAR_C1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "addw", 0, ORC_VAR_T1, ORC_VAR_T1, ORC_VAR_T5,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "addw", 0, ORC_VAR_T5, ORC_VAR_T2, ORC_VAR_T4,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "mullw", 0, ORC_VAR_T5, ORC_VAR_T5, ORC_VAR_C2,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "subw", 0, ORC_VAR_T1, ORC_VAR_T1, ORC_VAR_T5,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "absw", 0, ORC_VAR_T1, ORC_VAR_T1, ORC_VAR_D1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T1, ORC_VAR_T1, ORC_VAR_P3,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "subw", 0, ORC_VAR_T2, ORC_VAR_T3, ORC_VAR_T2,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "subw", 0, ORC_VAR_T4, ORC_VAR_T3, ORC_VAR_T4,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T5, ORC_VAR_T2, ORC_VAR_P1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T3, ORC_VAR_T4, ORC_VAR_P1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T5, ORC_VAR_T5, ORC_VAR_T3,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T2, ORC_VAR_P2, ORC_VAR_T2,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "cmpgtsw", 0, ORC_VAR_T4, ORC_VAR_P2, ORC_VAR_T4,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T2, ORC_VAR_T2, ORC_VAR_T4,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "orw", 0, ORC_VAR_T5, ORC_VAR_T5, ORC_VAR_T2,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T5, ORC_VAR_T5, ORC_VAR_T1,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "andw", 0, ORC_VAR_T5, ORC_VAR_T5, ORC_VAR_C3,
+          ORC_VAR_D1);
+      orc_program_append_2 (p, "convwb", 0, ORC_VAR_D1, ORC_VAR_T5, ORC_VAR_D1,
+          ORC_VAR_D1);
+#endif
+
+      orc_program_compile (p);
+      c = orc_program_take_code (p);
+      orc_program_free (p);
+    }
+    p_inited = TRUE;
+    orc_once_mutex_unlock ();
+  }
+  ex->arrays[ORC_VAR_A2] = c;
+  ex->program = 0;
+
+  ex->n = n;
+  ex->arrays[ORC_VAR_D1] = d1;
+  ex->arrays[ORC_VAR_S1] = (void *) s1;
+  ex->arrays[ORC_VAR_S2] = (void *) s2;
+  ex->arrays[ORC_VAR_S3] = (void *) s3;
+  ex->arrays[ORC_VAR_S4] = (void *) s4;
+  ex->arrays[ORC_VAR_S5] = (void *) s5;
+  ex->params[ORC_VAR_P1] = p1;
+  ex->params[ORC_VAR_P2] = p2;
+  ex->params[ORC_VAR_P3] = p3;
+
+  func = c->exec;
+  func (ex);
+}
+#endif
@@ -219,8 +219,11 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   /* header */
   gst_buffer_append_memory (ret_buf, mem);
 
-  /* buffer data */
-  return gst_buffer_append (ret_buf, gst_buffer_ref (buffer));
+  /* buffer data; the payload memories are only reffed, never copied, so
+   * the packet is scattered over the header and the original memory */
+  gst_buffer_copy_into (ret_buf, buffer, GST_BUFFER_COPY_MEMORY, 0, -1);
+
+  return ret_buf;
 }
 
 GstBuffer *
@@ -473,6 +476,17 @@ gst_dp_header_payload_type (const guint8 * header)
 
 /*** DEPACKETIZING FUNCTIONS ***/
 
+static void
+gst_dp_buffer_set_metadata (GstBuffer * buffer, const guint8 * header)
+{
+  GST_BUFFER_TIMESTAMP (buffer) = GST_DP_HEADER_TIMESTAMP (header);
+  GST_BUFFER_DTS (buffer) = GST_DP_HEADER_DTS (header);
+  GST_BUFFER_DURATION (buffer) = GST_DP_HEADER_DURATION (header);
+  GST_BUFFER_OFFSET (buffer) = GST_DP_HEADER_OFFSET (header);
+  GST_BUFFER_OFFSET_END (buffer) = GST_DP_HEADER_OFFSET_END (header);
+  GST_BUFFER_FLAGS (buffer) = GST_DP_HEADER_BUFFER_FLAGS (header);
+}
+
 /**
  * gst_dp_buffer_from_header:
  * @header_length: the length of the packet header
@@ -503,14 +517,59 @@ gst_dp_buffer_from_header (guint header_length, const guint8 * header)
       gst_buffer_new_allocate (NULL,
       (guint) GST_DP_HEADER_PAYLOAD_LENGTH (header), NULL);
 
-  GST_BUFFER_TIMESTAMP (buffer) = GST_DP_HEADER_TIMESTAMP (header);
-  GST_BUFFER_DTS (buffer) = GST_DP_HEADER_DTS (header);
-  GST_BUFFER_DURATION (buffer) = GST_DP_HEADER_DURATION (header);
-  GST_BUFFER_OFFSET (buffer) = GST_DP_HEADER_OFFSET (header);
-  GST_BUFFER_OFFSET_END (buffer) = GST_DP_HEADER_OFFSET_END (header);
-  GST_BUFFER_FLAGS (buffer) = GST_DP_HEADER_BUFFER_FLAGS (header);
+  gst_dp_buffer_set_metadata (buffer, header);
+
+  return buffer;
+}
+
+/**
+ * gst_dp_buffer_from_header_and_payload:
+ * @header_length: the length of the packet header
+ * @header: the byte array of the packet header
+ * @payload: (transfer full) (allow-none): a #GstBuffer with the packet payload
+ *
+ * Creates a #GstBuffer from the given header that wraps the memory of
+ * @payload instead of copying it. @payload would typically be taken from
+ * an adapter with gst_adapter_take_buffer_fast() so that the returned
+ * buffer shares the memory of the buffers the packet was received in.
+ *
+ * This function does not check the header or payload passed to it, use
+ * gst_dp_validate_header() and gst_dp_validate_payload_buffer() first if
+ * the data is unchecked.
+ *
+ * Returns: A #GstBuffer if the buffer was successfully created, or NULL.
+ */
+GstBuffer *
+gst_dp_buffer_from_header_and_payload (guint header_length,
+    const guint8 * header, GstBuffer * payload)
+{
+  GstBuffer *buffer;
+
+  /* @payload is owned even when the header is refused */
+  if (G_UNLIKELY (header == NULL || header_length < GST_DP_HEADER_LENGTH ||
+          GST_DP_HEADER_PAYLOAD_TYPE (header) != GST_DP_PAYLOAD_BUFFER))
+    goto invalid_header;
+
+  if (payload == NULL) {
+    buffer = gst_buffer_new ();
+  } else {
+    /* this is a shallow copy if someone else still holds a ref, the
+     * memory itself is shared */
+    buffer = gst_buffer_make_writable (payload);
+  }
+
+  gst_dp_buffer_set_metadata (buffer, header);
 
   return buffer;
+
+  /* ERRORS */
+invalid_header:
+  {
+    g_critical ("%s: no valid buffer packet header", G_STRFUNC);
+    if (payload)
+      gst_buffer_unref (payload);
+    return NULL;
+  }
 }
 
 /**
@@ -750,6 +809,64 @@ crc_error:
   }
 }
 
+/**
+ * gst_dp_validate_payload_buffer:
+ * @header_length: the length of the packet header
+ * @header: the byte array of the packet header
+ * @payload: (allow-none): a #GstBuffer with the packet payload
+ *
+ * Validates the given packet payload using the given packet header
+ * by checking the CRC checksum. Unlike gst_dp_validate_payload() the
+ * payload does not have to be contiguous, the checksum is calculated
+ * over the memories of @payload without merging them.
+ *
+ * Returns: %TRUE if the CRC matches, or no CRC checksum is present.
+ */
+gboolean
+gst_dp_validate_payload_buffer (guint header_length, const guint8 * header,
+    GstBuffer * payload)
+{
+  guint16 crc_read, crc_calculated = 0;
+  GstMapInfo *maps;
+  guint n_maps, i;
+
+  g_return_val_if_fail (header != NULL, FALSE);
+  g_return_val_if_fail (header_length >= GST_DP_HEADER_LENGTH, FALSE);
+
+  if (!(GST_DP_HEADER_FLAGS (header) & GST_DP_HEADER_FLAG_CRC_PAYLOAD))
+    return TRUE;
+
+  crc_read = GST_DP_HEADER_CRC_PAYLOAD (header);
+
+  n_maps = payload ? gst_buffer_n_memory (payload) : 0;
+  if (n_maps > 0) {
+    maps = g_newa (GstMapInfo, n_maps);
+
+    for (i = 0; i < n_maps; ++i)
+      gst_memory_map (gst_buffer_peek_memory (payload, i), &maps[i],
+          GST_MAP_READ);
+
+    crc_calculated = gst_dp_crc_from_memory_maps (maps, n_maps);
+
+    for (i = 0; i < n_maps; ++i)
+      gst_memory_unmap (maps[i].memory, &maps[i]);
+  }
+
+  if (crc_read != crc_calculated)
+    goto crc_error;
+
+  GST_LOG ("payload crc validation: %02x", crc_read);
+  return TRUE;
+
+  /* ERRORS */
+crc_error:
+  {
+    GST_WARNING ("payload crc mismatch: read %02x, calculated %02x", crc_read,
+        crc_calculated);
+    return FALSE;
+  }
+}
+
 /**
  * gst_dp_validate_packet:
  * @header_length: the length of the packet header
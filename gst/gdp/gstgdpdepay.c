@@ -280,7 +280,10 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
           goto wrong_type;
         }
 
-        if (this->payload_length) {
+        /* buffer payloads are validated when they are taken from the
+         * adapter so that they never have to be merged into one chunk */
+        if (this->payload_length &&
+            this->payload_type != GST_DP_PAYLOAD_BUFFER) {
           const guint8 *data;
           gboolean res;
 
@@ -297,26 +300,34 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       }
       case GST_GDP_DEPAY_STATE_BUFFER:
       {
+        GstBuffer *payload;
+
         /* if we receive a buffer without caps first, we error out */
         if (!this->caps)
           goto no_caps;
 
         GST_LOG_OBJECT (this, "reading GDP buffer from adapter");
-        buf = gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header);
-        if (!buf)
-          goto buffer_failed;
 
-        /* now take the payload if there is any */
-        if (this->payload_length > 0) {
-          GstMapInfo map;
-
-          gst_buffer_map (buf, &map, GST_MAP_WRITE);
-          gst_adapter_copy (this->adapter, map.data, 0, this->payload_length);
-          gst_buffer_unmap (buf, &map);
+        /* take the payload if there is any. This gives us the memory of the
+         * input buffers, or sub-buffers of them, without copying */
+        if (this->payload_length > 0)
+          payload = gst_adapter_take_buffer_fast (this->adapter,
+              this->payload_length);
+        else
+          payload = NULL;
 
-          gst_adapter_flush (this->adapter, this->payload_length);
+        if (!gst_dp_validate_payload_buffer (GST_DP_HEADER_LENGTH,
+                this->header, payload)) {
+          if (payload)
+            gst_buffer_unref (payload);
+          goto payload_validate_error;
         }
 
+        buf = gst_dp_buffer_from_header_and_payload (GST_DP_HEADER_LENGTH,
+            this->header, payload);
+        if (!buf)
+          goto buffer_failed;
+
         /* set caps and push */
         GST_LOG_OBJECT (this, "deserialized buffer %p, pushing, timestamp %"
             GST_TIME_FORMAT ", duration %" GST_TIME_FORMAT
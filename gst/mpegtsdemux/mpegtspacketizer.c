@@ -293,6 +293,7 @@ mpegts_packetizer_dispose (GObject * object)
 
     gst_adapter_clear (packetizer->adapter);
     g_object_unref (packetizer->adapter);
+    gst_buffer_replace (&packetizer->last_in_buffer, NULL);
     g_mutex_clear (&packetizer->group_lock);
     packetizer->disposed = TRUE;
     packetizer->offset = 0;
@@ -574,6 +575,7 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
   }
 
   gst_adapter_clear (packetizer->adapter);
+  gst_buffer_replace (&packetizer->last_in_buffer, NULL);
   packetizer->offset = 0;
   packetizer->empty = TRUE;
   packetizer->need_sync = FALSE;
@@ -608,6 +610,7 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
     }
   }
   gst_adapter_clear (packetizer->adapter);
+  gst_buffer_replace (&packetizer->last_in_buffer, NULL);
 
   packetizer->offset = 0;
   packetizer->empty = TRUE;
@@ -666,6 +669,7 @@ mpegts_packetizer_push (MpegTSPacketizer2 * packetizer, GstBuffer * buffer)
   GST_DEBUG ("Pushing %" G_GSIZE_FORMAT " byte from offset %"
       G_GUINT64_FORMAT, gst_buffer_get_size (buffer),
       GST_BUFFER_OFFSET (buffer));
+  gst_buffer_replace (&packetizer->last_in_buffer, buffer);
   gst_adapter_push (packetizer->adapter, buffer);
   /* If buffer timestamp is valid, store it */
   if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_TIMESTAMP (buffer)))
@@ -885,6 +889,33 @@ mpegts_packetizer_clear_packet (MpegTSPacketizer2 * packetizer,
   }
 }
 
+/* Returns the input buffer holding all 188 bytes of @packet, with @offset
+ * set to their position in it, so that they can be output without a copy.
+ * Returns NULL if the packet is split over several input buffers.
+ *
+ * The returned buffer is only valid until the next
+ * mpegts_packetizer_push() */
+GstBuffer *
+mpegts_packetizer_get_packet_input (MpegTSPacketizer2 * packetizer,
+    MpegTSPacketizerPacket * packet, gsize * offset)
+{
+  gsize in_size, tail;
+
+  if (G_UNLIKELY (!packetizer->map_data || !packetizer->last_in_buffer))
+    return NULL;
+
+  /* The mapping always starts at the head of the adapter and the last input
+   * buffer is its tail, so count from the end */
+  tail = gst_adapter_available (packetizer->adapter) -
+      (packet->data_start - packetizer->map_data);
+  in_size = gst_buffer_get_size (packetizer->last_in_buffer);
+  if (tail > in_size)
+    return NULL;
+
+  *offset = in_size - tail;
+  return packetizer->last_in_buffer;
+}
+
 gboolean
 mpegts_packetizer_has_packets (MpegTSPacketizer2 * packetizer)
 {
@@ -278,6 +278,9 @@ struct _MpegTSPacketizer2 {
   /* Last inputted timestamp */
   GstClockTime last_in_time;
 
+  /* Last inputted buffer, always the tail of the adapter */
+  GstBuffer *last_in_buffer;
+
   /* offset to observations table */
   guint8 pcrtablelut[0x2000];
   MpegTSPCR *observations[MAX_PCR_OBS_CHANNELS];
@@ -348,6 +351,8 @@ G_GNUC_INTERNAL MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet(MpegTSPacketizer2 * packetizer);
 G_GNUC_INTERNAL void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetizer,
 				     MpegTSPacketizerPacket *packet);
+G_GNUC_INTERNAL GstBuffer *mpegts_packetizer_get_packet_input (MpegTSPacketizer2 *packetizer,
+				     MpegTSPacketizerPacket *packet, gsize *offset);
 G_GNUC_INTERNAL void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
   gint16 pid);
 
@@ -58,11 +58,13 @@ struct _MpegTSParsePad
   gint program_number;
   MpegTSParseProgram *program;
 
-  /* set to FALSE before a push and TRUE after */
-  gboolean pushed;
-
-  /* the return of the latest push */
-  GstFlowReturn flow_return;
+  /* Packets for this pad from the current input buffer, pushed all at
+   * once when it is done. Consecutive packets from the same input buffer
+   * are collected as a run and output as a single sub-buffer of it */
+  GstBufferList *pending;
+  GstBuffer *run_buffer;
+  gsize run_start;
+  gsize run_end;
 };
 
 static GstStaticPadTemplate src_template =
@@ -122,6 +124,8 @@ static GstFlowReturn mpegts_parse_input_done (MpegTSBase * base,
     GstBuffer * buffer);
 static GstFlowReturn
 drain_pending_buffers (MpegTSParse2 * parse, gboolean drain_all);
+static GstFlowReturn mpegts_parse_push_pending (MpegTSParse2 * parse);
+static void mpegts_parse_drop_pending (MpegTSParse2 * parse);
 
 static void
 mpegts_parse_class_init (MpegTSParse2Class * klass)
@@ -230,6 +234,7 @@ mpegts_parse_reset (MpegTSBase * base)
 
   g_list_free_full (parse->pending_buffers, (GDestroyNotify) gst_buffer_unref);
   parse->pending_buffers = NULL;
+  mpegts_parse_drop_pending (parse);
 
   parse->current_pcr = GST_CLOCK_TIME_NONE;
   parse->previous_pcr = GST_CLOCK_TIME_NONE;
@@ -361,6 +366,13 @@ push_event (MpegTSBase * base, GstEvent * event)
   if (G_UNLIKELY (GST_EVENT_TYPE (event) == GST_EVENT_EOS))
     drain_pending_buffers (parse, TRUE);
 
+  /* Packets queued for the program pads go before the event */
+  if (G_UNLIKELY (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_START ||
+          GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP))
+    mpegts_parse_drop_pending (parse);
+  else
+    mpegts_parse_push_pending (parse);
+
   if (G_UNLIKELY (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT))
     parse->ts_offset = 0;
 
@@ -392,8 +404,6 @@ mpegts_parse_create_tspad (MpegTSParse2 * parse, const gchar * pad_name)
   tspad->pad = pad;
   tspad->program_number = -1;
   tspad->program = NULL;
-  tspad->pushed = FALSE;
-  tspad->flow_return = GST_FLOW_NOT_LINKED;
   gst_pad_set_element_private (pad, tspad);
 
   return tspad;
@@ -402,6 +412,10 @@ mpegts_parse_create_tspad (MpegTSParse2 * parse, const gchar * pad_name)
 static void
 mpegts_parse_destroy_tspad (MpegTSParse2 * parse, MpegTSParsePad * tspad)
 {
+  gst_buffer_replace (&tspad->run_buffer, NULL);
+  if (tspad->pending)
+    gst_buffer_list_unref (tspad->pending);
+
   /* free the wrapper */
   g_free (tspad);
 }
@@ -416,9 +430,11 @@ mpegts_parse_pad_removed (GstElement * element, GstPad * pad)
   if (gst_pad_get_direction (pad) == GST_PAD_SINK)
     return;
 
+  GST_OBJECT_LOCK (parse);
   tspad = (MpegTSParsePad *) gst_pad_get_element_private (pad);
   if (tspad) {
     mpegts_parse_destroy_tspad (parse, tspad);
+    gst_pad_set_element_private (pad, NULL);
 
     parse->srcpads = g_list_remove_all (parse->srcpads, pad);
   }
@@ -426,6 +442,7 @@ mpegts_parse_pad_removed (GstElement * element, GstPad * pad)
     base->push_data = FALSE;
     base->push_section = FALSE;
   }
+  GST_OBJECT_UNLOCK (parse);
 
   if (GST_ELEMENT_CLASS (parent_class)->pad_removed)
     GST_ELEMENT_CLASS (parent_class)->pad_removed (element, pad);
@@ -467,7 +484,9 @@ mpegts_parse_request_new_pad (GstElement * element, GstPadTemplate * template,
   }
 
   pad = tspad->pad;
+  GST_OBJECT_LOCK (parse);
   parse->srcpads = g_list_append (parse->srcpads, pad);
+  GST_OBJECT_UNLOCK (parse);
   base->push_data = TRUE;
   base->push_section = TRUE;
 
@@ -508,11 +527,62 @@ mpegts_parse_release_pad (GstElement * element, GstPad * pad)
   gst_element_remove_pad (element, pad);
 }
 
-static GstFlowReturn
+/* Called with the object lock */
+static void
+mpegts_parse_tspad_flush_run (MpegTSParsePad * tspad)
+{
+  if (!tspad->run_buffer)
+    return;
+
+  if (!tspad->pending)
+    tspad->pending = gst_buffer_list_new ();
+
+  gst_buffer_list_add (tspad->pending,
+      gst_buffer_copy_region (tspad->run_buffer, GST_BUFFER_COPY_MEMORY,
+          tspad->run_start, tspad->run_end - tspad->run_start));
+  gst_buffer_replace (&tspad->run_buffer, NULL);
+}
+
+/* Called with the object lock */
+static void
+mpegts_parse_tspad_queue_packet (MpegTSParse2 * parse, MpegTSParsePad * tspad,
+    MpegTSPacketizerPacket * packet)
+{
+  MpegTSPacketizer2 *packetizer = GST_MPEGTS_BASE (parse)->packetizer;
+  gsize size = packet->data_end - packet->data_start;
+  GstBuffer *input;
+  gsize offset;
+
+  input = mpegts_packetizer_get_packet_input (packetizer, packet, &offset);
+
+  /* Directly follows the previous packet for this pad, as in 188 byte
+   * streams with no other PIDs in between */
+  if (input && input == tspad->run_buffer && offset == tspad->run_end) {
+    tspad->run_end += size;
+    return;
+  }
+
+  mpegts_parse_tspad_flush_run (tspad);
+
+  if (input) {
+    tspad->run_buffer = gst_buffer_ref (input);
+    tspad->run_start = offset;
+    tspad->run_end = offset + size;
+  } else {
+    /* Split over two input buffers */
+    GstBuffer *buf = gst_buffer_new_and_alloc (size);
+    gst_buffer_fill (buf, 0, packet->data_start, size);
+
+    if (!tspad->pending)
+      tspad->pending = gst_buffer_list_new ();
+    gst_buffer_list_add (tspad->pending, buf);
+  }
+}
+
+static void
 mpegts_parse_tspad_push_section (MpegTSParse2 * parse, MpegTSParsePad * tspad,
     GstMpegtsSection * section, MpegTSPacketizerPacket * packet)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
   gboolean to_push = TRUE;
 
   if (tspad->program_number != -1) {
@@ -531,26 +601,18 @@ mpegts_parse_tspad_push_section (MpegTSParse2 * parse, MpegTSParsePad * tspad,
     }
   }
 
-  GST_DEBUG_OBJECT (parse,
-      "pushing section: %d program number: %d table_id: %d", to_push,
-      tspad->program_number, section->table_id);
-
-  if (to_push) {
-    GstBuffer *buf =
-        gst_buffer_new_and_alloc (packet->data_end - packet->data_start);
-    gst_buffer_fill (buf, 0, packet->data_start,
-        packet->data_end - packet->data_start);
-    ret = gst_pad_push (tspad->pad, buf);
-  }
+  /* No GST_DEBUG_OBJECT () here, we hold the object lock */
+  GST_DEBUG ("pushing section: %d program number: %d table_id: %d",
+      to_push, tspad->program_number, section->table_id);
 
-  return ret;
+  if (to_push)
+    mpegts_parse_tspad_queue_packet (parse, tspad, packet);
 }
 
-static GstFlowReturn
+static void
 mpegts_parse_tspad_push (MpegTSParse2 * parse, MpegTSParsePad * tspad,
     MpegTSPacketizerPacket * packet)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
   MpegTSBaseStream **pad_pids = NULL;
 
   if (tspad->program_number != -1) {
@@ -560,113 +622,113 @@ mpegts_parse_tspad_push (MpegTSParse2 * parse, MpegTSParsePad * tspad,
     } else {
       /* there's a program filter on the pad but the PMT for the program has not
        * been parsed yet, ignore the pad until we get a PMT */
-      goto out;
+      return;
     }
   }
 
-  if (pad_pids == NULL || pad_pids[packet->pid]) {
-    GstBuffer *buf =
-        gst_buffer_new_and_alloc (packet->data_end - packet->data_start);
-    gst_buffer_fill (buf, 0, packet->data_start,
-        packet->data_end - packet->data_start);
-    /* push if there's no filter or if the pid is in the filter */
-    ret = gst_pad_push (tspad->pad, buf);
-  }
-
-out:
-  return ret;
-}
-
-static void
-pad_clear_for_push (GstPad * pad, MpegTSParse2 * parse)
-{
-  MpegTSParsePad *tspad = (MpegTSParsePad *) gst_pad_get_element_private (pad);
-
-  tspad->flow_return = GST_FLOW_NOT_LINKED;
-  tspad->pushed = FALSE;
+  /* push if there's no filter or if the pid is in the filter */
+  if (pad_pids == NULL || pad_pids[packet->pid])
+    mpegts_parse_tspad_queue_packet (parse, tspad, packet);
 }
 
+/* Packets are only queued here, and pushed from mpegts_parse_input_done()
+ * once the whole input buffer was handled */
 static GstFlowReturn
 mpegts_parse_push (MpegTSBase * base, MpegTSPacketizerPacket * packet,
     GstMpegtsSection * section)
 {
   MpegTSParse2 *parse = (MpegTSParse2 *) base;
-  guint32 pads_cookie;
-  gboolean done = FALSE;
-  GstPad *pad = NULL;
   MpegTSParsePad *tspad;
-  GstFlowReturn ret;
-  GList *srcpads;
+  GList *tmp;
 
   GST_OBJECT_LOCK (parse);
-  srcpads = parse->srcpads;
-
-  /* clear tspad->pushed on pads */
-  g_list_foreach (srcpads, (GFunc) pad_clear_for_push, parse);
-  if (srcpads)
-    ret = GST_FLOW_NOT_LINKED;
-  else
-    ret = GST_FLOW_OK;
+  for (tmp = parse->srcpads; tmp; tmp = tmp->next) {
+    tspad = gst_pad_get_element_private (GST_PAD_CAST (tmp->data));
 
-  /* Get cookie and source pads list */
-  pads_cookie = GST_ELEMENT_CAST (parse)->pads_cookie;
-  if (G_LIKELY (srcpads)) {
-    pad = GST_PAD_CAST (srcpads->data);
-    g_object_ref (pad);
+    if (section)
+      mpegts_parse_tspad_push_section (parse, tspad, section, packet);
+    else
+      mpegts_parse_tspad_push (parse, tspad, packet);
   }
   GST_OBJECT_UNLOCK (parse);
 
-  while (pad && !done) {
-    tspad = gst_pad_get_element_private (pad);
+  return GST_FLOW_OK;
+}
 
-    if (G_LIKELY (!tspad->pushed)) {
-      if (section) {
-        tspad->flow_return =
-            mpegts_parse_tspad_push_section (parse, tspad, section, packet);
-      } else {
-        tspad->flow_return = mpegts_parse_tspad_push (parse, tspad, packet);
-      }
-      tspad->pushed = TRUE;
+static GstFlowReturn
+mpegts_parse_push_pending (MpegTSParse2 * parse)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  gboolean linked = FALSE;
+  GSList *pads = NULL, *lists = NULL, *p, *l;
+  MpegTSParsePad *tspad;
+  GList *tmp;
 
-      if (G_UNLIKELY (tspad->flow_return != GST_FLOW_OK
-              && tspad->flow_return != GST_FLOW_NOT_LINKED)) {
-        /* return the error upstream */
-        ret = tspad->flow_return;
-        done = TRUE;
-      }
+  GST_OBJECT_LOCK (parse);
+  if (parse->srcpads == NULL)
+    linked = TRUE;
+  for (tmp = parse->srcpads; tmp; tmp = tmp->next) {
+    tspad = gst_pad_get_element_private (GST_PAD_CAST (tmp->data));
 
+    mpegts_parse_tspad_flush_run (tspad);
+    if (tspad->pending) {
+      pads = g_slist_prepend (pads, gst_object_ref (tmp->data));
+      lists = g_slist_prepend (lists, tspad->pending);
+      tspad->pending = NULL;
+    } else {
+      /* Nothing for this pad, which is fine */
+      linked = TRUE;
     }
+  }
+  GST_OBJECT_UNLOCK (parse);
 
-    if (ret == GST_FLOW_NOT_LINKED)
-      ret = tspad->flow_return;
-
-    g_object_unref (pad);
-
-    if (G_UNLIKELY (!done)) {
-      GST_OBJECT_LOCK (parse);
-      if (G_UNLIKELY (pads_cookie != GST_ELEMENT_CAST (parse)->pads_cookie)) {
-        /* resync */
-        GST_DEBUG ("resync");
-        pads_cookie = GST_ELEMENT_CAST (parse)->pads_cookie;
-        srcpads = parse->srcpads;
-      } else {
-        GST_DEBUG ("getting next pad");
-        /* Get next pad */
-        srcpads = g_list_next (srcpads);
-      }
+  pads = g_slist_reverse (pads);
+  lists = g_slist_reverse (lists);
+
+  for (p = pads, l = lists; p; p = p->next, l = l->next) {
+    GstBufferList *list = l->data;
 
-      if (srcpads) {
-        pad = GST_PAD_CAST (srcpads->data);
-        g_object_ref (pad);
-      } else
-        done = TRUE;
-      GST_OBJECT_UNLOCK (parse);
+    if (ret == GST_FLOW_OK) {
+      GstFlowReturn pad_ret = gst_pad_push_list (GST_PAD_CAST (p->data), list);
+
+      if (pad_ret == GST_FLOW_OK)
+        linked = TRUE;
+      else if (pad_ret != GST_FLOW_NOT_LINKED)
+        /* return the error upstream */
+        ret = pad_ret;
+    } else {
+      gst_buffer_list_unref (list);
     }
+    gst_object_unref (p->data);
   }
+  g_slist_free (pads);
+  g_slist_free (lists);
+
+  if (ret == GST_FLOW_OK && !linked)
+    ret = GST_FLOW_NOT_LINKED;
 
   return ret;
 }
 
+static void
+mpegts_parse_drop_pending (MpegTSParse2 * parse)
+{
+  MpegTSParsePad *tspad;
+  GList *tmp;
+
+  GST_OBJECT_LOCK (parse);
+  for (tmp = parse->srcpads; tmp; tmp = tmp->next) {
+    tspad = gst_pad_get_element_private (GST_PAD_CAST (tmp->data));
+
+    gst_buffer_replace (&tspad->run_buffer, NULL);
+    if (tspad->pending) {
+      gst_buffer_list_unref (tspad->pending);
+      tspad->pending = NULL;
+    }
+  }
+  GST_OBJECT_UNLOCK (parse);
+}
+
 static void
 mpegts_parse_inspect_packet (MpegTSBase * base, MpegTSPacketizerPacket * packet)
 {
@@ -725,6 +787,7 @@ drain_pending_buffers (MpegTSParse2 * parse, gboolean drain_all)
   GstClockTime pcr_diff = 0;
   gsize pcr_bytes, bytes_since_pcr, pos;
   GstBuffer *buffer;
+  GstBufferList *list;
   GList *l, *end = NULL;
 
   if (parse->pending_buffers == NULL)
@@ -796,7 +859,9 @@ drain_pending_buffers (MpegTSParse2 * parse, gboolean drain_all)
       " duration %" GST_TIME_FORMAT " %" G_GSIZE_FORMAT " bytes",
       GST_TIME_ARGS (start_ts), GST_TIME_ARGS (pcr_diff), pcr_bytes);
 
-  /* Now, push buffers out pacing timestamps over pcr_diff time and pcr_bytes */
+  /* Now, push buffers out pacing timestamps over pcr_diff time and pcr_bytes,
+   * all in one list */
+  list = gst_buffer_list_new ();
   pos = 0;
   l = g_list_last (parse->pending_buffers);
   while (l != end) {
@@ -817,10 +882,7 @@ drain_pending_buffers (MpegTSParse2 * parse, gboolean drain_all)
 
     GST_BUFFER_PTS (buffer) = out_ts + parse->ts_offset;
     GST_BUFFER_DTS (buffer) = out_ts + parse->ts_offset;
-    if (ret == GST_FLOW_OK)
-      ret = gst_pad_push (parse->srcpad, buffer);
-    else
-      gst_buffer_unref (buffer);
+    gst_buffer_list_add (list, buffer);
 
     /* Free this list node and move to the next */
     p = g_list_previous (l);
@@ -832,6 +894,12 @@ drain_pending_buffers (MpegTSParse2 * parse, gboolean drain_all)
   parse->pending_buffers = end;
   parse->bytes_since_pcr = bytes_since_pcr;
   parse->previous_pcr = pcr;
+
+  if (gst_buffer_list_length (list) > 0)
+    ret = gst_pad_push_list (parse->srcpad, list);
+  else
+    gst_buffer_list_unref (list);
+
   return ret;
 }
 
@@ -843,6 +911,13 @@ mpegts_parse_input_done (MpegTSBase * base, GstBuffer * buffer)
 
   GST_LOG_OBJECT (parse, "Received buffer %" GST_PTR_FORMAT, buffer);
 
+  /* Output everything the program pads got from this buffer */
+  ret = mpegts_parse_push_pending (parse);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (buffer);
+    return ret;
+  }
+
   if (parse->current_pcr != GST_CLOCK_TIME_NONE) {
     GST_DEBUG_OBJECT (parse,
         "InputTS %" GST_TIME_FORMAT " PCR %" GST_TIME_FORMAT,
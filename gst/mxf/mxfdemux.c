@@ -75,8 +75,14 @@ static GstFlowReturn
 gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
     GstBuffer ** outbuf, guint * read);
 static GstFlowReturn
+gst_mxf_demux_peek_klv_packet (GstMXFDemux * demux, guint64 offset,
+    MXFUL * key, guint * data_offset, guint64 * length);
+static GstFlowReturn
 gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer, guint64 offset);
+static gint64
+gst_mxf_demux_get_position_for_offset (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, guint64 offset);
 
 GType gst_mxf_demux_pad_get_type (void);
 G_DEFINE_TYPE (GstMXFDemuxPad, gst_mxf_demux_pad, GST_TYPE_PAD);
@@ -279,6 +285,19 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
 
   demux->index_table_segments_collected = FALSE;
 
+  if (demux->index_tables) {
+    guint i;
+
+    for (i = 0; i < demux->index_tables->len; i++) {
+      GstMXFDemuxIndexTable *t =
+          &g_array_index (demux->index_tables, GstMXFDemuxIndexTable, i);
+      g_array_free (t->segments, TRUE);
+    }
+    g_array_free (demux->index_tables, TRUE);
+    demux->index_tables = NULL;
+  }
+  demux->index_tables_dirty = FALSE;
+
   gst_mxf_demux_reset_mxf_state (demux);
   gst_mxf_demux_reset_metadata (demux);
 
@@ -836,15 +855,18 @@ gst_mxf_demux_update_essence_tracks (GstMXFDemux * demux)
         MXFEssenceWrapping track_wrapping;
 
         track_wrapping = etrack->handler->get_track_wrapping (track);
-        if (track_wrapping == MXF_ESSENCE_WRAPPING_CLIP_WRAPPING) {
+        if (track_wrapping == MXF_ESSENCE_WRAPPING_CLIP_WRAPPING &&
+            !demux->random_access) {
+          /* We would have to collect the complete clip in the adapter */
           GST_ELEMENT_ERROR (demux, STREAM, NOT_IMPLEMENTED, (NULL),
-              ("Clip essence wrapping is not implemented yet."));
+              ("Clip essence wrapping is only supported in pull mode."));
           return GST_FLOW_ERROR;
         } else if (track_wrapping == MXF_ESSENCE_WRAPPING_CUSTOM_WRAPPING) {
           GST_ELEMENT_ERROR (demux, STREAM, NOT_IMPLEMENTED, (NULL),
               ("Custom essence wrappings are not supported."));
           return GST_FLOW_ERROR;
         }
+        etrack->wrapping = track_wrapping;
       }
 
       etrack->source_package = package;
@@ -1592,94 +1614,16 @@ gst_mxf_demux_pad_set_component (GstMXFDemux * demux, GstMXFDemuxPad * pad,
   return ret;
 }
 
+/* Pushes @n_edit_units edit units of @etrack contained in @buffer */
 static GstFlowReturn
-gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
-    const MXFUL * key, GstBuffer * buffer, gboolean peek)
+gst_mxf_demux_handle_essence (GstMXFDemux * demux, const MXFUL * key,
+    GstMXFDemuxEssenceTrack * etrack, GstBuffer * buffer, guint n_edit_units,
+    gboolean keyframe, gboolean peek)
 {
   GstFlowReturn ret = GST_FLOW_OK;
-  guint32 track_number;
   guint i;
   GstBuffer *inbuf = NULL;
   GstBuffer *outbuf = NULL;
-  GstMXFDemuxEssenceTrack *etrack = NULL;
-  gboolean keyframe = TRUE;
-
-  GST_DEBUG_OBJECT (demux,
-      "Handling generic container essence element of size %" G_GSIZE_FORMAT
-      " at offset %" G_GUINT64_FORMAT, gst_buffer_get_size (buffer),
-      demux->offset);
-
-  GST_DEBUG_OBJECT (demux, "  type = 0x%02x", key->u[12]);
-  GST_DEBUG_OBJECT (demux, "  essence element count = 0x%02x", key->u[13]);
-  GST_DEBUG_OBJECT (demux, "  essence element type = 0x%02x", key->u[14]);
-  GST_DEBUG_OBJECT (demux, "  essence element number = 0x%02x", key->u[15]);
-
-  if (demux->current_partition->essence_container_offset == 0)
-    demux->current_partition->essence_container_offset =
-        demux->offset - demux->current_partition->partition.this_partition -
-        demux->run_in;
-
-  if (!demux->current_package) {
-    GST_ERROR_OBJECT (demux, "No package selected yet");
-    return GST_FLOW_ERROR;
-  }
-
-  if (demux->src->len == 0) {
-    GST_ERROR_OBJECT (demux, "No streams created yet");
-    return GST_FLOW_ERROR;
-  }
-
-  if (demux->essence_tracks->len == 0) {
-    GST_ERROR_OBJECT (demux, "No essence streams found in the metadata");
-    return GST_FLOW_ERROR;
-  }
-
-  track_number = GST_READ_UINT32_BE (&key->u[12]);
-
-  for (i = 0; i < demux->essence_tracks->len; i++) {
-    GstMXFDemuxEssenceTrack *tmp =
-        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
-
-    if (tmp->body_sid == demux->current_partition->partition.body_sid &&
-        (tmp->track_number == track_number || tmp->track_number == 0)) {
-      etrack = tmp;
-      break;
-    }
-  }
-
-  if (!etrack) {
-    GST_WARNING_OBJECT (demux,
-        "No essence track for this essence element found");
-    return GST_FLOW_OK;
-  }
-
-  if (etrack->position == -1) {
-    GST_DEBUG_OBJECT (demux,
-        "Unknown essence track position, looking into index");
-    if (etrack->offsets) {
-      for (i = 0; i < etrack->offsets->len; i++) {
-        GstMXFDemuxIndex *idx =
-            &g_array_index (etrack->offsets, GstMXFDemuxIndex, i);
-
-        if (idx->offset != 0 && idx->offset == demux->offset - demux->run_in) {
-          etrack->position = i;
-          break;
-        }
-      }
-    }
-
-    if (etrack->position == -1) {
-      GST_WARNING_OBJECT (demux, "Essence track position not in index");
-      return GST_FLOW_OK;
-    }
-  }
-
-  if (etrack->offsets && etrack->offsets->len > etrack->position) {
-    GstMXFDemuxIndex *index =
-        &g_array_index (etrack->offsets, GstMXFDemuxIndex, etrack->position);
-    if (index->offset != 0)
-      keyframe = index->keyframe;
-  }
 
   /* Create subbuffer to be able to change metadata */
   inbuf =
@@ -1713,10 +1657,12 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
   if (outbuf)
     keyframe = !GST_BUFFER_FLAG_IS_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
 
-  if (!etrack->offsets)
-    etrack->offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
+  /* Clip wrapped essence has no essence element per edit unit, its
+   * offsets are calculated from the edit unit size or index tables */
+  if (etrack->wrapping != MXF_ESSENCE_WRAPPING_CLIP_WRAPPING) {
+    if (!etrack->offsets)
+      etrack->offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
 
-  {
     if (etrack->offsets->len > etrack->position) {
       GstMXFDemuxIndex *index =
           &g_array_index (etrack->offsets, GstMXFDemuxIndex, etrack->position);
@@ -1780,7 +1726,7 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     GST_BUFFER_PTS (outbuf) = pad->position;
     GST_BUFFER_DURATION (outbuf) =
         gst_util_uint64_scale (GST_SECOND,
-        pad->current_essence_track->source_track->edit_rate.d,
+        pad->current_essence_track->source_track->edit_rate.d * n_edit_units,
         pad->current_essence_track->source_track->edit_rate.n);
     GST_BUFFER_OFFSET (outbuf) = GST_BUFFER_OFFSET_NONE;
     GST_BUFFER_OFFSET_END (outbuf) = GST_BUFFER_OFFSET_NONE;
@@ -1788,8 +1734,8 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     /* Update accumulated error and compensate */
     {
       guint64 abs_error =
-          (GST_SECOND * pad->current_essence_track->source_track->edit_rate.d) %
-          pad->current_essence_track->source_track->edit_rate.n;
+          (GST_SECOND * pad->current_essence_track->source_track->edit_rate.d *
+          n_edit_units) % pad->current_essence_track->source_track->edit_rate.n;
       pad->position_accumulated_error +=
           ((gdouble) abs_error) /
           ((gdouble) pad->current_essence_track->source_track->edit_rate.n);
@@ -1842,7 +1788,7 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     if (ret != GST_FLOW_OK)
       goto out;
 
-    pad->current_essence_track_position++;
+    pad->current_essence_track_position += n_edit_units;
 
     if (pad->current_component) {
       if (pad->current_component_duration > 0 &&
@@ -1863,7 +1809,7 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
         ret = GST_FLOW_EOS;
       }
     } else if (etrack->duration > 0
-        && pad->current_essence_track_position == etrack->duration) {
+        && pad->current_essence_track_position >= etrack->duration) {
       GST_DEBUG_OBJECT (demux, "At the end of the essence track");
       ret = GST_FLOW_EOS;
     }
@@ -1890,42 +1836,198 @@ out:
   if (outbuf)
     gst_buffer_unref (outbuf);
 
-  etrack->position++;
+  etrack->position += n_edit_units;
 
   return ret;
 }
 
+static GstMXFDemuxEssenceTrack *
+gst_mxf_demux_get_essence_track_for_key (GstMXFDemux * demux,
+    const MXFUL * key)
+{
+  guint32 track_number;
+  guint i;
+
+  track_number = GST_READ_UINT32_BE (&key->u[12]);
+
+  for (i = 0; i < demux->essence_tracks->len; i++) {
+    GstMXFDemuxEssenceTrack *tmp =
+        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+    if (tmp->body_sid == demux->current_partition->partition.body_sid &&
+        (tmp->track_number == track_number || tmp->track_number == 0))
+      return tmp;
+  }
+
+  return NULL;
+}
+
+static GstFlowReturn
+gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
+    const MXFUL * key, GstBuffer * buffer, gboolean peek)
+{
+  guint i;
+  GstMXFDemuxEssenceTrack *etrack = NULL;
+  gboolean keyframe = TRUE;
+
+  GST_DEBUG_OBJECT (demux,
+      "Handling generic container essence element of size %" G_GSIZE_FORMAT
+      " at offset %" G_GUINT64_FORMAT, gst_buffer_get_size (buffer),
+      demux->offset);
+
+  GST_DEBUG_OBJECT (demux, "  type = 0x%02x", key->u[12]);
+  GST_DEBUG_OBJECT (demux, "  essence element count = 0x%02x", key->u[13]);
+  GST_DEBUG_OBJECT (demux, "  essence element type = 0x%02x", key->u[14]);
+  GST_DEBUG_OBJECT (demux, "  essence element number = 0x%02x", key->u[15]);
+
+  if (demux->current_partition->essence_container_offset == 0)
+    demux->current_partition->essence_container_offset =
+        demux->offset - demux->current_partition->partition.this_partition -
+        demux->run_in;
+
+  if (!demux->current_package) {
+    GST_ERROR_OBJECT (demux, "No package selected yet");
+    return GST_FLOW_ERROR;
+  }
+
+  if (demux->src->len == 0) {
+    GST_ERROR_OBJECT (demux, "No streams created yet");
+    return GST_FLOW_ERROR;
+  }
+
+  if (demux->essence_tracks->len == 0) {
+    GST_ERROR_OBJECT (demux, "No essence streams found in the metadata");
+    return GST_FLOW_ERROR;
+  }
+
+  etrack = gst_mxf_demux_get_essence_track_for_key (demux, key);
+  if (!etrack) {
+    GST_WARNING_OBJECT (demux,
+        "No essence track for this essence element found");
+    return GST_FLOW_OK;
+  }
+
+  if (etrack->position == -1) {
+    GST_DEBUG_OBJECT (demux,
+        "Unknown essence track position, looking into index");
+    if (etrack->offsets) {
+      for (i = 0; i < etrack->offsets->len; i++) {
+        GstMXFDemuxIndex *idx =
+            &g_array_index (etrack->offsets, GstMXFDemuxIndex, i);
+
+        if (idx->offset != 0 && idx->offset == demux->offset - demux->run_in) {
+          etrack->position = i;
+          break;
+        }
+      }
+    }
+
+    /* After seeking the index table segments know which edit unit
+     * this essence element belongs to */
+    if (etrack->position == -1)
+      etrack->position = gst_mxf_demux_get_position_for_offset (demux, etrack,
+          demux->offset - demux->run_in);
+
+    if (etrack->position == -1) {
+      GST_WARNING_OBJECT (demux, "Essence track position not in index");
+      return GST_FLOW_OK;
+    }
+  }
+
+  if (etrack->offsets && etrack->offsets->len > etrack->position) {
+    GstMXFDemuxIndex *index =
+        &g_array_index (etrack->offsets, GstMXFDemuxIndex, etrack->position);
+    if (index->offset != 0)
+      keyframe = index->keyframe;
+  }
+
+  return gst_mxf_demux_handle_essence (demux, key, etrack, buffer, 1,
+      keyframe, peek);
+}
+
+/* Reads the partition pack at @offset (including run-in) and all index
+ * table segments following its header metadata, and remembers where the
+ * essence container of the partition starts */
 static void
 read_partition_header (GstMXFDemux * demux, guint64 offset)
 {
   GstBuffer *buf;
   MXFUL key;
   guint read;
+  guint data_offset;
+  guint64 length;
+  MXFPartitionPack partition;
+  GstMXFDemuxPartition *p = NULL;
+  GstMapInfo map;
+  GList *l;
+  gboolean ret;
+
+  for (l = demux->partitions; l; l = l->next) {
+    GstMXFDemuxPartition *tmp = l->data;
+
+    if (tmp->partition.this_partition + demux->run_in == offset) {
+      p = tmp;
+      break;
+    }
+  }
+
+  if (!p)
+    return;
 
   if (gst_mxf_demux_pull_klv_packet (demux, offset, &key, &buf, &read)
       != GST_FLOW_OK)
     return;
-  offset += read;
 
   if (!mxf_is_partition_pack (&key)) {
     gst_buffer_unref (buf);
     return;
   }
 
-  do {
-    gst_buffer_unref (buf);
-    if (gst_mxf_demux_pull_klv_packet (demux, offset, &key, &buf, &read)
-        != GST_FLOW_OK)
-      return;
-    offset += read;
+  /* Partitions only known from the random index pack have
+   * not been parsed yet */
+  if (p->partition.major_version == 0) {
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    ret = mxf_partition_pack_parse (&key, &partition, map.data, map.size);
+    gst_buffer_unmap (buf, &map);
+
+    if (ret) {
+      partition.this_partition = offset - demux->run_in;
+      partition.prev_partition = p->partition.prev_partition;
+      mxf_partition_pack_reset (&p->partition);
+      memcpy (&p->partition, &partition, sizeof (MXFPartitionPack));
+    }
   }
-  while (mxf_is_fill (&key));
+  gst_buffer_unref (buf);
+  offset += read;
 
-  if (mxf_is_index_table_segment (&key)) {
-    gst_mxf_demux_handle_index_table_segment (demux, &key, buf, offset);
+  /* Skip the header metadata, which starts with the primer pack */
+  if (p->partition.header_byte_count > 0) {
+    while (gst_mxf_demux_peek_klv_packet (demux, offset, &key, &data_offset,
+            &length) == GST_FLOW_OK && mxf_is_fill (&key))
+      offset += data_offset + length;
+    offset += p->partition.header_byte_count;
+  }
+
+  while (gst_mxf_demux_peek_klv_packet (demux, offset, &key, &data_offset,
+          &length) == GST_FLOW_OK) {
+    if (mxf_is_index_table_segment (&key)) {
+      if (gst_mxf_demux_pull_klv_packet (demux, offset, &key, &buf, &read)
+          != GST_FLOW_OK)
+        return;
+      gst_mxf_demux_handle_index_table_segment (demux, &key, buf, offset);
+      gst_buffer_unref (buf);
+    } else if (!mxf_is_fill (&key)) {
+      break;
+    }
+    offset += data_offset + length;
   }
 
-  gst_buffer_unref (buf);
+  if (p->partition.body_sid != 0 && p->essence_container_offset == 0 &&
+      (mxf_is_generic_container_system_item (&key) ||
+          mxf_is_generic_container_essence_element (&key) ||
+          mxf_is_avid_essence_container_essence_element (&key)))
+    p->essence_container_offset =
+        offset - demux->run_in - p->partition.this_partition;
 }
 
 static GstFlowReturn
@@ -2009,9 +2111,17 @@ compare_index_table_segments (gconstpointer comparee, gconstpointer compared)
   comparee_segment = (MXFIndexTableSegment *) comparee;
   compared_segment = (MXFIndexTableSegment *) compared;
 
-  /* FIXME : is that the correct comparison ? */
-  return comparee_segment->index_start_position -
-      compared_segment->index_start_position;
+  if (comparee_segment->body_sid != compared_segment->body_sid ||
+      comparee_segment->index_sid != compared_segment->index_sid)
+    return 1;
+
+  if (comparee_segment->index_start_position <
+      compared_segment->index_start_position)
+    return -1;
+  else if (comparee_segment->index_start_position >
+      compared_segment->index_start_position)
+    return 1;
+  return 0;
 }
 
 static GstFlowReturn
@@ -2051,6 +2161,7 @@ gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
   if (l == NULL) {
     demux->pending_index_table_segments =
         g_list_prepend (demux->pending_index_table_segments, segment);
+    demux->index_tables_dirty = TRUE;
   } else {
     mxf_index_table_segment_reset (segment);
     g_free (segment);
@@ -2059,14 +2170,14 @@ gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
   return GST_FLOW_OK;
 }
 
+/* Reads the key and the BER encoded length of the KLV packet at @offset
+ * without pulling its value */
 static GstFlowReturn
-gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
-    GstBuffer ** outbuf, guint * read)
+gst_mxf_demux_peek_klv_packet (GstMXFDemux * demux, guint64 offset,
+    MXFUL * key, guint * data_offset, guint64 * length)
 {
   GstBuffer *buffer = NULL;
   const guint8 *data;
-  guint64 data_offset = 0;
-  guint64 length;
   GstFlowReturn ret = GST_FLOW_OK;
   GstMapInfo map;
 #ifndef GST_DISABLE_GST_DEBUG
@@ -2089,12 +2200,12 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
 
   /* Decode BER encoded packet length */
   if ((map.data[16] & 0x80) == 0) {
-    length = map.data[16];
-    data_offset = 17;
+    *length = map.data[16];
+    *data_offset = 17;
   } else {
     guint slen = map.data[16] & 0x7f;
 
-    data_offset = 16 + 1 + slen;
+    *data_offset = 16 + 1 + slen;
 
     gst_buffer_unmap (buffer, &map);
     gst_buffer_unref (buffer);
@@ -2115,9 +2226,9 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
     gst_buffer_map (buffer, &map, GST_MAP_READ);
 
     data = map.data;
-    length = 0;
+    *length = 0;
     while (slen) {
-      length = (length << 8) | *data;
+      *length = (*length << 8) | *data;
       data++;
       slen--;
     }
@@ -2127,32 +2238,46 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
   gst_buffer_unref (buffer);
   buffer = NULL;
 
+  GST_DEBUG_OBJECT (demux, "KLV packet with key %s has length "
+      "%" G_GUINT64_FORMAT, mxf_ul_to_string (key, str), *length);
+
+beach:
+  if (buffer)
+    gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
+    GstBuffer ** outbuf, guint * read)
+{
+  GstBuffer *buffer = NULL;
+  guint data_offset = 0;
+  guint64 length;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if ((ret = gst_mxf_demux_peek_klv_packet (demux, offset, key, &data_offset,
+              &length)) != GST_FLOW_OK)
+    return ret;
+
   /* GStreamer's buffer sizes are stored in a guint so we
    * limit ourself to G_MAXUINT large buffers */
   if (length > G_MAXUINT) {
     GST_ERROR_OBJECT (demux,
         "Unsupported KLV packet length: %" G_GUINT64_FORMAT, length);
-    ret = GST_FLOW_ERROR;
-    goto beach;
+    return GST_FLOW_ERROR;
   }
 
-  GST_DEBUG_OBJECT (demux, "KLV packet with key %s has length "
-      "%" G_GUINT64_FORMAT, mxf_ul_to_string (key, str), length);
-
   /* Pull the complete KLV packet */
   if ((ret = gst_mxf_demux_pull_range (demux, offset + data_offset, length,
               &buffer)) != GST_FLOW_OK)
-    goto beach;
+    return ret;
 
   *outbuf = buffer;
-  buffer = NULL;
   if (read)
     *read = data_offset + length;
 
-beach:
-  if (buffer)
-    gst_buffer_unref (buffer);
-
   return ret;
 }
 
@@ -2523,35 +2648,731 @@ gst_mxf_demux_set_partition_for_offset (GstMXFDemux * demux, guint64 offset)
   }
 }
 
-static guint64
-get_offset_from_index_table_segments (GstMXFDemux * demux, gint64 position,
-    gint64 * index_start_position)
+static void
+collect_index_table_segments (GstMXFDemux * demux)
 {
+  guint i;
   GList *l;
-  gint64 start, end;
-  gboolean return_offset = FALSE;
 
-  for (l = demux->pending_index_table_segments; l != NULL; l = l->next) {
-    MXFIndexTableSegment *segment = (MXFIndexTableSegment *) l->data;
-    start = segment->index_start_position;
-    end = start + segment->index_duration;
-
-    if (return_offset)
-      return segment->stream_offset;
+  if (!demux->random_index_pack) {
+    /* Only the partitions we went through so far */
+    for (l = demux->partitions; l; l = l->next) {
+      GstMXFDemuxPartition *p = l->data;
 
-    if (start <= position && position < end) {
-      *index_start_position = segment->index_start_position;
-      return_offset = TRUE;
+      read_partition_header (demux,
+          p->partition.this_partition + demux->run_in);
     }
+    return;
   }
 
-  return 0;
-}
+  for (i = 0; i < demux->random_index_pack->len; i++) {
+    MXFRandomIndexPackEntry *e =
+        &g_array_index (demux->random_index_pack, MXFRandomIndexPackEntry, i);
 
-static guint64
-gst_mxf_demux_find_essence_element (GstMXFDemux * demux,
-    GstMXFDemuxEssenceTrack * etrack, gint64 * position, gboolean keyframe)
-{
+    if (e->offset < demux->run_in) {
+      GST_ERROR_OBJECT (demux, "Invalid random index pack entry");
+      return;
+    }
+
+    read_partition_header (demux, e->offset);
+  }
+}
+
+static gint
+gst_mxf_demux_index_table_segment_compare (gconstpointer a, gconstpointer b)
+{
+  const GstMXFDemuxIndexTableSegment *sa = a, *sb = b;
+
+  if (sa->segment->index_start_position < sb->segment->index_start_position)
+    return -1;
+  else if (sa->segment->index_start_position >
+      sb->segment->index_start_position)
+    return 1;
+  return 0;
+}
+
+/* Merges the index table segments per body SID, sorted by position, so
+ * that lookups are a binary search instead of a walk over all segments */
+static void
+gst_mxf_demux_update_index_tables (GstMXFDemux * demux)
+{
+  GList *l;
+  guint i, j, k;
+
+  if (demux->index_tables && !demux->index_tables_dirty)
+    return;
+
+  if (!demux->index_tables) {
+    demux->index_tables =
+        g_array_new (FALSE, FALSE, sizeof (GstMXFDemuxIndexTable));
+  } else {
+    for (i = 0; i < demux->index_tables->len; i++) {
+      GstMXFDemuxIndexTable *t =
+          &g_array_index (demux->index_tables, GstMXFDemuxIndexTable, i);
+      g_array_free (t->segments, TRUE);
+    }
+    g_array_set_size (demux->index_tables, 0);
+  }
+
+  for (l = demux->pending_index_table_segments; l; l = l->next) {
+    MXFIndexTableSegment *segment = l->data;
+    GstMXFDemuxIndexTable *table = NULL;
+    GstMXFDemuxIndexTableSegment s;
+
+    if (segment->body_sid == 0)
+      continue;
+
+    for (i = 0; i < demux->index_tables->len; i++) {
+      GstMXFDemuxIndexTable *t =
+          &g_array_index (demux->index_tables, GstMXFDemuxIndexTable, i);
+
+      if (t->body_sid == segment->body_sid) {
+        table = t;
+        break;
+      }
+    }
+
+    if (!table) {
+      GstMXFDemuxIndexTable t;
+
+      memset (&t, 0, sizeof (t));
+      t.body_sid = segment->body_sid;
+      t.index_sid = segment->index_sid;
+      t.segments =
+          g_array_new (FALSE, FALSE, sizeof (GstMXFDemuxIndexTableSegment));
+      g_array_append_val (demux->index_tables, t);
+      table =
+          &g_array_index (demux->index_tables, GstMXFDemuxIndexTable,
+          demux->index_tables->len - 1);
+    } else if (table->index_sid != segment->index_sid) {
+      GST_DEBUG_OBJECT (demux, "Ignoring index table segment of index SID %u "
+          "for body SID %u", segment->index_sid, segment->body_sid);
+      continue;
+    }
+
+    s.segment = segment;
+    s.cbr_offset = 0;
+    g_array_append_val (table->segments, s);
+  }
+
+  for (i = 0; i < demux->index_tables->len; i++) {
+    GstMXFDemuxIndexTable *t =
+        &g_array_index (demux->index_tables, GstMXFDemuxIndexTable, i);
+    guint64 cbr_offset = 0;
+
+    g_array_sort (t->segments, gst_mxf_demux_index_table_segment_compare);
+
+    for (j = 0; j < t->segments->len; j++) {
+      GstMXFDemuxIndexTableSegment *s =
+          &g_array_index (t->segments, GstMXFDemuxIndexTableSegment, j);
+
+      s->cbr_offset = cbr_offset;
+      if (s->segment->edit_unit_byte_count)
+        cbr_offset +=
+            s->segment->edit_unit_byte_count * s->segment->index_duration;
+
+      for (k = 0; k < s->segment->n_index_entries &&
+          !t->has_random_access_flags; k++) {
+        if ((s->segment->index_entries[k].flags & 0x80))
+          t->has_random_access_flags = TRUE;
+      }
+    }
+
+    GST_DEBUG_OBJECT (demux, "Index table for body SID %u has %u segments",
+        t->body_sid, t->segments->len);
+  }
+
+  demux->index_tables_dirty = FALSE;
+}
+
+/* Returns the index table of the essence container of @etrack if it is
+ * usable for the track */
+static GstMXFDemuxIndexTable *
+gst_mxf_demux_get_index_table (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack)
+{
+  guint i;
+
+  if (demux->random_access && !demux->index_table_segments_collected) {
+    collect_index_table_segments (demux);
+    demux->index_table_segments_collected = TRUE;
+  }
+
+  gst_mxf_demux_update_index_tables (demux);
+
+  for (i = 0; i < demux->index_tables->len; i++) {
+    GstMXFDemuxIndexTable *t =
+        &g_array_index (demux->index_tables, GstMXFDemuxIndexTable, i);
+    MXFFraction *rate;
+
+    if (t->body_sid != etrack->body_sid || t->segments->len == 0)
+      continue;
+
+    /* Positions are only comparable if the index has the edit rate
+     * of the track */
+    rate =
+        &g_array_index (t->segments, GstMXFDemuxIndexTableSegment,
+        0).segment->index_edit_rate;
+    if (etrack->source_track && rate->n != 0 &&
+        (guint64) rate->n * etrack->source_track->edit_rate.d !=
+        (guint64) rate->d * etrack->source_track->edit_rate.n) {
+      GST_DEBUG_OBJECT (demux, "Index edit rate %d/%d differs from track "
+          "edit rate %d/%d", rate->n, rate->d,
+          etrack->source_track->edit_rate.n, etrack->source_track->edit_rate.d);
+      return NULL;
+    }
+
+    return t;
+  }
+
+  return NULL;
+}
+
+static GstMXFDemuxIndexTableSegment *
+gst_mxf_demux_index_table_find_segment (GstMXFDemuxIndexTable * table,
+    gint64 position)
+{
+  guint lo = 0, hi = table->segments->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    GstMXFDemuxIndexTableSegment *s =
+        &g_array_index (table->segments, GstMXFDemuxIndexTableSegment, mid);
+
+    if (position < s->segment->index_start_position)
+      hi = mid;
+    else if (s->segment->index_duration > 0 &&
+        position >= s->segment->index_start_position +
+        s->segment->index_duration)
+      lo = mid + 1;
+    else
+      return s;
+  }
+
+  return NULL;
+}
+
+/* Returns the offset of edit unit @position in the essence container
+ * stream, or -1 if the index does not contain it */
+static guint64
+gst_mxf_demux_index_table_get_offset (GstMXFDemuxIndexTable * table,
+    gint64 position, gboolean * keyframe)
+{
+  GstMXFDemuxIndexTableSegment *s;
+  MXFIndexEntry *entry;
+  gint64 i;
+
+  s = gst_mxf_demux_index_table_find_segment (table, position);
+  if (!s)
+    return -1;
+
+  i = position - s->segment->index_start_position;
+
+  if (s->segment->edit_unit_byte_count) {
+    if (keyframe)
+      *keyframe = TRUE;
+    return s->cbr_offset + i * s->segment->edit_unit_byte_count;
+  }
+
+  if (i >= s->segment->n_index_entries)
+    return -1;
+
+  entry = &s->segment->index_entries[i];
+  if (keyframe)
+    *keyframe = !table->has_random_access_flags || (entry->flags & 0x80);
+
+  return entry->stream_offset;
+}
+
+/* Returns the last keyframe at or before @position, or -1 */
+static gint64
+gst_mxf_demux_index_table_find_keyframe (GstMXFDemuxIndexTable * table,
+    gint64 position)
+{
+  GstMXFDemuxIndexTableSegment *s;
+  gboolean keyframe = FALSE;
+  gint8 key_frame_offset;
+
+  if (gst_mxf_demux_index_table_get_offset (table, position,
+          &keyframe) == -1)
+    return -1;
+  if (keyframe)
+    return position;
+
+  /* Usually the entry points directly at its keyframe */
+  s = gst_mxf_demux_index_table_find_segment (table, position);
+  key_frame_offset =
+      s->segment->index_entries[position -
+      s->segment->index_start_position].key_frame_offset;
+  if (key_frame_offset < 0 && position + key_frame_offset >= 0 &&
+      gst_mxf_demux_index_table_get_offset (table,
+          position + key_frame_offset, &keyframe) != -1 && keyframe)
+    return position + key_frame_offset;
+
+  while (--position >= 0) {
+    if (gst_mxf_demux_index_table_get_offset (table, position,
+            &keyframe) == -1)
+      return -1;
+    if (keyframe)
+      return position;
+  }
+
+  return -1;
+}
+
+/* Returns the edit unit containing @stream_offset, or -1 */
+static gint64
+gst_mxf_demux_index_table_find_position (GstMXFDemuxIndexTable * table,
+    guint64 stream_offset)
+{
+  GstMXFDemuxIndexTableSegment *s = NULL;
+  guint lo = 0, hi = table->segments->len;
+  gint64 i;
+
+  /* Last segment starting at or before the offset */
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    GstMXFDemuxIndexTableSegment *tmp =
+        &g_array_index (table->segments, GstMXFDemuxIndexTableSegment, mid);
+    guint64 first;
+
+    if (tmp->segment->edit_unit_byte_count)
+      first = tmp->cbr_offset;
+    else if (tmp->segment->n_index_entries > 0)
+      first = tmp->segment->index_entries[0].stream_offset;
+    else
+      first = G_MAXUINT64;
+
+    if (first <= stream_offset) {
+      s = tmp;
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  if (!s)
+    return -1;
+
+  if (s->segment->edit_unit_byte_count) {
+    i = (stream_offset - s->cbr_offset) / s->segment->edit_unit_byte_count;
+    if (s->segment->index_duration > 0 && i >= s->segment->index_duration)
+      return -1;
+    return s->segment->index_start_position + i;
+  }
+
+  /* Last entry starting at or before the offset */
+  lo = 0;
+  hi = s->segment->n_index_entries;
+  while (hi - lo > 1) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (s->segment->index_entries[mid].stream_offset <= stream_offset)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return s->segment->index_start_position + lo;
+}
+
+/* Converts an offset in the essence container @body_sid to a file
+ * offset without run-in, or -1 if the partition is unknown */
+static guint64
+gst_mxf_demux_get_file_offset (GstMXFDemux * demux, guint32 body_sid,
+    guint64 stream_offset)
+{
+  GstMXFDemuxPartition *p = NULL;
+  GList *l;
+
+  for (l = demux->partitions; l; l = l->next) {
+    GstMXFDemuxPartition *tmp = l->data;
+
+    if (tmp->partition.body_sid == body_sid &&
+        tmp->partition.body_offset <= stream_offset)
+      p = tmp;
+  }
+
+  if (!p)
+    return -1;
+
+  if (p->essence_container_offset == 0)
+    read_partition_header (demux, p->partition.this_partition + demux->run_in);
+  if (p->essence_container_offset == 0)
+    return -1;
+
+  return p->partition.this_partition + p->essence_container_offset +
+      stream_offset - p->partition.body_offset;
+}
+
+/* Returns the edit unit of @etrack at file offset @offset (without run-in)
+ * according to the index table segments, or -1 */
+static gint64
+gst_mxf_demux_get_position_for_offset (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, guint64 offset)
+{
+  GstMXFDemuxPartition *p = demux->current_partition;
+  GstMXFDemuxIndexTable *table;
+  guint64 essence_offset;
+
+  if (!p || p->partition.body_sid != etrack->body_sid ||
+      p->essence_container_offset == 0)
+    return -1;
+
+  essence_offset = p->partition.this_partition + p->essence_container_offset;
+  if (offset < essence_offset)
+    return -1;
+
+  table = gst_mxf_demux_get_index_table (demux, etrack);
+  if (!table)
+    return -1;
+
+  return gst_mxf_demux_index_table_find_position (table,
+      p->partition.body_offset + offset - essence_offset);
+}
+
+/* Looks for the essence element of a clip wrapped track by skipping over
+ * the KLV packets of its essence container */
+static gboolean
+gst_mxf_demux_locate_clip (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack)
+{
+  GList *l;
+
+  if (etrack->clip_length > 0)
+    return TRUE;
+
+  for (l = demux->partitions; l; l = l->next) {
+    GstMXFDemuxPartition *p = l->data;
+    guint64 offset, end = G_MAXUINT64;
+
+    if (p->partition.body_sid != etrack->body_sid)
+      continue;
+
+    if (p->essence_container_offset == 0)
+      read_partition_header (demux,
+          p->partition.this_partition + demux->run_in);
+    if (p->essence_container_offset == 0)
+      continue;
+
+    offset =
+        p->partition.this_partition + p->essence_container_offset +
+        demux->run_in;
+    if (l->next)
+      end = ((GstMXFDemuxPartition *) l->next->data)->partition.this_partition +
+          demux->run_in;
+
+    while (offset < end) {
+      MXFUL key;
+      guint data_offset;
+      guint64 length;
+
+      if (gst_mxf_demux_peek_klv_packet (demux, offset, &key, &data_offset,
+              &length) != GST_FLOW_OK || mxf_is_partition_pack (&key))
+        break;
+
+      if ((mxf_is_generic_container_essence_element (&key) ||
+              mxf_is_avid_essence_container_essence_element (&key)) &&
+          (etrack->track_number == 0 ||
+              GST_READ_UINT32_BE (&key.u[12]) == etrack->track_number)) {
+        etrack->clip_offset = offset + data_offset - demux->run_in;
+        etrack->clip_length = length;
+        memcpy (&etrack->clip_key, &key, sizeof (MXFUL));
+        return TRUE;
+      }
+
+      offset += data_offset + length;
+    }
+  }
+
+  return FALSE;
+}
+
+/* Whether @compression is unset or one of the PCM codings, which are all
+ * below the uncompressed sound coding node of SMPTE RP224 */
+static gboolean
+gst_mxf_demux_is_uncompressed_sound (const MXFUL * compression)
+{
+  static const guint8 uncompressed_sound_coding[] = {
+    0x04, 0x02, 0x02, 0x01
+  };
+
+  if (mxf_ul_is_zero (compression))
+    return TRUE;
+
+  return mxf_is_mxf_packet (compression) &&
+      memcmp (&compression->u[8], uncompressed_sound_coding, 4) == 0;
+}
+
+/* Makes sure the edit units of a clip wrapped track can be found, either
+ * because they have a constant size or from the index table segments */
+static gboolean
+gst_mxf_demux_update_clip_edit_unit_size (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack)
+{
+  GstMXFDemuxIndexTable *table;
+  MXFMetadataGenericSoundEssenceDescriptor *d;
+  MXFFraction *edit_rate;
+  guint64 n, m;
+
+  if (etrack->edit_unit_byte_count)
+    return TRUE;
+
+  table = gst_mxf_demux_get_index_table (demux, etrack);
+  if (table) {
+    etrack->edit_unit_byte_count =
+        g_array_index (table->segments, GstMXFDemuxIndexTableSegment,
+        0).segment->edit_unit_byte_count;
+    return TRUE;
+  }
+
+  /* Without index uncompressed audio still has a constant edit unit size */
+  if (!etrack->source_track || etrack->source_track->parent.n_descriptor == 0
+      || !MXF_IS_METADATA_GENERIC_SOUND_ESSENCE_DESCRIPTOR (etrack->
+          source_track->parent.descriptor[0]))
+    return FALSE;
+
+  d = MXF_METADATA_GENERIC_SOUND_ESSENCE_DESCRIPTOR (etrack->source_track->
+      parent.descriptor[0]);
+  edit_rate = &etrack->source_track->edit_rate;
+  if (!gst_mxf_demux_is_uncompressed_sound (&d->sound_essence_compression) ||
+      d->channel_count == 0 || d->quantization_bits == 0 ||
+      d->audio_sampling_rate.d == 0 || edit_rate->n == 0)
+    return FALSE;
+
+  n = (guint64) d->audio_sampling_rate.n * edit_rate->d;
+  m = (guint64) d->audio_sampling_rate.d * edit_rate->n;
+  if (n % m != 0)
+    return FALSE;
+
+  etrack->edit_unit_byte_count =
+      (n / m) * d->channel_count * ((d->quantization_bits + 7) / 8);
+
+  return TRUE;
+}
+
+/* Returns the offset (without run-in) of edit unit @position of @etrack
+ * from the index table segments or the constant edit unit size */
+static guint64
+gst_mxf_demux_find_essence_element_indexed (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, gint64 * position, gboolean keyframe)
+{
+  GstMXFDemuxIndexTable *table;
+  gint64 new_position = *position;
+  guint64 stream_offset, offset;
+
+  if (!demux->random_access)
+    return -1;
+
+  if (etrack->wrapping == MXF_ESSENCE_WRAPPING_CLIP_WRAPPING) {
+    if (!gst_mxf_demux_locate_clip (demux, etrack) ||
+        !gst_mxf_demux_update_clip_edit_unit_size (demux, etrack))
+      return -1;
+
+    if (etrack->edit_unit_byte_count) {
+      offset = new_position * etrack->edit_unit_byte_count;
+      if (offset >= etrack->clip_length)
+        return -1;
+      return etrack->clip_offset + offset;
+    }
+  }
+
+  table = gst_mxf_demux_get_index_table (demux, etrack);
+  if (!table)
+    return -1;
+
+  if (keyframe)
+    new_position = gst_mxf_demux_index_table_find_keyframe (table,
+        new_position);
+  if (new_position == -1)
+    return -1;
+
+  stream_offset =
+      gst_mxf_demux_index_table_get_offset (table, new_position, NULL);
+  if (stream_offset == -1)
+    return -1;
+
+  if (etrack->wrapping == MXF_ESSENCE_WRAPPING_CLIP_WRAPPING) {
+    guint64 clip_start = gst_mxf_demux_index_table_get_offset (table, 0, NULL);
+
+    /* Index entries count from the start of the essence element */
+    if (clip_start == -1)
+      clip_start = 0;
+    if (stream_offset < clip_start ||
+        stream_offset - clip_start >= etrack->clip_length)
+      return -1;
+    offset = etrack->clip_offset + stream_offset - clip_start;
+  } else {
+    offset =
+        gst_mxf_demux_get_file_offset (demux, etrack->body_sid, stream_offset);
+    if (offset == -1)
+      return -1;
+  }
+
+  GST_DEBUG_OBJECT (demux, "Found edit unit %" G_GINT64_FORMAT " at offset %"
+      G_GUINT64_FORMAT " in index table", new_position, offset);
+
+  *position = new_position;
+  return offset;
+}
+
+/* Pushes the edit units of the clip wrapped essence element that starts at
+ * the current offset. Audio is output in chunks of about 40ms instead of
+ * single samples */
+static GstFlowReturn
+gst_mxf_demux_handle_clip_wrapped_essence (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack)
+{
+  GstFlowReturn ret;
+  GstBuffer *buffer = NULL;
+  guint64 clip_pos = demux->offset - demux->run_in - etrack->clip_offset;
+  guint64 size;
+  gint64 position;
+  guint n_edit_units = 1;
+  gboolean keyframe = TRUE;
+
+  if (!etrack->source_track ||
+      !gst_mxf_demux_update_clip_edit_unit_size (demux, etrack)) {
+    GST_ELEMENT_ERROR (demux, STREAM, DEMUX, (NULL),
+        ("Can't find the edit units of clip wrapped essence"));
+    return GST_FLOW_ERROR;
+  }
+
+  if (etrack->edit_unit_byte_count) {
+    MXFFraction *edit_rate = &etrack->source_track->edit_rate;
+
+    position = clip_pos / etrack->edit_unit_byte_count;
+    if (edit_rate->d > 0)
+      n_edit_units =
+          MAX (1, gst_util_uint64_scale (edit_rate->n, 40,
+              (guint64) edit_rate->d * 1000));
+    size =
+        MIN ((guint64) n_edit_units * etrack->edit_unit_byte_count,
+        etrack->clip_length - clip_pos);
+    n_edit_units = MAX (1, size / etrack->edit_unit_byte_count);
+  } else {
+    GstMXFDemuxIndexTable *table = gst_mxf_demux_get_index_table (demux,
+        etrack);
+    guint64 clip_start, next;
+
+    clip_start = gst_mxf_demux_index_table_get_offset (table, 0, NULL);
+    if (clip_start == -1)
+      clip_start = 0;
+
+    position =
+        gst_mxf_demux_index_table_find_position (table, clip_start + clip_pos);
+    if (position == -1 ||
+        gst_mxf_demux_index_table_get_offset (table, position,
+            &keyframe) == -1) {
+      GST_ERROR_OBJECT (demux, "Offset %" G_GUINT64_FORMAT " of clip wrapped "
+          "essence not in index", clip_pos);
+      return GST_FLOW_ERROR;
+    }
+
+    next = gst_mxf_demux_index_table_get_offset (table, position + 1, NULL);
+    if (next == -1 || next - clip_start > etrack->clip_length)
+      size = etrack->clip_length - clip_pos;
+    else
+      size = next - clip_start - clip_pos;
+  }
+
+  if (size == 0 || size > G_MAXUINT) {
+    GST_ERROR_OBJECT (demux, "Invalid edit unit size %" G_GUINT64_FORMAT,
+        size);
+    return GST_FLOW_ERROR;
+  }
+
+  if ((ret = gst_mxf_demux_pull_range (demux, demux->offset, size,
+              &buffer)) != GST_FLOW_OK)
+    return ret;
+
+  GST_DEBUG_OBJECT (demux, "Handling %u edit units of clip wrapped essence "
+      "at position %" G_GINT64_FORMAT, n_edit_units, position);
+
+  etrack->position = position;
+  ret =
+      gst_mxf_demux_handle_essence (demux, &etrack->clip_key, etrack, buffer,
+      n_edit_units, keyframe, FALSE);
+  gst_buffer_unref (buffer);
+
+  demux->offset += size;
+
+  return ret;
+}
+
+/* Checks if the essence element at the current offset belongs to a clip
+ * wrapped track and if so remembers its location and skips its key */
+static GstFlowReturn
+gst_mxf_demux_start_clip (GstMXFDemux * demux, const MXFUL * key,
+    guint data_offset, guint64 length, GstMXFDemuxEssenceTrack ** clip)
+{
+  GstMXFDemuxEssenceTrack *etrack;
+  GstFlowReturn ret;
+
+  *clip = NULL;
+
+  if (!demux->current_partition)
+    return GST_FLOW_OK;
+
+  /* Tracks are only set up once the first essence is found */
+  if (demux->update_metadata && demux->preface) {
+    demux->current_partition->parsed_metadata = TRUE;
+    if ((ret = gst_mxf_demux_resolve_references (demux)) != GST_FLOW_OK ||
+        (ret = gst_mxf_demux_update_tracks (demux)) != GST_FLOW_OK)
+      return ret;
+  }
+
+  if (!demux->current_package || demux->src->len == 0)
+    return GST_FLOW_OK;
+
+  etrack = gst_mxf_demux_get_essence_track_for_key (demux, key);
+  if (!etrack || etrack->wrapping != MXF_ESSENCE_WRAPPING_CLIP_WRAPPING ||
+      length == 0)
+    return GST_FLOW_OK;
+
+  if (demux->current_partition->essence_container_offset == 0)
+    demux->current_partition->essence_container_offset =
+        demux->offset - demux->current_partition->partition.this_partition -
+        demux->run_in;
+
+  GST_DEBUG_OBJECT (demux, "Clip wrapped essence element of track %u with "
+      "length %" G_GUINT64_FORMAT " at offset %" G_GUINT64_FORMAT,
+      etrack->track_number, length, demux->offset);
+
+  memcpy (&etrack->clip_key, key, sizeof (MXFUL));
+  etrack->clip_offset = demux->offset + data_offset - demux->run_in;
+  etrack->clip_length = length;
+  demux->offset += data_offset;
+  *clip = etrack;
+
+  return GST_FLOW_OK;
+}
+
+/* Returns the clip wrapped essence track whose essence element contains
+ * the current offset */
+static GstMXFDemuxEssenceTrack *
+gst_mxf_demux_get_current_clip (GstMXFDemux * demux)
+{
+  guint64 offset = demux->offset - demux->run_in;
+  guint i;
+
+  for (i = 0; i < demux->essence_tracks->len; i++) {
+    GstMXFDemuxEssenceTrack *t =
+        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+    if (t->wrapping == MXF_ESSENCE_WRAPPING_CLIP_WRAPPING &&
+        t->clip_length > 0 && t->clip_offset <= offset &&
+        offset < t->clip_offset + t->clip_length)
+      return t;
+  }
+
+  return NULL;
+}
+
+static guint64
+gst_mxf_demux_find_essence_element (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, gint64 * position, gboolean keyframe)
+{
   GstFlowReturn ret = GST_FLOW_OK;
   guint64 old_offset = demux->offset;
   GstMXFDemuxPartition *old_partition = demux->current_partition;
@@ -2626,9 +3447,29 @@ from_index:
       return new_offset;
     }
   } else if (demux->random_access) {
-    gint64 index_start_position = -1;
     guint64 offset;
 
+    /* The index table segments give us the offset directly */
+    offset =
+        gst_mxf_demux_find_essence_element_indexed (demux, etrack, position,
+        keyframe);
+    if (offset != -1) {
+      /* Other tracks in this essence container find their position
+       * from the index again */
+      for (i = 0; i < demux->essence_tracks->len; i++) {
+        GstMXFDemuxEssenceTrack *t =
+            &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+        if (t != etrack && t->body_sid == etrack->body_sid &&
+            t->wrapping != MXF_ESSENCE_WRAPPING_CLIP_WRAPPING)
+          t->position = -1;
+      }
+      return offset;
+    } else if (etrack->wrapping == MXF_ESSENCE_WRAPPING_CLIP_WRAPPING) {
+      GST_DEBUG_OBJECT (demux, "Edit unit not found in clip wrapped essence");
+      return -1;
+    }
+
     demux->offset = demux->run_in;
     if (etrack->offsets && etrack->offsets->len) {
       for (i = etrack->offsets->len - 1; i >= 0; i--) {
@@ -2642,22 +3483,13 @@ from_index:
       }
     }
 
-    offset =
-        get_offset_from_index_table_segments (demux, *position,
-        &index_start_position);
-
-    demux->offset = offset;
-
     gst_mxf_demux_set_partition_for_offset (demux, demux->offset);
 
     for (i = 0; i < demux->essence_tracks->len; i++) {
       GstMXFDemuxEssenceTrack *t =
           &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
 
-      if (index_start_position != -1)
-        t->position = index_start_position;
-      else
-        t->position = (demux->offset == demux->run_in) ? 0 : -1;
+      t->position = (demux->offset == demux->run_in) ? 0 : -1;
     }
 
     /* Else peek at all essence elements and complete our
@@ -2739,6 +3571,7 @@ gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
   MXFUL key;
   GstFlowReturn ret = GST_FLOW_OK;
   guint read = 0;
+  GstMXFDemuxEssenceTrack *clip = NULL;
 
   if (demux->src->len > 0) {
     if (!gst_mxf_demux_get_earliest_pad (demux)) {
@@ -2748,9 +3581,25 @@ gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
     }
   }
 
-  ret =
-      gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
-      &read);
+  /* Clip wrapped essence elements are never pulled completely but
+   * edit unit by edit unit */
+  clip = gst_mxf_demux_get_current_clip (demux);
+  if (!clip) {
+    guint data_offset;
+    guint64 length;
+
+    ret =
+        gst_mxf_demux_peek_klv_packet (demux, demux->offset, &key,
+        &data_offset, &length);
+    if (ret == GST_FLOW_OK && (mxf_is_generic_container_essence_element (&key)
+            || mxf_is_avid_essence_container_essence_element (&key)))
+      ret = gst_mxf_demux_start_clip (demux, &key, data_offset, length, &clip);
+
+    if (ret == GST_FLOW_OK && !clip)
+      ret =
+          gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
+          &read);
+  }
 
   if (ret == GST_FLOW_EOS && demux->src->len > 0) {
     guint i;
@@ -2812,8 +3661,12 @@ gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
   if (G_UNLIKELY (ret != GST_FLOW_OK))
     goto beach;
 
-  ret = gst_mxf_demux_handle_klv_packet (demux, &key, buffer, FALSE);
-  demux->offset += read;
+  if (clip) {
+    ret = gst_mxf_demux_handle_clip_wrapped_essence (demux, clip);
+  } else {
+    ret = gst_mxf_demux_handle_klv_packet (demux, &key, buffer, FALSE);
+    demux->offset += read;
+  }
 
   if (ret == GST_FLOW_OK && demux->src->len > 0
       && demux->essence_tracks->len > 0) {
@@ -3397,40 +4250,6 @@ no_new_offset:
   }
 }
 
-static void
-collect_index_table_segments (GstMXFDemux * demux)
-{
-  guint i;
-  GList *l;
-
-  if (!demux->random_index_pack)
-    return;
-
-  for (i = 0; i < demux->random_index_pack->len; i++) {
-    GstMXFDemuxPartition *p = NULL;
-    MXFRandomIndexPackEntry *e =
-        &g_array_index (demux->random_index_pack, MXFRandomIndexPackEntry, i);
-
-    if (e->offset < demux->run_in) {
-      GST_ERROR_OBJECT (demux, "Invalid random index pack entry");
-      return;
-    }
-
-    for (l = demux->partitions; l; l = l->next) {
-      GstMXFDemuxPartition *tmp = l->data;
-
-      if (tmp->partition.this_partition + demux->run_in == e->offset) {
-        p = tmp;
-        break;
-      }
-    }
-
-    if (p) {
-      read_partition_header (demux, p->partition.this_partition);
-    }
-  }
-}
-
 static gboolean
 gst_mxf_demux_seek_pull (GstMXFDemux * demux, GstEvent * event)
 {
@@ -62,6 +62,28 @@ typedef struct
   gboolean keyframe;
 } GstMXFDemuxIndex;
 
+typedef struct
+{
+  MXFIndexTableSegment *segment;
+
+  /* Stream offset of the first edit unit if the segment
+   * has a constant edit unit byte count */
+  guint64 cbr_offset;
+} GstMXFDemuxIndexTableSegment;
+
+typedef struct
+{
+  guint32 body_sid;
+  guint32 index_sid;
+
+  /* GstMXFDemuxIndexTableSegment, sorted by start position */
+  GArray *segments;
+
+  /* If no entry is flagged as random access point all
+   * edit units are considered keyframes */
+  gboolean has_random_access_flags;
+} GstMXFDemuxIndexTable;
+
 typedef struct
 {
   guint32 body_sid;
@@ -75,6 +97,16 @@ typedef struct
 
   GArray *offsets;
 
+  MXFEssenceWrapping wrapping;
+
+  /* Clip wrapped essence: key, offset (without run-in) and length
+   * of the essence element's value, 0 if not located yet */
+  MXFUL clip_key;
+  guint64 clip_offset;
+  guint64 clip_length;
+  /* Size of one edit unit, 0 if variable or unknown */
+  guint32 edit_unit_byte_count;
+
   MXFMetadataSourcePackage *source_package;
   MXFMetadataTimelineTrack *source_track;
 
@@ -157,6 +189,12 @@ struct _GstMXFDemux
 
   gboolean index_table_segments_collected;
 
+  /* GstMXFDemuxIndexTable per body SID, merged from the
+   * pending index table segments and rebuilt when new
+   * segments were found */
+  GArray *index_tables;
+  gboolean index_tables_dirty;
+
   GArray *random_index_pack;
 
   /* Metadata */
@@ -52,9 +52,19 @@ static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE ("src",
     GST_STATIC_CAPS ("application/mxf")
     );
 
+#define DEFAULT_PARTITION_DURATION 0
+#define DEFAULT_PARTITION_SIZE 0
+#define DEFAULT_REPEAT_HEADER_METADATA FALSE
+
+/* Index entries are 11 bytes and local tags have 16 bit lengths */
+#define MAX_INDEX_ENTRIES_PER_SEGMENT 4096
+
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_PARTITION_DURATION,
+  PROP_PARTITION_SIZE,
+  PROP_REPEAT_HEADER_METADATA
 };
 
 #define gst_mxf_mux_parent_class parent_class
@@ -110,6 +120,49 @@ gst_mxf_mux_class_init (GstMXFMuxClass * klass)
   gobject_class->set_property = gst_mxf_mux_set_property;
   gobject_class->get_property = gst_mxf_mux_get_property;
 
+  /**
+   * GstMXFMux:partition-duration:
+   *
+   * Start a new body partition after this much essence, so that files can
+   * be read while they are still being written. Partitions are only started
+   * at keyframes. 0 disables partitioning by duration.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_PARTITION_DURATION,
+      g_param_spec_uint64 ("partition-duration", "Partition duration",
+          "Duration of essence per body partition in nanoseconds "
+          "(0 = unlimited)", 0, G_MAXUINT64, DEFAULT_PARTITION_DURATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMXFMux:partition-size:
+   *
+   * Start a new body partition after this many bytes of essence. Partitions
+   * are only started at keyframes. 0 disables partitioning by size.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_PARTITION_SIZE,
+      g_param_spec_uint64 ("partition-size", "Partition size",
+          "Bytes of essence per body partition (0 = unlimited)", 0,
+          G_MAXUINT64, DEFAULT_PARTITION_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMXFMux:repeat-header-metadata:
+   *
+   * Repeat the header metadata in every body partition, allowing readers to
+   * start from any partition of the file.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (gobject_class, PROP_REPEAT_HEADER_METADATA,
+      g_param_spec_boolean ("repeat-header-metadata", "Repeat header metadata",
+          "Repeat the header metadata in body partitions",
+          DEFAULT_REPEAT_HEADER_METADATA,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_mxf_mux_change_state);
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_mxf_mux_request_new_pad);
@@ -149,6 +202,13 @@ gst_mxf_mux_init (GstMXFMux * mux)
   gst_collect_pads_set_function (mux->collect,
       GST_DEBUG_FUNCPTR (gst_mxf_mux_collected), mux);
 
+  mux->index_entries = g_array_new (FALSE, FALSE, sizeof (MXFIndexEntry));
+  mux->rip = g_array_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry));
+
+  mux->partition_duration = DEFAULT_PARTITION_DURATION;
+  mux->partition_size = DEFAULT_PARTITION_SIZE;
+  mux->repeat_header_metadata = DEFAULT_REPEAT_HEADER_METADATA;
+
   gst_mxf_mux_reset (mux);
 }
 
@@ -166,6 +226,9 @@ gst_mxf_mux_finalize (GObject * object)
     mux->metadata_list = NULL;
   }
 
+  g_array_free (mux->index_entries, TRUE);
+  g_array_free (mux->rip, TRUE);
+
   gst_object_unref (mux->collect);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -175,9 +238,18 @@ static void
 gst_mxf_mux_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
 {
-  //GstMXFMux *mux = GST_MXF_MUX (object);
+  GstMXFMux *mux = GST_MXF_MUX (object);
 
   switch (prop_id) {
+    case PROP_PARTITION_DURATION:
+      mux->partition_duration = g_value_get_uint64 (value);
+      break;
+    case PROP_PARTITION_SIZE:
+      mux->partition_size = g_value_get_uint64 (value);
+      break;
+    case PROP_REPEAT_HEADER_METADATA:
+      mux->repeat_header_metadata = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -188,9 +260,18 @@ static void
 gst_mxf_mux_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
 {
-  //GstMXFMux *mux = GST_MXF_MUX (object);
+  GstMXFMux *mux = GST_MXF_MUX (object);
 
   switch (prop_id) {
+    case PROP_PARTITION_DURATION:
+      g_value_set_uint64 (value, mux->partition_duration);
+      break;
+    case PROP_PARTITION_SIZE:
+      g_value_set_uint64 (value, mux->partition_size);
+      break;
+    case PROP_REPEAT_HEADER_METADATA:
+      g_value_set_boolean (value, mux->repeat_header_metadata);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -228,6 +309,15 @@ gst_mxf_mux_reset (GstMXFMux * mux)
   mux->last_gc_timestamp = 0;
   mux->last_gc_position = 0;
   mux->offset = 0;
+
+  mux->essence_offset = 0;
+  g_array_set_size (mux->index_entries, 0);
+  mux->index_start_position = 0;
+  mux->last_keyframe_position = G_MAXUINT64;
+  mux->index_written = FALSE;
+  mux->partition_start_timestamp = 0;
+  mux->partition_start_offset = 0;
+  g_array_set_size (mux->rip, 0);
 }
 
 static gboolean
@@ -949,7 +1039,7 @@ gst_mxf_mux_create_metadata (GstMXFMux * mux)
 
     cstorage->essence_container_data[0]->linked_package =
         MXF_METADATA_SOURCE_PACKAGE (cstorage->packages[1]);
-    cstorage->essence_container_data[0]->index_sid = 0;
+    cstorage->essence_container_data[0]->index_sid = 2;
     cstorage->essence_container_data[0]->body_sid = 1;
   }
 
@@ -1046,8 +1136,146 @@ gst_mxf_mux_init_partition_pack (GstMXFMux * mux)
   return GST_FLOW_OK;
 }
 
+/* Called when the content package of the last index entry is complete */
+static void
+gst_mxf_mux_finish_index_entry (GstMXFMux * mux)
+{
+  MXFIndexEntry *entry;
+  guint64 position;
+
+  if (mux->index_entries->len == 0)
+    return;
+
+  position = mux->index_start_position + mux->index_entries->len - 1;
+  entry = &g_array_index (mux->index_entries, MXFIndexEntry,
+      mux->index_entries->len - 1);
+
+  if ((entry->flags & 0x80)) {
+    mux->last_keyframe_position = position;
+    entry->key_frame_offset = 0;
+  } else if (mux->last_keyframe_position != G_MAXUINT64) {
+    entry->key_frame_offset =
+        -(gint) MIN (position - mux->last_keyframe_position, 128);
+  }
+}
+
+/* Adds index entries up to the current content package, which starts at
+ * the current essence offset. Skipped content packages are empty. */
+static void
+gst_mxf_mux_add_index_entries (GstMXFMux * mux)
+{
+  MXFIndexEntry entry;
+  guint64 position;
+
+  memset (&entry, 0, sizeof (MXFIndexEntry));
+  entry.stream_offset = mux->essence_offset;
+
+  position = mux->index_start_position + mux->index_entries->len;
+  for (; position <= mux->last_gc_position; position++) {
+    gst_mxf_mux_finish_index_entry (mux);
+
+    /* Cleared again if any element of the content package is a delta unit */
+    entry.flags = (position == mux->last_gc_position) ? 0x80 : 0x00;
+    g_array_append_val (mux->index_entries, entry);
+  }
+}
+
+/* Returns the size of all edit units if it is constant, 0 otherwise */
+static guint32
+gst_mxf_mux_get_edit_unit_byte_count (GstMXFMux * mux)
+{
+  MXFIndexEntry *entries = (MXFIndexEntry *) mux->index_entries->data;
+  guint n = mux->index_entries->len;
+  guint64 size;
+  guint i;
+
+  if (mux->index_written || n == 0 || entries[0].stream_offset != 0)
+    return 0;
+
+  size = mux->essence_offset - entries[n - 1].stream_offset;
+  if (size == 0 || size > G_MAXUINT32)
+    return 0;
+
+  for (i = 1; i < n; i++) {
+    if (entries[i].stream_offset - entries[i - 1].stream_offset != size)
+      return 0;
+  }
+
+  return size;
+}
+
+/* Creates index table segments for all pending index entries and appends
+ * them to @buffers. Returns the number of bytes in the segments. */
+static guint64
+gst_mxf_mux_create_index_segments (GstMXFMux * mux, GList ** buffers)
+{
+  MXFMetadataEssenceContainerData *ecd =
+      mux->preface->content_storage->essence_container_data[0];
+  MXFIndexTableSegment segment;
+  GstBuffer *buf;
+  guint64 byte_count = 0;
+  guint32 edit_unit_byte_count = 0;
+  guint n, i;
+
+  gst_mxf_mux_finish_index_entry (mux);
+
+  n = mux->index_entries->len;
+  if (n == 0)
+    return 0;
+
+  memset (&segment, 0, sizeof (MXFIndexTableSegment));
+  memcpy (&segment.index_edit_rate, &mux->min_edit_rate, sizeof (MXFFraction));
+  segment.index_sid = ecd->index_sid;
+  segment.body_sid = ecd->body_sid;
+
+  /* Whether all edit units have the same size is only known at the end, a
+   * single segment without entries then indexes the whole body */
+  if (mux->partition.type == MXF_PARTITION_PACK_FOOTER)
+    edit_unit_byte_count = gst_mxf_mux_get_edit_unit_byte_count (mux);
+
+  if (edit_unit_byte_count > 0) {
+    GST_DEBUG_OBJECT (mux, "Writing CBE index with edit unit size %u",
+        edit_unit_byte_count);
+
+    mxf_uuid_init (&segment.instance_id, mux->metadata);
+    segment.index_start_position = mux->index_start_position;
+    segment.index_duration = n;
+    segment.edit_unit_byte_count = edit_unit_byte_count;
+
+    buf = mxf_index_table_segment_to_buffer (&segment);
+    byte_count += gst_buffer_get_size (buf);
+    *buffers = g_list_append (*buffers, buf);
+  } else {
+    GST_DEBUG_OBJECT (mux, "Writing VBE index for edit units %"
+        G_GUINT64_FORMAT " to %" G_GUINT64_FORMAT, mux->index_start_position,
+        mux->index_start_position + n - 1);
+
+    for (i = 0; i < n; i += MAX_INDEX_ENTRIES_PER_SEGMENT) {
+      mxf_uuid_init (&segment.instance_id, mux->metadata);
+      segment.index_start_position = mux->index_start_position + i;
+      segment.n_index_entries = MIN (n - i, MAX_INDEX_ENTRIES_PER_SEGMENT);
+      segment.index_duration = segment.n_index_entries;
+      segment.index_entries =
+          &g_array_index (mux->index_entries, MXFIndexEntry, i);
+
+      buf = mxf_index_table_segment_to_buffer (&segment);
+      byte_count += gst_buffer_get_size (buf);
+      *buffers = g_list_append (*buffers, buf);
+    }
+  }
+
+  mux->index_start_position += n;
+  g_array_set_size (mux->index_entries, 0);
+  mux->index_written = TRUE;
+
+  return byte_count;
+}
+
+/* Pushes the partition pack followed by the header metadata and the index
+ * table segments for all essence since the last partition, if requested */
 static GstFlowReturn
-gst_mxf_mux_write_header_metadata (GstMXFMux * mux)
+gst_mxf_mux_write_partition (GstMXFMux * mux, gboolean with_metadata,
+    gboolean with_index)
 {
   GstFlowReturn ret = GST_FLOW_OK;
   GstBuffer *buf;
@@ -1055,20 +1283,30 @@ gst_mxf_mux_write_header_metadata (GstMXFMux * mux)
   GList *l;
   MXFMetadataBase *m;
   guint64 header_byte_count = 0;
+  guint64 index_byte_count = 0;
+
+  if (with_metadata) {
+    for (l = mux->metadata_list; l; l = l->next) {
+      m = l->data;
+      buf = mxf_metadata_base_to_buffer (m, &mux->primer);
+      header_byte_count += gst_buffer_get_size (buf);
+      buffers = g_list_prepend (buffers, buf);
+    }
 
-  for (l = mux->metadata_list; l; l = l->next) {
-    m = l->data;
-    buf = mxf_metadata_base_to_buffer (m, &mux->primer);
+    buffers = g_list_reverse (buffers);
+    buf = mxf_primer_pack_to_buffer (&mux->primer);
     header_byte_count += gst_buffer_get_size (buf);
     buffers = g_list_prepend (buffers, buf);
   }
 
-  buffers = g_list_reverse (buffers);
-  buf = mxf_primer_pack_to_buffer (&mux->primer);
-  header_byte_count += gst_buffer_get_size (buf);
-  buffers = g_list_prepend (buffers, buf);
+  if (with_index)
+    index_byte_count = gst_mxf_mux_create_index_segments (mux, &buffers);
 
   mux->partition.header_byte_count = header_byte_count;
+  mux->partition.index_byte_count = index_byte_count;
+  mux->partition.index_sid = (index_byte_count > 0) ?
+      mux->preface->content_storage->essence_container_data[0]->index_sid : 0;
+
   buf = mxf_partition_pack_to_buffer (&mux->partition);
   if ((ret = gst_mxf_mux_push (mux, buf)) != GST_FLOW_OK) {
     GST_ERROR_OBJECT (mux, "Failed pushing partition: %s",
@@ -1095,6 +1333,103 @@ gst_mxf_mux_write_header_metadata (GstMXFMux * mux)
   return ret;
 }
 
+static GstFlowReturn
+gst_mxf_mux_write_header_metadata (GstMXFMux * mux)
+{
+  return gst_mxf_mux_write_partition (mux, TRUE, FALSE);
+}
+
+static void
+gst_mxf_mux_add_rip_entry (GstMXFMux * mux)
+{
+  MXFRandomIndexPackEntry entry;
+
+  entry.offset = mux->partition.this_partition;
+  entry.body_sid = mux->partition.body_sid;
+  g_array_append_val (mux->rip, entry);
+}
+
+static GstFlowReturn
+gst_mxf_mux_write_body_partition (GstMXFMux * mux)
+{
+  gboolean first = (mux->essence_offset == 0);
+
+  mux->partition.type = MXF_PARTITION_PACK_BODY;
+  mux->partition.prev_partition = mux->partition.this_partition;
+  mux->partition.this_partition = mux->offset;
+  mux->partition.footer_partition = 0;
+  mux->partition.body_offset = mux->essence_offset;
+  mux->partition.body_sid =
+      mux->preface->content_storage->essence_container_data[0]->body_sid;
+  gst_mxf_mux_add_rip_entry (mux);
+
+  mux->partition_start_timestamp = mux->last_gc_timestamp;
+  mux->partition_start_offset = mux->essence_offset;
+
+  GST_DEBUG_OBJECT (mux, "Starting body partition at offset %" G_GUINT64_FORMAT
+      ", essence offset %" G_GUINT64_FORMAT, mux->offset, mux->essence_offset);
+
+  /* The header metadata directly precedes the first body partition, the
+   * index of the previous partition's essence goes into the new one */
+  return gst_mxf_mux_write_partition (mux, mux->repeat_header_metadata
+      && !first, !first);
+}
+
+/* Whether the picture of the content package that @cpad starts is not a
+ * keyframe. Pictures come first in a content package, unless the picture
+ * track has nothing for this one yet, then its next buffer decides. */
+static gboolean
+gst_mxf_mux_picture_is_delta_unit (GstMXFMux * mux, GstMXFMuxPad * cpad)
+{
+  GSList *l;
+
+  for (l = mux->collect->data; l; l = l->next) {
+    GstMXFMuxPad *pad = l->data;
+    GstBuffer *buf;
+    gboolean delta_unit;
+
+    if (mxf_metadata_track_identifier_parse (&pad->writer->data_definition) !=
+        MXF_METADATA_TRACK_PICTURE_ESSENCE)
+      continue;
+
+    if (pad == cpad)
+      return cpad->delta_unit;
+
+    buf = gst_collect_pads_peek (mux->collect, &pad->collect);
+    if (!buf)
+      return FALSE;
+
+    delta_unit = GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    gst_buffer_unref (buf);
+
+    return delta_unit;
+  }
+
+  /* No picture track, every content package can start a partition */
+  return FALSE;
+}
+
+/* Whether a new body partition should start with the content package that
+ * @cpad starts. Partitions start at keyframes so that every one is decodable
+ * on its own. */
+static gboolean
+gst_mxf_mux_partition_due (GstMXFMux * mux, GstMXFMuxPad * cpad)
+{
+  if (gst_mxf_mux_picture_is_delta_unit (mux, cpad))
+    return FALSE;
+
+  if (mux->partition_duration > 0 &&
+      mux->last_gc_timestamp - mux->partition_start_timestamp >=
+      mux->partition_duration)
+    return TRUE;
+
+  if (mux->partition_size > 0 &&
+      mux->essence_offset - mux->partition_start_offset >= mux->partition_size)
+    return TRUE;
+
+  return FALSE;
+}
+
 static const guint8 _gc_essence_element_ul[] = {
   0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x00,
   0x0d, 0x01, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00
@@ -1123,6 +1458,8 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   }
 
   if (buf) {
+    cpad->delta_unit = GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
     GST_DEBUG_OBJECT (cpad->collect.pad,
         "Handling buffer of size %" G_GSIZE_FORMAT " for track %u at position %"
         G_GINT64_FORMAT, gst_buffer_get_size (buf),
@@ -1154,6 +1491,25 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   if (buf == NULL)
     return ret;
 
+  /* First element of a new content package */
+  if (mux->last_gc_position >=
+      mux->index_start_position + mux->index_entries->len) {
+    gst_mxf_mux_finish_index_entry (mux);
+
+    if (gst_mxf_mux_partition_due (mux, cpad)) {
+      if ((ret = gst_mxf_mux_write_body_partition (mux)) != GST_FLOW_OK) {
+        gst_buffer_unref (buf);
+        return ret;
+      }
+    }
+
+    gst_mxf_mux_add_index_entries (mux);
+  }
+
+  if (cpad->delta_unit)
+    g_array_index (mux->index_entries, MXFIndexEntry,
+        mux->index_entries->len - 1).flags &= ~0x80;
+
   gst_buffer_map (buf, &readmap, GST_MAP_READ);
   slen = mxf_ber_encode_size (readmap.size, ber);
   packet = gst_buffer_new_and_alloc (16 + slen + readmap.size);
@@ -1172,6 +1528,8 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
       cpad->source_track->parent.track_id);
   gst_buffer_unmap (packet, &map);
 
+  mux->essence_offset += gst_buffer_get_size (packet);
+
   if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK) {
     GST_ERROR_OBJECT (cpad->collect.pad,
         "Failed pushing buffer for track %u, reason %s",
@@ -1187,26 +1545,6 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   return ret;
 }
 
-static GstFlowReturn
-gst_mxf_mux_write_body_partition (GstMXFMux * mux)
-{
-  GstBuffer *buf;
-
-  mux->partition.type = MXF_PARTITION_PACK_BODY;
-  mux->partition.this_partition = mux->offset;
-  mux->partition.prev_partition = 0;
-  mux->partition.footer_partition = 0;
-  mux->partition.header_byte_count = 0;
-  mux->partition.index_byte_count = 0;
-  mux->partition.index_sid = 0;
-  mux->partition.body_offset = 0;
-  mux->partition.body_sid =
-      mux->preface->content_storage->essence_container_data[0]->body_sid;
-
-  buf = mxf_partition_pack_to_buffer (&mux->partition);
-  return gst_mxf_mux_push (mux, buf);
-}
-
 static GstFlowReturn
 gst_mxf_mux_handle_eos (GstMXFMux * mux)
 {
@@ -1300,44 +1638,26 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
   }
 
   {
-    guint64 body_partition = mux->partition.this_partition;
-    guint32 body_sid = mux->partition.body_sid;
     guint64 footer_partition = mux->offset;
-    GArray *rip;
     GstFlowReturn ret;
     GstSegment segment;
-    MXFRandomIndexPackEntry entry;
 
     mux->partition.type = MXF_PARTITION_PACK_FOOTER;
     mux->partition.closed = TRUE;
     mux->partition.complete = TRUE;
+    mux->partition.prev_partition = mux->partition.this_partition;
     mux->partition.this_partition = mux->offset;
-    mux->partition.prev_partition = body_partition;
     mux->partition.footer_partition = mux->offset;
-    mux->partition.header_byte_count = 0;
-    mux->partition.index_byte_count = 0;
-    mux->partition.index_sid = 0;
     mux->partition.body_offset = 0;
     mux->partition.body_sid = 0;
+    gst_mxf_mux_add_rip_entry (mux);
 
-    gst_mxf_mux_write_header_metadata (mux);
-
-    rip = g_array_sized_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry), 3);
-    entry.offset = 0;
-    entry.body_sid = 0;
-    g_array_append_val (rip, entry);
-    entry.offset = body_partition;
-    entry.body_sid = body_sid;
-    g_array_append_val (rip, entry);
-    entry.offset = footer_partition;
-    entry.body_sid = 0;
-    g_array_append_val (rip, entry);
+    gst_mxf_mux_write_partition (mux, TRUE, TRUE);
 
-    packet = mxf_random_index_pack_to_buffer (rip);
+    packet = mxf_random_index_pack_to_buffer (mux->rip);
     if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK) {
       GST_ERROR_OBJECT (mux, "Failed pushing random index pack");
     }
-    g_array_free (rip, TRUE);
 
     /* Rewrite header partition with updated values */
     gst_segment_init (&segment, GST_FORMAT_BYTES);
@@ -1347,11 +1667,8 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
       mux->partition.closed = TRUE;
       mux->partition.complete = TRUE;
       mux->partition.this_partition = 0;
-      mux->partition.prev_partition = footer_partition;
+      mux->partition.prev_partition = 0;
       mux->partition.footer_partition = footer_partition;
-      mux->partition.header_byte_count = 0;
-      mux->partition.index_byte_count = 0;
-      mux->partition.index_sid = 0;
       mux->partition.body_offset = 0;
       mux->partition.body_sid = 0;
 
@@ -1419,6 +1736,7 @@ gst_mxf_mux_collected (GstCollectPads * pads, gpointer user_data)
         goto error;
 
       ret = gst_mxf_mux_write_header_metadata (mux);
+      gst_mxf_mux_add_rip_entry (mux);
     } else {
       ret = GST_FLOW_ERROR;
     }
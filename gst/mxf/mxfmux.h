@@ -57,6 +57,9 @@ typedef struct
 
   MXFMetadataSourcePackage *source_package;
   MXFMetadataTimelineTrack *source_track;
+
+  /* last input buffer was not a keyframe */
+  gboolean delta_unit;
 } GstMXFMuxPad;
 
 typedef enum
@@ -92,6 +95,28 @@ typedef struct _GstMXFMux {
   guint64 last_gc_position;
   GstClockTime last_gc_timestamp;
 
+  /* bytes of essence written to the body so far */
+  guint64 essence_offset;
+
+  /* index entries of the content packages not yet in a segment,
+   * the first one is at index_start_position */
+  GArray *index_entries;
+  guint64 index_start_position;
+  guint64 last_keyframe_position;
+  gboolean index_written;
+
+  /* start of the current body partition */
+  GstClockTime partition_start_timestamp;
+  guint64 partition_start_offset;
+
+  /* MXFRandomIndexPackEntry for every partition written */
+  GArray *rip;
+
+  /* properties */
+  GstClockTime partition_duration;
+  guint64 partition_size;
+  gboolean repeat_header_metadata;
+
   gchar *application;
 } GstMXFMux;
 
@@ -25,21 +25,27 @@
  * #GstPcapParse:src-port and #GstPcapParse:dst-port to restrict which packets
  * should be included.
  *
+ * Both classic libpcap and pcapng captures are supported. The payloads are
+ * pushed as sub-buffers of the input, they are not copied.
+ *
+ * When operating in pull mode the capture is scanned once before streaming
+ * starts to build an index of the packets of every flow, which is then used
+ * for seeking in time.
+ *
+ * With #GstPcapParse:split-flows every flow (source and destination address
+ * and port) that passes the filters gets its own src_%u pad, so that
+ * multiple streams can be extracted from a capture in a single pass.
+ *
  * <refsect2>
  * <title>Example pipelines</title>
  * |[
- * gst-launch-0.10 filesrc location=h264crasher.pcap ! pcapparse ! rtph264depay
- * ! ffdec_h264 ! fakesink
+ * gst-launch-1.0 filesrc location=h264crasher.pcap ! pcapparse ! rtph264depay
+ * ! avdec_h264 ! fakesink
  * ]| Read from a pcap dump file using filesrc, extract the raw UDP packets,
  * depayload and decode them.
  * </refsect2>
  */
 
-/* TODO:
- * - React on state-change and update state accordingly.
- * - Implement support for timestamping the buffers.
- */
-
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif
@@ -64,9 +70,12 @@ enum
   PROP_SRC_PORT,
   PROP_DST_PORT,
   PROP_CAPS,
-  PROP_TS_OFFSET
+  PROP_TS_OFFSET,
+  PROP_SPLIT_FLOWS
 };
 
+#define DEFAULT_SPLIT_FLOWS FALSE
+
 GST_DEBUG_CATEGORY_STATIC (gst_pcap_parse_debug);
 #define GST_CAT_DEFAULT gst_pcap_parse_debug
 
@@ -80,18 +89,37 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS_ANY);
 
+static GstStaticPadTemplate flow_src_template =
+GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_SOMETIMES,
+    GST_STATIC_CAPS_ANY);
+
 static void gst_pcap_parse_finalize (GObject * object);
 static void gst_pcap_parse_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_pcap_parse_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
+static GstStateChangeReturn gst_pcap_parse_change_state (GstElement * element,
+    GstStateChange transition);
 
 static void gst_pcap_parse_reset (GstPcapParse * self);
+static void gst_pcap_parse_clear_flows (GstPcapParse * self,
+    gboolean remove_pads);
 
 static GstFlowReturn gst_pcap_parse_chain (GstPad * pad,
     GstObject * parent, GstBuffer * buffer);
 static gboolean gst_pcap_sink_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
+static gboolean gst_pcap_parse_sink_activate (GstPad * pad,
+    GstObject * parent);
+static gboolean gst_pcap_parse_sink_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
+static void gst_pcap_parse_loop (GstPad * pad);
+static gboolean gst_pcap_parse_src_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+static gboolean gst_pcap_parse_src_query (GstPad * pad,
+    GstObject * parent, GstQuery * query);
 
 #define parent_class gst_pcap_parse_parent_class
 G_DEFINE_TYPE (GstPcapParse, gst_pcap_parse, GST_TYPE_ELEMENT);
@@ -106,6 +134,8 @@ gst_pcap_parse_class_init (GstPcapParseClass * klass)
   gobject_class->get_property = gst_pcap_parse_get_property;
   gobject_class->set_property = gst_pcap_parse_set_property;
 
+  element_class->change_state = gst_pcap_parse_change_state;
+
   g_object_class_install_property (gobject_class,
       PROP_SRC_IP, g_param_spec_string ("src-ip", "Source IP",
           "Source IP to restrict to", "",
@@ -136,10 +166,18 @@ gst_pcap_parse_class_init (GstPcapParseClass * klass)
           "Relative timestamp offset (ns) to apply (-1 = use absolute packet time)",
           -1, G_MAXINT64, -1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_SPLIT_FLOWS,
+      g_param_spec_boolean ("split-flows", "Split flows",
+          "Expose every flow that passes the filters on its own src_%u pad "
+          "instead of the src pad", DEFAULT_SPLIT_FLOWS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&sink_template));
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&src_template));
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&flow_src_template));
 
   gst_element_class_set_static_metadata (element_class, "PCapParse",
       "Raw/Parser",
@@ -149,6 +187,26 @@ gst_pcap_parse_class_init (GstPcapParseClass * klass)
   GST_DEBUG_CATEGORY_INIT (gst_pcap_parse_debug, "pcapparse", 0, "pcap parser");
 }
 
+static guint
+gst_pcap_parse_flow_key_hash (gconstpointer v)
+{
+  const GstPcapParseFlowKey *key = v;
+
+  return key->src_ip ^ (key->dst_ip * 31) ^
+      ((key->src_port << 16) | key->dst_port) ^ key->protocol;
+}
+
+static gboolean
+gst_pcap_parse_flow_key_equal (gconstpointer v1, gconstpointer v2)
+{
+  const GstPcapParseFlowKey *a = v1;
+  const GstPcapParseFlowKey *b = v2;
+
+  return a->src_ip == b->src_ip && a->dst_ip == b->dst_ip &&
+      a->src_port == b->src_port && a->dst_port == b->dst_port &&
+      a->protocol == b->protocol;
+}
+
 static void
 gst_pcap_parse_init (GstPcapParse * self)
 {
@@ -158,10 +216,18 @@ gst_pcap_parse_init (GstPcapParse * self)
   gst_pad_use_fixed_caps (self->sink_pad);
   gst_pad_set_event_function (self->sink_pad,
       GST_DEBUG_FUNCPTR (gst_pcap_sink_event));
+  gst_pad_set_activate_function (self->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_sink_activate));
+  gst_pad_set_activatemode_function (self->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_sink_activate_mode));
   gst_element_add_pad (GST_ELEMENT (self), self->sink_pad);
 
   self->src_pad = gst_pad_new_from_static_template (&src_template, "src");
   gst_pad_use_fixed_caps (self->src_pad);
+  gst_pad_set_event_function (self->src_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_src_event));
+  gst_pad_set_query_function (self->src_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_src_query));
   gst_element_add_pad (GST_ELEMENT (self), self->src_pad);
 
   self->src_ip = -1;
@@ -169,8 +235,15 @@ gst_pcap_parse_init (GstPcapParse * self)
   self->src_port = -1;
   self->dst_port = -1;
   self->offset = -1;
+  self->split_flows = DEFAULT_SPLIT_FLOWS;
 
   self->adapter = gst_adapter_new ();
+  self->interfaces = g_array_new (FALSE, FALSE, sizeof (GstPcapParseInterface));
+  self->sections = g_array_new (FALSE, FALSE, sizeof (GstPcapParseSection));
+  self->flow_table = g_hash_table_new (gst_pcap_parse_flow_key_hash,
+      gst_pcap_parse_flow_key_equal);
+  self->flows = g_ptr_array_new ();
+  self->flowcombiner = gst_flow_combiner_new ();
 
   gst_pcap_parse_reset (self);
 }
@@ -180,7 +253,14 @@ gst_pcap_parse_finalize (GObject * object)
 {
   GstPcapParse *self = GST_PCAP_PARSE (object);
 
+  gst_pcap_parse_clear_flows (self, FALSE);
+
   g_object_unref (self->adapter);
+  g_array_free (self->interfaces, TRUE);
+  g_array_free (self->sections, TRUE);
+  g_hash_table_destroy (self->flow_table);
+  g_ptr_array_free (self->flows, TRUE);
+  gst_flow_combiner_free (self->flowcombiner);
   if (self->caps)
     gst_caps_unref (self->caps);
 
@@ -242,6 +322,10 @@ gst_pcap_parse_get_property (GObject * object, guint prop_id,
       g_value_set_int64 (value, self->offset);
       break;
 
+    case PROP_SPLIT_FLOWS:
+      g_value_set_boolean (value, self->split_flows);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -296,39 +380,101 @@ gst_pcap_parse_set_property (GObject * object, guint prop_id,
       self->offset = g_value_get_int64 (value);
       break;
 
+    case PROP_SPLIT_FLOWS:
+      self->split_flows = g_value_get_boolean (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static void
+gst_pcap_parse_free_flow (GstPcapParse * self, GstPcapParseFlow * flow,
+    gboolean remove_pad)
+{
+  if (flow->pad && remove_pad) {
+    gst_flow_combiner_remove_pad (self->flowcombiner, flow->pad);
+    gst_element_remove_pad (GST_ELEMENT_CAST (self), flow->pad);
+  }
+  if (flow->pending)
+    gst_buffer_list_unref (flow->pending);
+  if (flow->index)
+    g_array_free (flow->index, TRUE);
+  g_slice_free (GstPcapParseFlow, flow);
+}
+
+/* the pads are already gone when called from finalize */
+static void
+gst_pcap_parse_clear_flows (GstPcapParse * self, gboolean remove_pads)
+{
+  guint i;
+
+  g_hash_table_remove_all (self->flow_table);
+  for (i = 0; i < self->flows->len; i++)
+    gst_pcap_parse_free_flow (self, g_ptr_array_index (self->flows, i),
+        remove_pads);
+  g_ptr_array_set_size (self->flows, 0);
+
+  g_array_set_size (self->sections, 0);
+  self->index_min_ts = GST_CLOCK_TIME_NONE;
+  self->index_max_ts = GST_CLOCK_TIME_NONE;
+  self->duration = GST_CLOCK_TIME_NONE;
+}
+
 static void
 gst_pcap_parse_reset (GstPcapParse * self)
 {
   self->initialized = FALSE;
+  self->pcapng = FALSE;
   self->swap_endian = FALSE;
-  self->cur_packet_size = -1;
-  self->cur_ts = GST_CLOCK_TIME_NONE;
+  self->cur_offset = 0;
   self->base_ts = GST_CLOCK_TIME_NONE;
   self->newsegment_sent = FALSE;
+  self->segment_set = FALSE;
+  gst_segment_init (&self->segment, GST_FORMAT_TIME);
+
+  g_array_set_size (self->interfaces, 0);
+  self->if_base = 0;
+
+  if (self->pending) {
+    gst_buffer_list_unref (self->pending);
+    self->pending = NULL;
+  }
+
+  self->indexing = FALSE;
+  self->need_stream_start = FALSE;
+  self->reached_stop = FALSE;
+  gst_buffer_replace (&self->pull_cache, NULL);
 
   gst_adapter_clear (self->adapter);
 }
 
+static guint32
+gst_pcap_parse_swap_uint32 (const guint8 * p, gboolean swap)
+{
+  guint32 val;
+
+  memcpy (&val, p, sizeof (val));
+
+  return swap ? GUINT32_SWAP_LE_BE (val) : val;
+}
+
 static guint32
 gst_pcap_parse_read_uint32 (GstPcapParse * self, const guint8 * p)
 {
-  guint32 val = *((guint32 *) p);
+  return gst_pcap_parse_swap_uint32 (p, self->swap_endian);
+}
 
-  if (self->swap_endian) {
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-    return GUINT32_FROM_BE (val);
-#else
-    return GUINT32_FROM_LE (val);
-#endif
-  } else {
-    return val;
-  }
+static guint16
+gst_pcap_parse_read_uint16 (GstPcapParse * self, const guint8 * p)
+{
+  guint16 val;
+
+  memcpy (&val, p, sizeof (val));
+
+  return self->swap_endian ? GUINT16_SWAP_LE_BE (val) : val;
 }
 
 #define ETH_HEADER_LEN    14
@@ -339,11 +485,37 @@ gst_pcap_parse_read_uint32 (GstPcapParse * self, const guint8 * p)
 #define IP_PROTO_UDP      17
 #define IP_PROTO_TCP      6
 
+#define PCAP_MAGIC            0xa1b2c3d4
+#define PCAP_MAGIC_SWAPPED    0xd4c3b2a1
+#define PCAP_MAGIC_NS         0xa1b23c4d
+#define PCAP_MAGIC_NS_SWAPPED 0x4d3cb2a1
+#define PCAP_HEADER_LEN       24
+#define PCAP_RECORD_LEN       16
+
+/* pcapng block types, the section header block type is the same in both
+ * byte orders */
+#define PCAPNG_BLOCK_SHB      0x0a0d0d0a
+#define PCAPNG_BLOCK_IDB      0x00000001
+#define PCAPNG_BLOCK_PB       0x00000002
+#define PCAPNG_BLOCK_SPB      0x00000003
+#define PCAPNG_BLOCK_EPB      0x00000006
+#define PCAPNG_BYTE_ORDER     0x1a2b3c4d
+#define PCAPNG_OPT_IF_TSRESOL 9
+
+/* enough bytes to tell the size of any record */
+#define PCAP_PARSE_PEEK_LEN   12
+/* anything bigger is a corrupt capture */
+#define PCAP_PARSE_MAX_RECORD_LEN (16 * 1024 * 1024)
+
+/* pull mode reads the capture in chunks of this size, output buffers are
+ * sub-buffers of them */
+#define PCAP_PARSE_PULL_CHUNK_LEN (256 * 1024)
+#define PCAP_PARSE_RECORDS_PER_LOOP 256
 
 static gboolean
 gst_pcap_parse_scan_frame (GstPcapParse * self,
-    const guint8 * buf,
-    gint buf_size, const guint8 ** payload, gint * payload_size)
+    GstPcapParseLinktype linktype, const guint8 * buf, gint buf_size,
+    GstPcapParseFlowKey * key, gint * payload_offset, gint * payload_size)
 {
   const guint8 *buf_ip = 0;
   const guint8 *buf_proto;
@@ -351,25 +523,21 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
   guint8 b;
   guint8 ip_header_size;
   guint8 ip_protocol;
-  guint32 ip_src_addr;
-  guint32 ip_dst_addr;
-  guint16 src_port;
-  guint16 dst_port;
   guint16 len;
 
-  switch (self->linktype) {
+  switch (linktype) {
     case LINKTYPE_ETHER:
       if (buf_size < ETH_HEADER_LEN + IP_HEADER_MIN_LEN + UDP_HEADER_LEN)
         return FALSE;
 
-      eth_type = GUINT16_FROM_BE (*((guint16 *) (buf + 12)));
+      eth_type = GST_READ_UINT16_BE (buf + 12);
       buf_ip = buf + ETH_HEADER_LEN;
       break;
     case LINKTYPE_SLL:
       if (buf_size < SLL_HEADER_LEN + IP_HEADER_MIN_LEN + UDP_HEADER_LEN)
         return FALSE;
 
-      eth_type = GUINT16_FROM_BE (*((guint16 *) (buf + 14)));
+      eth_type = GST_READ_UINT16_BE (buf + 14);
       buf_ip = buf + SLL_HEADER_LEN;
       break;
     case LINKTYPE_RAW:
@@ -392,7 +560,9 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
     return FALSE;
 
   ip_header_size = (b & 0x0f) * 4;
-  if (buf_ip + ip_header_size > buf + buf_size)
+  if (ip_header_size < IP_HEADER_MIN_LEN)
+    return FALSE;
+  if (buf_ip + ip_header_size + 4 > buf + buf_size)
     return FALSE;
 
   ip_protocol = *(buf_ip + 9);
@@ -401,22 +571,25 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
   if (ip_protocol != IP_PROTO_UDP && ip_protocol != IP_PROTO_TCP)
     return FALSE;
 
-  /* ip info */
-  ip_src_addr = *((guint32 *) (buf_ip + 12));
-  ip_dst_addr = *((guint32 *) (buf_ip + 16));
+  /* ip info, kept in network byte order like the filter properties */
+  memcpy (&key->src_ip, buf_ip + 12, 4);
+  memcpy (&key->dst_ip, buf_ip + 16, 4);
+  key->protocol = ip_protocol;
   buf_proto = buf_ip + ip_header_size;
 
   /* ok for tcp and udp */
-  src_port = GUINT16_FROM_BE (*((guint16 *) (buf_proto + 0)));
-  dst_port = GUINT16_FROM_BE (*((guint16 *) (buf_proto + 2)));
+  key->src_port = GST_READ_UINT16_BE (buf_proto + 0);
+  key->dst_port = GST_READ_UINT16_BE (buf_proto + 2);
 
   /* extract some params and data according to protocol */
   if (ip_protocol == IP_PROTO_UDP) {
-    len = GUINT16_FROM_BE (*((guint16 *) (buf_proto + 4)));
+    if (buf_proto + UDP_HEADER_LEN > buf + buf_size)
+      return FALSE;
+    len = GST_READ_UINT16_BE (buf_proto + 4);
     if (len < UDP_HEADER_LEN || buf_proto + len > buf + buf_size)
       return FALSE;
 
-    *payload = buf_proto + UDP_HEADER_LEN;
+    *payload_offset = buf_proto + UDP_HEADER_LEN - buf;
     *payload_size = len - UDP_HEADER_LEN;
   } else {
     if (buf_proto + 12 >= buf + buf_size)
@@ -426,183 +599,653 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
       return FALSE;
 
     /* all remaining data following tcp header is payload */
-    *payload = buf_proto + len;
-    *payload_size = self->cur_packet_size - (buf_proto - buf) - len;
+    *payload_offset = buf_proto + len - buf;
+    *payload_size = buf_size - *payload_offset;
   }
 
-  /* but still filter as configured */
-  if (self->src_ip >= 0 && ip_src_addr != self->src_ip)
+  return TRUE;
+}
+
+static gboolean
+gst_pcap_parse_filter_flow (GstPcapParse * self,
+    const GstPcapParseFlowKey * key)
+{
+  if (self->src_ip >= 0 && key->src_ip != self->src_ip)
     return FALSE;
 
-  if (self->dst_ip >= 0 && ip_dst_addr != self->dst_ip)
+  if (self->dst_ip >= 0 && key->dst_ip != self->dst_ip)
     return FALSE;
 
-  if (self->src_port >= 0 && src_port != self->src_port)
+  if (self->src_port >= 0 && key->src_port != self->src_port)
     return FALSE;
 
-  if (self->dst_port >= 0 && dst_port != self->dst_port)
+  if (self->dst_port >= 0 && key->dst_port != self->dst_port)
     return FALSE;
 
   return TRUE;
 }
 
+static void
+gst_pcap_parse_add_flow_pad (GstPcapParse * self, GstPcapParseFlow * flow)
+{
+  GstEvent *event;
+  gchar *name, *src, *stream_id;
+
+  name = g_strdup_printf ("src_%u", flow->id);
+  flow->pad = gst_pad_new_from_static_template (&flow_src_template, name);
+  g_free (name);
+
+  gst_pad_use_fixed_caps (flow->pad);
+  gst_pad_set_event_function (flow->pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_src_event));
+  gst_pad_set_query_function (flow->pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_src_query));
+  gst_pad_set_active (flow->pad, TRUE);
+
+  /* name the stream after the flow so that applications can tell them
+   * apart; inet_ntoa() uses a static buffer */
+  src = g_strdup (get_ip_address_as_string (flow->key.src_ip));
+  stream_id = gst_pad_create_stream_id_printf (flow->pad,
+      GST_ELEMENT_CAST (self), "%s-%s:%u-%s:%u",
+      flow->key.protocol == IP_PROTO_UDP ? "udp" : "tcp", src,
+      flow->key.src_port, get_ip_address_as_string (flow->key.dst_ip),
+      flow->key.dst_port);
+  g_free (src);
+
+  GST_DEBUG_OBJECT (self, "adding pad %s:%s for stream %s",
+      GST_DEBUG_PAD_NAME (flow->pad), stream_id);
+
+  event = gst_event_new_stream_start (stream_id);
+  gst_event_set_group_id (event, gst_util_group_id_next ());
+  gst_pad_push_event (flow->pad, event);
+  g_free (stream_id);
+
+  if (self->caps)
+    gst_pad_set_caps (flow->pad, self->caps);
+
+  gst_flow_combiner_add_pad (self->flowcombiner, flow->pad);
+  gst_element_add_pad (GST_ELEMENT_CAST (self), flow->pad);
+}
+
+static GstPcapParseFlow *
+gst_pcap_parse_get_flow (GstPcapParse * self, const GstPcapParseFlowKey * key)
+{
+  GstPcapParseFlow *flow;
+
+  flow = g_hash_table_lookup (self->flow_table, key);
+  if (flow)
+    return flow;
+
+  flow = g_slice_new0 (GstPcapParseFlow);
+  flow->key = *key;
+  flow->id = self->flows->len;
+  if (self->random_access)
+    flow->index = g_array_new (FALSE, FALSE, sizeof (GstPcapParseIndexEntry));
+
+  g_ptr_array_add (self->flows, flow);
+  g_hash_table_insert (self->flow_table, &flow->key, flow);
+
+  GST_DEBUG_OBJECT (self, "new flow %u, %s port %u -> port %u", flow->id,
+      key->protocol == IP_PROTO_UDP ? "udp" : "tcp", key->src_port,
+      key->dst_port);
+
+  /* in pull mode the pads are added once the index is complete */
+  if (self->split_flows && !self->random_access)
+    gst_pcap_parse_add_flow_pad (self, flow);
+
+  return flow;
+}
+
+/* converts a capture time to the running time we timestamp with */
+static GstClockTime
+gst_pcap_parse_output_time (GstPcapParse * self, GstClockTime ts)
+{
+  if (!GST_CLOCK_TIME_IS_VALID (ts))
+    return ts;
+
+  if (!GST_CLOCK_TIME_IS_VALID (self->base_ts))
+    self->base_ts = ts;
+
+  if (self->offset < 0)
+    return ts;
+
+  return (ts > self->base_ts ? ts - self->base_ts : 0) + self->offset;
+}
+
+static GstClockTime
+gst_pcap_parse_capture_time (GstPcapParse * self, GstClockTime ts)
+{
+  if (self->offset < 0 || !GST_CLOCK_TIME_IS_VALID (self->base_ts))
+    return ts;
+
+  if (ts < self->offset)
+    return self->base_ts;
+
+  return ts - self->offset + self->base_ts;
+}
+
 static GstFlowReturn
-gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_pcap_parse_handle_packet (GstPcapParse * self, guint32 interface_id,
+    GstClockTime ts, GstBuffer * record, const guint8 * data,
+    guint data_offset, guint data_size, guint64 offset)
 {
-  GstPcapParse *self = GST_PCAP_PARSE (parent);
-  GstFlowReturn ret = GST_FLOW_OK;
-  GstBufferList *list = NULL;
+  GstPcapParseInterface *iface;
+  GstPcapParseFlowKey key;
+  GstPcapParseFlow *flow;
+  GstBuffer *out_buf;
+  gint payload_offset, payload_size;
+
+  if (self->if_base + interface_id >= self->interfaces->len) {
+    GST_WARNING_OBJECT (self, "packet for unknown interface %u", interface_id);
+    return GST_FLOW_OK;
+  }
+  iface = &g_array_index (self->interfaces, GstPcapParseInterface,
+      self->if_base + interface_id);
 
-  gst_adapter_push (self->adapter, buffer);
+  GST_LOG_OBJECT (self, "examining packet size %u", data_size);
 
-  while (ret == GST_FLOW_OK) {
-    gint avail;
-    const guint8 *data;
+  if (!gst_pcap_parse_scan_frame (self, iface->linktype, data + data_offset,
+          data_size, &key, &payload_offset, &payload_size))
+    return GST_FLOW_OK;
 
-    avail = gst_adapter_available (self->adapter);
+  if (!gst_pcap_parse_filter_flow (self, &key))
+    return GST_FLOW_OK;
 
-    if (self->initialized) {
-      if (self->cur_packet_size >= 0) {
-        if (avail < self->cur_packet_size)
-          break;
-
-        if (self->cur_packet_size > 0) {
-          const guint8 *payload_data;
-          gint payload_size;
-
-          data = gst_adapter_map (self->adapter, self->cur_packet_size);
-
-          GST_LOG_OBJECT (self, "examining packet size %" G_GINT64_FORMAT,
-              self->cur_packet_size);
-
-          if (gst_pcap_parse_scan_frame (self, data, self->cur_packet_size,
-                  &payload_data, &payload_size)) {
-            GstBuffer *out_buf;
-            guintptr offset = payload_data - data;
-
-            gst_adapter_unmap (self->adapter);
-            gst_adapter_flush (self->adapter, offset);
-            /* we don't use _take_buffer_fast() on purpose here, we need a
-             * buffer with a single memory, since the RTP depayloaders expect
-             * the complete RTP header to be in the first memory if there are
-             * multiple ones and we can't guarantee that with _fast() */
-            out_buf = gst_adapter_take_buffer (self->adapter, payload_size);
-            gst_adapter_flush (self->adapter,
-                self->cur_packet_size - offset - payload_size);
-
-            if (GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
-              if (!GST_CLOCK_TIME_IS_VALID (self->base_ts))
-                self->base_ts = self->cur_ts;
-              if (self->offset >= 0) {
-                self->cur_ts -= self->base_ts;
-                self->cur_ts += self->offset;
-              }
-            }
-            GST_BUFFER_TIMESTAMP (out_buf) = self->cur_ts;
-
-
-            if (list == NULL)
-              list = gst_buffer_list_new ();
-            gst_buffer_list_add (list, out_buf);
-          } else {
-            gst_adapter_unmap (self->adapter);
-            gst_adapter_flush (self->adapter, self->cur_packet_size);
-          }
-        }
-
-        self->cur_packet_size = -1;
-      } else {
-        guint32 ts_sec;
-        guint32 ts_usec;
-        guint32 incl_len;
+  flow = gst_pcap_parse_get_flow (self, &key);
 
-        if (avail < 16)
-          break;
+  if (self->indexing) {
+    GstPcapParseIndexEntry entry;
 
-        data = gst_adapter_map (self->adapter, 16);
+    entry.offset = offset;
+    entry.ts = ts;
+    g_array_append_val (flow->index, entry);
 
-        ts_sec = gst_pcap_parse_read_uint32 (self, data + 0);
-        ts_usec = gst_pcap_parse_read_uint32 (self, data + 4);
-        incl_len = gst_pcap_parse_read_uint32 (self, data + 8);
-        /* orig_len = gst_pcap_parse_read_uint32 (self, data + 12); */
+    if (GST_CLOCK_TIME_IS_VALID (ts)) {
+      if (!GST_CLOCK_TIME_IS_VALID (self->index_min_ts)
+          || ts < self->index_min_ts)
+        self->index_min_ts = ts;
+      if (!GST_CLOCK_TIME_IS_VALID (self->index_max_ts)
+          || ts > self->index_max_ts)
+        self->index_max_ts = ts;
+    }
+    return GST_FLOW_OK;
+  }
 
-        gst_adapter_unmap (self->adapter);
-        gst_adapter_flush (self->adapter, 16);
+  ts = gst_pcap_parse_output_time (self, ts);
+
+  if (self->random_access && GST_CLOCK_TIME_IS_VALID (ts)) {
+    /* the index gets us to the first packet of the flow that starts the
+     * segment, other flows may have earlier packets in between */
+    if (ts < self->segment.start)
+      return GST_FLOW_OK;
+    if (GST_CLOCK_TIME_IS_VALID (self->segment.stop)
+        && ts > self->segment.stop) {
+      self->reached_stop = TRUE;
+      return GST_FLOW_OK;
+    }
+  }
 
-        self->cur_ts = ts_sec * GST_SECOND + ts_usec * GST_USECOND;
-        self->cur_packet_size = incl_len;
-      }
-    } else {
-      guint32 magic;
-      guint32 linktype;
-      guint16 major_version;
+  /* the payload shares the memory of the record; when the record was
+   * assembled from several input buffers the adapter merged it into a
+   * single memory, so the RTP header is always in the first memory */
+  out_buf = gst_buffer_copy_region (record, GST_BUFFER_COPY_MEMORY,
+      data_offset + payload_offset, payload_size);
+  GST_BUFFER_TIMESTAMP (out_buf) = ts;
+
+  if (!self->segment_set) {
+    gst_segment_init (&self->segment, GST_FORMAT_TIME);
+    if (GST_CLOCK_TIME_IS_VALID (ts))
+      self->segment.start = self->segment.time = ts;
+    self->segment_set = TRUE;
+  }
 
-      if (avail < 24)
-        break;
+  if (self->split_flows) {
+    if (flow->pending == NULL)
+      flow->pending = gst_buffer_list_new ();
+    gst_buffer_list_add (flow->pending, out_buf);
+  } else {
+    if (self->pending == NULL)
+      self->pending = gst_buffer_list_new ();
+    gst_buffer_list_add (self->pending, out_buf);
+  }
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_pcap_parse_read_pcap_header (GstPcapParse * self, const guint8 * data)
+{
+  GstPcapParseInterface iface;
+  guint32 magic;
+  guint32 linktype;
+  guint16 major_version;
+
+  magic = *((guint32 *) data);
+  major_version = *((guint16 *) (data + 4));
+
+  iface.ts_rate = G_USEC_PER_SEC;
+  if (magic == PCAP_MAGIC || magic == PCAP_MAGIC_NS) {
+    self->swap_endian = FALSE;
+  } else if (magic == PCAP_MAGIC_SWAPPED || magic == PCAP_MAGIC_NS_SWAPPED) {
+    self->swap_endian = TRUE;
+    major_version = major_version << 8 | major_version >> 8;
+  } else {
+    GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
+        ("File is not a libpcap file, magic is %X", magic));
+    return FALSE;
+  }
+  if (magic == PCAP_MAGIC_NS || magic == PCAP_MAGIC_NS_SWAPPED)
+    iface.ts_rate = GST_SECOND;
+
+  linktype = gst_pcap_parse_read_uint32 (self, data + 20);
 
-      data = gst_adapter_map (self->adapter, 24);
+  if (major_version != 2) {
+    GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
+        ("File is not a libpcap major version 2, but %u", major_version));
+    return FALSE;
+  }
 
-      magic = *((guint32 *) data);
-      major_version = *((guint16 *) (data + 4));
-      linktype = gst_pcap_parse_read_uint32 (self, data + 20);
-      gst_adapter_unmap (self->adapter);
+  if (linktype != LINKTYPE_ETHER && linktype != LINKTYPE_SLL &&
+      linktype != LINKTYPE_RAW) {
+    GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
+        ("Only dumps of type Ethernet, raw IP or Linux Cooked (SLL) "
+            "understood; type %d unknown", linktype));
+    return FALSE;
+  }
 
-      if (magic == 0xa1b2c3d4) {
-        self->swap_endian = FALSE;
-      } else if (magic == 0xd4c3b2a1) {
-        self->swap_endian = TRUE;
-        major_version = major_version << 8 | major_version >> 8;
+  GST_DEBUG_OBJECT (self, "linktype %u", linktype);
+  iface.linktype = linktype;
+
+  g_array_set_size (self->interfaces, 0);
+  g_array_append_val (self->interfaces, iface);
+  self->if_base = 0;
+  self->pcapng = FALSE;
+
+  return TRUE;
+}
+
+/* returns the total size of the record starting with @data, which has at
+ * least PCAP_PARSE_PEEK_LEN bytes, or 0 if the capture is corrupt */
+static guint
+gst_pcap_parse_record_size (GstPcapParse * self, const guint8 * data)
+{
+  guint32 magic, size;
+  gboolean swap = self->swap_endian;
+
+  magic = *((guint32 *) data);
+
+  if (!self->initialized && magic != PCAPNG_BLOCK_SHB) {
+    /* the classic header is validated when it is handled */
+    return PCAP_HEADER_LEN;
+  } else if (!self->pcapng && self->initialized) {
+    size = PCAP_RECORD_LEN + gst_pcap_parse_read_uint32 (self, data + 8);
+    if (size < PCAP_RECORD_LEN)
+      goto invalid;
+  } else {
+    /* every section may use its own byte order */
+    if (magic == PCAPNG_BLOCK_SHB) {
+      guint32 byte_order = *((guint32 *) (data + 8));
+
+      if (byte_order == PCAPNG_BYTE_ORDER)
+        swap = FALSE;
+      else if (byte_order == GUINT32_SWAP_LE_BE (PCAPNG_BYTE_ORDER))
+        swap = TRUE;
+      else
+        goto invalid;
+    }
+    size = gst_pcap_parse_swap_uint32 (data + 4, swap);
+    if (size < 12 || (size & 3) != 0)
+      goto invalid;
+  }
+
+  if (size > PCAP_PARSE_MAX_RECORD_LEN)
+    goto invalid;
+
+  return size;
+
+invalid:
+  {
+    GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+        ("Invalid record at offset %" G_GUINT64_FORMAT, self->cur_offset));
+    return 0;
+  }
+}
+
+static guint64
+gst_pcap_parse_read_ts_rate (GstPcapParse * self, const guint8 * opt,
+    guint size)
+{
+  guint64 rate = G_USEC_PER_SEC;
+
+  while (size >= 4) {
+    guint16 code = gst_pcap_parse_read_uint16 (self, opt);
+    guint16 len = gst_pcap_parse_read_uint16 (self, opt + 2);
+    guint padded = (len + 3) & ~3;
+
+    if (code == 0 || 4 + padded > size)
+      break;
+
+    if (code == PCAPNG_OPT_IF_TSRESOL && len >= 1) {
+      guint8 v = opt[4];
+
+      /* negative power of 2 if the high bit is set, of 10 otherwise */
+      if (v & 0x80) {
+        rate = G_GUINT64_CONSTANT (1) << MIN (v & 0x7f, 63);
       } else {
-        GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
-            ("File is not a libpcap file, magic is %X", magic));
-        ret = GST_FLOW_ERROR;
-        goto out;
+        rate = 1;
+        v = MIN (v, 19);
+        while (v--)
+          rate *= 10;
       }
+    }
+
+    opt += 4 + padded;
+    size -= 4 + padded;
+  }
+
+  return rate;
+}
+
+static void
+gst_pcap_parse_seek_section (GstPcapParse * self, guint64 offset)
+{
+  guint i;
+
+  for (i = 0; i < self->sections->len; i++) {
+    GstPcapParseSection *section =
+        &g_array_index (self->sections, GstPcapParseSection, i);
+
+    if (section->offset > offset)
+      break;
+
+    self->if_base = section->if_base;
+    self->swap_endian = section->swap_endian;
+  }
+}
 
-      if (major_version != 2) {
+static GstFlowReturn
+gst_pcap_parse_handle_block (GstPcapParse * self, GstBuffer * record,
+    const guint8 * data, guint size, guint64 offset)
+{
+  guint32 type;
+
+  /* every block ends with a copy of its length */
+  type = gst_pcap_parse_read_uint32 (self, data);
+  size -= 4;
+
+  switch (type) {
+    case PCAPNG_BLOCK_SHB:
+    {
+      guint16 major_version;
+
+      if (size < 16)
+        goto invalid;
+
+      self->swap_endian = *((guint32 *) (data + 8)) != PCAPNG_BYTE_ORDER;
+      major_version = gst_pcap_parse_read_uint16 (self, data + 12);
+      if (major_version != 1) {
         GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
-            ("File is not a libpcap major version 2, but %u", major_version));
-        ret = GST_FLOW_ERROR;
-        goto out;
+            ("File is not a pcapng major version 1, but %u", major_version));
+        return GST_FLOW_ERROR;
       }
 
-      if (linktype != LINKTYPE_ETHER && linktype != LINKTYPE_SLL &&
-          linktype != LINKTYPE_RAW) {
-        GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
-            ("Only dumps of type Ethernet, raw IP or Linux Cooked (SLL) "
-                "understood; type %d unknown", linktype));
-        ret = GST_FLOW_ERROR;
-        goto out;
+      /* once indexed, the interfaces of all sections are known already */
+      if (self->random_access && !self->indexing) {
+        gst_pcap_parse_seek_section (self, offset);
+      } else {
+        GstPcapParseSection section;
+
+        self->if_base = self->interfaces->len;
+        section.offset = offset;
+        section.if_base = self->if_base;
+        section.swap_endian = self->swap_endian;
+        g_array_append_val (self->sections, section);
       }
 
-      GST_DEBUG_OBJECT (self, "linktype %u", linktype);
-      self->linktype = linktype;
+      GST_DEBUG_OBJECT (self, "pcapng section at offset %" G_GUINT64_FORMAT
+          ", swap endian %d", offset, self->swap_endian);
+      self->pcapng = TRUE;
+      break;
+    }
+    case PCAPNG_BLOCK_IDB:
+    {
+      GstPcapParseInterface iface;
+
+      if (size < 16)
+        goto invalid;
+
+      if (self->random_access && !self->indexing)
+        break;
+
+      iface.linktype = gst_pcap_parse_read_uint16 (self, data + 8);
+      iface.ts_rate =
+          gst_pcap_parse_read_ts_rate (self, data + 16, size - 16);
 
-      gst_adapter_flush (self->adapter, 24);
-      self->initialized = TRUE;
+      GST_DEBUG_OBJECT (self, "interface %u linktype %u, %" G_GUINT64_FORMAT
+          " timestamp units per second", self->interfaces->len - self->if_base,
+          iface.linktype, iface.ts_rate);
+      if (iface.linktype != LINKTYPE_ETHER && iface.linktype != LINKTYPE_SLL &&
+          iface.linktype != LINKTYPE_RAW)
+        GST_WARNING_OBJECT (self, "ignoring interface with linktype %u",
+            iface.linktype);
+
+      g_array_append_val (self->interfaces, iface);
+      break;
     }
-  }
+    case PCAPNG_BLOCK_EPB:
+    case PCAPNG_BLOCK_PB:
+    {
+      GstPcapParseInterface *iface;
+      guint32 interface_id, captured_len;
+      guint64 ticks;
+      GstClockTime ts = GST_CLOCK_TIME_NONE;
+
+      if (size < 28)
+        goto invalid;
+
+      if (type == PCAPNG_BLOCK_EPB)
+        interface_id = gst_pcap_parse_read_uint32 (self, data + 8);
+      else
+        interface_id = gst_pcap_parse_read_uint16 (self, data + 8);
+      ticks = ((guint64) gst_pcap_parse_read_uint32 (self, data + 12) << 32) |
+          gst_pcap_parse_read_uint32 (self, data + 16);
+      captured_len = gst_pcap_parse_read_uint32 (self, data + 20);
+      if (captured_len > size - 28)
+        goto invalid;
+
+      if (self->if_base + interface_id < self->interfaces->len) {
+        iface = &g_array_index (self->interfaces, GstPcapParseInterface,
+            self->if_base + interface_id);
+        ts = gst_util_uint64_scale (ticks, GST_SECOND, iface->ts_rate);
+      }
 
-  if (list) {
-    if (!self->newsegment_sent && GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
-      GstSegment segment;
+      return gst_pcap_parse_handle_packet (self, interface_id, ts, record,
+          data, 28, captured_len, offset);
+    }
+    case PCAPNG_BLOCK_SPB:
+    {
+      guint32 captured_len;
+
+      if (size < 12)
+        goto invalid;
 
-      if (self->caps)
-        gst_pad_set_caps (self->src_pad, self->caps);
-      gst_segment_init (&segment, GST_FORMAT_TIME);
-      segment.start = self->cur_ts;
-      gst_pad_push_event (self->src_pad, gst_event_new_segment (&segment));
-      self->newsegment_sent = TRUE;
+      /* no timestamp, always from the first interface */
+      captured_len = MIN (gst_pcap_parse_read_uint32 (self, data + 8),
+          size - 12);
+
+      return gst_pcap_parse_handle_packet (self, 0, GST_CLOCK_TIME_NONE,
+          record, data, 12, captured_len, offset);
     }
+    default:
+      GST_LOG_OBJECT (self, "skipping block of type 0x%08x", type);
+      break;
+  }
+
+  return GST_FLOW_OK;
+
+invalid:
+  {
+    GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+        ("Invalid pcapng block of type 0x%08x at offset %" G_GUINT64_FORMAT,
+            type, offset));
+    return GST_FLOW_ERROR;
+  }
+}
+
+/* handles one complete record (file header, packet or pcapng block) that
+ * starts at @offset in the capture */
+static GstFlowReturn
+gst_pcap_parse_handle_record (GstPcapParse * self, GstBuffer * record,
+    guint64 offset)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstMapInfo map;
+
+  gst_buffer_map (record, &map, GST_MAP_READ);
+
+  if (!self->initialized && *((guint32 *) map.data) != PCAPNG_BLOCK_SHB) {
+    if (!gst_pcap_parse_read_pcap_header (self, map.data))
+      ret = GST_FLOW_ERROR;
+  } else if (!self->pcapng && self->initialized) {
+    guint32 ts_sec;
+    guint32 ts_usec;
+    guint32 incl_len;
+    GstClockTime ts;
+
+    ts_sec = gst_pcap_parse_read_uint32 (self, map.data + 0);
+    ts_usec = gst_pcap_parse_read_uint32 (self, map.data + 4);
+    incl_len = gst_pcap_parse_read_uint32 (self, map.data + 8);
+    /* orig_len = gst_pcap_parse_read_uint32 (self, map.data + 12); */
+
+    ts = ts_sec * GST_SECOND + gst_util_uint64_scale_int (ts_usec,
+        GST_SECOND, g_array_index (self->interfaces, GstPcapParseInterface,
+            0).ts_rate);
+
+    if (incl_len > 0)
+      ret = gst_pcap_parse_handle_packet (self, 0, ts, record, map.data,
+          PCAP_RECORD_LEN, incl_len, offset);
+  } else {
+    ret = gst_pcap_parse_handle_block (self, record, map.data, map.size,
+        offset);
+  }
+
+  gst_buffer_unmap (record, &map);
+
+  if (ret == GST_FLOW_OK)
+    self->initialized = TRUE;
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_pcap_parse_push_list (GstPcapParse * self, GstPad * pad,
+    GstBufferList * list, gboolean * newsegment_sent)
+{
+  GstBuffer *first = gst_buffer_list_get (list, 0);
+
+  if (!*newsegment_sent) {
+    GstSegment segment;
 
-    ret = gst_pad_push_list (self->src_pad, list);
-    list = NULL;
+    if (self->caps)
+      gst_pad_set_caps (pad, self->caps);
+
+    /* all pads share the segment so that the flows stay in sync */
+    gst_segment_copy_into (&self->segment, &segment);
+    gst_pad_push_event (pad, gst_event_new_segment (&segment));
+    *newsegment_sent = TRUE;
+  }
+
+  if (GST_BUFFER_TIMESTAMP_IS_VALID (first))
+    self->segment.position = GST_BUFFER_TIMESTAMP (first);
+
+  return gst_pad_push_list (pad, list);
+}
+
+/* pushes the payloads collected so far on their pads */
+static GstFlowReturn
+gst_pcap_parse_push_pending (GstPcapParse * self)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i;
+
+  if (self->pending) {
+    ret = gst_pcap_parse_push_list (self, self->src_pad, self->pending,
+        &self->newsegment_sent);
+    self->pending = NULL;
+  }
+
+  for (i = 0; i < self->flows->len; i++) {
+    GstPcapParseFlow *flow = g_ptr_array_index (self->flows, i);
+    GstFlowReturn flow_ret;
+
+    if (flow->pending == NULL)
+      continue;
+
+    flow_ret = gst_pcap_parse_push_list (self, flow->pad, flow->pending,
+        &flow->newsegment_sent);
+    flow->pending = NULL;
+
+    ret = gst_flow_combiner_update_flow (self->flowcombiner, flow_ret);
   }
 
-out:
+  return ret;
+}
+
+static void
+gst_pcap_parse_push_event (GstPcapParse * self, GstEvent * event)
+{
+  guint i;
+
+  for (i = 0; i < self->flows->len; i++) {
+    GstPcapParseFlow *flow = g_ptr_array_index (self->flows, i);
+
+    if (flow->pad)
+      gst_pad_push_event (flow->pad, gst_event_ref (event));
+  }
+
+  gst_pad_push_event (self->src_pad, event);
+}
+
+static GstFlowReturn
+gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (parent);
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  gst_adapter_push (self->adapter, buffer);
+
+  while (ret == GST_FLOW_OK) {
+    guint8 peek[PCAP_PARSE_PEEK_LEN];
+    GstBuffer *record;
+    guint avail, size;
+
+    avail = gst_adapter_available (self->adapter);
+    if (avail < PCAP_PARSE_PEEK_LEN)
+      break;
+
+    gst_adapter_copy (self->adapter, peek, 0, PCAP_PARSE_PEEK_LEN);
+    size = gst_pcap_parse_record_size (self, peek);
+    if (size == 0) {
+      ret = GST_FLOW_ERROR;
+      break;
+    }
+    if (avail < size)
+      break;
 
-  if (list)
-    gst_buffer_list_unref (list);
+    /* we don't use _take_buffer_fast() on purpose here, we need a
+     * buffer with a single memory, since the RTP depayloaders expect
+     * the complete RTP header to be in the first memory if there are
+     * multiple ones and we can't guarantee that with _fast(). Records that
+     * are inside one input buffer are not copied. */
+    record = gst_adapter_take_buffer (self->adapter, size);
+    ret = gst_pcap_parse_handle_record (self, record, self->cur_offset);
+    gst_buffer_unref (record);
+
+    self->cur_offset += size;
+  }
+
+  if (ret == GST_FLOW_OK)
+    ret = gst_pcap_parse_push_pending (self);
 
   if (ret != GST_FLOW_OK)
     gst_pcap_parse_reset (self);
@@ -618,12 +1261,445 @@ gst_pcap_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_SEGMENT:
+    case GST_EVENT_CAPS:
       /* Drop it, we'll replace it with our own */
       gst_event_unref (event);
       break;
-    default:
+    case GST_EVENT_STREAM_START:
+      /* the flow pads have their own streams */
       ret = gst_pad_push_event (self->src_pad, event);
       break;
+    case GST_EVENT_EOS:
+      if (self->split_flows)
+        gst_element_no_more_pads (GST_ELEMENT_CAST (self));
+      gst_pcap_parse_push_event (self, event);
+      break;
+    default:
+      gst_pcap_parse_push_event (self, event);
+      break;
+  }
+
+  return ret;
+}
+
+/* makes sure that @size bytes at @offset are in the pull cache */
+static GstFlowReturn
+gst_pcap_parse_pull_range (GstPcapParse * self, guint64 offset, guint size)
+{
+  GstBuffer *chunk = NULL;
+  GstFlowReturn ret;
+
+  if (self->pull_cache && offset >= self->pull_cache_offset &&
+      offset + size <= self->pull_cache_offset +
+      gst_buffer_get_size (self->pull_cache))
+    return GST_FLOW_OK;
+
+  gst_buffer_replace (&self->pull_cache, NULL);
+
+  ret = gst_pad_pull_range (self->sink_pad, offset,
+      MAX (size, PCAP_PARSE_PULL_CHUNK_LEN), &chunk);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  self->pull_cache = chunk;
+  self->pull_cache_offset = offset;
+
+  /* short read, the capture ends with a truncated record */
+  if (gst_buffer_get_size (chunk) < size)
+    return GST_FLOW_EOS;
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_pcap_parse_pull_record (GstPcapParse * self)
+{
+  guint8 peek[PCAP_PARSE_PEEK_LEN];
+  GstBuffer *record;
+  GstFlowReturn ret;
+  guint size;
+
+  ret = gst_pcap_parse_pull_range (self, self->cur_offset,
+      PCAP_PARSE_PEEK_LEN);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  gst_buffer_extract (self->pull_cache,
+      self->cur_offset - self->pull_cache_offset, peek, PCAP_PARSE_PEEK_LEN);
+  size = gst_pcap_parse_record_size (self, peek);
+  if (size == 0)
+    return GST_FLOW_ERROR;
+
+  ret = gst_pcap_parse_pull_range (self, self->cur_offset, size);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  record = gst_buffer_copy_region (self->pull_cache, GST_BUFFER_COPY_MEMORY,
+      self->cur_offset - self->pull_cache_offset, size);
+  ret = gst_pcap_parse_handle_record (self, record, self->cur_offset);
+  gst_buffer_unref (record);
+
+  self->cur_offset += size;
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_pcap_parse_finish_index (GstPcapParse * self)
+{
+  guint i;
+
+  GST_DEBUG_OBJECT (self, "indexed %u flows, capture time %" GST_TIME_FORMAT
+      " - %" GST_TIME_FORMAT, self->flows->len,
+      GST_TIME_ARGS (self->index_min_ts), GST_TIME_ARGS (self->index_max_ts));
+
+  self->indexing = FALSE;
+  self->base_ts = self->index_min_ts;
+  self->duration = gst_pcap_parse_output_time (self, self->index_max_ts);
+
+  gst_segment_init (&self->segment, GST_FORMAT_TIME);
+  if (GST_CLOCK_TIME_IS_VALID (self->base_ts))
+    self->segment.start = self->segment.time = self->segment.position =
+        gst_pcap_parse_output_time (self, self->base_ts);
+  self->segment.duration = self->duration;
+  self->segment_set = TRUE;
+
+  if (self->split_flows) {
+    for (i = 0; i < self->flows->len; i++)
+      gst_pcap_parse_add_flow_pad (self, g_ptr_array_index (self->flows, i));
+    gst_element_no_more_pads (GST_ELEMENT_CAST (self));
+  }
+
+  /* and now parse the capture again from the first packet, the header
+   * was parsed already; pcapng section headers are handled again to get
+   * the byte order and interfaces of their sections */
+  self->cur_offset = self->pcapng ? 0 : PCAP_HEADER_LEN;
+
+  return self->flows->len > 0 ? GST_FLOW_OK : GST_FLOW_EOS;
+}
+
+static void
+gst_pcap_parse_loop (GstPad * pad)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (GST_PAD_PARENT (pad));
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i;
+
+  if (self->need_stream_start) {
+    gchar *stream_id;
+
+    stream_id = gst_pad_create_stream_id (self->src_pad,
+        GST_ELEMENT_CAST (self), NULL);
+    gst_pad_push_event (self->src_pad, gst_event_new_stream_start (stream_id));
+    g_free (stream_id);
+    self->need_stream_start = FALSE;
+  }
+
+  for (i = 0; i < PCAP_PARSE_RECORDS_PER_LOOP && ret == GST_FLOW_OK; i++)
+    ret = gst_pcap_parse_pull_record (self);
+
+  if (self->indexing) {
+    if (ret == GST_FLOW_EOS)
+      ret = gst_pcap_parse_finish_index (self);
+  } else {
+    GstFlowReturn push_ret = gst_pcap_parse_push_pending (self);
+
+    if (ret == GST_FLOW_OK && self->reached_stop)
+      ret = GST_FLOW_EOS;
+    if (push_ret != GST_FLOW_OK)
+      ret = push_ret;
+  }
+
+  if (ret != GST_FLOW_OK)
+    goto pause;
+
+  return;
+
+pause:
+  {
+    const gchar *reason = gst_flow_get_name (ret);
+
+    GST_DEBUG_OBJECT (self, "pausing task, reason %s", reason);
+    gst_pad_pause_task (pad);
+
+    if (ret == GST_FLOW_EOS) {
+      if (self->segment.flags & GST_SEGMENT_FLAG_SEGMENT) {
+        gint64 stop = self->segment.stop;
+
+        if (stop == -1)
+          stop = self->segment.duration;
+        gst_element_post_message (GST_ELEMENT_CAST (self),
+            gst_message_new_segment_done (GST_OBJECT_CAST (self),
+                GST_FORMAT_TIME, stop));
+        gst_pcap_parse_push_event (self,
+            gst_event_new_segment_done (GST_FORMAT_TIME, stop));
+      } else {
+        gst_pcap_parse_push_event (self, gst_event_new_eos ());
+      }
+    } else if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS) {
+      /* for fatal errors we post an error message, post the error
+       * first so the app knows about the error first. */
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          ("Internal data flow error."),
+          ("streaming task paused, reason %s (%d)", reason, ret));
+      gst_pcap_parse_push_event (self, gst_event_new_eos ());
+    }
+  }
+}
+
+/* finds the offset of the first record of any flow at or after @position */
+static guint64
+gst_pcap_parse_index_lookup (GstPcapParse * self, GstClockTime position)
+{
+  GstClockTime ts = gst_pcap_parse_capture_time (self, position);
+  guint64 offset = G_MAXUINT64;
+  guint i;
+
+  /* this assumes that the packets of a flow were captured in order */
+  for (i = 0; i < self->flows->len; i++) {
+    GstPcapParseFlow *flow = g_ptr_array_index (self->flows, i);
+    GstPcapParseIndexEntry *entries = (GstPcapParseIndexEntry *)
+        flow->index->data;
+    guint lo = 0, hi = flow->index->len;
+
+    while (lo < hi) {
+      guint mid = lo + (hi - lo) / 2;
+
+      if (entries[mid].ts < ts)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo < flow->index->len)
+      offset = MIN (offset, entries[lo].offset);
+  }
+
+  return offset;
+}
+
+static gboolean
+gst_pcap_parse_perform_seek (GstPcapParse * self, GstEvent * event)
+{
+  gdouble rate;
+  GstFormat format;
+  GstSeekFlags flags;
+  GstSeekType start_type, stop_type;
+  gint64 start, stop;
+  GstSegment seeksegment;
+  gboolean flush;
+  guint32 seqnum;
+  guint i;
+
+  if (!self->random_access || self->indexing) {
+    GST_DEBUG_OBJECT (self, "can only seek in pull mode once indexed");
+    return FALSE;
+  }
+
+  gst_event_parse_seek (event, &rate, &format, &flags, &start_type, &start,
+      &stop_type, &stop);
+  seqnum = gst_event_get_seqnum (event);
+
+  if (format != GST_FORMAT_TIME || rate <= 0.0) {
+    GST_DEBUG_OBJECT (self, "only forward seeks in time are supported");
+    return FALSE;
+  }
+
+  flush = ! !(flags & GST_SEEK_FLAG_FLUSH);
+
+  if (flush) {
+    GstEvent *fevent = gst_event_new_flush_start ();
+
+    gst_event_set_seqnum (fevent, seqnum);
+    gst_pcap_parse_push_event (self, fevent);
+  } else {
+    gst_pad_pause_task (self->sink_pad);
+  }
+
+  GST_PAD_STREAM_LOCK (self->sink_pad);
+
+  gst_segment_copy_into (&self->segment, &seeksegment);
+  gst_segment_do_seek (&seeksegment, rate, format, flags, start_type, start,
+      stop_type, stop, NULL);
+
+  if (flush) {
+    GstEvent *fevent = gst_event_new_flush_stop (TRUE);
+
+    gst_event_set_seqnum (fevent, seqnum);
+    gst_pcap_parse_push_event (self, fevent);
+    gst_flow_combiner_reset (self->flowcombiner);
+  }
+
+  self->cur_offset = gst_pcap_parse_index_lookup (self, seeksegment.position);
+  gst_pcap_parse_seek_section (self, self->cur_offset);
+  gst_buffer_replace (&self->pull_cache, NULL);
+
+  GST_DEBUG_OBJECT (self, "seeking to %" GST_TIME_FORMAT ", offset %"
+      G_GUINT64_FORMAT, GST_TIME_ARGS (seeksegment.position), self->cur_offset);
+
+  GST_OBJECT_LOCK (self);
+  gst_segment_copy_into (&seeksegment, &self->segment);
+  GST_OBJECT_UNLOCK (self);
+
+  if (seeksegment.flags & GST_SEGMENT_FLAG_SEGMENT) {
+    GstMessage *message;
+
+    message = gst_message_new_segment_start (GST_OBJECT (self),
+        seeksegment.format, seeksegment.position);
+    gst_message_set_seqnum (message, seqnum);
+    gst_element_post_message (GST_ELEMENT (self), message);
+  }
+
+  self->reached_stop = FALSE;
+  self->newsegment_sent = FALSE;
+  for (i = 0; i < self->flows->len; i++)
+    ((GstPcapParseFlow *) g_ptr_array_index (self->flows, i))->newsegment_sent =
+        FALSE;
+
+  gst_pad_start_task (self->sink_pad, (GstTaskFunction) gst_pcap_parse_loop,
+      self->sink_pad, NULL);
+
+  GST_PAD_STREAM_UNLOCK (self->sink_pad);
+
+  return TRUE;
+}
+
+static gboolean
+gst_pcap_parse_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (parent);
+  gboolean res;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_SEEK:
+      if (self->random_access) {
+        res = gst_pcap_parse_perform_seek (self, event);
+        gst_event_unref (event);
+      } else {
+        res = gst_pad_event_default (pad, parent, event);
+      }
+      break;
+    default:
+      res = gst_pad_event_default (pad, parent, event);
+      break;
+  }
+
+  return res;
+}
+
+static gboolean
+gst_pcap_parse_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (parent);
+  gboolean indexed = self->random_access && !self->indexing;
+  GstFormat format;
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_DURATION:
+      gst_query_parse_duration (query, &format, NULL);
+      if (format != GST_FORMAT_TIME || !indexed ||
+          !GST_CLOCK_TIME_IS_VALID (self->duration))
+        break;
+      gst_query_set_duration (query, GST_FORMAT_TIME, self->duration);
+      return TRUE;
+    case GST_QUERY_POSITION:
+      gst_query_parse_position (query, &format, NULL);
+      if (format != GST_FORMAT_TIME || !indexed)
+        break;
+      GST_OBJECT_LOCK (self);
+      gst_query_set_position (query, GST_FORMAT_TIME, self->segment.position);
+      GST_OBJECT_UNLOCK (self);
+      return TRUE;
+    case GST_QUERY_SEEKING:
+      gst_query_parse_seeking (query, &format, NULL, NULL, NULL);
+      if (format != GST_FORMAT_TIME || !self->random_access)
+        break;
+      gst_query_set_seeking (query, GST_FORMAT_TIME, indexed, 0,
+          indexed ? self->duration : -1);
+      return TRUE;
+    default:
+      break;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static gboolean
+gst_pcap_parse_sink_activate (GstPad * sinkpad, GstObject * parent)
+{
+  GstQuery *query;
+  gboolean pull_mode;
+
+  query = gst_query_new_scheduling ();
+
+  if (!gst_pad_peer_query (sinkpad, query)) {
+    gst_query_unref (query);
+    goto activate_push;
+  }
+
+  pull_mode = gst_query_has_scheduling_mode_with_flags (query,
+      GST_PAD_MODE_PULL, GST_SCHEDULING_FLAG_SEEKABLE);
+  gst_query_unref (query);
+
+  if (!pull_mode)
+    goto activate_push;
+
+  GST_DEBUG_OBJECT (sinkpad, "activating pull");
+  return gst_pad_activate_mode (sinkpad, GST_PAD_MODE_PULL, TRUE);
+
+activate_push:
+  {
+    GST_DEBUG_OBJECT (sinkpad, "activating push");
+    return gst_pad_activate_mode (sinkpad, GST_PAD_MODE_PUSH, TRUE);
+  }
+}
+
+static gboolean
+gst_pcap_parse_sink_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (parent);
+  gboolean res;
+
+  switch (mode) {
+    case GST_PAD_MODE_PUSH:
+      self->random_access = FALSE;
+      res = TRUE;
+      break;
+    case GST_PAD_MODE_PULL:
+      if (active) {
+        self->random_access = TRUE;
+        self->indexing = TRUE;
+        self->need_stream_start = TRUE;
+        res = gst_pad_start_task (pad, (GstTaskFunction) gst_pcap_parse_loop,
+            pad, NULL);
+      } else {
+        res = gst_pad_stop_task (pad);
+      }
+      break;
+    default:
+      res = FALSE;
+      break;
+  }
+
+  return res;
+}
+
+static GstStateChangeReturn
+gst_pcap_parse_change_state (GstElement * element, GstStateChange transition)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_pcap_parse_reset (self);
+      gst_pcap_parse_clear_flows (self, TRUE);
+      gst_flow_combiner_reset (self->flowcombiner);
+      break;
+    default:
+      break;
   }
 
   return ret;
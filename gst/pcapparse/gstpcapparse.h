@@ -22,6 +22,7 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
+#include <gst/base/gstflowcombiner.h>
 
 G_BEGIN_DECLS
 
@@ -52,6 +53,60 @@ typedef enum
   LINKTYPE_SLL = 113
 } GstPcapParseLinktype;
 
+typedef struct _GstPcapParseInterface GstPcapParseInterface;
+typedef struct _GstPcapParseSection GstPcapParseSection;
+typedef struct _GstPcapParseFlowKey GstPcapParseFlowKey;
+typedef struct _GstPcapParseFlow GstPcapParseFlow;
+typedef struct _GstPcapParseIndexEntry GstPcapParseIndexEntry;
+
+/* a capture interface; classic pcap files have exactly one */
+struct _GstPcapParseInterface
+{
+  GstPcapParseLinktype linktype;
+  /* timestamp units per second */
+  guint64 ts_rate;
+};
+
+/* a pcapng section, remembered so that we can restore the interfaces and
+ * byte order after seeking into the middle of it */
+struct _GstPcapParseSection
+{
+  guint64 offset;
+  guint if_base;
+  gboolean swap_endian;
+};
+
+struct _GstPcapParseFlowKey
+{
+  guint32 src_ip;
+  guint32 dst_ip;
+  guint16 src_port;
+  guint16 dst_port;
+  guint8 protocol;
+};
+
+struct _GstPcapParseIndexEntry
+{
+  /* offset of the record in the capture */
+  guint64 offset;
+  /* capture time of the packet */
+  GstClockTime ts;
+};
+
+struct _GstPcapParseFlow
+{
+  GstPcapParseFlowKey key;
+  guint id;
+
+  /* our own src pad when splitting flows */
+  GstPad *pad;
+  gboolean newsegment_sent;
+  GstBufferList *pending;
+
+  /* GstPcapParseIndexEntry, only built in pull mode */
+  GArray *index;
+};
+
 /**
  * GstPcapParse:
  *
@@ -73,17 +128,42 @@ struct _GstPcapParse
   gint32 dst_port;
   GstCaps *caps;
   gint64 offset;
+  gboolean split_flows;
 
   /* state */
   GstAdapter * adapter;
   gboolean initialized;
+  gboolean pcapng;
   gboolean swap_endian;
-  gint64 cur_packet_size;
-  GstClockTime cur_ts;
+  guint64 cur_offset;
   GstClockTime base_ts;
-  GstPcapParseLinktype linktype;
 
+  /* GstPcapParseInterface of all sections, indexed from if_base */
+  GArray *interfaces;
+  guint if_base;
+  GArray *sections;
+
+  /* flows that passed the filters */
+  GHashTable *flow_table;
+  GPtrArray *flows;
+  GstFlowCombiner *flowcombiner;
+
+  /* output for src_pad */
+  GstBufferList *pending;
   gboolean newsegment_sent;
+  GstSegment segment;
+  gboolean segment_set;
+
+  /* pull mode */
+  gboolean random_access;
+  gboolean indexing;
+  gboolean need_stream_start;
+  gboolean reached_stop;
+  GstBuffer *pull_cache;
+  guint64 pull_cache_offset;
+  GstClockTime index_min_ts;
+  GstClockTime index_max_ts;
+  GstClockTime duration;
 };
 
 struct _GstPcapParseClass
@@ -141,8 +141,6 @@ gst_rtp_h265_depay_class_init (GstRtpH265DepayClass * klass)
 static void
 gst_rtp_h265_depay_init (GstRtpH265Depay * rtph265depay)
 {
-  rtph265depay->adapter = gst_adapter_new ();
-  rtph265depay->picture_adapter = gst_adapter_new ();
   rtph265depay->byte_stream = DEFAULT_BYTE_STREAM;
   rtph265depay->stream_format = (gchar *) g_malloc (10);
   rtph265depay->merge = DEFAULT_ACCESS_UNIT;
@@ -154,17 +152,56 @@ gst_rtp_h265_depay_init (GstRtpH265Depay * rtph265depay)
       (GDestroyNotify) gst_buffer_unref);
 }
 
+/* NAL units and AUs are collected as lists of chunks, buffers referencing
+ * the RTP payloads, and only made into one buffer when they are output */
+static void
+gst_rtp_h265_depay_chunks_add (GstBufferList ** chunks, GstBuffer * buf)
+{
+  if (*chunks == NULL)
+    *chunks = gst_buffer_list_new ();
+  gst_buffer_list_add (*chunks, buf);
+}
+
+/* Moves the chunks of @list to the end of @chunks */
+static void
+gst_rtp_h265_depay_chunks_append (GstBufferList ** chunks,
+    GstBufferList * list)
+{
+  guint i, len;
+
+  if (*chunks == NULL) {
+    *chunks = list;
+    return;
+  }
+
+  len = gst_buffer_list_length (list);
+  for (i = 0; i < len; i++)
+    gst_buffer_list_add (*chunks, gst_buffer_ref (gst_buffer_list_get (list,
+                i)));
+  gst_buffer_list_unref (list);
+}
+
+static void
+gst_rtp_h265_depay_chunks_clear (GstBufferList ** chunks)
+{
+  if (*chunks) {
+    gst_buffer_list_unref (*chunks);
+    *chunks = NULL;
+  }
+}
+
 static void
 gst_rtp_h265_depay_reset (GstRtpH265Depay * rtph265depay)
 {
-  gst_adapter_clear (rtph265depay->adapter);
+  gst_rtp_h265_depay_chunks_clear (&rtph265depay->fragments);
   rtph265depay->wait_start = TRUE;
-  gst_adapter_clear (rtph265depay->picture_adapter);
+  gst_rtp_h265_depay_chunks_clear (&rtph265depay->picture);
   rtph265depay->picture_start = FALSE;
   rtph265depay->last_keyframe = FALSE;
   rtph265depay->last_ts = 0;
   rtph265depay->current_fu_type = 0;
   rtph265depay->new_codec_data = FALSE;
+  gst_rtp_h265_depay_chunks_clear (&rtph265depay->out_list);
   g_ptr_array_set_size (rtph265depay->vps, 0);
   g_ptr_array_set_size (rtph265depay->sps, 0);
   g_ptr_array_set_size (rtph265depay->pps, 0);
@@ -182,8 +219,9 @@ gst_rtp_h265_depay_finalize (GObject * object)
 
   g_free (rtph265depay->stream_format);
 
-  g_object_unref (rtph265depay->adapter);
-  g_object_unref (rtph265depay->picture_adapter);
+  gst_rtp_h265_depay_chunks_clear (&rtph265depay->fragments);
+  gst_rtp_h265_depay_chunks_clear (&rtph265depay->picture);
+  gst_rtp_h265_depay_chunks_clear (&rtph265depay->out_list);
 
   g_ptr_array_free (rtph265depay->vps, TRUE);
   g_ptr_array_free (rtph265depay->sps, TRUE);
@@ -804,27 +842,141 @@ incomplete_caps:
   }
 }
 
+/* Makes one buffer of @chunks, referencing their memory. A buffer holds at
+ * most gst_buffer_get_max_memory() blocks, the ones past that are copied
+ * into its last block. */
 static GstBuffer *
-gst_rtp_h265_complete_au (GstRtpH265Depay * rtph265depay,
-    GstClockTime * out_timestamp, gboolean * out_keyframe)
+gst_rtp_h265_depay_join (GstBufferList * chunks)
+{
+  GstBuffer *outbuf, *chunk;
+  GstMemory *mem, *tail = NULL;
+  GstMapInfo map, tail_map;
+  guint i, j, len, n_chunk, n_memory = 0, n_keep;
+  gsize size = 0, offset = 0;
+
+  len = gst_buffer_list_length (chunks);
+  for (i = 0; i < len; i++) {
+    chunk = gst_buffer_list_get (chunks, i);
+    n_memory += gst_buffer_n_memory (chunk);
+    size += gst_buffer_get_size (chunk);
+  }
+
+  n_keep = n_memory;
+  if (n_memory > gst_buffer_get_max_memory ())
+    n_keep = gst_buffer_get_max_memory () - 1;
+
+  outbuf = gst_buffer_new ();
+  for (i = 0; i < len; i++) {
+    chunk = gst_buffer_list_get (chunks, i);
+    n_chunk = gst_buffer_n_memory (chunk);
+
+    for (j = 0; j < n_chunk; j++) {
+      mem = gst_buffer_peek_memory (chunk, j);
+
+      if (gst_buffer_n_memory (outbuf) < n_keep) {
+        gst_buffer_append_memory (outbuf, gst_memory_ref (mem));
+        size -= mem->size;
+        continue;
+      }
+
+      /* what is left is copied into one block */
+      if (tail == NULL) {
+        tail = gst_allocator_alloc (NULL, size, NULL);
+        gst_memory_map (tail, &tail_map, GST_MAP_WRITE);
+      }
+
+      gst_memory_map (mem, &map, GST_MAP_READ);
+      memcpy (tail_map.data + offset, map.data, map.size);
+      offset += map.size;
+      gst_memory_unmap (mem, &map);
+    }
+  }
+
+  if (tail) {
+    GST_LOG ("copied %" G_GSIZE_FORMAT " bytes of %u memory blocks", size,
+        n_memory - n_keep);
+    gst_memory_unmap (tail, &tail_map);
+    gst_buffer_append_memory (outbuf, tail);
+  }
+
+  return outbuf;
+}
+
+/* Queues the NAL unit or AU made of @chunks for output, as one buffer */
+static void
+gst_rtp_h265_depay_output (GstRtpH265Depay * rtph265depay,
+    GstBufferList * chunks, GstClockTime timestamp, gboolean keyframe)
 {
-  guint outsize;
   GstBuffer *outbuf;
 
-  /* we had a picture in the adapter and we completed it */
-  GST_DEBUG_OBJECT (rtph265depay, "taking completed AU");
-  outsize = gst_adapter_available (rtph265depay->picture_adapter);
-  outbuf = gst_adapter_take_buffer (rtph265depay->picture_adapter, outsize);
+  /* prepend codec_data */
+  if (rtph265depay->codec_data) {
+    GST_DEBUG_OBJECT (rtph265depay, "prepending codec_data");
+    gst_buffer_list_insert (chunks, 0, rtph265depay->codec_data);
+    rtph265depay->codec_data = NULL;
+    keyframe = TRUE;
+  }
 
-  *out_timestamp = rtph265depay->last_ts;
-  *out_keyframe = rtph265depay->last_keyframe;
+  /* downstream takes every buffer as a whole NAL unit or AU, or finds the
+   * NAL units in them itself */
+  if (gst_buffer_list_length (chunks) > 1)
+    outbuf = gst_rtp_h265_depay_join (chunks);
+  else
+    outbuf = gst_buffer_ref (gst_buffer_list_get (chunks, 0));
+  gst_buffer_list_unref (chunks);
 
-  rtph265depay->last_keyframe = FALSE;
-  rtph265depay->picture_start = FALSE;
+  GST_BUFFER_TIMESTAMP (outbuf) = timestamp;
+
+  if (keyframe)
+    GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
+  else
+    GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  gst_rtp_h265_depay_chunks_add (&rtph265depay->out_list, outbuf);
+}
+
+/* Takes the output of the current input buffer. All but the last buffer are
+ * pushed here as one list, the last one is returned for the base class to
+ * push. */
+static GstBuffer *
+gst_rtp_h265_depay_take_output (GstRtpH265Depay * rtph265depay)
+{
+  GstBufferList *list = rtph265depay->out_list;
+  GstBuffer *outbuf;
+  guint len;
+
+  if (list == NULL)
+    return NULL;
+  rtph265depay->out_list = NULL;
+
+  len = gst_buffer_list_length (list);
+  outbuf = gst_buffer_ref (gst_buffer_list_get (list, len - 1));
+  gst_buffer_list_remove (list, len - 1, 1);
+
+  if (len > 1)
+    gst_rtp_base_depayload_push_list (GST_RTP_BASE_DEPAYLOAD (rtph265depay),
+        list);
+  else
+    gst_buffer_list_unref (list);
 
   return outbuf;
 }
 
+static void
+gst_rtp_h265_complete_au (GstRtpH265Depay * rtph265depay)
+{
+  /* we had a picture and we completed it */
+  GST_DEBUG_OBJECT (rtph265depay, "taking completed AU");
+  if (rtph265depay->picture) {
+    gst_rtp_h265_depay_output (rtph265depay, rtph265depay->picture,
+        rtph265depay->last_ts, rtph265depay->last_keyframe);
+    rtph265depay->picture = NULL;
+  }
+
+  rtph265depay->last_keyframe = FALSE;
+  rtph265depay->picture_start = FALSE;
+}
+
 /* VPS/SPS/PPS/RADL/TSA/RASL/IDR/CRA is considered key, all others DELTA;
  * so downstream waiting for keyframe can pick up at VPS/SPS/PPS/IDR */
 
@@ -849,38 +1001,44 @@ gst_rtp_h265_complete_au (GstRtpH265Depay * rtph265depay,
 
 #define NAL_TYPE_IS_KEY(nt) (NAL_TYPE_IS_PARAMETER_SET(nt) || NAL_TYPE_IS_CODED_SLICE_SEGMENT(nt))
 
-static GstBuffer *
-gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
-    GstClockTime in_timestamp, gboolean marker)
+/* Handles the NAL unit made of @nal, a list of chunks */
+static void
+gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay,
+    GstBufferList * nal, GstClockTime in_timestamp, gboolean marker)
 {
   GstRTPBaseDepayload *depayload = GST_RTP_BASE_DEPAYLOAD (rtph265depay);
   gint nal_type;
-  GstMapInfo map;
-  GstBuffer *outbuf = NULL;
-  GstClockTime out_timestamp;
-  gboolean keyframe, out_keyframe;
-
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  if (G_UNLIKELY (map.size < 5))
+  guint8 header[7];
+  gsize header_size = 0;
+  guint i, len;
+  gboolean keyframe;
+
+  /* only look at the start code, the NAL unit header and the first slice
+   * segment byte, mapping a NAL unit made of several memory blocks would
+   * merge them */
+  len = gst_buffer_list_length (nal);
+  for (i = 0; i < len && header_size < sizeof (header); i++)
+    header_size += gst_buffer_extract (gst_buffer_list_get (nal, i), 0,
+        header + header_size, sizeof (header) - header_size);
+  if (G_UNLIKELY (header_size < 5))
     goto short_nal;
 
-  nal_type = (map.data[4] >> 1) & 0x3f;
+  nal_type = (header[4] >> 1) & 0x3f;
   GST_DEBUG_OBJECT (rtph265depay, "handle NAL type %d (RTP marker bit %d)",
       nal_type, marker);
 
   keyframe = NAL_TYPE_IS_KEY (nal_type);
 
-  out_keyframe = keyframe;
-  out_timestamp = in_timestamp;
-
   if (!rtph265depay->byte_stream) {
     if (NAL_TYPE_IS_PARAMETER_SET (nal_type)) {
+      GstBuffer *buf = gst_rtp_h265_depay_join (nal);
+
       gst_rtp_h265_depay_add_vps_sps_pps (rtph265depay,
-          gst_buffer_copy_region (nal, GST_BUFFER_COPY_ALL,
-              4, gst_buffer_get_size (nal) - 4));
-      gst_buffer_unmap (nal, &map);
-      gst_buffer_unref (nal);
-      return NULL;
+          gst_buffer_copy_region (buf, GST_BUFFER_COPY_ALL,
+              4, gst_buffer_get_size (buf) - 4));
+      gst_buffer_unref (buf);
+      gst_buffer_list_unref (nal);
+      return;
     } else if (rtph265depay->sps->len == 0 || rtph265depay->pps->len == 0) {
       /* Down push down any buffer in non-bytestream mode if the SPS/PPS haven't
        * go through yet
@@ -889,9 +1047,8 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
           gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
               gst_structure_new ("GstForceKeyUnit",
                   "all-headers", G_TYPE_BOOLEAN, TRUE, NULL)));
-      gst_buffer_unmap (nal, &map);
-      gst_buffer_unref (nal);
-      return NULL;
+      gst_buffer_list_unref (nal);
+      return;
     }
 
     if (rtph265depay->new_codec_data &&
@@ -909,7 +1066,7 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
       if (NAL_TYPE_IS_CODED_SLICE_SEGMENT (nal_type)) {
         /* A NAL unit (X) ends an access unit if the next-occurring VCL NAL unit (Y) has the high-order bit of the first byte after its NAL unit header equal to 1 */
         start = TRUE;
-        if (((map.data[6] >> 7) & 0x01) == 1) {
+        if (header_size > 6 && ((header[6] >> 7) & 0x01) == 1) {
           complete = TRUE;
         }
         complete = TRUE;
@@ -922,96 +1079,98 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
       GST_DEBUG_OBJECT (depayload, "start %d, complete %d", start, complete);
 
       if (complete && rtph265depay->picture_start)
-        outbuf = gst_rtp_h265_complete_au (rtph265depay, &out_timestamp,
-            &out_keyframe);
+        gst_rtp_h265_complete_au (rtph265depay);
     }
-    /* add to adapter */
-    gst_buffer_unmap (nal, &map);
-
-    GST_DEBUG_OBJECT (depayload, "adding NAL to picture adapter");
-    gst_adapter_push (rtph265depay->picture_adapter, nal);
+    /* add to the picture, the chunks are only joined once it is complete */
+    GST_DEBUG_OBJECT (depayload, "adding NAL to picture");
+    gst_rtp_h265_depay_chunks_append (&rtph265depay->picture, nal);
     rtph265depay->last_ts = in_timestamp;
     rtph265depay->last_keyframe |= keyframe;
     rtph265depay->picture_start |= start;
 
     if (marker)
-      outbuf = gst_rtp_h265_complete_au (rtph265depay, &out_timestamp,
-          &out_keyframe);
+      gst_rtp_h265_complete_au (rtph265depay);
   } else {
     /* no merge, output is input nal */
     GST_DEBUG_OBJECT (depayload, "using NAL as output");
-    outbuf = nal;
-    gst_buffer_unmap (nal, &map);
-  }
-
-  if (outbuf) {
-    /* prepend codec_data */
-    if (rtph265depay->codec_data) {
-      GST_DEBUG_OBJECT (depayload, "prepending codec_data");
-      outbuf = gst_buffer_append (rtph265depay->codec_data, outbuf);
-      rtph265depay->codec_data = NULL;
-      out_keyframe = TRUE;
-    }
-    outbuf = gst_buffer_make_writable (outbuf);
-
-    GST_BUFFER_TIMESTAMP (outbuf) = out_timestamp;
-
-    if (out_keyframe)
-      GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
-    else
-      GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
+    gst_rtp_h265_depay_output (rtph265depay, nal, in_timestamp, keyframe);
   }
 
-  return outbuf;
+  return;
 
   /* ERRORS */
 short_nal:
   {
     GST_WARNING_OBJECT (depayload, "dropping short NAL");
-    gst_buffer_unmap (nal, &map);
-    gst_buffer_unref (nal);
-    return NULL;
+    gst_buffer_list_unref (nal);
+    return;
   }
 }
 
+/* Makes a NAL unit from @len bytes at @offset in the RTP payload, preceded
+ * by @prefix_len bytes of @prefix. The payload is referenced instead of
+ * copied, so that fragments and access units are assembled from the memory
+ * of the RTP packets. */
 static GstBuffer *
-gst_rtp_h265_push_fragmentation_unit (GstRtpH265Depay * rtph265depay,
-    gboolean send)
+gst_rtp_h265_depay_make_nal (GstRTPBuffer * rtp, const guint8 * prefix,
+    gsize prefix_len, guint offset, guint len)
 {
-  guint outsize;
-  GstMapInfo map;
-  GstBuffer *outbuf;
+  GstBuffer *nal;
 
-  outsize = gst_adapter_available (rtph265depay->adapter);
-  outbuf = gst_adapter_take_buffer (rtph265depay->adapter, outsize);
+  nal = gst_buffer_new ();
 
-  gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-  GST_DEBUG_OBJECT (rtph265depay, "output %d bytes", outsize);
+  if (prefix == sync_bytes) {
+    gst_buffer_append_memory (nal,
+        gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, (gpointer) prefix,
+            prefix_len, 0, prefix_len, NULL, NULL));
+  } else if (prefix_len > 0) {
+    GstMemory *mem;
+    GstMapInfo map;
 
-  if (rtph265depay->byte_stream) {
-    memcpy (map.data, sync_bytes, sizeof (sync_bytes));
-  } else {
-    goto not_implemented;
+    mem = gst_allocator_alloc (NULL, prefix_len, NULL);
+    gst_memory_map (mem, &map, GST_MAP_WRITE);
+    memcpy (map.data, prefix, prefix_len);
+    gst_memory_unmap (mem, &map);
+    gst_buffer_append_memory (nal, mem);
   }
-  gst_buffer_unmap (outbuf, &map);
 
+  gst_buffer_copy_into (nal, rtp->buffer, GST_BUFFER_COPY_MEMORY,
+      gst_rtp_buffer_get_header_len (rtp) + offset, len);
+
+  return nal;
+}
+
+static void
+gst_rtp_h265_push_fragmentation_unit (GstRtpH265Depay * rtph265depay)
+{
+  GstBufferList *nal;
+
+  /* the fragments are handled as the chunks of the NAL unit, they are only
+   * joined into one buffer when it is output */
+  nal = rtph265depay->fragments;
+  rtph265depay->fragments = NULL;
   rtph265depay->current_fu_type = 0;
 
-  outbuf = gst_rtp_h265_depay_handle_nal (rtph265depay, outbuf,
-      rtph265depay->fu_timestamp, rtph265depay->fu_marker);
+  if (nal == NULL)
+    return;
 
-  if (send && outbuf) {
-    gst_rtp_base_depayload_push (GST_RTP_BASE_DEPAYLOAD (rtph265depay), outbuf);
-    outbuf = NULL;
-  }
-  return outbuf;
+  GST_DEBUG_OBJECT (rtph265depay, "output %u fragments",
+      gst_buffer_list_length (nal));
+
+  /* the first fragment already starts with the sync bytes */
+  if (!rtph265depay->byte_stream)
+    goto not_implemented;
+
+  gst_rtp_h265_depay_handle_nal (rtph265depay, nal,
+      rtph265depay->fu_timestamp, rtph265depay->fu_marker);
+  return;
 
 not_implemented:
   {
     GST_ERROR_OBJECT (rtph265depay,
         ("Only bytestream format is currently supported."));
-    gst_buffer_unmap (outbuf, &map);
-    return NULL;
+    gst_buffer_list_unref (nal);
+    return;
   }
 }
 
@@ -1020,6 +1179,7 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
 {
   GstRtpH265Depay *rtph265depay;
   GstBuffer *outbuf = NULL;
+  GstBufferList *nal = NULL;
   guint8 nal_unit_type;
   GstRTPBuffer rtp = { NULL };
 
@@ -1027,7 +1187,7 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
 
   /* flush remaining data on discont */
   if (GST_BUFFER_IS_DISCONT (buf)) {
-    gst_adapter_clear (rtph265depay->adapter);
+    gst_rtp_h265_depay_chunks_clear (&rtph265depay->fragments);
     rtph265depay->wait_start = TRUE;
     rtph265depay->current_fu_type = 0;
   }
@@ -1035,14 +1195,14 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
   {
     gint payload_len;
     guint8 *payload;
-    guint header_len;
-    GstMapInfo map;
+    guint header_len, offset;
     guint outsize, nalu_size;
     GstClockTime timestamp;
     gboolean marker;
     guint8 nuh_layer_id, nuh_temporal_id_plus1;
     guint8 S, E;
     guint16 nal_header;
+    guint8 fu_prefix[sizeof (sync_bytes) + 2];
 #if 0
     gboolean donl_present = FALSE;
 #endif
@@ -1090,7 +1250,7 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
      * when the FU ended) and send out what we gathered thusfar */
     if (G_UNLIKELY (rtph265depay->current_fu_type != 0 &&
             nal_unit_type != rtph265depay->current_fu_type))
-      gst_rtp_h265_push_fragmentation_unit (rtph265depay, TRUE);
+      gst_rtp_h265_push_fragmentation_unit (rtph265depay);
 
     switch (nal_unit_type) {
       case 48:
@@ -1127,6 +1287,7 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
         /* strip headers */
         payload += header_len;
         payload_len -= header_len;
+        offset = header_len;
 
         rtph265depay->wait_start = FALSE;
 
@@ -1135,7 +1296,14 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
           goto not_implemented_donl_present;
 #endif
 
+        if (!rtph265depay->byte_stream)
+          goto not_implemented;
+
+        /* Every NAL unit is handled on its own, so that they go straight
+         * into the picture when merging instead of being collected into one
+         * buffer first. Only the last one can end the AU. */
         while (payload_len > 2) {
+          gboolean last;
 
           nalu_size = (payload[0] << 8) | payload[1];
 
@@ -1143,34 +1311,24 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
           if (nalu_size > (payload_len - 2))
             nalu_size = payload_len - 2;
 
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
-
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-          if (rtph265depay->byte_stream) {
-            memcpy (map.data, sync_bytes, sizeof (sync_bytes));
-          } else {
-            goto not_implemented;
-          }
-
           /* strip NALU size */
           payload += 2;
           payload_len -= 2;
+          offset += 2;
 
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          gst_buffer_unmap (outbuf, &map);
-
-          gst_adapter_push (rtph265depay->adapter, outbuf);
+          gst_rtp_h265_depay_chunks_add (&nal,
+              gst_rtp_h265_depay_make_nal (&rtp, sync_bytes,
+                  sizeof (sync_bytes), offset, nalu_size));
 
           payload += nalu_size;
           payload_len -= nalu_size;
-        }
+          offset += nalu_size;
+          last = payload_len <= 2;
 
-        outsize = gst_adapter_available (rtph265depay->adapter);
-        outbuf = gst_adapter_take_buffer (rtph265depay->adapter, outsize);
-
-        outbuf = gst_rtp_h265_depay_handle_nal (rtph265depay, outbuf, timestamp,
-            marker);
+          gst_rtp_h265_depay_handle_nal (rtph265depay, nal, timestamp,
+              marker && last);
+          nal = NULL;
+        }
         break;
       }
       case 49:
@@ -1224,7 +1382,7 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
            * Assume that the remote payloader is buggy (doesn't set the end
            * bit) and send out what we've gathered thusfar */
           if (G_UNLIKELY (rtph265depay->current_fu_type != 0))
-            gst_rtp_h265_push_fragmentation_unit (rtph265depay, TRUE);
+            gst_rtp_h265_push_fragmentation_unit (rtph265depay);
 
           rtph265depay->current_fu_type = nal_unit_type;
           rtph265depay->fu_timestamp = timestamp;
@@ -1236,26 +1394,21 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
               ((payload[0] & 0x3f) << 9) | (nuh_layer_id << 3) |
               nuh_temporal_id_plus1;
 
-          /* go back one byte so we can copy the payload + two bytes more in the front which
-           * will be overwritten by the nal_header
-           */
-          payload -= 1;
-          payload_len += 1;
+          /* only the sync bytes and the NAL header are written, the FU
+           * payload after the FU header is referenced */
+          memcpy (fu_prefix, sync_bytes, sizeof (sync_bytes));
+          fu_prefix[sizeof (sync_bytes)] = nal_header >> 8;
+          fu_prefix[sizeof (sync_bytes) + 1] = nal_header & 0xff;
 
-          nalu_size = payload_len;
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
-
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          map.data[sizeof (sync_bytes)] = nal_header >> 8;
-          map.data[sizeof (sync_bytes) + 1] = nal_header & 0xff;
-          gst_buffer_unmap (outbuf, &map);
+          nalu_size = payload_len - 1;
+          outsize = nalu_size + sizeof (fu_prefix);
+          outbuf = gst_rtp_h265_depay_make_nal (&rtp, fu_prefix,
+              sizeof (fu_prefix), header_len + 1, nalu_size);
 
           GST_DEBUG_OBJECT (rtph265depay, "queueing %d bytes", outsize);
 
-          /* and assemble in the adapter */
-          gst_adapter_push (rtph265depay->adapter, outbuf);
+          /* and collect the fragments */
+          gst_rtp_h265_depay_chunks_add (&rtph265depay->fragments, outbuf);
         } else {
 
           GST_DEBUG_OBJECT (rtph265depay,
@@ -1266,21 +1419,20 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
           payload_len -= 1;
 
           outsize = payload_len;
-          outbuf = gst_buffer_new_and_alloc (outsize);
-          gst_buffer_fill (outbuf, 0, payload, outsize);
+          outbuf = gst_rtp_h265_depay_make_nal (&rtp, NULL, 0, header_len + 1,
+              outsize);
 
           GST_DEBUG_OBJECT (rtph265depay, "queueing %d bytes", outsize);
 
-          /* and assemble in the adapter */
-          gst_adapter_push (rtph265depay->adapter, outbuf);
+          /* and collect the fragments */
+          gst_rtp_h265_depay_chunks_add (&rtph265depay->fragments, outbuf);
         }
 
-        outbuf = NULL;
         rtph265depay->fu_marker = marker;
 
-        /* if NAL unit ends, flush the adapter */
+        /* if NAL unit ends, handle the fragments */
         if (E) {
-          outbuf = gst_rtp_h265_push_fragmentation_unit (rtph265depay, FALSE);
+          gst_rtp_h265_push_fragmentation_unit (rtph265depay);
           GST_DEBUG_OBJECT (rtph265depay, "End of Fragmentation Unit");
         }
         break;
@@ -1299,28 +1451,22 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
           goto not_implemented_donl_present;
 #endif
 
-        nalu_size = payload_len;
-        outsize = nalu_size + sizeof (sync_bytes);
-        outbuf = gst_buffer_new_and_alloc (outsize);
-
-        gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-        if (rtph265depay->byte_stream) {
-          memcpy (map.data, sync_bytes, sizeof (sync_bytes));
-        } else {
+        if (!rtph265depay->byte_stream)
           goto not_implemented;
-        }
-        memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-        gst_buffer_unmap (outbuf, &map);
 
-        outbuf = gst_rtp_h265_depay_handle_nal (rtph265depay, outbuf, timestamp,
-            marker);
+        nalu_size = payload_len;
+        gst_rtp_h265_depay_chunks_add (&nal,
+            gst_rtp_h265_depay_make_nal (&rtp, sync_bytes,
+                sizeof (sync_bytes), 0, nalu_size));
+
+        gst_rtp_h265_depay_handle_nal (rtph265depay, nal, timestamp, marker);
         break;
       }
     }
     gst_rtp_buffer_unmap (&rtp);
   }
 
-  return outbuf;
+  return gst_rtp_h265_depay_take_output (rtph265depay);
 
   /* ERRORS */
 empty_packet:
@@ -1333,7 +1479,7 @@ waiting_start:
   {
     GST_DEBUG_OBJECT (rtph265depay, "waiting for start");
     gst_rtp_buffer_unmap (&rtp);
-    return NULL;
+    return gst_rtp_h265_depay_take_output (rtph265depay);
   }
 #if 0
 not_implemented_donl_present:
@@ -1349,7 +1495,7 @@ not_implemented:
     GST_ELEMENT_ERROR (rtph265depay, STREAM, FORMAT,
         (NULL), ("NAL unit type %d not supported yet", nal_unit_type));
     gst_rtp_buffer_unmap (&rtp);
-    return NULL;
+    return gst_rtp_h265_depay_take_output (rtph265depay);
   }
 }
 
@@ -60,12 +60,13 @@ struct _GstRtpH265Depay
   gboolean byte_stream;
 
   GstBuffer *codec_data;
-  GstAdapter *adapter;
+  /* fragments of the current FU, referencing the RTP payloads */
+  GstBufferList *fragments;
   gboolean wait_start;
 
   /* nal merging */
   gboolean merge;
-  GstAdapter *picture_adapter;
+  GstBufferList *picture;
   gboolean picture_start;
   GstClockTime last_ts;
   gboolean last_keyframe;
@@ -75,6 +76,9 @@ struct _GstRtpH265Depay
   GstClockTime fu_timestamp;
   gboolean fu_marker;
 
+  /* output of the current input buffer or buffer list */
+  GstBufferList *out_list;
+
   /* misc */
   GPtrArray *vps;
   GPtrArray *sps;
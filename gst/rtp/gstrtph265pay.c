@@ -103,14 +103,42 @@ GST_STATIC_PAD_TEMPLATE ("src",
 
 #define DEFAULT_SPROP_PARAMETER_SETS    NULL
 #define DEFAULT_CONFIG_INTERVAL		      0
+#define DEFAULT_AGGREGATE_MODE          GST_RTP_H265_AGGREGATE_NONE
+#define DEFAULT_BUFFER_LIST             FALSE
 
 enum
 {
   PROP_0,
   PROP_SPROP_PARAMETER_SETS,
-  PROP_CONFIG_INTERVAL
+  PROP_CONFIG_INTERVAL,
+  PROP_AGGREGATE_MODE,
+  PROP_BUFFER_LIST
 };
 
+#define GST_TYPE_RTP_H265_AGGREGATE_MODE \
+  (gst_rtp_h265_aggregate_mode_get_type ())
+
+static GType
+gst_rtp_h265_aggregate_mode_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_RTP_H265_AGGREGATE_NONE, "Do not aggregate NAL units", "none"},
+    {GST_RTP_H265_AGGREGATE_ZERO_LATENCY,
+        "Aggregate NAL units until the end of each input buffer",
+        "zero-latency"},
+    {GST_RTP_H265_AGGREGATE_MAX,
+          "Aggregate NAL units until the MTU or the end of the access unit",
+        "max"},
+    {0, NULL, NULL},
+  };
+
+  if (!type) {
+    type = g_enum_register_static ("GstRtpH265AggregateMode", values);
+  }
+  return type;
+}
+
 #define IS_ACCESS_UNIT(x) (((x) > 0x00) && ((x) < 0x06))
 
 static void gst_rtp_h265_pay_finalize (GObject * object);
@@ -166,6 +194,38 @@ gst_rtp_h265_pay_class_init (GstRtpH265PayClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
       );
 
+  /**
+   * GstRtpH265Pay:aggregate-mode:
+   *
+   * Bundle consecutive small NAL units, such as the parameter sets and SEI
+   * in front of a picture, into aggregation packets (RFC 7798 4.4.2).
+   * "max" can hold back NAL units until the next access unit when the
+   * input is not aligned to access units.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_AGGREGATE_MODE,
+      g_param_spec_enum ("aggregate-mode",
+          "Aggregate Mode",
+          "Bundle suitable NAL units into aggregation packets",
+          GST_TYPE_RTP_H265_AGGREGATE_MODE, DEFAULT_AGGREGATE_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpH265Pay:buffer-list:
+   *
+   * Push all packets of an access unit downstream in one buffer list
+   * instead of one list per NAL unit.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_BUFFER_LIST,
+      g_param_spec_boolean ("buffer-list", "Buffer List",
+          "Push all packets of an access unit in one buffer list",
+          DEFAULT_BUFFER_LIST, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->finalize = gst_rtp_h265_pay_finalize;
 
   gst_element_class_add_pad_template (gstelement_class,
@@ -203,6 +263,10 @@ gst_rtp_h265_pay_init (GstRtpH265Pay * rtph265pay)
       (GDestroyNotify) gst_buffer_unref);
   rtph265pay->last_vps_sps_pps = -1;
   rtph265pay->vps_sps_pps_interval = DEFAULT_CONFIG_INTERVAL;
+  rtph265pay->aggregate_mode = DEFAULT_AGGREGATE_MODE;
+  rtph265pay->buffer_list = DEFAULT_BUFFER_LIST;
+  rtph265pay->au_pts = GST_CLOCK_TIME_NONE;
+  rtph265pay->au_dts = GST_CLOCK_TIME_NONE;
 
   rtph265pay->adapter = gst_adapter_new ();
 }
@@ -215,6 +279,23 @@ gst_rtp_h265_pay_clear_vps_sps_pps (GstRtpH265Pay * rtph265pay)
   g_ptr_array_set_size (rtph265pay->pps, 0);
 }
 
+static void
+gst_rtp_h265_pay_reset_bundle (GstRtpH265Pay * rtph265pay)
+{
+  if (rtph265pay->bundle) {
+    gst_buffer_list_unref (rtph265pay->bundle);
+    rtph265pay->bundle = NULL;
+  }
+  rtph265pay->bundle_size = 0;
+
+  if (rtph265pay->pending_list) {
+    gst_buffer_list_unref (rtph265pay->pending_list);
+    rtph265pay->pending_list = NULL;
+  }
+  rtph265pay->au_pts = GST_CLOCK_TIME_NONE;
+  rtph265pay->au_dts = GST_CLOCK_TIME_NONE;
+}
+
 static void
 gst_rtp_h265_pay_finalize (GObject * object)
 {
@@ -232,6 +313,8 @@ gst_rtp_h265_pay_finalize (GObject * object)
 
   g_object_unref (rtph265pay->adapter);
 
+  gst_rtp_h265_pay_reset_bundle (rtph265pay);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -855,6 +938,104 @@ static GstFlowReturn
 gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
     GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au);
 
+/* Queues a finished RTP packet, it is pushed with the next
+ * gst_rtp_h265_pay_push_pending() */
+static void
+gst_rtp_h265_pay_add_packet (GstRtpH265Pay * rtph265pay, GstBuffer * outbuf)
+{
+  GST_BUFFER_PTS (outbuf) = rtph265pay->au_pts;
+  GST_BUFFER_DTS (outbuf) = rtph265pay->au_dts;
+
+  if (!rtph265pay->pending_list)
+    rtph265pay->pending_list = gst_buffer_list_new ();
+  gst_buffer_list_add (rtph265pay->pending_list, outbuf);
+}
+
+/* Turns the bundled NAL units into one packet: a single NAL unit packet if
+ * there is only one of them, an aggregation packet otherwise */
+static void
+gst_rtp_h265_pay_send_bundle (GstRtpH265Pay * rtph265pay)
+{
+  GstBufferList *bundle = rtph265pay->bundle;
+  GstRTPBuffer rtp = { NULL };
+  GstBuffer *outbuf;
+  guint8 *payload;
+  guint8 f = 0, layer_id = 0x3f, tid = 0x7;
+  guint i, n, pos;
+
+  if (!bundle)
+    return;
+
+  n = gst_buffer_list_length (bundle);
+
+  if (n == 1) {
+    outbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
+    outbuf = gst_buffer_append (outbuf,
+        gst_buffer_ref (gst_buffer_list_get (bundle, 0)));
+  } else {
+    GST_DEBUG_OBJECT (rtph265pay, "sending %u NAL units in an aggregation "
+        "packet of %u bytes", n, rtph265pay->bundle_size);
+
+    outbuf = gst_rtp_buffer_new_allocate (rtph265pay->bundle_size, 0, 0);
+    gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
+    payload = gst_rtp_buffer_get_payload (&rtp);
+
+    /* PayloadHdr, then the size and data of every NAL unit */
+    pos = 2;
+    for (i = 0; i < n; i++) {
+      GstBuffer *nal = gst_buffer_list_get (bundle, i);
+      gsize size = gst_buffer_get_size (nal);
+      guint8 nal_layer_id, nal_tid;
+
+      GST_WRITE_UINT16_BE (payload + pos, size);
+      gst_buffer_extract (nal, 0, payload + pos + 2, size);
+
+      /* F is set if any NAL unit has it, LayerId and TID are the lowest
+       * of all NAL units */
+      f |= payload[pos + 2] & 0x80;
+      nal_layer_id = ((payload[pos + 2] & 0x01) << 5) | (payload[pos + 3] >> 3);
+      nal_tid = payload[pos + 3] & 0x07;
+      layer_id = MIN (layer_id, nal_layer_id);
+      tid = MIN (tid, nal_tid);
+
+      pos += 2 + size;
+    }
+
+    /* PayloadHdr (type = 48) */
+    payload[0] = f | (48 << 1) | (layer_id >> 5);
+    payload[1] = (layer_id << 3) | tid;
+
+    gst_rtp_buffer_unmap (&rtp);
+  }
+
+  gst_rtp_h265_pay_add_packet (rtph265pay, outbuf);
+
+  gst_buffer_list_unref (bundle);
+  rtph265pay->bundle = NULL;
+  rtph265pay->bundle_size = 0;
+}
+
+static GstFlowReturn
+gst_rtp_h265_pay_push_pending (GstRtpH265Pay * rtph265pay)
+{
+  GstBufferList *list = rtph265pay->pending_list;
+
+  if (!list)
+    return GST_FLOW_OK;
+
+  rtph265pay->pending_list = NULL;
+  return gst_rtp_base_payload_push_list (GST_RTP_BASE_PAYLOAD (rtph265pay),
+      list);
+}
+
+/* Sends out everything still held back */
+static GstFlowReturn
+gst_rtp_h265_pay_drain (GstRtpH265Pay * rtph265pay)
+{
+  gst_rtp_h265_pay_send_bundle (rtph265pay);
+  return gst_rtp_h265_pay_push_pending (rtph265pay);
+}
+
 static GstFlowReturn
 gst_rtp_h265_pay_send_vps_sps_pps (GstRTPBasePayload * basepayload,
     GstRtpH265Pay * rtph265pay, GstClockTime dts, GstClockTime pts)
@@ -923,7 +1104,6 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
   guint packet_len, payload_len, mtu;
   GstBuffer *outbuf;
   guint8 *payload;
-  GstBufferList *list = NULL;
   gboolean send_vps_sps_pps;
   GstRTPBuffer rtp = { NULL };
   guint size = gst_buffer_get_size (paybuf);
@@ -936,6 +1116,19 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
 
   GST_DEBUG_OBJECT (rtph265pay, "Processing Buffer with NAL TYPE=%d", nalType);
 
+  /* NAL units of different access units never share an aggregation packet
+   * or a buffer list */
+  if ((rtph265pay->bundle || rtph265pay->pending_list) &&
+      pts != rtph265pay->au_pts) {
+    ret = gst_rtp_h265_pay_drain (rtph265pay);
+    if (ret != GST_FLOW_OK) {
+      gst_buffer_unref (paybuf);
+      return ret;
+    }
+  }
+  rtph265pay->au_pts = pts;
+  rtph265pay->au_dts = dts;
+
   /* should set src caps before pushing stuff,
    * and if we did not see enough VPS/SPS/PPS, that may not be the case */
   if (G_UNLIKELY (!gst_pad_has_current_caps (GST_RTP_BASE_PAYLOAD_SRCPAD
@@ -995,8 +1188,37 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
      * checking when we need to send SPS/PPS but convert to running_time first. */
     rtph265pay->send_vps_sps_pps = FALSE;
     ret = gst_rtp_h265_pay_send_vps_sps_pps (basepayload, rtph265pay, dts, pts);
-    if (ret != GST_FLOW_OK)
+    if (ret != GST_FLOW_OK) {
+      gst_buffer_unref (paybuf);
       return ret;
+    }
+  }
+
+  if (rtph265pay->aggregate_mode != GST_RTP_H265_AGGREGATE_NONE) {
+    /* An aggregation packet has a 2 byte PayloadHdr and 2 bytes of size in
+     * front of every NAL unit */
+    if (rtph265pay->bundle &&
+        gst_rtp_buffer_calc_packet_len (rtph265pay->bundle_size + 2 + size, 0,
+            0) > mtu)
+      gst_rtp_h265_pay_send_bundle (rtph265pay);
+
+    if (gst_rtp_buffer_calc_packet_len (2 + 2 + size, 0, 0) <= mtu) {
+      GST_DEBUG_OBJECT (rtph265pay, "bundling NAL unit of size %u", size);
+
+      if (!rtph265pay->bundle) {
+        rtph265pay->bundle = gst_buffer_list_new ();
+        rtph265pay->bundle_size = 2;
+      }
+      gst_buffer_list_add (rtph265pay->bundle, paybuf);
+      rtph265pay->bundle_size += 2 + size;
+
+      if (end_of_au)
+        gst_rtp_h265_pay_send_bundle (rtph265pay);
+      goto push;
+    }
+
+    /* keep the NAL units in order */
+    gst_rtp_h265_pay_send_bundle (rtph265pay);
   }
 
   packet_len = gst_rtp_buffer_calc_packet_len (size, 0, 0);
@@ -1008,34 +1230,19 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
         "NAL Unit fit in one packet datasize=%d mtu=%d", size, mtu);
     /* will fit in one packet */
 
-    /* use buffer lists
-     * create buffer without payload containing only the RTP header
+    /* create buffer without payload containing only the RTP header
      * (memory block at index 0) */
     outbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
 
-    gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
-
     /* FIXME : only set the marker bit on packets containing access units */
     /* if (IS_ACCESS_UNIT (nalType) && end_of_au) {
        gst_rtp_buffer_set_marker (&rtp, 1);
        } */
 
-    /* timestamp the outbuffer */
-    GST_BUFFER_PTS (outbuf) = pts;
-    GST_BUFFER_DTS (outbuf) = dts;
-
     /* insert payload memory block */
     outbuf = gst_buffer_append (outbuf, paybuf);
 
-    list = gst_buffer_list_new ();
-
-    /* add the buffer to the buffer list */
-    gst_buffer_list_add (list, outbuf);
-
-    gst_rtp_buffer_unmap (&rtp);
-
-    /* push the list to the next element in the pipe */
-    ret = gst_rtp_base_payload_push_list (basepayload, list);
+    gst_rtp_h265_pay_add_packet (rtph265pay, outbuf);
   } else {
     /* fragmentation Units */
     guint limitedSize;
@@ -1047,31 +1254,24 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
     pos += 2;
     size -= 2;
 
-    ret = GST_FLOW_OK;
-
     GST_DEBUG_OBJECT (basepayload, "Using FU fragmentation for data size=%d",
         size);
 
     /* We keep 3 bytes for PayloadHdr and FU Header */
     payload_len = gst_rtp_buffer_calc_payload_len (mtu - 3, 0, 0);
 
-    list = gst_buffer_list_new ();
-
     while (end == 0) {
       limitedSize = size < payload_len ? size : payload_len;
       GST_DEBUG_OBJECT (basepayload,
           "Inside  FU fragmentation limitedSize=%d iteration=%d", limitedSize,
           ii);
 
-      /* use buffer lists
-       * create buffer without payload containing only the RTP header
+      /* create buffer without payload containing only the RTP header
        * (memory block at index 0), and with space for PayloadHdr and FU header */
       outbuf = gst_rtp_buffer_new_allocate (3, 0, 0);
 
       gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
 
-      GST_BUFFER_DTS (outbuf) = dts;
-      GST_BUFFER_PTS (outbuf) = pts;
       payload = gst_rtp_buffer_get_payload (&rtp);
 
       if (limitedSize == size) {
@@ -1098,9 +1298,7 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
           gst_buffer_copy_region (paybuf, GST_BUFFER_COPY_MEMORY, pos,
               limitedSize));
 
-      /* add the buffer to the buffer list */
-      gst_buffer_list_add (list, outbuf);
-
+      gst_rtp_h265_pay_add_packet (rtph265pay, outbuf);
 
       size -= limitedSize;
       pos += limitedSize;
@@ -1108,10 +1306,15 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
       start = 0;
     }
 
-    ret = gst_rtp_base_payload_push_list (basepayload, list);
     gst_buffer_unref (paybuf);
   }
-  return ret;
+
+push:
+  /* in buffer-list mode, all packets of an access unit go out together */
+  if (!rtph265pay->buffer_list || end_of_au)
+    return gst_rtp_h265_pay_push_pending (rtph265pay);
+
+  return GST_FLOW_OK;
 }
 
 static GstFlowReturn
@@ -1170,10 +1373,8 @@ gst_rtp_h265_pay_handle_buffer (GstRTPBasePayload * basepayload,
 
   ret = GST_FLOW_OK;
 
-  /* now loop over all NAL units and put them in a packet
-   * FIXME, we should really try to pack multiple NAL units into one RTP packet
-   * if we can, especially for the config packets that wont't cause decoder
-   * latency. */
+  /* now loop over all NAL units and put them in a packet, small ones are
+   * bundled into aggregation packets depending on the aggregate-mode */
   if (hevc) {
     guint nal_length_size;
     gsize offset = 0;
@@ -1366,6 +1567,14 @@ done:
     gst_adapter_unmap (rtph265pay->adapter);
   }
 
+  /* do not hold back anything past the end of the input buffer */
+  if (ret == GST_FLOW_OK &&
+      rtph265pay->aggregate_mode == GST_RTP_H265_AGGREGATE_ZERO_LATENCY) {
+    gst_rtp_h265_pay_send_bundle (rtph265pay);
+    if (!rtph265pay->buffer_list)
+      ret = gst_rtp_h265_pay_push_pending (rtph265pay);
+  }
+
   return ret;
 
 caps_rejected:
@@ -1387,6 +1596,7 @@ gst_rtp_h265_pay_sink_event (GstRTPBasePayload * payload, GstEvent * event)
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_FLUSH_STOP:
       gst_adapter_clear (rtph265pay->adapter);
+      gst_rtp_h265_pay_reset_bundle (rtph265pay);
       break;
     case GST_EVENT_CUSTOM_DOWNSTREAM:
       s = gst_event_get_structure (event);
@@ -1404,6 +1614,7 @@ gst_rtp_h265_pay_sink_event (GstRTPBasePayload * payload, GstEvent * event)
        * in byte-stream mode
        */
       gst_rtp_h265_pay_handle_buffer (payload, NULL);
+      gst_rtp_h265_pay_drain (rtph265pay);
       break;
     }
     case GST_EVENT_STREAM_START:
@@ -1430,6 +1641,7 @@ gst_rtp_h265_pay_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       rtph265pay->send_vps_sps_pps = FALSE;
       gst_adapter_clear (rtph265pay->adapter);
+      gst_rtp_h265_pay_reset_bundle (rtph265pay);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       rtph265pay->last_vps_sps_pps = -1;
@@ -1461,6 +1673,12 @@ gst_rtp_h265_pay_set_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       rtph265pay->vps_sps_pps_interval = g_value_get_uint (value);
       break;
+    case PROP_AGGREGATE_MODE:
+      rtph265pay->aggregate_mode = g_value_get_enum (value);
+      break;
+    case PROP_BUFFER_LIST:
+      rtph265pay->buffer_list = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1482,6 +1700,12 @@ gst_rtp_h265_pay_get_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       g_value_set_uint (value, rtph265pay->vps_sps_pps_interval);
       break;
+    case PROP_AGGREGATE_MODE:
+      g_value_set_enum (value, rtph265pay->aggregate_mode);
+      break;
+    case PROP_BUFFER_LIST:
+      g_value_set_boolean (value, rtph265pay->buffer_list);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -47,6 +47,13 @@ typedef enum
   GST_H265_ALIGNMENT_AU
 } GstH265Alignment;
 
+typedef enum
+{
+  GST_RTP_H265_AGGREGATE_NONE,
+  GST_RTP_H265_AGGREGATE_ZERO_LATENCY,
+  GST_RTP_H265_AGGREGATE_MAX
+} GstRTPH265AggregateMode;
+
 struct _GstRtpH265Pay
 {
   GstRTPBasePayload payload;
@@ -67,6 +74,17 @@ struct _GstRtpH265Pay
   guint vps_sps_pps_interval;
   gboolean send_vps_sps_pps;
   GstClockTime last_vps_sps_pps;
+
+  GstRTPH265AggregateMode aggregate_mode;
+  gboolean buffer_list;
+
+  /* NAL units waiting to be sent in one aggregation packet */
+  GstBufferList *bundle;
+  guint bundle_size;
+
+  /* packets not pushed yet, all of them with the timestamps below */
+  GstBufferList *pending_list;
+  GstClockTime au_pts, au_dts;
 };
 
 struct _GstRtpH265PayClass
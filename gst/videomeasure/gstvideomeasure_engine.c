@@ -0,0 +1,571 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+/* SSIM and PSNR measurement of 8-bit planes.
+ *
+ * SSIM needs the weighted local mean of the original and modified samples,
+ * of their squares and of their product. Both window types are separable,
+ * so the five moments are filtered horizontally once per input line and
+ * the vertical filter runs over a ring of the last window-size filtered
+ * lines. That makes the cost per sample linear instead of quadratic in the
+ * window size. Windows are clipped at the plane edges and normalised by the
+ * sum of the weights that remain, which for a separable window is the
+ * product of the horizontal and the vertical sum.
+ *
+ * Planes are split into bands of lines that are measured concurrently, each
+ * band having its own scratch lines.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstvideomeasure_engine.h"
+#include <gst/parallel-private.h>
+
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VIDEO_MEASURE_NEON 1
+#endif
+
+/* upper bound on the number of bands a plane is split into */
+#define MAX_BANDS GST_PARALLEL_MAX_THREADS
+
+/* bands shorter than this cost more in synchronisation than they gain */
+#define MIN_BAND_LINES 16
+
+/* moments of a sample pair, in the order they are stored in scratch lines */
+enum
+{
+  MOMENT_O,
+  MOMENT_M,
+  MOMENT_OO,
+  MOMENT_MM,
+  MOMENT_OM,
+  N_MOMENTS
+};
+
+typedef struct
+{
+  /* the moments of one input line */
+  gfloat *line[N_MOMENTS];
+  /* ring of window_size horizontally filtered lines */
+  gfloat *ring[N_MOMENTS];
+  /* vertically filtered moments of one output line */
+  gfloat *acc[N_MOMENTS];
+  gfloat *ssim;
+} BandScratch;
+
+typedef struct
+{
+  guint band;
+  const guint8 *org, *mod;
+  gint org_stride, mod_stride;
+  gint width, height;
+  gint y0, y1;
+  guint8 *out;
+  gint out_stride;
+
+  gdouble ssim_sum;
+  gfloat ssim_lowest, ssim_highest;
+  guint64 ssd;
+} BandJob;
+
+struct _GstVideoMeasureEngine
+{
+  GstVideoMeasureWindowType window_type;
+  gint window_size;
+  gfloat sigma;
+  gboolean fixed_mu;
+
+  /* taps span [-left, right] around the centre sample */
+  gint left, right;
+  gfloat *weights;
+  gfloat total_weight;
+
+  gfloat const1, const2;
+
+  GstParallelBands bands;
+  guint max_threads;
+  guint n_threads;
+
+  BandScratch scratch[MAX_BANDS];
+  gint scratch_width;
+};
+
+static void
+mla_f32 (gfloat * d, const gfloat * s, gfloat w, gint n)
+{
+  gint i = 0;
+
+#if defined(__SSE2__)
+  const __m128 vw = _mm_set1_ps (w);
+
+  for (; i + 8 <= n; i += 8) {
+    __m128 d0 = _mm_loadu_ps (d + i);
+    __m128 d1 = _mm_loadu_ps (d + i + 4);
+
+    d0 = _mm_add_ps (d0, _mm_mul_ps (_mm_loadu_ps (s + i), vw));
+    d1 = _mm_add_ps (d1, _mm_mul_ps (_mm_loadu_ps (s + i + 4), vw));
+    _mm_storeu_ps (d + i, d0);
+    _mm_storeu_ps (d + i + 4, d1);
+  }
+#elif defined(VIDEO_MEASURE_NEON)
+  for (; i + 8 <= n; i += 8) {
+    vst1q_f32 (d + i, vmlaq_n_f32 (vld1q_f32 (d + i), vld1q_f32 (s + i), w));
+    vst1q_f32 (d + i + 4, vmlaq_n_f32 (vld1q_f32 (d + i + 4),
+            vld1q_f32 (s + i + 4), w));
+  }
+#endif
+
+  for (; i < n; i++)
+    d[i] += s[i] * w;
+}
+
+static void
+load_moments (const guint8 * org, const guint8 * mod, gfloat ** line, gint n)
+{
+  gfloat *o = line[MOMENT_O], *m = line[MOMENT_M];
+  gfloat *oo = line[MOMENT_OO], *mm = line[MOMENT_MM], *om = line[MOMENT_OM];
+  gint i = 0;
+
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (; i + 8 <= n; i += 8) {
+    __m128i o16 =
+        _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (org + i)),
+        zero);
+    __m128i m16 =
+        _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (mod + i)),
+        zero);
+    __m128 o0 = _mm_cvtepi32_ps (_mm_unpacklo_epi16 (o16, zero));
+    __m128 o1 = _mm_cvtepi32_ps (_mm_unpackhi_epi16 (o16, zero));
+    __m128 m0 = _mm_cvtepi32_ps (_mm_unpacklo_epi16 (m16, zero));
+    __m128 m1 = _mm_cvtepi32_ps (_mm_unpackhi_epi16 (m16, zero));
+
+    _mm_storeu_ps (o + i, o0);
+    _mm_storeu_ps (o + i + 4, o1);
+    _mm_storeu_ps (m + i, m0);
+    _mm_storeu_ps (m + i + 4, m1);
+    _mm_storeu_ps (oo + i, _mm_mul_ps (o0, o0));
+    _mm_storeu_ps (oo + i + 4, _mm_mul_ps (o1, o1));
+    _mm_storeu_ps (mm + i, _mm_mul_ps (m0, m0));
+    _mm_storeu_ps (mm + i + 4, _mm_mul_ps (m1, m1));
+    _mm_storeu_ps (om + i, _mm_mul_ps (o0, m0));
+    _mm_storeu_ps (om + i + 4, _mm_mul_ps (o1, m1));
+  }
+#elif defined(VIDEO_MEASURE_NEON)
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t o16 = vmovl_u8 (vld1_u8 (org + i));
+    uint16x8_t m16 = vmovl_u8 (vld1_u8 (mod + i));
+    float32x4_t o0 = vcvtq_f32_u32 (vmovl_u16 (vget_low_u16 (o16)));
+    float32x4_t o1 = vcvtq_f32_u32 (vmovl_u16 (vget_high_u16 (o16)));
+    float32x4_t m0 = vcvtq_f32_u32 (vmovl_u16 (vget_low_u16 (m16)));
+    float32x4_t m1 = vcvtq_f32_u32 (vmovl_u16 (vget_high_u16 (m16)));
+
+    vst1q_f32 (o + i, o0);
+    vst1q_f32 (o + i + 4, o1);
+    vst1q_f32 (m + i, m0);
+    vst1q_f32 (m + i + 4, m1);
+    vst1q_f32 (oo + i, vmulq_f32 (o0, o0));
+    vst1q_f32 (oo + i + 4, vmulq_f32 (o1, o1));
+    vst1q_f32 (mm + i, vmulq_f32 (m0, m0));
+    vst1q_f32 (mm + i + 4, vmulq_f32 (m1, m1));
+    vst1q_f32 (om + i, vmulq_f32 (o0, m0));
+    vst1q_f32 (om + i + 4, vmulq_f32 (o1, m1));
+  }
+#endif
+
+  for (; i < n; i++) {
+    o[i] = org[i];
+    m[i] = mod[i];
+    oo[i] = o[i] * o[i];
+    mm[i] = m[i] * m[i];
+    om[i] = o[i] * m[i];
+  }
+}
+
+/* computes the SSIM index from the normalised local moments. with fixed_mu
+ * the means used in the luminance term and for centering the variances are
+ * taken to be 128, as the old "without mu" calculation did */
+static void
+combine_ssim (gfloat ** acc, gfloat c1, gfloat c2, gboolean fixed_mu,
+    gfloat * ssim, gint n)
+{
+  const gfloat *mo = acc[MOMENT_O], *mm = acc[MOMENT_M];
+  const gfloat *eoo = acc[MOMENT_OO], *emm = acc[MOMENT_MM];
+  const gfloat *eom = acc[MOMENT_OM];
+  gint i = 0;
+
+#if defined(__SSE2__)
+  const __m128 v128 = _mm_set1_ps (128.0f);
+  const __m128 vc1 = _mm_set1_ps (c1);
+  const __m128 vc2 = _mm_set1_ps (c2);
+  const __m128 v2 = _mm_set1_ps (2.0f);
+
+  for (; i + 4 <= n; i += 4) {
+    __m128 o = _mm_loadu_ps (mo + i);
+    __m128 m = _mm_loadu_ps (mm + i);
+    __m128 ao = fixed_mu ? v128 : o;
+    __m128 am = fixed_mu ? v128 : m;
+    /* E[(x - a)^2] = E[x^2] - 2aE[x] + a^2 and likewise for the covariance */
+    __m128 vo = _mm_add_ps (_mm_sub_ps (_mm_loadu_ps (eoo + i),
+            _mm_mul_ps (v2, _mm_mul_ps (ao, o))), _mm_mul_ps (ao, ao));
+    __m128 vm = _mm_add_ps (_mm_sub_ps (_mm_loadu_ps (emm + i),
+            _mm_mul_ps (v2, _mm_mul_ps (am, m))), _mm_mul_ps (am, am));
+    __m128 cov = _mm_add_ps (_mm_sub_ps (_mm_sub_ps (_mm_loadu_ps (eom + i),
+                _mm_mul_ps (ao, m)), _mm_mul_ps (am, o)), _mm_mul_ps (ao, am));
+    __m128 num = _mm_mul_ps (_mm_add_ps (_mm_mul_ps (v2, _mm_mul_ps (ao, am)),
+            vc1), _mm_add_ps (_mm_mul_ps (v2, cov), vc2));
+    __m128 den = _mm_mul_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (ao, ao),
+                _mm_mul_ps (am, am)), vc1), _mm_add_ps (_mm_add_ps (vo, vm),
+            vc2));
+
+    _mm_storeu_ps (ssim + i, _mm_div_ps (num, den));
+  }
+#endif
+
+  for (; i < n; i++) {
+    const gfloat ao = fixed_mu ? 128.0f : mo[i];
+    const gfloat am = fixed_mu ? 128.0f : mm[i];
+    const gfloat vo = eoo[i] - 2.0f * ao * mo[i] + ao * ao;
+    const gfloat vm = emm[i] - 2.0f * am * mm[i] + am * am;
+    const gfloat cov = eom[i] - ao * mm[i] - am * mo[i] + ao * am;
+
+    ssim[i] = (2.0f * ao * am + c1) * (2.0f * cov + c2) /
+        ((ao * ao + am * am + c1) * (vo + vm + c2));
+  }
+}
+
+/* filters the moments of one line horizontally into dest */
+static void
+filter_line (GstVideoMeasureEngine * engine, gfloat ** line, gfloat ** dest,
+    gint width)
+{
+  const gint left = engine->left, right = engine->right;
+  const gfloat *weights = engine->weights;
+  gint p, k, x, start, end;
+
+  /* samples whose window lies completely inside the line */
+  start = MIN (left, width);
+  end = MAX (width - right, start);
+
+  for (p = 0; p < N_MOMENTS; p++) {
+    memset (dest[p] + start, 0, (end - start) * sizeof (gfloat));
+    for (k = 0; k < engine->window_size; k++)
+      mla_f32 (dest[p] + start, line[p] + start + k - left,
+          weights[k] / engine->total_weight, end - start);
+  }
+
+  /* clipped windows at both edges */
+  for (x = 0; x < width; x++) {
+    gfloat sum[N_MOMENTS] = { 0, };
+    gfloat norm = 0;
+
+    if (x == start && end > start)
+      x = end;
+    if (x >= width)
+      break;
+
+    for (k = MAX (0, left - x); k < engine->window_size; k++) {
+      const gint ix = x + k - left;
+
+      if (ix >= width)
+        break;
+      for (p = 0; p < N_MOMENTS; p++)
+        sum[p] += weights[k] * line[p][ix];
+      norm += weights[k];
+    }
+    for (p = 0; p < N_MOMENTS; p++)
+      dest[p][x] = sum[p] / norm;
+  }
+}
+
+static void
+measure_band (GstVideoMeasureEngine * engine, BandJob * job)
+{
+  BandScratch *scratch = &engine->scratch[job->band];
+  const gint width = job->width, height = job->height;
+  const gint ws = engine->window_size;
+  gfloat *ring[N_MOMENTS];
+  gint next_line, y, p, k, x;
+
+  job->ssim_sum = 0;
+  job->ssim_lowest = G_MAXFLOAT;
+  job->ssim_highest = -G_MAXFLOAT;
+  job->ssd = 0;
+
+  /* first input line needed by the first output line of the band */
+  next_line = MAX (0, job->y0 - engine->left);
+
+  for (y = job->y0; y < job->y1; y++) {
+    const gint last = MIN (height - 1, y + engine->right);
+    const guint8 *org = job->org + y * job->org_stride;
+    const guint8 *mod = job->mod + y * job->mod_stride;
+    gdouble line_sum = 0;
+    gfloat norm = 0;
+    guint64 ssd = 0;
+
+    /* horizontally filter the lines entering the window */
+    for (; next_line <= last; next_line++) {
+      for (p = 0; p < N_MOMENTS; p++)
+        ring[p] = scratch->ring[p] + (next_line % ws) * width;
+      load_moments (job->org + next_line * job->org_stride,
+          job->mod + next_line * job->mod_stride, scratch->line, width);
+      filter_line (engine, scratch->line, ring, width);
+    }
+
+    /* vertical filter over the clipped window */
+    for (k = MAX (0, engine->left - y); k < ws; k++) {
+      if (y + k - engine->left >= height)
+        break;
+      norm += engine->weights[k];
+    }
+    for (p = 0; p < N_MOMENTS; p++)
+      memset (scratch->acc[p], 0, width * sizeof (gfloat));
+    for (k = MAX (0, engine->left - y); k < ws; k++) {
+      const gint iy = y + k - engine->left;
+
+      if (iy >= height)
+        break;
+      for (p = 0; p < N_MOMENTS; p++)
+        mla_f32 (scratch->acc[p], scratch->ring[p] + (iy % ws) * width,
+            engine->weights[k] / norm, width);
+    }
+
+    combine_ssim (scratch->acc, engine->const1, engine->const2,
+        engine->fixed_mu, scratch->ssim, width);
+
+    for (x = 0; x < width; x++) {
+      const gfloat s = scratch->ssim[x];
+      const gint d = org[x] - mod[x];
+
+      line_sum += s;
+      job->ssim_lowest = MIN (job->ssim_lowest, s);
+      job->ssim_highest = MAX (job->ssim_highest, s);
+      ssd += d * d;
+    }
+    job->ssim_sum += line_sum;
+    job->ssd += ssd;
+
+    /* SSIM can go negative, that's why it is
+       127 + index * 128 instead of index * 255 */
+    if (job->out) {
+      guint8 *out = job->out + y * job->out_stride;
+
+      for (x = 0; x < width; x++)
+        out[x] = CLAMP (127 + scratch->ssim[x] * 128, 0, 255);
+    }
+  }
+}
+
+typedef struct
+{
+  GstVideoMeasureEngine *engine;
+  BandJob *jobs;
+} PlaneJob;
+
+static void
+measure_band_func (gpointer user_data, guint band, guint n_bands)
+{
+  PlaneJob *plane = user_data;
+
+  measure_band (plane->engine, &plane->jobs[band]);
+}
+
+static void
+free_scratch (GstVideoMeasureEngine * engine)
+{
+  gint i;
+
+  for (i = 0; i < MAX_BANDS; i++) {
+    /* all lines of a band are carved out of a single allocation */
+    g_free (engine->scratch[i].line[0]);
+    memset (&engine->scratch[i], 0, sizeof (BandScratch));
+  }
+  engine->scratch_width = 0;
+}
+
+static void
+alloc_scratch (GstVideoMeasureEngine * engine, gint width)
+{
+  const gint ws = engine->window_size;
+  guint i;
+  gint p;
+
+  if (engine->scratch_width >= width)
+    return;
+
+  free_scratch (engine);
+  for (i = 0; i < MAX (engine->n_threads, 1); i++) {
+    BandScratch *scratch = &engine->scratch[i];
+    gfloat *mem = g_new (gfloat, ((2 + ws) * N_MOMENTS + 1) * width);
+
+    for (p = 0; p < N_MOMENTS; p++) {
+      scratch->line[p] = mem;
+      mem += width;
+      scratch->acc[p] = mem;
+      mem += width;
+      scratch->ring[p] = mem;
+      mem += ws * width;
+    }
+    scratch->ssim = mem;
+  }
+  engine->scratch_width = width;
+}
+
+GstVideoMeasureEngine *
+gst_video_measure_engine_new (void)
+{
+  GstVideoMeasureEngine *engine = g_new0 (GstVideoMeasureEngine, 1);
+
+  gst_parallel_bands_init (&engine->bands);
+  engine->n_threads = 1;
+
+  /* FIXME: while 0.01 and 0.03 are pretty much static, the 255 implies that
+   * we're working with 8-bit-per-color-component format, which may not be true
+   */
+  engine->const1 = 0.01 * 255 * 0.01 * 255;
+  engine->const2 = 0.03 * 255 * 0.03 * 255;
+
+  return engine;
+}
+
+void
+gst_video_measure_engine_free (GstVideoMeasureEngine * engine)
+{
+  gst_parallel_bands_stop (&engine->bands);
+  free_scratch (engine);
+  g_free (engine->weights);
+  gst_parallel_bands_clear (&engine->bands);
+  g_free (engine);
+}
+
+gboolean
+gst_video_measure_engine_configure (GstVideoMeasureEngine * engine,
+    GstVideoMeasureWindowType window_type, gint window_size, gfloat sigma,
+    gboolean fixed_mu, guint max_threads)
+{
+  gint windowiseven, k;
+
+  g_return_val_if_fail (window_size > 0, FALSE);
+
+  if (engine->bands.pool == NULL || engine->max_threads != max_threads) {
+    gst_parallel_bands_stop (&engine->bands);
+    engine->n_threads = gst_parallel_bands_start (&engine->bands, NULL,
+        max_threads);
+    engine->max_threads = max_threads;
+  }
+  free_scratch (engine);
+
+  engine->window_type = window_type;
+  engine->window_size = window_size;
+  engine->sigma = sigma;
+  engine->fixed_mu = fixed_mu;
+
+  /* even windows have one more sample after the centre than before it */
+  windowiseven = (window_size & 1) == 0;
+  engine->left = window_size / 2 - windowiseven;
+  engine->right = window_size / 2;
+
+  /* the 2D gaussian is the product of two 1D ones, the constant factor
+   * cancels out in the normalisation */
+  g_free (engine->weights);
+  engine->weights = g_new (gfloat, window_size);
+  engine->total_weight = 0;
+  for (k = 0; k < window_size; k++) {
+    const gint t = k - engine->left;
+
+    if (window_type == GST_VIDEO_MEASURE_WINDOW_GAUSS)
+      engine->weights[k] = exp (-(t * t) / (2 * sigma * sigma));
+    else
+      engine->weights[k] = 1;
+    engine->total_weight += engine->weights[k];
+  }
+
+  return TRUE;
+}
+
+/* measures SSIM and PSNR of mod against org, two planes of width x height
+ * 8-bit samples. if out is not NULL it receives the SSIM map */
+void
+gst_video_measure_engine_measure_plane (GstVideoMeasureEngine * engine,
+    const guint8 * org, gint org_stride, const guint8 * mod, gint mod_stride,
+    gint width, gint height, guint8 * out, gint out_stride,
+    GstVideoMeasurePlaneResult * result)
+{
+  BandJob jobs[MAX_BANDS];
+  PlaneJob plane = { engine, jobs };
+  gdouble ssim_sum = 0;
+  guint n_bands, i;
+
+  g_return_if_fail (engine->weights != NULL);
+
+  alloc_scratch (engine, width);
+
+  n_bands = MIN (engine->n_threads, MAX (height / MIN_BAND_LINES, 1));
+
+  for (i = 0; i < n_bands; i++) {
+    BandJob *job = &jobs[i];
+
+    job->band = i;
+    job->org = org;
+    job->org_stride = org_stride;
+    job->mod = mod;
+    job->mod_stride = mod_stride;
+    job->width = width;
+    job->height = height;
+    job->y0 = ((guint64) height * i) / n_bands;
+    job->y1 = ((guint64) height * (i + 1)) / n_bands;
+    job->out = out;
+    job->out_stride = out_stride;
+  }
+
+  gst_parallel_bands_run (&engine->bands, n_bands, measure_band_func, &plane);
+
+  result->ssim_lowest = G_MAXFLOAT;
+  result->ssim_highest = -G_MAXFLOAT;
+  result->ssd = 0;
+  for (i = 0; i < n_bands; i++) {
+    ssim_sum += jobs[i].ssim_sum;
+    result->ssim_lowest = MIN (result->ssim_lowest, jobs[i].ssim_lowest);
+    result->ssim_highest = MAX (result->ssim_highest, jobs[i].ssim_highest);
+    result->ssd += jobs[i].ssd;
+  }
+
+  result->ssim_mean = ssim_sum / ((gdouble) width * height);
+  result->mse = (gdouble) result->ssd / ((gdouble) width * height);
+  result->psnr = gst_video_measure_psnr (result->mse);
+}
+
+/* PSNR of 8-bit samples with the given mean squared error, capped for
+ * identical samples */
+gdouble
+gst_video_measure_psnr (gdouble mse)
+{
+  if (mse <= 0)
+    return GST_VIDEO_MEASURE_PSNR_MAX;
+
+  return MIN (10.0 * log10 (255.0 * 255.0 / mse), GST_VIDEO_MEASURE_PSNR_MAX);
+}
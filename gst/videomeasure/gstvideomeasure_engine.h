@@ -0,0 +1,65 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __GST_VIDEO_MEASURE_ENGINE_H__
+#define __GST_VIDEO_MEASURE_ENGINE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVideoMeasureEngine GstVideoMeasureEngine;
+typedef struct _GstVideoMeasurePlaneResult GstVideoMeasurePlaneResult;
+
+/* window types, values match the "window-type" property of ssim */
+typedef enum {
+  GST_VIDEO_MEASURE_WINDOW_BOX = 0,
+  GST_VIDEO_MEASURE_WINDOW_GAUSS = 1
+} GstVideoMeasureWindowType;
+
+/* PSNR reported for identical planes */
+#define GST_VIDEO_MEASURE_PSNR_MAX 100.0
+
+struct _GstVideoMeasurePlaneResult {
+  gdouble ssim_mean;
+  gfloat  ssim_lowest;
+  gfloat  ssim_highest;
+
+  /* sum of squared differences and what it amounts to */
+  guint64 ssd;
+  gdouble mse;
+  gdouble psnr;
+};
+
+GstVideoMeasureEngine *gst_video_measure_engine_new (void);
+void gst_video_measure_engine_free (GstVideoMeasureEngine *engine);
+
+gboolean gst_video_measure_engine_configure (GstVideoMeasureEngine *engine,
+    GstVideoMeasureWindowType window_type, gint window_size, gfloat sigma,
+    gboolean fixed_mu, guint max_threads);
+
+void gst_video_measure_engine_measure_plane (GstVideoMeasureEngine *engine,
+    const guint8 *org, gint org_stride, const guint8 *mod, gint mod_stride,
+    gint width, gint height, guint8 *out, gint out_stride,
+    GstVideoMeasurePlaneResult *result);
+
+gdouble gst_video_measure_psnr (gdouble mse);
+
+G_END_DECLS
+
+#endif /* __GST_VIDEO_MEASURE_ENGINE_H__ */
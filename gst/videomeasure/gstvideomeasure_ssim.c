@@ -26,12 +26,16 @@
  * ssim will calculate SSIM index of each frame of each modified stream, using 
  * original stream as a reference.
  *
- * The ssim accepts only YUV planar top-first data and calculates only Y-SSIM.
+ * The ssim accepts only YUV planar top-first data.
  * All streams must have the same width, height and colorspace.
  * Output streams are greyscale video streams, where bright pixels indicate 
  * high SSIM values, dark pixels - low SSIM values.
- * The ssim also calculates mean SSIM index for each frame and emits is as a 
- * message.
+ * The ssim also calculates the mean SSIM index of each plane and the PSNR of
+ * each plane and of the whole frame, and emits them as a "SSIM" element
+ * message for every frame. If #GstSSim:aggregate-frames is set, a
+ * "SSIM-aggregate" message summarising that many frames is emitted as well.
+ * Planes are measured in bands of lines spread over
+ * #GstSSim:max-threads threads.
  * ssim is intended to be used with videomeasure_collector element to catch the 
  * events (such as mean SSIM index values) and save them into a file.
  *
@@ -52,6 +56,7 @@
 
 #include "gstvideomeasure.h"
 #include "gstvideomeasure_ssim.h"
+#include <gst/parallel-private.h>
 #include <gst/audio/audio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -137,9 +142,10 @@ gst_ssim_get_type (void)
   return ssim_type;
 }
 
+/* mean, lowest and highest are those of the Y plane, for compatibility */
 static void
-gst_ssim_post_message (GstSSim * ssim, GstBuffer * buffer, gfloat mssim,
-    gfloat lowest, gfloat highest)
+gst_ssim_post_message (GstSSim * ssim, GstSSimOutputContext * c,
+    GstBuffer * buffer, GstVideoMeasurePlaneResult * planes, gdouble psnr)
 {
   GstMessage *m;
   guint64 offset;
@@ -148,19 +154,96 @@ gst_ssim_post_message (GstSSim * ssim, GstBuffer * buffer, gfloat mssim,
 
   m = gst_message_new_element (GST_OBJECT_CAST (ssim),
       gst_structure_new ("SSIM",
+          "stream", G_TYPE_STRING, GST_PAD_NAME (c->pad),
           "offset", G_TYPE_UINT64, offset,
           "timestamp", GST_TYPE_CLOCK_TIME, GST_BUFFER_TIMESTAMP (buffer),
-          "mean", G_TYPE_FLOAT, mssim,
-          "lowest", G_TYPE_FLOAT, lowest,
-          "highest", G_TYPE_FLOAT, highest, NULL));
+          "mean", G_TYPE_FLOAT, (gfloat) planes[0].ssim_mean,
+          "lowest", G_TYPE_FLOAT, planes[0].ssim_lowest,
+          "highest", G_TYPE_FLOAT, planes[0].ssim_highest,
+          "ssim-y", G_TYPE_DOUBLE, planes[0].ssim_mean,
+          "ssim-u", G_TYPE_DOUBLE, planes[1].ssim_mean,
+          "ssim-v", G_TYPE_DOUBLE, planes[2].ssim_mean,
+          "psnr-y", G_TYPE_DOUBLE, planes[0].psnr,
+          "psnr-u", G_TYPE_DOUBLE, planes[1].psnr,
+          "psnr-v", G_TYPE_DOUBLE, planes[2].psnr,
+          "psnr", G_TYPE_DOUBLE, psnr, NULL));
 
   GST_DEBUG_OBJECT (GST_OBJECT (ssim), "Frame %" G_GINT64_FORMAT
-      " @ %" GST_TIME_FORMAT " mean SSIM is %f, l-h is %f-%f", offset,
-      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)), mssim, lowest, highest);
+      " @ %" GST_TIME_FORMAT " mean SSIM is %f, l-h is %f-%f, PSNR %f dB",
+      offset, GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)),
+      planes[0].ssim_mean, planes[0].ssim_lowest, planes[0].ssim_highest,
+      psnr);
 
   gst_element_post_message (GST_ELEMENT_CAST (ssim), m);
 }
 
+static void
+gst_ssim_reset_aggregate (GstSSimOutputContext * c)
+{
+  c->agg_frames = 0;
+  c->agg_start = GST_CLOCK_TIME_NONE;
+  c->agg_ssim_sum = 0;
+  c->agg_ssim_lowest = G_MAXFLOAT;
+  c->agg_ssim_highest = -G_MAXFLOAT;
+  c->agg_mse_sum = 0;
+  c->agg_psnr_lowest = G_MAXDOUBLE;
+}
+
+/* summarises the frames measured since the last aggregate. the PSNR is
+ * that of the mean squared error over all of them, not the mean PSNR */
+static void
+gst_ssim_post_aggregate (GstSSim * ssim, GstSSimOutputContext * c)
+{
+  GstMessage *m;
+  gdouble mean, psnr;
+
+  if (c->agg_frames == 0)
+    return;
+
+  mean = c->agg_ssim_sum / c->agg_frames;
+  psnr = gst_video_measure_psnr (c->agg_mse_sum / c->agg_frames);
+
+  m = gst_message_new_element (GST_OBJECT_CAST (ssim),
+      gst_structure_new ("SSIM-aggregate",
+          "stream", G_TYPE_STRING, GST_PAD_NAME (c->pad),
+          "timestamp", GST_TYPE_CLOCK_TIME, c->agg_start,
+          "frames", G_TYPE_UINT, c->agg_frames,
+          "mean", G_TYPE_DOUBLE, mean,
+          "lowest", G_TYPE_FLOAT, c->agg_ssim_lowest,
+          "highest", G_TYPE_FLOAT, c->agg_ssim_highest,
+          "psnr", G_TYPE_DOUBLE, psnr,
+          "psnr-lowest", G_TYPE_DOUBLE, c->agg_psnr_lowest, NULL));
+
+  GST_DEBUG_OBJECT (ssim, "%u frames @ %" GST_TIME_FORMAT " on %s: mean SSIM "
+      "is %f, PSNR %f dB", c->agg_frames, GST_TIME_ARGS (c->agg_start),
+      GST_PAD_NAME (c->pad), mean, psnr);
+
+  gst_element_post_message (GST_ELEMENT_CAST (ssim), m);
+
+  gst_ssim_reset_aggregate (c);
+}
+
+static void
+gst_ssim_update_aggregate (GstSSim * ssim, GstSSimOutputContext * c,
+    GstBuffer * buffer, GstVideoMeasurePlaneResult * luma, gdouble mse,
+    gdouble psnr)
+{
+  if (ssim->aggregate_frames == 0)
+    return;
+
+  if (c->agg_frames == 0)
+    c->agg_start = GST_BUFFER_TIMESTAMP (buffer);
+  c->agg_frames++;
+  c->agg_ssim_sum += luma->ssim_mean;
+  c->agg_ssim_lowest = MIN (c->agg_ssim_lowest, luma->ssim_mean);
+  c->agg_ssim_highest = MAX (c->agg_ssim_highest, luma->ssim_mean);
+  c->agg_mse_sum += mse;
+  c->agg_psnr_lowest = MIN (c->agg_psnr_lowest, psnr);
+
+  if (c->agg_frames >= ssim->aggregate_frames)
+    gst_ssim_post_aggregate (ssim, c);
+}
+
 static GstCaps *
 gst_ssim_src_getcaps (GstPad * pad)
 {
@@ -195,287 +278,6 @@ gst_ssim_sink_getcaps (GstPad * pad)
   return result;
 }
 
-static void
-calculate_mu (GstSSim * ssim, gfloat * outmu, guint8 * buf)
-{
-  gint oy, ox, iy, ix;
-
-  for (oy = 0; oy < ssim->height; oy++) {
-    for (ox = 0; ox < ssim->width; ox++) {
-      gfloat mu = 0;
-      gfloat elsumm;
-      gint weight_y_base, weight_x_base;
-      gint weight_offset;
-      gint pixel_offset;
-      gint winstart_y;
-      gint wghstart_y;
-      gint winend_y;
-      gint winstart_x;
-      gint wghstart_x;
-      gint winend_x;
-      gfloat weight;
-      gint source_offset;
-
-      source_offset = oy * ssim->width + ox;
-
-      winstart_x = ssim->windows[source_offset].x_window_start;
-      wghstart_x = ssim->windows[source_offset].x_weight_start;
-      winend_x = ssim->windows[source_offset].x_window_end;
-      winstart_y = ssim->windows[source_offset].y_window_start;
-      wghstart_y = ssim->windows[source_offset].y_weight_start;
-      winend_y = ssim->windows[source_offset].y_window_end;
-      elsumm = ssim->windows[source_offset].element_summ;
-
-      switch (ssim->windowtype) {
-        case 0:
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * ssim->width;
-            for (ix = winstart_x; ix <= winend_x; ix++)
-              mu += buf[pixel_offset + ix];
-          }
-          mu = mu / elsumm;
-          break;
-        case 1:
-
-          weight_y_base = wghstart_y - winstart_y;
-          weight_x_base = wghstart_x - winstart_x;
-
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * ssim->width;
-            weight_offset = (weight_y_base + iy) * ssim->windowsize +
-                weight_x_base;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              weight = ssim->weights[weight_offset + ix];
-              mu += weight * buf[pixel_offset + ix];
-            }
-          }
-          mu = mu / elsumm;
-          break;
-      }
-      outmu[oy * ssim->width + ox] = mu;
-    }
-  }
-
-}
-
-static void
-calcssim_without_mu (GstSSim * ssim, guint8 * org, gfloat * orgmu, guint8 * mod,
-    guint8 * out, gfloat * mean, gfloat * lowest, gfloat * highest)
-{
-  gint oy, ox, iy, ix;
-  gfloat cumulative_ssim = 0;
-  *lowest = G_MAXFLOAT;
-  *highest = -G_MAXFLOAT;
-
-  for (oy = 0; oy < ssim->height; oy++) {
-    for (ox = 0; ox < ssim->width; ox++) {
-      gfloat mu_o = 128, mu_m = 128;
-      gdouble sigma_o = 0, sigma_m = 0, sigma_om = 0;
-      gfloat tmp1 = 0, tmp2 = 0;
-      gfloat elsumm = 0;
-      gint weight_y_base, weight_x_base;
-      gint weight_offset;
-      gint pixel_offset;
-      gint winstart_y;
-      gint wghstart_y;
-      gint winend_y;
-      gint winstart_x;
-      gint wghstart_x;
-      gint winend_x;
-      gfloat weight;
-      gint source_offset;
-
-      source_offset = oy * ssim->width + ox;
-
-      winstart_x = ssim->windows[source_offset].x_window_start;
-      wghstart_x = ssim->windows[source_offset].x_weight_start;
-      winend_x = ssim->windows[source_offset].x_window_end;
-      winstart_y = ssim->windows[source_offset].y_window_start;
-      wghstart_y = ssim->windows[source_offset].y_weight_start;
-      winend_y = ssim->windows[source_offset].y_window_end;
-      elsumm = ssim->windows[source_offset].element_summ;
-
-      weight_y_base = wghstart_y - winstart_y;
-      weight_x_base = wghstart_x - winstart_x;
-      switch (ssim->windowtype) {
-        case 0:
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            guint8 *org_with_offset, *mod_with_offset;
-            pixel_offset = iy * ssim->width;
-            org_with_offset = &org[pixel_offset];
-            mod_with_offset = &mod[pixel_offset];
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              tmp1 = org_with_offset[ix] - mu_o;
-              sigma_o += tmp1 * tmp1;
-              tmp2 = mod_with_offset[ix] - mu_m;
-              sigma_m += tmp2 * tmp2;
-              sigma_om += tmp1 * tmp2;
-            }
-          }
-          break;
-        case 1:
-
-          weight_y_base = wghstart_y - winstart_y;
-          weight_x_base = wghstart_x - winstart_x;
-
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            guint8 *org_with_offset, *mod_with_offset;
-            gfloat *weights_with_offset;
-            gfloat wt1, wt2;
-            pixel_offset = iy * ssim->width;
-            weight_offset = (weight_y_base + iy) * ssim->windowsize +
-                weight_x_base;
-            org_with_offset = &org[pixel_offset];
-            mod_with_offset = &mod[pixel_offset];
-            weights_with_offset = &ssim->weights[weight_offset];
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              weight = weights_with_offset[ix];
-              tmp1 = org_with_offset[ix] - mu_o;
-              tmp2 = mod_with_offset[ix] - mu_m;
-              wt1 = weight * tmp1;
-              wt2 = weight * tmp2;
-              sigma_o += wt1 * tmp1;
-              sigma_m += wt2 * tmp2;
-              sigma_om += wt1 * tmp2;
-            }
-          }
-          break;
-      }
-      sigma_o = sqrt (sigma_o / elsumm);
-      sigma_m = sqrt (sigma_m / elsumm);
-      sigma_om = sigma_om / elsumm;
-      tmp1 = (2 * mu_o * mu_m + ssim->const1) * (2 * sigma_om + ssim->const2) /
-          ((mu_o * mu_o + mu_m * mu_m + ssim->const1) *
-          (sigma_o * sigma_o + sigma_m * sigma_m + ssim->const2));
-
-      /* SSIM can go negative, that's why it is
-         127 + index * 128 instead of index * 255 */
-      out[oy * ssim->width + ox] = 127 + tmp1 * 128;
-      *lowest = MIN (*lowest, tmp1);
-      *highest = MAX (*highest, tmp1);
-      cumulative_ssim += tmp1;
-    }
-  }
-  *mean = cumulative_ssim / (ssim->width * ssim->height);
-}
-
-static void
-calcssim_canonical (GstSSim * ssim, guint8 * org, gfloat * orgmu, guint8 * mod,
-    guint8 * out, gfloat * mean, gfloat * lowest, gfloat * highest)
-{
-  gint oy, ox, iy, ix;
-  gfloat cumulative_ssim = 0;
-  *lowest = G_MAXFLOAT;
-  *highest = -G_MAXFLOAT;
-
-  for (oy = 0; oy < ssim->height; oy++) {
-    for (ox = 0; ox < ssim->width; ox++) {
-      gfloat mu_o = 0, mu_m = 0;
-      gdouble sigma_o = 0, sigma_m = 0, sigma_om = 0;
-      gfloat tmp1, tmp2;
-      gfloat elsumm = 0;
-      gint weight_y_base, weight_x_base;
-      gint weight_offset;
-      gint pixel_offset;
-      gint winstart_y;
-      gint wghstart_y;
-      gint winend_y;
-      gint winstart_x;
-      gint wghstart_x;
-      gint winend_x;
-      gfloat weight;
-      gint source_offset;
-
-      source_offset = oy * ssim->width + ox;
-
-      winstart_x = ssim->windows[source_offset].x_window_start;
-      wghstart_x = ssim->windows[source_offset].x_weight_start;
-      winend_x = ssim->windows[source_offset].x_window_end;
-      winstart_y = ssim->windows[source_offset].y_window_start;
-      wghstart_y = ssim->windows[source_offset].y_weight_start;
-      winend_y = ssim->windows[source_offset].y_window_end;
-      elsumm = ssim->windows[source_offset].element_summ;
-
-      switch (ssim->windowtype) {
-        case 0:
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * ssim->width;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              mu_m += mod[pixel_offset + ix];
-            }
-          }
-          mu_m = mu_m / elsumm;
-          mu_o = orgmu[oy * ssim->width + ox];
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * ssim->width;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              tmp1 = org[pixel_offset + ix] - mu_o;
-              tmp2 = mod[pixel_offset + ix] - mu_m;
-              sigma_o += tmp1 * tmp1;
-              sigma_m += tmp2 * tmp2;
-              sigma_om += tmp1 * tmp2;
-            }
-          }
-          break;
-        case 1:
-
-          weight_y_base = wghstart_y - winstart_y;
-          weight_x_base = wghstart_x - winstart_x;
-
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * ssim->width;
-            weight_offset = (weight_y_base + iy) * ssim->windowsize +
-                weight_x_base;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              weight = ssim->weights[weight_offset + ix];
-              mu_o += weight * org[pixel_offset + ix];
-              mu_m += weight * mod[pixel_offset + ix];
-            }
-          }
-          mu_m = mu_m / elsumm;
-          mu_o = orgmu[oy * ssim->width + ox];
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            gfloat *weights_with_offset;
-            guint8 *org_with_offset, *mod_with_offset;
-            gfloat wt1, wt2;
-            pixel_offset = iy * ssim->width;
-            weight_offset = (weight_y_base + iy) * ssim->windowsize +
-                weight_x_base;
-            weights_with_offset = &ssim->weights[weight_offset];
-            org_with_offset = &org[pixel_offset];
-            mod_with_offset = &mod[pixel_offset];
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              weight = weights_with_offset[ix];
-              tmp1 = org_with_offset[ix] - mu_o;
-              tmp2 = mod_with_offset[ix] - mu_m;
-              wt1 = weight * tmp1;
-              wt2 = weight * tmp2;
-              sigma_o += wt1 * tmp1;
-              sigma_m += wt2 * tmp2;
-              sigma_om += wt1 * tmp2;
-            }
-          }
-          break;
-      }
-      sigma_o = sqrt (sigma_o / elsumm);
-      sigma_m = sqrt (sigma_m / elsumm);
-      sigma_om = sigma_om / elsumm;
-      tmp1 = (2 * mu_o * mu_m + ssim->const1) * (2 * sigma_om + ssim->const2) /
-          ((mu_o * mu_o + mu_m * mu_m + ssim->const1) *
-          (sigma_o * sigma_o + sigma_m * sigma_m + ssim->const2));
-
-      /* SSIM can go negative, that's why it is
-         127 + index * 128 instead of index * 255 */
-      out[oy * ssim->width + ox] = 127 + tmp1 * 128;
-      *lowest = MIN (*lowest, tmp1);
-      *highest = MAX (*highest, tmp1);
-      cumulative_ssim += tmp1;
-    }
-  }
-  *mean = cumulative_ssim / (ssim->width * ssim->height);
-}
-
-
 /* the first caps we receive on any of the sinkpads will define the caps for all
  * the other sinkpads because we can only measure streams with the same caps.
  */
@@ -502,6 +304,8 @@ gst_ssim_setcaps (GstPad * pad, GstCaps * caps)
 
   GST_OBJECT_LOCK (ssim);
 
+  ssim->format = gst_video_format_from_fourcc (fourcc);
+
   /* Sink caps are stored only once. At the moment it doesn't feel
    * right to measure streams with variable caps.
    */
@@ -1012,21 +816,26 @@ gst_ssim_set_property (GObject * object, guint prop_id,
   switch (prop_id) {
     case PROP_SSIM_TYPE:
       ssim->ssimtype = g_value_get_int (value);
+      ssim->reconfigure = TRUE;
       break;
     case PROP_WINDOW_TYPE:
       ssim->windowtype = g_value_get_int (value);
-      g_free (ssim->windows);
-      ssim->windows = NULL;
+      ssim->reconfigure = TRUE;
       break;
     case PROP_WINDOW_SIZE:
       ssim->windowsize = g_value_get_int (value);
-      g_free (ssim->windows);
-      ssim->windows = NULL;
+      ssim->reconfigure = TRUE;
       break;
     case PROP_GAUSS_SIGMA:
       ssim->sigma = g_value_get_float (value);
-      g_free (ssim->windows);
-      ssim->windows = NULL;
+      ssim->reconfigure = TRUE;
+      break;
+    case PROP_MAX_THREADS:
+      ssim->max_threads = g_value_get_uint (value);
+      ssim->reconfigure = TRUE;
+      break;
+    case PROP_AGGREGATE_FRAMES:
+      ssim->aggregate_frames = g_value_get_uint (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -1055,6 +864,12 @@ gst_ssim_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_GAUSS_SIGMA:
       g_value_set_float (value, ssim->sigma);
       break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, ssim->max_threads);
+      break;
+    case PROP_AGGREGATE_FRAMES:
+      g_value_set_uint (value, ssim->aggregate_frames);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1074,8 +889,7 @@ gst_ssim_class_init (GstSSimClass * klass)
 
   g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_SSIM_TYPE,
       g_param_spec_int ("ssim-type", "SSIM type",
-          "Type of the SSIM metric. 0 - canonical. 1 - with fixed mu "
-          "(almost the same results, but roughly 20% faster)",
+          "Type of the SSIM metric. 0 - canonical. 1 - with fixed mu",
           0, 1, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_WINDOW_TYPE,
@@ -1095,6 +909,19 @@ gst_ssim_class_init (GstSSimClass * klass)
           "(only when using Gaussian window).",
           G_MINFLOAT, 10, 1.5, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum threads",
+          "Maximum number of threads used for measuring (0 = automatic)",
+          0, GST_PARALLEL_MAX_THREADS, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_AGGREGATE_FRAMES, g_param_spec_uint ("aggregate-frames",
+          "Aggregate frames",
+          "Number of frames summarised by each SSIM-aggregate message "
+          "(0 = no aggregates)", 0, G_MAXUINT, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&gst_ssim_src_template));
   gst_element_class_add_pad_template (gstelement_class,
@@ -1103,7 +930,7 @@ gst_ssim_class_init (GstSSimClass * klass)
       gst_static_pad_template_get (&gst_ssim_sink_modified_template));
   gst_element_class_set_static_metadata (gstelement_class, "SSim",
       "Filter/Analyzer/Video",
-      "Calculate Y-SSIM for n+2 YUV video streams",
+      "Calculate SSIM and PSNR for n+2 YUV video streams",
       "Руслан Ижбулатов <lrn1986 _at_ gmail _dot_ com>");
 
   parent_class = g_type_class_peek_parent (klass);
@@ -1200,8 +1027,9 @@ gst_ssim_request_new_pad (GstElement * element, GstPadTemplate * templ,
     if (!gst_element_add_pad (GST_ELEMENT (ssim), newsrc))
       goto could_not_add_src;
 
-    c = g_new (GstSSimOutputContext, 1);
+    c = g_new0 (GstSSimOutputContext, 1);
     c->pad = newsrc;
+    gst_ssim_reset_aggregate (c);
     g_object_set_data (G_OBJECT (newpad), "ssim-match-output-context", c);
     g_ptr_array_add (ssim->src, (gpointer) c);
   }
@@ -1259,9 +1087,12 @@ gst_ssim_init (GstSSim * ssim)
 {
   ssim->windowsize = 11;
   ssim->windowtype = 1;
-  ssim->windows = NULL;
   ssim->sigma = 1.5;
   ssim->ssimtype = 0;
+  ssim->max_threads = 0;
+  ssim->aggregate_frames = 0;
+  ssim->engine = gst_video_measure_engine_new ();
+  ssim->reconfigure = TRUE;
   ssim->src = g_ptr_array_new ();
   ssim->padcount = 0;
   ssim->collect_event = NULL;
@@ -1281,11 +1112,8 @@ gst_ssim_finalize (GObject * object)
   gst_object_unref (ssim->collect);
   ssim->collect = NULL;
 
-  g_free (ssim->windows);
-  ssim->windows = NULL;
-
-  g_free (ssim->weights);
-  ssim->weights = NULL;
+  gst_video_measure_engine_free (ssim->engine);
+  ssim->engine = NULL;
 
   if (ssim->sinkcaps)
     gst_caps_unref (ssim->sinkcaps);
@@ -1297,114 +1125,55 @@ gst_ssim_finalize (GObject * object)
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
-typedef gfloat (*GstSSimWeightFunc) (GstSSim * ssim, gint y, gint x);
-
-static gfloat
-gst_ssim_weight_func_none (GstSSim * ssim, gint y, gint x)
-{
-  return 1;
-}
-
-static gfloat
-gst_ssim_weight_func_gauss (GstSSim * ssim, gint y, gint x)
-{
-  gfloat coord = sqrt (x * x + y * y);
-  return exp (-1 * (coord * coord) / (2 * ssim->sigma * ssim->sigma)) /
-      (ssim->sigma * sqrt (2 * G_PI));
-}
-
 static gboolean
-gst_ssim_regenerate_windows (GstSSim * ssim)
+gst_ssim_configure_engine (GstSSim * ssim)
 {
-  gint windowiseven;
-  gint y, x, y2, x2;
-  GstSSimWeightFunc func;
-  gfloat normal_summ = 0;
-  gint normal_count = 0;
-
-  g_free (ssim->weights);
-
-  ssim->weights = g_new (gfloat, ssim->windowsize * ssim->windowsize);
-
-  windowiseven = ((gint) ssim->windowsize / 2) * 2 == ssim->windowsize ? 1 : 0;
-
-  g_free (ssim->windows);
-
-  ssim->windows = g_new (GstSSimWindowCache, ssim->height * ssim->width);
-
-  switch (ssim->windowtype) {
-    case 0:
-      func = gst_ssim_weight_func_none;
-      break;
-    case 1:
-      func = gst_ssim_weight_func_gauss;
-      break;
-    default:
-      GST_WARNING_OBJECT (ssim, "unknown window type - %d. Defaulting to %d",
-          ssim->windowtype, 1);
-      ssim->windowtype = 1;
-      func = gst_ssim_weight_func_gauss;
-  }
-
-  for (y = 0; y < ssim->windowsize; y++) {
-    gint yoffset = y * ssim->windowsize;
-    for (x = 0; x < ssim->windowsize; x++) {
-      ssim->weights[yoffset + x] = func (ssim, x - ssim->windowsize / 2 +
-          windowiseven, y - ssim->windowsize / 2 + windowiseven);
-      normal_summ += ssim->weights[yoffset + x];
-      normal_count++;
-    }
+  if (ssim->windowtype != GST_VIDEO_MEASURE_WINDOW_BOX &&
+      ssim->windowtype != GST_VIDEO_MEASURE_WINDOW_GAUSS) {
+    GST_WARNING_OBJECT (ssim, "unknown window type - %d. Defaulting to %d",
+        ssim->windowtype, 1);
+    ssim->windowtype = GST_VIDEO_MEASURE_WINDOW_GAUSS;
   }
 
-  for (y = 0; y < ssim->height; y++) {
-    for (x = 0; x < ssim->width; x++) {
-      GstSSimWindowCache win;
-      gint element_count = 0;
-
-      win.x_window_start = x - ssim->windowsize / 2 + windowiseven;
-      win.x_weight_start = 0;
-      if (win.x_window_start < 0) {
-        win.x_weight_start = -win.x_window_start;
-        win.x_window_start = 0;
-      }
+  GST_DEBUG_OBJECT (ssim, "measuring with window type %d, size %d, "
+      "max %u threads", ssim->windowtype, ssim->windowsize,
+      ssim->max_threads);
 
-      win.x_window_end = x + ssim->windowsize / 2;
-      if (win.x_window_end >= ssim->width)
-        win.x_window_end = ssim->width - 1;
+  ssim->reconfigure = FALSE;
 
-      win.y_window_start = y - ssim->windowsize / 2 + windowiseven;
-      win.y_weight_start = 0;
-      if (win.y_window_start < 0) {
-        win.y_weight_start = -win.y_window_start;
-        win.y_window_start = 0;
-      }
+  return gst_video_measure_engine_configure (ssim->engine, ssim->windowtype,
+      ssim->windowsize, ssim->sigma, ssim->ssimtype == 1, ssim->max_threads);
+}
 
-      win.y_window_end = y + ssim->windowsize / 2;
-      if (win.y_window_end >= ssim->height)
-        win.y_window_end = ssim->height - 1;
-
-      win.element_summ = 0;
-      element_count = (win.y_window_end - win.y_window_start + 1) *
-          (win.x_window_end - win.x_window_start + 1);
-      if (element_count == normal_count)
-        win.element_summ = normal_summ;
-      else {
-        for (y2 = win.y_weight_start; y2 < ssim->windowsize; y2++) {
-          for (x2 = win.x_weight_start; x2 < ssim->windowsize; x2++) {
-            win.element_summ += ssim->weights[y2 * ssim->windowsize + x2];
-          }
-        }
-      }
-      ssim->windows[(y * ssim->width + x)] = win;
-    }
+/* measures all three planes of mod against org. the SSIM map of the Y plane
+ * is written to out. returns the mean squared error over all samples */
+static gdouble
+gst_ssim_measure_frame (GstSSim * ssim, guint8 * org, guint8 * mod,
+    guint8 * out, GstVideoMeasurePlaneResult * planes)
+{
+  guint64 ssd = 0, samples = 0;
+  gint i;
+
+  for (i = 0; i < 3; i++) {
+    gint offset, stride, width, height;
+
+    offset = gst_video_format_get_component_offset (ssim->format, i,
+        ssim->width, ssim->height);
+    stride = gst_video_format_get_row_stride (ssim->format, i, ssim->width);
+    width = gst_video_format_get_component_width (ssim->format, i,
+        ssim->width);
+    height = gst_video_format_get_component_height (ssim->format, i,
+        ssim->height);
+
+    gst_video_measure_engine_measure_plane (ssim->engine, org + offset,
+        stride, mod + offset, stride, width, height, i == 0 ? out : NULL,
+        GST_ROUND_UP_4 (ssim->width), &planes[i]);
+
+    ssd += planes[i].ssd;
+    samples += width * height;
   }
 
-  /* FIXME: while 0.01 and 0.03 are pretty much static, the 255 implies that
-   * we're working with 8-bit-per-color-component format, which may not be true
-   */
-  ssim->const1 = 0.01 * 255 * 0.01 * 255;
-  ssim->const2 = 0.03 * 255 * 0.03 * 255;
-  return TRUE;
+  return (gdouble) ssd / samples;
 }
 
 static GstFlowReturn
@@ -1414,29 +1183,16 @@ gst_ssim_collected (GstCollectPads * pads, gpointer user_data)
   GSList *collected;
   GstFlowReturn ret = GST_FLOW_OK;
   GstBuffer *orgbuf = NULL;
-  gfloat *orgmu = NULL;
   GstBuffer *outbuf = NULL;
   gpointer outdata = NULL;
   guint outsize = 0;
-  gfloat mssim = 0, lowest = 1, highest = -1;
   gboolean ready = TRUE;
   gint padnumber = 0;
 
   ssim = GST_SSIM (user_data);
 
-  if (G_UNLIKELY (ssim->windows == NULL)) {
-    GST_DEBUG_OBJECT (ssim, "Regenerating windows");
-    gst_ssim_regenerate_windows (ssim);
-  }
-
-  switch (ssim->ssimtype) {
-    case 0:
-      ssim->func = (GstSSimFunction) calcssim_canonical;
-      break;
-    case 1:
-      ssim->func = (GstSSimFunction) calcssim_without_mu;
-      break;
-    default:
+  if (G_UNLIKELY (ssim->reconfigure)) {
+    if (!gst_ssim_configure_engine (ssim))
       return GST_FLOW_ERROR;
   }
 
@@ -1464,28 +1220,20 @@ gst_ssim_collected (GstCollectPads * pads, gpointer user_data)
   if (G_UNLIKELY (!ready))
     goto eos;
 
-  /* Mu is just a blur, we can calculate it once */
-  if (ssim->ssimtype == 0) {
-    orgmu = g_new (gfloat, ssim->width * ssim->height);
-
-    for (collected = pads->data; collected;
-        collected = g_slist_next (collected)) {
-      GstCollectData *collect_data;
-
-      collect_data = (GstCollectData *) collected->data;
+  for (collected = pads->data; collected; collected = g_slist_next (collected)) {
+    GstCollectData *collect_data;
 
-      if (collect_data->pad == ssim->orig) {
-        orgbuf = gst_collect_pads_pop (pads, collect_data);
+    collect_data = (GstCollectData *) collected->data;
 
-        GST_DEBUG_OBJECT (ssim, "Original stream - flags(0x%x), timestamp(%"
-            GST_TIME_FORMAT "), duration(%" GST_TIME_FORMAT ")",
-            GST_BUFFER_FLAGS (orgbuf),
-            GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (orgbuf)),
-            GST_TIME_ARGS (GST_BUFFER_DURATION (orgbuf)));
-        calculate_mu (ssim, orgmu, GST_BUFFER_DATA (orgbuf));
+    if (collect_data->pad == ssim->orig) {
+      orgbuf = gst_collect_pads_pop (pads, collect_data);
 
-        break;
-      }
+      GST_DEBUG_OBJECT (ssim, "Original stream - flags(0x%x), timestamp(%"
+          GST_TIME_FORMAT "), duration(%" GST_TIME_FORMAT ")",
+          GST_BUFFER_FLAGS (orgbuf),
+          GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (orgbuf)),
+          GST_TIME_ARGS (GST_BUFFER_DURATION (orgbuf)));
+      break;
     }
   }
 
@@ -1512,6 +1260,8 @@ gst_ssim_collected (GstCollectPads * pads, gpointer user_data)
       if (!GST_BUFFER_FLAG_IS_SET (inbuf, GST_BUFFER_FLAG_GAP)) {
         GstSSimOutputContext *c;
         GstEvent *measured;
+        GstVideoMeasurePlaneResult planes[3];
+        gdouble mse, psnr;
         guint64 offset;
         GValue vmean = { 0 }
         , vlowest = {
@@ -1553,17 +1303,20 @@ gst_ssim_collected (GstCollectPads * pads, gpointer user_data)
 
         GST_LOG_OBJECT (ssim, "channel %p: calculating SSIM", collect_data);
 
-        ssim->func (ssim, GST_BUFFER_DATA (orgbuf), orgmu, indata, outdata,
-            &mssim, &lowest, &highest);
+        mse = gst_ssim_measure_frame (ssim, GST_BUFFER_DATA (orgbuf), indata,
+            outdata, planes);
+        psnr = gst_video_measure_psnr (mse);
 
         GST_DEBUG_OBJECT (GST_OBJECT (ssim), "MSSIM is %f, l-h is %f - %f",
-            mssim, lowest, highest);
+            planes[0].ssim_mean, planes[0].ssim_lowest,
+            planes[0].ssim_highest);
 
-        gst_ssim_post_message (ssim, outbuf, mssim, lowest, highest);
+        gst_ssim_post_message (ssim, c, outbuf, planes, psnr);
+        gst_ssim_update_aggregate (ssim, c, outbuf, &planes[0], mse, psnr);
 
-        g_value_set_float (&vmean, mssim);
-        g_value_set_float (&vlowest, lowest);
-        g_value_set_float (&vhighest, highest);
+        g_value_set_float (&vmean, planes[0].ssim_mean);
+        g_value_set_float (&vlowest, planes[0].ssim_lowest);
+        g_value_set_float (&vhighest, planes[0].ssim_highest);
         offset = GST_BUFFER_OFFSET (inbuf);
 
         /* our timestamping is very simple, just an ever incrementing
@@ -1613,9 +1366,6 @@ gst_ssim_collected (GstCollectPads * pads, gpointer user_data)
   }
   gst_buffer_unref (orgbuf);
 
-  if (ssim->ssimtype == 0)
-    g_free (orgmu);
-
   ssim->segment_position = 0;
 
   return ret;
@@ -1628,6 +1378,7 @@ eos:
     for (i = 0; i < ssim->src->len; i++) {
       GstSSimOutputContext *c =
           (GstSSimOutputContext *) g_ptr_array_index (ssim->src, i);
+      gst_ssim_post_aggregate (ssim, c);
       gst_pad_push_event (c->pad, gst_event_new_eos ());
     }
 
@@ -1655,6 +1406,7 @@ gst_ssim_change_state (GstElement * element, GstStateChange transition)
         for (i = 0; i < ssim->src->len; i++) {
           c = (GstSSimOutputContext *) g_ptr_array_index (ssim->src, i);
           c->segment_pending = TRUE;
+          gst_ssim_reset_aggregate (c);
         }
       }
       ssim->segment_position = 0;
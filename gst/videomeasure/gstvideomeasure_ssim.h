@@ -24,6 +24,8 @@
 #include <gst/base/gstcollectpads.h>
 #include <gst/video/video.h>
 
+#include "gstvideomeasure_engine.h"
+
 G_BEGIN_DECLS
 
 enum
@@ -33,6 +35,8 @@ enum
   PROP_WINDOW_TYPE,
   PROP_WINDOW_SIZE,
   PROP_GAUSS_SIGMA,
+  PROP_MAX_THREADS,
+  PROP_AGGREGATE_FRAMES
 };
 
 
@@ -51,25 +55,21 @@ enum
 typedef struct _GstSSim             GstSSim;
 typedef struct _GstSSimClass        GstSSimClass;
 
-typedef struct _GstSSimWindowCache {
-  gint x_window_start;
-  gint x_weight_start;
-  gint x_window_end;
-  gint y_window_start;
-  gint y_weight_start;
-  gint y_window_end;
-  gfloat element_summ;
-} GstSSimWindowCache;
-
-typedef void (*GstSSimFunction) (GstSSim *ssim, guint8 *org, gfloat *orgmu,
-    guint8 *mod, guint8 *out, gfloat *mean, gfloat *lowest, gfloat *highest);
-
 typedef struct _GstSSimOutputContext GstSSimOutputContext;
 
 /* TODO: check if all fields are used */
 struct _GstSSimOutputContext {
   GstPad       *pad;
   gboolean      segment_pending;
+
+  /* aggregate of the frames measured since the last SSIM-aggregate message */
+  guint         agg_frames;
+  GstClockTime  agg_start;
+  gdouble       agg_ssim_sum;
+  gfloat        agg_ssim_lowest;
+  gfloat        agg_ssim_highest;
+  gdouble       agg_mse_sum;
+  gdouble       agg_psnr_lowest;
 };
 
 /**
@@ -92,6 +92,7 @@ struct _GstSSim {
   gint            frame_rate_base;
   gint            width;
   gint            height;
+  GstVideoFormat  format;
   GstCaps        *sinkcaps;
   GstCaps        *srccaps;
 
@@ -104,19 +105,18 @@ struct _GstSSim {
   /* Type of a weight-generator. 0 - no weighting. 1 - Gaussian weighting */
   gint            windowtype;
 
-  /* Array of width*height GstSSimWindowCaches */
-  GstSSimWindowCache *windows;
-
-  /* Array of windowsize*windowsize gfloats */
-  gfloat         *weights;
-
   /* For Gaussian function */
   gfloat          sigma;
-  
-  GstSSimFunction func;
 
-  gfloat         const1;
-  gfloat         const2;
+  /* Maximum number of threads, 0 - one per CPU */
+  guint           max_threads;
+
+  /* Number of frames per SSIM-aggregate message, 0 - no aggregates */
+  guint           aggregate_frames;
+
+  GstVideoMeasureEngine *engine;
+  /* the engine needs to be configured before measuring the next frame */
+  gboolean        reconfigure;
 
   /* counters to keep track of timestamps */
   gint64          timestamp;
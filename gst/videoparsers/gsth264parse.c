@@ -410,9 +410,12 @@ gst_h264_parse_negotiate (GstH264Parse * h264parse, gint in_format,
       align == GST_H264_PARSE_ALIGN_AU;
 }
 
+/* prefixes @size bytes of NAL payload at @offset in @src as required by
+ * @format; the payload memory is shared with @src, only the start code or
+ * length prefix is newly allocated */
 static GstBuffer *
-gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
-    guint size)
+gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format,
+    GstBuffer * src, guint offset, guint size)
 {
   GstBuffer *buf;
   guint nl = h264parse->nal_length_size;
@@ -420,7 +423,6 @@ gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
 
   GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
 
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H264_PARSE_FORMAT_AVC
       || format == GST_H264_PARSE_FORMAT_AVC3) {
     tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
@@ -432,9 +434,9 @@ gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
     tmp = GUINT32_TO_BE (1);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
-  gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
+  buf = gst_buffer_new_allocate (NULL, nl, NULL);
+  gst_buffer_fill (buf, 0, &tmp, nl);
+  gst_buffer_copy_into (buf, src, GST_BUFFER_COPY_MEMORY, offset, size);
 
   return buf;
 }
@@ -688,7 +690,8 @@ gst_h264_parse_process_sei (GstH264Parse * h264parse, GstH264NalUnit * nalu)
 
 /* caller guarantees 2 bytes of nal payload */
 static gboolean
-gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
+gst_h264_parse_process_nal (GstH264Parse * h264parse, GstBuffer * buffer,
+    GstH264NalUnit * nalu)
 {
   guint nal_type;
   GstH264PPS pps = { 0, };
@@ -820,8 +823,9 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       {
         GstH264SliceHdr slice;
 
-        pres = gst_h264_parser_parse_slice_hdr (nalparser, nalu, &slice,
-            FALSE, FALSE);
+        /* only the slice type and field_pic_flag are needed */
+        pres = gst_h264_parser_parse_slice_hdr_light (nalparser, nalu,
+            &slice);
         GST_DEBUG_OBJECT (h264parse,
             "parse result %d, first MB: %u, slice type: %u",
             pres, slice.first_mb_in_slice, slice.type);
@@ -871,10 +875,21 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
    * and use that to replace outgoing buffer data later on */
   if (h264parse->transform) {
     GstBuffer *buf;
+    guint prefix = nalu->offset - nalu->sc_offset;
+    gboolean bs = h264parse->format == GST_H264_PARSE_FORMAT_BYTE;
 
     GST_LOG_OBJECT (h264parse, "collecting NAL in AVC frame");
-    buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-        nalu->data + nalu->offset, nalu->size);
+    /* a 4 byte start code or a length prefix of the output size can be
+     * passed on as is, along with the payload */
+    if ((bs && !h264parse->packetized && prefix == 4) ||
+        (!bs && h264parse->packetized &&
+            prefix == h264parse->nal_length_size)) {
+      buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+          nalu->sc_offset, prefix + nalu->size);
+    } else {
+      buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format, buffer,
+          nalu->offset, nalu->size);
+    }
     gst_adapter_push (h264parse->frame_out, buf);
   }
   return TRUE;
@@ -967,7 +982,7 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h264parse, "AVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
-    gst_h264_parse_process_nal (h264parse, &nalu);
+    gst_h264_parse_process_nal (h264parse, buffer, &nalu);
 
     /* dispatch per NALU if needed */
     if (h264parse->split_packetized) {
@@ -1185,7 +1200,7 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
       }
     }
 
-    if (!gst_h264_parse_process_nal (h264parse, &nalu)) {
+    if (!gst_h264_parse_process_nal (h264parse, buffer, &nalu)) {
       GST_WARNING_OBJECT (h264parse,
           "broken/invalid nal Type: %d %s, Size: %u will be dropped",
           nalu.type, _nal_name (nalu.type), nalu.size);
@@ -2045,12 +2060,13 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     h264parse->discont = FALSE;
   }
 
-  /* replace with transformed AVC output if applicable */
+  /* replace with transformed AVC output if applicable, which merely
+   * references the collected NALs' memory */
   av = gst_adapter_available (h264parse->frame_out);
   if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h264parse->frame_out, av);
+    buf = gst_adapter_take_buffer_fast (h264parse->frame_out, av);
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -2065,12 +2081,8 @@ static GstFlowReturn
 gst_h264_parse_push_codec_buffer (GstH264Parse * h264parse,
     GstBuffer * nal, GstClockTime ts)
 {
-  GstMapInfo map;
-
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  nal = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-      map.data, map.size);
-  gst_buffer_unmap (nal, &map);
+  nal = gst_h264_parse_wrap_nal (h264parse, h264parse->format, nal, 0,
+      gst_buffer_get_size (nal));
 
   GST_BUFFER_TIMESTAMP (nal) = ts;
   GST_BUFFER_DURATION (nal) = 0;
@@ -2273,54 +2285,34 @@ gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
             }
           }
         } else {
-          /* insert config NALs into AU */
-          GstByteWriter bw;
+          /* insert config NALs into AU, by reference to the frame and
+           * stored NALs' memory */
           GstBuffer *new_buf;
-          const gboolean bs = h264parse->format == GST_H264_PARSE_FORMAT_BYTE;
-          const gint nls = 4 - h264parse->nal_length_size;
-          gboolean ok;
 
-          gst_byte_writer_init_with_size (&bw, gst_buffer_get_size (buffer),
-              FALSE);
-          ok = gst_byte_writer_put_buffer (&bw, buffer, 0, h264parse->idr_pos);
+          new_buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, 0,
+              h264parse->idr_pos);
           GST_DEBUG_OBJECT (h264parse, "- inserting SPS/PPS");
           for (i = 0; i < GST_H264_MAX_SPS_COUNT; i++) {
             if ((codec_nal = h264parse->sps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
               GST_DEBUG_OBJECT (h264parse, "inserting SPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+              new_buf = gst_buffer_append (new_buf,
+                  gst_h264_parse_wrap_nal (h264parse, h264parse->format,
+                      codec_nal, 0, gst_buffer_get_size (codec_nal)));
               h264parse->last_report = new_ts;
             }
           }
           for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++) {
             if ((codec_nal = h264parse->pps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
               GST_DEBUG_OBJECT (h264parse, "inserting PPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+              new_buf = gst_buffer_append (new_buf,
+                  gst_h264_parse_wrap_nal (h264parse, h264parse->format,
+                      codec_nal, 0, gst_buffer_get_size (codec_nal)));
               h264parse->last_report = new_ts;
             }
           }
-          ok &=
-              gst_byte_writer_put_buffer (&bw, buffer, h264parse->idr_pos, -1);
+          new_buf = gst_buffer_append_region (new_buf, gst_buffer_ref (buffer),
+              h264parse->idr_pos, -1);
           /* collect result and push */
-          new_buf = gst_byte_writer_reset_and_get_buffer (&bw);
           gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_METADATA, 0,
               -1);
           /* should already be keyframe/IDR, but it may not have been,
@@ -2328,10 +2320,6 @@ gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
           GST_BUFFER_FLAG_UNSET (new_buf, GST_BUFFER_FLAG_DELTA_UNIT);
           gst_buffer_replace (&frame->out_buffer, new_buf);
           gst_buffer_unref (new_buf);
-          /* some result checking seems to make some compilers happy */
-          if (G_UNLIKELY (!ok)) {
-            GST_ERROR_OBJECT (h264parse, "failed to insert SPS/PPS");
-          }
         }
       }
       /* we pushed whatever we had */
@@ -2492,7 +2480,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, codec_data, &nalu);
       off = nalu.offset + nalu.size;
     }
 
@@ -2507,7 +2495,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, codec_data, &nalu);
       off = nalu.offset + nalu.size;
     }
 
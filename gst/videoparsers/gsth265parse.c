@@ -360,9 +360,12 @@ gst_h265_parse_negotiate (GstH265Parse * h265parse, gint in_format,
   h265parse->transform = (in_format != h265parse->format);
 }
 
+/* prefixes @size bytes of NAL payload at @offset in @src as required by
+ * @format; the payload memory is shared with @src, only the start code or
+ * length prefix is newly allocated */
 static GstBuffer *
-gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format, guint8 * data,
-    guint size)
+gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format,
+    GstBuffer * src, guint offset, guint size)
 {
   GstBuffer *buf;
   guint nl = h265parse->nal_length_size;
@@ -370,7 +373,6 @@ gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format, guint8 * data,
 
   GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
 
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H265_PARSE_FORMAT_HVC1
       || format == GST_H265_PARSE_FORMAT_HEV1) {
     tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
@@ -382,9 +384,9 @@ gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format, guint8 * data,
     tmp = GUINT32_TO_BE (1);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
-  gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
+  buf = gst_buffer_new_allocate (NULL, nl, NULL);
+  gst_buffer_fill (buf, 0, &tmp, nl);
+  gst_buffer_copy_into (buf, src, GST_BUFFER_COPY_MEMORY, offset, size);
 
   return buf;
 }
@@ -485,7 +487,8 @@ _nal_name (GstH265NalUnitType nal_type)
 
 /* caller guarantees 2 bytes of nal payload */
 static void
-gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
+gst_h265_parse_process_nal (GstH265Parse * h265parse, GstBuffer * buffer,
+    GstH265NalUnit * nalu)
 {
   GstH265PPS pps = { 0, };
   GstH265SPS sps = { 0, };
@@ -612,7 +615,8 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
     {
       GstH265SliceHdr slice;
 
-      pres = gst_h265_parser_parse_slice_hdr (nalparser, nalu, &slice);
+      /* only the slice type is needed */
+      pres = gst_h265_parser_parse_slice_hdr_light (nalparser, nalu, &slice);
 
       if (pres == GST_H265_PARSER_OK) {
         if (GST_H265_IS_I_SLICE (&slice))
@@ -663,9 +667,21 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
   if (h265parse->transform) {
     GstBuffer *buf;
 
+    guint prefix = nalu->offset - nalu->sc_offset;
+    gboolean bs = h265parse->format == GST_H265_PARSE_FORMAT_BYTE;
+
     GST_LOG_OBJECT (h265parse, "collecting NAL in HEVC frame");
-    buf = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
-        nalu->data + nalu->offset, nalu->size);
+    /* a 4 byte start code or a length prefix of the output size can be
+     * passed on as is, along with the payload */
+    if ((bs && !h265parse->packetized && prefix == 4) ||
+        (!bs && h265parse->packetized &&
+            prefix == h265parse->nal_length_size)) {
+      buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+          nalu->sc_offset, prefix + nalu->size);
+    } else {
+      buf = gst_h265_parse_wrap_nal (h265parse, h265parse->format, buffer,
+          nalu->offset, nalu->size);
+    }
     gst_adapter_push (h265parse->frame_out, buf);
   }
 }
@@ -756,16 +772,25 @@ gst_h265_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h265parse, "HEVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
-    gst_h265_parse_process_nal (h265parse, &nalu);
+    gst_h265_parse_process_nal (h265parse, buffer, &nalu);
 
     /* dispatch per NALU if needed */
     if (h265parse->split_packetized) {
+      GstBaseParseFrame tmp_frame;
+
+      gst_base_parse_frame_init (&tmp_frame);
+      tmp_frame.flags |= frame->flags;
+      tmp_frame.offset = frame->offset;
+      tmp_frame.overhead = frame->overhead;
+      tmp_frame.buffer = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL,
+          nalu.offset, nalu.size);
+
       /* note we don't need to come up with a sub-buffer, since
        * subsequent code only considers input buffer's metadata.
        * Real data is either taken from input by baseclass or
        * a replacement output buffer is provided anyway. */
-      gst_h265_parse_parse_frame (parse, frame);
-      ret = gst_base_parse_finish_frame (parse, frame, nl + nalu.size);
+      gst_h265_parse_parse_frame (parse, &tmp_frame);
+      ret = gst_base_parse_finish_frame (parse, &tmp_frame, nl + nalu.size);
       left -= nl + nalu.size;
     }
 
@@ -794,7 +819,6 @@ gst_h265_parse_handle_frame_packetized (GstBaseParse * parse,
     if (h265parse->split_packetized) {
       GST_ELEMENT_ERROR (h265parse, STREAM, FAILED, (NULL),
           ("invalid HEVC input data"));
-      gst_buffer_unref (buffer);
 
       return GST_FLOW_ERROR;
     } else {
@@ -963,7 +987,7 @@ gst_h265_parse_handle_frame (GstBaseParse * parse,
         nalu.type == GST_H265_NAL_SPS ||
         nalu.type == GST_H265_NAL_PPS ||
         (h265parse->have_sps && h265parse->have_pps)) {
-      gst_h265_parse_process_nal (h265parse, &nalu);
+      gst_h265_parse_process_nal (h265parse, buffer, &nalu);
     } else {
       GST_WARNING_OBJECT (h265parse,
           "no SPS/PPS yet, nal Type: %d %s, Size: %u will be dropped",
@@ -1513,12 +1537,13 @@ gst_h265_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   else
     GST_BUFFER_FLAG_UNSET (buffer, GST_BUFFER_FLAG_HEADER);
 
-  /* replace with transformed HEVC output if applicable */
+  /* replace with transformed HEVC output if applicable, which merely
+   * references the collected NALs' memory */
   av = gst_adapter_available (h265parse->frame_out);
   if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h265parse->frame_out, av);
+    buf = gst_adapter_take_buffer_fast (h265parse->frame_out, av);
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -1533,12 +1558,8 @@ static GstFlowReturn
 gst_h265_parse_push_codec_buffer (GstH265Parse * h265parse, GstBuffer * nal,
     GstClockTime ts)
 {
-  GstMapInfo map;
-
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  nal = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
-      map.data, map.size);
-  gst_buffer_unmap (nal, &map);
+  nal = gst_h265_parse_wrap_nal (h265parse, h265parse->format, nal, 0,
+      gst_buffer_get_size (nal));
 
   GST_BUFFER_TIMESTAMP (nal) = ts;
   GST_BUFFER_DURATION (nal) = 0;
@@ -1744,71 +1765,43 @@ gst_h265_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
             }
           }
         } else {
-          /* insert config NALs into AU */
-          GstByteWriter bw;
+          /* insert config NALs into AU, by reference to the frame and
+           * stored NALs' memory */
           GstBuffer *new_buf;
-          const gboolean bs = h265parse->format == GST_H265_PARSE_FORMAT_BYTE;
-          const gint nls = 4 - h265parse->nal_length_size;
-          gboolean ok;
 
-          gst_byte_writer_init_with_size (&bw, gst_buffer_get_size (buffer),
-              FALSE);
-          ok = gst_byte_writer_put_buffer (&bw, buffer, 0, h265parse->idr_pos);
+          new_buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, 0,
+              h265parse->idr_pos);
           GST_DEBUG_OBJECT (h265parse, "- inserting VPS/SPS/PPS");
           for (i = 0; i < GST_H265_MAX_VPS_COUNT; i++) {
             if ((codec_nal = h265parse->vps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
               GST_DEBUG_OBJECT (h265parse, "inserting VPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+              new_buf = gst_buffer_append (new_buf,
+                  gst_h265_parse_wrap_nal (h265parse, h265parse->format,
+                      codec_nal, 0, gst_buffer_get_size (codec_nal)));
               h265parse->last_report = new_ts;
             }
           }
           for (i = 0; i < GST_H265_MAX_SPS_COUNT; i++) {
             if ((codec_nal = h265parse->sps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
               GST_DEBUG_OBJECT (h265parse, "inserting SPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+              new_buf = gst_buffer_append (new_buf,
+                  gst_h265_parse_wrap_nal (h265parse, h265parse->format,
+                      codec_nal, 0, gst_buffer_get_size (codec_nal)));
               h265parse->last_report = new_ts;
             }
           }
           for (i = 0; i < GST_H265_MAX_PPS_COUNT; i++) {
             if ((codec_nal = h265parse->pps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
               GST_DEBUG_OBJECT (h265parse, "inserting PPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+              new_buf = gst_buffer_append (new_buf,
+                  gst_h265_parse_wrap_nal (h265parse, h265parse->format,
+                      codec_nal, 0, gst_buffer_get_size (codec_nal)));
               h265parse->last_report = new_ts;
             }
           }
-          ok &=
-              gst_byte_writer_put_buffer (&bw, buffer, h265parse->idr_pos, -1);
+          new_buf = gst_buffer_append_region (new_buf, gst_buffer_ref (buffer),
+              h265parse->idr_pos, -1);
           /* collect result and push */
-          new_buf = gst_byte_writer_reset_and_get_buffer (&bw);
           gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_METADATA, 0,
               -1);
           /* should already be keyframe/IDR, but it may not have been,
@@ -1816,10 +1809,6 @@ gst_h265_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
           GST_BUFFER_FLAG_UNSET (new_buf, GST_BUFFER_FLAG_DELTA_UNIT);
           gst_buffer_replace (&frame->out_buffer, new_buf);
           gst_buffer_unref (new_buf);
-          /* some result checking seems to make some compilers happy */
-          if (G_UNLIKELY (!ok)) {
-            GST_ERROR_OBJECT (h265parse, "failed to insert SPS/PPS");
-          }
         }
       }
       /* we pushed whatever we had */
@@ -1911,7 +1900,7 @@ gst_h265_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
           goto hvcc_too_small;
         }
 
-        gst_h265_parse_process_nal (h265parse, &nalu);
+        gst_h265_parse_process_nal (h265parse, codec_data, &nalu);
         off = nalu.offset + nalu.size;
       }
     }
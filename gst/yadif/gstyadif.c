@@ -34,6 +34,9 @@
  * This pipeline creates an interlaced test pattern, and then deinterlaces
  * it using the yadif filter.
  * </refsect2>
+ *
+ * Each frame is split into horizontal bands which are filtered concurrently
+ * by a pool of worker threads, see #GstYadif:max-threads.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -72,18 +75,27 @@ static GstFlowReturn gst_yadif_transform (GstBaseTransform * trans,
 enum
 {
   PROP_0,
-  PROP_MODE
+  PROP_MODE,
+  PROP_MAX_THREADS
 };
 
 #define DEFAULT_MODE GST_DEINTERLACE_MODE_AUTO
+#define DEFAULT_MAX_THREADS 0
 
 /* pad templates */
 
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define YADIF_16BIT_FORMATS "I420_10LE,I422_10LE,Y444_10LE"
+#else
+#define YADIF_16BIT_FORMATS "I420_10BE,I422_10BE,Y444_10BE"
+#endif
+
 static GstStaticPadTemplate gst_yadif_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444}")
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444,"
+            YADIF_16BIT_FORMATS "}")
         ",interlace-mode=(string){interleaved,mixed,progressive}")
     );
 
@@ -91,7 +103,8 @@ static GstStaticPadTemplate gst_yadif_src_template =
 GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444}")
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444,"
+            YADIF_16BIT_FORMATS "}")
         ",interlace-mode=(string)progressive")
     );
 
@@ -160,11 +173,19 @@ gst_yadif_class_init (GstYadifClass * klass)
           DEFAULT_MODE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum threads",
+          "Maximum number of threads used to filter a frame (0 = auto), "
+          "applied when the element starts",
+          0, GST_PARALLEL_MAX_THREADS, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_yadif_init (GstYadif * yadif)
 {
+  yadif->max_threads = DEFAULT_MAX_THREADS;
+  gst_parallel_bands_init (&yadif->bands);
 }
 
 void
@@ -177,6 +198,9 @@ gst_yadif_set_property (GObject * object, guint property_id,
     case PROP_MODE:
       yadif->mode = g_value_get_enum (value);
       break;
+    case PROP_MAX_THREADS:
+      yadif->max_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -193,6 +217,9 @@ gst_yadif_get_property (GObject * object, guint property_id,
     case PROP_MODE:
       g_value_set_enum (value, yadif->mode);
       break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, yadif->max_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -212,9 +239,9 @@ gst_yadif_dispose (GObject * object)
 void
 gst_yadif_finalize (GObject * object)
 {
-  /* GstYadif *yadif = GST_YADIF (object); */
+  GstYadif *yadif = GST_YADIF (object);
 
-  /* clean up object here */
+  gst_parallel_bands_clear (&yadif->bands);
 
   G_OBJECT_CLASS (gst_yadif_parent_class)->finalize (object);
 }
@@ -277,9 +304,18 @@ gst_yadif_get_unit_size (GstBaseTransform * trans, GstCaps * caps, gsize * size)
   return FALSE;
 }
 
+void yadif_filter (GstYadif * yadif, int parity, int tff);
+
 static gboolean
 gst_yadif_start (GstBaseTransform * trans)
 {
+  GstYadif *yadif = GST_YADIF (trans);
+  guint threads;
+
+  threads = gst_parallel_bands_start (&yadif->bands, GST_OBJECT (yadif),
+      yadif->max_threads);
+
+  GST_INFO_OBJECT (yadif, "filtering with %u threads", threads);
 
   return TRUE;
 }
@@ -287,12 +323,13 @@ gst_yadif_start (GstBaseTransform * trans)
 static gboolean
 gst_yadif_stop (GstBaseTransform * trans)
 {
+  GstYadif *yadif = GST_YADIF (trans);
+
+  gst_parallel_bands_stop (&yadif->bands);
 
   return TRUE;
 }
 
-void yadif_filter (GstYadif * yadif, int parity, int tff);
-
 static GstFlowReturn
 gst_yadif_transform (GstBaseTransform * trans, GstBuffer * inbuf,
     GstBuffer * outbuf)
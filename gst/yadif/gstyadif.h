@@ -23,6 +23,7 @@
 
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
+#include <gst/parallel-private.h>
 
 G_BEGIN_DECLS
 
@@ -46,6 +47,7 @@ struct _GstYadif
   GstBaseTransform base_yadif;
 
   GstDeinterlaceMode mode;
+  guint max_threads;
 
   GstVideoInfo video_info;
 
@@ -53,6 +55,11 @@ struct _GstYadif
   GstVideoFrame cur_frame;
   GstVideoFrame next_frame;
   GstVideoFrame dest_frame;
+
+  /* row band workers */
+  GstParallelBands bands;
+  int parity;
+  int tff;
 };
 
 struct _GstYadifClass
@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <gstyadif.h>
+#include "yadif_simd.h"
 #include <string.h>
 
 #undef NDEBUG
@@ -97,7 +98,6 @@ filter_line_c (guint8 * dst,
 
 FILTER}
 
-#if 0
 static void
 filter_line_c_16bit (guint16 * dst,
     guint16 * prev, guint16 * cur, guint16 * next,
@@ -110,51 +110,123 @@ filter_line_c_16bit (guint16 * dst,
   prefs /= 2;
 
 FILTER}
-#endif
 
 void yadif_filter (GstYadif * yadif, int parity, int tff);
+void yadif_filter_band (GstYadif * yadif, int parity, int tff, int band,
+    int n_bands);
+
 #ifdef HAVE_CPU_X86_64
 void filter_line_x86_64 (guint8 * dst,
     guint8 * prev, guint8 * cur, guint8 * next,
     int w, int prefs, int mrefs, int parity, int mode);
 #endif
 
+typedef void (*YadifFilterLineFunc) (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
+
+#ifdef YADIF_HAVE_AVX2
+static void
+filter_line_avx2 (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  int x;
+
+  x = yadif_filter_line_avx2 (dst, prev, cur, next, w, prefs, mrefs, parity,
+      mode);
+  if (x < w)
+    filter_line_c (dst + x, prev + x, cur + x, next + x, w - x, prefs, mrefs,
+        parity, mode);
+}
+#endif
+
+#ifdef YADIF_HAVE_NEON
+static void
+filter_line_neon (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  int x;
+
+  x = yadif_filter_line_neon (dst, prev, cur, next, w, prefs, mrefs, parity,
+      mode);
+  if (x < w)
+    filter_line_c (dst + x, prev + x, cur + x, next + x, w - x, prefs, mrefs,
+        parity, mode);
+}
+#endif
+
+static void
+filter_line_16bit (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  filter_line_c_16bit ((guint16 *) dst, (guint16 *) prev, (guint16 *) cur,
+      (guint16 *) next, w, prefs, mrefs, parity, mode);
+}
+
+static gpointer
+yadif_select_filter_line (gpointer data)
+{
+  YadifFilterLineFunc func = filter_line_c;
+
+#if HAVE_CPU_X86_64
+  func = filter_line_x86_64;
+#endif
+#ifdef YADIF_HAVE_AVX2
+  if (gst_parallel_cpu_has_avx2 ())
+    func = filter_line_avx2;
+#endif
+#ifdef YADIF_HAVE_NEON
+  func = filter_line_neon;
+#endif
+
+  return (gpointer) func;
+}
+
+/* Filters rows [band * h / n_bands, (band + 1) * h / n_bands) of every
+ * plane.  Each output row only depends on the input frames, so the bands
+ * can be processed concurrently. */
 void
-yadif_filter (GstYadif * yadif, int parity, int tff)
+yadif_filter_band (GstYadif * yadif, int parity, int tff, int band,
+    int n_bands)
 {
+  static GOnce filter_line_once = G_ONCE_INIT;
+  YadifFilterLineFunc filter_line;
   int y, i;
   const GstVideoInfo *vi = &yadif->video_info;
   const GstVideoFormatInfo *vfi = vi->finfo;
 
+  if (GST_VIDEO_FORMAT_INFO_DEPTH (vfi, 0) > 8) {
+    filter_line = filter_line_16bit;
+  } else {
+    g_once (&filter_line_once, yadif_select_filter_line, NULL);
+    filter_line = (YadifFilterLineFunc) filter_line_once.retval;
+  }
+
   for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (vfi); i++) {
     int w = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (vfi, i, vi->width);
     int h = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (vfi, i, vi->height);
     int refs = GST_VIDEO_INFO_COMP_STRIDE (vi, i);
     int df = GST_VIDEO_INFO_COMP_PSTRIDE (vi, i);
+    int y_start = (gint64) h * band / n_bands;
+    int y_end = (gint64) h * (band + 1) / n_bands;
     guint8 *prev_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->prev_frame, i);
     guint8 *cur_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->cur_frame, i);
     guint8 *next_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->next_frame, i);
     guint8 *dest_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->dest_frame, i);
 
-    for (y = 0; y < h; y++) {
+    for (y = y_start; y < y_end; y++) {
       if ((y ^ parity) & 1) {
         guint8 *prev = prev_data + y * refs;
         guint8 *cur = cur_data + y * refs;
         guint8 *next = next_data + y * refs;
         guint8 *dst = dest_data + y * refs;
         int mode = ((y == 1) || (y + 2 == h)) ? 2 : yadif->mode;
-#if HAVE_CPU_X86_64
-        if (0) {
-          filter_line_c (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-        } else {
-          filter_line_x86_64 (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-        }
-#else
-        filter_line_c (dst, prev, cur, next, w,
+
+        filter_line (dst, prev, cur, next, w,
             y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-#endif
       } else {
         guint8 *dst = dest_data + y * refs;
         guint8 *cur = cur_data + y * refs;
@@ -163,8 +235,21 @@ yadif_filter (GstYadif * yadif, int parity, int tff)
       }
     }
   }
+}
 
-#if 0
-  emms_c ();
-#endif
+static void
+yadif_filter_band_func (gpointer user_data, guint band, guint n_bands)
+{
+  GstYadif *yadif = user_data;
+
+  yadif_filter_band (yadif, yadif->parity, yadif->tff, band, n_bands);
+}
+
+void
+yadif_filter (GstYadif * yadif, int parity, int tff)
+{
+  yadif->parity = parity;
+  yadif->tff = tff;
+  gst_parallel_bands_run (&yadif->bands, yadif->bands.n_threads,
+      yadif_filter_band_func, yadif);
 }
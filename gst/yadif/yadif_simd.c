@@ -0,0 +1,230 @@
+/* GStreamer
+ * Copyright (C) 2006 Michael Niedermayer <michaelni@gmx.at>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Intrinsics versions of filter_line for instruction sets that the inline
+ * assembly in yadif_template.c does not cover.  Both kernels compute exactly
+ * the same result as filter_line_c(), including the quirk that the dir=2
+ * spatial check is only taken when the dir=1 check succeeded.  Leftover
+ * pixels at the end of a line are handed back to the caller. */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "yadif_simd.h"
+
+#if defined(YADIF_HAVE_AVX2)
+#include <immintrin.h>
+
+#define LOAD_AVX2(p) _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (p)))
+
+__attribute__ ((target ("avx2")))
+int
+yadif_filter_line_avx2 (guint8 * dst, guint8 * prev, guint8 * cur,
+    guint8 * next, int w, int prefs, int mrefs, int parity, int mode)
+{
+  guint8 *prev2 = parity ? prev : cur;
+  guint8 *next2 = parity ? cur : next;
+  const __m256i one = _mm256_set1_epi16 (1);
+  int x;
+
+  for (x = 0; x + 16 <= w; x += 16) {
+    __m256i c = LOAD_AVX2 (cur + mrefs + x);
+    __m256i e = LOAD_AVX2 (cur + prefs + x);
+    __m256i p2 = LOAD_AVX2 (prev2 + x);
+    __m256i n2 = LOAD_AVX2 (next2 + x);
+    __m256i d = _mm256_srai_epi16 (_mm256_add_epi16 (p2, n2), 1);
+    __m256i td0, td1, td2, diff;
+    __m256i sp, ss, score, a, b, mask;
+    __m256i res;
+
+    td0 = _mm256_abs_epi16 (_mm256_sub_epi16 (p2, n2));
+    td1 = _mm256_add_epi16 (
+        _mm256_abs_epi16 (_mm256_sub_epi16 (LOAD_AVX2 (prev + mrefs + x), c)),
+        _mm256_abs_epi16 (_mm256_sub_epi16 (LOAD_AVX2 (prev + prefs + x), e)));
+    td2 = _mm256_add_epi16 (
+        _mm256_abs_epi16 (_mm256_sub_epi16 (LOAD_AVX2 (next + mrefs + x), c)),
+        _mm256_abs_epi16 (_mm256_sub_epi16 (LOAD_AVX2 (next + prefs + x), e)));
+    diff = _mm256_max_epi16 (_mm256_srai_epi16 (td0, 1),
+        _mm256_max_epi16 (_mm256_srai_epi16 (td1, 1),
+            _mm256_srai_epi16 (td2, 1)));
+
+    sp = _mm256_srai_epi16 (_mm256_add_epi16 (c, e), 1);
+    ss = _mm256_add_epi16 (_mm256_abs_epi16 (_mm256_sub_epi16 (LOAD_AVX2 (cur +
+                    mrefs + x - 1), LOAD_AVX2 (cur + prefs + x - 1))),
+        _mm256_abs_epi16 (_mm256_sub_epi16 (c, e)));
+    ss = _mm256_add_epi16 (ss,
+        _mm256_abs_epi16 (_mm256_sub_epi16 (LOAD_AVX2 (cur + mrefs + x + 1),
+                LOAD_AVX2 (cur + prefs + x + 1))));
+    ss = _mm256_sub_epi16 (ss, one);
+
+#define SCORE_AVX2(j) \
+    _mm256_add_epi16 (_mm256_add_epi16 ( \
+        _mm256_abs_epi16 (_mm256_sub_epi16 ( \
+            LOAD_AVX2 (cur + mrefs + x - 1 + (j)), \
+            LOAD_AVX2 (cur + prefs + x - 1 - (j)))), \
+        _mm256_abs_epi16 (_mm256_sub_epi16 ( \
+            LOAD_AVX2 (cur + mrefs + x + (j)), \
+            LOAD_AVX2 (cur + prefs + x - (j))))), \
+        _mm256_abs_epi16 (_mm256_sub_epi16 ( \
+            LOAD_AVX2 (cur + mrefs + x + 1 + (j)), \
+            LOAD_AVX2 (cur + prefs + x + 1 - (j)))))
+#define PRED_AVX2(j) \
+    _mm256_srai_epi16 (_mm256_add_epi16 (LOAD_AVX2 (cur + mrefs + x + (j)), \
+        LOAD_AVX2 (cur + prefs + x - (j))), 1)
+#define CHECK_AVX2(j1, j2) \
+    score = SCORE_AVX2 (j1); \
+    mask = _mm256_cmpgt_epi16 (ss, score); \
+    ss = _mm256_blendv_epi8 (ss, score, mask); \
+    sp = _mm256_blendv_epi8 (sp, PRED_AVX2 (j1), mask); \
+    score = SCORE_AVX2 (j2); \
+    mask = _mm256_and_si256 (mask, _mm256_cmpgt_epi16 (ss, score)); \
+    ss = _mm256_blendv_epi8 (ss, score, mask); \
+    sp = _mm256_blendv_epi8 (sp, PRED_AVX2 (j2), mask);
+
+    CHECK_AVX2 (-1, -2);
+    CHECK_AVX2 (1, 2);
+
+#undef CHECK_AVX2
+#undef PRED_AVX2
+#undef SCORE_AVX2
+
+    if (mode < 2) {
+      __m256i bb = _mm256_srai_epi16 (_mm256_add_epi16 (LOAD_AVX2 (prev2 +
+                  2 * mrefs + x), LOAD_AVX2 (next2 + 2 * mrefs + x)), 1);
+      __m256i ff = _mm256_srai_epi16 (_mm256_add_epi16 (LOAD_AVX2 (prev2 +
+                  2 * prefs + x), LOAD_AVX2 (next2 + 2 * prefs + x)), 1);
+      __m256i de = _mm256_sub_epi16 (d, e);
+      __m256i dc = _mm256_sub_epi16 (d, c);
+      __m256i bc = _mm256_sub_epi16 (bb, c);
+      __m256i fe = _mm256_sub_epi16 (ff, e);
+
+      a = _mm256_max_epi16 (_mm256_max_epi16 (de, dc), _mm256_min_epi16 (bc,
+              fe));
+      b = _mm256_min_epi16 (_mm256_min_epi16 (de, dc), _mm256_max_epi16 (bc,
+              fe));
+      diff = _mm256_max_epi16 (diff, _mm256_max_epi16 (b,
+              _mm256_sub_epi16 (_mm256_setzero_si256 (), a)));
+    }
+
+    sp = _mm256_min_epi16 (sp, _mm256_add_epi16 (d, diff));
+    sp = _mm256_max_epi16 (sp, _mm256_sub_epi16 (d, diff));
+
+    res = _mm256_permute4x64_epi64 (_mm256_packus_epi16 (sp, sp), 0xd8);
+    _mm_storeu_si128 ((__m128i *) (dst + x), _mm256_castsi256_si128 (res));
+  }
+
+  return x;
+}
+
+#undef LOAD_AVX2
+#endif /* YADIF_HAVE_AVX2 */
+
+#if defined(YADIF_HAVE_NEON)
+#include <arm_neon.h>
+
+#define LOAD_NEON(p) vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (p)))
+
+int
+yadif_filter_line_neon (guint8 * dst, guint8 * prev, guint8 * cur,
+    guint8 * next, int w, int prefs, int mrefs, int parity, int mode)
+{
+  guint8 *prev2 = parity ? prev : cur;
+  guint8 *next2 = parity ? cur : next;
+  const int16x8_t one = vdupq_n_s16 (1);
+  int x;
+
+  for (x = 0; x + 8 <= w; x += 8) {
+    int16x8_t c = LOAD_NEON (cur + mrefs + x);
+    int16x8_t e = LOAD_NEON (cur + prefs + x);
+    int16x8_t p2 = LOAD_NEON (prev2 + x);
+    int16x8_t n2 = LOAD_NEON (next2 + x);
+    int16x8_t d = vshrq_n_s16 (vaddq_s16 (p2, n2), 1);
+    int16x8_t td0, td1, td2, diff;
+    int16x8_t sp, ss, score;
+    uint16x8_t mask;
+
+    td0 = vabdq_s16 (p2, n2);
+    td1 = vaddq_s16 (vabdq_s16 (LOAD_NEON (prev + mrefs + x), c),
+        vabdq_s16 (LOAD_NEON (prev + prefs + x), e));
+    td2 = vaddq_s16 (vabdq_s16 (LOAD_NEON (next + mrefs + x), c),
+        vabdq_s16 (LOAD_NEON (next + prefs + x), e));
+    diff = vmaxq_s16 (vshrq_n_s16 (td0, 1),
+        vmaxq_s16 (vshrq_n_s16 (td1, 1), vshrq_n_s16 (td2, 1)));
+
+    sp = vshrq_n_s16 (vaddq_s16 (c, e), 1);
+    ss = vaddq_s16 (vabdq_s16 (LOAD_NEON (cur + mrefs + x - 1),
+            LOAD_NEON (cur + prefs + x - 1)), vabdq_s16 (c, e));
+    ss = vaddq_s16 (ss, vabdq_s16 (LOAD_NEON (cur + mrefs + x + 1),
+            LOAD_NEON (cur + prefs + x + 1)));
+    ss = vsubq_s16 (ss, one);
+
+#define SCORE_NEON(j) \
+    vaddq_s16 (vaddq_s16 ( \
+        vabdq_s16 (LOAD_NEON (cur + mrefs + x - 1 + (j)), \
+            LOAD_NEON (cur + prefs + x - 1 - (j))), \
+        vabdq_s16 (LOAD_NEON (cur + mrefs + x + (j)), \
+            LOAD_NEON (cur + prefs + x - (j)))), \
+        vabdq_s16 (LOAD_NEON (cur + mrefs + x + 1 + (j)), \
+            LOAD_NEON (cur + prefs + x + 1 - (j))))
+#define PRED_NEON(j) \
+    vshrq_n_s16 (vaddq_s16 (LOAD_NEON (cur + mrefs + x + (j)), \
+        LOAD_NEON (cur + prefs + x - (j))), 1)
+#define CHECK_NEON(j1, j2) \
+    score = SCORE_NEON (j1); \
+    mask = vcltq_s16 (score, ss); \
+    ss = vbslq_s16 (mask, score, ss); \
+    sp = vbslq_s16 (mask, PRED_NEON (j1), sp); \
+    score = SCORE_NEON (j2); \
+    mask = vandq_u16 (mask, vcltq_s16 (score, ss)); \
+    ss = vbslq_s16 (mask, score, ss); \
+    sp = vbslq_s16 (mask, PRED_NEON (j2), sp);
+
+    CHECK_NEON (-1, -2);
+    CHECK_NEON (1, 2);
+
+#undef CHECK_NEON
+#undef PRED_NEON
+#undef SCORE_NEON
+
+    if (mode < 2) {
+      int16x8_t bb = vshrq_n_s16 (vaddq_s16 (LOAD_NEON (prev2 + 2 * mrefs + x),
+              LOAD_NEON (next2 + 2 * mrefs + x)), 1);
+      int16x8_t ff = vshrq_n_s16 (vaddq_s16 (LOAD_NEON (prev2 + 2 * prefs + x),
+              LOAD_NEON (next2 + 2 * prefs + x)), 1);
+      int16x8_t de = vsubq_s16 (d, e);
+      int16x8_t dc = vsubq_s16 (d, c);
+      int16x8_t bc = vsubq_s16 (bb, c);
+      int16x8_t fe = vsubq_s16 (ff, e);
+      int16x8_t max = vmaxq_s16 (vmaxq_s16 (de, dc), vminq_s16 (bc, fe));
+      int16x8_t min = vminq_s16 (vminq_s16 (de, dc), vmaxq_s16 (bc, fe));
+
+      diff = vmaxq_s16 (diff, vmaxq_s16 (min, vnegq_s16 (max)));
+    }
+
+    sp = vminq_s16 (sp, vaddq_s16 (d, diff));
+    sp = vmaxq_s16 (sp, vsubq_s16 (d, diff));
+
+    vst1_u8 (dst + x, vqmovun_s16 (sp));
+  }
+
+  return x;
+}
+
+#undef LOAD_NEON
+#endif /* YADIF_HAVE_NEON */
@@ -0,0 +1,48 @@
+/* GStreamer
+ * Copyright (C) 2006 Michael Niedermayer <michaelni@gmx.at>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __YADIF_SIMD_H__
+#define __YADIF_SIMD_H__
+
+#include <gst/parallel-private.h>
+
+G_BEGIN_DECLS
+
+#ifdef GST_PARALLEL_HAVE_AVX2
+#define YADIF_HAVE_AVX2 1
+#endif
+
+#ifdef GST_PARALLEL_HAVE_NEON
+#define YADIF_HAVE_NEON 1
+#endif
+
+/* The kernels return the number of pixels they filtered, which is always
+ * a multiple of their vector width and at most @w. */
+#ifdef YADIF_HAVE_AVX2
+int yadif_filter_line_avx2 (guint8 * dst, guint8 * prev, guint8 * cur,
+    guint8 * next, int w, int prefs, int mrefs, int parity, int mode);
+#endif
+
+#ifdef YADIF_HAVE_NEON
+int yadif_filter_line_neon (guint8 * dst, guint8 * prev, guint8 * cur,
+    guint8 * next, int w, int prefs, int mrefs, int parity, int mode);
+#endif
+
+G_END_DECLS
+
+#endif /* __YADIF_SIMD_H__ */
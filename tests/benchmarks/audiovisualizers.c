@@ -0,0 +1,153 @@
+/* GStreamer
+ *
+ * audiovisualizers.c: measures the cost of the audio visualizers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define DEFAULT_NUM_BUFFERS 300
+
+/* one audio buffer per video frame at 60 fps */
+#define AUDIO_CAPS "audio/x-raw,format=S16LE,rate=48000,channels=2"
+#define SAMPLES_PER_BUFFER 800
+
+static const gchar *scopes[] = {
+  "wavescope", "spacescope", "spectrascope", "synaescope"
+};
+
+static const struct
+{
+  guint width, height;
+} sizes[] = {
+  {640, 360}, {1280, 720}, {1920, 1080}
+};
+
+static GstClockTime
+run_pipeline (const gchar * scope, guint branches, guint max_threads,
+    guint num_buffers, guint width, guint height)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GError *err = NULL;
+  GstClockTime start, end;
+  GString *desc;
+  guint i;
+
+  desc = g_string_new (NULL);
+  g_string_append_printf (desc, "audiotestsrc wave=pink-noise num-buffers=%u "
+      "samplesperbuffer=%u ! " AUDIO_CAPS " ! tee name=t", num_buffers,
+      SAMPLES_PER_BUFFER);
+  if (scope) {
+    /* scopes on the same audio share their analysis */
+    for (i = 0; i < branches; i++) {
+      g_string_append_printf (desc, " t. ! queue ! %s shader=fade "
+          "max-threads=%u ! video/x-raw,width=%u,height=%u,framerate=60/1 ! "
+          "fakesink sync=false", scope, max_threads, width, height);
+    }
+  } else {
+    g_string_append (desc, " t. ! fakesink sync=false");
+  }
+  pipeline = gst_parse_launch (desc->str, &err);
+  g_string_free (desc, TRUE);
+  if (pipeline == NULL) {
+    g_printerr ("failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    exit (1);
+  }
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  end = gst_util_get_timestamp ();
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("pipeline error: %s\n", err->message);
+    g_clear_error (&err);
+    exit (1);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return end - start;
+}
+
+static void
+print_result (const gchar * scope, guint branches, guint max_threads,
+    guint num_buffers, guint width, guint height, GstClockTime baseline)
+{
+  GstClockTime elapsed;
+  gchar *size;
+
+  elapsed = run_pipeline (scope, branches, max_threads, num_buffers, width,
+      height);
+  elapsed = elapsed > baseline ? elapsed - baseline : 0;
+
+  size = g_strdup_printf ("%ux%u", width, height);
+  g_print ("%-14s %-9s %-9u %-8s %" GST_TIME_FORMAT " %9.3f ms\n", scope,
+      size, branches, max_threads ? "1" : "auto", GST_TIME_ARGS (elapsed),
+      (gdouble) elapsed / GST_MSECOND / MAX (num_buffers * branches, 1));
+  g_free (size);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint num_buffers = DEFAULT_NUM_BUFFERS;
+  guint threads[] = { 1, 0 };
+  GstClockTime baseline;
+  guint i, s, t;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    num_buffers = atoi (argv[1]);
+
+  /* measure the source and sink alone so only the scopes are reported */
+  baseline = run_pipeline (NULL, 0, 0, num_buffers, 0, 0);
+
+  g_print ("%u frames of " AUDIO_CAPS "\n\n", num_buffers);
+  g_print ("%-14s %-9s %-9s %-8s %14s %12s\n", "scope", "size", "branches",
+      "threads", "total", "per frame");
+
+  for (i = 0; i < G_N_ELEMENTS (scopes); i++) {
+    for (s = 0; s < G_N_ELEMENTS (sizes); s++) {
+      for (t = 0; t < G_N_ELEMENTS (threads); t++) {
+        print_result (scopes[i], 1, threads[t], num_buffers, sizes[s].width,
+            sizes[s].height, baseline);
+      }
+    }
+  }
+
+  /* two branches with the same analysis, the second one reuses the FFT */
+  for (i = 0; i < G_N_ELEMENTS (scopes); i++) {
+    if (g_str_equal (scopes[i], "spectrascope")
+        || g_str_equal (scopes[i], "synaescope"))
+      print_result (scopes[i], 2, 0, num_buffers, 1280, 720, baseline);
+  }
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+/* GStreamer
+ *
+ * fieldanalysis.c: measures the cost of the fieldanalysis metrics
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define DEFAULT_NUM_BUFFERS 200
+
+typedef struct
+{
+  const gchar *field_metric;
+  const gchar *frame_metric;
+  const gchar *comb_method;
+} Method;
+
+static const Method methods[] = {
+  {"sad", "5-tap", "5-tap"},
+  {"ssd", "5-tap", "5-tap"},
+  {"3-tap", "5-tap", "5-tap"},
+  {"ssd", "windowed-comb", "32-detect"},
+  {"ssd", "windowed-comb", "isCombed"},
+  {"ssd", "windowed-comb", "5-tap"},
+};
+
+static GstClockTime
+run_pipeline (const Method * method, guint max_threads, guint num_buffers,
+    const gchar * caps)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GError *err = NULL;
+  GstClockTime start, end;
+  gchar *desc;
+
+  if (method) {
+    desc = g_strdup_printf ("videotestsrc pattern=snow num-buffers=%u ! %s ! "
+        "fieldanalysis field-metric=%s frame-metric=%s comb-method=%s "
+        "max-threads=%u ! fakesink sync=false", num_buffers, caps,
+        method->field_metric, method->frame_metric, method->comb_method,
+        max_threads);
+  } else {
+    desc = g_strdup_printf ("videotestsrc pattern=snow num-buffers=%u ! %s ! "
+        "fakesink sync=false", num_buffers, caps);
+  }
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (pipeline == NULL) {
+    g_printerr ("failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    exit (1);
+  }
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  end = gst_util_get_timestamp ();
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("pipeline error: %s\n", err->message);
+    g_clear_error (&err);
+    exit (1);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return end - start;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  const gchar *caps = "video/x-raw,format=I420,width=1920,height=1080,"
+      "interlace-mode=interleaved,framerate=30000/1001";
+  guint num_buffers = DEFAULT_NUM_BUFFERS;
+  guint threads[] = { 1, 0 };
+  GstClockTime baseline;
+  guint i, t;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    num_buffers = atoi (argv[1]);
+  if (argc > 2)
+    caps = argv[2];
+
+  /* measure the source and sink alone so only the analysis is reported */
+  baseline = run_pipeline (NULL, 0, num_buffers, caps);
+
+  g_print ("%u buffers of %s\n\n", num_buffers, caps);
+  g_print ("%-6s %-14s %-10s %-8s %14s %12s\n", "field", "frame", "comb",
+      "threads", "total", "per frame");
+
+  for (i = 0; i < G_N_ELEMENTS (methods); i++) {
+    for (t = 0; t < G_N_ELEMENTS (threads); t++) {
+      GstClockTime elapsed;
+
+      elapsed = run_pipeline (&methods[i], threads[t], num_buffers, caps);
+      elapsed = elapsed > baseline ? elapsed - baseline : 0;
+
+      g_print ("%-6s %-14s %-10s %-8s %" GST_TIME_FORMAT " %9.3f ms\n",
+          methods[i].field_metric, methods[i].frame_metric,
+          methods[i].comb_method, threads[t] ? "1" : "auto",
+          GST_TIME_ARGS (elapsed),
+          (gdouble) elapsed / GST_MSECOND / MAX (num_buffers, 1));
+    }
+  }
+
+  return 0;
+}
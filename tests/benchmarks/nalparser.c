@@ -0,0 +1,169 @@
+/* GStreamer
+ *
+ * nalparser.c: measures the cost of parsing H.264 headers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/codecparsers/gsth264parser.h>
+
+#define DEFAULT_NUM_ITERATIONS 200000
+
+/* An access unit of a stream that repeats its SPS and PPS with every
+ * IDR frame, like most broadcast and streaming encoders do */
+static const guint8 h264_au[] = {
+  /* SPS */
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x4d, 0x40, 0x15,
+  0xec, 0xa4, 0xbf, 0x2e, 0x02, 0x20, 0x00, 0x00,
+  0x03, 0x00, 0x2e, 0xe6, 0xb2, 0x80, 0x01, 0xe2,
+  0xc5, 0xb2, 0xc0,
+  /* PPS */
+  0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xec, 0xb2,
+  /* IDR slice */
+  0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00,
+  0x10, 0xff, 0xfe, 0xf6, 0xf0, 0xfe, 0x05, 0x36,
+  0x56, 0x04, 0x50, 0x96, 0x7b, 0x3f, 0x53, 0xe1
+};
+
+#define N_NALS 3
+
+/* Parses every header completely, as before parameter sets were cached */
+static guint
+parse_full (GstH264NalParser * parser, GstH264NalUnit * nalus)
+{
+  GstH264SPS sps = { 0, };
+  GstH264PPS pps = { 0, };
+  GstH264SliceHdr slice;
+  guint i, n_ok = 0;
+
+  for (i = 0; i < N_NALS; i++) {
+    GstH264ParserResult res = GST_H264_PARSER_ERROR;
+
+    switch (nalus[i].type) {
+      case GST_H264_NAL_SPS:
+        res = gst_h264_parse_sps (&nalus[i], &sps, TRUE);
+        break;
+      case GST_H264_NAL_PPS:
+        res = gst_h264_parse_pps (parser, &nalus[i], &pps);
+        gst_h264_pps_clear (&pps);
+        break;
+      case GST_H264_NAL_SLICE_IDR:
+        res = gst_h264_parser_parse_slice_hdr (parser, &nalus[i], &slice,
+            FALSE, FALSE);
+        break;
+    }
+    n_ok += res == GST_H264_PARSER_OK;
+  }
+
+  return n_ok;
+}
+
+/* Parses the way h264parse does */
+static guint
+parse_cached (GstH264NalParser * parser, GstH264NalUnit * nalus)
+{
+  GstH264SPS sps = { 0, };
+  GstH264PPS pps = { 0, };
+  GstH264SliceHdr slice;
+  guint i, n_ok = 0;
+
+  for (i = 0; i < N_NALS; i++) {
+    GstH264ParserResult res = GST_H264_PARSER_ERROR;
+
+    switch (nalus[i].type) {
+      case GST_H264_NAL_SPS:
+        res = gst_h264_parser_parse_sps (parser, &nalus[i], &sps, TRUE);
+        break;
+      case GST_H264_NAL_PPS:
+        res = gst_h264_parser_parse_pps (parser, &nalus[i], &pps);
+        gst_h264_pps_clear (&pps);
+        break;
+      case GST_H264_NAL_SLICE_IDR:
+        res = gst_h264_parser_parse_slice_hdr_light (parser, &nalus[i],
+            &slice);
+        break;
+    }
+    n_ok += res == GST_H264_PARSER_OK;
+  }
+
+  return n_ok;
+}
+
+static void
+run (const gchar * name, guint (*func) (GstH264NalParser *,
+        GstH264NalUnit *), GstH264NalParser * parser, GstH264NalUnit * nalus,
+    guint num_iterations)
+{
+  GstClockTime start, end;
+  guint i, n_ok = 0;
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < num_iterations; i++)
+    n_ok += func (parser, nalus);
+  end = gst_util_get_timestamp ();
+
+  if (n_ok != num_iterations * N_NALS)
+    g_printerr ("%s: %u NALs failed to parse\n", name,
+        num_iterations * N_NALS - n_ok);
+
+  g_print ("%-8s %12.0f NALs/s\n", name,
+      (gdouble) num_iterations * N_NALS * GST_SECOND / MAX (end - start, 1));
+}
+
+int
+main (int argc, char *argv[])
+{
+  GstH264NalParser *parser;
+  GstH264NalUnit nalus[N_NALS];
+  guint num_iterations = DEFAULT_NUM_ITERATIONS;
+  guint i, offset = 0;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    num_iterations = atoi (argv[1]);
+
+  parser = gst_h264_nal_parser_new ();
+
+  for (i = 0; i < N_NALS; i++) {
+    GstH264ParserResult res;
+
+    /* the last one is only terminated by the end of the data */
+    res = gst_h264_parser_identify_nalu (parser, h264_au, offset,
+        sizeof (h264_au), &nalus[i]);
+    if (res != GST_H264_PARSER_OK && res != GST_H264_PARSER_NO_NAL_END) {
+      g_printerr ("failed to split test data\n");
+      return 1;
+    }
+    offset = nalus[i].offset + nalus[i].size;
+  }
+
+  /* get the parameter sets into the parser */
+  parse_cached (parser, nalus);
+
+  run ("full", parse_full, parser, nalus, num_iterations);
+  run ("cached", parse_cached, parser, nalus, num_iterations);
+
+  gst_h264_nal_parser_free (parser);
+
+  return 0;
+}
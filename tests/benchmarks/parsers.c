@@ -0,0 +1,779 @@
+/* GStreamer
+ *
+ * parsers.c: throughput of the codec parser libraries and parser elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Every benchmark reports NAL units (or start code packets) per second,
+ * megabytes of input per second and heap allocations per frame.
+ *
+ * The input is generated: H.264 access units made of SPS, PPS and an IDR
+ * slice padded with slice data up to the frame size, and similar H.265
+ * and MPEG-2 streams. -f replaces the H.264 byte-stream with the contents
+ * of a file; the modes that need AVC input are skipped then.
+ *
+ * --csv prints one line per benchmark with the fields
+ *   benchmark,nals,bytes,frames,seconds,nals_per_sec,mb_per_sec,allocs_per_frame
+ * which is meant to be collected over time. allocs_per_frame is -1 if
+ * allocations can not be counted with the GLib in use. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/codecparsers/gstmpegvideoparser.h>
+
+#define DEFAULT_NUM_FRAMES 2000
+#define DEFAULT_FRAME_SIZE (16 * 1024)
+
+static const guint8 h264_sps[] = {
+  0x67, 0x4d, 0x40, 0x15, 0xec, 0xa4, 0xbf, 0x2e,
+  0x02, 0x20, 0x00, 0x00, 0x03, 0x00, 0x2e, 0xe6,
+  0xb2, 0x80, 0x01, 0xe2, 0xc5, 0xb2, 0xc0
+};
+
+static const guint8 h264_pps[] = {
+  0x68, 0xeb, 0xec, 0xb2
+};
+
+static const guint8 h264_idr[] = {
+  0x65, 0x88, 0x84, 0x00, 0x10, 0xff, 0xfe, 0xf6,
+  0xf0, 0xfe, 0x05, 0x36, 0x56, 0x04, 0x50, 0x96,
+  0x7b, 0x3f, 0x53, 0xe1
+};
+
+/* NAL unit headers of VPS, SPS, PPS and an IDR_W_RADL slice */
+static const guint8 h265_headers[][2] = {
+  {0x40, 0x01}, {0x42, 0x01}, {0x44, 0x01}, {0x26, 0x01}
+};
+
+typedef struct
+{
+  const gchar *name;
+  guint64 nals;
+  guint64 bytes;
+  guint64 frames;
+  GstClockTime elapsed;
+  guint64 allocs;
+} Result;
+
+static gboolean csv = FALSE;
+
+/* Allocation counting */
+
+static gboolean count_allocs;
+static volatile gint n_allocs;
+
+static gpointer
+counting_malloc (gsize n_bytes)
+{
+  g_atomic_int_inc (&n_allocs);
+  return malloc (n_bytes);
+}
+
+static gpointer
+counting_realloc (gpointer mem, gsize n_bytes)
+{
+  g_atomic_int_inc (&n_allocs);
+  return realloc (mem, n_bytes);
+}
+
+static gpointer
+counting_calloc (gsize n_blocks, gsize n_block_bytes)
+{
+  g_atomic_int_inc (&n_allocs);
+  return calloc (n_blocks, n_block_bytes);
+}
+
+static GMemVTable counting_vtable = {
+  counting_malloc,
+  counting_realloc,
+  free,
+  counting_calloc,
+  counting_malloc,
+  counting_realloc
+};
+
+/* Has to run before anything is allocated */
+static void
+init_alloc_counting (void)
+{
+  /* GSlice would hide most allocations in its magazines */
+  setenv ("G_SLICE", "always-malloc", 1);
+
+  g_mem_set_vtable (&counting_vtable);
+
+  /* newer GLib ignores the vtable */
+  g_free (g_malloc (1));
+  count_allocs = g_atomic_int_get (&n_allocs) > 0;
+}
+
+/* Test data */
+
+static void
+fill_noise (guint8 * data, gsize size, guint32 seed)
+{
+  GRand *rand = g_rand_new_with_seed (seed);
+  gsize i;
+
+  /* no zero bytes, so no start codes or emulation prevention */
+  for (i = 0; i < size; i++)
+    data[i] = g_rand_int_range (rand, 1, 256);
+
+  g_rand_free (rand);
+}
+
+/* Appends one NAL unit with a start code or a 4 byte length, padded with
+ * noise up to @size bytes of NAL unit */
+static void
+append_nal (GByteArray * array, const guint8 * nal, guint nal_size,
+    guint size, gboolean avc, guint32 seed)
+{
+  guint8 prefix[4] = { 0x00, 0x00, 0x00, 0x01 };
+  guint offset;
+
+  size = MAX (size, nal_size);
+  if (avc)
+    GST_WRITE_UINT32_BE (prefix, size);
+
+  g_byte_array_append (array, prefix, 4);
+  offset = array->len;
+  g_byte_array_set_size (array, offset + size);
+  memcpy (array->data + offset, nal, nal_size);
+  fill_noise (array->data + offset + nal_size, size - nal_size, seed);
+}
+
+/* One access unit per frame, every one of them an IDR picture with its
+ * parameter sets, like a stream of an all-intra encoder. AVC frames carry
+ * the parameter sets in the codec_data only. */
+static GByteArray *
+make_h264_stream (guint num_frames, guint frame_size, gboolean avc,
+    GArray * frame_sizes)
+{
+  GByteArray *array = g_byte_array_new ();
+  guint i;
+
+  for (i = 0; i < num_frames; i++) {
+    guint start = array->len;
+
+    if (!avc) {
+      append_nal (array, h264_sps, sizeof (h264_sps), 0, FALSE, 0);
+      append_nal (array, h264_pps, sizeof (h264_pps), 0, FALSE, 0);
+    }
+    append_nal (array, h264_idr, sizeof (h264_idr), frame_size, avc, i);
+
+    if (frame_sizes) {
+      guint size = array->len - start;
+      g_array_append_val (frame_sizes, size);
+    }
+  }
+
+  return array;
+}
+
+static GstBuffer *
+make_h264_codec_data (void)
+{
+  GByteArray *array = g_byte_array_new ();
+  guint8 header[8];
+  gsize size;
+
+  header[0] = 1;
+  header[1] = h264_sps[1];
+  header[2] = h264_sps[2];
+  header[3] = h264_sps[3];
+  header[4] = 0xff;             /* 4 byte NAL unit lengths */
+  header[5] = 0xe1;             /* 1 SPS */
+  GST_WRITE_UINT16_BE (header + 6, sizeof (h264_sps));
+  g_byte_array_append (array, header, 8);
+  g_byte_array_append (array, h264_sps, sizeof (h264_sps));
+
+  header[0] = 1;                /* 1 PPS */
+  GST_WRITE_UINT16_BE (header + 1, sizeof (h264_pps));
+  g_byte_array_append (array, header, 3);
+  g_byte_array_append (array, h264_pps, sizeof (h264_pps));
+
+  size = array->len;
+  return gst_buffer_new_wrapped (g_byte_array_free (array, FALSE), size);
+}
+
+static GByteArray *
+make_h265_stream (guint num_frames, guint frame_size)
+{
+  GByteArray *array = g_byte_array_new ();
+  guint i, j;
+
+  for (i = 0; i < num_frames; i++) {
+    for (j = 0; j < G_N_ELEMENTS (h265_headers); j++) {
+      gboolean slice = j == G_N_ELEMENTS (h265_headers) - 1;
+
+      append_nal (array, h265_headers[j], 2, slice ? frame_size : 16, FALSE,
+          i * 4 + j);
+    }
+  }
+
+  return array;
+}
+
+/* Sequence header, picture header and one slice per 16 lines of 1080p */
+static GByteArray *
+make_mpeg_video_stream (guint num_frames, guint frame_size)
+{
+  GByteArray *array = g_byte_array_new ();
+  const guint n_slices = 68;
+  guint i, j;
+
+  for (i = 0; i < num_frames; i++) {
+    guint8 sc[4] = { 0x00, 0x00, 0x01, 0xb3 };
+    guint offset;
+
+    g_byte_array_append (array, sc, 4);
+    offset = array->len;
+    g_byte_array_set_size (array, offset + 8);
+    fill_noise (array->data + offset, 8, i);
+
+    sc[3] = 0x00;
+    g_byte_array_append (array, sc, 4);
+    offset = array->len;
+    g_byte_array_set_size (array, offset + 4);
+    fill_noise (array->data + offset, 4, i);
+
+    for (j = 0; j < n_slices; j++) {
+      sc[3] = j + 1;
+      g_byte_array_append (array, sc, 4);
+      offset = array->len;
+      g_byte_array_set_size (array, offset + frame_size / n_slices);
+      fill_noise (array->data + offset, frame_size / n_slices, i * 100 + j);
+    }
+  }
+
+  return array;
+}
+
+/* Reporting */
+
+static void
+print_header (void)
+{
+  if (csv)
+    g_print ("benchmark,nals,bytes,frames,seconds,nals_per_sec,mb_per_sec,"
+        "allocs_per_frame\n");
+  else
+    g_print ("%-24s %12s %10s %14s\n", "benchmark", "NALs/s", "MB/s",
+        "allocs/frame");
+}
+
+static void
+print_result (const Result * r)
+{
+  gdouble seconds = (gdouble) MAX (r->elapsed, 1) / GST_SECOND;
+  gdouble nals_per_sec = r->nals / seconds;
+  gdouble mb_per_sec = r->bytes / seconds / (1024 * 1024);
+  gdouble allocs_per_frame = -1;
+
+  if (count_allocs)
+    allocs_per_frame = (gdouble) r->allocs / MAX (r->frames, 1);
+
+  if (csv) {
+    gchar buf[4][G_ASCII_DTOSTR_BUF_SIZE];
+
+    /* independent of the locale */
+    g_print ("%s,%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%"
+        G_GUINT64_FORMAT ",%s,%s,%s,%s\n", r->name, r->nals, r->bytes,
+        r->frames, g_ascii_formatd (buf[0], sizeof (buf[0]), "%.6f", seconds),
+        g_ascii_formatd (buf[1], sizeof (buf[1]), "%.0f", nals_per_sec),
+        g_ascii_formatd (buf[2], sizeof (buf[2]), "%.2f", mb_per_sec),
+        g_ascii_formatd (buf[3], sizeof (buf[3]), "%.2f", allocs_per_frame));
+  } else {
+    g_print ("%-24s %12.0f %10.2f %14.2f\n", r->name, nals_per_sec,
+        mb_per_sec, allocs_per_frame);
+  }
+}
+
+#define RESULT_START(r) G_STMT_START {                          \
+  (r)->allocs = g_atomic_int_get (&n_allocs);                   \
+  (r)->elapsed = gst_util_get_timestamp ();                     \
+} G_STMT_END
+
+#define RESULT_STOP(r) G_STMT_START {                           \
+  (r)->elapsed = gst_util_get_timestamp () - (r)->elapsed;      \
+  (r)->allocs = g_atomic_int_get (&n_allocs) - (r)->allocs;     \
+} G_STMT_END
+
+/* Parser libraries */
+
+static void
+parse_h264_nal (GstH264NalParser * parser, GstH264NalUnit * nalu,
+    Result * r)
+{
+  GstH264SPS sps;
+  GstH264PPS pps;
+  GstH264SliceHdr slice;
+
+  r->nals++;
+
+  switch (nalu->type) {
+    case GST_H264_NAL_SPS:
+      gst_h264_parser_parse_sps (parser, nalu, &sps, TRUE);
+      break;
+    case GST_H264_NAL_PPS:
+      if (gst_h264_parser_parse_pps (parser, nalu, &pps) ==
+          GST_H264_PARSER_OK)
+        gst_h264_pps_clear (&pps);
+      break;
+    case GST_H264_NAL_SLICE:
+    case GST_H264_NAL_SLICE_IDR:
+      /* the way h264parse does it, a slice that does not parse is
+       * counted as a frame of its own */
+      if (gst_h264_parser_parse_slice_hdr_light (parser, nalu, &slice) !=
+          GST_H264_PARSER_OK || slice.first_mb_in_slice == 0)
+        r->frames++;
+      break;
+    default:
+      break;
+  }
+}
+
+static void
+bench_h264_byte_stream (const guint8 * data, gsize size)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  Result r = { "h264parser-byte-stream", 0, size, 0, 0, 0 };
+  GstH264NalUnit nalu;
+  GstH264ParserResult res;
+  guint offset = 0;
+
+  RESULT_START (&r);
+  do {
+    res = gst_h264_parser_identify_nalu (parser, data, offset, size, &nalu);
+    if (res != GST_H264_PARSER_OK && res != GST_H264_PARSER_NO_NAL_END)
+      break;
+    parse_h264_nal (parser, &nalu, &r);
+    offset = nalu.offset + nalu.size;
+  } while (res == GST_H264_PARSER_OK);
+  RESULT_STOP (&r);
+
+  gst_h264_nal_parser_free (parser);
+  print_result (&r);
+}
+
+static void
+bench_h264_avc (const guint8 * data, gsize size)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  Result r = { "h264parser-avc", 0, size, 0, 0, 0 };
+  GByteArray *ps;
+  GstH264NalUnit nalu;
+  GstH264ParserResult res;
+  guint offset = 0;
+
+  /* the parameter sets come from the codec_data */
+  ps = g_byte_array_new ();
+  append_nal (ps, h264_sps, sizeof (h264_sps), 0, TRUE, 0);
+  append_nal (ps, h264_pps, sizeof (h264_pps), 0, TRUE, 0);
+  while (offset + 4 <= ps->len && gst_h264_parser_identify_nalu_avc (parser,
+          ps->data, offset, ps->len, 4, &nalu) == GST_H264_PARSER_OK) {
+    parse_h264_nal (parser, &nalu, &r);
+    offset = nalu.offset + nalu.size;
+  }
+  g_byte_array_unref (ps);
+  r.nals = 0;
+  offset = 0;
+
+  RESULT_START (&r);
+  while (offset + 4 <= size) {
+    res = gst_h264_parser_identify_nalu_avc (parser, data, offset, size, 4,
+        &nalu);
+    if (res != GST_H264_PARSER_OK)
+      break;
+    parse_h264_nal (parser, &nalu, &r);
+    offset = nalu.offset + nalu.size;
+  }
+  RESULT_STOP (&r);
+
+  gst_h264_nal_parser_free (parser);
+  print_result (&r);
+}
+
+static void
+bench_h265_byte_stream (const guint8 * data, gsize size)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  Result r = { "h265parser-byte-stream", 0, size, 0, 0, 0 };
+  GstH265NalUnit nalu;
+  GstH265ParserResult res;
+  guint offset = 0;
+
+  /* the generated slices can not be parsed, only split */
+  RESULT_START (&r);
+  do {
+    res = gst_h265_parser_identify_nalu (parser, data, offset, size, &nalu);
+    if (res != GST_H265_PARSER_OK && res != GST_H265_PARSER_NO_NAL_END)
+      break;
+    r.nals++;
+    if (nalu.type == GST_H265_NAL_SLICE_IDR_W_RADL)
+      r.frames++;
+    offset = nalu.offset + nalu.size;
+  } while (res == GST_H265_PARSER_OK);
+  RESULT_STOP (&r);
+
+  gst_h265_parser_free (parser);
+  print_result (&r);
+}
+
+static void
+bench_mpeg_video (const guint8 * data, gsize size)
+{
+  Result r = { "mpegvideoparser", 0, size, 0, 0, 0 };
+  GstMpegVideoPacket packet;
+  guint offset = 0;
+
+  RESULT_START (&r);
+  while (gst_mpeg_video_parse (&packet, data, size, offset)) {
+    r.nals++;
+    if (packet.type == GST_MPEG_VIDEO_PACKET_PICTURE)
+      r.frames++;
+    offset = packet.offset;
+  }
+  RESULT_STOP (&r);
+
+  print_result (&r);
+}
+
+/* Parser elements */
+
+typedef struct
+{
+  GstCaps *out_caps;
+  guint64 n_buffers;
+} SinkData;
+
+static GstFlowReturn
+sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  SinkData *data = gst_pad_get_element_private (pad);
+
+  data->n_buffers++;
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  SinkData *data = gst_pad_get_element_private (pad);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CAPS:{
+      GstCaps *filter, *caps;
+
+      gst_query_parse_caps (query, &filter);
+      if (filter)
+        caps = gst_caps_intersect (data->out_caps, filter);
+      else
+        caps = gst_caps_ref (data->out_caps);
+      gst_query_set_caps_result (query, caps);
+      gst_caps_unref (caps);
+      return TRUE;
+    }
+    case GST_QUERY_ACCEPT_CAPS:{
+      GstCaps *caps;
+
+      gst_query_parse_accept_caps (query, &caps);
+      gst_query_set_accept_caps_result (query,
+          gst_caps_can_intersect (caps, data->out_caps));
+      return TRUE;
+    }
+    default:
+      return gst_pad_query_default (pad, parent, query);
+  }
+}
+
+/* Pushes all @buffers through @element and returns FALSE if the element
+ * is not available */
+static gboolean
+bench_element (Result * r, const gchar * factory, GstCaps * in_caps,
+    GstCaps * out_caps, GPtrArray * buffers)
+{
+  GstElement *element;
+  GstPad *srcpad, *sinkpad, *pad;
+  GstSegment segment;
+  SinkData data = { out_caps, 0 };
+  guint i;
+
+  element = gst_element_factory_make (factory, NULL);
+  if (!element)
+    return FALSE;
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_element_private (sinkpad, &data);
+  gst_pad_set_chain_function (sinkpad, sink_chain);
+  gst_pad_set_query_function (sinkpad, sink_query);
+
+  pad = gst_element_get_static_pad (element, "sink");
+  gst_pad_link (srcpad, pad);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (element, "src");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (pad);
+
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  gst_element_set_state (element, GST_STATE_PLAYING);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("parsers"));
+  gst_pad_push_event (srcpad, gst_event_new_caps (in_caps));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  RESULT_START (r);
+  for (i = 0; i < buffers->len; i++) {
+    r->bytes += gst_buffer_get_size (g_ptr_array_index (buffers, i));
+    if (gst_pad_push (srcpad, g_ptr_array_index (buffers, i)) != GST_FLOW_OK)
+      break;
+  }
+  /* pushes out what the parser still holds */
+  for (i++; i < buffers->len; i++)
+    gst_buffer_unref (g_ptr_array_index (buffers, i));
+  gst_pad_push_event (srcpad, gst_event_new_eos ());
+  RESULT_STOP (r);
+
+  r->frames = data.n_buffers;
+
+  gst_element_set_state (element, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (element);
+
+  g_ptr_array_set_size (buffers, 0);
+
+  print_result (r);
+  return TRUE;
+}
+
+/* Wraps the frames of @stream into buffers that are not allocated or
+ * copied while measuring */
+static GPtrArray *
+make_buffers (GByteArray * stream, GArray * frame_sizes, gsize chunk_size)
+{
+  GPtrArray *buffers = g_ptr_array_new ();
+  gsize offset = 0, size;
+  guint i;
+
+  while (offset < stream->len) {
+    GstBuffer *buffer;
+
+    i = buffers->len;
+    if (frame_sizes)
+      size = g_array_index (frame_sizes, guint, i);
+    else
+      size = MIN (chunk_size, stream->len - offset);
+
+    buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        stream->data + offset, size, 0, size, NULL, NULL);
+    GST_BUFFER_PTS (buffer) = i * GST_SECOND / 30;
+    g_ptr_array_add (buffers, buffer);
+    offset += size;
+  }
+
+  return buffers;
+}
+
+static void
+bench_h264parse (GByteArray * byte_stream, GArray * byte_stream_sizes,
+    guint byte_stream_nals, GByteArray * avc, GArray * avc_sizes,
+    guint avc_nals)
+{
+  GstBuffer *codec_data = make_h264_codec_data ();
+  GstCaps *bs_caps, *bs_au_caps, *avc_au_caps, *avc_caps;
+  GPtrArray *buffers;
+  Result r = { NULL, };
+
+  bs_au_caps = gst_caps_from_string ("video/x-h264, "
+      "stream-format=byte-stream, alignment=au");
+  avc_au_caps = gst_caps_from_string ("video/x-h264, "
+      "stream-format=avc, alignment=au");
+  /* a file is pushed in chunks, the parser finds the frames */
+  if (byte_stream_sizes)
+    bs_caps = gst_caps_ref (bs_au_caps);
+  else
+    bs_caps = gst_caps_from_string ("video/x-h264, "
+        "stream-format=byte-stream");
+  avc_caps = gst_caps_new_simple ("video/x-h264",
+      "stream-format", G_TYPE_STRING, "avc",
+      "alignment", G_TYPE_STRING, "au",
+      "codec_data", GST_TYPE_BUFFER, codec_data, NULL);
+
+  buffers = make_buffers (byte_stream, byte_stream_sizes, 64 * 1024);
+  r.name = "h264parse-passthrough";
+  r.nals = byte_stream_nals;
+  if (!bench_element (&r, "h264parse", bs_caps, bs_au_caps, buffers)) {
+    g_printerr ("h264parse not found, skipping the element benchmarks\n");
+    goto done;
+  }
+  g_ptr_array_unref (buffers);
+
+  buffers = make_buffers (byte_stream, byte_stream_sizes, 64 * 1024);
+  memset (&r, 0, sizeof (r));
+  r.name = "h264parse-bs-to-avc";
+  r.nals = byte_stream_nals;
+  bench_element (&r, "h264parse", bs_caps, avc_au_caps, buffers);
+
+  if (avc) {
+    g_ptr_array_unref (buffers);
+    buffers = make_buffers (avc, avc_sizes, 0);
+    memset (&r, 0, sizeof (r));
+    r.name = "h264parse-avc-to-bs";
+    r.nals = avc_nals;
+    bench_element (&r, "h264parse", avc_caps, bs_au_caps, buffers);
+  }
+
+done:
+  /* whatever was not pushed */
+  g_ptr_array_foreach (buffers, (GFunc) gst_buffer_unref, NULL);
+  g_ptr_array_unref (buffers);
+  gst_caps_unref (bs_caps);
+  gst_caps_unref (bs_au_caps);
+  gst_caps_unref (avc_au_caps);
+  gst_caps_unref (avc_caps);
+  gst_buffer_unref (codec_data);
+}
+
+/* Counts the NAL units of a byte-stream file for the element results */
+static guint
+count_h264_nals (const guint8 * data, gsize size)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GstH264NalUnit nalu;
+  GstH264ParserResult res;
+  guint offset = 0, n = 0;
+
+  do {
+    res = gst_h264_parser_identify_nalu_unchecked (parser, data, offset,
+        size, &nalu);
+    if (res != GST_H264_PARSER_OK && res != GST_H264_PARSER_NO_NAL_END)
+      break;
+    n++;
+    offset = nalu.offset + nalu.size;
+  } while (res == GST_H264_PARSER_OK);
+
+  gst_h264_nal_parser_free (parser);
+
+  return n;
+}
+
+int
+main (int argc, char *argv[])
+{
+  guint num_frames = DEFAULT_NUM_FRAMES;
+  guint frame_size = DEFAULT_FRAME_SIZE;
+  gchar *filename = NULL;
+  GOptionEntry options[] = {
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &num_frames,
+        "Number of generated frames", NULL},
+    {"frame-size", 's', 0, G_OPTION_ARG_INT, &frame_size,
+        "Size of the generated slices in bytes", NULL},
+    {"file", 'f', 0, G_OPTION_ARG_FILENAME, &filename,
+        "H.264 byte-stream file to use instead of generated data", NULL},
+    {"csv", 'c', 0, G_OPTION_ARG_NONE, &csv,
+        "Print comma separated values", NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GByteArray *h264_bs, *h264_avc = NULL, *stream;
+  GArray *h264_bs_sizes = NULL, *h264_avc_sizes = NULL;
+
+  init_alloc_counting ();
+
+  ctx = g_option_context_new ("- parser throughput");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+#ifdef GST_VIDEOPARSERS_DIR
+  /* run from the build directory without installing */
+  if (!gst_registry_find_feature (gst_registry_get (), "h264parse",
+          GST_TYPE_ELEMENT_FACTORY))
+    gst_registry_scan_path (gst_registry_get (), GST_VIDEOPARSERS_DIR);
+#endif
+
+  if (filename) {
+    gchar *contents;
+    gsize length;
+
+    if (!g_file_get_contents (filename, &contents, &length, &err)) {
+      g_printerr ("Could not read %s: %s\n", filename, err->message);
+      g_clear_error (&err);
+      return 1;
+    }
+    h264_bs = g_byte_array_new_take ((guint8 *) contents, length);
+  } else {
+    h264_bs_sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+    h264_avc_sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+    h264_bs = make_h264_stream (num_frames, frame_size, FALSE, h264_bs_sizes);
+    h264_avc = make_h264_stream (num_frames, frame_size, TRUE, h264_avc_sizes);
+  }
+
+  print_header ();
+
+  bench_h264_byte_stream (h264_bs->data, h264_bs->len);
+  if (h264_avc)
+    bench_h264_avc (h264_avc->data, h264_avc->len);
+
+  stream = make_h265_stream (num_frames, frame_size);
+  bench_h265_byte_stream (stream->data, stream->len);
+  g_byte_array_unref (stream);
+
+  stream = make_mpeg_video_stream (num_frames, frame_size);
+  bench_mpeg_video (stream->data, stream->len);
+  g_byte_array_unref (stream);
+
+  /* generated frames are SPS, PPS and a slice, or just the slice */
+  if (filename)
+    bench_h264parse (h264_bs, NULL, count_h264_nals (h264_bs->data,
+            h264_bs->len), NULL, NULL, 0);
+  else
+    bench_h264parse (h264_bs, h264_bs_sizes, num_frames * 3, h264_avc,
+        h264_avc_sizes, num_frames);
+
+  g_byte_array_unref (h264_bs);
+  if (h264_avc)
+    g_byte_array_unref (h264_avc);
+  if (h264_bs_sizes)
+    g_array_unref (h264_bs_sizes);
+  if (h264_avc_sizes)
+    g_array_unref (h264_avc_sizes);
+  g_free (filename);
+
+  return 0;
+}
@@ -0,0 +1,128 @@
+/* GStreamer
+ *
+ * startcode.c: measures the speed of the codec parsers start code scanning
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/base/gstbytereader.h>
+#include <gst/codecparsers/gsth264parser.h>
+
+#define DEFAULT_NUM_ITERATIONS 10
+
+/* An intra-heavy stream has a few large NAL units per frame, so nearly all
+ * of the time is spent scanning slice data */
+#define DATA_SIZE (16 * 1024 * 1024)
+#define NAL_SIZE (256 * 1024)
+
+/* Byte-at-a-time reference */
+static guint
+scan_reference (const guint8 * data)
+{
+  GstByteReader br;
+  guint n_nals = 0;
+  gint off = 0;
+
+  gst_byte_reader_init (&br, data, DATA_SIZE);
+  while ((off = gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00,
+              0x00000100, off, DATA_SIZE - off)) >= 0) {
+    n_nals++;
+    off += 3;
+  }
+
+  return n_nals;
+}
+
+static guint
+scan_h264 (const guint8 * data)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GstH264NalUnit nalu;
+  GstH264ParserResult res;
+  guint n_nals = 0;
+  guint off = 0;
+
+  do {
+    res = gst_h264_parser_identify_nalu (parser, data, off, DATA_SIZE, &nalu);
+    if (res == GST_H264_PARSER_OK || res == GST_H264_PARSER_NO_NAL_END)
+      n_nals++;
+    off = nalu.offset + nalu.size;
+  } while (res == GST_H264_PARSER_OK);
+
+  gst_h264_nal_parser_free (parser);
+
+  return n_nals;
+}
+
+static guint
+run (const gchar * name, guint (*func) (const guint8 *), const guint8 * data,
+    guint num_iterations)
+{
+  GstClockTime start, end;
+  guint i, n_nals = 0;
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < num_iterations; i++)
+    n_nals = func (data);
+  end = gst_util_get_timestamp ();
+
+  g_print ("%-10s %10.1f MB/s\n", name,
+      (gdouble) DATA_SIZE * num_iterations * GST_SECOND / (1024 * 1024) /
+      MAX (end - start, 1));
+
+  return n_nals;
+}
+
+int
+main (int argc, char *argv[])
+{
+  guint num_iterations = DEFAULT_NUM_ITERATIONS;
+  guint8 *data;
+  guint i, n_reference, n_h264;
+  GRand *rand;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    num_iterations = atoi (argv[1]);
+
+  /* filler without any zero byte, so only the planted start codes count */
+  data = g_malloc (DATA_SIZE);
+  rand = g_rand_new_with_seed (0);
+  for (i = 0; i < DATA_SIZE; i++)
+    data[i] = g_rand_int_range (rand, 1, 256);
+  g_rand_free (rand);
+
+  for (i = 0; i + 4 < DATA_SIZE; i += NAL_SIZE)
+    memcpy (data + i, "\x00\x00\x01\x65", 4);
+
+  n_reference = run ("byte-wise", scan_reference, data, num_iterations);
+  n_h264 = run ("h264", scan_h264, data, num_iterations);
+
+  if (n_h264 != n_reference)
+    g_printerr ("h264 found %u NALs instead of %u\n", n_h264, n_reference);
+
+  g_free (data);
+
+  return n_h264 != n_reference;
+}
@@ -29,12 +29,14 @@
 # include <valgrind/valgrind.h>
 #endif
 
+#include <string.h>
 #include <unistd.h>
 
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstconsistencychecker.h>
 #include <gst/video/gstvideometa.h>
 #include <gst/base/gstbasesrc.h>
+#include <gst/video/gstvideoaggregator.h>
 
 #define VIDEO_CAPS_STRING               \
     "video/x-raw, "                 \
@@ -1425,6 +1427,115 @@ GST_START_TEST (test_ignore_eos)
 
 GST_END_TEST;
 
+/* The same buffer converted to the same format is converted once, and the
+ * result is shared until every user released it */
+GST_START_TEST (test_conversion_cache)
+{
+  GstVideoInfo in_info, out_info, other_info;
+  GstVideoConverter *convert, *other_convert;
+  GstBuffer *buf, *converted[3];
+
+  gst_video_info_set_format (&in_info, GST_VIDEO_FORMAT_I420, 320, 240);
+  gst_video_info_set_format (&out_info, GST_VIDEO_FORMAT_AYUV, 160, 120);
+  gst_video_info_set_format (&other_info, GST_VIDEO_FORMAT_AYUV, 80, 60);
+  convert = gst_video_converter_new (&in_info, &out_info, NULL);
+  other_convert = gst_video_converter_new (&in_info, &other_info, NULL);
+
+  buf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&in_info), NULL);
+  gst_buffer_memset (buf, 0, 0x80, GST_VIDEO_INFO_SIZE (&in_info));
+
+  converted[0] = gst_videoaggregator_convert_buffer (convert, buf, &in_info,
+      &out_info, 0);
+  converted[1] = gst_videoaggregator_convert_buffer (convert, buf, &in_info,
+      &out_info, 0);
+  fail_unless (converted[0] != NULL);
+  fail_unless (converted[1] == converted[0]);
+  /* the cache keeps the input buffer from being reused meanwhile */
+  ASSERT_MINI_OBJECT_REFCOUNT (buf, "buf", 2);
+
+  /* another size is another conversion */
+  converted[2] = gst_videoaggregator_convert_buffer (other_convert, buf,
+      &in_info, &other_info, 0);
+  fail_unless (converted[2] != NULL);
+  fail_unless (converted[2] != converted[0]);
+  fail_unless_equals_int (gst_buffer_get_size (converted[2]),
+      GST_VIDEO_INFO_SIZE (&other_info));
+  gst_videoaggregator_release_converted_buffer (converted[2]);
+  ASSERT_MINI_OBJECT_REFCOUNT (buf, "buf", 2);
+
+  /* still shared while one user holds it */
+  gst_videoaggregator_release_converted_buffer (converted[0]);
+  converted[2] = gst_videoaggregator_convert_buffer (convert, buf, &in_info,
+      &out_info, 0);
+  fail_unless (converted[2] == converted[1]);
+  gst_videoaggregator_release_converted_buffer (converted[2]);
+  ASSERT_MINI_OBJECT_REFCOUNT (buf, "buf", 2);
+
+  /* dropped with its last user, together with the ref on the input */
+  gst_videoaggregator_release_converted_buffer (converted[1]);
+  ASSERT_MINI_OBJECT_REFCOUNT (buf, "buf", 1);
+
+  gst_buffer_unref (buf);
+  gst_video_converter_free (convert);
+  gst_video_converter_free (other_convert);
+}
+
+GST_END_TEST;
+
+/* Two pads showing the same buffers at the same size share one conversion,
+ * both halves of the output must still be identical */
+GST_START_TEST (test_shared_conversion)
+{
+  GstElement *bin, *appsink;
+  GstSample *sample;
+  GstVideoFrame frame;
+  GstVideoInfo info;
+  GError *err = NULL;
+  gint n_frames = 0, y;
+
+  bin = gst_parse_launch ("videotestsrc num-buffers=5 pattern=smpte ! "
+      "video/x-raw,format=I420,width=320,height=240 ! tee name=t "
+      "t. ! queue ! comp.sink_0 t. ! queue ! comp.sink_1 "
+      "compositor name=comp sink_0::width=160 sink_0::height=120 "
+      "sink_1::xpos=160 sink_1::width=160 sink_1::height=120 ! "
+      "video/x-raw,format=AYUV,width=320,height=120 ! "
+      "appsink name=sink sync=false", &err);
+  fail_unless (bin != NULL, "Could not create pipeline: %s",
+      err ? err->message : "");
+  appsink = gst_bin_get_by_name (GST_BIN (bin), "sink");
+
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  while (TRUE) {
+    g_signal_emit_by_name (appsink, "pull-sample", &sample);
+    if (!sample)
+      break;
+
+    fail_unless (gst_video_info_from_caps (&info,
+            gst_sample_get_caps (sample)));
+    fail_unless (gst_video_frame_map (&frame, &info,
+            gst_sample_get_buffer (sample), GST_MAP_READ));
+    for (y = 0; y < GST_VIDEO_FRAME_HEIGHT (&frame); y++) {
+      const guint8 *row = (const guint8 *) GST_VIDEO_FRAME_PLANE_DATA (&frame,
+          0) + y * GST_VIDEO_FRAME_PLANE_STRIDE (&frame, 0);
+
+      fail_unless (memcmp (row, row + 160 * 4, 160 * 4) == 0);
+    }
+    gst_video_frame_unmap (&frame);
+    gst_sample_unref (sample);
+    n_frames++;
+  }
+  fail_unless_equals_int (n_frames, 5);
+
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (appsink);
+  gst_object_unref (bin);
+}
+
+GST_END_TEST;
+
 static Suite *
 compositor_suite (void)
 {
@@ -1446,6 +1557,8 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_segment_base_handling);
   tcase_add_test (tc_chain, test_obscured_skipped);
   tcase_add_test (tc_chain, test_ignore_eos);
+  tcase_add_test (tc_chain, test_conversion_cache);
+  tcase_add_test (tc_chain, test_shared_conversion);
 
   /* Use a longer timeout */
 #ifdef HAVE_VALGRIND
@@ -6,6 +6,8 @@
 #include <glib/gstdio.h>
 #include <curl/curl.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -334,6 +336,187 @@ GST_START_TEST (test_two_files)
 
 GST_END_TEST;
 
+/* Creates a fifo in a new temporary directory. Nothing reads it yet, so
+ * the transfer thread blocks while opening it and does not take any data
+ * from the queue. */
+static gchar *
+make_fifo_dir (void)
+{
+  gchar *dir, *path;
+
+  dir = g_dir_make_tmp ("curlfilesink_XXXXXX", NULL);
+  fail_unless (dir != NULL);
+  path = g_build_filename (dir, "fifo", NULL);
+  fail_unless (mkfifo (path, 0600) == 0);
+  g_free (path);
+
+  return dir;
+}
+
+static void
+remove_fifo_dir (gchar * dir)
+{
+  gchar *path = g_build_filename (dir, "fifo", NULL);
+
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (path);
+  g_free (dir);
+}
+
+static gpointer
+read_fifo (gpointer data)
+{
+  gchar *path = g_build_filename ((const gchar *) data, "fifo", NULL);
+  gchar *contents = NULL;
+
+  g_file_get_contents (path, &contents, NULL, NULL);
+  g_free (path);
+
+  return contents;
+}
+
+static void
+check_queue_stats (GstElement * sink, guint expected_buffers,
+    guint64 expected_bytes, guint64 expected_sent)
+{
+  GstStructure *stats = NULL;
+  guint queued_buffers = 0;
+  guint64 queued_bytes = 0, bytes_sent = 0;
+
+  g_object_get (sink, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get_uint (stats, "queued-buffers",
+          &queued_buffers));
+  fail_unless (gst_structure_get_uint64 (stats, "queued-bytes",
+          &queued_bytes));
+  fail_unless (gst_structure_get_uint64 (stats, "bytes-sent", &bytes_sent));
+  fail_unless_equals_int (queued_buffers, expected_buffers);
+  fail_unless_equals_uint64 (queued_bytes, expected_bytes);
+  fail_unless_equals_uint64 (bytes_sent, expected_sent);
+  gst_structure_free (stats);
+}
+
+static GstElement *
+setup_queued_curlfilesink (const gchar * dir)
+{
+  GstElement *sink;
+  gchar *location;
+  guint64 max_queue_bytes = 0;
+
+  sink = setup_curlfilesink ();
+
+  location = g_strdup_printf ("file://%s/", dir);
+  g_object_set (G_OBJECT (sink), "location", location, NULL);
+  g_object_set (G_OBJECT (sink), "file-name", "fifo", NULL);
+  g_object_set (G_OBJECT (sink), "max-queue-bytes", (guint64) 16, NULL);
+  g_free (location);
+
+  g_object_get (sink, "max-queue-bytes", &max_queue_bytes, NULL);
+  fail_unless_equals_uint64 (max_queue_bytes, 16);
+
+  return sink;
+}
+
+GST_START_TEST (test_queued_upload)
+{
+  GstElement *sink;
+  GstCaps *caps;
+  GThread *reader;
+  gchar *dir, *res_file_content;
+  const gchar *file_line1 = "line 1\r\n";
+  const gchar *file_line2 = "line 2\r\n";
+  const gchar *file_line3 = "line 3\r\n";
+  const gchar *expected_file_content = "line 1\r\n" "line 2\r\n" "line 3\r\n";
+
+  dir = make_fifo_dir ();
+  sink = setup_queued_curlfilesink (dir);
+
+  /* start playing */
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+  caps = gst_caps_from_string ("application/x-gst-check");
+  gst_check_setup_events (srcpad, sink, caps, GST_FORMAT_BYTES);
+
+  /* render returns while nothing has been sent yet */
+  test_set_and_play_buffer (file_line1);
+  test_set_and_play_buffer (file_line2);
+  check_queue_stats (sink, 2, 16, 0);
+
+  reader = g_thread_new ("curlfilesink-reader", read_fifo, dir);
+
+  /* the third buffer has to wait for room in the queue */
+  test_set_and_play_buffer (file_line3);
+
+  /* eos sends everything still queued */
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+  check_queue_stats (sink, 0, 0, strlen (expected_file_content));
+
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+
+  res_file_content = g_thread_join (reader);
+  fail_unless_equals_string (res_file_content, expected_file_content);
+  g_free (res_file_content);
+
+  gst_caps_unref (caps);
+  cleanup_curlfilesink (sink);
+  remove_fifo_dir (dir);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_queued_flush)
+{
+  GstElement *sink;
+  GstCaps *caps;
+  GstSegment segment;
+  GThread *reader;
+  gchar *dir, *res_file_content;
+  const gchar *file_line1 = "line 1\r\n";
+  const gchar *file_line2 = "line 2\r\n";
+  const gchar *file_line3 = "line 3\r\n";
+  const gchar *expected_file_content = "line 1\r\n" "line 3\r\n";
+
+  dir = make_fifo_dir ();
+  sink = setup_queued_curlfilesink (dir);
+
+  /* start playing */
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+  caps = gst_caps_from_string ("application/x-gst-check");
+  gst_check_setup_events (srcpad, sink, caps, GST_FORMAT_BYTES);
+
+  test_set_and_play_buffer (file_line1);
+  test_set_and_play_buffer (file_line2);
+  check_queue_stats (sink, 2, 16, 0);
+
+  /* the first buffer is already with the transfer thread, the second one
+   * is dropped */
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_flush_start ()));
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_flush_stop (TRUE)));
+  check_queue_stats (sink, 1, 8, 0);
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  reader = g_thread_new ("curlfilesink-reader", read_fifo, dir);
+
+  test_set_and_play_buffer (file_line3);
+
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+  check_queue_stats (sink, 0, 0, strlen (expected_file_content));
+
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+
+  res_file_content = g_thread_join (reader);
+  fail_unless_equals_string (res_file_content, expected_file_content);
+  g_free (res_file_content);
+
+  gst_caps_unref (caps);
+  cleanup_curlfilesink (sink);
+  remove_fifo_dir (dir);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_create_dirs)
 {
   GstElement *sink;
@@ -448,6 +631,8 @@ curlsink_suite (void)
   tcase_add_test (tc_chain, test_two_files);
   tcase_add_test (tc_chain, test_missing_path);
   tcase_add_test (tc_chain, test_create_dirs);
+  tcase_add_test (tc_chain, test_queued_upload);
+  tcase_add_test (tc_chain, test_queued_flush);
 
   return s;
 }
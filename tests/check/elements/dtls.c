@@ -0,0 +1,287 @@
+/* GStreamer
+ *
+ * unit test for dtlsenc and dtlsdec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <string.h>
+
+static GMutex key_lock;
+static GCond key_cond;
+static guint n_keys;
+
+static void
+on_key_received (GstElement * dec, gpointer user_data)
+{
+  g_mutex_lock (&key_lock);
+  n_keys++;
+  g_cond_broadcast (&key_cond);
+  g_mutex_unlock (&key_lock);
+}
+
+static GstElement *
+make_dec (const gchar * id, const gchar * key_type, const gchar * pem)
+{
+  GstElement *dec;
+
+  dec = gst_element_factory_make ("dtlsdec", NULL);
+  fail_unless (dec != NULL);
+
+  /* both must be known before the connection-id */
+  if (key_type)
+    gst_util_set_object_arg (G_OBJECT (dec), "key-type", key_type);
+  if (pem)
+    g_object_set (dec, "pem", pem, NULL);
+  g_object_set (dec, "connection-id", id, NULL);
+
+  g_signal_connect (dec, "on-key-received", G_CALLBACK (on_key_received),
+      NULL);
+
+  return dec;
+}
+
+static GstElement *
+make_enc (const gchar * id, gboolean is_client)
+{
+  GstElement *enc;
+
+  enc = gst_element_factory_make ("dtlsenc", NULL);
+  fail_unless (enc != NULL);
+  g_object_set (enc, "connection-id", id, "is-client", is_client, NULL);
+
+  return enc;
+}
+
+/* Runs a handshake between a client and a server decoder made with @key_type
+ * and @pem, and returns them once both received their keys */
+static void
+handshake (const gchar * key_type, const gchar * pem, GstElement ** client,
+    GstElement ** server)
+{
+  static guint n_connections = 0;
+  GstElement *pipeline, *c_dec, *c_enc, *s_dec, *s_enc;
+  gchar *c_id, *s_id;
+  gint64 end_time;
+
+  c_id = g_strdup_printf ("client-%u", n_connections);
+  s_id = g_strdup_printf ("server-%u", n_connections);
+  n_connections++;
+
+  c_dec = make_dec (c_id, key_type, pem);
+  s_dec = make_dec (s_id, key_type, pem);
+  c_enc = make_enc (c_id, TRUE);
+  s_enc = make_enc (s_id, FALSE);
+  g_free (c_id);
+  g_free (s_id);
+
+  pipeline = gst_pipeline_new (NULL);
+  gst_bin_add_many (GST_BIN (pipeline), c_dec, c_enc, s_dec, s_enc, NULL);
+  fail_unless (gst_element_link (c_enc, s_dec));
+  fail_unless (gst_element_link (s_enc, c_dec));
+
+  n_keys = 0;
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  end_time = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+  g_mutex_lock (&key_lock);
+  while (n_keys < 2)
+    fail_unless (g_cond_wait_until (&key_cond, &key_lock, end_time),
+        "handshake timed out");
+  g_mutex_unlock (&key_lock);
+
+  *client = gst_object_ref (c_dec);
+  *server = gst_object_ref (s_dec);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+static void
+check_stats (GstElement * dec, gboolean generated)
+{
+  GstStructure *stats;
+  guint64 time;
+  guint retransmissions;
+
+  g_object_get (dec, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+
+  fail_unless (gst_structure_get_uint64 (stats, "certificate-generation-time",
+          &time));
+  if (generated)
+    fail_unless (time > 0);
+  else
+    fail_unless_equals_uint64 (time, 0);
+
+  fail_unless (gst_structure_get_uint64 (stats, "peer-certificate-time",
+          &time));
+  fail_unless (GST_CLOCK_TIME_IS_VALID (time));
+  fail_unless (gst_structure_get_uint64 (stats, "handshake-time", &time));
+  fail_unless (GST_CLOCK_TIME_IS_VALID (time));
+  fail_unless (gst_structure_get_uint (stats, "retransmissions",
+          &retransmissions));
+
+  gst_structure_free (stats);
+}
+
+/* the peer certificate of @dec is the certificate of @peer */
+static void
+check_peer_pem (GstElement * dec, GstElement * peer)
+{
+  gchar *peer_pem, *pem;
+
+  g_object_get (dec, "peer-pem", &peer_pem, NULL);
+  g_object_get (peer, "pem", &pem, NULL);
+  fail_unless (peer_pem != NULL);
+  fail_unless_equals_string (peer_pem, pem);
+  g_free (peer_pem);
+  g_free (pem);
+}
+
+static void
+check_handshake (const gchar * key_type)
+{
+  GstElement *client, *server;
+
+  handshake (key_type, NULL, &client, &server);
+
+  check_stats (client, TRUE);
+  check_stats (server, TRUE);
+  check_peer_pem (client, server);
+  check_peer_pem (server, client);
+
+  gst_object_unref (client);
+  gst_object_unref (server);
+}
+
+GST_START_TEST (test_handshake_rsa)
+{
+  check_handshake (NULL);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_handshake_ecdsa)
+{
+  check_handshake ("ecdsa");
+}
+
+GST_END_TEST;
+
+/* The private-pem of a generated certificate can be set as pem to skip the
+ * generation, while the pem only holds the certificate */
+GST_START_TEST (test_private_pem)
+{
+  GstElement *client, *server;
+  gchar *pem, *private_pem, *peer_pem;
+
+  handshake ("ecdsa", NULL, &client, &server);
+  g_object_get (client, "pem", &pem, "private-pem", &private_pem, NULL);
+  gst_object_unref (client);
+  gst_object_unref (server);
+
+  fail_unless (g_str_has_prefix (pem, "-----BEGIN CERTIFICATE-----"));
+  fail_if (strstr (pem, "PRIVATE KEY") != NULL);
+  fail_unless (g_str_has_prefix (private_pem, pem));
+  fail_unless (strstr (private_pem, "PRIVATE KEY") != NULL);
+
+  handshake (NULL, private_pem, &client, &server);
+
+  check_stats (client, FALSE);
+  check_stats (server, FALSE);
+  g_object_get (client, "peer-pem", &peer_pem, NULL);
+  fail_unless_equals_string (peer_pem, pem);
+
+  gst_object_unref (client);
+  gst_object_unref (server);
+  g_free (peer_pem);
+  g_free (private_pem);
+  g_free (pem);
+}
+
+GST_END_TEST;
+
+static gpointer
+get_pem (gpointer data)
+{
+  GstElement *dec = data;
+  gchar *pem;
+
+  g_object_get (dec, "pem", &pem, NULL);
+
+  return pem;
+}
+
+/* Elements waiting for a generated certificate do not block each other,
+ * and elements with the same key type share one certificate */
+GST_START_TEST (test_generated_certificates)
+{
+  GstElement *rsa[2], *ecdsa;
+  GThread *threads[2];
+  gchar *rsa_pem[2], *ecdsa_pem;
+  guint i;
+
+  for (i = 0; i < 2; i++) {
+    rsa[i] = gst_element_factory_make ("dtlsdec", NULL);
+    threads[i] = g_thread_new ("dtls-test", get_pem, rsa[i]);
+  }
+
+  /* generated in the background while the RSA key is still being made */
+  ecdsa = gst_element_factory_make ("dtlsdec", NULL);
+  gst_util_set_object_arg (G_OBJECT (ecdsa), "key-type", "ecdsa");
+  ecdsa_pem = get_pem (ecdsa);
+
+  for (i = 0; i < 2; i++)
+    rsa_pem[i] = g_thread_join (threads[i]);
+
+  fail_unless (rsa_pem[0] != NULL);
+  fail_unless (ecdsa_pem != NULL);
+  fail_unless_equals_string (rsa_pem[0], rsa_pem[1]);
+  fail_unless (strcmp (rsa_pem[0], ecdsa_pem) != 0);
+
+  for (i = 0; i < 2; i++) {
+    g_free (rsa_pem[i]);
+    gst_object_unref (rsa[i]);
+  }
+  g_free (ecdsa_pem);
+  gst_object_unref (ecdsa);
+}
+
+GST_END_TEST;
+
+static Suite *
+dtls_suite (void)
+{
+  Suite *s = suite_create ("dtls");
+  TCase *tc_chain = tcase_create ("general");
+
+  /* RSA keys can take a while */
+  tcase_set_timeout (tc_chain, 60);
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_handshake_rsa);
+  tcase_add_test (tc_chain, test_handshake_ecdsa);
+  tcase_add_test (tc_chain, test_private_pem);
+  tcase_add_test (tc_chain, test_generated_certificates);
+
+  return s;
+}
+
+GST_CHECK_MAIN (dtls);
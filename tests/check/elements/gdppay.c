@@ -557,6 +557,58 @@ GST_START_TEST (test_crc)
 GST_END_TEST;
 
 
+/* the payload of a GDP buffer packet is the original memory */
+GST_START_TEST (test_payload_no_copy)
+{
+  GstCaps *caps;
+  GstElement *gdppay;
+  GstBuffer *inbuffer, *outbuffer;
+  GstMemory *payload_mem;
+
+  gdppay = setup_gdppay ();
+  g_object_set (gdppay, "crc-header", FALSE, "crc-payload", FALSE, NULL);
+
+  fail_unless (gst_element_set_state (gdppay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  inbuffer = gst_buffer_new_and_alloc (4);
+  gst_buffer_memset (inbuffer, 0, 0xaa, 4);
+  payload_mem = gst_buffer_get_memory (inbuffer, 0);
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, gdppay, caps, GST_FORMAT_TIME);
+
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 4);
+
+  check_stream_start_buffer (1);
+  check_caps_buffer (1, caps);
+  check_segment_buffer (1);
+
+  /* header memory followed by the payload memory */
+  fail_if ((outbuffer = (GstBuffer *) buffers->data) == NULL);
+  buffers = g_list_remove (buffers, outbuffer);
+  fail_unless_equals_int (gst_buffer_get_size (outbuffer),
+      GST_DP_HEADER_LENGTH + 4);
+  fail_unless_equals_int (gst_buffer_n_memory (outbuffer), 2);
+  fail_unless (gst_buffer_peek_memory (outbuffer, 1) == payload_mem);
+  gst_buffer_unref (outbuffer);
+  gst_memory_unref (payload_mem);
+
+  fail_unless (gst_element_set_state (gdppay,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  gst_caps_unref (caps);
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+  ASSERT_OBJECT_REFCOUNT (gdppay, "gdppay", 1);
+  cleanup_gdppay (gdppay);
+}
+
+GST_END_TEST;
+
+
 static Suite *
 gdppay_suite (void)
 {
@@ -569,6 +621,7 @@ gdppay_suite (void)
   tcase_add_test (tc_chain, test_first_no_new_segment);
   tcase_add_test (tc_chain, test_streamheader);
   tcase_add_test (tc_chain, test_crc);
+  tcase_add_test (tc_chain, test_payload_no_copy);
 
   return s;
 }
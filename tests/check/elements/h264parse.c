@@ -416,6 +416,178 @@ h264parse_packetized_suite (void)
 }
 
 
+/* stream format conversion, with several NAL units in every input buffer */
+
+static GstPad *mysrcpad, *mysinkpad;
+
+/* Appends @nal, which starts with a 4 byte start code, to @data with a start
+ * code or with a 4 byte length prefix */
+static void
+append_nal (GByteArray * data, const guint8 * nal, gsize size, gboolean avc)
+{
+  guint8 prefix[4];
+
+  if (avc)
+    GST_WRITE_UINT32_BE (prefix, size - 4);
+  else
+    GST_WRITE_UINT32_BE (prefix, 1);
+  g_byte_array_append (data, prefix, 4);
+  g_byte_array_append (data, nal + 4, size - 4);
+}
+
+/* An access unit of SPS, PPS and IDR slice */
+static void
+append_au (GByteArray * data, gboolean avc)
+{
+  append_nal (data, h264_sps, sizeof (h264_sps), avc);
+  append_nal (data, h264_pps, sizeof (h264_pps), avc);
+  append_nal (data, h264_idrframe, sizeof (h264_idrframe), avc);
+}
+
+#define N_AUS 3
+
+/* Pushes N_AUS access units with the @input_caps stream format, one per
+ * buffer, and collects the output for downstream with the caps of
+ * @sinktemplate. Returns the output bytes, the number of output buffers in
+ * @n_buffers and the output caps in @out_caps. */
+static GByteArray *
+convert (const gchar * input_caps, GstStaticPadTemplate * sinktemplate,
+    guint * n_buffers, GstCaps ** out_caps)
+{
+  GstElement *parse;
+  GstCaps *caps;
+  GstBuffer *buf;
+  GByteArray *input, *output;
+  gboolean avc;
+  GList *l;
+  guint i;
+
+  parse = gst_check_setup_element ("h264parse");
+  mysrcpad = gst_check_setup_src_pad (parse, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (parse, sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (parse,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (input_caps);
+  avc = !g_str_equal (gst_structure_get_string (gst_caps_get_structure (caps,
+              0), "stream-format"), "byte-stream");
+  if (avc) {
+    buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        h264_avc_codec_data, sizeof (h264_avc_codec_data), 0,
+        sizeof (h264_avc_codec_data), NULL, NULL);
+    gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER, buf, NULL);
+    gst_buffer_unref (buf);
+  }
+  gst_check_setup_events (mysrcpad, parse, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < N_AUS; i++) {
+    input = g_byte_array_new ();
+    append_au (input, avc);
+    buf = gst_buffer_new_wrapped (input->data, input->len);
+    g_byte_array_free (input, FALSE);
+    GST_BUFFER_PTS (buf) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (buf) = 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  output = g_byte_array_new ();
+  for (l = buffers; l; l = l->next) {
+    GstMapInfo map;
+
+    gst_buffer_map (l->data, &map, GST_MAP_READ);
+    g_byte_array_append (output, map.data, map.size);
+    gst_buffer_unmap (l->data, &map);
+  }
+  *n_buffers = g_list_length (buffers);
+  *out_caps = gst_pad_get_current_caps (mysinkpad);
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (parse, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (parse);
+  gst_check_teardown_sink_pad (parse);
+  gst_check_teardown_element (parse);
+
+  return output;
+}
+
+static void
+check_conversion (const gchar * input_caps,
+    GstStaticPadTemplate * sinktemplate, gboolean avc, guint n_expected)
+{
+  GByteArray *expected, *output;
+  GstCaps *caps;
+  GstStructure *s;
+  guint i, n_buffers;
+
+  expected = g_byte_array_new ();
+  for (i = 0; i < N_AUS; i++)
+    append_au (expected, avc);
+
+  output = convert (input_caps, sinktemplate, &n_buffers, &caps);
+  fail_unless_equals_int (n_buffers, n_expected);
+  fail_unless_equals_int (output->len, expected->len);
+  fail_unless (memcmp (output->data, expected->data, expected->len) == 0);
+
+  fail_unless (caps != NULL);
+  s = gst_caps_get_structure (caps, 0);
+  fail_unless_equals_string (gst_structure_get_string (s, "stream-format"),
+      avc ? "avc" : "byte-stream");
+  fail_unless_equals_int (gst_structure_has_field (s, "codec_data"), avc);
+  gst_caps_unref (caps);
+
+  g_byte_array_unref (output);
+  g_byte_array_unref (expected);
+}
+
+#define AVC_CAPS SRC_CAPS_TMPL ", stream-format = (string) avc, " \
+    "alignment = (string) au"
+#define BS_CAPS SRC_CAPS_TMPL ", stream-format = (string) byte-stream"
+
+/* every input buffer is split into its NAL units */
+GST_START_TEST (test_convert_avc_to_bs_nal)
+{
+  check_conversion (AVC_CAPS, &sinktemplate_bs_nal, FALSE, 3 * N_AUS);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_convert_avc_to_bs_au)
+{
+  check_conversion (AVC_CAPS, &sinktemplate_bs_au, FALSE, N_AUS);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_convert_bs_to_avc_au)
+{
+  check_conversion (BS_CAPS, &sinktemplate_avc_au, TRUE, N_AUS);
+}
+
+GST_END_TEST;
+
+static Suite *
+h264parse_convert_suite (void)
+{
+  Suite *s = suite_create (ctx_suite);
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_convert_avc_to_bs_nal);
+  tcase_add_test (tc_chain, test_convert_avc_to_bs_au);
+  tcase_add_test (tc_chain, test_convert_bs_to_avc_au);
+
+  return s;
+}
+
+
 /*
  * TODO:
  *   - Both push- and pull-modes need to be tested
@@ -522,5 +694,12 @@ main (int argc, char **argv)
   nf += srunner_ntests_failed (sr);
   srunner_free (sr);
 
+  ctx_suite = "h264parse_convert";
+  s = h264parse_convert_suite ();
+  sr = srunner_create (s);
+  srunner_run_all (sr, CK_NORMAL);
+  nf += srunner_ntests_failed (sr);
+  srunner_free (sr);
+
   return nf;
 }
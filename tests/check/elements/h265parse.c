@@ -0,0 +1,263 @@
+/*
+ * GStreamer
+ *
+ * unit test for h265parse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#define SRC_CAPS_TMPL   "video/x-h265, parsed=(boolean)false"
+#define SINK_CAPS_TMPL  "video/x-h265, parsed=(boolean)true"
+
+static GstStaticPadTemplate sinktemplate_bs_nal =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SINK_CAPS_TMPL
+        ", stream-format = (string) byte-stream, alignment = (string) nal")
+    );
+
+static GstStaticPadTemplate sinktemplate_bs_au =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SINK_CAPS_TMPL
+        ", stream-format = (string) byte-stream, alignment = (string) au")
+    );
+
+static GstStaticPadTemplate sinktemplate_hvc1_au =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SINK_CAPS_TMPL
+        ", stream-format = (string) hvc1, alignment = (string) au")
+    );
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SRC_CAPS_TMPL)
+    );
+
+static GstPad *mysrcpad, *mysinkpad;
+
+/* 64x64 main profile VPS, SPS and PPS, and the start of an IDR slice */
+static const guint8 h265_vps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+  0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x1e, 0xf0, 0x24
+};
+
+static const guint8 h265_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+  0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x1e, 0xa0, 0x20,
+  0x81, 0x05, 0x97, 0xea, 0xf0, 0x82
+};
+
+static const guint8 h265_pps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0x71, 0x80, 0x12
+};
+
+static const guint8 h265_idr[] = {
+  0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xae, 0xbc, 0x1a, 0xe1, 0x8f, 0xbc,
+  0xe9, 0xfc, 0xf9, 0x4f, 0xff, 0xc9, 0x2b, 0xbd, 0xa9, 0x79, 0xb6
+};
+
+/* the same parameter sets as hvcC codec_data, with 4 byte NAL lengths */
+static guint8 h265_hvcc[] = {
+  0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x1e, 0xf0, 0x00, 0xfc, 0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f, 0x03, 0x20,
+  0x00, 0x01, 0x00, 0x17, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+  0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x1e, 0xf0, 0x24, 0x21, 0x00, 0x01, 0x00, 0x1a, 0x42, 0x01, 0x01, 0x01,
+  0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+  0x00, 0x1e, 0xa0, 0x20, 0x81, 0x05, 0x97, 0xea, 0xf0, 0x82, 0x22, 0x00,
+  0x01, 0x00, 0x06, 0x44, 0x01, 0xc0, 0x71, 0x80, 0x12
+};
+
+/* Appends @nal, which starts with a 4 byte start code, to @data with a start
+ * code or with a 4 byte length prefix */
+static void
+append_nal (GByteArray * data, const guint8 * nal, gsize size, gboolean hvc1)
+{
+  guint8 prefix[4];
+
+  if (hvc1)
+    GST_WRITE_UINT32_BE (prefix, size - 4);
+  else
+    GST_WRITE_UINT32_BE (prefix, 1);
+  g_byte_array_append (data, prefix, 4);
+  g_byte_array_append (data, nal + 4, size - 4);
+}
+
+/* An access unit of VPS, SPS, PPS and IDR slice */
+static void
+append_au (GByteArray * data, gboolean hvc1)
+{
+  append_nal (data, h265_vps, sizeof (h265_vps), hvc1);
+  append_nal (data, h265_sps, sizeof (h265_sps), hvc1);
+  append_nal (data, h265_pps, sizeof (h265_pps), hvc1);
+  append_nal (data, h265_idr, sizeof (h265_idr), hvc1);
+}
+
+#define N_AUS 3
+
+/* Pushes N_AUS access units with the @input_caps stream format, one per
+ * buffer, and collects the output for downstream with the caps of
+ * @sinktemplate. Returns the output bytes, the number of output buffers in
+ * @n_buffers and the output caps in @out_caps. */
+static GByteArray *
+convert (const gchar * input_caps, GstStaticPadTemplate * sinktemplate,
+    guint * n_buffers, GstCaps ** out_caps)
+{
+  GstElement *parse;
+  GstCaps *caps;
+  GstBuffer *buf;
+  GByteArray *input, *output;
+  gboolean hvc1;
+  GList *l;
+  guint i;
+
+  parse = gst_check_setup_element ("h265parse");
+  mysrcpad = gst_check_setup_src_pad (parse, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (parse, sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (parse,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (input_caps);
+  hvc1 = !g_str_equal (gst_structure_get_string (gst_caps_get_structure (caps,
+              0), "stream-format"), "byte-stream");
+  if (hvc1) {
+    buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        h265_hvcc, sizeof (h265_hvcc), 0, sizeof (h265_hvcc), NULL, NULL);
+    gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER, buf, NULL);
+    gst_buffer_unref (buf);
+  }
+  gst_check_setup_events (mysrcpad, parse, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < N_AUS; i++) {
+    input = g_byte_array_new ();
+    append_au (input, hvc1);
+    buf = gst_buffer_new_wrapped (input->data, input->len);
+    g_byte_array_free (input, FALSE);
+    GST_BUFFER_PTS (buf) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (buf) = 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  output = g_byte_array_new ();
+  for (l = buffers; l; l = l->next) {
+    GstMapInfo map;
+
+    gst_buffer_map (l->data, &map, GST_MAP_READ);
+    g_byte_array_append (output, map.data, map.size);
+    gst_buffer_unmap (l->data, &map);
+  }
+  *n_buffers = g_list_length (buffers);
+  *out_caps = gst_pad_get_current_caps (mysinkpad);
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (parse, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (parse);
+  gst_check_teardown_sink_pad (parse);
+  gst_check_teardown_element (parse);
+
+  return output;
+}
+
+static void
+check_conversion (const gchar * input_caps,
+    GstStaticPadTemplate * sinktemplate, gboolean hvc1, guint n_expected)
+{
+  GByteArray *expected, *output;
+  GstCaps *caps;
+  GstStructure *s;
+  guint i, n_buffers;
+  gint width;
+
+  expected = g_byte_array_new ();
+  for (i = 0; i < N_AUS; i++)
+    append_au (expected, hvc1);
+
+  output = convert (input_caps, sinktemplate, &n_buffers, &caps);
+  fail_unless_equals_int (n_buffers, n_expected);
+  fail_unless_equals_int (output->len, expected->len);
+  fail_unless (memcmp (output->data, expected->data, expected->len) == 0);
+
+  fail_unless (caps != NULL);
+  s = gst_caps_get_structure (caps, 0);
+  fail_unless_equals_string (gst_structure_get_string (s, "stream-format"),
+      hvc1 ? "hvc1" : "byte-stream");
+  fail_unless (gst_structure_get_int (s, "width", &width));
+  fail_unless_equals_int (width, 64);
+  fail_unless_equals_int (gst_structure_has_field (s, "codec_data"), hvc1);
+  gst_caps_unref (caps);
+
+  g_byte_array_unref (output);
+  g_byte_array_unref (expected);
+}
+
+#define HVC1_CAPS SRC_CAPS_TMPL ", stream-format = (string) hvc1, " \
+    "alignment = (string) au"
+#define BS_CAPS SRC_CAPS_TMPL ", stream-format = (string) byte-stream"
+
+/* every input buffer is split into its NAL units */
+GST_START_TEST (test_convert_hvc1_to_bs_nal)
+{
+  check_conversion (HVC1_CAPS, &sinktemplate_bs_nal, FALSE, 4 * N_AUS);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_convert_hvc1_to_bs_au)
+{
+  check_conversion (HVC1_CAPS, &sinktemplate_bs_au, FALSE, N_AUS);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_convert_bs_to_hvc1_au)
+{
+  check_conversion (BS_CAPS, &sinktemplate_hvc1_au, TRUE, N_AUS);
+}
+
+GST_END_TEST;
+
+static Suite *
+h265parse_suite (void)
+{
+  Suite *s = suite_create ("h265parse");
+  TCase *tc_chain = tcase_create ("convert");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_convert_hvc1_to_bs_nal);
+  tcase_add_test (tc_chain, test_convert_hvc1_to_bs_au);
+  tcase_add_test (tc_chain, test_convert_bs_to_hvc1_au);
+
+  return s;
+}
+
+GST_CHECK_MAIN (h265parse);
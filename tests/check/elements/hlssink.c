@@ -0,0 +1,165 @@
+/* GStreamer
+ *
+ * unit test for hlssink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstPad *srcpad;
+
+static GPtrArray *fragments;
+static GPtrArray *deleted;
+static gchar *last_playlist;
+
+static const gchar *final_playlist = "#EXTM3U\n"
+    "#EXT-X-VERSION:3\n"
+    "#EXT-X-ALLOW-CACHE:NO\n"
+    "#EXT-X-MEDIA-SEQUENCE:1\n"
+    "#EXT-X-TARGETDURATION:1\n"
+    "\n"
+    "#EXTINF:1,\n" "fragment00001.ts\n"
+    "#EXTINF:1,\n" "fragment00002.ts\n" "#EXT-X-ENDLIST";
+
+static gboolean
+write_fragment_cb (GstElement * sink, const gchar * location,
+    GstBufferList * fragment, gpointer user_data)
+{
+  /* one buffer per fragment */
+  fail_unless_equals_int (gst_buffer_list_length (fragment), 1);
+  g_ptr_array_add (fragments, g_strdup (location));
+
+  return TRUE;
+}
+
+static gboolean
+write_playlist_cb (GstElement * sink, const gchar * location,
+    const gchar * playlist, gpointer user_data)
+{
+  fail_unless_equals_string (location, "playlist.m3u8");
+  g_free (last_playlist);
+  last_playlist = g_strdup (playlist);
+
+  return TRUE;
+}
+
+static void
+delete_fragment_cb (GstElement * sink, const gchar * location,
+    gpointer user_data)
+{
+  g_ptr_array_add (deleted, g_strdup (location));
+}
+
+static void
+push_fragment (guint index)
+{
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, 188, NULL);
+
+  gst_buffer_memset (buffer, 0, 0x47, 188);
+  GST_BUFFER_PTS (buffer) = index * GST_SECOND;
+  GST_BUFFER_DURATION (buffer) = GST_SECOND;
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+}
+
+static void
+push_key_unit (guint index)
+{
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_video_event_new_downstream_force_key_unit (index * GST_SECOND,
+              index * GST_SECOND, index * GST_SECOND, TRUE, index)));
+}
+
+GST_START_TEST (test_app_writer)
+{
+  GstElement *sink;
+  GstCaps *caps;
+
+  fragments = g_ptr_array_new_with_free_func (g_free);
+  deleted = g_ptr_array_new_with_free_func (g_free);
+
+  sink = gst_check_setup_element ("hlssink");
+  gst_util_set_object_arg (G_OBJECT (sink), "writer", "app");
+  g_object_set (sink, "location", "fragment%05d.ts", "target-duration", 0,
+      "playlist-length", 2, "max-files", 2, NULL);
+  g_signal_connect (sink, "write-fragment", G_CALLBACK (write_fragment_cb),
+      NULL);
+  g_signal_connect (sink, "write-playlist", G_CALLBACK (write_playlist_cb),
+      NULL);
+  g_signal_connect (sink, "delete-fragment", G_CALLBACK (delete_fragment_cb),
+      NULL);
+
+  srcpad = gst_check_setup_src_pad (sink, &srctemplate);
+  fail_unless (gst_pad_set_active (srcpad, TRUE));
+
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+  caps = gst_caps_from_string ("video/mpegts");
+  gst_check_setup_events (srcpad, sink, caps, GST_FORMAT_TIME);
+
+  push_fragment (0);
+  push_key_unit (1);
+  push_fragment (1);
+  push_key_unit (2);
+  push_fragment (2);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (fragments->len, 3);
+  fail_unless_equals_string (g_ptr_array_index (fragments, 0),
+      "fragment00000.ts");
+  fail_unless_equals_string (g_ptr_array_index (fragments, 2),
+      "fragment00002.ts");
+
+  /* max-files */
+  fail_unless_equals_int (deleted->len, 1);
+  fail_unless_equals_string (g_ptr_array_index (deleted, 0),
+      "fragment00000.ts");
+
+  /* the first entry has been trimmed from the rendered playlist */
+  fail_unless_equals_string (last_playlist, final_playlist);
+
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+
+  gst_caps_unref (caps);
+  gst_check_teardown_src_pad (sink);
+  gst_check_teardown_element (sink);
+
+  g_ptr_array_unref (fragments);
+  g_ptr_array_unref (deleted);
+  g_free (last_playlist);
+  last_playlist = NULL;
+}
+
+GST_END_TEST;
+
+static Suite *
+hlssink_suite (void)
+{
+  Suite *s = suite_create ("hlssink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_app_writer);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlssink);
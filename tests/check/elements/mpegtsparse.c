@@ -0,0 +1,387 @@
+/* GStreamer
+ *
+ * unit test for tsparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <string.h>
+
+#define PACKET_SIZE 188
+
+/* program 1 has its PMT on 0x1000 and one stream on 0x100, program 2 its
+ * PMT on 0x1001 and one stream on 0x200 */
+#define PMT_PID(program) (0x1000 + (program) - 1)
+#define ES_PID(program) (0x100 * (program))
+
+#define N_PACKETS 10
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/mpegts, systemstream = (boolean) true"));
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstElement *tsparse;
+static GstPad *mysrcpad, *program_sinkpad, *tssinkpad, *program_pad;
+
+/* everything output on the program_1 pad */
+static GByteArray *program_data;
+
+/* the packets of the stream of program 1 */
+static guint8 es_packets[N_PACKETS * PACKET_SIZE];
+
+static guint32
+calc_crc32 (const guint8 * data, guint len)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < len; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+/* Writes a packet with @payload_size bytes of @payload to @packet, and
+ * stuffs the rest of it */
+static void
+write_packet (guint8 * packet, guint16 pid, gboolean unit_start, guint8 cc,
+    const guint8 * payload, guint payload_size)
+{
+  packet[0] = 0x47;
+  packet[1] = (unit_start ? 0x40 : 0x00) | (pid >> 8);
+  packet[2] = pid & 0xff;
+  packet[3] = 0x10 | (cc & 0x0f);
+  if (payload_size)
+    memcpy (packet + 4, payload, payload_size);
+  memset (packet + 4 + payload_size, 0xff, PACKET_SIZE - 4 - payload_size);
+}
+
+/* Writes a packet carrying the section in @section, whose size and CRC are
+ * filled in here */
+static void
+write_section_packet (guint8 * packet, guint16 pid, guint8 * section,
+    guint size)
+{
+  guint8 payload[PACKET_SIZE - 4];
+  guint32 crc;
+
+  /* section_length counts everything after it, the CRC included */
+  section[1] = 0xb0 | ((size + 4 - 3) >> 8);
+  section[2] = (size + 4 - 3) & 0xff;
+  crc = calc_crc32 (section, size);
+  GST_WRITE_UINT32_BE (section + size, crc);
+
+  /* pointer_field */
+  payload[0] = 0;
+  memcpy (payload + 1, section, size + 4);
+  write_packet (packet, pid, TRUE, 0, payload, size + 5);
+}
+
+static void
+write_pat (guint8 * packet)
+{
+  guint8 pat[] = {
+    0x00, 0, 0, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PMT_PID (1) >> 8), PMT_PID (1) & 0xff,
+    0x00, 0x02, 0xe0 | (PMT_PID (2) >> 8), PMT_PID (2) & 0xff,
+    0, 0, 0, 0
+  };
+
+  write_section_packet (packet, 0, pat, sizeof (pat) - 4);
+}
+
+static void
+write_pmt (guint8 * packet, guint program)
+{
+  guint8 pmt[] = {
+    0x02, 0, 0, 0x00, program, 0xc1, 0x00, 0x00,
+    0xe0 | (ES_PID (program) >> 8), ES_PID (program) & 0xff, 0xf0, 0x00,
+    0x1b, 0xe0 | (ES_PID (program) >> 8), ES_PID (program) & 0xff,
+    0xf0, 0x00,
+    0, 0, 0, 0
+  };
+
+  write_section_packet (packet, PMT_PID (program), pmt, sizeof (pmt) - 4);
+}
+
+static void
+write_es_packet (guint8 * packet, guint program, guint n)
+{
+  guint8 payload[PACKET_SIZE - 4];
+
+  memset (payload, program * 0x10 + n, sizeof (payload));
+  write_packet (packet, ES_PID (program), n == 0, n, payload,
+      sizeof (payload));
+}
+
+static void
+push_data (const guint8 * data, gsize size, gboolean discont)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new_and_alloc (size);
+  gst_buffer_fill (buf, 0, data, size);
+  if (discont)
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+}
+
+static GstFlowReturn
+program_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstMapInfo map;
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  g_byte_array_append (program_data, map.data, map.size);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+drop_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  gst_buffer_unref (buf);
+
+  return GST_FLOW_OK;
+}
+
+static GstPad *
+link_sink_pad (GstPad * srcpad, GstPadChainFunction chain)
+{
+  GstPad *sinkpad;
+
+  sinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (sinkpad, chain);
+  fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  return sinkpad;
+}
+
+/* Sets up tsparse with a program_1 pad, and pushes the PAT and PMTs of
+ * both programs */
+static void
+setup_tsparse (void)
+{
+  guint8 psi[5 * PACKET_SIZE];
+  GstCaps *caps;
+  GstPad *srcpad;
+  guint i;
+
+  tsparse = gst_check_setup_element ("tsparse");
+  mysrcpad = gst_check_setup_src_pad (tsparse, &srctemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  program_pad = gst_element_get_request_pad (tsparse, "program_1");
+  fail_unless (program_pad != NULL);
+  program_sinkpad = link_sink_pad (program_pad, program_chain);
+
+  /* the multi-program stream is not checked here, it only must not
+   * return not-linked */
+  srcpad = gst_element_get_static_pad (tsparse, "src");
+  tssinkpad = link_sink_pad (srcpad, drop_chain);
+  gst_object_unref (srcpad);
+
+  program_data = g_byte_array_new ();
+  for (i = 0; i < N_PACKETS; i++)
+    write_es_packet (es_packets + i * PACKET_SIZE, 1, i);
+
+  fail_unless_equals_int (gst_element_set_state (tsparse, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("video/mpegts, systemstream = (boolean) true, "
+      "packetsize = (int) 188");
+  gst_check_setup_events (mysrcpad, tsparse, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  /* the packet size is only detected on 4 packets of the biggest size, so
+   * also add null packets */
+  write_pat (psi);
+  write_pmt (psi + PACKET_SIZE, 1);
+  write_pmt (psi + 2 * PACKET_SIZE, 2);
+  write_packet (psi + 3 * PACKET_SIZE, 0x1fff, FALSE, 0, NULL, 0);
+  write_packet (psi + 4 * PACKET_SIZE, 0x1fff, FALSE, 0, NULL, 0);
+  push_data (psi, sizeof (psi), FALSE);
+
+  /* only the PMT of program 1 goes to its pad, the PAT came before the
+   * program was known */
+  fail_unless_equals_int (program_data->len, PACKET_SIZE);
+  fail_unless (memcmp (program_data->data, psi + PACKET_SIZE,
+          PACKET_SIZE) == 0);
+  g_byte_array_set_size (program_data, 0);
+}
+
+static void
+cleanup_tsparse (void)
+{
+  GstPad *srcpad;
+
+  gst_element_set_state (tsparse, GST_STATE_NULL);
+
+  gst_pad_set_active (program_sinkpad, FALSE);
+  gst_pad_unlink (program_pad, program_sinkpad);
+  gst_element_release_request_pad (tsparse, program_pad);
+  gst_object_unref (program_pad);
+  gst_object_unref (program_sinkpad);
+
+  srcpad = gst_element_get_static_pad (tsparse, "src");
+  gst_pad_set_active (tssinkpad, FALSE);
+  gst_pad_unlink (srcpad, tssinkpad);
+  gst_object_unref (tssinkpad);
+  gst_object_unref (srcpad);
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (tsparse);
+  gst_check_teardown_element (tsparse);
+
+  g_byte_array_free (program_data, TRUE);
+}
+
+/* The program pad output is exactly the @n_packets packets of
+ * es_packets listed in @packets */
+static void
+check_program_data (const guint * packets, guint n_packets)
+{
+  guint i;
+
+  fail_unless_equals_int (program_data->len, n_packets * PACKET_SIZE);
+  for (i = 0; i < n_packets; i++)
+    fail_unless (memcmp (program_data->data + i * PACKET_SIZE,
+            es_packets + packets[i] * PACKET_SIZE, PACKET_SIZE) == 0,
+        "packet %u is not the packet %u of the stream", i, packets[i]);
+}
+
+/* Packets split over several input buffers are output whole, as soon as
+ * their last byte came in */
+GST_START_TEST (test_split_packets)
+{
+  static const guint chunks[] = { 100, 300, 1000, 480 };
+  static const guint all[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  guint i, offset = 0;
+
+  setup_tsparse ();
+
+  for (i = 0; i < G_N_ELEMENTS (chunks); i++) {
+    push_data (es_packets + offset, chunks[i], FALSE);
+    offset += chunks[i];
+
+    check_program_data (all, offset / PACKET_SIZE);
+  }
+  fail_unless_equals_int (offset, sizeof (es_packets));
+
+  cleanup_tsparse ();
+}
+
+GST_END_TEST;
+
+/* The program pad only gets the packets of its program */
+GST_START_TEST (test_program_pad)
+{
+  static const guint all[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  guint8 data[2 * N_PACKETS * PACKET_SIZE];
+  guint i, pos = 0;
+
+  setup_tsparse ();
+
+  /* 0 and 1 of program 1 follow each other, then both programs alternate */
+  for (i = 0; i < N_PACKETS; i++) {
+    memcpy (data + pos++ * PACKET_SIZE, es_packets + i * PACKET_SIZE,
+        PACKET_SIZE);
+    if (i > 0)
+      write_es_packet (data + pos++ * PACKET_SIZE, 2, i - 1);
+  }
+  write_es_packet (data + pos++ * PACKET_SIZE, 2, N_PACKETS - 1);
+  fail_unless_equals_int (pos, 2 * N_PACKETS);
+
+  push_data (data, sizeof (data), FALSE);
+
+  check_program_data (all, N_PACKETS);
+
+  cleanup_tsparse ();
+}
+
+GST_END_TEST;
+
+/* A flush drops the incomplete packet, what follows is output whole */
+GST_START_TEST (test_flush)
+{
+  static const guint packets[] = { 0, 1, 3, 4, 5 };
+
+  setup_tsparse ();
+
+  /* all of 0 and 1, and the start of 2 */
+  push_data (es_packets, 2 * PACKET_SIZE + 100, FALSE);
+  check_program_data (packets, 2);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_start ()));
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_stop (TRUE)));
+
+  push_data (es_packets + 3 * PACKET_SIZE, 3 * PACKET_SIZE, FALSE);
+  check_program_data (packets, G_N_ELEMENTS (packets));
+
+  cleanup_tsparse ();
+}
+
+GST_END_TEST;
+
+/* Same with a discontinuity in the input */
+GST_START_TEST (test_discont)
+{
+  static const guint packets[] = { 0, 1, 3, 4, 5 };
+
+  setup_tsparse ();
+
+  push_data (es_packets, 2 * PACKET_SIZE + 100, FALSE);
+  check_program_data (packets, 2);
+
+  push_data (es_packets + 3 * PACKET_SIZE, 3 * PACKET_SIZE, TRUE);
+  check_program_data (packets, G_N_ELEMENTS (packets));
+
+  cleanup_tsparse ();
+}
+
+GST_END_TEST;
+
+static Suite *
+mpegtsparse_suite (void)
+{
+  Suite *s = suite_create ("mpegtsparse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_split_packets);
+  tcase_add_test (tc_chain, test_program_pad);
+  tcase_add_test (tc_chain, test_flush);
+  tcase_add_test (tc_chain, test_discont);
+
+  return s;
+}
+
+GST_CHECK_MAIN (mpegtsparse);
@@ -21,7 +21,9 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
+#include <unistd.h>
 #include "mxfdemux.h"
 
 static GstPad *mysrcpad, *mysinkpad;
@@ -287,6 +289,412 @@ GST_START_TEST (test_push)
 
 GST_END_TEST;
 
+/* Muxes the streams of @description, which link to "mux.", into a
+ * temporary file with an mxfmux that has @properties and returns its name */
+static gchar *
+mux_to_file (const gchar * properties, const gchar * description)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  GError *err = NULL;
+  gchar *location, *pipeline_str;
+  gint fd;
+
+  fd = g_file_open_tmp ("mxfdemux-XXXXXX.mxf", &location, &err);
+  fail_unless (fd >= 0, "could not create file: %s", err ? err->message : "");
+  close (fd);
+
+  pipeline_str = g_strdup_printf ("mxfmux name=mux %s ! filesink location=%s "
+      "%s", properties ? properties : "", location, description);
+  pipeline = gst_parse_launch (pipeline_str, &err);
+  fail_unless (pipeline != NULL, "could not create pipeline: %s",
+      err ? err->message : "");
+  g_free (pipeline_str);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return location;
+}
+
+static guint64
+read_ber_length (const guint8 * data, guint * size)
+{
+  guint64 length = 0;
+  guint i, n;
+
+  if (data[0] < 0x80) {
+    *size = 1;
+    return data[0];
+  }
+
+  n = data[0] & 0x7f;
+  for (i = 0; i < n; i++)
+    length = (length << 8) | data[1 + i];
+  *size = 1 + n;
+
+  return length;
+}
+
+/* the KLV of @length bytes of fill at @data, with a 9 byte length */
+static void
+write_fill (guint8 * data, guint64 length)
+{
+  static const guint8 fill_key[] = {
+    0x06, 0x0e, 0x2b, 0x34, 0x01, 0x01, 0x01, 0x02,
+    0x03, 0x01, 0x02, 0x10, 0x01, 0x00, 0x00, 0x00
+  };
+
+  fail_unless (length >= 16 + 9);
+
+  memcpy (data, fill_key, 16);
+  data[16] = 0x88;
+  GST_WRITE_UINT64_BE (data + 17, length - 16 - 9);
+  memset (data + 16 + 9, 0, length - 16 - 9);
+}
+
+/* Turns a file with a single frame wrapped BWF track and no body partitions
+ * other than the first into a clip wrapped one. The essence elements become
+ * a single one followed by fill, and the index table segments are filled
+ * too, so all partition offsets stay the same and the edit unit size comes
+ * from the sound descriptor. The element keys are left alone, mxfdemux
+ * takes the wrapping from the essence container label. */
+static void
+make_clip_wrapped (const gchar * location)
+{
+  static const guint8 essence_element_key[] = {
+    0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x00,
+    0x0d, 0x01, 0x03, 0x01
+  };
+  static const guint8 index_table_segment_key[] = {
+    0x06, 0x0e, 0x2b, 0x34, 0x02, 0x53, 0x01, 0x01,
+    0x0d, 0x01, 0x02, 0x01, 0x01, 0x10, 0x01, 0x00
+  };
+  static const guint8 bwf_frame_wrapped_ul[] = {
+    0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x00,
+    0x0d, 0x01, 0x03, 0x01, 0x02, 0x06, 0x01, 0x00
+  };
+  guint8 *data, *clip = NULL;
+  gsize size, offset = 0, clip_start = 0, clip_end = 0;
+  guint64 clip_length = 0;
+  gboolean clip_done = FALSE;
+
+  fail_unless (g_file_get_contents (location, (gchar **) & data, &size,
+          NULL));
+  clip = g_malloc (size);
+
+  while (offset + 17 <= size) {
+    guint8 *key = data + offset;
+    guint64 length;
+    guint ber_size;
+    gsize i;
+
+    length = read_ber_length (key + 16, &ber_size);
+    fail_unless (offset + 16 + ber_size + length <= size);
+
+    if (memcmp (key, essence_element_key, 7) == 0 &&
+        memcmp (key + 8, essence_element_key + 8, 4) == 0) {
+      fail_if (clip_done, "more than one run of essence elements");
+      if (clip_end == 0) {
+        clip_start = offset;
+        memcpy (clip, key, 16);
+      }
+      memcpy (clip + 16 + 9 + clip_length, key + 16 + ber_size, length);
+      clip_length += length;
+      clip_end = offset + 16 + ber_size + length;
+    } else {
+      if (clip_end != 0)
+        clip_done = TRUE;
+
+      if (memcmp (key, index_table_segment_key, 16) == 0) {
+        write_fill (key, 16 + ber_size + length);
+      } else {
+        /* the partition packs, the preface and the descriptor */
+        for (i = 16; i + 16 <= 16 + ber_size + length; i++) {
+          if (memcmp (key + i, bwf_frame_wrapped_ul, 7) == 0 &&
+              memcmp (key + i + 8, bwf_frame_wrapped_ul + 8, 8) == 0)
+            key[i + 14] = 0x02;
+        }
+      }
+    }
+
+    offset += 16 + ber_size + length;
+  }
+  fail_unless (clip_end != 0);
+
+  clip[16] = 0x88;
+  GST_WRITE_UINT64_BE (clip + 17, clip_length);
+  memcpy (data + clip_start, clip, 16 + 9 + clip_length);
+  write_fill (data + clip_start + 16 + 9 + clip_length,
+      clip_end - clip_start - 16 - 9 - clip_length);
+
+  fail_unless (g_file_set_contents (location, (gchar *) data, size, NULL));
+
+  g_free (clip);
+  g_free (data);
+}
+
+typedef struct
+{
+  GstElement *sink;
+  GstClockTime first_ts;
+  guint64 size;
+} SeekPadData;
+
+static GMutex seek_lock;
+static GPtrArray *seek_pads;
+
+static void
+on_seek_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    SeekPadData * data)
+{
+  g_mutex_lock (&seek_lock);
+  if (!GST_CLOCK_TIME_IS_VALID (data->first_ts))
+    data->first_ts = GST_BUFFER_TIMESTAMP (buffer);
+  data->size += gst_buffer_get_size (buffer);
+  g_mutex_unlock (&seek_lock);
+}
+
+static void
+on_seek_pad_added (GstElement * demux, GstPad * pad, GstElement * pipeline)
+{
+  SeekPadData *data = g_new0 (SeekPadData, 1);
+  GstPad *sinkpad;
+
+  data->first_ts = GST_CLOCK_TIME_NONE;
+  data->sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (data->sink, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (data->sink, "handoff", G_CALLBACK (on_seek_handoff), data);
+
+  g_mutex_lock (&seek_lock);
+  g_ptr_array_add (seek_pads, data);
+  g_mutex_unlock (&seek_lock);
+
+  gst_bin_add (GST_BIN (pipeline), data->sink);
+  sinkpad = gst_element_get_static_pad (data->sink, "sink");
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+  gst_element_sync_state_with_parent (data->sink);
+}
+
+/* Plays @location from @start, seeking there first in PAUSED if it is
+ * not 0 */
+static void
+play_file (const gchar * location, GstClockTime start)
+{
+  GstElement *pipeline, *src, *demux;
+  GstMessage *msg;
+  GstBus *bus;
+  guint i;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  g_object_set (src, "location", location, NULL);
+  demux = gst_element_factory_make ("mxfdemux", NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, demux, NULL);
+  fail_unless (gst_element_link (src, demux));
+
+  seek_pads = g_ptr_array_new_with_free_func (g_free);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (on_seek_pad_added),
+      pipeline);
+
+  if (start > 0) {
+    fail_unless (gst_element_set_state (pipeline,
+            GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+    fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+            GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+    fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH, start));
+    fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+            GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+    /* nothing was rendered yet, but forget the prerolled buffers */
+    g_mutex_lock (&seek_lock);
+    for (i = 0; i < seek_pads->len; i++) {
+      SeekPadData *data = g_ptr_array_index (seek_pads, i);
+
+      data->first_ts = GST_CLOCK_TIME_NONE;
+      data->size = 0;
+    }
+    g_mutex_unlock (&seek_lock);
+  }
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  /* the sinks are kept for their caps */
+  for (i = 0; i < seek_pads->len; i++)
+    gst_object_ref (((SeekPadData *) g_ptr_array_index (seek_pads,
+                i))->sink);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+/* Checks that the pad with caps @media_type started at @start and output
+ * @size bytes */
+static void
+check_pad (const gchar * media_type, GstClockTime start, guint64 size)
+{
+  guint i;
+
+  for (i = 0; i < seek_pads->len; i++) {
+    SeekPadData *data = g_ptr_array_index (seek_pads, i);
+    GstPad *sinkpad = gst_element_get_static_pad (data->sink, "sink");
+    GstCaps *caps = gst_pad_get_current_caps (sinkpad);
+    gboolean match;
+
+    gst_object_unref (sinkpad);
+    fail_unless (caps != NULL);
+    match = gst_structure_has_name (gst_caps_get_structure (caps, 0),
+        media_type);
+    gst_caps_unref (caps);
+
+    if (match) {
+      fail_unless_equals_uint64 (data->first_ts, start);
+      fail_unless_equals_uint64 (data->size, size);
+      return;
+    }
+  }
+
+  fail_unless (FALSE, "no %s pad", media_type);
+}
+
+static void
+free_seek_pads (void)
+{
+  guint i;
+
+  for (i = 0; i < seek_pads->len; i++)
+    gst_object_unref (((SeekPadData *) g_ptr_array_index (seek_pads,
+                i))->sink);
+  g_ptr_array_unref (seek_pads);
+  seek_pads = NULL;
+}
+
+/* 10s of 64x48 v308 video and 48kHz stereo S16LE audio */
+#define SEEK_DURATION (10 * GST_SECOND)
+#define SEEK_VIDEO_FRAME_SIZE (64 * 48 * 3)
+#define SEEK_AUDIO_RATE_BYTES (48000 * 2 * 2)
+
+static guint64
+video_bytes (GstClockTime start)
+{
+  return ((SEEK_DURATION - start) / (GST_SECOND / 25)) *
+      SEEK_VIDEO_FRAME_SIZE;
+}
+
+static guint64
+audio_bytes (GstClockTime start)
+{
+  return gst_util_uint64_scale (SEEK_DURATION - start, SEEK_AUDIO_RATE_BYTES,
+      GST_SECOND);
+}
+
+#define SEEK_AV_STREAMS \
+  "videotestsrc num-buffers=250 ! " \
+  "video/x-raw,format=v308,width=64,height=48,framerate=25/1 ! mux. " \
+  "audiotestsrc num-buffers=250 samplesperbuffer=1920 ! " \
+  "audio/x-raw,format=S16LE,rate=48000,channels=2 ! mux."
+
+static void
+check_av_seeks (const gchar * location)
+{
+  play_file (location, 0);
+  check_pad ("video/x-raw", 0, video_bytes (0));
+  check_pad ("audio/x-raw", 0, audio_bytes (0));
+  free_seek_pads ();
+
+  /* the position of both tracks comes from the index */
+  play_file (location, 2 * GST_SECOND);
+  check_pad ("video/x-raw", 2 * GST_SECOND, video_bytes (2 * GST_SECOND));
+  check_pad ("audio/x-raw", 2 * GST_SECOND, audio_bytes (2 * GST_SECOND));
+  free_seek_pads ();
+
+  play_file (location, 7 * GST_SECOND + 400 * GST_MSECOND);
+  check_pad ("video/x-raw", 7 * GST_SECOND + 400 * GST_MSECOND,
+      video_bytes (7 * GST_SECOND + 400 * GST_MSECOND));
+  check_pad ("audio/x-raw", 7 * GST_SECOND + 400 * GST_MSECOND,
+      audio_bytes (7 * GST_SECOND + 400 * GST_MSECOND));
+  free_seek_pads ();
+}
+
+GST_START_TEST (test_seek_frame_wrapped)
+{
+  gchar *location;
+
+  location = mux_to_file (NULL, SEEK_AV_STREAMS);
+  check_av_seeks (location);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* body partitions every second, the index is spread over them */
+GST_START_TEST (test_seek_body_partitions)
+{
+  gchar *location;
+
+  location = mux_to_file ("partition-duration=1000000000", SEEK_AV_STREAMS);
+  check_av_seeks (location);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_seek_clip_wrapped)
+{
+  gchar *location;
+
+  /* 100ms edit units without other tracks */
+  location = mux_to_file (NULL, "audiotestsrc num-buffers=100 "
+      "samplesperbuffer=4800 ! "
+      "audio/x-raw,format=S16LE,rate=48000,channels=2 ! mux.");
+  make_clip_wrapped (location);
+
+  play_file (location, 0);
+  check_pad ("audio/x-raw", 0, audio_bytes (0));
+  free_seek_pads ();
+
+  /* the offset comes from the edit unit size */
+  play_file (location, 2 * GST_SECOND);
+  check_pad ("audio/x-raw", 2 * GST_SECOND, audio_bytes (2 * GST_SECOND));
+  free_seek_pads ();
+
+  play_file (location, 7 * GST_SECOND + 400 * GST_MSECOND);
+  check_pad ("audio/x-raw", 7 * GST_SECOND + 400 * GST_MSECOND,
+      audio_bytes (7 * GST_SECOND + 400 * GST_MSECOND));
+  free_seek_pads ();
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
 static Suite *
 mxfdemux_suite (void)
 {
@@ -302,6 +710,9 @@ mxfdemux_suite (void)
   tcase_set_timeout (tc_chain, 180);
   tcase_add_test (tc_chain, test_pull);
   tcase_add_test (tc_chain, test_push);
+  tcase_add_test (tc_chain, test_seek_frame_wrapped);
+  tcase_add_test (tc_chain, test_seek_body_partitions);
+  tcase_add_test (tc_chain, test_seek_clip_wrapped);
 
   return s;
 }
@@ -0,0 +1,229 @@
+/* GStreamer
+ *
+ * unit test for openh264enc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/codecparsers/gsth264parser.h>
+
+#include <string.h>
+
+#define N_FRAMES 10
+#define N_SLICES 4
+
+/* 320x240 */
+#define N_MBS (20 * 15)
+
+static GMutex buffers_lock;
+static GList *encoded;
+
+static void
+on_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    gpointer user_data)
+{
+  g_mutex_lock (&buffers_lock);
+  encoded = g_list_append (encoded, gst_buffer_ref (buffer));
+  g_mutex_unlock (&buffers_lock);
+}
+
+/* Encodes N_FRAMES into N_SLICES slices each and returns the negotiated
+ * caps, the buffers are in encoded */
+static GstCaps *
+encode (const gchar * stream_format)
+{
+  GstElement *pipeline, *sink;
+  GstMessage *msg;
+  GstCaps *caps;
+  GstPad *pad;
+  GstBus *bus;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d ! "
+      "video/x-raw,format=I420,width=320,height=240,framerate=25/1 ! "
+      "openh264enc slice-mode=n-slices num-slices=%d ! "
+      "video/x-h264,stream-format=%s ! "
+      "fakesink name=sink sync=false signal-handoffs=true", N_FRAMES,
+      N_SLICES, stream_format);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (on_handoff), NULL);
+
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  pad = gst_element_get_static_pad (sink, "sink");
+  caps = gst_pad_get_current_caps (pad);
+  fail_unless (caps != NULL);
+  gst_object_unref (pad);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  return caps;
+}
+
+static void
+parse_nal (GstH264NalParser * parser, GstH264NalUnit * nalu,
+    guint * first_mbs, guint * n_slices)
+{
+  GstH264SPS sps;
+  GstH264PPS pps;
+  GstH264SliceHdr slice;
+
+  switch (nalu->type) {
+    case GST_H264_NAL_SPS:
+      fail_unless_equals_int (gst_h264_parser_parse_sps (parser, nalu, &sps,
+              TRUE), GST_H264_PARSER_OK);
+      gst_h264_sps_clear (&sps);
+      break;
+    case GST_H264_NAL_PPS:
+      fail_unless_equals_int (gst_h264_parser_parse_pps (parser, nalu, &pps),
+          GST_H264_PARSER_OK);
+      gst_h264_pps_clear (&pps);
+      break;
+    case GST_H264_NAL_SLICE:
+    case GST_H264_NAL_SLICE_IDR:
+      fail_unless_equals_int (gst_h264_parser_parse_slice_hdr (parser, nalu,
+              &slice, FALSE, FALSE), GST_H264_PARSER_OK);
+      fail_unless (*n_slices < N_SLICES, "more than %d slices", N_SLICES);
+      first_mbs[(*n_slices)++] = slice.first_mb_in_slice;
+      break;
+    default:
+      break;
+  }
+}
+
+/* Every frame has all its slices, which follow each other and cover the
+ * whole picture */
+static void
+check_slices (const guint * first_mbs, guint n_slices)
+{
+  guint i;
+
+  fail_unless_equals_int (n_slices, N_SLICES);
+  fail_unless_equals_int (first_mbs[0], 0);
+  for (i = 1; i < n_slices; i++) {
+    fail_unless (first_mbs[i] > first_mbs[i - 1]);
+    fail_unless (first_mbs[i] < N_MBS);
+  }
+}
+
+static void
+check_encoded (const gchar * stream_format)
+{
+  GstH264NalParser *parser;
+  GstH264NalUnit nalu;
+  GstStructure *s;
+  GstCaps *caps;
+  GList *l;
+  gboolean avc = !strcmp (stream_format, "avc");
+
+  caps = encode (stream_format);
+  s = gst_caps_get_structure (caps, 0);
+  fail_unless_equals_string (gst_structure_get_string (s, "stream-format"),
+      stream_format);
+  fail_unless_equals_string (gst_structure_get_string (s, "alignment"), "au");
+  fail_unless_equals_int (gst_structure_has_field (s, "codec_data"), avc);
+  gst_caps_unref (caps);
+
+  fail_unless_equals_int (g_list_length (encoded), N_FRAMES);
+
+  parser = gst_h264_nal_parser_new ();
+
+  for (l = encoded; l; l = l->next) {
+    GstBuffer *buffer = l->data;
+    guint first_mbs[N_SLICES], n_slices = 0;
+    GstH264ParserResult res;
+    GstMapInfo map;
+    guint offset = 0;
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+
+    if (avc) {
+      /* the 4 byte lengths add up to the buffer exactly */
+      while (offset < map.size) {
+        res = gst_h264_parser_identify_nalu_avc (parser, map.data, offset,
+            map.size, 4, &nalu);
+        fail_unless_equals_int (res, GST_H264_PARSER_OK);
+        parse_nal (parser, &nalu, first_mbs, &n_slices);
+        offset = nalu.offset + nalu.size;
+      }
+      fail_unless_equals_int (offset, map.size);
+    } else {
+      do {
+        res = gst_h264_parser_identify_nalu (parser, map.data, offset,
+            map.size, &nalu);
+        fail_unless (res == GST_H264_PARSER_OK ||
+            res == GST_H264_PARSER_NO_NAL_END);
+        parse_nal (parser, &nalu, first_mbs, &n_slices);
+        offset = nalu.offset + nalu.size;
+      } while (res == GST_H264_PARSER_OK);
+      fail_unless_equals_int (offset, map.size);
+    }
+
+    gst_buffer_unmap (buffer, &map);
+
+    check_slices (first_mbs, n_slices);
+  }
+
+  gst_h264_nal_parser_free (parser);
+
+  g_list_free_full (encoded, (GDestroyNotify) gst_buffer_unref);
+  encoded = NULL;
+}
+
+GST_START_TEST (test_slices_avc)
+{
+  check_encoded ("avc");
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_slices_byte_stream)
+{
+  check_encoded ("byte-stream");
+}
+
+GST_END_TEST;
+
+static Suite *
+openh264enc_suite (void)
+{
+  Suite *s = suite_create ("openh264enc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_slices_avc);
+  tcase_add_test (tc_chain, test_slices_byte_stream);
+
+  return s;
+}
+
+GST_CHECK_MAIN (openh264enc);
@@ -1,5 +1,7 @@
 #include "parser.h"
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -69,6 +71,521 @@ GST_START_TEST (test_parse_frames_with_eth_padding)
 }
 GST_END_TEST;
 
+/* the frame of pcap_frame_with_eth_padding in a little endian pcapng
+ * section with one ethernet interface, captured at 1 second */
+static guint8 pcapng_header[] = {
+  0x0a, 0x0d, 0x0d, 0x0a, 0x1c, 0x00, 0x00, 0x00, 0x4d, 0x3c, 0x2b, 0x1a,
+  0x01, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0x1c, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0xff, 0xff, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00
+};
+
+static guint8 pcapng_epb_header[] = {
+  0x06, 0x00, 0x00, 0x00, 0x5c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x40, 0x42, 0x0f, 0x00, 0x3c, 0x00, 0x00, 0x00,
+  0x3c, 0x00, 0x00, 0x00
+};
+
+static guint8 pcapng_epb_trailer[] = {
+  0x5c, 0x00, 0x00, 0x00
+};
+
+GST_START_TEST (test_parse_pcapng)
+{
+  GstElement *element;
+  GstPad *srcpad, *sinkpad;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  guint frame_offset, payload_offset, payload_size;
+
+  element = setup_element (NULL);
+  srcpad = gst_check_setup_src_pad (element, &srctemplate);
+  sinkpad = gst_check_setup_sink_pad (element, &sinktemplate_rtp);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (element,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string ("raw/x-pcap");
+  gst_check_setup_events (srcpad, element, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  /* the frame without the classic pcap record header */
+  frame_offset = 16;
+  payload_offset = pcap_frame_with_eth_padding_offset;
+  payload_size = sizeof (pcap_frame_with_eth_padding) - payload_offset - 2;
+
+  buffer = gst_buffer_new_allocate (NULL, sizeof (pcapng_header), NULL);
+  gst_buffer_fill (buffer, 0, pcapng_header, sizeof (pcapng_header));
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 0);
+
+  /* the block arrives in several pieces */
+  buffer = gst_buffer_new_allocate (NULL, sizeof (pcapng_epb_header), NULL);
+  gst_buffer_fill (buffer, 0, pcapng_epb_header, sizeof (pcapng_epb_header));
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+
+  buffer = gst_buffer_new_allocate (NULL,
+      sizeof (pcap_frame_with_eth_padding) - frame_offset, NULL);
+  gst_buffer_fill (buffer, 0, pcap_frame_with_eth_padding + frame_offset,
+      sizeof (pcap_frame_with_eth_padding) - frame_offset);
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 0);
+
+  buffer = gst_buffer_new_allocate (NULL, sizeof (pcapng_epb_trailer), NULL);
+  gst_buffer_fill (buffer, 0, pcapng_epb_trailer,
+      sizeof (pcapng_epb_trailer));
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  buffer = GST_BUFFER (buffers->data);
+  fail_unless_equals_int (gst_buffer_get_size (buffer), payload_size);
+  fail_unless (gst_buffer_memcmp (buffer, 0,
+          pcap_frame_with_eth_padding + payload_offset, payload_size) == 0);
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer), GST_SECOND);
+
+  fail_unless (gst_element_set_state (element,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (element);
+  gst_check_teardown_sink_pad (element);
+  gst_check_teardown_element (element);
+}
+GST_END_TEST;
+
+/* a classic capture with two interleaved udp flows of N_PACKETS packets:
+ * flow A from port 5000 at 1s + n * 100ms and flow B from port 6000 50ms
+ * later; the payload is the flow letter followed by n */
+#define N_PACKETS 10
+#define PACKET_SPACING (100 * GST_MSECOND)
+
+static GstClockTime
+packet_time (guint8 flow, guint8 n)
+{
+  return GST_SECOND + n * PACKET_SPACING + (flow == 'B' ? 50 * GST_MSECOND :
+      0);
+}
+
+static void
+append_packet (GByteArray * capture, guint8 flow, guint8 n)
+{
+  guint8 record[16 + 14 + 20 + 8 + 2] = { 0, };
+  GstClockTime ts = packet_time (flow, n);
+  guint8 *ip = record + 16 + 14;
+  guint8 *udp = ip + 20;
+
+  GST_WRITE_UINT32_LE (record, ts / GST_SECOND);
+  GST_WRITE_UINT32_LE (record + 4, (ts % GST_SECOND) / GST_USECOND);
+  GST_WRITE_UINT32_LE (record + 8, sizeof (record) - 16);
+  GST_WRITE_UINT32_LE (record + 12, sizeof (record) - 16);
+
+  GST_WRITE_UINT16_BE (record + 16 + 12, 0x0800);
+
+  ip[0] = 0x45;
+  GST_WRITE_UINT16_BE (ip + 2, 20 + 8 + 2);
+  ip[8] = 64;
+  ip[9] = 17;
+  GST_WRITE_UINT32_BE (ip + 12, 0xc0a80001);
+  GST_WRITE_UINT32_BE (ip + 16, 0xc0a80002);
+
+  GST_WRITE_UINT16_BE (udp, flow == 'A' ? 5000 : 6000);
+  GST_WRITE_UINT16_BE (udp + 2, flow == 'A' ? 5002 : 6002);
+  GST_WRITE_UINT16_BE (udp + 4, 8 + 2);
+
+  udp[8] = flow;
+  udp[9] = n;
+
+  g_byte_array_append (capture, record, sizeof (record));
+}
+
+static gchar *
+write_capture (void)
+{
+  GByteArray *capture;
+  GError *err = NULL;
+  gchar *location;
+  gint fd;
+  guint8 n;
+
+  fd = g_file_open_tmp ("pcapparse-XXXXXX.pcap", &location, &err);
+  fail_unless (fd >= 0, "could not create capture: %s", err ? err->message :
+      "");
+  close (fd);
+
+  capture = g_byte_array_new ();
+  g_byte_array_append (capture, pcap_header, sizeof (pcap_header));
+  for (n = 0; n < N_PACKETS; n++) {
+    append_packet (capture, 'A', n);
+    append_packet (capture, 'B', n);
+  }
+
+  fail_unless (g_file_set_contents (location, (gchar *) capture->data,
+          capture->len, NULL));
+  g_byte_array_unref (capture);
+
+  return location;
+}
+
+/* timestamps of the buffers received by a fakesink, checked against the
+ * payload */
+static GMutex received_lock;
+
+static void
+on_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    GArray * received)
+{
+  guint8 payload[2];
+  GstClockTime ts = GST_BUFFER_TIMESTAMP (buffer);
+
+  fail_unless_equals_int (gst_buffer_extract (buffer, 0, payload, 2), 2);
+  fail_unless_equals_uint64 (ts, packet_time (payload[0], payload[1]));
+
+  g_mutex_lock (&received_lock);
+  g_array_append_val (received, ts);
+  g_mutex_unlock (&received_lock);
+}
+
+static GstElement *
+make_fakesink (GArray * received)
+{
+  GstElement *sink;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (sink != NULL);
+  g_object_set (sink, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (on_handoff), received);
+
+  return sink;
+}
+
+/* filesrc ! pcapparse ! fakesink, so that pcapparse works in pull mode */
+static GstElement *
+setup_pull_pipeline (const gchar * location, GArray * received,
+    GstElement ** parse)
+{
+  GstElement *pipeline, *src;
+  GstCaps *caps;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  fail_unless (src != NULL);
+  g_object_set (src, "location", location, NULL);
+
+  *parse = gst_element_factory_make ("pcapparse", NULL);
+  fail_unless (*parse != NULL);
+  caps = gst_caps_from_string ("application/x-rtp");
+  g_object_set (*parse, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, *parse, NULL);
+  fail_unless (gst_element_link (src, *parse));
+
+  if (received) {
+    GstElement *sink = make_fakesink (received);
+
+    gst_bin_add (GST_BIN (pipeline), sink);
+    fail_unless (gst_element_link (*parse, sink));
+  }
+
+  return pipeline;
+}
+
+static void
+run_to_eos (GstElement * pipeline)
+{
+  GstMessage *msg;
+  GstBus *bus;
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL, "timed out waiting for EOS");
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+}
+
+static void
+pause_pipeline (GstElement * pipeline)
+{
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+}
+
+/* flush seeks in PAUSED, the buffers collected so far are dropped */
+static void
+seek_pipeline (GstElement * pipeline, GArray * received, GstClockTime start,
+    GstClockTime stop)
+{
+  fail_unless (gst_element_seek (pipeline, 1.0, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, GST_SEEK_TYPE_SET, start,
+          GST_CLOCK_TIME_IS_VALID (stop) ? GST_SEEK_TYPE_SET :
+          GST_SEEK_TYPE_NONE, stop));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  g_mutex_lock (&received_lock);
+  g_array_set_size (received, 0);
+  g_mutex_unlock (&received_lock);
+}
+
+static void
+teardown_pull_pipeline (GstElement * pipeline, gchar * location)
+{
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (pipeline);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_START_TEST (test_pull_mode)
+{
+  GstElement *pipeline, *parse;
+  GArray *received;
+  gchar *location;
+  guint n;
+
+  location = write_capture ();
+  received = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  pipeline = setup_pull_pipeline (location, received, &parse);
+
+  run_to_eos (pipeline);
+
+  /* all packets, in capture order */
+  fail_unless_equals_int (received->len, 2 * N_PACKETS);
+  for (n = 0; n < N_PACKETS; n++) {
+    fail_unless_equals_uint64 (g_array_index (received, GstClockTime, 2 * n),
+        packet_time ('A', n));
+    fail_unless_equals_uint64 (g_array_index (received, GstClockTime,
+            2 * n + 1), packet_time ('B', n));
+  }
+
+  teardown_pull_pipeline (pipeline, location);
+  g_array_unref (received);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pull_mode_queries)
+{
+  GstElement *pipeline, *parse;
+  GArray *received;
+  GstQuery *query;
+  gchar *location;
+  gint64 duration, start, end;
+  gboolean seekable;
+  GstFormat format;
+
+  location = write_capture ();
+  received = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  pipeline = setup_pull_pipeline (location, received, &parse);
+
+  pause_pipeline (pipeline);
+
+  /* the duration is the time of the last packet, known from the index */
+  fail_unless (gst_element_query_duration (pipeline, GST_FORMAT_TIME,
+          &duration));
+  fail_unless_equals_uint64 (duration, packet_time ('B', N_PACKETS - 1));
+
+  query = gst_query_new_seeking (GST_FORMAT_TIME);
+  fail_unless (gst_element_query (pipeline, query));
+  gst_query_parse_seeking (query, &format, &seekable, &start, &end);
+  fail_unless_equals_int (format, GST_FORMAT_TIME);
+  fail_unless (seekable);
+  fail_unless_equals_int64 (start, 0);
+  fail_unless_equals_int64 (end, duration);
+  gst_query_unref (query);
+
+  teardown_pull_pipeline (pipeline, location);
+  g_array_unref (received);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pull_mode_seek)
+{
+  GstElement *pipeline, *parse;
+  GArray *received;
+  gchar *location;
+  gint64 position;
+  guint n;
+
+  location = write_capture ();
+  received = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  pipeline = setup_pull_pipeline (location, received, &parse);
+
+  pause_pipeline (pipeline);
+
+  /* the index of flow A points at its 6th packet, flow B has no earlier
+   * packets after that */
+  seek_pipeline (pipeline, received, packet_time ('A', 5),
+      GST_CLOCK_TIME_NONE);
+  fail_unless (gst_element_query_position (pipeline, GST_FORMAT_TIME,
+          &position));
+  fail_unless_equals_uint64 (position, packet_time ('A', 5));
+
+  run_to_eos (pipeline);
+
+  fail_unless_equals_int (received->len, 2 * (N_PACKETS - 5));
+  for (n = 5; n < N_PACKETS; n++) {
+    fail_unless_equals_uint64 (g_array_index (received, GstClockTime,
+            2 * (n - 5)), packet_time ('A', n));
+    fail_unless_equals_uint64 (g_array_index (received, GstClockTime,
+            2 * (n - 5) + 1), packet_time ('B', n));
+  }
+
+  /* in between the packets of flow A, starting at the flow B packet, and
+   * with a stop position */
+  pause_pipeline (pipeline);
+  seek_pipeline (pipeline, received, packet_time ('A', 2) + GST_MSECOND,
+      packet_time ('A', 4));
+
+  run_to_eos (pipeline);
+
+  fail_unless_equals_int (received->len, 4);
+  fail_unless_equals_uint64 (g_array_index (received, GstClockTime, 0),
+      packet_time ('B', 2));
+  fail_unless_equals_uint64 (g_array_index (received, GstClockTime, 1),
+      packet_time ('A', 3));
+  fail_unless_equals_uint64 (g_array_index (received, GstClockTime, 2),
+      packet_time ('B', 3));
+  fail_unless_equals_uint64 (g_array_index (received, GstClockTime, 3),
+      packet_time ('A', 4));
+
+  teardown_pull_pipeline (pipeline, location);
+  g_array_unref (received);
+}
+
+GST_END_TEST;
+
+/* only the flows that pass the filters are indexed, so seeking only looks
+ * at their packets */
+GST_START_TEST (test_pull_mode_seek_filtered)
+{
+  GstElement *pipeline, *parse;
+  GArray *received;
+  gchar *location;
+  gint64 duration;
+  guint n;
+
+  location = write_capture ();
+  received = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  pipeline = setup_pull_pipeline (location, received, &parse);
+  g_object_set (parse, "src-port", 5000, NULL);
+
+  pause_pipeline (pipeline);
+
+  fail_unless (gst_element_query_duration (pipeline, GST_FORMAT_TIME,
+          &duration));
+  fail_unless_equals_uint64 (duration, packet_time ('A', N_PACKETS - 1));
+
+  seek_pipeline (pipeline, received, packet_time ('B', 6),
+      GST_CLOCK_TIME_NONE);
+  run_to_eos (pipeline);
+
+  fail_unless_equals_int (received->len, N_PACKETS - 7);
+  for (n = 7; n < N_PACKETS; n++)
+    fail_unless_equals_uint64 (g_array_index (received, GstClockTime, n - 7),
+        packet_time ('A', n));
+
+  teardown_pull_pipeline (pipeline, location);
+  g_array_unref (received);
+}
+
+GST_END_TEST;
+
+/* per flow received timestamps, indexed by the number of the src_%u pad */
+static GArray *flow_received[2];
+
+static void
+on_flow_pad_added (GstElement * parse, GstPad * pad, GstElement * pipeline)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+  guint id;
+
+  /* the always src pad is not a flow pad */
+  if (!g_str_has_prefix (GST_PAD_NAME (pad), "src_"))
+    return;
+
+  id = g_ascii_strtoull (GST_PAD_NAME (pad) + 4, NULL, 10);
+  fail_unless (id < G_N_ELEMENTS (flow_received));
+
+  sink = make_fakesink (flow_received[id]);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+  gst_element_sync_state_with_parent (sink);
+}
+
+GST_START_TEST (test_split_flows)
+{
+  GstElement *pipeline, *parse;
+  GstPad *pad;
+  GstEvent *event;
+  const gchar *stream_id;
+  gchar *location;
+  guint i, n;
+
+  location = write_capture ();
+  for (i = 0; i < G_N_ELEMENTS (flow_received); i++)
+    flow_received[i] = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+
+  pipeline = setup_pull_pipeline (location, NULL, &parse);
+  g_object_set (parse, "split-flows", TRUE, NULL);
+  g_signal_connect (parse, "pad-added", G_CALLBACK (on_flow_pad_added),
+      pipeline);
+
+  run_to_eos (pipeline);
+
+  /* flows are numbered in the order they appear in the capture */
+  fail_unless_equals_int (flow_received[0]->len, N_PACKETS);
+  fail_unless_equals_int (flow_received[1]->len, N_PACKETS);
+  for (n = 0; n < N_PACKETS; n++) {
+    fail_unless_equals_uint64 (g_array_index (flow_received[0], GstClockTime,
+            n), packet_time ('A', n));
+    fail_unless_equals_uint64 (g_array_index (flow_received[1], GstClockTime,
+            n), packet_time ('B', n));
+  }
+
+  /* every flow has its own stream */
+  pad = gst_element_get_static_pad (parse, "src_0");
+  event = gst_pad_get_sticky_event (pad, GST_EVENT_STREAM_START, 0);
+  gst_event_parse_stream_start (event, &stream_id);
+  fail_unless (g_str_has_suffix (stream_id,
+          "/udp-192.168.0.1:5000-192.168.0.2:5002"));
+  gst_event_unref (event);
+  gst_object_unref (pad);
+
+  pad = gst_element_get_static_pad (parse, "src_1");
+  event = gst_pad_get_sticky_event (pad, GST_EVENT_STREAM_START, 0);
+  gst_event_parse_stream_start (event, &stream_id);
+  fail_unless (g_str_has_suffix (stream_id,
+          "/udp-192.168.0.1:6000-192.168.0.2:6002"));
+  gst_event_unref (event);
+  gst_object_unref (pad);
+
+  teardown_pull_pipeline (pipeline, location);
+  for (i = 0; i < G_N_ELEMENTS (flow_received); i++)
+    g_array_unref (flow_received[i]);
+}
+
+GST_END_TEST;
+
 static Suite *
 pcapparse_suite (void)
 {
@@ -86,6 +603,12 @@ pcapparse_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_parse_frames_with_eth_padding);
+  tcase_add_test (tc_chain, test_parse_pcapng);
+  tcase_add_test (tc_chain, test_pull_mode);
+  tcase_add_test (tc_chain, test_pull_mode_queries);
+  tcase_add_test (tc_chain, test_pull_mode_seek);
+  tcase_add_test (tc_chain, test_pull_mode_seek_filtered);
+  tcase_add_test (tc_chain, test_split_flows);
 
   return s;
 }
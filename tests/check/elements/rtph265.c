@@ -0,0 +1,500 @@
+/* GStreamer
+ *
+ * unit test for the H.265 RTP payloader and depayloader
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+static GstStaticPadTemplate srctemplate_h265 = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-h265")
+    );
+
+/* downstream that asks for AUs, for NAL units, or for no alignment */
+static GstStaticPadTemplate sinktemplate_au = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-h265, stream-format = (string) byte-stream, "
+        "alignment = (string) au")
+    );
+static GstStaticPadTemplate sinktemplate_nal = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-h265, stream-format = (string) byte-stream, "
+        "alignment = (string) nal")
+    );
+static GstStaticPadTemplate sinktemplate_any = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-h265, stream-format = (string) byte-stream")
+    );
+
+#define RTP_CAPS "application/x-rtp, media = (string) video, " \
+    "clock-rate = (int) 90000, encoding-name = (string) H265"
+
+/* an SPS and a PPS in one aggregation packet and an IDR slice in more
+ * fragmentation units than a buffer has memory blocks */
+#define PS_SIZE 12
+#define FU_SIZE 100
+#define N_FU 24
+#define SLICE_SIZE (2 + FU_SIZE * N_FU)
+
+static const guint8 sync_bytes[] = { 0, 0, 0, 1 };
+
+static void
+fill_nal (guint8 * nal, guint8 type, gsize size)
+{
+  gsize i;
+
+  /* NAL unit header with nuh_layer_id 0 and nuh_temporal_id_plus1 1 */
+  nal[0] = type << 1;
+  nal[1] = 0x01;
+  for (i = 2; i < size; i++)
+    nal[i] = (type + i) & 0xff;
+}
+
+static GstBuffer *
+make_rtp_buffer (const guint8 * header, gsize header_size,
+    const guint8 * payload, gsize payload_size, guint16 seq, gboolean marker)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buf;
+  guint8 *data;
+
+  buf = gst_rtp_buffer_new_allocate (header_size + payload_size, 0, 0);
+  GST_BUFFER_PTS (buf) = 0;
+
+  gst_rtp_buffer_map (buf, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_payload_type (&rtp, 96);
+  gst_rtp_buffer_set_seq (&rtp, seq);
+  gst_rtp_buffer_set_timestamp (&rtp, 0);
+  gst_rtp_buffer_set_marker (&rtp, marker);
+  data = gst_rtp_buffer_get_payload (&rtp);
+  memcpy (data, header, header_size);
+  memcpy (data + header_size, payload, payload_size);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buf;
+}
+
+/* Makes the RTP packets of one AU, and the byte-stream they depayload to in
+ * @expected */
+static GstBufferList *
+make_packets (GByteArray * expected)
+{
+  GstBufferList *list;
+  guint8 ap[2 * (2 + PS_SIZE)], sps[PS_SIZE], pps[PS_SIZE];
+  guint8 slice[SLICE_SIZE], header[3];
+  guint16 seq = 0;
+  guint i;
+
+  list = gst_buffer_list_new ();
+
+  fill_nal (sps, 33, PS_SIZE);
+  fill_nal (pps, 34, PS_SIZE);
+  fill_nal (slice, 19, SLICE_SIZE);
+
+  g_byte_array_append (expected, sync_bytes, sizeof (sync_bytes));
+  g_byte_array_append (expected, sps, PS_SIZE);
+  g_byte_array_append (expected, sync_bytes, sizeof (sync_bytes));
+  g_byte_array_append (expected, pps, PS_SIZE);
+  g_byte_array_append (expected, sync_bytes, sizeof (sync_bytes));
+  g_byte_array_append (expected, slice, SLICE_SIZE);
+
+  /* aggregation packet */
+  ap[0] = 0;
+  ap[1] = PS_SIZE;
+  memcpy (ap + 2, sps, PS_SIZE);
+  ap[2 + PS_SIZE] = 0;
+  ap[3 + PS_SIZE] = PS_SIZE;
+  memcpy (ap + 4 + PS_SIZE, pps, PS_SIZE);
+  header[0] = 48 << 1;
+  header[1] = 0x01;
+  gst_buffer_list_add (list, make_rtp_buffer (header, 2, ap, sizeof (ap),
+          seq++, FALSE));
+
+  /* fragmentation units, without the NAL unit header of the slice */
+  header[0] = 49 << 1;
+  header[1] = 0x01;
+  for (i = 0; i < N_FU; i++) {
+    header[2] = 19;
+    if (i == 0)
+      header[2] |= 0x80;
+    if (i == N_FU - 1)
+      header[2] |= 0x40;
+    gst_buffer_list_add (list, make_rtp_buffer (header, 3,
+            slice + 2 + i * FU_SIZE, FU_SIZE, seq++, i == N_FU - 1));
+  }
+
+  return list;
+}
+
+/* Depayloads the packets of make_packets() for downstream with the caps of
+ * @sinktemplate, one at a time or as a list. Returns the output bytes and the
+ * number of output buffers in @n_buffers. */
+static GByteArray *
+depayload (GstStaticPadTemplate * sinktemplate, gboolean as_list,
+    GByteArray * expected, guint * n_buffers)
+{
+  GstElement *depay;
+  GstBufferList *packets;
+  GByteArray *output;
+  GstCaps *caps;
+  GList *l;
+  guint i;
+
+  depay = gst_check_setup_element ("rtph265depay");
+  mysrcpad = gst_check_setup_src_pad (depay, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (depay, sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (depay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (RTP_CAPS);
+  gst_check_setup_events (mysrcpad, depay, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  packets = make_packets (expected);
+  if (as_list) {
+    fail_unless_equals_int (gst_pad_push_list (mysrcpad, packets),
+        GST_FLOW_OK);
+  } else {
+    for (i = 0; i < gst_buffer_list_length (packets); i++)
+      fail_unless_equals_int (gst_pad_push (mysrcpad,
+              gst_buffer_ref (gst_buffer_list_get (packets, i))), GST_FLOW_OK);
+    gst_buffer_list_unref (packets);
+  }
+
+  output = g_byte_array_new ();
+  for (l = buffers; l; l = l->next) {
+    GstBuffer *buf = l->data;
+    GstMapInfo map;
+
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), 0);
+    fail_if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT));
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    g_byte_array_append (output, map.data, map.size);
+    gst_buffer_unmap (buf, &map);
+  }
+  *n_buffers = g_list_length (buffers);
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (depay, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (depay);
+  gst_check_teardown_sink_pad (depay);
+  gst_check_teardown_element (depay);
+
+  return output;
+}
+
+static void
+check_output (GByteArray * output, GByteArray * expected)
+{
+  fail_unless_equals_int (output->len, expected->len);
+  fail_unless (memcmp (output->data, expected->data, expected->len) == 0);
+}
+
+/* The AU has more memory blocks than a buffer holds, the ones past that
+ * are copied */
+GST_START_TEST (test_depay_au)
+{
+  GByteArray *expected, *output;
+  guint n_buffers;
+  gboolean as_list;
+
+  for (as_list = FALSE; as_list <= TRUE; as_list++) {
+    expected = g_byte_array_new ();
+    output = depayload (&sinktemplate_au, as_list, expected, &n_buffers);
+    check_output (output, expected);
+    fail_unless_equals_int (n_buffers, 1);
+    g_byte_array_unref (output);
+    g_byte_array_unref (expected);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_depay_nal)
+{
+  GByteArray *expected, *output;
+  guint n_buffers;
+  gboolean as_list;
+
+  for (as_list = FALSE; as_list <= TRUE; as_list++) {
+    expected = g_byte_array_new ();
+    output = depayload (&sinktemplate_nal, as_list, expected, &n_buffers);
+    check_output (output, expected);
+    fail_unless_equals_int (n_buffers, 3);
+    g_byte_array_unref (output);
+    g_byte_array_unref (expected);
+  }
+}
+
+GST_END_TEST;
+
+/* Without an alignment downstream, every buffer still holds one whole NAL
+ * unit */
+GST_START_TEST (test_depay_no_alignment)
+{
+  GByteArray *expected, *output;
+  guint n_buffers;
+  gboolean as_list;
+
+  for (as_list = FALSE; as_list <= TRUE; as_list++) {
+    expected = g_byte_array_new ();
+    output = depayload (&sinktemplate_any, as_list, expected, &n_buffers);
+    check_output (output, expected);
+    fail_unless_equals_int (n_buffers, 3);
+    g_byte_array_unref (output);
+    g_byte_array_unref (expected);
+  }
+}
+
+GST_END_TEST;
+
+/* Two AUs of parameter sets, SEI and slices, the small NAL units can be
+ * aggregated and the big ones need fragmentation units */
+static const struct
+{
+  guint8 type;
+  gsize size;
+  gboolean end_of_au;
+} roundtrip_nals[] = {
+  {
+  39, 20, FALSE}, {
+  33, 30, FALSE}, {
+  34, 10, FALSE}, {
+  19, 3000, TRUE}, {
+  39, 20, FALSE}, {
+  1, 300, FALSE}, {
+  1, 2500, TRUE}
+};
+
+/* Makes the byte-stream AUs of roundtrip_nals, the NAL units they hold are
+ * added to @nals with their start code */
+static GList *
+make_roundtrip_aus (GList ** nals)
+{
+  GList *aus = NULL;
+  GByteArray *au = NULL;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (roundtrip_nals); i++) {
+    GByteArray *nal;
+    gsize j, size = roundtrip_nals[i].size;
+
+    nal = g_byte_array_new ();
+    g_byte_array_append (nal, sync_bytes, sizeof (sync_bytes));
+    g_byte_array_set_size (nal, sizeof (sync_bytes) + size);
+    fill_nal (nal->data + sizeof (sync_bytes), roundtrip_nals[i].type, size);
+    /* no zero bytes, which would make start codes or be trimmed as
+     * trailing zeros by the payloader */
+    for (j = sizeof (sync_bytes) + 2; j < nal->len; j++)
+      nal->data[j] = nal->data[j] % 255 + 1;
+
+    if (au == NULL)
+      au = g_byte_array_new ();
+    g_byte_array_append (au, nal->data, nal->len);
+    *nals = g_list_append (*nals, nal);
+
+    if (roundtrip_nals[i].end_of_au) {
+      GstBuffer *buf;
+      gsize len = au->len;
+
+      buf = gst_buffer_new_wrapped (g_byte_array_free (au, FALSE), len);
+      GST_BUFFER_PTS (buf) = g_list_length (aus) * 40 * GST_MSECOND;
+      aus = g_list_append (aus, buf);
+      au = NULL;
+    }
+  }
+
+  return aus;
+}
+
+static GstPadProbeReturn
+count_aggregation_packets (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  guint *n_ap = user_data;
+  GstBufferList *list = NULL;
+  GstBuffer *buf;
+  guint i, len = 1;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    len = gst_buffer_list_length (list);
+  }
+
+  for (i = 0; i < len; i++) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+    buf = list ? gst_buffer_list_get (list, i) :
+        GST_PAD_PROBE_INFO_BUFFER (info);
+    fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+    if (((((guint8 *) gst_rtp_buffer_get_payload (&rtp))[0] >> 1) & 0x3f) ==
+        48)
+      (*n_ap)++;
+    gst_rtp_buffer_unmap (&rtp);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Payloads the AUs with rtph265pay in @aggregate_mode, depayloads them again
+ * and checks that the same NAL units come out */
+static void
+roundtrip (const gchar * aggregate_mode, gboolean buffer_list)
+{
+  GstElement *pay, *depay;
+  GstPad *paysrc, *depaysink;
+  GList *aus, *nals = NULL, *l, *n;
+  GstCaps *caps;
+  guint n_ap = 0;
+
+  pay = gst_check_setup_element ("rtph265pay");
+  depay = gst_check_setup_element ("rtph265depay");
+  gst_util_set_object_arg (G_OBJECT (pay), "aggregate-mode", aggregate_mode);
+  g_object_set (pay, "buffer-list", buffer_list, NULL);
+
+  mysrcpad = gst_check_setup_src_pad (pay, &srctemplate_h265);
+  mysinkpad = gst_check_setup_sink_pad (depay, &sinktemplate_nal);
+
+  paysrc = gst_element_get_static_pad (pay, "src");
+  depaysink = gst_element_get_static_pad (depay, "sink");
+  fail_unless (gst_pad_link (paysrc, depaysink) == GST_PAD_LINK_OK);
+  gst_pad_add_probe (paysrc,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      count_aggregation_packets, &n_ap, NULL);
+
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless (gst_element_set_state (depay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+  fail_unless (gst_element_set_state (pay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string ("video/x-h265, "
+      "stream-format = (string) byte-stream, alignment = (string) au");
+  gst_check_setup_events (mysrcpad, pay, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  aus = make_roundtrip_aus (&nals);
+  for (l = aus; l; l = l->next)
+    fail_unless_equals_int (gst_pad_push (mysrcpad, l->data), GST_FLOW_OK);
+  g_list_free (aus);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* the parameter sets and SEI in front of the first slice */
+  fail_unless (n_ap > 0);
+
+  fail_unless_equals_int (g_list_length (buffers), g_list_length (nals));
+  for (l = buffers, n = nals; l && n; l = l->next, n = n->next) {
+    GByteArray *nal = n->data;
+    GstMapInfo map;
+
+    gst_buffer_map (l->data, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, nal->len);
+    fail_unless (memcmp (map.data, nal->data, nal->len) == 0);
+    gst_buffer_unmap (l->data, &map);
+  }
+  g_list_free_full (nals, (GDestroyNotify) g_byte_array_unref);
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (pay, GST_STATE_NULL);
+  gst_element_set_state (depay, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_pad_unlink (paysrc, depaysink);
+  gst_object_unref (paysrc);
+  gst_object_unref (depaysink);
+  gst_check_teardown_src_pad (pay);
+  gst_check_teardown_sink_pad (depay);
+  gst_check_teardown_element (pay);
+  gst_check_teardown_element (depay);
+}
+
+GST_START_TEST (test_roundtrip_zero_latency)
+{
+  roundtrip ("zero-latency", FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_roundtrip_max)
+{
+  roundtrip ("max", FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_roundtrip_zero_latency_buffer_list)
+{
+  roundtrip ("zero-latency", TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_roundtrip_max_buffer_list)
+{
+  roundtrip ("max", TRUE);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtph265_suite (void)
+{
+  Suite *s = suite_create ("rtph265");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("depay");
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_depay_au);
+  tcase_add_test (tc_chain, test_depay_nal);
+  tcase_add_test (tc_chain, test_depay_no_alignment);
+
+  tc_chain = tcase_create ("roundtrip");
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_roundtrip_zero_latency);
+  tcase_add_test (tc_chain, test_roundtrip_max);
+  tcase_add_test (tc_chain, test_roundtrip_zero_latency_buffer_list);
+  tcase_add_test (tc_chain, test_roundtrip_max_buffer_list);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtph265);
@@ -87,7 +87,8 @@ create_input_buffer (void)
  *
  * https://bugzilla.gnome.org/show_bug.cgi?id=678485
  */
-GST_START_TEST (test_match_blue_square)
+static void
+check_match_blue_square (gboolean async)
 {
   GstElement *element;
   GstPad *sinkpad, *srcpad;
@@ -99,6 +100,7 @@ GST_START_TEST (test_match_blue_square)
   gchar *path;
   GstBuffer *buf;
   guint x, y, width, height;
+  guint64 timestamp;
 
   element = gst_check_setup_element ("templatematch");
   srcpad = gst_check_setup_src_pad (element, &srctemplate);
@@ -111,7 +113,7 @@ GST_START_TEST (test_match_blue_square)
   gst_element_set_bus (element, bus);
 
   path = g_build_filename (GST_TEST_FILES_PATH, "blue-square.png", NULL);
-  g_object_set (element, "template", path, NULL);
+  g_object_set (element, "template", path, "async", async, NULL);
   g_free (path);
 
   fail_unless (gst_element_set_state (element,
@@ -119,11 +121,13 @@ GST_START_TEST (test_match_blue_square)
       "could not set to playing");
 
   buf = create_input_buffer ();
+  GST_BUFFER_PTS (buf) = 0;
   fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
 
   /* make sure that the template match message was posted, detecting the
-   * blue area in the top left corner */
-  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+   * blue area in the top left corner. In async mode it comes from the
+   * worker thread. */
+  msg = gst_bus_timed_pop_filtered (bus, 5 * GST_SECOND, GST_MESSAGE_ELEMENT);
   fail_unless (msg != NULL);
   fail_unless (GST_MESSAGE_SRC (msg) == GST_OBJECT_CAST (element));
   structure = gst_message_get_structure (msg);
@@ -136,6 +140,8 @@ GST_START_TEST (test_match_blue_square)
   fail_unless (y == 0);
   fail_unless (width == 8);
   fail_unless (height == 8);
+  fail_unless (gst_structure_get_uint64 (structure, "timestamp", &timestamp));
+  fail_unless_equals_uint64 (timestamp, 0);
 
   gst_message_unref (msg);
 
@@ -152,6 +158,18 @@ GST_START_TEST (test_match_blue_square)
   gst_check_teardown_element (element);
 }
 
+GST_START_TEST (test_match_blue_square)
+{
+  check_match_blue_square (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_match_blue_square_async)
+{
+  check_match_blue_square (TRUE);
+}
+
 GST_END_TEST;
 
 static Suite *
@@ -162,6 +180,7 @@ templatematch_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_match_blue_square);
+  tcase_add_test (tc_chain, test_match_blue_square_async);
 
   return s;
 }
@@ -0,0 +1,274 @@
+/* GStreamer
+ *
+ * unit test for webpenc and webpdec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+#include <stdlib.h>
+
+#define N_FRAMES 8
+#define N_THREADS 4
+
+/* the ball moves, so every frame differs from the one before */
+#define SOURCE "videotestsrc num-buffers=%d pattern=ball ! " \
+    "video/x-raw,format=%s,width=64,height=48,framerate=25/1"
+
+static GMutex buffers_lock;
+static GList *buffers;
+
+static void
+on_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    gpointer user_data)
+{
+  g_mutex_lock (&buffers_lock);
+  buffers = g_list_append (buffers, gst_buffer_ref (buffer));
+  g_mutex_unlock (&buffers_lock);
+}
+
+/* Runs @desc, which ends in a fakesink named sink, to EOS and returns the
+ * buffers it received. The negotiated caps are stored in @caps. */
+static GList *
+run_pipeline (const gchar * desc, GstCaps ** caps)
+{
+  GstElement *pipeline, *sink;
+  GstMessage *msg;
+  GstPad *pad;
+  GstBus *bus;
+  GList *ret;
+
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (on_handoff), NULL);
+
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  pad = gst_element_get_static_pad (sink, "sink");
+  *caps = gst_pad_get_current_caps (pad);
+  fail_unless (*caps != NULL);
+  gst_object_unref (pad);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  ret = buffers;
+  buffers = NULL;
+  fail_unless_equals_int (g_list_length (ret), N_FRAMES);
+
+  return ret;
+}
+
+static GList *
+encode (const gchar * format, gboolean lossless, guint max_threads)
+{
+  GList *ret;
+  GstCaps *caps;
+  gchar *desc;
+
+  desc = g_strdup_printf (SOURCE " ! webpenc lossless=%s quality=90 "
+      "max-threads=%u ! fakesink name=sink sync=false signal-handoffs=true",
+      N_FRAMES, format, lossless ? "true" : "false", max_threads);
+  ret = run_pipeline (desc, &caps);
+  g_free (desc);
+
+  fail_unless (gst_structure_has_name (gst_caps_get_structure (caps, 0),
+          "image/webp"));
+  gst_caps_unref (caps);
+
+  return ret;
+}
+
+/* Encoding in parallel gives the same images, in the same order, as
+ * encoding one frame after the other */
+static void
+check_threads (const gchar * format, gboolean lossless)
+{
+  GList *single, *threaded, *l, *m;
+
+  single = encode (format, lossless, 1);
+  threaded = encode (format, lossless, N_THREADS);
+
+  for (l = single, m = threaded; l && m; l = l->next, m = m->next) {
+    GstBuffer *a = l->data, *b = m->data;
+    GstMapInfo map;
+
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (a), GST_BUFFER_PTS (b));
+    fail_unless_equals_int (gst_buffer_get_size (a), gst_buffer_get_size (b));
+    gst_buffer_map (a, &map, GST_MAP_READ);
+    fail_unless (gst_buffer_memcmp (b, 0, map.data, map.size) == 0);
+    gst_buffer_unmap (a, &map);
+  }
+
+  g_list_free_full (single, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (threaded, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* Mean absolute difference of all the samples of two frames */
+static gdouble
+frame_difference (GstVideoInfo * info_a, GstBuffer * a, GstVideoInfo * info_b,
+    GstBuffer * b)
+{
+  GstVideoFrame frame_a, frame_b;
+  guint64 sum = 0, n_samples = 0;
+  gint c, x, y;
+
+  fail_unless (gst_video_frame_map (&frame_a, info_a, a, GST_MAP_READ));
+  fail_unless (gst_video_frame_map (&frame_b, info_b, b, GST_MAP_READ));
+
+  for (c = 0; c < GST_VIDEO_FRAME_N_COMPONENTS (&frame_a); c++) {
+    gint width = GST_VIDEO_FRAME_COMP_WIDTH (&frame_a, c);
+    gint pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (&frame_a, c);
+
+    for (y = 0; y < GST_VIDEO_FRAME_COMP_HEIGHT (&frame_a, c); y++) {
+      const guint8 *row_a = GST_VIDEO_FRAME_COMP_DATA (&frame_a, c);
+      const guint8 *row_b = GST_VIDEO_FRAME_COMP_DATA (&frame_b, c);
+
+      row_a += y * GST_VIDEO_FRAME_COMP_STRIDE (&frame_a, c);
+      row_b += y * GST_VIDEO_FRAME_COMP_STRIDE (&frame_b, c);
+      for (x = 0; x < width; x++)
+        sum += abs (row_a[x * pstride] - row_b[x * pstride]);
+      n_samples += width;
+    }
+  }
+
+  gst_video_frame_unmap (&frame_a);
+  gst_video_frame_unmap (&frame_b);
+
+  return (gdouble) sum / n_samples;
+}
+
+/* Encodes with N_THREADS threads, decodes the images back to @format and
+ * compares them to the source frames */
+static void
+check_round_trip (const gchar * format, gboolean lossless,
+    gdouble max_difference)
+{
+  GstVideoInfo ref_info, out_info;
+  GList *reference, *decoded, *l, *m;
+  GstCaps *caps;
+  gchar *desc;
+
+  desc = g_strdup_printf (SOURCE " ! fakesink name=sink sync=false "
+      "signal-handoffs=true", N_FRAMES, format);
+  reference = run_pipeline (desc, &caps);
+  g_free (desc);
+  fail_unless (gst_video_info_from_caps (&ref_info, caps));
+  gst_caps_unref (caps);
+
+  desc = g_strdup_printf (SOURCE " ! webpenc lossless=%s quality=90 "
+      "max-threads=%u ! webpdec ! video/x-raw,format=%s ! "
+      "fakesink name=sink sync=false signal-handoffs=true", N_FRAMES, format,
+      lossless ? "true" : "false", N_THREADS, format);
+  decoded = run_pipeline (desc, &caps);
+  g_free (desc);
+  fail_unless (gst_video_info_from_caps (&out_info, caps));
+  gst_caps_unref (caps);
+
+  fail_unless_equals_int (GST_VIDEO_INFO_FORMAT (&out_info),
+      GST_VIDEO_INFO_FORMAT (&ref_info));
+  fail_unless_equals_int (GST_VIDEO_INFO_WIDTH (&out_info), 64);
+  fail_unless_equals_int (GST_VIDEO_INFO_HEIGHT (&out_info), 48);
+
+  for (l = reference, m = decoded; l && m; l = l->next, m = m->next) {
+    gdouble difference;
+
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (m->data),
+        GST_BUFFER_PTS (l->data));
+    difference = frame_difference (&ref_info, l->data, &out_info, m->data);
+    fail_unless (difference <= max_difference,
+        "frame differs by %f on average", difference);
+  }
+
+  g_list_free_full (reference, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (decoded, (GDestroyNotify) gst_buffer_unref);
+}
+
+GST_START_TEST (test_threads_lossless)
+{
+  check_threads ("RGB", TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads_lossy)
+{
+  check_threads ("RGB", FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads_i420)
+{
+  check_threads ("I420", FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_round_trip_lossless)
+{
+  check_round_trip ("RGB", TRUE, 0.0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_round_trip_lossy)
+{
+  check_round_trip ("RGB", FALSE, 4.0);
+}
+
+GST_END_TEST;
+
+/* I420 is encoded and decoded without any colorspace conversion */
+GST_START_TEST (test_round_trip_i420)
+{
+  check_round_trip ("I420", FALSE, 2.0);
+}
+
+GST_END_TEST;
+
+static Suite *
+webp_suite (void)
+{
+  Suite *s = suite_create ("webp");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_threads_lossless);
+  tcase_add_test (tc_chain, test_threads_lossy);
+  tcase_add_test (tc_chain, test_threads_i420);
+  tcase_add_test (tc_chain, test_round_trip_lossless);
+  tcase_add_test (tc_chain, test_round_trip_lossy);
+  tcase_add_test (tc_chain, test_round_trip_i420);
+
+  return s;
+}
+
+GST_CHECK_MAIN (webp);
@@ -306,6 +306,65 @@ GST_START_TEST (test_mpegts_nit)
 
 GST_END_TEST;
 
+/* Bit-at-a-time CRC-32/MPEG-2 */
+static guint32
+reference_crc32 (const guint8 * data, gsize size)
+{
+  guint32 crc = 0xffffffff;
+  gsize i;
+  gint b;
+
+  for (i = 0; i < size; i++) {
+    crc ^= data[i] << 24;
+    for (b = 0; b < 8; b++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+GST_START_TEST (test_mpegts_section_crc)
+{
+  GstMpegtsNITStream *stream;
+  GstMpegtsNIT *nit;
+  GstMpegtsSection *nit_section;
+  gchar name[256];
+  guint8 *data;
+  gsize data_size;
+  gint i, j;
+
+  /* Sections of all sizes between 32 and a few hundred bytes, to get every
+   * remainder of the block sizes the CRC is computed in */
+  for (i = 0; i < 400; i++) {
+    nit = gst_mpegts_nit_new ();
+    nit->network_id = i;
+
+    memset (name, 'a' + i % 26, sizeof (name));
+    name[1 + i % 200] = '\0';
+    g_ptr_array_add (nit->descriptors,
+        gst_mpegts_descriptor_from_dvb_network_name (name));
+
+    for (j = 0; j < i / 200; j++) {
+      stream = gst_mpegts_nit_stream_new ();
+      stream->transport_stream_id = j;
+      g_ptr_array_add (stream->descriptors,
+          gst_mpegts_descriptor_from_dvb_network_name ("Another network"));
+      g_ptr_array_add (nit->streams, stream);
+    }
+
+    nit_section = gst_mpegts_section_from_nit (nit);
+    data = gst_mpegts_section_packetize (nit_section, &data_size);
+    fail_if (data == NULL);
+
+    assert_equals_int (GST_READ_UINT32_BE (data + data_size - 4),
+        reference_crc32 (data, data_size - 4));
+
+    gst_mpegts_section_unref (nit_section);
+  }
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_mpegts_sdt)
 {
   GstMpegtsSDTService *service;
@@ -573,6 +632,7 @@ mpegts_suite (void)
   tcase_add_test (tc_chain, test_mpegts_pat);
   tcase_add_test (tc_chain, test_mpegts_pmt);
   tcase_add_test (tc_chain, test_mpegts_nit);
+  tcase_add_test (tc_chain, test_mpegts_section_crc);
   tcase_add_test (tc_chain, test_mpegts_sdt);
   tcase_add_test (tc_chain, test_mpegts_atsc_stt);
   tcase_add_test (tc_chain, test_mpegts_descriptors);
@@ -0,0 +1,143 @@
+/* Gstreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <gst/check/gstcheck.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/codecparsers/gstmpegvideoparser.h>
+
+/* Start codes are searched in blocks of up to 32 bytes, so plant them at
+ * every alignment around a few block boundaries */
+#define MAX_SC_OFFSET 100
+
+/* Filler without any zero byte, so it never contains a start code */
+static void
+fill_noise (guint8 * data, gsize size, guint32 seed)
+{
+  GRand *rand = g_rand_new_with_seed (seed);
+  gsize i;
+
+  for (i = 0; i < size; i++)
+    data[i] = g_rand_int_range (rand, 1, 256);
+
+  g_rand_free (rand);
+}
+
+GST_START_TEST (test_start_code_h264_alignment)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  guint8 data[MAX_SC_OFFSET + 64];
+  GstH264NalUnit nalu;
+  GstH264ParserResult res;
+  guint sc1, sc2;
+
+  for (sc1 = 0; sc1 < MAX_SC_OFFSET; sc1++) {
+    for (sc2 = sc1 + 6; sc2 < sizeof (data) - 4; sc2 += 7) {
+      fill_noise (data, sizeof (data), sc1 * 1000 + sc2);
+      /* IDR slice followed by an access unit delimiter */
+      memcpy (data + sc1, "\x00\x00\x01\x65", 4);
+      memcpy (data + sc2, "\x00\x00\x01\x09", 4);
+
+      res = gst_h264_parser_identify_nalu (parser, data, 0, sizeof (data),
+          &nalu);
+      assert_equals_int (res, GST_H264_PARSER_OK);
+      assert_equals_int (nalu.sc_offset, sc1);
+      assert_equals_int (nalu.offset, sc1 + 3);
+      assert_equals_int (nalu.size, sc2 - sc1 - 3);
+      assert_equals_int (nalu.type, GST_H264_NAL_SLICE_IDR);
+
+      res = gst_h264_parser_identify_nalu (parser, data, nalu.offset +
+          nalu.size, sizeof (data), &nalu);
+      assert_equals_int (res, GST_H264_PARSER_NO_NAL_END);
+      assert_equals_int (nalu.offset, sc2 + 3);
+      assert_equals_int (nalu.type, GST_H264_NAL_AU_DELIMITER);
+    }
+  }
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_start_code_h265_alignment)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  guint8 data[MAX_SC_OFFSET + 64];
+  GstH265NalUnit nalu;
+  GstH265ParserResult res;
+  guint sc;
+
+  for (sc = 0; sc < MAX_SC_OFFSET; sc++) {
+    fill_noise (data, sizeof (data), sc);
+    /* IDR_W_RADL slice */
+    memcpy (data + sc, "\x00\x00\x01\x26\x01", 5);
+
+    res = gst_h265_parser_identify_nalu (parser, data, 0, sizeof (data),
+        &nalu);
+    assert_equals_int (res, GST_H265_PARSER_NO_NAL_END);
+    assert_equals_int (nalu.sc_offset, sc);
+    assert_equals_int (nalu.type, GST_H265_NAL_SLICE_IDR_W_RADL);
+  }
+
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_start_code_mpegvideo_alignment)
+{
+  guint8 data[MAX_SC_OFFSET + 64];
+  GstMpegVideoPacket packet;
+  guint sc, end;
+
+  for (sc = 0; sc < MAX_SC_OFFSET; sc++) {
+    /* No start code in the last 3 bytes can be found */
+    for (end = sc + 4; end <= sizeof (data); end += 5) {
+      fill_noise (data, sizeof (data), sc * 1000 + end);
+      memcpy (data + sc, "\x00\x00\x01\xb3", 4);
+
+      fail_unless (gst_mpeg_video_parse (&packet, data, end, 0));
+      assert_equals_int (packet.offset, sc + 4);
+      assert_equals_int (packet.type, GST_MPEG_VIDEO_PACKET_SEQUENCE);
+      assert_equals_int (packet.size, -1);
+    }
+
+    /* Not followed by any byte */
+    fill_noise (data, sizeof (data), sc);
+    memcpy (data + sc, "\x00\x00\x01", 3);
+    fail_if (gst_mpeg_video_parse (&packet, data, sc + 3, 0));
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+startcode_suite (void)
+{
+  Suite *s = suite_create ("Start code scanning");
+
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_start_code_h264_alignment);
+  tcase_add_test (tc_chain, test_start_code_h265_alignment);
+  tcase_add_test (tc_chain, test_start_code_mpegvideo_alignment);
+
+  return s;
+}
+
+GST_CHECK_MAIN (startcode);
@@ -21,7 +21,9 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
+#include <unistd.h>
 
 static const gchar *
 get_mpeg2enc_element_name (void)
@@ -260,6 +262,316 @@ GST_START_TEST (test_multiple_av_streams)
 
 GST_END_TEST;
 
+/* Runs a pipeline without demuxer to EOS */
+static void
+run_pipeline (const gchar * pipeline_string)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+
+  GST_DEBUG ("Running pipeline '%s'", pipeline_string);
+
+  pipeline = gst_parse_launch (pipeline_string, NULL);
+  fail_unless (pipeline != NULL);
+
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (pipeline);
+}
+
+typedef struct
+{
+  guint64 offset;
+  guint8 kind;
+  guint64 this_partition;
+  guint64 prev_partition;
+  guint64 footer_partition;
+  guint64 index_byte_count;
+  guint32 index_sid;
+  guint64 body_offset;
+  guint32 body_sid;
+
+  /* bytes of index table segments following the partition pack */
+  guint64 index_bytes;
+} Partition;
+
+#define PARTITION_HEADER 0x02
+#define PARTITION_BODY 0x03
+#define PARTITION_FOOTER 0x04
+
+typedef struct
+{
+  GArray *partitions;
+  /* essence offset of every picture element, which start the content
+   * packages here */
+  GArray *pictures;
+  /* stream offsets of all index entries */
+  GArray *index_entries;
+  /* offsets of the partitions in the random index pack */
+  GArray *rip;
+  GArray *rip_body_sids;
+} MXFLayout;
+
+static const guint8 mxf_key_prefix[] = { 0x06, 0x0e, 0x2b, 0x34 };
+
+static void
+parse_index_table_segment (MXFLayout * layout, const guint8 * data,
+    guint64 size)
+{
+  guint64 start = G_MAXUINT64, duration = 0;
+  guint32 n_entries = 0, entry_size = 0;
+  const guint8 *entries = NULL;
+  guint i;
+
+  while (size >= 4) {
+    guint16 tag = GST_READ_UINT16_BE (data);
+    guint16 len = GST_READ_UINT16_BE (data + 2);
+
+    fail_unless (size >= 4 + len);
+    if (tag == 0x3f0c) {
+      start = GST_READ_UINT64_BE (data + 4);
+    } else if (tag == 0x3f0d) {
+      duration = GST_READ_UINT64_BE (data + 4);
+    } else if (tag == 0x3f0a) {
+      n_entries = GST_READ_UINT32_BE (data + 4);
+      entry_size = GST_READ_UINT32_BE (data + 8);
+      entries = data + 12;
+      fail_unless (len == 8 + n_entries * entry_size);
+    }
+    data += 4 + len;
+    size -= 4 + len;
+  }
+
+  /* segments are contiguous and variable-size, listing every edit unit */
+  fail_unless_equals_int64 (start, layout->index_entries->len);
+  fail_unless_equals_int64 (duration, n_entries);
+
+  for (i = 0; i < n_entries; i++) {
+    guint64 stream_offset = GST_READ_UINT64_BE (entries + i * entry_size + 3);
+
+    g_array_append_val (layout->index_entries, stream_offset);
+  }
+}
+
+static void
+parse_partition (MXFLayout * layout, guint8 kind, guint64 offset,
+    const guint8 * data, guint64 size)
+{
+  Partition p;
+
+  fail_unless (size >= 88);
+  p.offset = offset;
+  p.kind = kind;
+  p.this_partition = GST_READ_UINT64_BE (data + 8);
+  p.prev_partition = GST_READ_UINT64_BE (data + 16);
+  p.footer_partition = GST_READ_UINT64_BE (data + 24);
+  p.index_byte_count = GST_READ_UINT64_BE (data + 40);
+  p.index_sid = GST_READ_UINT32_BE (data + 48);
+  p.body_offset = GST_READ_UINT64_BE (data + 52);
+  p.body_sid = GST_READ_UINT32_BE (data + 60);
+  p.index_bytes = 0;
+  g_array_append_val (layout->partitions, p);
+}
+
+/* Walks over all KLV packets of the file, which has no run-in */
+static void
+parse_layout (MXFLayout * layout, const guint8 * data, gsize size)
+{
+  guint64 offset = 0, essence_offset = 0;
+
+  layout->partitions = g_array_new (FALSE, FALSE, sizeof (Partition));
+  layout->pictures = g_array_new (FALSE, FALSE, sizeof (guint64));
+  layout->index_entries = g_array_new (FALSE, FALSE, sizeof (guint64));
+  layout->rip = g_array_new (FALSE, FALSE, sizeof (guint64));
+  layout->rip_body_sids = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  while (offset < size) {
+    const guint8 *key = data + offset;
+    guint64 len, klv_size;
+    guint ber_size = 1, i;
+
+    fail_unless (size - offset >= 17);
+    fail_unless (memcmp (key, mxf_key_prefix, 4) == 0);
+
+    len = key[16];
+    if (len & 0x80) {
+      ber_size += len & 0x7f;
+      fail_unless (size - offset >= 16 + ber_size);
+      for (len = 0, i = 1; i < ber_size; i++)
+        len = (len << 8) | key[16 + i];
+    }
+    klv_size = 16 + ber_size + len;
+    fail_unless (size - offset >= klv_size);
+
+    if (key[4] == 0x02 && key[8] == 0x0d && key[9] == 0x01 &&
+        key[10] == 0x02 && key[11] == 0x01 && key[12] == 0x01) {
+      const guint8 *value = key + 16 + ber_size;
+
+      if (key[13] >= PARTITION_HEADER && key[13] <= PARTITION_FOOTER) {
+        parse_partition (layout, key[13], offset, value, len);
+      } else if (key[13] == 0x10) {
+        fail_unless (layout->partitions->len > 0);
+        g_array_index (layout->partitions, Partition,
+            layout->partitions->len - 1).index_bytes += klv_size;
+        parse_index_table_segment (layout, value, len);
+      } else if (key[13] == 0x11) {
+        /* the random index pack ends the file */
+        fail_unless_equals_int64 (offset + klv_size, size);
+        fail_unless_equals_int64 (GST_READ_UINT32_BE (value + len - 4),
+            klv_size);
+        for (i = 0; i + 4 < len; i += 12) {
+          guint32 body_sid = GST_READ_UINT32_BE (value + i);
+          guint64 rip_offset = GST_READ_UINT64_BE (value + i + 4);
+
+          g_array_append_val (layout->rip_body_sids, body_sid);
+          g_array_append_val (layout->rip, rip_offset);
+        }
+      }
+    } else if (key[4] == 0x01 && key[5] == 0x02 && key[8] == 0x0d &&
+        key[9] == 0x01 && key[10] == 0x03 && key[11] == 0x01) {
+      /* generic container picture item */
+      if (key[12] == 0x15)
+        g_array_append_val (layout->pictures, essence_offset);
+      essence_offset += klv_size;
+    }
+
+    offset += klv_size;
+  }
+}
+
+static void
+free_layout (MXFLayout * layout)
+{
+  g_array_free (layout->partitions, TRUE);
+  g_array_free (layout->pictures, TRUE);
+  g_array_free (layout->index_entries, TRUE);
+  g_array_free (layout->rip, TRUE);
+  g_array_free (layout->rip_body_sids, TRUE);
+}
+
+/* Returns the number of the content package at @essence_offset */
+static guint
+find_content_package (MXFLayout * layout, guint64 essence_offset)
+{
+  guint i;
+
+  for (i = 0; i < layout->pictures->len; i++) {
+    if (g_array_index (layout->pictures, guint64, i) == essence_offset)
+      return i;
+  }
+
+  fail_unless (FALSE, "no content package at essence offset %"
+      G_GUINT64_FORMAT, essence_offset);
+  return 0;
+}
+
+#define N_FRAMES 250
+#define FRAMES_PER_PARTITION 25
+
+GST_START_TEST (test_body_partitions)
+{
+  MXFLayout layout;
+  Partition *partitions, *footer;
+  gchar *location, *pipeline, *contents;
+  gsize size;
+  guint i, n_body = 0;
+  gint fd;
+
+  fd = g_file_open_tmp ("mxf-test-XXXXXX.mxf", &location, NULL);
+  fail_unless (fd != -1);
+  close (fd);
+
+  /* 1 s partitions with 25 fps video */
+  pipeline = g_strdup_printf ("videotestsrc num-buffers=%u ! "
+      "video/x-raw,format=(string)v308,width=320,height=240,framerate=25/1 ! "
+      "mxfmux name=mux partition-duration=1000000000 "
+      "repeat-header-metadata=true ! "
+      "filesink location=%s "
+      "audiotestsrc num-buffers=250 ! "
+      "audioconvert ! " "audio/x-raw,rate=48000,channels=2 ! " "mux. ",
+      N_FRAMES, location);
+  run_pipeline (pipeline);
+  g_free (pipeline);
+
+  fail_unless (g_file_get_contents (location, &contents, &size, NULL));
+  parse_layout (&layout, (const guint8 *) contents, size);
+  partitions = (Partition *) layout.partitions->data;
+
+  fail_unless_equals_int (layout.pictures->len, N_FRAMES);
+  fail_unless (layout.partitions->len >= 3);
+  fail_unless_equals_int (partitions[0].kind, PARTITION_HEADER);
+  footer = &partitions[layout.partitions->len - 1];
+  fail_unless_equals_int (footer->kind, PARTITION_FOOTER);
+
+  /* the header is rewritten at the end and points at the footer */
+  fail_unless_equals_int64 (partitions[0].footer_partition, footer->offset);
+  fail_unless_equals_int64 (footer->footer_partition, footer->offset);
+
+  for (i = 0; i < layout.partitions->len; i++) {
+    Partition *p = &partitions[i];
+
+    fail_unless_equals_int64 (p->this_partition, p->offset);
+    fail_unless_equals_int64 (p->prev_partition,
+        (i > 0) ? partitions[i - 1].offset : 0);
+    fail_unless_equals_int64 (p->index_byte_count, p->index_bytes);
+    fail_unless ((p->index_sid != 0) == (p->index_bytes > 0));
+
+    if (p->kind != PARTITION_BODY)
+      continue;
+
+    /* every body partition starts with a whole content package, and all but
+     * the first hold the index of the previous partition's essence */
+    fail_unless_equals_int (find_content_package (&layout, p->body_offset),
+        n_body * FRAMES_PER_PARTITION);
+    fail_unless (p->body_sid != 0);
+    if (n_body > 0)
+      fail_unless (p->index_bytes > 0);
+    n_body++;
+  }
+  fail_unless_equals_int (n_body, N_FRAMES / FRAMES_PER_PARTITION);
+
+  /* the index lists all content packages in order */
+  fail_unless_equals_int (layout.index_entries->len, N_FRAMES);
+  for (i = 0; i < N_FRAMES; i++)
+    fail_unless_equals_int64 (g_array_index (layout.index_entries, guint64, i),
+        g_array_index (layout.pictures, guint64, i));
+
+  /* the random index pack lists every partition */
+  fail_unless_equals_int (layout.rip->len, layout.partitions->len);
+  for (i = 0; i < layout.rip->len; i++) {
+    fail_unless_equals_int64 (g_array_index (layout.rip, guint64, i),
+        partitions[i].offset);
+    if (partitions[i].kind != PARTITION_HEADER)
+      fail_unless_equals_int (g_array_index (layout.rip_body_sids, guint32,
+              i), partitions[i].body_sid);
+  }
+
+  free_layout (&layout);
+  g_free (contents);
+
+  /* mxfdemux finds its way through the partitions in pull mode */
+  pipeline = g_strdup_printf ("filesrc location=%s ! "
+      "mxfdemux name=demux ! fakesink", location);
+  run_test (pipeline, 2);
+  g_free (pipeline);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
 static Suite *
 mxf_suite (void)
 {
@@ -280,6 +592,7 @@ mxf_suite (void)
   tcase_add_test (tc_chain, test_jpeg2000_alaw);
   tcase_add_test (tc_chain, test_dnxhd_mp3);
   tcase_add_test (tc_chain, test_multiple_av_streams);
+  tcase_add_test (tc_chain, test_body_partitions);
 
   return s;
 }